@@ -145,6 +145,12 @@ const tsip_header_t* SipMessage::getSipHeader(const char* name, unsigned index /
 		return tsk_null;
 	}			
 
+	/* lazy parsing: the header could still be raw, another thread could be parsing it */
+	tsip_message_lock(m_pSipMessage);
+	if(m_pSipMessage->deferred.count){
+		tsip_message_parse_deferred(m_pSipMessage, tsip_header_get_type(name, tsk_strlen(name)));
+	}
+
 	if(tsk_striequals(name, "v") || tsk_striequals(name, "via")){
 		if(index == 0){
 			hdr = (const tsip_header_t*)m_pSipMessage->firstVia;
@@ -203,6 +209,7 @@ const tsip_header_t* SipMessage::getSipHeader(const char* name, unsigned index /
 	
 
 bail:
+	tsip_message_unlock(m_pSipMessage);
 	return hdr;
 }
 
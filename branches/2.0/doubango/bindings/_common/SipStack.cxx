@@ -307,6 +307,25 @@ bool SipStack::setSSLCertificates(const char* privKey, const char* pubKey, const
 		TSIP_STACK_SET_NULL()) == 0);
 }
 
+bool SipStack::setSSLSessions(unsigned cacheSize, unsigned lifetime, unsigned ticketKeyRotation)
+{
+	return (tsip_stack_set(m_pHandle,
+		TSIP_STACK_SET_TLS_SESSIONS(cacheSize, lifetime, ticketKeyRotation),
+		TSIP_STACK_SET_NULL()) == 0);
+}
+
+uint64_t SipStack::getSSLHandshakesCount(bool server, bool resumed)
+{
+	tnet_tls_stats_t stats;
+	if(tsip_stack_get_tls_stats(m_pHandle, &stats) != 0){
+		return 0;
+	}
+	if(server){
+		return resumed ? stats.server.resumed : stats.server.full;
+	}
+	return resumed ? stats.client.resumed : stats.client.full;
+}
+
 bool SipStack::setIPSecSecAgree(bool enabled)
 {
 	tsk_bool_t _enable = enabled;
@@ -388,6 +407,13 @@ bool SipStack::setMaxFDs(unsigned max_fds)
 		TSIP_STACK_SET_NULL()) == 0);
 }
 
+bool SipStack::setNetworkWorkers(unsigned count)
+{
+	return (tsip_stack_set(m_pHandle,
+		TSIP_STACK_SET_NETWORK_WORKERS(count),
+		TSIP_STACK_SET_NULL()) == 0);
+}
+
 char* SipStack::getLocalIPnPort(const char* protocol, unsigned short* OUTPUT)
 {
 	tnet_ip_t ip;
@@ -73,6 +73,8 @@ public: /* API functions */
 	bool setTLSSecAgree(bool enabled);
 	bool setSSLCertificates(const char* privKey, const char* pubKey, const char* caKey, bool verify = false);
 	bool setSSLCretificates(const char* privKey, const char* pubKey, const char* caKey, bool verify = false); /*@deprecated: typo */
+	bool setSSLSessions(unsigned cacheSize, unsigned lifetime, unsigned ticketKeyRotation);
+	uint64_t getSSLHandshakesCount(bool server, bool resumed);
 	bool setIPSecSecAgree(bool enabled);
 	bool setIPSecParameters(const char* algo, const char* ealgo, const char* mode, const char* proto);
 	
@@ -81,6 +83,7 @@ public: /* API functions */
 	char* dnsSrv(const char* service, unsigned short* OUTPUT);
 
 	bool setMaxFDs(unsigned max_fds);
+	bool setNetworkWorkers(unsigned count);
 
 	char* getLocalIPnPort(const char* protocol, unsigned short* OUTPUT);
 
@@ -0,0 +1,55 @@
+/*
+* Copyright (C) 2010-2015 Mamadou DIOP.
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*/
+
+/**@file tdav_audio_mixer.h
+* @brief N-way audio conference mixer (in-process bridge).
+*
+* Each participant is an audio session using the virtual consumer/producer (see @ref tdav_consumer_virtual.h).
+* The decoded PCM of the loudest speakers is summed and every participant receives the mix minus its own voice
+* through its encoder path.
+*/
+#ifndef TINYDAV_AUDIO_MIXER_H
+#define TINYDAV_AUDIO_MIXER_H
+
+#include "tinydav_config.h"
+
+#include "tsk_object.h"
+
+TDAV_BEGIN_DECLS
+
+/** Default maximum number of speakers mixed together. */
+#define TDAV_AUDIO_MIXER_SPEAKERS_MAX_DEFAULT	3
+
+struct tmedia_session_s;
+struct tdav_audio_mixer_s;
+
+TINYDAV_API struct tdav_audio_mixer_s* tdav_audio_mixer_create(uint32_t rate, uint32_t ptime);
+TINYDAV_API int tdav_audio_mixer_set_speakers_max(struct tdav_audio_mixer_s* self, tsk_size_t speakers_max);
+TINYDAV_API int tdav_audio_mixer_add_session(struct tdav_audio_mixer_s* self, struct tmedia_session_s* session);
+TINYDAV_API int tdav_audio_mixer_remove_session(struct tdav_audio_mixer_s* self, struct tmedia_session_s* session);
+TINYDAV_API tsk_size_t tdav_audio_mixer_get_sessions_count(const struct tdav_audio_mixer_s* self);
+
+/* Mixing kernels (SIMD when available, selected on each call): adds 16-bit PCM to a 32-bit mix and
+ * writes the mix minus "own" (optional) saturated to 16-bit */
+TINYDAV_API void tdav_audio_mixer_add(int32_t* mix, const int16_t* pcm, tsk_size_t count);
+TINYDAV_API void tdav_audio_mixer_out(const int32_t* mix, const int16_t* own, int16_t* out, tsk_size_t count);
+
+TDAV_END_DECLS
+
+#endif /* TINYDAV_AUDIO_MIXER_H */
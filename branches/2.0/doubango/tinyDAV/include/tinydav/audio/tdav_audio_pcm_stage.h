@@ -0,0 +1,56 @@
+/*
+* Copyright (C) 2010-2015 Mamadou DIOP.
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*/
+
+/**@file tdav_audio_pcm_stage.h
+* @brief Gain, soft clipping, level metering and VAD scoring done in a single pass over the PCM frame.
+*/
+#ifndef TINYDAV_AUDIO_PCM_STAGE_H
+#define TINYDAV_AUDIO_PCM_STAGE_H
+
+#include "tinydav_config.h"
+
+#include "tsk_object.h"
+
+TDAV_BEGIN_DECLS
+
+/** Levels measured on the last frame (after the gain). */
+typedef struct tdav_audio_pcm_levels_s
+{
+	int32_t rms; /* 0 to 32767 */
+	int32_t peak; /* 0 to 32767 */
+	int32_t dbov; /* RMS level: -127 (silence) to 0 dBov */
+	int32_t vad_score; /* 0 (noise) to 100 (voice), -1 when the scoring is disabled */
+	int32_t clipped; /* samples going through the soft clipper */
+}
+tdav_audio_pcm_levels_t;
+
+typedef struct tdav_audio_pcm_stage_s
+{
+	tsk_bool_t vad_enabled;
+	uint64_t noise_floor; /* mean square, tracked by the VAD */
+	tdav_audio_pcm_levels_t levels;
+}
+tdav_audio_pcm_stage_t;
+
+TINYDAV_API void tdav_audio_pcm_stage_init(tdav_audio_pcm_stage_t* self);
+TINYDAV_API int tdav_audio_pcm_stage_process(tdav_audio_pcm_stage_t* self, void* buffer, tsk_size_t size, uint32_t bits_per_sample, uint8_t gain);
+
+TDAV_END_DECLS
+
+#endif /* TINYDAV_AUDIO_PCM_STAGE_H */
@@ -0,0 +1,53 @@
+/*
+* Copyright (C) 2010-2015 Mamadou DIOP.
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*/
+
+/**@file tdav_audio_resampler.h
+* @brief Polyphase audio resampler plugin. The filter banks are shared by all instances using the same
+* (input rate, output rate, quality).
+*/
+#ifndef TINYDAV_AUDIO_RESAMPLER_H
+#define TINYDAV_AUDIO_RESAMPLER_H
+
+#include "tinydav_config.h"
+
+#include "tinymedia/tmedia_resampler.h"
+
+TDAV_BEGIN_DECLS
+
+/** One conversion processed by @ref tdav_audio_resampler_process_batch(). */
+typedef struct tdav_audio_resampler_batch_item_s
+{
+	tmedia_resampler_t* resampler; /* must be opened and created using @ref tdav_audio_resampler_plugin_def_t */
+	const void* in_data;
+	tsk_size_t in_size_in_sample;
+	void* out_data;
+	tsk_size_t out_size_in_sample;
+	tsk_size_t out_result; /* number of samples written, zero on error */
+}
+tdav_audio_resampler_batch_item_t;
+
+TINYDAV_API int tdav_audio_resampler_init();
+TINYDAV_API int tdav_audio_resampler_deinit();
+TINYDAV_API int tdav_audio_resampler_process_batch(tdav_audio_resampler_batch_item_t* items, tsk_size_t count);
+
+TINYDAV_GEXTERN const tmedia_resampler_plugin_def_t *tdav_audio_resampler_plugin_def_t;
+
+TDAV_END_DECLS
+
+#endif /* TINYDAV_AUDIO_RESAMPLER_H */
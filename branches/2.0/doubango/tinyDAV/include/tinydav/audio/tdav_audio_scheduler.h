@@ -0,0 +1,50 @@
+/*
+* Copyright (C) 2010-2015 Mamadou DIOP.
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*/
+
+/**@file tdav_audio_scheduler.h
+* @brief Drives many audio producers/consumers from a small pool of threads sharing the same clock.
+*/
+#ifndef TINYDAV_AUDIO_SCHEDULER_H
+#define TINYDAV_AUDIO_SCHEDULER_H
+
+#include "tinydav_config.h"
+
+#include "tsk_object.h"
+
+TDAV_BEGIN_DECLS
+
+/** Default clock period (in milliseconds). Each registered entry runs every "ptime / period" ticks. */
+#define TDAV_AUDIO_SCHEDULER_PERIOD_DEFAULT	10
+/** Maximum number of worker threads. */
+#define TDAV_AUDIO_SCHEDULER_WORKERS_MAX	64
+
+/** Called once per packetization time (ptime) from one of the scheduler's workers. Must not block. */
+typedef int (*tdav_audio_scheduler_cb_f)(const void* callback_data);
+
+int tdav_audio_scheduler_init();
+TINYDAV_API int tdav_audio_scheduler_set_workers_count(tsk_size_t count);
+TINYDAV_API int tdav_audio_scheduler_set_period(uint32_t period);
+TINYDAV_API int tdav_audio_scheduler_add(const void* callback_data, tdav_audio_scheduler_cb_f callback, uint32_t ptime);
+TINYDAV_API int tdav_audio_scheduler_remove(const void* callback_data);
+TINYDAV_API int tdav_audio_scheduler_get_stats(tsk_size_t* entries_count, uint64_t* ticks_count, uint64_t* overruns_count);
+int tdav_audio_scheduler_deinit();
+
+TDAV_END_DECLS
+
+#endif /* TINYDAV_AUDIO_SCHEDULER_H */
@@ -141,6 +141,17 @@ typedef struct jitterbuffer {
 	jb_frame *controlframes; /* queued controlframes */
 	jb_settings settings;    /* the settings of the jitterbuffer */
 	jb_info info;            /* the statistics of the jitterbuffer */
+
+	/* preallocated frames, only used when created with jb_new_with_pool() */
+	struct {
+		jb_frame *frames;        /* "count" frames */
+		char *slab;              /* "count" x "data_size" bytes, frame #i owns slot #i */
+		long *free_index;        /* circular index of the free frames */
+		long count;
+		long data_size;
+		long free_head;
+		long free_size;
+	} pool;
 } jitterbuffer;
 
 //parameter definitions
@@ -178,6 +189,17 @@ typedef struct jitterbuffer {
  */
 jitterbuffer *jb_new();
 
+/*
+ * Same as jb_new() but the frames are taken from a slab of frames_count slots
+ * of frame_size bytes allocated once, nothing is allocated by jb_put()/jb_get().
+ * jb_put() copies frame_size bytes from *data and the caller keeps the ownership,
+ * use jb_put_with_size() for smaller frames (e.g. control frames).
+ * When jb_get() returns JB_OK, *data points into the slab, must not be freed and
+ * is valid until the next call to jb_put().
+ * When all the slots are used, new frames are dropped (frames_dropped).
+ */
+jitterbuffer *jb_new_with_pool(long frames_count, long frame_size);
+
 /*
  * The control frames and possible personal settings are kept. 
  * History and voice/silence frames are destroyed. 
@@ -244,6 +266,13 @@ int jb_has_frames(jitterbuffer *jb);
  */
 void jb_put(jitterbuffer *jb, void *data, int type, long ms, long ts, long now, int codec);
 
+/*
+ * Same as jb_put() but, with a pool, only size bytes are copied from *data.
+ * Frames bigger than the pool frame_size are dropped (frames_dropped).
+ * Without a pool, size is ignored.
+ */
+void jb_put_with_size(jitterbuffer *jb, void *data, long size, int type, long ms, long ts, long now, int codec);
+
 /*
  * Get a packet from the jitterbuffer if it's available.
  * control packets have a higher priority above voice and silence packets
@@ -32,6 +32,7 @@
 #include "tinydav_config.h"
 
 #include "tinydav/tdav_session_av.h"
+#include "tinydav/audio/tdav_audio_pcm_stage.h"
 
 #include "tsk_timer.h"
 
@@ -62,6 +63,8 @@ typedef struct tdav_session_audio_s
 			tsk_size_t buffer_size;
 			struct tmedia_resampler_s* instance;
 		} resampler;
+
+		tdav_audio_pcm_stage_t pcm; /* gain and levels of the captured audio */
 	} encoder;
 
 	struct {
@@ -76,6 +79,8 @@ typedef struct tdav_session_audio_s
 			tsk_size_t buffer_size;
 			struct tmedia_resampler_s* instance;
 		} resampler;
+
+		tdav_audio_pcm_stage_t pcm; /* gain and levels of the decoded audio */
 	} decoder;
 
 	struct tmedia_denoise_s* denoise;
@@ -50,10 +50,12 @@ typedef struct tdav_speakup_jitterBuffer_s
 	uint32_t rate;
 	uint32_t channels;
 	uint32_t _10ms_size_bytes;
+	tsk_bool_t slab; /* frames preallocated at open() time, see jb_new_with_pool() */
 }
 tdav_speakup_jitterbuffer_t;
 
 TINYDAV_GEXTERN const tmedia_jitterbuffer_plugin_def_t *tdav_speakup_jitterbuffer_plugin_def_t;
+TINYDAV_GEXTERN const tmedia_jitterbuffer_plugin_def_t *tdav_speakup_slab_jitterbuffer_plugin_def_t;
 
 TDAV_END_DECLS
 
@@ -0,0 +1,41 @@
+/*
+* Copyright (C) 2010-2015 Mamadou DIOP.
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*/
+
+/**@file tdav_consumer_virtual.h
+* @brief Headless audio consumer driven by the audio scheduler (no sound card, e.g. media servers).
+*/
+#ifndef TINYDAV_CONSUMER_VIRTUAL_H
+#define TINYDAV_CONSUMER_VIRTUAL_H
+
+#include "tinydav_config.h"
+
+#include "tinydav/audio/tdav_consumer_audio.h"
+
+TDAV_BEGIN_DECLS
+
+/** Receives one ptime of PCM (16-bit) pulled from the jitter buffer. */
+typedef int (*tdav_consumer_virtual_sink_cb_f)(const void* callback_data, const void* in_data, tsk_size_t in_size);
+
+TINYDAV_API int tdav_consumer_virtual_set_sink(struct tmedia_consumer_s* self, tdav_consumer_virtual_sink_cb_f callback, const void* callback_data);
+
+TINYDAV_GEXTERN const tmedia_consumer_plugin_def_t *tdav_consumer_virtual_plugin_def_t;
+
+TDAV_END_DECLS
+
+#endif /* TINYDAV_CONSUMER_VIRTUAL_H */
@@ -0,0 +1,41 @@
+/*
+* Copyright (C) 2010-2015 Mamadou DIOP.
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*/
+
+/**@file tdav_producer_virtual.h
+* @brief Headless audio producer driven by the audio scheduler (no sound card, e.g. media servers).
+*/
+#ifndef TINYDAV_PRODUCER_VIRTUAL_H
+#define TINYDAV_PRODUCER_VIRTUAL_H
+
+#include "tinydav_config.h"
+
+#include "tinydav/audio/tdav_producer_audio.h"
+
+TDAV_BEGIN_DECLS
+
+/** Fills @a out_data with up to @a out_size bytes of PCM (16-bit) and returns the number of bytes written. The remaining bytes are set to silence. */
+typedef tsk_size_t (*tdav_producer_virtual_source_cb_f)(const void* callback_data, void* out_data, tsk_size_t out_size);
+
+TINYDAV_API int tdav_producer_virtual_set_source(struct tmedia_producer_s* self, tdav_producer_virtual_source_cb_f callback, const void* callback_data);
+
+TINYDAV_GEXTERN const tmedia_producer_plugin_def_t *tdav_producer_virtual_plugin_def_t;
+
+TDAV_END_DECLS
+
+#endif /* TINYDAV_PRODUCER_VIRTUAL_H */
@@ -32,6 +32,8 @@
 
 #include "tinydav_config.h"
 
+#include "tsk_common.h"
+
 TDAV_BEGIN_DECLS
 
 unsigned char linear2alaw(short	pcm_val);
@@ -39,6 +41,14 @@ short alaw2linear(unsigned char	a_val);
 unsigned char linear2ulaw(short	pcm_val);
 short ulaw2linear(unsigned char	u_val);
 
+/* Block conversions (table-driven, SIMD when available), bit-exact with the functions above.
+ * g711_init() builds the tables and must be called first (done by tdav_init()) */
+int g711_init();
+void linear2alaw_block(const short* pcm, unsigned char* a_val, tsk_size_t count);
+void alaw2linear_block(const unsigned char* a_val, short* pcm, tsk_size_t count);
+void linear2ulaw_block(const short* pcm, unsigned char* u_val, tsk_size_t count);
+void ulaw2linear_block(const unsigned char* u_val, short* pcm, tsk_size_t count);
+
 TDAV_END_DECLS
 
 #endif /* TINYDAV_CODEC_G711_IMPLEMENTATION_H */
@@ -138,6 +138,8 @@ int tdav_session_av_set_ro(tdav_session_av_t* self, const struct tsdp_header_M_s
 const tmedia_codec_t* tdav_session_av_get_best_neg_codec(const tdav_session_av_t* self);
 const tmedia_codec_t* tdav_session_av_get_red_codec(const tdav_session_av_t* self);
 const tmedia_codec_t* tdav_session_av_get_ulpfec_codec(const tdav_session_av_t* self);
+TINYDAV_API int tdav_session_av_relay_start(tdav_session_av_t* self, tdav_session_av_t* peer, tsk_bool_t local_delivery);
+TINYDAV_API int tdav_session_av_relay_stop(tdav_session_av_t* self, tdav_session_av_t* peer);
 int tdav_session_av_deinit(tdav_session_av_t* self);
 
 TDAV_END_DECLS
@@ -77,11 +77,12 @@ tdav_video_jb_cb_data_xt;
 typedef int (*tdav_video_jb_cb_f)(const tdav_video_jb_cb_data_xt* data);
 #define TDAV_VIDEO_JB_CB_F(self) ((tdav_video_jb_cb_f)(self))
 
-struct tdav_video_jb_s* tdav_video_jb_create();
-int tdav_video_jb_set_callback(struct tdav_video_jb_s* self, tdav_video_jb_cb_f callback, const void* usr_data);
-int tdav_video_jb_start(struct tdav_video_jb_s* self);
-int tdav_video_jb_put(struct tdav_video_jb_s* self, struct trtp_rtp_packet_s* rtp_pkt);
-int tdav_video_jb_stop(struct tdav_video_jb_s* self);
+TINYDAV_API struct tdav_video_jb_s* tdav_video_jb_create();
+TINYDAV_API int tdav_video_jb_set_callback(struct tdav_video_jb_s* self, tdav_video_jb_cb_f callback, const void* usr_data);
+TINYDAV_API int tdav_video_jb_set_fps(struct tdav_video_jb_s* self, int32_t fps);
+TINYDAV_API int tdav_video_jb_start(struct tdav_video_jb_s* self);
+TINYDAV_API int tdav_video_jb_put(struct tdav_video_jb_s* self, struct trtp_rtp_packet_s* rtp_pkt);
+TINYDAV_API int tdav_video_jb_stop(struct tdav_video_jb_s* self);
 
 TDAV_END_DECLS
 
@@ -32,6 +32,7 @@
 
 #include "tinydav_config.h"
 #include "tinydav/tdav_session_av.h"
+#include "tinydav/video/tdav_video_avpf_history.h"
 
 TDAV_BEGIN_DECLS
 
@@ -67,6 +68,21 @@ typedef struct tdav_session_video_s
 
 		void* conv_buffer;
 		tsk_size_t conv_buffer_size;
+		tsk_size_t yuv420p_size; // size of the converted frame in "conv_buffer", zero when not converted
+
+		// frames from the producer waiting for the shared video pool (converted on the producer's thread)
+		struct{
+			struct tdav_video_pool_stream_s* stream; // null -> encoded on the producer's thread
+			tsk_mutex_handle_t* h_mutex;
+			void* buffer; // latest frame, swapped with "conv_buffer" by the producer
+			tsk_size_t buffer_size;
+			tsk_size_t size;
+			void* work_buffer; // frame being encoded, swapped with "buffer" by the encode job
+			tsk_size_t work_buffer_size;
+			tsk_size_t work_size;
+			tsk_bool_t posted; // whether the encode job is pending
+			uint64_t skipped; // frames replaced by a newer one before being encoded
+		} pending;
 
 		tdav_session_video_pkt_loss_level_t pkt_loss_level;
 		int32_t pkt_loss_fact;
@@ -110,10 +126,17 @@ typedef struct tdav_session_video_s
 		struct tmedia_converter_video_s* toYUV420;
 	} conv;
 
+	// history of the sent packets (as serialized, after SRTP) used to honor RTCP-NACK requests
 	struct{
-		tsk_list_t* packets;
-		tsk_size_t count;
-		tsk_size_t max;
+		tdav_video_avpf_history_t history;
+		tsk_size_t max; // minimum number of packets to keep, grows when NACKs arrive too late
+		uint32_t rtt; // round-trip time (millis) computed from the RTCP report blocks
+		struct{
+			uint64_t start;
+			tsk_size_t count;
+			tsk_size_t rate; // packets per second
+		} pps;
+		tsk_mutex_handle_t* h_mutex;
 		uint64_t last_fir_time;
 		uint64_t last_pli_time;
 	} avpf;
@@ -0,0 +1,61 @@
+/*
+* Copyright (C) 2010-2015 Mamadou DIOP.
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*/
+
+/**@file tdav_video_avpf_history.h
+* @brief History of the sent RTP packets (as serialized, after SRTP) used to honor the RTCP-NACK requests.
+* Not thread-safe: the owner serializes the calls.
+*/
+#ifndef TINYDAV_VIDEO_AVPF_HISTORY_H
+#define TINYDAV_VIDEO_AVPF_HISTORY_H
+
+#include "tinydav_config.h"
+
+#include "tsk_object.h"
+
+TDAV_BEGIN_DECLS
+
+/** Size of the preallocated slots: a full MTU packet plus the SRTP trailer. Bigger packets are allocated apart. */
+#define TDAV_VIDEO_AVPF_HISTORY_SLOT_SIZE	1536
+
+typedef struct tdav_video_avpf_history_slot_s
+{
+	uint16_t seq_num;
+	tsk_size_t size; // zero if the slot is empty
+	void* ext; // only for the (rare) packets bigger than TDAV_VIDEO_AVPF_HISTORY_SLOT_SIZE
+	tsk_size_t ext_size;
+}
+tdav_video_avpf_history_slot_t;
+
+typedef struct tdav_video_avpf_history_s
+{
+	tdav_video_avpf_history_slot_t* slots; // ring indexed by "seq_num & (capacity - 1)"
+	uint8_t* storage; // "capacity" preallocated slots of TDAV_VIDEO_AVPF_HISTORY_SLOT_SIZE bytes
+	tsk_size_t capacity; // power of two, zero until the first resize
+}
+tdav_video_avpf_history_t;
+
+TINYDAV_API int tdav_video_avpf_history_resize(tdav_video_avpf_history_t* self, tsk_size_t capacity);
+TINYDAV_API int tdav_video_avpf_history_put(tdav_video_avpf_history_t* self, uint16_t seq_num, const void* data, tsk_size_t size);
+TINYDAV_API const void* tdav_video_avpf_history_get(const tdav_video_avpf_history_t* self, uint16_t seq_num, tsk_size_t* size, int32_t* overwritten_by);
+TINYDAV_API void tdav_video_avpf_history_clear(tdav_video_avpf_history_t* self);
+TINYDAV_API void tdav_video_avpf_history_deinit(tdav_video_avpf_history_t* self);
+
+TDAV_END_DECLS
+
+#endif /* TINYDAV_VIDEO_AVPF_HISTORY_H */
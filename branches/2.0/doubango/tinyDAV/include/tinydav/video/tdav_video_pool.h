@@ -0,0 +1,75 @@
+/*
+* Copyright (C) 2010-2015 Mamadou DIOP.
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*/
+
+/**@file tdav_video_pool.h
+* @brief Shared pool of threads running the video decode and encode jobs of all sessions.
+*/
+#ifndef TINYDAV_VIDEO_POOL_H
+#define TINYDAV_VIDEO_POOL_H
+
+#include "tinydav_config.h"
+
+#include "tsk_object.h"
+
+TDAV_BEGIN_DECLS
+
+/** Maximum number of worker threads. */
+#define TDAV_VIDEO_POOL_WORKERS_MAX			64
+/** Maximum number of jobs waiting on a stream. */
+#define TDAV_VIDEO_POOL_STREAM_JOBS_MAX		16
+
+typedef enum tdav_video_pool_stage_e
+{
+	tdav_video_pool_stage_decode,
+	tdav_video_pool_stage_encode,
+
+	tdav_video_pool_stage_count
+}
+tdav_video_pool_stage_t;
+
+/** Per-stage metrics. Latencies are the time spent in the queue (after the requested delay) and are in milliseconds like the run times. */
+typedef struct tdav_video_pool_stats_s
+{
+	tsk_size_t queue_depth;
+	tsk_size_t queue_depth_max;
+	uint64_t jobs_count;
+	uint64_t jobs_dropped;
+	uint64_t latency_avg;
+	uint64_t latency_max;
+	uint64_t run_avg;
+	uint64_t run_max;
+}
+tdav_video_pool_stats_t;
+
+/** Runs a job on one of the workers. Jobs posted on the same stream run in order and never concurrently. */
+typedef int (*tdav_video_pool_cb_f)(const void* callback_data);
+
+struct tdav_video_pool_stream_s;
+
+TINYDAV_API int tdav_video_pool_init();
+TINYDAV_API int tdav_video_pool_set_workers_count(tsk_size_t count);
+TINYDAV_API struct tdav_video_pool_stream_s* tdav_video_pool_stream_create();
+TINYDAV_API int tdav_video_pool_stream_close(struct tdav_video_pool_stream_s* stream);
+TINYDAV_API int tdav_video_pool_post(struct tdav_video_pool_stream_s* stream, tdav_video_pool_stage_t stage, tdav_video_pool_cb_f callback, const void* callback_data, uint64_t delay);
+TINYDAV_API int tdav_video_pool_get_stats(tdav_video_pool_stage_t stage, tdav_video_pool_stats_t* stats);
+TINYDAV_API int tdav_video_pool_deinit();
+
+TDAV_END_DECLS
+
+#endif /* TINYDAV_VIDEO_POOL_H */
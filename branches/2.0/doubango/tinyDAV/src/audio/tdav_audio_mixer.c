@@ -0,0 +1,494 @@
+/*
+* Copyright (C) 2010-2015 Mamadou DIOP.
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*/
+
+/**@file tdav_audio_mixer.c
+* @brief N-way audio conference mixer (in-process bridge).
+*
+* The virtual consumer of each participant hands the decoded frame (one ptime) to the mixer. When a virtual
+* producer asks for its next frame and it already got the current mix, a new mix is computed: the frames of
+* the K loudest participants are summed into 32-bit accumulators. Each participant then gets the sum minus its
+* own contribution, saturated to 16-bit, which goes through the session's encoder path.
+* The accumulation and the saturation are done with SSE2 or NEON when available.
+*/
+#include "tinydav/audio/tdav_audio_mixer.h"
+#include "tinydav/audio/virtual/tdav_consumer_virtual.h"
+#include "tinydav/audio/virtual/tdav_producer_virtual.h"
+#include "tinydav/tdav_session_av.h"
+
+#include "tinymedia/tmedia_session.h"
+
+#include "tsk_memory.h"
+#include "tsk_safeobj.h"
+#include "tsk_cpu.h"
+#include "tsk_debug.h"
+
+#if TSK_CPU_X86
+#	include <emmintrin.h>
+#elif TSK_CPU_NEON
+#	include <arm_neon.h>
+#endif
+
+typedef struct tdav_audio_mixer_participant_s
+{
+	struct tdav_audio_mixer_s* mixer; /* weak */
+	struct tmedia_session_s* session;
+	struct tmedia_consumer_s* consumer;
+	struct tmedia_producer_s* producer;
+
+	int16_t* frame; /* last frame decoded */
+	tsk_bool_t frame_fresh; /* not used by a mix yet */
+	int16_t* contrib; /* what was summed in the current mix */
+	tsk_bool_t in_mix;
+	uint64_t level; /* smoothed energy */
+	uint64_t mix_seq; /* last mix sent */
+	tsk_bool_t removing;
+}
+tdav_audio_mixer_participant_t;
+
+typedef struct tdav_audio_mixer_s
+{
+	TSK_DECLARE_OBJECT;
+
+	uint32_t rate;
+	uint32_t ptime;
+	tsk_size_t frame_samples;
+	tsk_size_t speakers_max;
+
+	tdav_audio_mixer_participant_t** participants;
+	tsk_size_t participants_count;
+	tsk_size_t participants_capacity;
+
+	int32_t* mix;
+	uint64_t mix_seq;
+	tdav_audio_mixer_participant_t** speakers;
+
+	TSK_DECLARE_SAFEOBJ;
+}
+tdav_audio_mixer_t;
+
+static void _tdav_audio_mixer_add(int32_t* mix, const int16_t* pcm, tsk_size_t count)
+{
+	tsk_size_t i;
+	for (i = 0; i < count; ++i) {
+		mix[i] += pcm[i];
+	}
+}
+
+static void _tdav_audio_mixer_out(const int32_t* mix, const int16_t* own, int16_t* out, tsk_size_t count)
+{
+	tsk_size_t i;
+	int32_t v;
+	for (i = 0; i < count; ++i) {
+		v = own ? (mix[i] - own[i]) : mix[i];
+		out[i] = (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+	}
+}
+
+#if TSK_CPU_X86
+TSK_CPU_TARGET("sse2") static void _tdav_audio_mixer_add_sse2(int32_t* mix, const int16_t* pcm, tsk_size_t count)
+{
+	tsk_size_t i = 0;
+	__m128i x;
+	for (; i + 8 <= count; i += 8) {
+		x = _mm_loadu_si128((const __m128i*)&pcm[i]);
+		/* sign extend to 32-bit */
+		_mm_storeu_si128((__m128i*)&mix[i], _mm_add_epi32(_mm_loadu_si128((const __m128i*)&mix[i]), _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)));
+		_mm_storeu_si128((__m128i*)&mix[i + 4], _mm_add_epi32(_mm_loadu_si128((const __m128i*)&mix[i + 4]), _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16)));
+	}
+	_tdav_audio_mixer_add(&mix[i], &pcm[i], count - i);
+}
+
+TSK_CPU_TARGET("sse2") static void _tdav_audio_mixer_out_sse2(const int32_t* mix, const int16_t* own, int16_t* out, tsk_size_t count)
+{
+	tsk_size_t i = 0;
+	__m128i lo, hi, x;
+	for (; i + 8 <= count; i += 8) {
+		lo = _mm_loadu_si128((const __m128i*)&mix[i]);
+		hi = _mm_loadu_si128((const __m128i*)&mix[i + 4]);
+		if (own) {
+			x = _mm_loadu_si128((const __m128i*)&own[i]);
+			lo = _mm_sub_epi32(lo, _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+			hi = _mm_sub_epi32(hi, _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+		}
+		/* saturating pack */
+		_mm_storeu_si128((__m128i*)&out[i], _mm_packs_epi32(lo, hi));
+	}
+	_tdav_audio_mixer_out(&mix[i], own ? &own[i] : tsk_null, &out[i], count - i);
+}
+#elif TSK_CPU_NEON
+static void _tdav_audio_mixer_add_neon(int32_t* mix, const int16_t* pcm, tsk_size_t count)
+{
+	tsk_size_t i = 0;
+	int16x8_t x;
+	for (; i + 8 <= count; i += 8) {
+		x = vld1q_s16(&pcm[i]);
+		vst1q_s32(&mix[i], vaddw_s16(vld1q_s32(&mix[i]), vget_low_s16(x)));
+		vst1q_s32(&mix[i + 4], vaddw_s16(vld1q_s32(&mix[i + 4]), vget_high_s16(x)));
+	}
+	_tdav_audio_mixer_add(&mix[i], &pcm[i], count - i);
+}
+
+static void _tdav_audio_mixer_out_neon(const int32_t* mix, const int16_t* own, int16_t* out, tsk_size_t count)
+{
+	tsk_size_t i = 0;
+	int32x4_t lo, hi;
+	int16x8_t x;
+	for (; i + 8 <= count; i += 8) {
+		lo = vld1q_s32(&mix[i]);
+		hi = vld1q_s32(&mix[i + 4]);
+		if (own) {
+			x = vld1q_s16(&own[i]);
+			lo = vsubw_s16(lo, vget_low_s16(x));
+			hi = vsubw_s16(hi, vget_high_s16(x));
+		}
+		/* saturating narrow */
+		vst1q_s16(&out[i], vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+	}
+	_tdav_audio_mixer_out(&mix[i], own ? &own[i] : tsk_null, &out[i], count - i);
+}
+#endif
+
+void tdav_audio_mixer_add(int32_t* mix, const int16_t* pcm, tsk_size_t count)
+{
+#if TSK_CPU_X86
+	if (tsk_cpu_has(tsk_cpu_flag_sse2)) {
+		_tdav_audio_mixer_add_sse2(mix, pcm, count);
+		return;
+	}
+#elif TSK_CPU_NEON
+	if (tsk_cpu_has(tsk_cpu_flag_neon)) {
+		_tdav_audio_mixer_add_neon(mix, pcm, count);
+		return;
+	}
+#endif
+	_tdav_audio_mixer_add(mix, pcm, count);
+}
+
+void tdav_audio_mixer_out(const int32_t* mix, const int16_t* own, int16_t* out, tsk_size_t count)
+{
+#if TSK_CPU_X86
+	if (tsk_cpu_has(tsk_cpu_flag_sse2)) {
+		_tdav_audio_mixer_out_sse2(mix, own, out, count);
+		return;
+	}
+#elif TSK_CPU_NEON
+	if (tsk_cpu_has(tsk_cpu_flag_neon)) {
+		_tdav_audio_mixer_out_neon(mix, own, out, count);
+		return;
+	}
+#endif
+	_tdav_audio_mixer_out(mix, own, out, count);
+}
+
+/* mean square */
+static uint64_t _tdav_audio_mixer_energy(const int16_t* pcm, tsk_size_t count)
+{
+	tsk_size_t i;
+	uint64_t energy = 0;
+	for (i = 0; i < count; ++i) {
+		energy += (uint64_t)((int32_t)pcm[i] * (int32_t)pcm[i]);
+	}
+	return count ? (energy / count) : 0;
+}
+
+/* must be called with the mixer locked */
+static void _tdav_audio_mixer_mix(tdav_audio_mixer_t* self)
+{
+	tsk_size_t i, j, speakers_count = 0;
+	tdav_audio_mixer_participant_t* p;
+
+	/* top-K fresh frames by level (K is small: insertion sort) */
+	for (i = 0; i < self->participants_count; ++i) {
+		p = self->participants[i];
+		p->in_mix = tsk_false;
+		if (!p->frame_fresh || !p->level) {
+			continue;
+		}
+		for (j = speakers_count; j > 0 && self->speakers[j - 1]->level < p->level; --j) {
+			if (j < self->speakers_max) {
+				self->speakers[j] = self->speakers[j - 1];
+			}
+		}
+		if (j < self->speakers_max) {
+			self->speakers[j] = p;
+			if (speakers_count < self->speakers_max) {
+				++speakers_count;
+			}
+		}
+	}
+
+	memset(self->mix, 0, self->frame_samples * sizeof(int32_t));
+	for (i = 0; i < speakers_count; ++i) {
+		p = self->speakers[i];
+		/* the frame could be overwritten before all the mixes are sent */
+		memcpy(p->contrib, p->frame, self->frame_samples * sizeof(int16_t));
+		p->in_mix = tsk_true;
+		tdav_audio_mixer_add(self->mix, p->contrib, self->frame_samples);
+	}
+	/* a frame is mixed at most once (late frames are dropped rather than repeated) */
+	for (i = 0; i < self->participants_count; ++i) {
+		self->participants[i]->frame_fresh = tsk_false;
+	}
+	++self->mix_seq;
+}
+
+/* virtual consumer sink: decoded audio from the participant */
+static int _tdav_audio_mixer_sink(const void* callback_data, const void* in_data, tsk_size_t in_size)
+{
+	tdav_audio_mixer_participant_t* p = (tdav_audio_mixer_participant_t*)callback_data;
+	tdav_audio_mixer_t* self = p->mixer;
+	uint64_t energy;
+
+	if (in_size != (self->frame_samples * sizeof(int16_t))) {
+		TSK_DEBUG_WARN("Frame size mismatch: %u <> %u (rate=%u, ptime=%u, mono)", (unsigned)in_size, (unsigned)(self->frame_samples * sizeof(int16_t)), self->rate, self->ptime);
+		return -1;
+	}
+	energy = _tdav_audio_mixer_energy((const int16_t*)in_data, self->frame_samples);
+
+	tsk_safeobj_lock(self);
+	memcpy(p->frame, in_data, in_size);
+	p->frame_fresh = tsk_true;
+	p->level = ((p->level * 3) + energy) >> 2;
+	tsk_safeobj_unlock(self);
+	return 0;
+}
+
+/* virtual producer source: audio to encode and send to the participant */
+static tsk_size_t _tdav_audio_mixer_source(const void* callback_data, void* out_data, tsk_size_t out_size)
+{
+	tdav_audio_mixer_participant_t* p = (tdav_audio_mixer_participant_t*)callback_data;
+	tdav_audio_mixer_t* self = p->mixer;
+	tsk_size_t count = TSK_MIN(out_size / sizeof(int16_t), self->frame_samples);
+
+	tsk_safeobj_lock(self);
+	if (p->mix_seq == self->mix_seq) {
+		/* already got the current mix: move to the next tick */
+		_tdav_audio_mixer_mix(self);
+	}
+	p->mix_seq = self->mix_seq;
+	tdav_audio_mixer_out(self->mix, p->in_mix ? p->contrib : tsk_null, (int16_t*)out_data, count);
+	tsk_safeobj_unlock(self);
+
+	return (count * sizeof(int16_t));
+}
+
+static void _tdav_audio_mixer_participant_detach(tdav_audio_mixer_participant_t* p)
+{
+	/* both return when the callbacks are no longer running */
+	tdav_producer_virtual_set_source(p->producer, tsk_null, tsk_null);
+	tdav_consumer_virtual_set_sink(p->consumer, tsk_null, tsk_null);
+}
+
+static void _tdav_audio_mixer_participant_free(tdav_audio_mixer_participant_t** p)
+{
+	if (p && *p) {
+		TSK_OBJECT_SAFE_FREE((*p)->consumer);
+		TSK_OBJECT_SAFE_FREE((*p)->producer);
+		TSK_OBJECT_SAFE_FREE((*p)->session);
+		TSK_FREE((*p)->frame);
+		TSK_FREE((*p)->contrib);
+		TSK_FREE(*p);
+	}
+}
+
+/** Sets the maximum number of speakers mixed together (caps the cost per tick). */
+int tdav_audio_mixer_set_speakers_max(tdav_audio_mixer_t* self, tsk_size_t speakers_max)
+{
+	tdav_audio_mixer_participant_t** speakers;
+	if (!self || !speakers_max) {
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	tsk_safeobj_lock(self);
+	if (!(speakers = tsk_realloc(self->speakers, speakers_max * sizeof(tdav_audio_mixer_participant_t*)))) {
+		TSK_DEBUG_ERROR("Failed to allocate speakers");
+		tsk_safeobj_unlock(self);
+		return -2;
+	}
+	self->speakers = speakers;
+	self->speakers_max = speakers_max;
+	tsk_safeobj_unlock(self);
+	return 0;
+}
+
+/** Adds an audio session to the conference. The session must be using the virtual consumer and producer. */
+int tdav_audio_mixer_add_session(tdav_audio_mixer_t* self, tmedia_session_t* session)
+{
+	tdav_audio_mixer_participant_t* p = tsk_null;
+	tsk_size_t i;
+	int ret = 0;
+
+	if (!self || !session || session->type != tmedia_audio || !TDAV_SESSION_AV(session)->producer || !TDAV_SESSION_AV(session)->consumer) {
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	if (TDAV_SESSION_AV(session)->producer->plugin != tdav_producer_virtual_plugin_def_t || TDAV_SESSION_AV(session)->consumer->plugin != tdav_consumer_virtual_plugin_def_t) {
+		TSK_DEBUG_ERROR("The session must be using the virtual audio consumer and producer");
+		return -2;
+	}
+
+	if (!(p = tsk_calloc(1, sizeof(tdav_audio_mixer_participant_t))) || !(p->frame = tsk_calloc(self->frame_samples, sizeof(int16_t))) || !(p->contrib = tsk_calloc(self->frame_samples, sizeof(int16_t)))) {
+		TSK_DEBUG_ERROR("Failed to allocate participant");
+		_tdav_audio_mixer_participant_free(&p);
+		return -3;
+	}
+	p->mixer = self;
+	p->session = tsk_object_ref(session);
+	p->producer = tsk_object_ref(TDAV_SESSION_AV(session)->producer);
+	p->consumer = tsk_object_ref(TDAV_SESSION_AV(session)->consumer);
+
+	tsk_safeobj_lock(self);
+	for (i = 0; i < self->participants_count; ++i) {
+		if (self->participants[i]->session == session) {
+			TSK_DEBUG_WARN("Session already in the conference");
+			ret = -4;
+			goto bail;
+		}
+	}
+	if (self->participants_count == self->participants_capacity) {
+		tsk_size_t capacity = self->participants_capacity ? (self->participants_capacity << 1) : 8;
+		tdav_audio_mixer_participant_t** participants = tsk_realloc(self->participants, capacity * sizeof(tdav_audio_mixer_participant_t*));
+		if (!participants) {
+			TSK_DEBUG_ERROR("Failed to allocate participants");
+			ret = -5;
+			goto bail;
+		}
+		self->participants = participants;
+		self->participants_capacity = capacity;
+	}
+	p->mix_seq = self->mix_seq; /* join at the next mix */
+	self->participants[self->participants_count++] = p;
+bail:
+	tsk_safeobj_unlock(self);
+
+	if (ret == 0) {
+		/* the callbacks take the mixer's lock: must not be held here */
+		tdav_consumer_virtual_set_sink(p->consumer, _tdav_audio_mixer_sink, p);
+		tdav_producer_virtual_set_source(p->producer, _tdav_audio_mixer_source, p);
+	}
+	else {
+		_tdav_audio_mixer_participant_free(&p);
+	}
+	return ret;
+}
+
+/** Removes an audio session from the conference. */
+int tdav_audio_mixer_remove_session(tdav_audio_mixer_t* self, tmedia_session_t* session)
+{
+	tdav_audio_mixer_participant_t* p = tsk_null;
+	tsk_size_t i;
+
+	if (!self || !session) {
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+
+	tsk_safeobj_lock(self);
+	for (i = 0; i < self->participants_count; ++i) {
+		if (self->participants[i]->session == session && !self->participants[i]->removing) {
+			p = self->participants[i];
+			p->removing = tsk_true;
+			break;
+		}
+	}
+	tsk_safeobj_unlock(self);
+
+	if (!p) {
+		return 0;
+	}
+
+	/* the callbacks take the mixer's lock: must not be held here */
+	_tdav_audio_mixer_participant_detach(p);
+
+	tsk_safeobj_lock(self);
+	for (i = 0; i < self->participants_count; ++i) {
+		if (self->participants[i] == p) {
+			memmove(&self->participants[i], &self->participants[i + 1], (self->participants_count - i - 1) * sizeof(tdav_audio_mixer_participant_t*));
+			--self->participants_count;
+			break;
+		}
+	}
+	tsk_safeobj_unlock(self);
+
+	_tdav_audio_mixer_participant_free(&p);
+	return 0;
+}
+
+tsk_size_t tdav_audio_mixer_get_sessions_count(const tdav_audio_mixer_t* self)
+{
+	return self ? self->participants_count : 0;
+}
+
+
+//
+//	Audio mixer object definition
+//
+static tsk_object_t* tdav_audio_mixer_ctor(tsk_object_t * self, va_list * app)
+{
+	tdav_audio_mixer_t *mixer = (tdav_audio_mixer_t*)self;
+	if (mixer) {
+		tsk_safeobj_init(mixer);
+	}
+	return self;
+}
+static tsk_object_t* tdav_audio_mixer_dtor(tsk_object_t * self)
+{ 
+	tdav_audio_mixer_t *mixer = (tdav_audio_mixer_t*)self;
+	if (mixer) {
+		tsk_size_t i;
+		for (i = 0; i < mixer->participants_count; ++i) {
+			_tdav_audio_mixer_participant_detach(mixer->participants[i]);
+			_tdav_audio_mixer_participant_free(&mixer->participants[i]);
+		}
+		TSK_FREE(mixer->participants);
+		TSK_FREE(mixer->speakers);
+		TSK_FREE(mixer->mix);
+		tsk_safeobj_deinit(mixer);
+	}
+	return self;
+}
+static const tsk_object_def_t tdav_audio_mixer_def_s = 
+{
+	sizeof(tdav_audio_mixer_t),
+	tdav_audio_mixer_ctor, 
+	tdav_audio_mixer_dtor,
+	tsk_null, 
+};
+
+/** Creates a mixer. All participants must decode and encode mono PCM with the same rate and ptime. */
+tdav_audio_mixer_t* tdav_audio_mixer_create(uint32_t rate, uint32_t ptime)
+{
+	tdav_audio_mixer_t* self;
+	tsk_size_t frame_samples = (rate * ptime) / 1000;
+
+	if (!frame_samples) {
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return tsk_null;
+	}
+	if ((self = tsk_object_new(&tdav_audio_mixer_def_s))) {
+		self->rate = rate;
+		self->ptime = ptime;
+		self->frame_samples = frame_samples;
+		if (!(self->mix = tsk_calloc(frame_samples, sizeof(int32_t))) || tdav_audio_mixer_set_speakers_max(self, TDAV_AUDIO_MIXER_SPEAKERS_MAX_DEFAULT)) {
+			TSK_DEBUG_ERROR("Failed to allocate mixer buffers");
+			TSK_OBJECT_SAFE_FREE(self);
+		}
+	}
+	return self;
+}
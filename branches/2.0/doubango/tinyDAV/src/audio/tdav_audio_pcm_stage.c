@@ -0,0 +1,278 @@
+/*
+* Copyright (C) 2010-2015 Mamadou DIOP.
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*/
+
+/**@file tdav_audio_pcm_stage.c
+* @brief Gain, soft clipping, level metering and VAD scoring done in a single pass over the PCM frame.
+*
+* The gain is a power of two (same meaning as the consumer/producer "gain" field) applied in Q8. Above
+* TDAV_AUDIO_PCM_STAGE_KNEE the amplified samples are compressed 4:1 instead of wrapping or being left
+* unchanged, then saturated. The sum of squares and the peak of the output are accumulated in the same loop
+* (SSE2 or NEON when available, checked on each call). The VAD score compares the frame energy with a noise floor tracked frame
+* after frame.
+*/
+#include "tinydav/audio/tdav_audio_pcm_stage.h"
+
+#include "tsk_cpu.h"
+#include "tsk_debug.h"
+
+#include <math.h>
+#include <string.h>
+
+#if TSK_CPU_X86
+#	include <emmintrin.h>
+#elif TSK_CPU_NEON
+#	include <arm_neon.h>
+#endif
+
+#define TDAV_AUDIO_PCM_STAGE_UNITY		256 /* Q8 */
+#define TDAV_AUDIO_PCM_STAGE_GAIN_MAX	6 /* 64x, the Q8 gain must fit in 16 bits */
+#define TDAV_AUDIO_PCM_STAGE_KNEE		24576 /* about -2.5 dBFS */
+/* energy above the noise floor (in dB) giving a VAD score of 100 */
+#define TDAV_AUDIO_PCM_STAGE_VAD_RANGE	15
+/* below this level the frame is never considered as voice */
+#define TDAV_AUDIO_PCM_STAGE_VAD_MIN_DBOV	-55
+
+static void _tdav_audio_pcm_stage_kernel(int16_t* pcm, tsk_size_t count, int32_t gain_q8, uint64_t* sum_sq, int32_t* peak, int32_t* clipped)
+{
+	tsk_size_t i;
+	int32_t v, over, under;
+	uint64_t sum = 0;
+	int32_t pk = *peak, clp = 0;
+	for (i = 0; i < count; ++i) {
+		v = pcm[i];
+		if (gain_q8 != TDAV_AUDIO_PCM_STAGE_UNITY) {
+			v = (v * gain_q8) >> 8;
+			over = v - TDAV_AUDIO_PCM_STAGE_KNEE;
+			under = v + TDAV_AUDIO_PCM_STAGE_KNEE;
+			if (over > 0) {
+				v -= over - (over >> 2);
+				++clp;
+			}
+			else if (under < 0) {
+				v -= under - (under >> 2);
+				++clp;
+			}
+			v = (v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+			pcm[i] = (int16_t)v;
+		}
+		sum += (uint64_t)(v * v);
+		v = v < 0 ? -v : v;
+		pk = (v > 32767 ? 32767 : (v > pk ? v : pk));
+	}
+	*sum_sq += sum;
+	*peak = pk;
+	*clipped += clp;
+}
+
+#if TSK_CPU_X86
+TSK_CPU_TARGET("sse2") static __m128i _tdav_audio_pcm_stage_soft_clip_sse2(__m128i v, __m128i* clipped)
+{
+	const __m128i knee = _mm_set1_epi32(TDAV_AUDIO_PCM_STAGE_KNEE), zero = _mm_setzero_si128();
+	__m128i over = _mm_sub_epi32(v, knee), under = _mm_add_epi32(v, knee);
+	__m128i m_over = _mm_cmpgt_epi32(over, zero), m_under = _mm_cmplt_epi32(under, zero);
+	over = _mm_and_si128(over, m_over);
+	under = _mm_and_si128(under, m_under);
+	*clipped = _mm_sub_epi32(_mm_sub_epi32(*clipped, m_over), m_under);
+	v = _mm_add_epi32(_mm_sub_epi32(v, over), _mm_srai_epi32(over, 2));
+	return _mm_add_epi32(_mm_sub_epi32(v, under), _mm_srai_epi32(under, 2));
+}
+
+TSK_CPU_TARGET("sse2") static void _tdav_audio_pcm_stage_kernel_sse2(int16_t* pcm, tsk_size_t count, int32_t gain_q8, uint64_t* sum_sq, int32_t* peak, int32_t* clipped)
+{
+	const __m128i zero = _mm_setzero_si128(), g = _mm_set1_epi16((int16_t)gain_q8);
+	__m128i x, p_lo, p_hi, lo, hi, sq, acc = _mm_setzero_si128(), pk = _mm_setzero_si128(), clp = _mm_setzero_si128();
+	int32_t out[4];
+	int16_t pks[8];
+	uint64_t sums[2];
+	tsk_size_t i = 0, k;
+	for (; i + 8 <= count; i += 8) {
+		x = _mm_loadu_si128((const __m128i*)&pcm[i]);
+		if (gain_q8 != TDAV_AUDIO_PCM_STAGE_UNITY) {
+			p_lo = _mm_mullo_epi16(x, g);
+			p_hi = _mm_mulhi_epi16(x, g);
+			/* 32-bit products, back to Q0 */
+			lo = _mm_srai_epi32(_mm_unpacklo_epi16(p_lo, p_hi), 8);
+			hi = _mm_srai_epi32(_mm_unpackhi_epi16(p_lo, p_hi), 8);
+			x = _mm_packs_epi32(_tdav_audio_pcm_stage_soft_clip_sse2(lo, &clp), _tdav_audio_pcm_stage_soft_clip_sse2(hi, &clp));
+			_mm_storeu_si128((__m128i*)&pcm[i], x);
+		}
+		/* pairs of squares are below 2^31 */
+		sq = _mm_madd_epi16(x, x);
+		acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(sq, zero));
+		acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(sq, zero));
+		pk = _mm_max_epi16(pk, _mm_max_epi16(x, _mm_subs_epi16(zero, x)));
+	}
+	_mm_storeu_si128((__m128i*)sums, acc);
+	_mm_storeu_si128((__m128i*)pks, pk);
+	_mm_storeu_si128((__m128i*)out, clp);
+	*sum_sq += sums[0] + sums[1];
+	for (k = 0; k < 8; ++k) {
+		*peak = TSK_MAX(*peak, pks[k]);
+	}
+	*clipped += out[0] + out[1] + out[2] + out[3];
+	_tdav_audio_pcm_stage_kernel(&pcm[i], count - i, gain_q8, sum_sq, peak, clipped);
+}
+#elif TSK_CPU_NEON
+static int32x4_t _tdav_audio_pcm_stage_soft_clip_neon(int32x4_t v, int32x4_t* clipped)
+{
+	const int32x4_t knee = vdupq_n_s32(TDAV_AUDIO_PCM_STAGE_KNEE), zero = vdupq_n_s32(0);
+	int32x4_t over = vmaxq_s32(vsubq_s32(v, knee), zero), under = vminq_s32(vaddq_s32(v, knee), zero);
+	*clipped = vsubq_s32(*clipped, vreinterpretq_s32_u32(vcgtq_s32(over, zero)));
+	*clipped = vsubq_s32(*clipped, vreinterpretq_s32_u32(vcltq_s32(under, zero)));
+	v = vaddq_s32(vsubq_s32(v, over), vshrq_n_s32(over, 2));
+	return vaddq_s32(vsubq_s32(v, under), vshrq_n_s32(under, 2));
+}
+
+static void _tdav_audio_pcm_stage_kernel_neon(int16_t* pcm, tsk_size_t count, int32_t gain_q8, uint64_t* sum_sq, int32_t* peak, int32_t* clipped)
+{
+	const int16x4_t g = vdup_n_s16((int16_t)gain_q8);
+	int16x8_t x;
+	int16x4_t pk4;
+	int32x4_t lo, hi, clp = vdupq_n_s32(0);
+	int32x2_t clp2;
+	uint64x2_t acc = vdupq_n_u64(0);
+	int16x8_t pk = vdupq_n_s16(0);
+	tsk_size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		x = vld1q_s16(&pcm[i]);
+		if (gain_q8 != TDAV_AUDIO_PCM_STAGE_UNITY) {
+			lo = vshrq_n_s32(vmull_s16(vget_low_s16(x), g), 8);
+			hi = vshrq_n_s32(vmull_s16(vget_high_s16(x), g), 8);
+			x = vcombine_s16(vqmovn_s32(_tdav_audio_pcm_stage_soft_clip_neon(lo, &clp)), vqmovn_s32(_tdav_audio_pcm_stage_soft_clip_neon(hi, &clp)));
+			vst1q_s16(&pcm[i], x);
+		}
+		acc = vpadalq_u32(acc, vreinterpretq_u32_s32(vmull_s16(vget_low_s16(x), vget_low_s16(x))));
+		acc = vpadalq_u32(acc, vreinterpretq_u32_s32(vmull_s16(vget_high_s16(x), vget_high_s16(x))));
+		pk = vmaxq_s16(pk, vqabsq_s16(x));
+	}
+	*sum_sq += vgetq_lane_u64(acc, 0) + vgetq_lane_u64(acc, 1);
+	pk4 = vpmax_s16(vget_low_s16(pk), vget_high_s16(pk));
+	pk4 = vpmax_s16(pk4, pk4);
+	pk4 = vpmax_s16(pk4, pk4);
+	*peak = TSK_MAX(*peak, vget_lane_s16(pk4, 0));
+	clp2 = vadd_s32(vget_low_s32(clp), vget_high_s32(clp));
+	*clipped += vget_lane_s32(vpadd_s32(clp2, clp2), 0);
+	_tdav_audio_pcm_stage_kernel(&pcm[i], count - i, gain_q8, sum_sq, peak, clipped);
+}
+#endif
+
+static void _tdav_audio_pcm_stage_score(tdav_audio_pcm_stage_t* self, uint64_t mean_square)
+{
+	double snr;
+	if (!self->vad_enabled) {
+		self->levels.vad_score = -1;
+		return;
+	}
+	/* the floor follows the quiet frames quickly and the loud ones slowly */
+	if (!self->noise_floor || mean_square < self->noise_floor) {
+		self->noise_floor = (self->noise_floor + mean_square + 1) >> 1;
+	}
+	else {
+		self->noise_floor += ((mean_square - self->noise_floor) >> 7) + 1;
+	}
+	if (self->levels.dbov < TDAV_AUDIO_PCM_STAGE_VAD_MIN_DBOV) {
+		self->levels.vad_score = 0;
+		return;
+	}
+	snr = 10.0 * log10((double)(mean_square + 1) / (double)(self->noise_floor + 1));
+	self->levels.vad_score = (int32_t)(TSK_CLAMP(0.0, (snr * 100.0) / TDAV_AUDIO_PCM_STAGE_VAD_RANGE, 100.0));
+}
+
+/**@ingroup tdav_audio_pcm_stage_group
+*/
+void tdav_audio_pcm_stage_init(tdav_audio_pcm_stage_t* self)
+{
+	if (!self) {
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return;
+	}
+	memset(self, 0, sizeof(*self));
+	self->vad_enabled = tsk_true;
+	self->levels.dbov = -127;
+}
+
+/**@ingroup tdav_audio_pcm_stage_group
+* Applies the gain (in place) and updates the levels.
+* @param self the stage.
+* @param buffer the PCM frame.
+* @param size the size of the frame in bytes.
+* @param bits_per_sample 8 or 16. The levels of 8-bit samples are scaled to 16-bit.
+* @param gain the gain as a power of two (0 means no gain, capped to 6).
+* @retval zero if succeed and non-zero error code otherwise.
+*/
+int tdav_audio_pcm_stage_process(tdav_audio_pcm_stage_t* self, void* buffer, tsk_size_t size, uint32_t bits_per_sample, uint8_t gain)
+{
+	uint64_t sum_sq = 0, mean_square;
+	int32_t peak = 0, clipped = 0, gain_q8 = TDAV_AUDIO_PCM_STAGE_UNITY << TSK_MIN(gain, TDAV_AUDIO_PCM_STAGE_GAIN_MAX);
+	tsk_size_t count;
+
+	if (!self || !buffer) {
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+
+	if (bits_per_sample == 16) {
+		count = size >> 1;
+#if TSK_CPU_X86
+		if (tsk_cpu_has(tsk_cpu_flag_sse2)) {
+			_tdav_audio_pcm_stage_kernel_sse2((int16_t*)buffer, count, gain_q8, &sum_sq, &peak, &clipped);
+		}
+		else
+#elif TSK_CPU_NEON
+		if (tsk_cpu_has(tsk_cpu_flag_neon)) {
+			_tdav_audio_pcm_stage_kernel_neon((int16_t*)buffer, count, gain_q8, &sum_sq, &peak, &clipped);
+		}
+		else
+#endif
+		{
+			_tdav_audio_pcm_stage_kernel((int16_t*)buffer, count, gain_q8, &sum_sq, &peak, &clipped);
+		}
+	}
+	else if (bits_per_sample == 8) {
+		int8_t* pcm = (int8_t*)buffer;
+		int32_t v;
+		tsk_size_t i;
+		count = size;
+		for (i = 0; i < count; ++i) {
+			v = (pcm[i] * gain_q8) >> 8;
+			if (v > 127 || v < -128) {
+				v = v > 127 ? 127 : -128;
+				++clipped;
+			}
+			pcm[i] = (int8_t)v;
+			v <<= 8;
+			sum_sq += (uint64_t)(v * v);
+			peak = TSK_MAX(peak, (v < 0 ? -v : v));
+		}
+		peak = TSK_MIN(peak, 32767);
+	}
+	else {
+		TSK_DEBUG_ERROR("%u not valid as bits_per_sample", bits_per_sample);
+		return -2;
+	}
+
+	mean_square = count ? (sum_sq / count) : 0;
+	self->levels.rms = (int32_t)sqrt((double)mean_square);
+	self->levels.peak = peak;
+	self->levels.clipped = clipped;
+	self->levels.dbov = mean_square ? (int32_t)TSK_MAX(-127.0, 10.0 * log10((double)mean_square / (32767.0 * 32767.0))) : -127;
+	_tdav_audio_pcm_stage_score(self, mean_square);
+
+	return 0;
+}
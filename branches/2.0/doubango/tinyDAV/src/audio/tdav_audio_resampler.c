@@ -0,0 +1,759 @@
+/*
+* Copyright (C) 2010-2015 Mamadou DIOP.
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*/
+
+/**@file tdav_audio_resampler.c
+* @brief Polyphase audio resampler plugin.
+*
+* The ratio out/in is reduced to L/M and a windowed-sinc low-pass filter is designed at L times the input rate,
+* then split in L phases of "taps" coefficients each. Output sample j uses the phase (j*M) % L applied to the
+* "taps" input samples ending at (j*M) / L. The banks only depend on (in_freq, out_freq, quality), are immutable
+* once built and shared by all resamplers through a reference counted cache. Each resampler only keeps its
+* history (taps - 1 samples per channel) and its position.
+* The dot products use AVX2, SSE2 or NEON when available.
+*/
+#include "tinydav/audio/tdav_audio_resampler.h"
+
+#include "tsk_memory.h"
+#include "tsk_mutex.h"
+#include "tsk_cpu.h"
+#include "tsk_debug.h"
+
+#include <math.h>
+#include <string.h>
+
+#if TSK_CPU_X86
+#	include <emmintrin.h>
+#	if defined(__GNUC__) || (defined(_MSC_VER) && _MSC_VER >= 1700)
+#		include <immintrin.h>
+#		define TDAV_AUDIO_RESAMPLER_HAVE_AVX2 1
+#	endif
+#elif TSK_CPU_NEON
+#	include <arm_neon.h>
+#endif
+
+#ifndef TDAV_AUDIO_RESAMPLER_HAVE_AVX2
+#	define TDAV_AUDIO_RESAMPLER_HAVE_AVX2 0
+#endif
+
+#ifndef M_PI
+#	define M_PI 3.14159265358979323846
+#endif
+
+#define TDAV_AUDIO_RESAMPLER_MAX_QUALITY	10
+/* taps per phase are always a multiple of this value which means the SIMD loops have no tail */
+#define TDAV_AUDIO_RESAMPLER_TAPS_ALIGN		16
+#define TDAV_AUDIO_RESAMPLER_TAPS_MAX		512
+
+typedef struct tdav_audio_resampler_bank_s
+{
+	uint32_t in_freq;
+	uint32_t out_freq;
+	uint32_t quality;
+
+	uint32_t L; /* interpolation factor */
+	uint32_t M; /* decimation factor */
+	tsk_size_t taps; /* per phase */
+	int16_t* coeffs_int; /* L phases, Q15, in input order (oldest sample first) */
+	float* coeffs_float;
+
+	tsk_size_t refs; /* protected by the cache lock */
+	struct tdav_audio_resampler_bank_s* next;
+}
+tdav_audio_resampler_bank_t;
+
+typedef int32_t (*tdav_audio_resampler_dot_int_f)(const int16_t* x, const int16_t* h, tsk_size_t taps);
+typedef float (*tdav_audio_resampler_dot_float_f)(const float* x, const float* h, tsk_size_t taps);
+
+/** Polyphase resampler */
+typedef struct tdav_audio_resampler_s
+{
+	TMEDIA_DECLARE_RESAMPLER;
+
+	tdav_audio_resampler_bank_t* bank; /* null when in_freq == out_freq */
+	tsk_size_t in_size;
+	tsk_size_t out_size;
+	uint32_t in_channels;
+	uint32_t out_channels;
+	uint32_t channels; /* number of channels going through the filter */
+	uint32_t bytes_per_sample;
+
+	/* position of the next output: window start in the work buffer and phase */
+	tsk_size_t index;
+	uint32_t phase;
+
+	/* per channel: history (taps - 1 samples) followed by the input */
+	void* work[2];
+	tsk_size_t work_size_in_samples;
+
+	tdav_audio_resampler_dot_int_f dot_int;
+	tdav_audio_resampler_dot_float_f dot_float;
+}
+tdav_audio_resampler_t;
+
+static tdav_audio_resampler_bank_t* __tdav_audio_resampler_banks = tsk_null;
+static tsk_mutex_handle_t* __tdav_audio_resampler_banks_mutex = tsk_null;
+
+#define _tdav_audio_resampler_banks_lock() tsk_mutex_lock(__tdav_audio_resampler_banks_mutex)
+#define _tdav_audio_resampler_banks_unlock() tsk_mutex_unlock(__tdav_audio_resampler_banks_mutex)
+
+/** Called by tdav_init() */
+int tdav_audio_resampler_init()
+{
+	if (!__tdav_audio_resampler_banks_mutex && !(__tdav_audio_resampler_banks_mutex = tsk_mutex_create_2(tsk_false))) {
+		TSK_DEBUG_ERROR("Failed to create mutex");
+		return -1;
+	}
+	return 0;
+}
+
+/** Called by tdav_deinit(). The resamplers must be closed. */
+int tdav_audio_resampler_deinit()
+{
+	if (__tdav_audio_resampler_banks) {
+		TSK_DEBUG_WARN("Resampler banks still in use");
+		return -1;
+	}
+	tsk_mutex_destroy(&__tdav_audio_resampler_banks_mutex);
+	return 0;
+}
+
+static uint32_t _tdav_audio_resampler_gcd(uint32_t a, uint32_t b)
+{
+	uint32_t t;
+	while (b) {
+		t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/* zeroth order modified Bessel function of the first kind */
+static double _tdav_audio_resampler_bessel_i0(double x)
+{
+	double sum = 1.0, term = 1.0, y = (x * x) / 4.0;
+	int k;
+	for (k = 1; k < 64 && term > sum * 1e-12; ++k) {
+		term *= y / ((double)k * (double)k);
+		sum += term;
+	}
+	return sum;
+}
+
+static tdav_audio_resampler_bank_t* _tdav_audio_resampler_bank_build(uint32_t in_freq, uint32_t out_freq, uint32_t quality)
+{
+	tdav_audio_resampler_bank_t* bank;
+	uint32_t g = _tdav_audio_resampler_gcd(in_freq, out_freq), p;
+	tsk_size_t k, N;
+	double fc, beta, rolloff, center, t, w, h, i0_beta;
+
+	if (!(bank = (tdav_audio_resampler_bank_t*)tsk_calloc(1, sizeof(tdav_audio_resampler_bank_t)))) {
+		TSK_DEBUG_ERROR("Failed to allocate new bank");
+		return tsk_null;
+	}
+	bank->in_freq = in_freq;
+	bank->out_freq = out_freq;
+	bank->quality = quality;
+	bank->L = out_freq / g;
+	bank->M = in_freq / g;
+
+	/* longer filters, sharper transition band and more stop band attenuation with the quality */
+	bank->taps = TDAV_AUDIO_RESAMPLER_TAPS_ALIGN * (1 + (quality >> 2));
+	rolloff = quality < 4 ? 0.85 : (quality < 8 ? 0.91 : 0.94);
+	beta = quality < 4 ? 6.0 : (quality < 8 ? 8.0 : 9.5);
+	if (bank->M > bank->L) {
+		/* downsampling: the cut-off moves down to the output Nyquist, keep the same transition band */
+		bank->taps = (bank->taps * bank->M + bank->L - 1) / bank->L;
+		bank->taps = ((bank->taps + TDAV_AUDIO_RESAMPLER_TAPS_ALIGN - 1) / TDAV_AUDIO_RESAMPLER_TAPS_ALIGN) * TDAV_AUDIO_RESAMPLER_TAPS_ALIGN;
+		bank->taps = TSK_MIN(bank->taps, TDAV_AUDIO_RESAMPLER_TAPS_MAX);
+	}
+
+	N = bank->taps * bank->L;
+	if (!(bank->coeffs_int = (int16_t*)tsk_calloc(N, sizeof(int16_t))) || !(bank->coeffs_float = (float*)tsk_calloc(N, sizeof(float)))) {
+		TSK_DEBUG_ERROR("Failed to allocate filter bank with %u coefficients", (unsigned)N);
+		TSK_FREE(bank->coeffs_int);
+		TSK_FREE(bank);
+		return tsk_null;
+	}
+
+	/* prototype filter at L * in_freq, cut-off in cycles per (upsampled) sample */
+	fc = 0.5 * rolloff / (double)TSK_MAX(bank->L, bank->M);
+	center = (double)(N - 1) / 2.0;
+	i0_beta = _tdav_audio_resampler_bessel_i0(beta);
+	for (p = 0; p < bank->L; ++p) {
+		for (k = 0; k < bank->taps; ++k) {
+			/* coefficient applied to x[q - (taps - 1 - k)] for phase p */
+			tsk_size_t m = ((bank->taps - 1 - k) * bank->L) + p;
+			t = (double)m - center;
+			h = (t == 0.0) ? 2.0 * fc : sin(2.0 * M_PI * fc * t) / (M_PI * t);
+			w = (2.0 * (double)m / (double)(N - 1)) - 1.0;
+			w = _tdav_audio_resampler_bessel_i0(beta * sqrt(TSK_MAX(0.0, 1.0 - (w * w)))) / i0_beta;
+			h *= w * (double)bank->L; /* compensates the zero-stuffing */
+			bank->coeffs_float[(p * bank->taps) + k] = (float)h;
+			h = floor((h * 32768.0) + 0.5);
+			bank->coeffs_int[(p * bank->taps) + k] = (int16_t)(h > 32767.0 ? 32767 : (h < -32768.0 ? -32768 : h));
+		}
+	}
+	return bank;
+}
+
+static void _tdav_audio_resampler_bank_free(tdav_audio_resampler_bank_t** bank)
+{
+	if (bank && *bank) {
+		TSK_FREE((*bank)->coeffs_int);
+		TSK_FREE((*bank)->coeffs_float);
+		TSK_FREE(*bank);
+	}
+}
+
+static tdav_audio_resampler_bank_t* _tdav_audio_resampler_bank_acquire(uint32_t in_freq, uint32_t out_freq, uint32_t quality)
+{
+	tdav_audio_resampler_bank_t* bank;
+
+	if (!__tdav_audio_resampler_banks_mutex) {
+		TSK_DEBUG_ERROR("Not initialized: tdav_audio_resampler_init() must be called first");
+		return tsk_null;
+	}
+
+	_tdav_audio_resampler_banks_lock();
+	for (bank = __tdav_audio_resampler_banks; bank; bank = bank->next) {
+		if (bank->in_freq == in_freq && bank->out_freq == out_freq && bank->quality == quality) {
+			++bank->refs;
+			_tdav_audio_resampler_banks_unlock();
+			return bank;
+		}
+	}
+	_tdav_audio_resampler_banks_unlock();
+
+	/* built without holding the lock, another thread may race us for the same key */
+	if (!(bank = _tdav_audio_resampler_bank_build(in_freq, out_freq, quality))) {
+		return tsk_null;
+	}
+
+	_tdav_audio_resampler_banks_lock();
+	{
+		tdav_audio_resampler_bank_t* other;
+		for (other = __tdav_audio_resampler_banks; other; other = other->next) {
+			if (other->in_freq == in_freq && other->out_freq == out_freq && other->quality == quality) {
+				++other->refs;
+				_tdav_audio_resampler_banks_unlock();
+				_tdav_audio_resampler_bank_free(&bank);
+				return other;
+			}
+		}
+	}
+	bank->refs = 1;
+	bank->next = __tdav_audio_resampler_banks;
+	__tdav_audio_resampler_banks = bank;
+	_tdav_audio_resampler_banks_unlock();
+
+	TSK_DEBUG_INFO("New resampler bank: %u->%u, quality=%u, L=%u, M=%u, taps=%u", in_freq, out_freq, quality, bank->L, bank->M, (unsigned)bank->taps);
+	return bank;
+}
+
+static void _tdav_audio_resampler_bank_release(tdav_audio_resampler_bank_t** bank)
+{
+	tdav_audio_resampler_bank_t **it, *unlinked = tsk_null;
+	if (!bank || !*bank) {
+		return;
+	}
+	_tdav_audio_resampler_banks_lock();
+	if (--(*bank)->refs == 0) {
+		for (it = &__tdav_audio_resampler_banks; *it; it = &(*it)->next) {
+			if (*it == *bank) {
+				*it = (*bank)->next;
+				unlinked = *bank;
+				break;
+			}
+		}
+	}
+	_tdav_audio_resampler_banks_unlock();
+	_tdav_audio_resampler_bank_free(&unlinked);
+	*bank = tsk_null;
+}
+
+//
+//	Dot products
+//
+static int32_t _tdav_audio_resampler_dot_int(const int16_t* x, const int16_t* h, tsk_size_t taps)
+{
+	int32_t acc = 0;
+	tsk_size_t k;
+	for (k = 0; k < taps; ++k) {
+		acc += (int32_t)x[k] * (int32_t)h[k];
+	}
+	return acc;
+}
+
+static float _tdav_audio_resampler_dot_float(const float* x, const float* h, tsk_size_t taps)
+{
+	float acc = 0.f;
+	tsk_size_t k;
+	for (k = 0; k < taps; ++k) {
+		acc += x[k] * h[k];
+	}
+	return acc;
+}
+
+#if TSK_CPU_X86
+TSK_CPU_TARGET("sse2") static int32_t _tdav_audio_resampler_dot_int_sse2(const int16_t* x, const int16_t* h, tsk_size_t taps)
+{
+	__m128i acc = _mm_setzero_si128();
+	tsk_size_t k;
+	for (k = 0; k < taps; k += 8) {
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i*)&x[k]), _mm_loadu_si128((const __m128i*)&h[k])));
+	}
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(acc);
+}
+
+TSK_CPU_TARGET("sse2") static float _tdav_audio_resampler_dot_float_sse2(const float* x, const float* h, tsk_size_t taps)
+{
+	__m128 acc = _mm_setzero_ps();
+	float out[4];
+	tsk_size_t k;
+	for (k = 0; k < taps; k += 4) {
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(&x[k]), _mm_loadu_ps(&h[k])));
+	}
+	_mm_storeu_ps(out, acc);
+	return (out[0] + out[1]) + (out[2] + out[3]);
+}
+
+#if TDAV_AUDIO_RESAMPLER_HAVE_AVX2
+TSK_CPU_TARGET("avx2") static int32_t _tdav_audio_resampler_dot_int_avx2(const int16_t* x, const int16_t* h, tsk_size_t taps)
+{
+	__m256i acc = _mm256_setzero_si256();
+	__m128i sum;
+	tsk_size_t k;
+	for (k = 0; k < taps; k += 16) {
+		acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_loadu_si256((const __m256i*)&x[k]), _mm256_loadu_si256((const __m256i*)&h[k])));
+	}
+	sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(sum);
+}
+
+TSK_CPU_TARGET("avx2") static float _tdav_audio_resampler_dot_float_avx2(const float* x, const float* h, tsk_size_t taps)
+{
+	__m256 acc = _mm256_setzero_ps();
+	__m128 sum;
+	float out[4];
+	tsk_size_t k;
+	for (k = 0; k < taps; k += 8) {
+		acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(&x[k]), _mm256_loadu_ps(&h[k])));
+	}
+	sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+	_mm_storeu_ps(out, sum);
+	return (out[0] + out[1]) + (out[2] + out[3]);
+}
+#endif /* TDAV_AUDIO_RESAMPLER_HAVE_AVX2 */
+
+#elif TSK_CPU_NEON
+static int32_t _tdav_audio_resampler_dot_int_neon(const int16_t* x, const int16_t* h, tsk_size_t taps)
+{
+	int32x4_t acc = vdupq_n_s32(0);
+	int32x2_t sum;
+	int16x8_t a, b;
+	tsk_size_t k;
+	for (k = 0; k < taps; k += 8) {
+		a = vld1q_s16(&x[k]);
+		b = vld1q_s16(&h[k]);
+		acc = vmlal_s16(acc, vget_low_s16(a), vget_low_s16(b));
+		acc = vmlal_s16(acc, vget_high_s16(a), vget_high_s16(b));
+	}
+	sum = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+	return vget_lane_s32(vpadd_s32(sum, sum), 0);
+}
+
+static float _tdav_audio_resampler_dot_float_neon(const float* x, const float* h, tsk_size_t taps)
+{
+	float32x4_t acc = vdupq_n_f32(0.f);
+	float32x2_t sum;
+	tsk_size_t k;
+	for (k = 0; k < taps; k += 4) {
+		acc = vmlaq_f32(acc, vld1q_f32(&x[k]), vld1q_f32(&h[k]));
+	}
+	sum = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+	return vget_lane_f32(vpadd_f32(sum, sum), 0);
+}
+#endif /* TSK_CPU_NEON */
+
+//
+//	Processing
+//
+
+/* copies the input channels at the end of the work buffers (after the history) */
+static void _tdav_audio_resampler_load(tdav_audio_resampler_t* resampler, const void* in_data, tsk_size_t count, tsk_size_t offset)
+{
+	tsk_size_t i;
+	if (resampler->bytes_per_sample == sizeof(int16_t)) {
+		const int16_t* in = (const int16_t*)in_data;
+		int16_t *w0 = ((int16_t*)resampler->work[0]) + offset, *w1 = resampler->work[1] ? ((int16_t*)resampler->work[1]) + offset : tsk_null;
+		if (resampler->in_channels == 1) {
+			memcpy(w0, in, count * sizeof(int16_t));
+		}
+		else if (resampler->channels == 1) { /* stereo to mono: downmix before filtering */
+			for (i = 0; i < count; ++i, in += 2) {
+				w0[i] = (int16_t)(((int32_t)in[0] + (int32_t)in[1]) >> 1);
+			}
+		}
+		else {
+			for (i = 0; i < count; ++i, in += 2) {
+				w0[i] = in[0];
+				w1[i] = in[1];
+			}
+		}
+	}
+	else {
+		const float* in = (const float*)in_data;
+		float *w0 = ((float*)resampler->work[0]) + offset, *w1 = resampler->work[1] ? ((float*)resampler->work[1]) + offset : tsk_null;
+		if (resampler->in_channels == 1) {
+			memcpy(w0, in, count * sizeof(float));
+		}
+		else if (resampler->channels == 1) {
+			for (i = 0; i < count; ++i, in += 2) {
+				w0[i] = (in[0] + in[1]) * 0.5f;
+			}
+		}
+		else {
+			for (i = 0; i < count; ++i, in += 2) {
+				w0[i] = in[0];
+				w1[i] = in[1];
+			}
+		}
+	}
+}
+
+/* same rate: only the channels are converted */
+static tsk_size_t _tdav_audio_resampler_copy(tdav_audio_resampler_t* resampler, const void* in_data, tsk_size_t count, void* out_data, tsk_size_t out_max)
+{
+	tsk_size_t i, c;
+	count = TSK_MIN(count, out_max);
+	if (resampler->in_channels == resampler->out_channels) {
+		memcpy(out_data, in_data, count * resampler->out_channels * resampler->bytes_per_sample);
+		return count * resampler->out_channels;
+	}
+	if (resampler->out_channels == 2) {
+		for (i = 0; i < count; ++i) {
+			for (c = 0; c < 2; ++c) {
+				memcpy(((uint8_t*)out_data) + (((i << 1) + c) * resampler->bytes_per_sample), ((const uint8_t*)in_data) + (i * resampler->bytes_per_sample), resampler->bytes_per_sample);
+			}
+		}
+		return count << 1;
+	}
+	if (resampler->bytes_per_sample == sizeof(int16_t)) {
+		for (i = 0; i < count; ++i) {
+			((int16_t*)out_data)[i] = (int16_t)(((int32_t)((const int16_t*)in_data)[i << 1] + (int32_t)((const int16_t*)in_data)[(i << 1) + 1]) >> 1);
+		}
+	}
+	else {
+		for (i = 0; i < count; ++i) {
+			((float*)out_data)[i] = (((const float*)in_data)[i << 1] + ((const float*)in_data)[(i << 1) + 1]) * 0.5f;
+		}
+	}
+	return count;
+}
+
+static tsk_size_t _tdav_audio_resampler_run(tdav_audio_resampler_t* resampler, const void* in_data, tsk_size_t in_size_in_sample, void* out_data, tsk_size_t out_size_in_sample)
+{
+	const tdav_audio_resampler_bank_t* bank = resampler->bank;
+	tsk_size_t n = in_size_in_sample / resampler->in_channels; /* input samples per channel */
+	tsk_size_t out_max = out_size_in_sample / resampler->out_channels;
+	tsk_size_t hist, count = 0, q = 0, step_q;
+	uint32_t p = 0, step_p, c;
+
+	if (!bank) {
+		return _tdav_audio_resampler_copy(resampler, in_data, n, out_data, out_max);
+	}
+	hist = bank->taps - 1;
+	step_q = bank->M / bank->L;
+	step_p = bank->M % bank->L;
+
+	if (hist + n > resampler->work_size_in_samples) {
+		tsk_size_t size = hist + n;
+		void* work;
+		for (c = 0; c < resampler->channels; ++c) {
+			if (!(work = tsk_realloc(resampler->work[c], size * resampler->bytes_per_sample))) {
+				TSK_DEBUG_ERROR("Failed to allocate work buffer");
+				return 0;
+			}
+			resampler->work[c] = work;
+			if (resampler->work_size_in_samples == 0) {
+				memset(resampler->work[c], 0, hist * resampler->bytes_per_sample);
+			}
+		}
+		resampler->work_size_in_samples = size;
+	}
+	_tdav_audio_resampler_load(resampler, in_data, n, hist);
+
+	for (c = 0; c < resampler->channels; ++c) {
+		q = resampler->index;
+		p = resampler->phase;
+		count = 0;
+		if (resampler->bytes_per_sample == sizeof(int16_t)) {
+			const int16_t* x = (const int16_t*)resampler->work[c];
+			int16_t* out = ((int16_t*)out_data) + c;
+			int32_t y;
+			while (q < n && count < out_max) {
+				y = (resampler->dot_int(&x[q], &bank->coeffs_int[p * bank->taps], bank->taps) + (1 << 14)) >> 15;
+				y = (y > 32767 ? 32767 : (y < -32768 ? -32768 : y));
+				*out = (int16_t)y;
+				if (resampler->out_channels > resampler->channels) {
+					out[1] = (int16_t)y;
+				}
+				out += resampler->out_channels;
+				++count;
+				q += step_q;
+				if ((p += step_p) >= bank->L) {
+					p -= bank->L;
+					++q;
+				}
+			}
+		}
+		else {
+			const float* x = (const float*)resampler->work[c];
+			float* out = ((float*)out_data) + c;
+			float y;
+			while (q < n && count < out_max) {
+				y = resampler->dot_float(&x[q], &bank->coeffs_float[p * bank->taps], bank->taps);
+				*out = y;
+				if (resampler->out_channels > resampler->channels) {
+					out[1] = y;
+				}
+				out += resampler->out_channels;
+				++count;
+				q += step_q;
+				if ((p += step_p) >= bank->L) {
+					p -= bank->L;
+					++q;
+				}
+			}
+		}
+		/* keep the last "taps - 1" samples for the next call */
+		memmove(resampler->work[c], ((uint8_t*)resampler->work[c]) + (n * resampler->bytes_per_sample), hist * resampler->bytes_per_sample);
+	}
+
+	if (q < n) {
+		TSK_DEBUG_WARN("Output buffer too short, %u input samples dropped", (unsigned)(n - q));
+		q = n;
+	}
+	resampler->index = q - n;
+	resampler->phase = p;
+
+	return count * resampler->out_channels;
+}
+
+static int tdav_audio_resampler_open(tmedia_resampler_t* self, uint32_t in_freq, uint32_t out_freq, uint32_t frame_duration, uint32_t in_channels, uint32_t out_channels, uint32_t quality, uint32_t bits_per_sample)
+{
+	tdav_audio_resampler_t *resampler = (tdav_audio_resampler_t *)self;
+	uint32_t bytes_per_sample = (bits_per_sample >> 3);
+
+	if (!in_freq || !out_freq) {
+		TSK_DEBUG_ERROR("%u->%u not valid as frequencies", in_freq, out_freq);
+		return -1;
+	}
+	if (in_channels != 1 && in_channels != 2) {
+		TSK_DEBUG_ERROR("%d not valid as input channel", in_channels);
+		return -1;
+	}
+	if (out_channels != 1 && out_channels != 2) {
+		TSK_DEBUG_ERROR("%d not valid as output channel", out_channels);
+		return -1;
+	}
+	if (bytes_per_sample != sizeof(int16_t) && bytes_per_sample != sizeof(float)) {
+		TSK_DEBUG_ERROR("%d not valid as bits_per_sample", bits_per_sample);
+		return -1;
+	}
+
+	_tdav_audio_resampler_bank_release(&resampler->bank);
+	if (in_freq != out_freq && !(resampler->bank = _tdav_audio_resampler_bank_acquire(in_freq, out_freq, TSK_CLAMP(0, quality, TDAV_AUDIO_RESAMPLER_MAX_QUALITY)))) {
+		return -2;
+	}
+
+	resampler->bytes_per_sample = bytes_per_sample;
+	resampler->in_size = ((in_freq * frame_duration) / 1000) << (in_channels == 2 ? 1 : 0);
+	resampler->out_size = ((out_freq * frame_duration) / 1000) << (out_channels == 2 ? 1 : 0);
+	resampler->in_channels = in_channels;
+	resampler->out_channels = out_channels;
+	resampler->channels = TSK_MIN(in_channels, out_channels);
+	resampler->index = 0;
+	resampler->phase = 0;
+	TSK_FREE(resampler->work[0]);
+	TSK_FREE(resampler->work[1]);
+	resampler->work_size_in_samples = 0;
+
+	return 0;
+}
+
+static tsk_size_t tdav_audio_resampler_process(tmedia_resampler_t* self, const void* in_data, tsk_size_t in_size_in_sample, void* out_data, tsk_size_t out_size_in_sample)
+{
+	tdav_audio_resampler_t *resampler = (tdav_audio_resampler_t *)self;
+	if (!resampler->bytes_per_sample || !in_data || !out_data) {
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return 0;
+	}
+
+	if (in_size_in_sample != resampler->in_size) {
+		TSK_DEBUG_ERROR("Input data has wrong size");
+		return 0;
+	}
+
+	if (out_size_in_sample < resampler->out_size) {
+		TSK_DEBUG_ERROR("Output data is too short");
+		return 0;
+	}
+
+	return _tdav_audio_resampler_run(resampler, in_data, in_size_in_sample, out_data, out_size_in_sample);
+}
+
+static int tdav_audio_resampler_close(tmedia_resampler_t* self)
+{
+	tdav_audio_resampler_t *resampler = (tdav_audio_resampler_t *)self;
+
+	_tdav_audio_resampler_bank_release(&resampler->bank);
+	resampler->bytes_per_sample = 0;
+	return 0;
+}
+
+/**@ingroup tdav_audio_resampler_group
+* Processes several conversions in a single call, e.g. all the channels or sessions of a conference. The items
+* sharing the same filter bank are processed one after the other so that the coefficients stay in the cache.
+* @param items the conversions to process. "out_result" is updated.
+* @param count the number of items.
+* @retval zero if all conversions succeeded and non-zero otherwise.
+*/
+int tdav_audio_resampler_process_batch(tdav_audio_resampler_batch_item_t* items, tsk_size_t count)
+{
+	tsk_size_t i, j;
+	const tdav_audio_resampler_bank_t* bank;
+	int ret = 0;
+
+	if (!items && count) {
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+
+	for (i = 0; i < count; ++i) {
+		items[i].out_result = 0;
+		if (!items[i].resampler || items[i].resampler->plugin != tdav_audio_resampler_plugin_def_t || !items[i].resampler->opened) {
+			TSK_DEBUG_ERROR("Item #%u doesn't hold an opened polyphase resampler", (unsigned)i);
+			ret = -1;
+			items[i].resampler = tsk_null; /* skipped below */
+		}
+	}
+
+	for (i = 0; i < count; ++i) {
+		if (!items[i].resampler) {
+			continue;
+		}
+		bank = ((const tdav_audio_resampler_t*)items[i].resampler)->bank;
+		/* already processed with a previous item sharing the same bank? */
+		for (j = 0; j < i; ++j) {
+			if (items[j].resampler && ((const tdav_audio_resampler_t*)items[j].resampler)->bank == bank) {
+				break;
+			}
+		}
+		if (j < i) {
+			continue;
+		}
+		for (j = i; j < count; ++j) {
+			if (items[j].resampler && ((const tdav_audio_resampler_t*)items[j].resampler)->bank == bank) {
+				if (!(items[j].out_result = tdav_audio_resampler_process(items[j].resampler, items[j].in_data, items[j].in_size_in_sample, items[j].out_data, items[j].out_size_in_sample))) {
+					ret = -2;
+				}
+			}
+		}
+	}
+	return ret;
+}
+
+
+//
+//	Polyphase resampler Plugin definition
+//
+
+/* constructor */
+static tsk_object_t* tdav_audio_resampler_ctor(tsk_object_t * self, va_list * app)
+{
+	tdav_audio_resampler_t *resampler = (tdav_audio_resampler_t *)self;
+	if (resampler) {
+		/* init base */
+		tmedia_resampler_init(TMEDIA_RESAMPLER(resampler));
+		/* init self */
+		resampler->dot_int = _tdav_audio_resampler_dot_int;
+		resampler->dot_float = _tdav_audio_resampler_dot_float;
+#if TSK_CPU_X86
+		if (tsk_cpu_has(tsk_cpu_flag_sse2)) {
+			resampler->dot_int = _tdav_audio_resampler_dot_int_sse2;
+			resampler->dot_float = _tdav_audio_resampler_dot_float_sse2;
+		}
+#	if TDAV_AUDIO_RESAMPLER_HAVE_AVX2
+		if (tsk_cpu_has(tsk_cpu_flag_avx2)) {
+			resampler->dot_int = _tdav_audio_resampler_dot_int_avx2;
+			resampler->dot_float = _tdav_audio_resampler_dot_float_avx2;
+		}
+#	endif
+#elif TSK_CPU_NEON
+		if (tsk_cpu_has(tsk_cpu_flag_neon)) {
+			resampler->dot_int = _tdav_audio_resampler_dot_int_neon;
+			resampler->dot_float = _tdav_audio_resampler_dot_float_neon;
+		}
+#endif
+	}
+	return self;
+}
+/* destructor */
+static tsk_object_t* tdav_audio_resampler_dtor(tsk_object_t * self)
+{
+	tdav_audio_resampler_t *resampler = (tdav_audio_resampler_t *)self;
+	if (resampler) {
+		/* deinit base */
+		tmedia_resampler_deinit(TMEDIA_RESAMPLER(resampler));
+		/* deinit self */
+		_tdav_audio_resampler_bank_release(&resampler->bank);
+		TSK_FREE(resampler->work[0]);
+		TSK_FREE(resampler->work[1]);
+
+		TSK_DEBUG_INFO("*** Polyphase resampler (plugin) destroyed ***");
+	}
+
+	return self;
+}
+/* object definition */
+static const tsk_object_def_t tdav_audio_resampler_def_s =
+{
+	sizeof(tdav_audio_resampler_t),
+	tdav_audio_resampler_ctor,
+	tdav_audio_resampler_dtor,
+	tsk_null,
+};
+/* plugin definition*/
+static const tmedia_resampler_plugin_def_t tdav_audio_resampler_plugin_def_s =
+{
+	&tdav_audio_resampler_def_s,
+
+	"Polyphase audio resampler with shared filter banks",
+
+	tdav_audio_resampler_open,
+	tdav_audio_resampler_process,
+	tdav_audio_resampler_close,
+};
+const tmedia_resampler_plugin_def_t *tdav_audio_resampler_plugin_def_t = &tdav_audio_resampler_plugin_def_s;
@@ -0,0 +1,360 @@
+/*
+* Copyright (C) 2010-2015 Mamadou DIOP.
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*/
+
+/**@file tdav_audio_scheduler.c
+* @brief Drives many audio producers/consumers from a small pool of threads sharing the same clock.
+*
+* Instead of having one (or two) threads per audio session ticking every ptime, the entries are spread across
+* a fixed number of workers. All workers wake up on the same absolute clock (no drift) and run their entries in
+* a batch. An entry with a 20ms ptime on a 10ms clock runs every other tick and the entries are phased so that
+* the load is the same on each tick.
+*/
+#include "tinydav/audio/tdav_audio_scheduler.h"
+
+#include "tsk_thread.h"
+#include "tsk_mutex.h"
+#include "tsk_condwait.h"
+#include "tsk_memory.h"
+#include "tsk_time.h"
+#include "tsk_cpu.h"
+#include "tsk_debug.h"
+
+typedef struct tdav_audio_scheduler_entry_s
+{
+	tdav_audio_scheduler_cb_f callback; /* null when removed while the batch is running */
+	const void* callback_data;
+	uint32_t every; /* in ticks */
+	uint32_t phase;
+}
+tdav_audio_scheduler_entry_t;
+
+typedef struct tdav_audio_scheduler_worker_s
+{
+	tsk_thread_handle_t* tid[1];
+	tsk_mutex_handle_t* mutex; /* recursive: callbacks are allowed to add/remove entries */
+
+	tdav_audio_scheduler_entry_t* entries;
+	tsk_size_t count;
+	tsk_size_t capacity;
+	tsk_bool_t in_batch;
+	tsk_bool_t dirty;
+
+	uint64_t ticks_count;
+	uint64_t overruns_count;
+}
+tdav_audio_scheduler_worker_t;
+
+static struct
+{
+	tsk_bool_t initialized;
+	tsk_bool_t started;
+	volatile tsk_bool_t running;
+	tsk_mutex_handle_t* mutex;
+	tsk_condwait_handle_t* condwait;
+
+	uint32_t period;
+	uint64_t epoch;
+	uint32_t phase;
+
+	tsk_size_t workers_count;
+	tdav_audio_scheduler_worker_t workers[TDAV_AUDIO_SCHEDULER_WORKERS_MAX];
+}
+__scheduler = { tsk_false };
+
+static void _tdav_audio_scheduler_worker_run(tdav_audio_scheduler_worker_t* worker, uint64_t tick)
+{
+	tsk_size_t i;
+	tdav_audio_scheduler_cb_f callback;
+	const void* callback_data;
+
+	tsk_mutex_lock(worker->mutex);
+	worker->in_batch = tsk_true;
+	/* index-based: a callback could add entries and reallocate the array */
+	for(i = 0; i < worker->count; ++i){
+		if((callback = worker->entries[i].callback) && (tick % worker->entries[i].every) == worker->entries[i].phase){
+			callback_data = worker->entries[i].callback_data;
+			callback(callback_data);
+		}
+	}
+	worker->in_batch = tsk_false;
+	if(worker->dirty){
+		tsk_size_t j = 0;
+		for(i = 0; i < worker->count; ++i){
+			if(worker->entries[i].callback){
+				worker->entries[j++] = worker->entries[i];
+			}
+		}
+		worker->count = j;
+		worker->dirty = tsk_false;
+	}
+	++worker->ticks_count;
+	tsk_mutex_unlock(worker->mutex);
+}
+
+static void* TSK_STDCALL _tdav_audio_scheduler_worker_thread(void *param)
+{
+	tdav_audio_scheduler_worker_t* worker = (tdav_audio_scheduler_worker_t*)param;
+	uint64_t tick = 0, deadline = __scheduler.epoch, now, late;
+
+	TSK_DEBUG_INFO("Audio scheduler worker -- START");
+
+	tsk_thread_set_priority_2(TSK_THREAD_PRIORITY_TIME_CRITICAL);
+
+	while(__scheduler.running){
+		now = tsk_time_now();
+		if(now < deadline){
+			tsk_condwait_timedwait(__scheduler.condwait, (deadline - now));
+			continue;
+		}
+		if((late = (now - deadline) / __scheduler.period) > 0){
+			/* do not burst to catch up: skip the missed ticks */
+			worker->overruns_count += late;
+			tick += late;
+			deadline += (late * __scheduler.period);
+		}
+		_tdav_audio_scheduler_worker_run(worker, tick);
+		++tick;
+		deadline += __scheduler.period;
+	}
+
+	TSK_DEBUG_INFO("Audio scheduler worker -- STOP");
+	return tsk_null;
+}
+
+static int _tdav_audio_scheduler_start()
+{
+	tsk_size_t i;
+
+	__scheduler.running = tsk_true;
+	__scheduler.epoch = tsk_time_now() + __scheduler.period;
+	for(i = 0; i < __scheduler.workers_count; ++i){
+		if(!(__scheduler.workers[i].mutex = tsk_mutex_create())){
+			TSK_DEBUG_ERROR("Failed to create mutex");
+			break;
+		}
+		if(tsk_thread_create(&__scheduler.workers[i].tid[0], _tdav_audio_scheduler_worker_thread, &__scheduler.workers[i])){
+			TSK_DEBUG_ERROR("Failed to create worker thread");
+			tsk_mutex_destroy(&__scheduler.workers[i].mutex);
+			break;
+		}
+	}
+	if(i == 0){
+		__scheduler.running = tsk_false;
+		return -1;
+	}
+	/* keep running with the workers we managed to start */
+	__scheduler.workers_count = i;
+	__scheduler.started = tsk_true;
+	TSK_DEBUG_INFO("Audio scheduler started: workers=%u, period=%ums", (unsigned)__scheduler.workers_count, __scheduler.period);
+	return 0;
+}
+
+/** Called by tdav_init() */
+int tdav_audio_scheduler_init()
+{
+	if(__scheduler.initialized){
+		return 0;
+	}
+	if(!(__scheduler.mutex = tsk_mutex_create()) || !(__scheduler.condwait = tsk_condwait_create())){
+		TSK_DEBUG_ERROR("Failed to create mutex or condwait");
+		return -1;
+	}
+	__scheduler.period = TDAV_AUDIO_SCHEDULER_PERIOD_DEFAULT;
+	__scheduler.workers_count = TSK_MIN(tsk_cpu_get_cores_count(), TDAV_AUDIO_SCHEDULER_WORKERS_MAX);
+	__scheduler.initialized = tsk_true;
+	return 0;
+}
+
+/** Sets the number of worker threads (default: number of cores). Must be called before the first entry is added. */
+int tdav_audio_scheduler_set_workers_count(tsk_size_t count)
+{
+	int ret = 0;
+	if(!__scheduler.initialized || !count || count > TDAV_AUDIO_SCHEDULER_WORKERS_MAX){
+		TSK_DEBUG_ERROR("Invalid parameter or not initialized");
+		return -1;
+	}
+	tsk_mutex_lock(__scheduler.mutex);
+	if(__scheduler.started){
+		TSK_DEBUG_ERROR("Audio scheduler already started");
+		ret = -2;
+	}
+	else{
+		__scheduler.workers_count = count;
+	}
+	tsk_mutex_unlock(__scheduler.mutex);
+	return ret;
+}
+
+/** Sets the clock period in milliseconds (default: 10ms). Must be called before the first entry is added. */
+int tdav_audio_scheduler_set_period(uint32_t period)
+{
+	int ret = 0;
+	if(!__scheduler.initialized || !period){
+		TSK_DEBUG_ERROR("Invalid parameter or not initialized");
+		return -1;
+	}
+	tsk_mutex_lock(__scheduler.mutex);
+	if(__scheduler.started){
+		TSK_DEBUG_ERROR("Audio scheduler already started");
+		ret = -2;
+	}
+	else{
+		__scheduler.period = period;
+	}
+	tsk_mutex_unlock(__scheduler.mutex);
+	return ret;
+}
+
+/** Registers a callback to run every @a ptime milliseconds. The workers are started on the first call. */
+int tdav_audio_scheduler_add(const void* callback_data, tdav_audio_scheduler_cb_f callback, uint32_t ptime)
+{
+	tdav_audio_scheduler_worker_t* worker = tsk_null;
+	tdav_audio_scheduler_entry_t* entry;
+	tsk_size_t i;
+	int ret = 0;
+
+	if(!callback || !ptime){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	if(!__scheduler.initialized){
+		TSK_DEBUG_ERROR("Audio scheduler not initialized");
+		return -2;
+	}
+
+	tsk_mutex_lock(__scheduler.mutex);
+
+	if(!__scheduler.started && (ret = _tdav_audio_scheduler_start())){
+		goto bail;
+	}
+	if(ptime % __scheduler.period){
+		TSK_DEBUG_WARN("ptime=%u is not a multiple of the scheduler period (%u)", ptime, __scheduler.period);
+	}
+
+	/* least loaded worker */
+	for(i = 0; i < __scheduler.workers_count; ++i){
+		if(!worker || __scheduler.workers[i].count < worker->count){
+			worker = &__scheduler.workers[i];
+		}
+	}
+
+	tsk_mutex_lock(worker->mutex);
+	if(worker->count == worker->capacity){
+		tsk_size_t capacity = worker->capacity ? (worker->capacity << 1) : 16;
+		tdav_audio_scheduler_entry_t* entries = tsk_realloc(worker->entries, capacity * sizeof(tdav_audio_scheduler_entry_t));
+		if(!entries){
+			TSK_DEBUG_ERROR("Failed to allocate %u entries", (unsigned)capacity);
+			ret = -3;
+		}
+		else{
+			worker->entries = entries;
+			worker->capacity = capacity;
+		}
+	}
+	if(ret == 0){
+		entry = &worker->entries[worker->count++];
+		entry->callback = callback;
+		entry->callback_data = callback_data;
+		entry->every = TSK_MAX((ptime + (__scheduler.period >> 1)) / __scheduler.period, 1);
+		entry->phase = (__scheduler.phase++ % entry->every);
+	}
+	tsk_mutex_unlock(worker->mutex);
+
+bail:
+	tsk_mutex_unlock(__scheduler.mutex);
+	return ret;
+}
+
+/** Unregisters all callbacks associated to @a callback_data. When this function returns the callbacks are not running and will never be called again. */
+int tdav_audio_scheduler_remove(const void* callback_data)
+{
+	tsk_size_t i, j;
+
+	if(!__scheduler.initialized || !__scheduler.started){
+		return 0;
+	}
+
+	for(i = 0; i < __scheduler.workers_count; ++i){
+		tdav_audio_scheduler_worker_t* worker = &__scheduler.workers[i];
+		/* blocks until the current batch completes unless called from a callback (recursive mutex) */
+		tsk_mutex_lock(worker->mutex);
+		for(j = 0; j < worker->count; ){
+			if(worker->entries[j].callback_data == callback_data){
+				if(worker->in_batch){
+					worker->entries[j].callback = tsk_null;
+					worker->dirty = tsk_true;
+				}
+				else{
+					memmove(&worker->entries[j], &worker->entries[j + 1], (worker->count - j - 1) * sizeof(tdav_audio_scheduler_entry_t));
+					--worker->count;
+					continue;
+				}
+			}
+			++j;
+		}
+		tsk_mutex_unlock(worker->mutex);
+	}
+	return 0;
+}
+
+/** Gets the number of entries, the number of ticks run and the number of ticks skipped because the workers were late. */
+int tdav_audio_scheduler_get_stats(tsk_size_t* entries_count, uint64_t* ticks_count, uint64_t* overruns_count)
+{
+	tsk_size_t i, entries = 0;
+	uint64_t ticks = 0, overruns = 0;
+
+	if(__scheduler.initialized && __scheduler.started){
+		for(i = 0; i < __scheduler.workers_count; ++i){
+			tsk_mutex_lock(__scheduler.workers[i].mutex);
+			entries += __scheduler.workers[i].count;
+			ticks += __scheduler.workers[i].ticks_count;
+			overruns += __scheduler.workers[i].overruns_count;
+			tsk_mutex_unlock(__scheduler.workers[i].mutex);
+		}
+	}
+	if(entries_count) *entries_count = entries;
+	if(ticks_count) *ticks_count = ticks;
+	if(overruns_count) *overruns_count = overruns;
+	return 0;
+}
+
+/** Called by tdav_deinit() */
+int tdav_audio_scheduler_deinit()
+{
+	tsk_size_t i;
+
+	if(!__scheduler.initialized){
+		return 0;
+	}
+	if(__scheduler.started){
+		__scheduler.running = tsk_false;
+		tsk_condwait_broadcast(__scheduler.condwait);
+		for(i = 0; i < __scheduler.workers_count; ++i){
+			if(__scheduler.workers[i].tid[0]){
+				tsk_thread_join(&__scheduler.workers[i].tid[0]);
+			}
+			tsk_mutex_destroy(&__scheduler.workers[i].mutex);
+			TSK_FREE(__scheduler.workers[i].entries);
+		}
+	}
+	tsk_condwait_destroy(&__scheduler.condwait);
+	tsk_mutex_destroy(&__scheduler.mutex);
+	memset(&__scheduler, 0, sizeof(__scheduler));
+	return 0;
+}
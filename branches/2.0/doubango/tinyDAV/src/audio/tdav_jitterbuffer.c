@@ -42,6 +42,7 @@
 
 //public functions
 jitterbuffer *jb_new();
+jitterbuffer *jb_new_with_pool(long frames_count, long frame_size);
 void jb_reset(jitterbuffer *jb);
 void jb_reset_all(jitterbuffer *jb);
 void jb_destroy(jitterbuffer *jb);
@@ -53,6 +54,7 @@ float jb_guess_mos(float p, long d, int codec);
 int jb_has_frames(jitterbuffer *jb);
 
 void jb_put(jitterbuffer *jb, void *data, int type, long ms, long ts, long now, int codec); 
+void jb_put_with_size(jitterbuffer *jb, void *data, long size, int type, long ms, long ts, long now, int codec);
 int jb_get(jitterbuffer *jb, void **data, long now, long interpl);
 
 
@@ -60,10 +62,12 @@ int jb_get(jitterbuffer *jb, void **data, long now, long interpl);
 //private functions
 static void set_default_settings(jitterbuffer *jb); 
 static void reset(jitterbuffer *jb); 
-static long find_pointer(long *array, long max_index, long value); static void frame_free(jb_frame *frame);
+static long find_pointer(long *array, long max_index, long value); 
+static jb_frame *frame_alloc(jitterbuffer *jb, void *data, long size);
+static void frame_free(jitterbuffer *jb, jb_frame *frame);
 
-static void put_control(jitterbuffer *jb, void *data, int type, long ts); 
-static void put_voice(jitterbuffer *jb, void *data, int type, long ms, long ts, int codec); 
+static void put_control(jitterbuffer *jb, void *data, long size, int type, long ts); 
+static void put_voice(jitterbuffer *jb, void *data, long size, int type, long ms, long ts, int codec); 
 static void put_history(jitterbuffer *jb, long ts, long now, long ms, int codec); 
 static void calculate_info(jitterbuffer *jb, long ts, long now, int codec);
 
@@ -106,6 +110,42 @@ jitterbuffer *jb_new()
 }
 
 
+/***********
+ * create a new jitterbuffer using preallocated frames
+ * return NULL if malloc doesn't work
+ * else return jb with default_settings and all the frames free.
+ */
+jitterbuffer *jb_new_with_pool(long frames_count, long frame_size) 
+{
+  jitterbuffer *jb;
+  long i;
+  
+  if (frames_count <= 0 || frame_size <= 0) {
+    jb_err("invalid pool size in jb_new_with_pool()\n");
+    return NULL;
+  }
+  if (!(jb = jb_new())) {
+    return NULL;
+  }
+  jb->pool.frames = tsk_calloc(frames_count, sizeof(jb_frame));
+  jb->pool.slab = tsk_calloc(frames_count, frame_size);
+  jb->pool.free_index = tsk_calloc(frames_count, sizeof(long));
+  if (!jb->pool.frames || !jb->pool.slab || !jb->pool.free_index) {
+    jb_err("cannot allocate jitterbuffer pool\n");
+    jb_destroy(jb);
+    return NULL;
+  }
+  jb->pool.count = frames_count;
+  jb->pool.data_size = frame_size;
+  for (i = 0; i < frames_count; ++i) {
+    jb->pool.free_index[i] = i;
+  }
+  jb->pool.free_head = 0;
+  jb->pool.free_size = frames_count;
+  return jb;
+}
+
+
 /***********
  * empty voice messages 
  * reset statistics 
@@ -124,7 +164,7 @@ void jb_reset(jitterbuffer *jb)
   //free voice
   while(jb->voiceframes) {
     frame = get_all_frames(jb);
-    frame_free(frame);
+    frame_free(jb, frame);
   }
   //reset stats
   memset(&(jb->info),0,sizeof(jb_info) );
@@ -153,7 +193,7 @@ void jb_reset_all(jitterbuffer *jb)
   while(jb->controlframes) {
     frame = jb->controlframes;
     jb->controlframes = frame->next;
-    frame_free(frame);
+    frame_free(jb, frame);
   }
   // free voice and reset statistics is done by jb_reset
   jb_reset(jb);
@@ -175,6 +215,9 @@ void jb_destroy(jitterbuffer *jb)
   }
   
   jb_reset_all(jb);
+  TSK_FREE(jb->pool.frames);
+  TSK_FREE(jb->pool.slab);
+  TSK_FREE(jb->pool.free_index);
   free(jb);
 }
 
@@ -338,11 +381,24 @@ int jb_has_frames(jitterbuffer *jb)
  * keep track of statistics
  */
 void jb_put(jitterbuffer *jb, void *data, int type, long ms, long ts, long now, int codec) 
+{ 
+  if (jb == NULL) {
+    jb_err("no jitterbuffer in jb_put()\n");
+    return;
+  }
+  jb_put_with_size(jb, data, jb->pool.data_size, type, ms, ts, now, codec);
+}
+
+
+/***********
+ * same as jb_put(), with a pool only size bytes are copied from data
+ */
+void jb_put_with_size(jitterbuffer *jb, void *data, long size, int type, long ms, long ts, long now, int codec) 
 { 
   long pointer, max_index;
   
   if (jb == NULL) {
-    jb_err("no jitterbuffer in jb_put()\n");
+    jb_err("no jitterbuffer in jb_put_with_size()\n");
     return;
   }
   
@@ -351,7 +407,7 @@ void jb_put(jitterbuffer *jb, void *data, int type, long ms, long ts, long now,
   if (type == JB_TYPE_CONTROL) {
     //put the packet into the contol-queue of the jitterbuffer
     jb_dbg("pC");
-    put_control(jb,data,type,ts);
+    put_control(jb,data,size,type,ts);
 
   } else if (type == JB_TYPE_VOICE) {
     // only add voice that aren't already in the buffer
@@ -359,7 +415,9 @@ void jb_put(jitterbuffer *jb, void *data, int type, long ms, long ts, long now,
     pointer = find_pointer(&jb->hist_sorted_timestamp[0], max_index, ts);
     if (jb->hist_sorted_timestamp[pointer]==ts) { //timestamp already in queue
       jb_dbg("pT");
-      free(data); 
+      if (!jb->pool.count) {
+        free(data); 
+      }
       jb->info.frames_dropped_twice++;
     } else { //add
       jb_dbg("pV");
@@ -368,16 +426,18 @@ void jb_put(jitterbuffer *jb, void *data, int type, long ms, long ts, long now,
       /*calculate jitterbuffer size*/
       calculate_info(jb, ts, now, codec);
       /*put the packet into the queue of the jitterbuffer*/
-      put_voice(jb,data,type,ms,ts,codec);
+      put_voice(jb,data,size,type,ms,ts,codec);
     } 
 
   } else if (type == JB_TYPE_SILENCE){ //silence
     jb_dbg("pS");
-    put_voice(jb,data,type,ms,ts,codec);
+    put_voice(jb,data,size,type,ms,ts,codec);
 
   } else {//should NEVER happen
     jb_err("jb_put(): type not known\n");
-    free(data);
+    if (!jb->pool.count) {
+      free(data);
+    }
   }
 }
 
@@ -466,11 +526,49 @@ static long find_pointer(long *array, long max_index, long value)
 }
 
 
+/***********
+ * allocate a frame holding data
+ * with a pool, the frame is the oldest free one and the size bytes of data are copied in its slot
+ * return NULL if there is no frame available or if data doesn't fit in a slot
+ */
+static jb_frame *frame_alloc(jitterbuffer *jb, void *data, long size) 
+{
+  jb_frame *frame;
+  long index;
+  
+  if (!jb->pool.count) {
+    if ((frame = malloc(sizeof(jb_frame)))) {
+      frame->data = data;
+    }
+    return frame;
+  }
+  if (!jb->pool.free_size || size < 0 || size > jb->pool.data_size) {
+    return NULL;
+  }
+  index = jb->pool.free_index[jb->pool.free_head];
+  jb->pool.free_head = (jb->pool.free_head + 1) % jb->pool.count;
+  jb->pool.free_size--;
+  frame = &jb->pool.frames[index];
+  frame->data = &jb->pool.slab[index * jb->pool.data_size];
+  if (data && size) {
+    memcpy(frame->data, data, size);
+  }
+  return frame;
+}
+
+
 /***********
  * free the given frame, afterwards the framepointer is undefined
+ * a pooled frame goes back at the end of the free index: its slot, 
+ * returned by jb_get(), stays untouched as long as possible
  */
-static void frame_free(jb_frame *frame) 
+static void frame_free(jitterbuffer *jb, jb_frame *frame) 
 {
+  if (jb->pool.count) {
+    jb->pool.free_index[(jb->pool.free_head + jb->pool.free_size) % jb->pool.count] = (long)(frame - jb->pool.frames);
+    jb->pool.free_size++;
+    return;
+  }
   if (frame->data) {
     free(frame->data);
   }
@@ -481,16 +579,16 @@ static void frame_free(jb_frame *frame)
 /***********
  * put a nonvoice frame into the nonvoice queue
  */
-static void put_control(jitterbuffer *jb, void *data, int type, long ts) 
+static void put_control(jitterbuffer *jb, void *data, long size, int type, long ts) 
 {
   jb_frame *frame, *p;
     
-  frame = malloc(sizeof(jb_frame));
+  frame = frame_alloc(jb, data, size);
   if(!frame) {
     jb_err("cannot allocate frame\n");
+    jb->info.frames_dropped++;
     return;
   }
-  frame->data = data;
   frame->ts = ts;
   frame->type = type;
   frame->next = NULL;
@@ -519,16 +617,16 @@ static void put_control(jitterbuffer *jb, void *data, int type, long ts)
 /***********
  * put a voice or silence frame into the jitterbuffer 
  */
-static void put_voice(jitterbuffer *jb, void *data, int type, long ms, long ts, int codec) 
+static void put_voice(jitterbuffer *jb, void *data, long size, int type, long ms, long ts, int codec) 
 {
   jb_frame *frame, *p;
-  frame = malloc(sizeof(jb_frame));
+  frame = frame_alloc(jb, data, size);
   if(!frame) {
     jb_err("cannot allocate frame\n");
+    jb->info.frames_dropped++;
     return;
   }
   
-  frame->data = data;
   frame->ts = ts;
   frame->ms = ms;
   frame->type = type;
@@ -770,7 +868,7 @@ static int get_control(jitterbuffer *jb, void **data)
     *data = frame->data;
     frame->data = NULL;
     jb->controlframes = frame->next;
-    frame_free(frame);
+    frame_free(jb, frame);
     result = JB_OK;
   } else {
     result = JB_NOFRAME;
@@ -806,7 +904,7 @@ static int get_voice(jitterbuffer *jb, void **data, long now, long interpl)
     frame->data = NULL;
     jb->info.silence =1;
     jb->silence_begin_ts = frame->ts;
-    frame_free(frame);
+    frame_free(jb, frame);
     result = JB_OK;
   } else {  
     if(jb->info.silence) { // we are in silence
@@ -823,7 +921,7 @@ static int get_voice(jitterbuffer *jb, void **data, long now, long interpl)
           jb_dbg("gL");
           /* voice frame is late, next!*/
           jb->info.frames_late++;
-          frame_free(frame);
+          frame_free(jb, frame);
           result = get_voice(jb, data, now, interpl);
         } else {
           jb_dbg("gP"); 
@@ -834,7 +932,7 @@ static int get_voice(jitterbuffer *jb, void **data, long now, long interpl)
           jb->info.last_voice_ms = frame->ms;
           *data = frame->data;
           frame->data = NULL;
-          frame_free(frame);
+          frame_free(jb, frame);
           result = JB_OK;
         }
       } else {    //no frame 
@@ -897,7 +995,7 @@ static int get_voicecase(jitterbuffer *jb, void **data, long now, long interpl,
       /* shrink by frame size we're throwing out */
       jb->info.frames_dropped++;
       jb->current -= frame->ms;
-      frame_free(frame);
+      frame_free(jb, frame);
     } else {
       jb_dbg("aS");
       /* shrink by interpl */
@@ -921,7 +1019,7 @@ static int get_voicecase(jitterbuffer *jb, void **data, long now, long interpl,
         if(frame->ts < jb->next_voice_time) {   //late
           jb_dbg("aL");
           jb->info.frames_late++;
-          frame_free(frame);
+          frame_free(jb, frame);
           result = get_voice(jb, data, now, interpl);
         } else {
           jb_dbg("aP");
@@ -930,7 +1028,7 @@ static int get_voicecase(jitterbuffer *jb, void **data, long now, long interpl,
           frame->data = NULL;
           jb->next_voice_time = frame->ts + frame->ms;
           jb->cnt_successive_interp = 0;
-          frame_free(frame);
+          frame_free(jb, frame);
           result = JB_OK;
         }
       } else { // no frame, thus interpolate
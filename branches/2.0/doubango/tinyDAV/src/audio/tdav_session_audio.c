@@ -47,7 +47,6 @@
 
 static int _tdav_session_audio_dtmfe_timercb(const void* arg, tsk_timer_id_t timer_id);
 static struct tdav_session_audio_dtmfe_s* _tdav_session_audio_dtmfe_create(const tdav_session_audio_t* session, uint8_t event, uint16_t duration, uint32_t seq, uint32_t timestamp, uint8_t format, tsk_bool_t M, tsk_bool_t E);
-static void _tdav_session_audio_apply_gain(void* buffer, int len, int bps, int gain);
 static tmedia_resampler_t* _tdav_session_audio_resampler_create(int32_t bytes_per_sample, uint32_t in_freq, uint32_t out_freq, uint32_t frame_duration, uint32_t in_channels, uint32_t out_channels, uint32_t quality, void** resampler_buffer, tsk_size_t *resampler_buffer_size);
 
 /* DTMF event object */
@@ -109,7 +108,7 @@ static int tdav_session_audio_rtp_cb(const void* callback_data, const struct trt
 			tsk_safeobj_unlock(base);
 		}
 		// Decode data
-		out_size = codec->plugin->decode(codec, packet->payload.data, packet->payload.size, &audio->decoder.buffer, &audio->decoder.buffer_size, packet->header);
+		out_size = codec->plugin->decode(codec, (packet->payload.data ? packet->payload.data : packet->payload.data_const), packet->payload.size, &audio->decoder.buffer, &audio->decoder.buffer_size, packet->header);
 		if (out_size && audio->is_started) { // check "is_started" again ...to be sure stop() not called by another thread 
 			void* buffer = audio->decoder.buffer;
 			tsk_size_t size = out_size;
@@ -149,10 +148,8 @@ static int tdav_session_audio_rtp_cb(const void* callback_data, const struct trt
 				size = audio->decoder.resampler.buffer_size;
 			}
 
-			// adjust the gain
-			if (base->consumer->audio.gain) {
-				_tdav_session_audio_apply_gain(buffer, (int)size, base->consumer->audio.bits_per_sample, base->consumer->audio.gain);
-			}
+			// adjust the gain and measure the levels
+			tdav_audio_pcm_stage_process(&audio->decoder.pcm, buffer, size, base->consumer->audio.bits_per_sample, base->consumer->audio.gain);
 			// consume the frame
 			tmedia_consumer_consume(base->consumer, buffer, size, packet->header);
 		}
@@ -269,11 +266,9 @@ static int tdav_session_audio_producer_enc_cb(const void* callback_data, const v
 				ret = tmedia_denoise_process_record(TMEDIA_DENOISE(audio->denoise), (void*)buffer, (uint32_t)size, &silence_or_noise);
 			}
 		}
-		// adjust the gain
+		// adjust the gain and measure the levels
 		// Must be done after resampling
-		if (base->producer->audio.gain){
-			_tdav_session_audio_apply_gain((void*)buffer, (int)size, base->producer->audio.bits_per_sample, base->producer->audio.gain);
-		}
+		tdav_audio_pcm_stage_process(&audio->encoder.pcm, (void*)buffer, size, base->producer->audio.bits_per_sample, base->producer->audio.gain);
 
 		// Encode data
 		if ((audio->encoder.codec = tsk_object_ref(audio->encoder.codec))){ /* Thread safeness (SIP reINVITE or UPDATE could update the encoder) */
@@ -329,6 +324,9 @@ static int tdav_session_audio_set(tmedia_session_t* self, const tmedia_param_t*
 					return tmedia_denoise_set(audio->denoise, param);
 				}
 			}
+			else if (tsk_striequals(param->key, "vad-scoring")){
+				audio->encoder.pcm.vad_enabled = audio->decoder.pcm.vad_enabled = (TSK_TO_INT32((uint8_t*)param->value) != 0);
+			}
 		}
 	}
 
@@ -346,6 +344,31 @@ static int tdav_session_audio_get(tmedia_session_t* self, tmedia_param_t* param)
 		return 0;
 	}
 
+	// levels measured on the decoded (consumer) or captured (producer) audio
+	if (param->value_type == tmedia_pvt_int32 && (param->plugin_type == tmedia_ppt_consumer || param->plugin_type == tmedia_ppt_producer)){
+		const tdav_audio_pcm_levels_t* levels = (param->plugin_type == tmedia_ppt_consumer) ? &TDAV_SESSION_AUDIO(self)->decoder.pcm.levels : &TDAV_SESSION_AUDIO(self)->encoder.pcm.levels;
+		if (tsk_striequals(param->key, "level-rms")){
+			*((int32_t*)param->value) = levels->rms;
+			return 0;
+		}
+		else if (tsk_striequals(param->key, "level-peak")){
+			*((int32_t*)param->value) = levels->peak;
+			return 0;
+		}
+		else if (tsk_striequals(param->key, "level-dbov")){
+			*((int32_t*)param->value) = levels->dbov;
+			return 0;
+		}
+		else if (tsk_striequals(param->key, "vad-score")){
+			*((int32_t*)param->value) = levels->vad_score;
+			return 0;
+		}
+		else if (tsk_striequals(param->key, "clipped-samples")){
+			*((int32_t*)param->value) = levels->clipped;
+			return 0;
+		}
+	}
+
 	// the codec information is held by the session even if the user is authorized to request it for the consumer/producer
 	if (tsk_striequals("codec", param->key) && param->value_type == tmedia_pvt_pobject){
 		if (param->plugin_type == tmedia_ppt_consumer){
@@ -656,31 +679,6 @@ static int tdav_session_audio_set_ro(tmedia_session_t* self, const tsdp_header_M
 	return ret;
 }
 
-/* apply gain */
-static void _tdav_session_audio_apply_gain(void* buffer, int len, int bps, int gain)
-{
-	register int i;
-	int max_val;
-
-	max_val = (1 << (bps - 1 - gain)) - 1;
-
-	if (bps == 8) {
-		int8_t *buff = buffer;
-		for (i = 0; i < len; i++) {
-			if (buff[i] > -max_val && buff[i] < max_val)
-				buff[i] = buff[i] << gain;
-		}
-	}
-	else if (bps == 16) {
-		int16_t *buff = buffer;
-		for (i = 0; i < len / 2; i++) {
-			if (buff[i] > -max_val && buff[i] < max_val)
-				buff[i] = buff[i] << gain;
-		}
-	}
-}
-
-
 /* Internal function used to create new DTMF event */
 static tdav_session_audio_dtmfe_t* _tdav_session_audio_dtmfe_create(const tdav_session_audio_t* session, uint8_t event, uint16_t duration, uint32_t seq, uint32_t timestamp, uint8_t format, tsk_bool_t M, tsk_bool_t E)
 {
@@ -808,6 +806,8 @@ static tsk_object_t* tdav_session_audio_ctor(tsk_object_t * self, va_list * app)
 		}
 
 		/* init() self */
+		tdav_audio_pcm_stage_init(&audio->encoder.pcm);
+		tdav_audio_pcm_stage_init(&audio->decoder.pcm);
 		if (base->producer){
 			tmedia_producer_set_enc_callback(base->producer, tdav_session_audio_producer_enc_cb, audio);
 		}
@@ -49,6 +49,8 @@
 #define TDAV_SPEAKUP_10MS						10
 #define TDAV_SPEAKUP_10MS_FRAME_SIZE(self)		(((self)->rate * TDAV_SPEAKUP_10MS)/1000)
 #define TDAV_SPEAKUP_PTIME_FRAME_SIZE(self)		(((self)->rate * (self)->framesize)/1000)
+/* maximum delay (in milliseconds) the slab can hold, two extra ptimes are kept for bursts */
+#define TDAV_SPEAKUP_SLAB_MAX_DELAY				1000
 
 static int tdav_speakup_jitterbuffer_set(tmedia_jitterbuffer_t *self, const tmedia_param_t* param)
 {
@@ -59,8 +61,20 @@ static int tdav_speakup_jitterbuffer_set(tmedia_jitterbuffer_t *self, const tmed
 static int tdav_speakup_jitterbuffer_open(tmedia_jitterbuffer_t* self, uint32_t frame_duration, uint32_t rate, uint32_t channels)
 {
 	tdav_speakup_jitterbuffer_t *jitterbuffer = (tdav_speakup_jitterbuffer_t *)self;
+	uint32_t _10ms_size_bytes = 160 * (rate/8000);
+	if(jitterbuffer->slab && jitterbuffer->jbuffer && jitterbuffer->jbuffer->pool.data_size != (long)_10ms_size_bytes){
+		/* rate changed */
+		jb_destroy(jitterbuffer->jbuffer);
+		jitterbuffer->jbuffer = tsk_null;
+	}
 	if(!jitterbuffer->jbuffer){
-		if(!(jitterbuffer->jbuffer = jb_new())){
+		if(jitterbuffer->slab){
+			jitterbuffer->jbuffer = jb_new_with_pool((TDAV_SPEAKUP_SLAB_MAX_DELAY + (frame_duration << 1)) / TDAV_SPEAKUP_10MS, _10ms_size_bytes);
+		}
+		else{
+			jitterbuffer->jbuffer = jb_new();
+		}
+		if(!jitterbuffer->jbuffer){
 			TSK_DEBUG_ERROR("Failed to create new buffer");
 			return -1;
 		}
@@ -70,7 +84,7 @@ static int tdav_speakup_jitterbuffer_open(tmedia_jitterbuffer_t* self, uint32_t
 	jitterbuffer->frame_duration = frame_duration;
 	jitterbuffer->rate = rate;
 	jitterbuffer->channels = channels;
-	jitterbuffer->_10ms_size_bytes = 160 * (rate/8000);
+	jitterbuffer->_10ms_size_bytes = _10ms_size_bytes;
 
 	return 0;
 }
@@ -134,7 +148,11 @@ static int tdav_speakup_jitterbuffer_put(tmedia_jitterbuffer_t* self, void* data
 	ts = (long)(rtp_hdr->timestamp/(jitterbuffer->rate/1000));
 	pdata = (uint8_t*)data;
 	for(i=0; i<(int)(data_size/jitterbuffer->_10ms_size_bytes);i++){
-		if((_10ms_buf = tsk_calloc(jitterbuffer->_10ms_size_bytes, 1))){
+		if(jitterbuffer->slab){
+			/* copied into the slab */
+			jb_put_with_size(jitterbuffer->jbuffer, &pdata[i*jitterbuffer->_10ms_size_bytes], (long)jitterbuffer->_10ms_size_bytes, JB_TYPE_VOICE, TDAV_SPEAKUP_10MS, ts, now, jitterbuffer->jcodec);
+		}
+		else if((_10ms_buf = tsk_calloc(jitterbuffer->_10ms_size_bytes, 1))){
 			memcpy(_10ms_buf, &pdata[i*jitterbuffer->_10ms_size_bytes], jitterbuffer->_10ms_size_bytes);
 			jb_put(jitterbuffer->jbuffer, _10ms_buf, JB_TYPE_VOICE, TDAV_SPEAKUP_10MS, ts, now, jitterbuffer->jcodec);
 			_10ms_buf = tsk_null;
@@ -190,6 +208,9 @@ static tsk_size_t tdav_speakup_jitterbuffer_get(tmedia_jitterbuffer_t* self, voi
 			default:
 				break;
 		}
+		if(jitterbuffer->slab){
+			_10ms_buf = tsk_null; /* owned by the slab */
+		}
 		TSK_FREE(_10ms_buf);
 	}
 
@@ -237,6 +258,19 @@ static tsk_object_t* tdav_speakup_jitterbuffer_ctor(tsk_object_t * self, va_list
 	}
 	return self;
 }
+/* constructor */
+static tsk_object_t* tdav_speakup_slab_jitterbuffer_ctor(tsk_object_t * self, va_list * app)
+{
+	tdav_speakup_jitterbuffer_t *jitterbuffer = self;
+	TSK_DEBUG_INFO("Create speekup jitter buffer (slab)");
+	if(jitterbuffer){
+		/* init base */
+		tmedia_jitterbuffer_init(TMEDIA_JITTER_BUFFER(jitterbuffer));
+		/* init self */
+		jitterbuffer->slab = tsk_true;
+	}
+	return self;
+}
 /* destructor */
 static tsk_object_t* tdav_speakup_jitterbuffer_dtor(tsk_object_t * self)
 { 
@@ -278,4 +312,34 @@ static const tmedia_jitterbuffer_plugin_def_t tdav_speakup_jitterbuffer_plugin_d
 };
 const tmedia_jitterbuffer_plugin_def_t *tdav_speakup_jitterbuffer_plugin_def_t = &tdav_speakup_jitterbuffer_plugin_def_s;
 
+
+//
+//	Speakup jitterbufferr Plugin definition (preallocated frames)
+//
+
+/* object definition */
+static const tsk_object_def_t tdav_speakup_slab_jitterbuffer_def_s = 
+{
+	sizeof(tdav_speakup_jitterbuffer_t),
+	tdav_speakup_slab_jitterbuffer_ctor, 
+	tdav_speakup_jitterbuffer_dtor,
+	tsk_null, 
+};
+/* plugin definition*/
+static const tmedia_jitterbuffer_plugin_def_t tdav_speakup_slab_jitterbuffer_plugin_def_s = 
+{
+	&tdav_speakup_slab_jitterbuffer_def_s,
+	tmedia_audio,
+	"Audio JitterBuffer based on Speakup (preallocated frames)",
+	
+	tdav_speakup_jitterbuffer_set,
+	tdav_speakup_jitterbuffer_open,
+	tdav_speakup_jitterbuffer_tick,
+	tdav_speakup_jitterbuffer_put,
+	tdav_speakup_jitterbuffer_get,
+	tdav_speakup_jitterbuffer_reset,
+	tdav_speakup_jitterbuffer_close,
+};
+const tmedia_jitterbuffer_plugin_def_t *tdav_speakup_slab_jitterbuffer_plugin_def_t = &tdav_speakup_slab_jitterbuffer_plugin_def_s;
+
 #endif /* !(HAVE_SPEEX_DSP && HAVE_SPEEX_JB) */
@@ -0,0 +1,253 @@
+/*
+* Copyright (C) 2010-2015 Mamadou DIOP.
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*/
+
+/**@file tdav_consumer_virtual.c
+* @brief Headless audio consumer driven by the audio scheduler (no sound card, e.g. media servers).
+*/
+#include "tinydav/audio/virtual/tdav_consumer_virtual.h"
+#include "tinydav/audio/tdav_audio_scheduler.h"
+
+#include "tsk_memory.h"
+#include "tsk_safeobj.h"
+#include "tsk_debug.h"
+
+#define VIRTUAL_DEBUG_INFO(FMT, ...) TSK_DEBUG_INFO("[Virtual Consumer] " FMT, ##__VA_ARGS__)
+#define VIRTUAL_DEBUG_WARN(FMT, ...) TSK_DEBUG_WARN("[Virtual Consumer] " FMT, ##__VA_ARGS__)
+#define VIRTUAL_DEBUG_ERROR(FMT, ...) TSK_DEBUG_ERROR("[Virtual Consumer] " FMT, ##__VA_ARGS__)
+
+typedef struct tdav_consumer_virtual_s
+{
+	TDAV_DECLARE_CONSUMER_AUDIO;
+
+	tsk_bool_t b_started;
+
+	tsk_size_t n_buff_size_in_bytes;
+	uint8_t* p_buff_ptr;
+
+	tdav_consumer_virtual_sink_cb_f sink_cb;
+	const void* sink_cb_data;
+
+	TSK_DECLARE_SAFEOBJ;
+}
+tdav_consumer_virtual_t;
+
+/* called by the audio scheduler every ptime */
+static int _tdav_consumer_virtual_tick(const void* callback_data)
+{
+	tdav_consumer_virtual_t* p_virtual = (tdav_consumer_virtual_t*)callback_data;
+	tsk_size_t n_size;
+
+	tsk_safeobj_lock(p_virtual);
+	if (p_virtual->b_started) {
+		n_size = tdav_consumer_audio_get(TDAV_CONSUMER_AUDIO(p_virtual), p_virtual->p_buff_ptr, p_virtual->n_buff_size_in_bytes); // thread-safe
+		if (n_size < p_virtual->n_buff_size_in_bytes) {
+			memset(p_virtual->p_buff_ptr + n_size, 0, (p_virtual->n_buff_size_in_bytes - n_size));
+		}
+		if (p_virtual->sink_cb) {
+			p_virtual->sink_cb(p_virtual->sink_cb_data, p_virtual->p_buff_ptr, p_virtual->n_buff_size_in_bytes);
+		}
+		tdav_consumer_audio_tick(TDAV_CONSUMER_AUDIO(p_virtual));
+	}
+	tsk_safeobj_unlock(p_virtual);
+	return 0;
+}
+
+/** Sets the function receiving the decoded PCM. Without sink the audio is pulled from the jitter buffer and dropped. */
+int tdav_consumer_virtual_set_sink(tmedia_consumer_t* self, tdav_consumer_virtual_sink_cb_f callback, const void* callback_data)
+{
+	tdav_consumer_virtual_t* p_virtual = (tdav_consumer_virtual_t*)self;
+	if (!p_virtual || self->plugin != tdav_consumer_virtual_plugin_def_t) {
+		VIRTUAL_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	tsk_safeobj_lock(p_virtual);
+	p_virtual->sink_cb = callback;
+	p_virtual->sink_cb_data = callback_data;
+	tsk_safeobj_unlock(p_virtual);
+	return 0;
+}
+
+/* ============ Media Consumer Interface ================= */
+static int tdav_consumer_virtual_set(tmedia_consumer_t* self, const tmedia_param_t* param)
+{
+	return tdav_consumer_audio_set(TDAV_CONSUMER_AUDIO(self), param);
+}
+
+static int tdav_consumer_virtual_prepare(tmedia_consumer_t* self, const tmedia_codec_t* codec)
+{
+	tdav_consumer_virtual_t* p_virtual = (tdav_consumer_virtual_t*)self;
+	int err = 0;
+
+	if (!p_virtual || !codec) {
+		VIRTUAL_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+
+	tsk_safeobj_lock(p_virtual);
+
+	TMEDIA_CONSUMER(p_virtual)->audio.ptime = TMEDIA_CODEC_PTIME_AUDIO_DECODING(codec);
+	TMEDIA_CONSUMER(p_virtual)->audio.in.channels = TMEDIA_CODEC_CHANNELS_AUDIO_DECODING(codec);
+	TMEDIA_CONSUMER(p_virtual)->audio.in.rate = TMEDIA_CODEC_RATE_DECODING(codec);
+	/* no device: no resampling */
+	TMEDIA_CONSUMER(p_virtual)->audio.out.channels = TMEDIA_CONSUMER(p_virtual)->audio.in.channels;
+	TMEDIA_CONSUMER(p_virtual)->audio.out.rate = TMEDIA_CONSUMER(p_virtual)->audio.in.rate;
+
+	p_virtual->n_buff_size_in_bytes = (TMEDIA_CONSUMER(p_virtual)->audio.ptime * TMEDIA_CONSUMER(p_virtual)->audio.out.rate * ((TMEDIA_CONSUMER(p_virtual)->audio.bits_per_sample >> 3) * TMEDIA_CONSUMER(p_virtual)->audio.out.channels)) / 1000;
+	if (!(p_virtual->p_buff_ptr = tsk_realloc(p_virtual->p_buff_ptr, p_virtual->n_buff_size_in_bytes))) {
+		VIRTUAL_DEBUG_ERROR("Failed to allocate buffer with size = %u", (unsigned)p_virtual->n_buff_size_in_bytes);
+		p_virtual->n_buff_size_in_bytes = 0;
+		err = -2;
+	}
+
+	VIRTUAL_DEBUG_INFO("prepared: channels=%d; rate=%d; ptime=%d",
+		TMEDIA_CONSUMER(p_virtual)->audio.out.channels, TMEDIA_CONSUMER(p_virtual)->audio.out.rate, TMEDIA_CONSUMER(p_virtual)->audio.ptime);
+
+	tsk_safeobj_unlock(p_virtual);
+	return err;
+}
+
+static int tdav_consumer_virtual_start(tmedia_consumer_t* self)
+{
+	tdav_consumer_virtual_t* p_virtual = (tdav_consumer_virtual_t*)self;
+	int err;
+
+	if (!p_virtual) {
+		VIRTUAL_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+
+	tsk_safeobj_lock(p_virtual);
+	if (p_virtual->b_started) {
+		VIRTUAL_DEBUG_WARN("Already started");
+		tsk_safeobj_unlock(p_virtual);
+		return 0;
+	}
+	if (!p_virtual->p_buff_ptr) {
+		VIRTUAL_DEBUG_ERROR("Not prepared");
+		tsk_safeobj_unlock(p_virtual);
+		return -2;
+	}
+	p_virtual->b_started = tsk_true;
+	tsk_safeobj_unlock(p_virtual);
+
+	/* must not hold our lock: the scheduler's workers lock it from within the tick */
+	if ((err = tdav_audio_scheduler_add(p_virtual, _tdav_consumer_virtual_tick, TMEDIA_CONSUMER(p_virtual)->audio.ptime))) {
+		p_virtual->b_started = tsk_false;
+		return err;
+	}
+
+	VIRTUAL_DEBUG_INFO("started");
+	return 0;
+}
+
+static int tdav_consumer_virtual_consume(tmedia_consumer_t* self, const void* buffer, tsk_size_t size, const tsk_object_t* proto_hdr)
+{
+	tdav_consumer_virtual_t* p_virtual = (tdav_consumer_virtual_t*)self;
+
+	if (!p_virtual || !buffer || !size) {
+		VIRTUAL_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	if (!p_virtual->b_started) {
+		VIRTUAL_DEBUG_WARN("Not started");
+		return -2;
+	}
+	return tdav_consumer_audio_put(TDAV_CONSUMER_AUDIO(p_virtual), buffer, size, proto_hdr); // thread-safe
+}
+
+static int tdav_consumer_virtual_pause(tmedia_consumer_t* self)
+{
+	return 0;
+}
+
+static int tdav_consumer_virtual_stop(tmedia_consumer_t* self)
+{
+	tdav_consumer_virtual_t* p_virtual = (tdav_consumer_virtual_t*)self;
+
+	if (!p_virtual) {
+		VIRTUAL_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+
+	p_virtual->b_started = tsk_false;
+	/* returns when the tick is no longer running */
+	tdav_audio_scheduler_remove(p_virtual);
+
+	VIRTUAL_DEBUG_INFO("stopped");
+	return 0;
+}
+
+
+//
+//	Virtual consumer object definition
+//
+/* constructor */
+static tsk_object_t* tdav_consumer_virtual_ctor(tsk_object_t * self, va_list * app)
+{
+	tdav_consumer_virtual_t *p_virtual = (tdav_consumer_virtual_t*)self;
+	if (p_virtual) {
+		/* init base */
+		tdav_consumer_audio_init(TDAV_CONSUMER_AUDIO(p_virtual));
+		/* init self */
+		tsk_safeobj_init(p_virtual);
+	}
+	return self;
+}
+/* destructor */
+static tsk_object_t* tdav_consumer_virtual_dtor(tsk_object_t * self)
+{ 
+	tdav_consumer_virtual_t *p_virtual = (tdav_consumer_virtual_t *)self;
+	if (p_virtual) {
+		/* stop */
+		if (p_virtual->b_started) {
+			tdav_consumer_virtual_stop((tmedia_consumer_t*)p_virtual);
+		}
+		/* deinit base */
+		tdav_consumer_audio_deinit(TDAV_CONSUMER_AUDIO(p_virtual));
+		/* deinit self */
+		TSK_FREE(p_virtual->p_buff_ptr);
+		tsk_safeobj_deinit(p_virtual);
+	}
+
+	return self;
+}
+/* object definition */
+static const tsk_object_def_t tdav_consumer_virtual_def_s = 
+{
+	sizeof(tdav_consumer_virtual_t),
+	tdav_consumer_virtual_ctor, 
+	tdav_consumer_virtual_dtor,
+	tdav_consumer_audio_cmp, 
+};
+/* plugin definition*/
+static const tmedia_consumer_plugin_def_t tdav_consumer_virtual_plugin_def_s = 
+{
+	&tdav_consumer_virtual_def_s,
+	
+	tmedia_audio,
+	"Virtual audio consumer",
+	
+	tdav_consumer_virtual_set,
+	tdav_consumer_virtual_prepare,
+	tdav_consumer_virtual_start,
+	tdav_consumer_virtual_consume,
+	tdav_consumer_virtual_pause,
+	tdav_consumer_virtual_stop
+};
+const tmedia_consumer_plugin_def_t *tdav_consumer_virtual_plugin_def_t = &tdav_consumer_virtual_plugin_def_s;
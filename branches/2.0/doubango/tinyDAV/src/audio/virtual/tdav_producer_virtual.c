@@ -0,0 +1,247 @@
+/*
+* Copyright (C) 2010-2015 Mamadou DIOP.
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*/
+
+/**@file tdav_producer_virtual.c
+* @brief Headless audio producer driven by the audio scheduler (no sound card, e.g. media servers).
+*/
+#include "tinydav/audio/virtual/tdav_producer_virtual.h"
+#include "tinydav/audio/tdav_audio_scheduler.h"
+
+#include "tsk_string.h"
+#include "tsk_memory.h"
+#include "tsk_safeobj.h"
+#include "tsk_debug.h"
+
+#define VIRTUAL_DEBUG_INFO(FMT, ...) TSK_DEBUG_INFO("[Virtual Producer] " FMT, ##__VA_ARGS__)
+#define VIRTUAL_DEBUG_WARN(FMT, ...) TSK_DEBUG_WARN("[Virtual Producer] " FMT, ##__VA_ARGS__)
+#define VIRTUAL_DEBUG_ERROR(FMT, ...) TSK_DEBUG_ERROR("[Virtual Producer] " FMT, ##__VA_ARGS__)
+
+typedef struct tdav_producer_virtual_s
+{
+	TDAV_DECLARE_PRODUCER_AUDIO;
+
+	tsk_bool_t b_started;
+	tsk_bool_t b_muted;
+
+	tsk_size_t n_buff_size_in_bytes;
+	uint8_t* p_buff_ptr;
+
+	tdav_producer_virtual_source_cb_f source_cb;
+	const void* source_cb_data;
+
+	TSK_DECLARE_SAFEOBJ;
+}
+tdav_producer_virtual_t;
+
+/* called by the audio scheduler every ptime */
+static int _tdav_producer_virtual_tick(const void* callback_data)
+{
+	tdav_producer_virtual_t* p_virtual = (tdav_producer_virtual_t*)callback_data;
+	tsk_size_t n_size = 0;
+
+	tsk_safeobj_lock(p_virtual);
+	if (p_virtual->b_started && !p_virtual->b_muted && TMEDIA_PRODUCER(p_virtual)->enc_cb.callback) {
+		if (p_virtual->source_cb) {
+			n_size = TSK_MIN(p_virtual->source_cb(p_virtual->source_cb_data, p_virtual->p_buff_ptr, p_virtual->n_buff_size_in_bytes), p_virtual->n_buff_size_in_bytes);
+		}
+		if (n_size < p_virtual->n_buff_size_in_bytes) {
+			memset(p_virtual->p_buff_ptr + n_size, 0, (p_virtual->n_buff_size_in_bytes - n_size));
+		}
+		TMEDIA_PRODUCER(p_virtual)->enc_cb.callback(TMEDIA_PRODUCER(p_virtual)->enc_cb.callback_data, p_virtual->p_buff_ptr, p_virtual->n_buff_size_in_bytes);
+	}
+	tsk_safeobj_unlock(p_virtual);
+	return 0;
+}
+
+/** Sets the function providing the PCM to send. Without source the producer sends silence. */
+int tdav_producer_virtual_set_source(tmedia_producer_t* self, tdav_producer_virtual_source_cb_f callback, const void* callback_data)
+{
+	tdav_producer_virtual_t* p_virtual = (tdav_producer_virtual_t*)self;
+	if (!p_virtual || self->plugin != tdav_producer_virtual_plugin_def_t) {
+		VIRTUAL_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	tsk_safeobj_lock(p_virtual);
+	p_virtual->source_cb = callback;
+	p_virtual->source_cb_data = callback_data;
+	tsk_safeobj_unlock(p_virtual);
+	return 0;
+}
+
+/* ============ Media Producer Interface ================= */
+static int tdav_producer_virtual_set(tmedia_producer_t* self, const tmedia_param_t* param)
+{
+	tdav_producer_virtual_t* p_virtual = (tdav_producer_virtual_t*)self;
+	if (param->plugin_type == tmedia_ppt_producer) {
+		if (param->value_type == tmedia_pvt_int32) {
+			if (tsk_striequals(param->key, "volume")) {
+				return 0;
+			}
+			else if (tsk_striequals(param->key, "mute")) {
+				p_virtual->b_muted = (TSK_TO_INT32((uint8_t*)param->value) != 0);
+				return 0;
+			}
+		}
+	}
+	return tdav_producer_audio_set(TDAV_PRODUCER_AUDIO(self), param);
+}
+
+static int tdav_producer_virtual_prepare(tmedia_producer_t* self, const tmedia_codec_t* codec)
+{
+	tdav_producer_virtual_t* p_virtual = (tdav_producer_virtual_t*)self;
+	int err = 0;
+
+	if (!p_virtual || !codec) {
+		VIRTUAL_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+
+	tsk_safeobj_lock(p_virtual);
+
+	TMEDIA_PRODUCER(p_virtual)->audio.channels = TMEDIA_CODEC_CHANNELS_AUDIO_ENCODING(codec);
+	TMEDIA_PRODUCER(p_virtual)->audio.rate = TMEDIA_CODEC_RATE_ENCODING(codec);
+	TMEDIA_PRODUCER(p_virtual)->audio.ptime = TMEDIA_CODEC_PTIME_AUDIO_ENCODING(codec);
+
+	p_virtual->n_buff_size_in_bytes = (TMEDIA_PRODUCER(p_virtual)->audio.ptime * TMEDIA_PRODUCER(p_virtual)->audio.rate * ((TMEDIA_PRODUCER(p_virtual)->audio.bits_per_sample >> 3) * TMEDIA_PRODUCER(p_virtual)->audio.channels)) / 1000;
+	if (!(p_virtual->p_buff_ptr = tsk_realloc(p_virtual->p_buff_ptr, p_virtual->n_buff_size_in_bytes))) {
+		VIRTUAL_DEBUG_ERROR("Failed to allocate buffer with size = %u", (unsigned)p_virtual->n_buff_size_in_bytes);
+		p_virtual->n_buff_size_in_bytes = 0;
+		err = -2;
+	}
+
+	VIRTUAL_DEBUG_INFO("prepared: channels=%d; rate=%d; ptime=%d",
+		TMEDIA_PRODUCER(p_virtual)->audio.channels, TMEDIA_PRODUCER(p_virtual)->audio.rate, TMEDIA_PRODUCER(p_virtual)->audio.ptime);
+
+	tsk_safeobj_unlock(p_virtual);
+	return err;
+}
+
+static int tdav_producer_virtual_start(tmedia_producer_t* self)
+{
+	tdav_producer_virtual_t* p_virtual = (tdav_producer_virtual_t*)self;
+	int err = 0;
+
+	if (!p_virtual) {
+		VIRTUAL_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+
+	tsk_safeobj_lock(p_virtual);
+	if (p_virtual->b_started) {
+		VIRTUAL_DEBUG_WARN("Already started");
+		tsk_safeobj_unlock(p_virtual);
+		return 0;
+	}
+	if (!p_virtual->p_buff_ptr) {
+		VIRTUAL_DEBUG_ERROR("Not prepared");
+		tsk_safeobj_unlock(p_virtual);
+		return -2;
+	}
+	p_virtual->b_started = tsk_true;
+	tsk_safeobj_unlock(p_virtual);
+
+	/* must not hold our lock: the scheduler's workers lock it from within the tick */
+	if ((err = tdav_audio_scheduler_add(p_virtual, _tdav_producer_virtual_tick, TMEDIA_PRODUCER(p_virtual)->audio.ptime))) {
+		p_virtual->b_started = tsk_false;
+		return err;
+	}
+
+	VIRTUAL_DEBUG_INFO("started");
+	return 0;
+}
+
+static int tdav_producer_virtual_pause(tmedia_producer_t* self)
+{
+	return 0;
+}
+
+static int tdav_producer_virtual_stop(tmedia_producer_t* self)
+{
+	tdav_producer_virtual_t* p_virtual = (tdav_producer_virtual_t*)self;
+
+	if (!p_virtual) {
+		VIRTUAL_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+
+	p_virtual->b_started = tsk_false;
+	/* returns when the tick is no longer running */
+	tdav_audio_scheduler_remove(p_virtual);
+
+	VIRTUAL_DEBUG_INFO("stopped");
+	return 0;
+}
+
+
+//
+//	Virtual producer object definition
+//
+/* constructor */
+static tsk_object_t* tdav_producer_virtual_ctor(tsk_object_t * self, va_list * app)
+{
+	tdav_producer_virtual_t *p_virtual = (tdav_producer_virtual_t*)self;
+	if (p_virtual) {
+		/* init base */
+		tdav_producer_audio_init(TDAV_PRODUCER_AUDIO(p_virtual));
+		/* init self */
+		tsk_safeobj_init(p_virtual);
+	}
+	return self;
+}
+/* destructor */
+static tsk_object_t* tdav_producer_virtual_dtor(tsk_object_t * self)
+{ 
+	tdav_producer_virtual_t *p_virtual = (tdav_producer_virtual_t *)self;
+	if (p_virtual) {
+		/* stop */
+		if (p_virtual->b_started) {
+			tdav_producer_virtual_stop((tmedia_producer_t*)p_virtual);
+		}
+		/* deinit base */
+		tdav_producer_audio_deinit(TDAV_PRODUCER_AUDIO(p_virtual));
+		/* deinit self */
+		TSK_FREE(p_virtual->p_buff_ptr);
+		tsk_safeobj_deinit(p_virtual);
+	}
+
+	return self;
+}
+/* object definition */
+static const tsk_object_def_t tdav_producer_virtual_def_s = 
+{
+	sizeof(tdav_producer_virtual_t),
+	tdav_producer_virtual_ctor, 
+	tdav_producer_virtual_dtor,
+	tdav_producer_audio_cmp, 
+};
+/* plugin definition*/
+static const tmedia_producer_plugin_def_t tdav_producer_virtual_plugin_def_s = 
+{
+	&tdav_producer_virtual_def_s,
+	
+	tmedia_audio,
+	"Virtual audio producer",
+	
+	tdav_producer_virtual_set,
+	tdav_producer_virtual_prepare,
+	tdav_producer_virtual_start,
+	tdav_producer_virtual_pause,
+	tdav_producer_virtual_stop
+};
+const tmedia_producer_plugin_def_t *tdav_producer_virtual_plugin_def_t = &tdav_producer_virtual_plugin_def_s;
@@ -293,3 +293,309 @@ unsigned char ulaw2alaw(unsigned char	uval)
 	return (unsigned char) ((uval & 0x80) ? (0xD5 ^ (_u2a[0xFF ^ uval] - 1)) :
 	    (unsigned char) (0x55 ^ (_u2a[0x7F ^ uval] - 1)));
 }
+
+/*
+ * Block conversions.
+ *
+ * Decoding uses 256-entry tables. Encoding only depends on the 13 (A-law) or 14 (u-law) most
+ * significant bits of the sample which makes 8K/16K-entry tables possible. When the CPU
+ * supports it, encoding is done 8 (SSE2, NEON) or 32 (AVX2) samples at a time: the segment
+ * is the number of segment ends exceeded and the quantization bits are extracted using a
+ * multiply-high by (0x8000 >> shift) instead of a per-lane variable shift.
+ * All tables are built once by g711_init() from the scalar functions above so the results are bit-exact.
+ */
+#include "tsk_cpu.h"
+
+#if TSK_CPU_X86
+#	include <emmintrin.h>
+#	if defined(__GNUC__) || defined(_MSC_VER)
+#		include <immintrin.h>
+#		define G711_HAVE_AVX2 1
+#	endif
+#elif TSK_CPU_NEON
+#	include <arm_neon.h>
+#endif
+
+static unsigned char _l2a[8192];	/* indexed by (pcm >> 3) & 0x1FFF */
+static unsigned char _l2u[16384];	/* indexed by (pcm >> 2) & 0x3FFF */
+static short _a2l[256];
+static short _u2l[256];
+
+static void linear2alaw_block_lut(const short* pcm, unsigned char* a_val, tsk_size_t count)
+{
+	tsk_size_t i;
+	for (i = 0; i < count; i++)
+		a_val[i] = _l2a[(pcm[i] >> 3) & 0x1FFF];
+}
+
+static void linear2ulaw_block_lut(const short* pcm, unsigned char* u_val, tsk_size_t count)
+{
+	tsk_size_t i;
+	for (i = 0; i < count; i++)
+		u_val[i] = _l2u[(pcm[i] >> 2) & 0x3FFF];
+}
+
+#if TSK_CPU_X86
+
+#define G711_SSE2_SEG(thr, mag, seg, mult, halve) { \
+	__m128i _m = _mm_cmpgt_epi16(mag, _mm_set1_epi16(thr)); \
+	seg = _mm_sub_epi16(seg, _m); \
+	if (halve) mult = _mm_sub_epi16(mult, _mm_and_si128(_mm_srli_epi16(mult, 1), _m)); \
+}
+
+TSK_CPU_TARGET("sse2") static __m128i linear2alaw_sse2(__m128i x)
+{
+	__m128i v = _mm_srai_epi16(x, 3);
+	__m128i sign = _mm_srai_epi16(v, 15);
+	__m128i mag = _mm_xor_si128(v, sign);	/* -v - 1 for negative values */
+	__m128i seg = _mm_setzero_si128();
+	__m128i mult = _mm_set1_epi16((short)0x8000);
+	__m128i aval;
+
+	G711_SSE2_SEG(0x1F, mag, seg, mult, 0);
+	G711_SSE2_SEG(0x3F, mag, seg, mult, 1);
+	G711_SSE2_SEG(0x7F, mag, seg, mult, 1);
+	G711_SSE2_SEG(0xFF, mag, seg, mult, 1);
+	G711_SSE2_SEG(0x1FF, mag, seg, mult, 1);
+	G711_SSE2_SEG(0x3FF, mag, seg, mult, 1);
+	G711_SSE2_SEG(0x7FF, mag, seg, mult, 1);
+
+	aval = _mm_or_si128(_mm_slli_epi16(seg, SEG_SHIFT), _mm_and_si128(_mm_mulhi_epu16(mag, mult), _mm_set1_epi16(QUANT_MASK)));
+	return _mm_xor_si128(aval, _mm_xor_si128(_mm_set1_epi16(0xD5), _mm_and_si128(sign, _mm_set1_epi16(SIGN_BIT))));
+}
+
+TSK_CPU_TARGET("sse2") static __m128i linear2ulaw_sse2(__m128i x)
+{
+	__m128i v = _mm_srai_epi16(x, 2);
+	__m128i sign = _mm_srai_epi16(v, 15);
+	__m128i mag = _mm_sub_epi16(_mm_xor_si128(v, sign), sign);
+	__m128i seg = _mm_setzero_si128();
+	__m128i mult = _mm_set1_epi16((short)0x8000);
+	__m128i uval;
+
+	mag = _mm_min_epi16(mag, _mm_set1_epi16(CLIP));
+	/* 8159 + 33 is out of range and saturates to 0x7F, so does 0x1FFF */
+	mag = _mm_min_epi16(_mm_add_epi16(mag, _mm_set1_epi16(BIAS >> 2)), _mm_set1_epi16(0x1FFF));
+
+	G711_SSE2_SEG(0x3F, mag, seg, mult, 1);
+	G711_SSE2_SEG(0x7F, mag, seg, mult, 1);
+	G711_SSE2_SEG(0xFF, mag, seg, mult, 1);
+	G711_SSE2_SEG(0x1FF, mag, seg, mult, 1);
+	G711_SSE2_SEG(0x3FF, mag, seg, mult, 1);
+	G711_SSE2_SEG(0x7FF, mag, seg, mult, 1);
+	G711_SSE2_SEG(0xFFF, mag, seg, mult, 1);
+
+	uval = _mm_or_si128(_mm_slli_epi16(seg, 4), _mm_and_si128(_mm_mulhi_epu16(mag, mult), _mm_set1_epi16(0xF)));
+	return _mm_xor_si128(uval, _mm_xor_si128(_mm_set1_epi16(0xFF), _mm_and_si128(sign, _mm_set1_epi16(SIGN_BIT))));
+}
+
+#define G711_SSE2_BLOCK(name, kernel, lut) \
+TSK_CPU_TARGET("sse2") static void name(const short* pcm, unsigned char* out, tsk_size_t count) \
+{ \
+	tsk_size_t i = 0; \
+	for (; i + 16 <= count; i += 16) { \
+		__m128i lo = kernel(_mm_loadu_si128((const __m128i*)&pcm[i])); \
+		__m128i hi = kernel(_mm_loadu_si128((const __m128i*)&pcm[i + 8])); \
+		_mm_storeu_si128((__m128i*)&out[i], _mm_packus_epi16(lo, hi)); \
+	} \
+	lut(&pcm[i], &out[i], count - i); \
+}
+
+G711_SSE2_BLOCK(linear2alaw_block_sse2, linear2alaw_sse2, linear2alaw_block_lut)
+G711_SSE2_BLOCK(linear2ulaw_block_sse2, linear2ulaw_sse2, linear2ulaw_block_lut)
+
+#if G711_HAVE_AVX2
+
+#define G711_AVX2_SEG(thr, mag, seg, mult, halve) { \
+	__m256i _m = _mm256_cmpgt_epi16(mag, _mm256_set1_epi16(thr)); \
+	seg = _mm256_sub_epi16(seg, _m); \
+	if (halve) mult = _mm256_sub_epi16(mult, _mm256_and_si256(_mm256_srli_epi16(mult, 1), _m)); \
+}
+
+TSK_CPU_TARGET("avx2") static __m256i linear2alaw_avx2(__m256i x)
+{
+	__m256i v = _mm256_srai_epi16(x, 3);
+	__m256i sign = _mm256_srai_epi16(v, 15);
+	__m256i mag = _mm256_xor_si256(v, sign);
+	__m256i seg = _mm256_setzero_si256();
+	__m256i mult = _mm256_set1_epi16((short)0x8000);
+	__m256i aval;
+
+	G711_AVX2_SEG(0x1F, mag, seg, mult, 0);
+	G711_AVX2_SEG(0x3F, mag, seg, mult, 1);
+	G711_AVX2_SEG(0x7F, mag, seg, mult, 1);
+	G711_AVX2_SEG(0xFF, mag, seg, mult, 1);
+	G711_AVX2_SEG(0x1FF, mag, seg, mult, 1);
+	G711_AVX2_SEG(0x3FF, mag, seg, mult, 1);
+	G711_AVX2_SEG(0x7FF, mag, seg, mult, 1);
+
+	aval = _mm256_or_si256(_mm256_slli_epi16(seg, SEG_SHIFT), _mm256_and_si256(_mm256_mulhi_epu16(mag, mult), _mm256_set1_epi16(QUANT_MASK)));
+	return _mm256_xor_si256(aval, _mm256_xor_si256(_mm256_set1_epi16(0xD5), _mm256_and_si256(sign, _mm256_set1_epi16(SIGN_BIT))));
+}
+
+TSK_CPU_TARGET("avx2") static __m256i linear2ulaw_avx2(__m256i x)
+{
+	__m256i v = _mm256_srai_epi16(x, 2);
+	__m256i sign = _mm256_srai_epi16(v, 15);
+	__m256i mag = _mm256_sub_epi16(_mm256_xor_si256(v, sign), sign);
+	__m256i seg = _mm256_setzero_si256();
+	__m256i mult = _mm256_set1_epi16((short)0x8000);
+	__m256i uval;
+
+	mag = _mm256_min_epi16(mag, _mm256_set1_epi16(CLIP));
+	mag = _mm256_min_epi16(_mm256_add_epi16(mag, _mm256_set1_epi16(BIAS >> 2)), _mm256_set1_epi16(0x1FFF));
+
+	G711_AVX2_SEG(0x3F, mag, seg, mult, 1);
+	G711_AVX2_SEG(0x7F, mag, seg, mult, 1);
+	G711_AVX2_SEG(0xFF, mag, seg, mult, 1);
+	G711_AVX2_SEG(0x1FF, mag, seg, mult, 1);
+	G711_AVX2_SEG(0x3FF, mag, seg, mult, 1);
+	G711_AVX2_SEG(0x7FF, mag, seg, mult, 1);
+	G711_AVX2_SEG(0xFFF, mag, seg, mult, 1);
+
+	uval = _mm256_or_si256(_mm256_slli_epi16(seg, 4), _mm256_and_si256(_mm256_mulhi_epu16(mag, mult), _mm256_set1_epi16(0xF)));
+	return _mm256_xor_si256(uval, _mm256_xor_si256(_mm256_set1_epi16(0xFF), _mm256_and_si256(sign, _mm256_set1_epi16(SIGN_BIT))));
+}
+
+/* _mm256_packus_epi16() works on 128-bit lanes: restore the order with a 64-bit permute */
+#define G711_AVX2_BLOCK(name, kernel, lut) \
+TSK_CPU_TARGET("avx2") static void name(const short* pcm, unsigned char* out, tsk_size_t count) \
+{ \
+	tsk_size_t i = 0; \
+	for (; i + 32 <= count; i += 32) { \
+		__m256i lo = kernel(_mm256_loadu_si256((const __m256i*)&pcm[i])); \
+		__m256i hi = kernel(_mm256_loadu_si256((const __m256i*)&pcm[i + 16])); \
+		_mm256_storeu_si256((__m256i*)&out[i], _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8)); \
+	} \
+	lut(&pcm[i], &out[i], count - i); \
+}
+
+G711_AVX2_BLOCK(linear2alaw_block_avx2, linear2alaw_avx2, linear2alaw_block_lut)
+G711_AVX2_BLOCK(linear2ulaw_block_avx2, linear2ulaw_avx2, linear2ulaw_block_lut)
+
+#endif /* G711_HAVE_AVX2 */
+
+#elif TSK_CPU_NEON
+
+static void linear2alaw_block_neon(const short* pcm, unsigned char* a_val, tsk_size_t count)
+{
+	static const uint16_t ends[7] = {0x1F, 0x3F, 0x7F, 0xFF, 0x1FF, 0x3FF, 0x7FF};
+	tsk_size_t i = 0;
+	int k;
+	for (; i + 8 <= count; i += 8) {
+		int16x8_t v = vshrq_n_s16(vld1q_s16(&pcm[i]), 3);
+		int16x8_t sign = vshrq_n_s16(v, 15);
+		uint16x8_t mag = vreinterpretq_u16_s16(veorq_s16(v, sign));
+		uint16x8_t seg = vdupq_n_u16(0);
+		uint16x8_t aval;
+		for (k = 0; k < 7; k++)
+			seg = vsubq_u16(seg, vcgtq_u16(mag, vdupq_n_u16(ends[k])));
+		/* shift right by max(seg, 1) */
+		aval = vandq_u16(vshlq_u16(mag, vnegq_s16(vreinterpretq_s16_u16(vmaxq_u16(seg, vdupq_n_u16(1))))), vdupq_n_u16(QUANT_MASK));
+		aval = vorrq_u16(vshlq_n_u16(seg, SEG_SHIFT), aval);
+		aval = veorq_u16(aval, veorq_u16(vdupq_n_u16(0xD5), vandq_u16(vreinterpretq_u16_s16(sign), vdupq_n_u16(SIGN_BIT))));
+		vst1_u8(&a_val[i], vmovn_u16(aval));
+	}
+	linear2alaw_block_lut(&pcm[i], &a_val[i], count - i);
+}
+
+static void linear2ulaw_block_neon(const short* pcm, unsigned char* u_val, tsk_size_t count)
+{
+	static const uint16_t ends[7] = {0x3F, 0x7F, 0xFF, 0x1FF, 0x3FF, 0x7FF, 0xFFF};
+	tsk_size_t i = 0;
+	int k;
+	for (; i + 8 <= count; i += 8) {
+		int16x8_t v = vshrq_n_s16(vld1q_s16(&pcm[i]), 2);
+		uint16x8_t sign = vreinterpretq_u16_s16(vshrq_n_s16(v, 15));
+		uint16x8_t mag = vreinterpretq_u16_s16(vabsq_s16(v));
+		uint16x8_t seg = vdupq_n_u16(0);
+		uint16x8_t uval;
+		mag = vminq_u16(mag, vdupq_n_u16(CLIP));
+		mag = vminq_u16(vaddq_u16(mag, vdupq_n_u16(BIAS >> 2)), vdupq_n_u16(0x1FFF));
+		for (k = 0; k < 7; k++)
+			seg = vsubq_u16(seg, vcgtq_u16(mag, vdupq_n_u16(ends[k])));
+		/* shift right by (seg + 1) */
+		uval = vandq_u16(vshlq_u16(mag, vnegq_s16(vreinterpretq_s16_u16(vaddq_u16(seg, vdupq_n_u16(1))))), vdupq_n_u16(0xF));
+		uval = vorrq_u16(vshlq_n_u16(seg, 4), uval);
+		uval = veorq_u16(uval, veorq_u16(vdupq_n_u16(0xFF), vandq_u16(sign, vdupq_n_u16(SIGN_BIT))));
+		vst1_u8(&u_val[i], vmovn_u16(uval));
+	}
+	linear2ulaw_block_lut(&pcm[i], &u_val[i], count - i);
+}
+
+#endif /* TSK_CPU_NEON */
+
+/* Must be called once, before any block conversion, from a single thread (tdav_init() does it) */
+int g711_init()
+{
+	int i;
+	for (i = 0; i < 8192; i++)
+		_l2a[i] = linear2alaw((short)(i << 3));
+	for (i = 0; i < 16384; i++)
+		_l2u[i] = linear2ulaw((short)(i << 2));
+	for (i = 0; i < 256; i++) {
+		_a2l[i] = alaw2linear((unsigned char)i);
+		_u2l[i] = ulaw2linear((unsigned char)i);
+	}
+	return 0;
+}
+
+/* The implementation is selected per call (tsk_cpu_has() only reads the cached flags) so that
+ * tsk_cpu_set_flags_mask() is honored at any time */
+void linear2alaw_block(const short* pcm, unsigned char* a_val, tsk_size_t count)
+{
+#if TSK_CPU_X86
+#	if G711_HAVE_AVX2
+	if (tsk_cpu_has(tsk_cpu_flag_avx2)) {
+		linear2alaw_block_avx2(pcm, a_val, count);
+		return;
+	}
+#	endif
+	if (tsk_cpu_has(tsk_cpu_flag_sse2)) {
+		linear2alaw_block_sse2(pcm, a_val, count);
+		return;
+	}
+#elif TSK_CPU_NEON
+	if (tsk_cpu_has(tsk_cpu_flag_neon)) {
+		linear2alaw_block_neon(pcm, a_val, count);
+		return;
+	}
+#endif
+	linear2alaw_block_lut(pcm, a_val, count);
+}
+
+void alaw2linear_block(const unsigned char* a_val, short* pcm, tsk_size_t count)
+{
+	tsk_size_t i;
+	for (i = 0; i < count; i++)
+		pcm[i] = _a2l[a_val[i]];
+}
+
+void linear2ulaw_block(const short* pcm, unsigned char* u_val, tsk_size_t count)
+{
+#if TSK_CPU_X86
+#	if G711_HAVE_AVX2
+	if (tsk_cpu_has(tsk_cpu_flag_avx2)) {
+		linear2ulaw_block_avx2(pcm, u_val, count);
+		return;
+	}
+#	endif
+	if (tsk_cpu_has(tsk_cpu_flag_sse2)) {
+		linear2ulaw_block_sse2(pcm, u_val, count);
+		return;
+	}
+#elif TSK_CPU_NEON
+	if (tsk_cpu_has(tsk_cpu_flag_neon)) {
+		linear2ulaw_block_neon(pcm, u_val, count);
+		return;
+	}
+#endif
+	linear2ulaw_block_lut(pcm, u_val, count);
+}
+
+void ulaw2linear_block(const unsigned char* u_val, short* pcm, tsk_size_t count)
+{
+	tsk_size_t i;
+	for (i = 0; i < count; i++)
+		pcm[i] = _u2l[u_val[i]];
+}
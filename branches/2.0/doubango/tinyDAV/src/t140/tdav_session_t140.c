@@ -382,7 +382,7 @@ static int _tdav_session_t140_rtp_cb(const void* callback_data, const struct trt
 			tsk_safeobj_unlock(base);
 		}
 		// Decode data
-		out_size = t140->decoder.codec->plugin->decode(t140->decoder.codec, packet->payload.data, packet->payload.size, &t140->decoder.buffer, &t140->decoder.buffer_size, packet->header);
+		out_size = t140->decoder.codec->plugin->decode(t140->decoder.codec, (packet->payload.data ? packet->payload.data : packet->payload.data_const), packet->payload.size, &t140->decoder.buffer, &t140->decoder.buffer_size, packet->header);
 		if(out_size){
 			_tdav_session_t140_recv_raw(t140, t140->decoder.buffer, out_size);
 		}
@@ -105,6 +105,7 @@ static const tsk_size_t __codec_plugins_all_count = sizeof(__codec_plugins_all)/
 #include "tinydav/video/mf/tdav_consumer_video_mf.h"
 #include "tinydav/video/gdi/tdav_consumer_video_gdi.h"
 #include "tinydav/t140/tdav_consumer_t140.h"
+#include "tinydav/audio/virtual/tdav_consumer_virtual.h"
 
 // Producers
 #include "tinydav/audio/waveapi/tdav_producer_waveapi.h"
@@ -119,6 +120,12 @@ static const tsk_size_t __codec_plugins_all_count = sizeof(__codec_plugins_all)/
 #include "tinydav/video/winm/tdav_producer_winm.h"
 #include "tinydav/video/mf/tdav_producer_video_mf.h"
 #include "tinydav/t140/tdav_producer_t140.h"
+#include "tinydav/audio/virtual/tdav_producer_virtual.h"
+
+// Audio scheduler (shared threads for the virtual devices)
+#include "tinydav/audio/tdav_audio_scheduler.h"
+// Video pool (shared threads for the decode, convert and encode jobs)
+#include "tinydav/video/tdav_video_pool.h"
 
 // Audio Denoise (AGC, Noise Suppression, VAD and AEC)
 #if HAVE_SPEEX_DSP && (!defined(HAVE_SPEEX_DENOISE) || HAVE_SPEEX_DENOISE)
@@ -129,6 +136,7 @@ static const tsk_size_t __codec_plugins_all_count = sizeof(__codec_plugins_all)/
 #endif
 
 // Audio resampler
+#include "tinydav/audio/tdav_audio_resampler.h"
 #if HAVE_SPEEX_DSP && (!defined(HAVE_SPEEX_RESAMPLER) || HAVE_SPEEX_RESAMPLER)
 #	include "tinydav/audio/tdav_speex_resampler.h"
 #endif
@@ -144,6 +152,9 @@ static const tsk_size_t __codec_plugins_all_count = sizeof(__codec_plugins_all)/
 #	include <libavcodec/avcodec.h>
 #endif
 
+// G.711 lookup tables
+#include "tinydav/codecs/g711/g711.h"
+
 static inline int _tdav_codec_plugins_collect();
 static inline int _tdav_codec_plugins_disperse();
 static inline tsk_bool_t _tdav_codec_is_supported(tdav_codec_id_t codec, const tmedia_codec_plugin_def_t* plugin);
@@ -175,6 +186,9 @@ int tdav_init()
 #   endif
 #endif
 
+	/* === G.711 tables (built here, before any session can use them) === */
+	g711_init();
+
 		/* === stand-alone plugins === */
 #if TDAV_HAVE_PLUGIN_EXT_WIN32
 	{
@@ -394,6 +408,8 @@ int tdav_init()
 #if HAVE_OSS_H
 	tmedia_consumer_plugin_register(tmedia_consumer_oss_plugin_def_t);
 #endif
+	/* Headless: must be the last one to be used only when there is no sound card (or when the others are unregistered) */
+	tmedia_consumer_plugin_register(tdav_consumer_virtual_plugin_def_t);
 
 	/* === Register producers === */
 	tmedia_producer_plugin_register(tdav_producer_t140_plugin_def_t); /* T140 */
@@ -426,6 +442,8 @@ int tdav_init()
 #elif HAVE_COREAUDIO_AUDIO_QUEUE // CoreAudio based on AudioQueue
 	tmedia_producer_plugin_register(tdav_producer_audioqueue_plugin_def_t);
 #endif
+	/* Headless: must be the last one to be used only when there is no sound card (or when the others are unregistered) */
+	tmedia_producer_plugin_register(tdav_producer_virtual_plugin_def_t);
 
 	/* === Register Audio Denoise (AGC, VAD, Noise Suppression and AEC) === */
 #if HAVE_WEBRTC && (!defined(HAVE_WEBRTC_DENOISE) || HAVE_WEBRTC_DENOISE)
@@ -436,6 +454,10 @@ int tdav_init()
 #endif
 
 	/* === Register Audio Resampler === */
+	if ((ret = tdav_audio_resampler_init())) {
+		return ret;
+	}
+	tmedia_resampler_plugin_register(tdav_audio_resampler_plugin_def_t); /* first registered wins */
 #if HAVE_SPEEX_DSP && (!defined(HAVE_SPEEX_RESAMPLER) || HAVE_SPEEX_RESAMPLER)
 	tmedia_resampler_plugin_register(tdav_speex_resampler_plugin_def_t);
 #endif
@@ -444,9 +466,19 @@ int tdav_init()
 #if HAVE_SPEEX_DSP && HAVE_SPEEX_JB
 	tmedia_jitterbuffer_plugin_register(tdav_speex_jitterbuffer_plugin_def_t);
 #else
+	tmedia_jitterbuffer_plugin_register(tdav_speakup_slab_jitterbuffer_plugin_def_t); /* before the heap based one to be used first */
 	tmedia_jitterbuffer_plugin_register(tdav_speakup_jitterbuffer_plugin_def_t);
 #endif
 
+	/* === Audio scheduler (workers are started on demand) === */
+	if ((ret = tdav_audio_scheduler_init())) {
+		return ret;
+	}
+	/* === Video pool (workers are started on demand) === */
+	if ((ret = tdav_video_pool_init())) {
+		return ret;
+	}
+
 	// collect all codecs before filtering
 	_tdav_codec_plugins_collect();
 
@@ -661,6 +693,7 @@ int tdav_deinit()
 #if HAVE_LINUX_SOUNDCARD_H // Linux
 	tmedia_consumer_plugin_unregister(tdav_consumer_oss_plugin_def_t);
 #endif
+	tmedia_consumer_plugin_unregister(tdav_consumer_virtual_plugin_def_t);
 
 	/* === UnRegister producers === */
 	tmedia_producer_plugin_unregister(tdav_producer_t140_plugin_def_t); /* T140 */
@@ -695,6 +728,7 @@ int tdav_deinit()
 #elif HAVE_COREAUDIO_AUDIO_QUEUE // CoreAudio based on AudioQueue
 	tmedia_producer_plugin_unregister(tdav_producer_audioqueue_plugin_def_t);
 #endif
+	tmedia_producer_plugin_unregister(tdav_producer_virtual_plugin_def_t);
 
 #if HAVE_OSS_H
 	tmedia_consumer_plugin_unregister(tmedia_consumer_oss_plugin_def_t);
@@ -709,6 +743,7 @@ int tdav_deinit()
 #endif
 
 	/* === UnRegister Audio Resampler === */
+	tmedia_resampler_plugin_unregister(tdav_audio_resampler_plugin_def_t);
 #if HAVE_SPEEX_DSP && (!defined(HAVE_SPEEX_RESAMPLER) || HAVE_SPEEX_RESAMPLER)
 	tmedia_resampler_plugin_unregister(tdav_speex_resampler_plugin_def_t);
 #endif
@@ -717,6 +752,7 @@ int tdav_deinit()
 #if HAVE_SPEEX_DSP && HAVE_SPEEX_JB
 	tmedia_jitterbuffer_plugin_unregister(tdav_speex_jitterbuffer_plugin_def_t);
 #else
+	tmedia_jitterbuffer_plugin_unregister(tdav_speakup_slab_jitterbuffer_plugin_def_t);
 	tmedia_jitterbuffer_plugin_unregister(tdav_speakup_jitterbuffer_plugin_def_t);
 #endif
 
@@ -736,6 +772,13 @@ int tdav_deinit()
 	// disperse all collected codecs
 	_tdav_codec_plugins_disperse();
 
+	/* === Audio resampler (shared filter banks) === */
+	tdav_audio_resampler_deinit();
+	/* === Audio scheduler === */
+	tdav_audio_scheduler_deinit();
+	/* === Video pool === */
+	tdav_video_pool_deinit();
+
 	__b_initialized = tsk_false;
 
 	return ret;
@@ -1847,6 +1847,47 @@ const tmedia_codec_t* tdav_session_av_get_ulpfec_codec(const tdav_session_av_t*
 	return tsk_null;
 }
 
+/** Relays (SFU mode) the RTP/RTCP received by each session to the other one without decoding it.
+* Both sessions must be prepared and must have negotiated the same codec. Stopping either session ends the relay.
+* @param local_delivery whether the received packets are still decoded and played by the sessions.
+*/
+int tdav_session_av_relay_start(tdav_session_av_t* self, tdav_session_av_t* peer, tsk_bool_t local_delivery)
+{
+	int ret;
+
+	if(!self || !peer || self == peer){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	if(!self->rtp_manager || !peer->rtp_manager){
+		TSK_DEBUG_ERROR("Both sessions must be prepared");
+		return -2;
+	}
+	if((ret = trtp_manager_relay_add(self->rtp_manager, peer->rtp_manager)) || (ret = trtp_manager_relay_add(peer->rtp_manager, self->rtp_manager))){
+		tdav_session_av_relay_stop(self, peer);
+		return ret;
+	}
+	trtp_manager_relay_set_local_delivery(self->rtp_manager, local_delivery);
+	trtp_manager_relay_set_local_delivery(peer->rtp_manager, local_delivery);
+	return 0;
+}
+
+/** Stops relaying between two sessions (see @ref tdav_session_av_relay_start()) and restores the local delivery. */
+int tdav_session_av_relay_stop(tdav_session_av_t* self, tdav_session_av_t* peer)
+{
+	if(!self || !peer){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	if(self->rtp_manager && peer->rtp_manager){
+		trtp_manager_relay_remove(self->rtp_manager, peer->rtp_manager);
+		trtp_manager_relay_remove(peer->rtp_manager, self->rtp_manager);
+		trtp_manager_relay_set_local_delivery(self->rtp_manager, tsk_true);
+		trtp_manager_relay_set_local_delivery(peer->rtp_manager, tsk_true);
+	}
+	return 0;
+}
+
 int tdav_session_av_deinit(tdav_session_av_t* self)
 {
 	if(!self){
@@ -23,14 +23,14 @@
  * @brief Video Jitter Buffer
  */
 #include "tinydav/video/jb/tdav_video_jb.h"
-#include "tinydav/video/jb/tdav_video_frame.h"
+#include "tinydav/video/tdav_video_pool.h"
 
 #include "tinyrtp/rtp/trtp_rtp_packet.h"
 
-#include "tsk_time.h"
-#include "tsk_memory.h"
 #include "tsk_thread.h"
 #include "tsk_condwait.h"
+#include "tsk_time.h"
+#include "tsk_memory.h"
 #include "tsk_debug.h"
 
 #if TSK_UNDER_WINDOWS
@@ -61,9 +61,54 @@
 #define TDAV_VIDEO_JB_LATENCY_MIN		2 /* Must be > 0 */
 #define TDAV_VIDEO_JB_LATENCY_MAX		15 /* Default, will be updated using fps */
 
-static const tdav_video_frame_t* _tdav_video_jb_get_frame(struct tdav_video_jb_s* self, uint32_t timestamp, uint8_t pt, tsk_bool_t *pt_matched);
+// Maximum time the decoding thread (only used when the video pool cannot be started) waits for put()
+#define TDAV_VIDEO_JB_DECODE_WAIT_MAX	(1000 / TDAV_VIDEO_JB_FPS_MIN)
+
+// Number of RTP packets allocated for a frame slot the first time it's used. Grows (and then reused) for bigger frames
+#define TDAV_VIDEO_JB_SLOT_PKTS_COUNT	16
+
+// RTP packet kept by the jitter buffer: a view (see trtp_rtp_packet_deserialize_view()) on a reused buffer
+typedef struct tdav_video_jb_pkt_s
+{
+	trtp_rtp_packet_t* packet; // reused unless the decoder kept it (see trtp_rtp_packet_recycle())
+	uint8_t* data; // extension then payload
+	tsk_size_t data_size;
+}
+tdav_video_jb_pkt_t;
+
+// Frame slot: all RTP packets sharing the same timestamp, sorted by sequence number
+typedef struct tdav_video_jb_slot_s
+{
+	uint8_t payload_type;
+	uint32_t timestamp;
+	uint32_t ssrc;
+	tdav_video_jb_pkt_t** pkts;
+	tsk_size_t pkts_count;
+	tsk_size_t pkts_max;
+}
+tdav_video_jb_slot_t;
+
+// Single-producer single-consumer queue of slot indexes
+typedef struct tdav_video_jb_queue_s
+{
+	int32_t* items; // "slots_count" items
+	uint32_t mask; // slots_count - 1
+	volatile uint32_t head; // written by the consumer only
+	volatile uint32_t tail; // written by the producer only
+}
+tdav_video_jb_queue_t;
+
+static int _tdav_video_jb_decode_job(const void* arg);
 static void* TSK_STDCALL _tdav_video_jb_decode_thread_func(void *arg);
 
+/*
+* Threading: "put()" (network thread) is the only one assembling frames. A frame is published to the decoding job
+* when it's complete or when it cannot wait anymore. The decoding job never touches a frame before it's published and gives it back once
+* decoded: the frames are exchanged using two lock-free SPSC queues ("ready" and "free").
+* The decoding job runs on the shared video pool (see tdav_video_pool.c). It's posted by "put()" when there is something to do and
+* re-posts itself at the frame rate until the published frames are consumed. At most one job is pending or running.
+* When the pool cannot be started, the same job runs on a dedicated (time critical) thread woken up by put().
+*/
 typedef struct tdav_video_jb_s
 {
 	TSK_DECLARE_OBJECT;
@@ -76,17 +121,33 @@ typedef struct tdav_video_jb_s
 	uint32_t last_timestamp;
 	int32_t conseq_frame_drop;
 	int32_t tail_max;
-	tdav_video_frames_L_t *frames;
-	int64_t frames_count;
+
+	int32_t fps_neg; // negotiated frame rate, used to size the frame slots (zero if unknown)
+	tdav_video_jb_slot_t* slots; // allocated by start(), "tail_max" is always lower than "slots_count"
+	int32_t slots_count; // power of two
+	tdav_video_jb_queue_t ready; // put() -> decoding job
+	tdav_video_jb_queue_t free; // decoding job -> put()
+	int32_t* pending; // frames being assembled, sorted by timestamp (put() only)
+	volatile int32_t pending_count;
+	int32_t* spare; // dropped frames, reused before the ones from the free queue (put() only)
+	int32_t spare_count;
+	volatile tsk_bool_t flush_requested; // asks the decoding job to drop the published frames
 
 	tsk_size_t latency_min;
 	tsk_size_t latency_max;
 
-	uint32_t decode_last_timestamp;
+	uint32_t decode_last_timestamp; // timestamp of the last published frame
 	int32_t decode_last_seq_num_with_mark; // -1 = unset
+	volatile uint32_t decode_missing; // missing packets in the oldest pending frame: (start << 16) | count
+	uint32_t decode_missing_ssrc;
 	uint64_t decode_last_time;
-	tsk_thread_handle_t* decode_thread[1];
+	uint32_t decode_prev_missing; // missing packets already signaled by the decoding job
+	tsk_bool_t decode_cleaning_delay;
+	struct tdav_video_pool_stream_s* decode_stream;
+	volatile long decode_scheduled; // whether a decoding job is pending or running
+	tsk_thread_handle_t* decode_thread[1]; // only when "decode_stream" is null
 	tsk_condwait_handle_t* decode_thread_cond;
+	volatile uint64_t decode_thread_due; // when the decoding thread runs the pending job
 
 	uint16_t seq_nums[0xFF];
 	tdav_video_jb_cb_f callback;
@@ -97,33 +158,123 @@ typedef struct tdav_video_jb_s
 	tdav_video_jb_cb_data_xt cb_data_fdd;
 	tdav_video_jb_cb_data_xt cb_data_any;
 
-	struct{
-		void* ptr;
-		tsk_size_t size;
-	} buffer;
-
 	TSK_DECLARE_SAFEOBJ;
 }
 tdav_video_jb_t;
 
+#define _tdav_video_jb_queue_count(queue) ((queue)->tail - (queue)->head)
+#define _tdav_video_jb_frames_count(self) ((int64_t)(self)->pending_count + (int64_t)_tdav_video_jb_queue_count(&(self)->ready))
+#define _tdav_video_jb_decode_pending(self) (_tdav_video_jb_queue_count(&(self)->ready) || (self)->flush_requested || ((self)->decode_missing && (self)->decode_missing != (self)->decode_prev_missing))
+
+static void _tdav_video_jb_queue_push(tdav_video_jb_queue_t* queue, int32_t index)
+{
+	queue->items[queue->tail & queue->mask] = index;
+	tsk_atomic_barrier(); // item visible before the tail
+	++queue->tail;
+}
+
+static int32_t _tdav_video_jb_queue_pop(tdav_video_jb_queue_t* queue)
+{
+	int32_t index;
+	if(queue->head == queue->tail){
+		return -1;
+	}
+	tsk_atomic_barrier(); // tail read before the item
+	index = queue->items[queue->head & queue->mask];
+	tsk_atomic_barrier(); // item read before releasing the room
+	++queue->head;
+	return index;
+}
+
+// must be called when the decoding job is not running
+static void _tdav_video_jb_reset(tdav_video_jb_t* self)
+{
+	int32_t i;
+	self->ready.head = self->ready.tail = 0;
+	self->free.head = self->free.tail = 0;
+	for(i = 0; i < self->slots_count; ++i){
+		self->slots[i].pkts_count = 0;
+		_tdav_video_jb_queue_push(&self->free, i);
+	}
+	self->pending_count = 0;
+	self->spare_count = 0;
+	self->flush_requested = tsk_false;
+	self->decode_last_timestamp = 0;
+	self->decode_last_seq_num_with_mark = -1;
+	self->decode_missing = 0;
+	self->decode_prev_missing = 0;
+	self->decode_cleaning_delay = tsk_false;
+	self->decode_scheduled = 0;
+}
+
+static void _tdav_video_jb_slots_free(tdav_video_jb_t* self)
+{
+	int32_t i;
+	tsk_size_t j;
+	if(self->slots){
+		for(i = 0; i < self->slots_count; ++i){
+			for(j = 0; j < self->slots[i].pkts_max; ++j){
+				TSK_OBJECT_SAFE_FREE(self->slots[i].pkts[j]->packet);
+				TSK_FREE(self->slots[i].pkts[j]->data);
+				TSK_FREE(self->slots[i].pkts[j]);
+			}
+			TSK_FREE(self->slots[i].pkts);
+		}
+		TSK_FREE(self->slots);
+	}
+	TSK_FREE(self->ready.items);
+	TSK_FREE(self->free.items);
+	TSK_FREE(self->pending);
+	TSK_FREE(self->spare);
+	self->slots_count = 0;
+}
+
+// sizes the frame slots for "fps" (the packets are only allocated when a slot is used for the first time)
+// must be called when the decoding job is not running
+static int _tdav_video_jb_slots_alloc(tdav_video_jb_t* self, int32_t fps)
+{
+	int32_t tail_max = TSK_MIN(((TSK_CLAMP(TDAV_VIDEO_JB_FPS_MIN, fps, TDAV_VIDEO_JB_FPS_MAX)) << TDAV_VIDEO_JB_TAIL_MAX_LOG2), TDAV_VIDEO_JB_TAIL_MAX);
+	int32_t slots_count = 1;
+	while(slots_count <= tail_max){
+		slots_count <<= 1;
+	}
+	if(self->slots_count == slots_count){
+		return 0;
+	}
+
+	_tdav_video_jb_slots_free(self);
+	if(!(self->slots = tsk_calloc(slots_count, sizeof(tdav_video_jb_slot_t)))
+		|| !(self->ready.items = tsk_calloc(slots_count, sizeof(int32_t)))
+		|| !(self->free.items = tsk_calloc(slots_count, sizeof(int32_t)))
+		|| !(self->pending = tsk_calloc(slots_count, sizeof(int32_t)))
+		|| !(self->spare = tsk_calloc(slots_count, sizeof(int32_t)))){
+		TSK_DEBUG_ERROR("Failed to allocate %d frame slots", slots_count);
+		_tdav_video_jb_slots_free(self);
+		return -1;
+	}
+	self->slots_count = slots_count;
+	self->ready.mask = self->free.mask = (uint32_t)(slots_count - 1);
+	TSK_DEBUG_INFO("Video jitter buffer: %d frame slots for fps=%d", slots_count, fps);
+	return 0;
+}
+
+// "tail_max" and "latency_max" for the current fps, limited by the number of frame slots
+static void _tdav_video_jb_update_tail(tdav_video_jb_t* self)
+{
+	self->tail_max = TSK_MIN((self->fps << TDAV_VIDEO_JB_TAIL_MAX_LOG2), TDAV_VIDEO_JB_TAIL_MAX);
+	if(self->slots_count && self->tail_max >= self->slots_count){
+		self->tail_max = (self->slots_count - 1);
+	}
+	self->latency_max = TSK_MAX((self->tail_max >> TDAV_VIDEO_JB_TAIL_MAX_LOG2), TDAV_VIDEO_JB_LATENCY_MIN);
+}
 
 static tsk_object_t* tdav_video_jb_ctor(tsk_object_t * self, va_list * app)
 {
 	tdav_video_jb_t *jb = self;
 	if(jb){
-		if(!(jb->frames = tsk_list_create())){
-			TSK_DEBUG_ERROR("Failed to create list");
-			return tsk_null;
-		}
-		if(!(jb->decode_thread_cond = tsk_condwait_create())){
-			TSK_DEBUG_ERROR("Failed to create condition var");
-			return tsk_null;
-		}
 		jb->cb_data_fdd.type = tdav_video_jb_cb_data_type_fdd;
 		jb->cb_data_rtp.type = tdav_video_jb_cb_data_type_rtp;
 
-		jb->decode_last_seq_num_with_mark = -1;
-
 		jb->fps = TDAV_VIDEO_JB_FPS_MAX;
 
 		jb->rate = TDAV_VIDEO_JB_RATE;
@@ -142,11 +293,10 @@ static tsk_object_t* tdav_video_jb_dtor(tsk_object_t * self)
 		if(jb->started){
 			tdav_video_jb_stop(jb);
 		}
-		TSK_OBJECT_SAFE_FREE(jb->frames);
+		_tdav_video_jb_slots_free(jb);
 		if(jb->decode_thread_cond){
 			tsk_condwait_destroy(&jb->decode_thread_cond);
 		}
-		TSK_SAFE_FREE(jb->buffer.ptr);
 		tsk_safeobj_deinit(jb);
 	}
 
@@ -195,6 +345,20 @@ int tdav_video_jb_set_callback(tdav_video_jb_t* self, tdav_video_jb_cb_f callbac
 	return 0;
 }
 
+/**
+* Sets the negotiated frame rate, used by the next call to tdav_video_jb_start() to size the frame slots.
+* The actual frame rate is still computed using the RTP timestamps.
+*/
+int tdav_video_jb_set_fps(tdav_video_jb_t* self, int32_t fps)
+{
+	if(!self || fps < 0){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	self->fps_neg = fps;
+	return 0;
+}
+
 int tdav_video_jb_start(tdav_video_jb_t* self)
 {
 	int ret = 0;
@@ -206,27 +370,226 @@ int tdav_video_jb_start(tdav_video_jb_t* self)
 		return 0;
 	}
 
-	self->started = tsk_true;
-
-	if(!self->decode_thread[0]){
-		ret = tsk_thread_create(&self->decode_thread[0], _tdav_video_jb_decode_thread_func, self);
-		if(ret != 0 || !self->decode_thread[0]){
+	tsk_safeobj_lock(self);
+	if((ret = _tdav_video_jb_slots_alloc(self, self->fps_neg ? self->fps_neg : TDAV_VIDEO_JB_FPS))){
+		tsk_safeobj_unlock(self);
+		return ret;
+	}
+	if(self->tail_max >= self->slots_count){
+		self->tail_max = (self->slots_count - 1);
+	}
+	_tdav_video_jb_reset(self);
+	self->decode_last_time = tsk_time_now();
+	if(!self->decode_stream && !(self->decode_stream = tdav_video_pool_stream_create())){
+		TSK_DEBUG_WARN("Failed to create video pool stream: decoding on a dedicated thread");
+		if(!self->decode_thread_cond && !(self->decode_thread_cond = tsk_condwait_create())){
+			TSK_DEBUG_ERROR("Failed to create condwait");
+			ret = -2;
+			goto bail;
+		}
+		self->started = tsk_true; // before the thread starts
+		if((ret = tsk_thread_create(&self->decode_thread[0], _tdav_video_jb_decode_thread_func, self)) != 0 || !self->decode_thread[0]){
 			TSK_DEBUG_ERROR("Failed to create new thread");
+			self->started = tsk_false;
+			ret = -3;
+			goto bail;
 		}
-		ret = tsk_thread_set_priority(self->decode_thread[0], TSK_THREAD_PRIORITY_TIME_CRITICAL);
+		tsk_thread_set_priority(self->decode_thread[0], TSK_THREAD_PRIORITY_TIME_CRITICAL);
 	}
+	else{
+		self->started = tsk_true;
+	}
+bail:
+	tsk_safeobj_unlock(self);
 	
 	return ret;
 }
 
+// finds a frame being assembled (newest first: most of the time the packet belongs to the last frame)
+static tdav_video_jb_slot_t* _tdav_video_jb_get_pending(tdav_video_jb_t* self, uint32_t timestamp, uint8_t pt)
+{
+	int32_t i;
+	for(i = self->pending_count - 1; i >= 0; --i){
+		tdav_video_jb_slot_t* slot = &self->slots[self->pending[i]];
+		if(slot->timestamp == timestamp && slot->payload_type == pt){
+			return slot;
+		}
+	}
+	return tsk_null;
+}
+
+// removes the oldest pending frame and gives it to the decoding job (publish) or keeps it for reuse (drop)
+static void _tdav_video_jb_pending_pop(tdav_video_jb_t* self, tsk_bool_t publish)
+{
+	int32_t index = self->pending[0];
+	memmove(&self->pending[0], &self->pending[1], (self->pending_count - 1) * sizeof(self->pending[0]));
+	if(publish){
+		self->decode_last_timestamp = self->slots[index].timestamp;
+		_tdav_video_jb_queue_push(&self->ready, index);
+	}
+	else{
+		self->slots[index].pkts_count = 0;
+		self->spare[self->spare_count++] = index;
+	}
+	--self->pending_count; // after the push: the frames count seen by the decoding job never goes lower than expected
+}
+
+// adds a packet to the frame (sorted by seq_num, duplicates ignored)
+static int _tdav_video_jb_slot_put(tdav_video_jb_slot_t* slot, const trtp_rtp_packet_t* rtp_pkt)
+{
+	tdav_video_jb_pkt_t* pkt;
+	tsk_size_t i, size;
+
+	// find the position: from the end as the packets are most likely in order
+	for(i = slot->pkts_count; i > 0; --i){
+		int16_t diff = (int16_t)(rtp_pkt->header->seq_num - slot->pkts[i - 1]->packet->header->seq_num);
+		if(diff == 0){
+			TSK_DEBUG_INFO("JB: Packet with seq_num=%hu duplicated", rtp_pkt->header->seq_num);
+			return 0;
+		}
+		if(diff > 0){
+			break;
+		}
+	}
+
+	if(slot->pkts_count == slot->pkts_max){
+		tsk_size_t j, pkts_max = slot->pkts_max ? (slot->pkts_max << 1) : TDAV_VIDEO_JB_SLOT_PKTS_COUNT;
+		tdav_video_jb_pkt_t** pkts;
+		if(!(pkts = tsk_realloc(slot->pkts, pkts_max * sizeof(tdav_video_jb_pkt_t*)))){
+			TSK_DEBUG_ERROR("Failed to allocate %u RTP packets", (unsigned)pkts_max);
+			return -1;
+		}
+		slot->pkts = pkts;
+		for(j = slot->pkts_max; j < pkts_max; ++j){
+			if(!(slot->pkts[j] = tsk_calloc(1, sizeof(tdav_video_jb_pkt_t)))){
+				TSK_DEBUG_ERROR("Failed to allocate RTP packet");
+				slot->pkts_max = j;
+				return -1;
+			}
+		}
+		slot->pkts_max = pkts_max;
+	}
+
+	// fill the spare packet at the end then move it to its position
+	pkt = slot->pkts[slot->pkts_count];
+	size = (rtp_pkt->extension.size + rtp_pkt->payload.size);
+	if(pkt->data_size < size){
+		uint8_t* data;
+		if(!(data = tsk_realloc(pkt->data, size))){
+			TSK_DEBUG_ERROR("Failed to allocate buffer with size = %u", (unsigned)size);
+			return -1;
+		}
+		pkt->data = data;
+		pkt->data_size = size;
+	}
+	if(trtp_rtp_packet_recycle(&pkt->packet) != 0){
+		return -1;
+	}
+	if(rtp_pkt->extension.size){
+		memcpy(pkt->data, rtp_pkt->extension.data ? rtp_pkt->extension.data : rtp_pkt->extension.data_const, rtp_pkt->extension.size);
+	}
+	if(rtp_pkt->payload.size){
+		memcpy(pkt->data + rtp_pkt->extension.size, rtp_pkt->payload.data ? rtp_pkt->payload.data : rtp_pkt->payload.data_const, rtp_pkt->payload.size);
+	}
+
+	// same as the views created by trtp_rtp_packet_deserialize_view(): callees must materialize() to keep it
+	trtp_rtp_header_copy(pkt->packet->header, rtp_pkt->header);
+	pkt->packet->is_view = tsk_true;
+	pkt->packet->extension.data_const = rtp_pkt->extension.size ? pkt->data : tsk_null;
+	pkt->packet->extension.size = rtp_pkt->extension.size;
+	pkt->packet->payload.data_const = (pkt->data + rtp_pkt->extension.size);
+	pkt->packet->payload.size = rtp_pkt->payload.size;
+
+	if(i < slot->pkts_count){
+		memmove(&slot->pkts[i + 1], &slot->pkts[i], (slot->pkts_count - i) * sizeof(tdav_video_jb_pkt_t*));
+		slot->pkts[i] = pkt;
+	}
+
+	++slot->pkts_count;
+	return 0;
+}
+
+/**
+Checks if the frame is complete (no gap/loss) or not.
+IMPORTANT: This function assume that the RTP packets use the marker bit to signal end of sequences.
+*/
+static tsk_bool_t _tdav_video_jb_slot_is_complete(const tdav_video_jb_slot_t* slot, int32_t last_seq_num_with_mark, int32_t* missing_seq_num_start, int32_t* missing_seq_num_count)
+{
+	tsk_size_t i;
+	const trtp_rtp_header_t* header;
+
+	for(i = 0; i < slot->pkts_count; ++i){
+		header = slot->pkts[i]->packet->header;
+		if(last_seq_num_with_mark >= 0 && header->seq_num != (uint16_t)(last_seq_num_with_mark + i + 1)){
+			*missing_seq_num_start = (uint16_t)(last_seq_num_with_mark + i + 1);
+			*missing_seq_num_count = (uint16_t)(header->seq_num - (*missing_seq_num_start));
+			return tsk_false;
+		}
+	}
+	if(slot->pkts_count){
+		header = slot->pkts[slot->pkts_count - 1]->packet->header;
+		if(header->marker){
+			return tsk_true;
+		}
+		*missing_seq_num_start = (uint16_t)(header->seq_num + 1);
+		*missing_seq_num_count = 1;
+	}
+	return tsk_false;
+}
+
+// publishes the oldest frames if they are complete or cannot wait anymore
+static void _tdav_video_jb_publish(tdav_video_jb_t* self)
+{
+	int32_t missing_seq_num_start = 0, missing_seq_num_count = 0;
+
+	while(self->pending_count > 0){
+		const tdav_video_jb_slot_t* slot = &self->slots[self->pending[0]];
+		tsk_bool_t is_complete = _tdav_video_jb_slot_is_complete(slot, self->decode_last_seq_num_with_mark, &missing_seq_num_start, &missing_seq_num_count);
+		if(!is_complete){
+			// is it still acceptable to wait for missing packets?
+			if(_tdav_video_jb_frames_count(self) < (int64_t)self->latency_max){
+				self->decode_missing_ssrc = slot->ssrc;
+				self->decode_missing = ((uint32_t)(missing_seq_num_start & 0xFFFF) << 16) | (uint32_t)(missing_seq_num_count & 0xFFFF);
+				return;
+			}
+			TSK_DEBUG_INFO("frames_count(%lld)>=latency_max(%u)...decoding video frame even if pkts are missing :(", _tdav_video_jb_frames_count(self), (unsigned)self->latency_max);
+		}
+		self->decode_last_seq_num_with_mark = (slot->pkts_count && slot->pkts[slot->pkts_count - 1]->packet->header->marker) 
+			? slot->pkts[slot->pkts_count - 1]->packet->header->seq_num 
+			: -1; // unset()
+		_tdav_video_jb_pending_pop(self, tsk_true);
+	}
+	self->decode_missing = 0;
+}
+
+// posts the decoding job on the video pool or wakes up the decoding thread
+static int _tdav_video_jb_decode_post(tdav_video_jb_t* self, uint64_t delay)
+{
+	if(self->decode_stream){
+		return tdav_video_pool_post(self->decode_stream, tdav_video_pool_stage_decode, _tdav_video_jb_decode_job, self, delay);
+	}
+	self->decode_thread_due = tsk_time_now() + delay;
+	return tsk_condwait_signal(self->decode_thread_cond);
+}
+
+// posts the decoding job unless already pending or running
+static void _tdav_video_jb_decode_schedule(tdav_video_jb_t* self, uint64_t delay)
+{
+	if(tsk_atomic_cas(&self->decode_scheduled, 0, 1)){
+		if(_tdav_video_jb_decode_post(self, delay) != 0){
+			self->decode_scheduled = 0;
+		}
+	}
+}
+
 int tdav_video_jb_put(tdav_video_jb_t* self, trtp_rtp_packet_t* rtp_pkt)
 {
 #if TDAV_VIDEO_JB_DISABLE
     self->cb_data_rtp.rtp.pkt = rtp_pkt;
     self->callback(&self->cb_data_rtp);
 #else
-	const tdav_video_frame_t* old_frame;
-	tsk_bool_t pt_matched = tsk_false, is_frame_late_or_dup = tsk_false, is_restarted = tsk_false;
+	tdav_video_jb_slot_t* slot;
+	tsk_bool_t is_frame_late_or_dup = tsk_false, is_restarted = tsk_false;
 	uint16_t* seq_num;
 
 	if(!self || !rtp_pkt || !rtp_pkt->header){
@@ -241,7 +604,7 @@ int tdav_video_jb_put(tdav_video_jb_t* self, trtp_rtp_packet_t* rtp_pkt)
 
 	seq_num = &self->seq_nums[rtp_pkt->header->payload_type];
 
-	tsk_safeobj_lock(self);
+	tsk_safeobj_lock(self); // against start() and stop(), never locked by the decoding job
 
 	//TSK_DEBUG_INFO("receive seqnum=%u", rtp_pkt->header->seq_num);
 
@@ -253,7 +616,7 @@ int tdav_video_jb_put(tdav_video_jb_t* self, trtp_rtp_packet_t* rtp_pkt)
 		}
 	}
 
-	old_frame = _tdav_video_jb_get_frame(self, rtp_pkt->header->timestamp, rtp_pkt->header->payload_type, &pt_matched);	
+	slot = _tdav_video_jb_get_pending(self, rtp_pkt->header->timestamp, rtp_pkt->header->payload_type);
 
 	if((*seq_num && *seq_num != 0xFFFF) && (*seq_num + 1) != rtp_pkt->header->seq_num){
 		int32_t diff = ((int32_t)rtp_pkt->header->seq_num - (int32_t)*seq_num);
@@ -274,53 +637,67 @@ int tdav_video_jb_put(tdav_video_jb_t* self, trtp_rtp_packet_t* rtp_pkt)
 		}
 	}
 
-	if(!old_frame){
-		tdav_video_frame_t* new_frame;
-		if(pt_matched){
-			// if we have a frame with the same payload type but without this timestamp this means that we moved to a new frame
-			// this happens if the frame is waiting to be decoded or the marker is lost
+	if(!slot){
+		int32_t index, i;
+
+		// compute avg frame duration
+		if(self->last_timestamp && self->last_timestamp < rtp_pkt->header->timestamp){
+			uint32_t duration = (rtp_pkt->header->timestamp - self->last_timestamp)/self->rate;
+			self->avg_duration = self->avg_duration ? ((self->avg_duration + duration) >> 1) : duration;
+			--self->fps_prob;
 		}
-		if((new_frame = tdav_video_frame_create(rtp_pkt))){
-			// compute avg frame duration
-			if(self->last_timestamp && self->last_timestamp < rtp_pkt->header->timestamp){
-				uint32_t duration = (rtp_pkt->header->timestamp - self->last_timestamp)/self->rate;
-				self->avg_duration = self->avg_duration ? ((self->avg_duration + duration) >> 1) : duration;
-				--self->fps_prob;
-			}
-			self->last_timestamp = rtp_pkt->header->timestamp;
-			
-			tsk_list_lock(self->frames);
-			if(self->frames_count >= self->tail_max){
-				if(++self->conseq_frame_drop >= self->tail_max){
-					TSK_DEBUG_ERROR("Too many frames dropped and fps=%d", self->fps);
-					tsk_list_clear_items(self->frames);
-					self->conseq_frame_drop = 0;
-					self->frames_count = 1;
-					if(self->callback){
-						self->cb_data_any.type = tdav_video_jb_cb_data_type_tmfr;
-						self->cb_data_any.ssrc = rtp_pkt->header->ssrc;
-						self->callback(&self->cb_data_any);
-					}
+		self->last_timestamp = rtp_pkt->header->timestamp;
+
+		if(_tdav_video_jb_frames_count(self) >= self->tail_max){
+			if(++self->conseq_frame_drop >= self->tail_max){
+				TSK_DEBUG_ERROR("Too many frames dropped and fps=%d", self->fps);
+				while(self->pending_count > 0){
+					_tdav_video_jb_pending_pop(self, tsk_false);
 				}
-				else{
-					TSK_DEBUG_INFO("Dropping video frame because frames_count(%lld)>=tail_max(%d)", self->frames_count, self->tail_max);
-					tsk_list_remove_first_item(self->frames);
+				self->flush_requested = tsk_true; // the published frames are dropped by the decoding job
+				self->conseq_frame_drop = 0;
+				self->decode_last_seq_num_with_mark = -1;
+				if(self->callback){
+					self->cb_data_any.type = tdav_video_jb_cb_data_type_tmfr;
+					self->cb_data_any.ssrc = rtp_pkt->header->ssrc;
+					self->callback(&self->cb_data_any);
 				}
-				tdav_video_jb_reset_fps_prob(self);
 			}
-			else{
-				++self->frames_count;
+			else if(self->pending_count > 0){
+				TSK_DEBUG_INFO("Dropping video frame because frames_count(%lld)>=tail_max(%d)", _tdav_video_jb_frames_count(self), self->tail_max);
+				_tdav_video_jb_pending_pop(self, tsk_false);
 			}
-			tsk_list_push_ascending_data(self->frames, (void**)&new_frame);
-			tsk_list_unlock(self->frames);
+			tdav_video_jb_reset_fps_prob(self);
+		}
+
+		if(self->spare_count > 0){
+			index = self->spare[--self->spare_count];
+		}
+		else{
+			index = _tdav_video_jb_queue_pop(&self->free);
 		}
+		if(index < 0){
+			TSK_DEBUG_INFO("Dropping RTP packet: no free frame slot (decoding too slow)");
+		}
+		else{
+			slot = &self->slots[index];
+			slot->payload_type = rtp_pkt->header->payload_type;
+			slot->timestamp = rtp_pkt->header->timestamp;
+			slot->ssrc = rtp_pkt->header->ssrc;
+			slot->pkts_count = 0;
+			// sorted by timestamp: most of the time appended
+			for(i = self->pending_count; i > 0 && (int32_t)(self->slots[self->pending[i - 1]].timestamp - slot->timestamp) > 0; --i) ;
+			memmove(&self->pending[i + 1], &self->pending[i], (self->pending_count - i) * sizeof(self->pending[0]));
+			self->pending[i] = index;
+			++self->pending_count;
+		}
+
 		if(self->fps_prob <= 0 && self->avg_duration){
 			// compute FPS using timestamp values
 			int32_t fps_new = (1000 / self->avg_duration);
 			int32_t fps_old = self->fps;
 			self->fps = TSK_CLAMP(TDAV_VIDEO_JB_FPS_MIN, fps_new, TDAV_VIDEO_JB_FPS_MAX);
-			self->tail_max = (self->fps << TDAV_VIDEO_JB_TAIL_MAX_LOG2); // maximum delay = 2 seconds
-			self->latency_max = self->fps; // maximum = 1 second
+			_tdav_video_jb_update_tail(self); // maximum delay = 2 seconds, latency = 1 second (less if the frame slots were sized for a lower fps)
 			TSK_DEBUG_INFO("According to rtp-timestamps ...FPS = %d (clipped to %d) tail_max=%d, latency_max=%u", fps_new, self->fps, self->tail_max, self->latency_max);
 			tdav_video_jb_reset_fps_prob(self);
 			if(self->callback && (fps_old != self->fps)){
@@ -332,8 +709,14 @@ int tdav_video_jb_put(tdav_video_jb_t* self, trtp_rtp_packet_t* rtp_pkt)
 			}
 		}
 	}
-	else{
-		tdav_video_frame_put((tdav_video_frame_t*)old_frame, rtp_pkt);
+
+	if(slot){
+		_tdav_video_jb_slot_put(slot, rtp_pkt);
+		_tdav_video_jb_publish(self);
+	}
+
+	if(_tdav_video_jb_decode_pending(self)){
+		_tdav_video_jb_decode_schedule(self, 0);
 	}
 
 	tsk_safeobj_unlock(self);
@@ -361,177 +744,131 @@ int tdav_video_jb_stop(tdav_video_jb_t* self)
 
 	self->started = tsk_false;
 
-	ret = tsk_condwait_broadcast(self->decode_thread_cond);
-	
-	if(self->decode_thread[0]){
-		ret = tsk_thread_join(&self->decode_thread[0]);
+	tsk_safeobj_lock(self);
+	if(self->decode_stream){
+		ret = tdav_video_pool_stream_close(self->decode_stream);
+		TSK_OBJECT_SAFE_FREE(self->decode_stream);
 	}
-	
-	return ret;
-}
-
-static const tdav_video_frame_t* _tdav_video_jb_get_frame(tdav_video_jb_t* self, uint32_t timestamp, uint8_t pt, tsk_bool_t *pt_matched)
-{
-	const tdav_video_frame_t* ret = tsk_null;
-	const tsk_list_item_t *item;
-	
-	*pt_matched =tsk_false;
-
-	tsk_list_lock(self->frames);
-	tsk_list_foreach(item, self->frames){
-		if(TDAV_VIDEO_FRAME(item->data)->payload_type == pt){
-			if(!(*pt_matched)) *pt_matched = tsk_true;
-			if(TDAV_VIDEO_FRAME(item->data)->timestamp == timestamp){
-				ret = item->data;
-				break;
-			}
+	else{
+		ret = tsk_condwait_broadcast(self->decode_thread_cond);
+		if(self->decode_thread[0]){
+			ret = tsk_thread_join(&self->decode_thread[0]);
 		}
-		
 	}
-	tsk_list_unlock(self->frames);
-
+	tsk_safeobj_unlock(self);
+	
 	return ret;
 }
 
-static void* TSK_STDCALL _tdav_video_jb_decode_thread_func(void *arg)
+static int _tdav_video_jb_decode_job(const void* arg)
 {
 	tdav_video_jb_t* jb = (tdav_video_jb_t*)arg;
-	//uint64_t delay;
-	int32_t missing_seq_num_start = 0, prev_missing_seq_num_start = 0;
-	int32_t missing_seq_num_count = 0, prev_lasted_missing_seq_num_count = 0;
-	const tdav_video_frame_t* frame;
-	tsk_list_item_t* item;
+	uint32_t missing;
+	int32_t index;
 	uint64_t next_decode_duration = 0, now, _now;
-	//uint64_t x_decode_duration = (1000 / jb->fps); // expected
-	//uint64_t x_decode_time = tsk_time_now();//expected
-	tsk_bool_t postpone, cleaning_delay = tsk_false;
-	static const uint64_t __toomuch_delay_to_be_valid = 10000; // guard against systems with buggy "tsk_time_now()" -Won't say Windows ...but :)-
-
-	jb->decode_last_seq_num_with_mark = -1; // -1 -> unset
-	jb->decode_last_time = tsk_time_now();
 
-	(void)(now);
-	//(void)(delay);
-	
-	TSK_DEBUG_INFO("Video jitter buffer thread - ENTER");
+	if(!jb->started){
+		return 0;
+	}
 
-	while(jb->started){
-		now = tsk_time_now();
-		if (next_decode_duration > 0) {
-			tsk_condwait_timedwait(jb->decode_thread_cond, next_decode_duration);
-		}
+	now = tsk_time_now();
 
-		if(!jb->started){
-			break;
+	if(jb->flush_requested){
+		while((index = _tdav_video_jb_queue_pop(&jb->ready)) >= 0){
+			_tdav_video_jb_queue_push(&jb->free, index);
 		}
+		jb->flush_requested = tsk_false;
+	}
 
-		// TSK_DEBUG_INFO("Frames count = %d", jb->frames_count);
-
-		if(jb->frames_count >= (int64_t)jb->latency_min){
-			item = tsk_null;
-			postpone = tsk_false;
-            
-			tsk_safeobj_lock(jb); // against get_frame()
-			tsk_list_lock(jb->frames); // against put()
-			
-			// is it still acceptable to wait for missing packets?
-			if (jb->frames_count < (int64_t)jb->latency_max){
-				frame = (const tdav_video_frame_t*)jb->frames->head->data;
-				if(!tdav_video_frame_is_complete(frame, jb->decode_last_seq_num_with_mark, &missing_seq_num_start, &missing_seq_num_count)){
-					TSK_DEBUG_INFO("Time to decode frame...but some RTP packets are missing (missing_seq_num_start=%d, missing_seq_num_count=%d, last_seq_num_with_mark=%d). Postpone :(", missing_seq_num_start, missing_seq_num_count, jb->decode_last_seq_num_with_mark);
-					// signal to the session that a sequence number is missing (will send a NACK)
-					// the missing seqnum has been already requested in jb_put() and here we request it again only ONE time
-					if(jb->callback){
-						if(prev_missing_seq_num_start != missing_seq_num_start || prev_lasted_missing_seq_num_count != missing_seq_num_count){ // guard to request it only once
-							jb->cb_data_any.type = tdav_video_jb_cb_data_type_fl;
-							jb->cb_data_any.ssrc = frame->ssrc;
-							jb->cb_data_any.fl.seq_num = prev_missing_seq_num_start = missing_seq_num_start;
-							jb->cb_data_any.fl.count = prev_lasted_missing_seq_num_count = missing_seq_num_count;
-							jb->callback(&jb->cb_data_any);
-						}
-						postpone = tsk_true;
+	// TSK_DEBUG_INFO("Frames count = %lld", _tdav_video_jb_frames_count(jb));
+
+	if(_tdav_video_jb_frames_count(jb) >= (int64_t)jb->latency_min){
+		if((index = _tdav_video_jb_queue_pop(&jb->ready)) >= 0){
+			const tdav_video_jb_slot_t* slot = &jb->slots[index];
+			if(jb->callback){
+				const trtp_rtp_packet_t* pkt;
+				tsk_size_t i;
+				for(i = 0; i < slot->pkts_count && jb->started; ++i){
+					pkt = slot->pkts[i]->packet;
+					if(!pkt->payload.size){
+						TSK_DEBUG_ERROR("Skipping invalid rtp packet (do not decode!)");
+						continue;
 					}
+					jb->cb_data_rtp.rtp.pkt = pkt;
+					jb->callback(&jb->cb_data_rtp);
 				}
 			}
-			else{
-				TSK_DEBUG_INFO("frames_count(%lld)>=latency_max(%u)...decoding video frame even if pkts are missing :(", jb->frames_count, jb->latency_max);
-				jb->decode_last_seq_num_with_mark = -1; // unset()
+			_tdav_video_jb_queue_push(&jb->free, index);
+			jb->decode_prev_missing = 0;
+		}
+		else if((missing = jb->decode_missing) && missing != jb->decode_prev_missing){
+			// Time to decode frame...but some RTP packets are missing. Postpone :(
+			// signal to the session that a sequence number is missing (will send a NACK)
+			// the missing seqnum has been already requested in jb_put() and here we request it again only ONE time
+			TSK_DEBUG_INFO("Time to decode frame...but some RTP packets are missing (missing_seq_num_start=%u, missing_seq_num_count=%u). Postpone :(", (missing >> 16), (missing & 0xFFFF));
+			if(jb->callback){
+				jb->cb_data_any.type = tdav_video_jb_cb_data_type_fl;
+				jb->cb_data_any.ssrc = jb->decode_missing_ssrc;
+				jb->cb_data_any.fl.seq_num = (uint16_t)(missing >> 16);
+				jb->cb_data_any.fl.count = (missing & 0xFFFF);
+				jb->callback(&jb->cb_data_any);
 			}
-			if(!postpone){
-				item = tsk_list_pop_first_item(jb->frames);
-				--jb->frames_count;
+			jb->decode_prev_missing = missing;
+		}
+	}
+	
+	if (jb->decode_cleaning_delay || _tdav_video_jb_frames_count(jb) > (int64_t)jb->latency_max){
+		next_decode_duration = 0;
+		jb->decode_cleaning_delay = ((_tdav_video_jb_frames_count(jb) << 1) > (int64_t)jb->latency_max); // cleanup up2 half
+	}
+	else{
+		next_decode_duration = (1000 / jb->fps);
+		_now = tsk_time_now();
+		if (_now > now) {
+			if ((_now - now) > next_decode_duration){
+				next_decode_duration = 0;
 			}
-			tsk_list_unlock(jb->frames);
-			tsk_safeobj_unlock(jb);
-            
-			if(item){
-				jb->decode_last_timestamp = ((const tdav_video_frame_t*)item->data)->timestamp;
-				if(jb->callback){
-					trtp_rtp_packet_t* pkt;
-					const tsk_list_item_t* _item = item; // save memory address as "tsk_list_foreach() will change it for each loop"
-					int32_t last_seq_num = -1; // guard against duplicated packets
-					frame = _item->data;
-					tsk_list_foreach(_item, frame->pkts){
-						if(!(pkt = _item->data) || !pkt->payload.size || !pkt->header || pkt->header->seq_num == last_seq_num || !jb->started){
-							TSK_DEBUG_ERROR("Skipping invalid rtp packet (do not decode!)");
-							continue;
-						}					
-						jb->cb_data_rtp.rtp.pkt = pkt;
-						jb->callback(&jb->cb_data_rtp);
-						if(pkt->header->marker){
-							jb->decode_last_seq_num_with_mark = pkt->header->seq_num;
-						}
-					}
-				}
-	            
-				TSK_OBJECT_SAFE_FREE(item);
+			else {
+				next_decode_duration -= (_now - now);
 			}
 		}
-		
-#if 1
-		if (cleaning_delay || jb->frames_count > (int64_t)jb->latency_max){
-			//x_decode_time = now;
-			next_decode_duration = 0;
-			cleaning_delay = ((jb->frames_count << 1) > (int64_t)jb->latency_max); // cleanup up2 half
+	}
+
+	// keep the pace while there are published frames, otherwise wait for put()
+	if(jb->started && _tdav_video_jb_queue_count(&jb->ready)){
+		if(_tdav_video_jb_decode_post(jb, next_decode_duration) != 0){
+			jb->decode_scheduled = 0;
 		}
-		else{
-			next_decode_duration = (1000 / jb->fps);
-			_now = tsk_time_now();
-			if (_now > now) {
-				if ((_now - now) > next_decode_duration){
-					next_decode_duration = 0;
-				}
-				else {
-					next_decode_duration -= (_now - now);
-				}
-			}
-			//delay = ( (now > x_decode_time) ? (now - x_decode_time) : (x_decode_duration >> 1)/* do not use zero to avoid endless loop when there is no frame to display */ );
-			//next_decode_duration = (delay > x_decode_duration) ? 0 : (x_decode_duration - delay);
-			//x_decode_duration = (1000 / jb->fps);
-			//x_decode_time += x_decode_duration;
-		}
-		//delay = /*(now - x_decode_time);*/(now > x_decode_time) ? (now - x_decode_time) : ( (jb->frames_count >= jb->latency_max) ? 0 : (x_decode_duration >> 1) )/* do not use zero to avoid endless loop when there is no frame to display */;
-		// delay = (jb->frames_count > jb->latency_max) ? 0 : ( (now > x_decode_time) ? (now - x_decode_time) : (x_decode_duration >> 1)/* do not use zero to avoid endless loop when there is no frame to display */ );
-		// comparison used as guard against time wrapping
-		/*if(delay > __toomuch_delay_to_be_valid){
-			TSK_DEBUG_INFO("Too much delay (%llu) in video jb. Reseting...", delay);
-			x_decode_time = now;
-			next_decode_duration = 0;
-		}
-		else*/{
-			//next_decode_duration = (delay > x_decode_duration) ? 0 : (x_decode_duration - delay);
-			//x_decode_duration = (1000 / jb->fps);
-			//x_decode_time += x_decode_duration;
+	}
+	else{
+		jb->decode_scheduled = 0;
+		tsk_atomic_barrier(); // put() could have published a frame before seeing the flag cleared
+		if(jb->started && _tdav_video_jb_decode_pending(jb)){
+			_tdav_video_jb_decode_schedule(jb, next_decode_duration);
 		}
-		
+	}
 
-		//TSK_DEBUG_INFO("next_decode_timeout=%llu, delay = %llu", next_decode_duration, delay);
-#else
-		next_decode_duration = (1000 / jb->fps);
-#endif
+	return 0;
+}
+
+static void* TSK_STDCALL _tdav_video_jb_decode_thread_func(void *arg)
+{
+	tdav_video_jb_t* jb = (tdav_video_jb_t*)arg;
+	uint64_t now, due;
+
+	TSK_DEBUG_INFO("Video jitter buffer thread - ENTER");
+
+	while(jb->started){
+		now = tsk_time_now();
+		due = jb->decode_thread_due;
+		if(jb->decode_scheduled && due <= now){
+			_tdav_video_jb_decode_job(jb);
+		}
+		else{
+			tsk_condwait_timedwait(jb->decode_thread_cond, jb->decode_scheduled ? TSK_MIN((due - now), TDAV_VIDEO_JB_DECODE_WAIT_MAX) : TDAV_VIDEO_JB_DECODE_WAIT_MAX);
+		}
 	}
 
 	TSK_DEBUG_INFO("Video jitter buffer thread - EXIT");
-
 	return tsk_null;
 }
@@ -26,6 +26,7 @@
  */
 #include "tinydav/video/tdav_session_video.h"
 #include "tinydav/video/tdav_converter_video.h"
+#include "tinydav/video/tdav_video_pool.h"
 #include "tinydav/video/jb/tdav_video_jb.h"
 #include "tinydav/codecs/fec/tdav_codec_red.h"
 #include "tinydav/codecs/fec/tdav_codec_ulpfec.h"
@@ -73,6 +74,9 @@
 // The maximum number of pakcet loss allowed
 #define TDAV_SESSION_VIDEO_PKT_LOSS_MAX_COUNT_TO_REQUEST_FIR	50
 
+// Time (millis) added to twice the RTT to decide for how long the sent packets must be kept
+#define TDAV_SESSION_VIDEO_AVPF_RTT_MARGIN		100
+
 static const tmedia_codec_action_t __action_encode_idr = tmedia_codec_action_encode_idr;
 static const tmedia_codec_action_t __action_encode_bw_up = tmedia_codec_action_bw_up;
 static const tmedia_codec_action_t __action_encode_bw_down = tmedia_codec_action_bw_down;
@@ -138,6 +142,10 @@ static int _tdav_session_video_jb_cb(const tdav_video_jb_cb_data_xt* data);
 static int _tdav_session_video_open_decoder(tdav_session_video_t* self, uint8_t payload_type);
 static int _tdav_session_video_decode(tdav_session_video_t* self, const trtp_rtp_packet_t* packet);
 static int _tdav_session_video_set_callbacks(tmedia_session_t* self);
+static int _tdav_session_video_avpf_store(tdav_session_video_t* self, uint16_t seq_num, const void* data, tsk_size_t size);
+static tsk_size_t _tdav_session_video_avpf_resend(tdav_session_video_t* self, uint16_t pid, uint16_t blp);
+static void _tdav_session_video_avpf_update_rtt(tdav_session_video_t* self, const trtp_rtcp_rblock_t* block);
+static void _tdav_session_video_avpf_clear(tdav_session_video_t* self);
 
 // Codec callback (From codec to the network)
 // or Producer callback to sendRaw() data "as is"
@@ -231,32 +239,8 @@ static int tdav_session_video_raw_cb(const tmedia_video_encode_result_xt* result
 			rtp_hdr_size = TRTP_RTP_HEADER_MIN_SIZE + (packet->header->csrc_count << 2);
 			// Save packet
 			if(base->avpf_mode_neg){
-				trtp_rtp_packet_t* packet_avpf = tsk_object_ref(packet);
-				// when SRTP is used, "serial_buffer" will contains the encoded buffer with both RTP header and payload
-				// Hack the RTP packet payload to point to the the SRTP data instead of unencrypted ptr
-				packet_avpf->payload.size = (s - rtp_hdr_size);
-				packet_avpf->payload.data_const = tsk_null;
-				if(!(packet_avpf->payload.data = tsk_malloc(packet_avpf->payload.size))){// FIXME: to be optimized (reuse memory address)
-					TSK_DEBUG_ERROR("failed to allocate buffer");
-					goto bail;
-				}
-				memcpy(packet_avpf->payload.data, (((const uint8_t*)base->rtp_manager->rtp.serial_buffer.ptr) + rtp_hdr_size), packet_avpf->payload.size);
-				tsk_list_lock(video->avpf.packets);
-				if(video->avpf.count > video->avpf.max){
-					tsk_list_remove_first_item(video->avpf.packets);
-				}
-				else{
-					++video->avpf.count;
-				}
-
-				// The packet must not added 'ascending' but 'back' because the sequence number coult wrap
-				// For example:
-				//	- send(65533, 65534, 65535, 0, 1)
-				//  - will be stored as (if added 'ascending'): 0, 1, 65533, 65534, 65535
-				//  - this means there is no benefit (if added 'ascending') as we cannot make 'smart search' using seqnums
-				// tsk_list_push_ascending_data(video->avpf.packets, (void**)&packet_avpf); // filtered per seqnum
-				tsk_list_push_back_data(video->avpf.packets, (void**)&packet_avpf);
-				tsk_list_unlock(video->avpf.packets);
+				// when SRTP is used, "serial_buffer" contains the encrypted packet: saved "as is" to be resent without any processing
+				_tdav_session_video_avpf_store(video, packet->header->seq_num, base->rtp_manager->rtp.serial_buffer.ptr, s);
 			}
 
 			// Send FEC packet
@@ -342,12 +326,135 @@ static int tdav_session_video_decode_cb(const tmedia_video_decode_result_xt* res
 	return 0;
 }
 
+#define PRODUCER_OUTPUT_FIXSIZE (base->producer->video.chroma != tmedia_chroma_mjpeg) // whether the output data has a fixed size/length
+#define PRODUCER_OUTPUT_RAW (base->producer->encoder.codec_id == tmedia_codec_id_none) // Otherwise, frames from the producer are already encoded
+#define PRODUCER_SIZE_CHANGED ((video->conv.producerWidth && video->conv.producerWidth != base->producer->video.width) || (video->conv.producerHeight && video->conv.producerHeight != base->producer->video.height) \
+|| (video->conv.xProducerSize && (video->conv.xProducerSize != size && PRODUCER_OUTPUT_FIXSIZE)))
+#define ENCODED_NEED_FLIP (TMEDIA_CODEC_VIDEO(video->encoder.codec)->out.flip)
+#define ENCODED_NEED_RESIZE (base->producer->video.width != TMEDIA_CODEC_VIDEO(video->encoder.codec)->out.width || base->producer->video.height != TMEDIA_CODEC_VIDEO(video->encoder.codec)->out.height)
+#define PRODUCED_FRAME_NEED_ROTATION (base->producer->video.rotation != 0)
+#define PRODUCED_FRAME_NEED_MIRROR (base->producer->video.mirror != tsk_false)
+#define PRODUCED_FRAME_NEED_CHROMA_CONVERSION (base->producer->video.chroma != TMEDIA_CODEC_VIDEO(video->encoder.codec)->out.chroma)
+
+// Converts a frame from the producer to YUV420P if needed ("encoder.yuv420p_size" is zero when not converted)
+static int _tdav_session_video_convert(tdav_session_video_t* video, const void* buffer, tsk_size_t size)
+{
+	tdav_session_av_t* base = (tdav_session_av_t*)video;
+	int ret = 0;
+
+	video->encoder.yuv420p_size = 0;
+	if(!video->encoder.codec){
+		return 0;
+	}
+
+	// Video codecs only accept YUV420P buffers ==> do conversion if needed or producer doesn't have the right size
+	if (PRODUCER_OUTPUT_RAW && (PRODUCED_FRAME_NEED_CHROMA_CONVERSION || PRODUCER_SIZE_CHANGED || ENCODED_NEED_FLIP || ENCODED_NEED_RESIZE ||PRODUCED_FRAME_NEED_ROTATION || PRODUCED_FRAME_NEED_MIRROR)) {
+		// Create video converter if not already done or producer size have changed
+		if(!video->conv.toYUV420 || PRODUCER_SIZE_CHANGED){
+			TSK_OBJECT_SAFE_FREE(video->conv.toYUV420);
+			video->conv.producerWidth = base->producer->video.width;
+			video->conv.producerHeight = base->producer->video.height;
+			video->conv.xProducerSize = size;
+			
+			TSK_DEBUG_INFO("producer size = (%d, %d)", base->producer->video.width, base->producer->video.height);
+			if(!(video->conv.toYUV420 = tmedia_converter_video_create(base->producer->video.width, base->producer->video.height, base->producer->video.chroma, TMEDIA_CODEC_VIDEO(video->encoder.codec)->out.width, TMEDIA_CODEC_VIDEO(video->encoder.codec)->out.height,
+				TMEDIA_CODEC_VIDEO(video->encoder.codec)->out.chroma))){
+				TSK_DEBUG_ERROR("Failed to create video converter");
+				ret = -5;
+				goto bail;
+			}
+                // restore/set rotation scaling info because producer size could change
+                tmedia_converter_video_set_scale_rotated_frames(video->conv.toYUV420, video->encoder.scale_rotated_frames);
+		}
+	}
+
+	if(video->conv.toYUV420){
+		video->encoder.scale_rotated_frames = video->conv.toYUV420->scale_rotated_frames;
+		// check if rotation have changed and alert the codec
+		// we avoid scalling the frame after rotation because it's CPU intensive and keeping the image ratio is difficult
+		// it's up to the encoder to swap (w,h) and to track the rotation value
+		if(video->encoder.rotation != base->producer->video.rotation){
+			tmedia_param_t* param = tmedia_param_create(tmedia_pat_set,
+											tmedia_video, 
+											tmedia_ppt_codec, 
+											tmedia_pvt_int32,
+											"rotation",
+											(void*)&base->producer->video.rotation);
+			if(!param){
+				TSK_DEBUG_ERROR("Failed to create a media parameter");
+				return -1;
+			}
+			video->encoder.rotation = base->producer->video.rotation; // update rotation to avoid calling the function several times
+			ret = tmedia_codec_set(video->encoder.codec, param);
+			TSK_OBJECT_SAFE_FREE(param);
+			// (ret != 0) -> not supported by the codec -> to be done by the converter
+			video->encoder.scale_rotated_frames = (ret != 0);
+			ret = 0;
+		}
+
+		// update one-shot parameters
+		tmedia_converter_video_set(video->conv.toYUV420, base->producer->video.rotation, TMEDIA_CODEC_VIDEO(video->encoder.codec)->out.flip, base->producer->video.mirror, video->encoder.scale_rotated_frames);
+		
+		video->encoder.yuv420p_size = tmedia_converter_video_process(video->conv.toYUV420, buffer, size, &video->encoder.conv_buffer, &video->encoder.conv_buffer_size);
+		if(!video->encoder.yuv420p_size || !video->encoder.conv_buffer){
+			TSK_DEBUG_ERROR("Failed to convert XXX buffer to YUV42P");
+			ret = -6;
+			goto bail;
+		}
+	}
+
+bail:
+	return ret;
+}
+
+// Encodes a frame (from the producer or converted to YUV420P) then sends the result
+static int _tdav_session_video_encode(tdav_session_video_t* video, const void* buffer, tsk_size_t size)
+{
+	tdav_session_av_t* base = (tdav_session_av_t*)video;
+	tsk_size_t out_size = 0;
+
+	tsk_mutex_lock(video->encoder.h_mutex);
+	if(video->encoder.codec){ // codec is destroyed by stop() which use same mutex
+		out_size = video->encoder.codec->plugin->encode(video->encoder.codec, buffer, size, &video->encoder.buffer, &video->encoder.buffer_size);
+	}
+	tsk_mutex_unlock(video->encoder.h_mutex);
+
+	if(out_size && base->rtp_manager){
+		/* Never called, see tdav_session_video_raw_cb() */
+		trtp_manager_send_rtp(base->rtp_manager, video->encoder.buffer, out_size, 6006, tsk_true, tsk_true);
+	}
+	return 0;
+}
+
+// Video pool job: takes the latest frame from the producer (the ones received in between were skipped)
+static int _tdav_session_video_encode_job(const void* callback_data)
+{
+	tdav_session_video_t* video = (tdav_session_video_t*)callback_data;
+	void* buffer;
+	tsk_size_t buffer_size;
+
+	tsk_mutex_lock(video->encoder.pending.h_mutex);
+	buffer = video->encoder.pending.buffer, buffer_size = video->encoder.pending.buffer_size;
+	video->encoder.pending.buffer = video->encoder.pending.work_buffer, video->encoder.pending.buffer_size = video->encoder.pending.work_buffer_size;
+	video->encoder.pending.work_buffer = buffer, video->encoder.pending.work_buffer_size = buffer_size;
+	video->encoder.pending.work_size = video->encoder.pending.size;
+	video->encoder.pending.size = 0;
+	video->encoder.pending.posted = tsk_false;
+	tsk_mutex_unlock(video->encoder.pending.h_mutex);
+
+	if(video->started && video->encoder.pending.work_size){
+		_tdav_session_video_encode(video, video->encoder.pending.work_buffer, video->encoder.pending.work_size);
+	}
+	return 0;
+}
+
 // Producer callback (From the producer to the network) => encode data before send()
+// The frame is converted (or copied when already in the right format) into a buffer handed over to the video pool where it's
+// encoded: a single copy per frame. When the pool is late, only the latest frame is kept.
 static int tdav_session_video_producer_enc_cb(const void* callback_data, const void* buffer, tsk_size_t size)
 {
 	tdav_session_video_t* video = (tdav_session_video_t*)callback_data;
 	tdav_session_av_t* base = (tdav_session_av_t*)callback_data;
-	tsk_size_t yuv420p_size = 0;
 	int ret = 0;
 
 	if(!base){
@@ -382,99 +489,53 @@ static int tdav_session_video_producer_enc_cb(const void* callback_data, const v
 	}
 
 	if(base->rtp_manager){
-		//static int __rotation_counter = 0;
-		/* encode */
-		tsk_size_t out_size = 0;
-
 		if(!base->rtp_manager->is_started){
 			TSK_DEBUG_ERROR("Not started");
 			return 0;
 		}
 
-#define PRODUCER_OUTPUT_FIXSIZE (base->producer->video.chroma != tmedia_chroma_mjpeg) // whether the output data has a fixed size/length
-#define PRODUCER_OUTPUT_RAW (base->producer->encoder.codec_id == tmedia_codec_id_none) // Otherwise, frames from the producer are already encoded
-#define PRODUCER_SIZE_CHANGED ((video->conv.producerWidth && video->conv.producerWidth != base->producer->video.width) || (video->conv.producerHeight && video->conv.producerHeight != base->producer->video.height) \
-|| (video->conv.xProducerSize && (video->conv.xProducerSize != size && PRODUCER_OUTPUT_FIXSIZE)))
-#define ENCODED_NEED_FLIP (TMEDIA_CODEC_VIDEO(video->encoder.codec)->out.flip)
-#define ENCODED_NEED_RESIZE (base->producer->video.width != TMEDIA_CODEC_VIDEO(video->encoder.codec)->out.width || base->producer->video.height != TMEDIA_CODEC_VIDEO(video->encoder.codec)->out.height)
-#define PRODUCED_FRAME_NEED_ROTATION (base->producer->video.rotation != 0)
-#define PRODUCED_FRAME_NEED_MIRROR (base->producer->video.mirror != tsk_false)
-#define PRODUCED_FRAME_NEED_CHROMA_CONVERSION (base->producer->video.chroma != TMEDIA_CODEC_VIDEO(video->encoder.codec)->out.chroma)
-		// Video codecs only accept YUV420P buffers ==> do conversion if needed or producer doesn't have the right size
-		if (PRODUCER_OUTPUT_RAW && (PRODUCED_FRAME_NEED_CHROMA_CONVERSION || PRODUCER_SIZE_CHANGED || ENCODED_NEED_FLIP || ENCODED_NEED_RESIZE ||PRODUCED_FRAME_NEED_ROTATION || PRODUCED_FRAME_NEED_MIRROR)) {
-			// Create video converter if not already done or producer size have changed
-			if(!video->conv.toYUV420 || PRODUCER_SIZE_CHANGED){
-				TSK_OBJECT_SAFE_FREE(video->conv.toYUV420);
-				video->conv.producerWidth = base->producer->video.width;
-				video->conv.producerHeight = base->producer->video.height;
-				video->conv.xProducerSize = size;
-				
-				TSK_DEBUG_INFO("producer size = (%d, %d)", base->producer->video.width, base->producer->video.height);
-				if(!(video->conv.toYUV420 = tmedia_converter_video_create(base->producer->video.width, base->producer->video.height, base->producer->video.chroma, TMEDIA_CODEC_VIDEO(video->encoder.codec)->out.width, TMEDIA_CODEC_VIDEO(video->encoder.codec)->out.height,
-					TMEDIA_CODEC_VIDEO(video->encoder.codec)->out.chroma))){
-					TSK_DEBUG_ERROR("Failed to create video converter");
-					ret = -5;
-					goto bail;
-				}
-                // restore/set rotation scaling info because producer size could change
-                tmedia_converter_video_set_scale_rotated_frames(video->conv.toYUV420, video->encoder.scale_rotated_frames);
-			}
+		if((ret = _tdav_session_video_convert(video, buffer, size)) != 0){
+			return ret;
 		}
-
-		if(video->conv.toYUV420){
-			video->encoder.scale_rotated_frames = video->conv.toYUV420->scale_rotated_frames;
-			// check if rotation have changed and alert the codec
-			// we avoid scalling the frame after rotation because it's CPU intensive and keeping the image ratio is difficult
-			// it's up to the encoder to swap (w,h) and to track the rotation value
-			if(video->encoder.rotation != base->producer->video.rotation){
-				tmedia_param_t* param = tmedia_param_create(tmedia_pat_set,
-												tmedia_video, 
-												tmedia_ppt_codec, 
-												tmedia_pvt_int32,
-												"rotation",
-												(void*)&base->producer->video.rotation);
-				if(!param){
-					TSK_DEBUG_ERROR("Failed to create a media parameter");
-					return -1;
+		if(video->encoder.pending.stream){ // checked again under the lock
+			tsk_size_t frame_size = video->encoder.yuv420p_size ? video->encoder.yuv420p_size : size;
+			void* frame;
+			if(!video->encoder.yuv420p_size){ // not converted: the producer's buffer cannot be kept
+				if(video->encoder.conv_buffer_size < size){
+					if(!(frame = tsk_realloc(video->encoder.conv_buffer, size))){
+						TSK_DEBUG_ERROR("Failed to allocate buffer with size = %u", (unsigned)size);
+						return -3;
+					}
+					video->encoder.conv_buffer = frame;
+					video->encoder.conv_buffer_size = size;
 				}
-				video->encoder.rotation = base->producer->video.rotation; // update rotation to avoid calling the function several times
-				ret = tmedia_codec_set(video->encoder.codec, param);
-				TSK_OBJECT_SAFE_FREE(param);
-				// (ret != 0) -> not supported by the codec -> to be done by the converter
-				video->encoder.scale_rotated_frames = (ret != 0);
+				memcpy(video->encoder.conv_buffer, buffer, size);
 			}
-
-			// update one-shot parameters
-			tmedia_converter_video_set(video->conv.toYUV420, base->producer->video.rotation, TMEDIA_CODEC_VIDEO(video->encoder.codec)->out.flip, base->producer->video.mirror, video->encoder.scale_rotated_frames);
-			
-			yuv420p_size = tmedia_converter_video_process(video->conv.toYUV420, buffer, size, &video->encoder.conv_buffer, &video->encoder.conv_buffer_size);
-			if(!yuv420p_size || !video->encoder.conv_buffer){
-				TSK_DEBUG_ERROR("Failed to convert XXX buffer to YUV42P");
-				ret = -6;
-				goto bail;
-			}
-		}
-
-		// Encode data
-		tsk_mutex_lock(video->encoder.h_mutex);
-		if(video->encoder.codec){ // codec is destroyed by stop() which use same mutex
-			if(video->encoder.conv_buffer && yuv420p_size){
-				/* producer doesn't support yuv42p */
-				out_size = video->encoder.codec->plugin->encode(video->encoder.codec, video->encoder.conv_buffer, yuv420p_size, &video->encoder.buffer, &video->encoder.buffer_size);
-			}
-			else{
-				/* producer supports yuv42p */
-				out_size = video->encoder.codec->plugin->encode(video->encoder.codec, buffer, size,  &video->encoder.buffer, &video->encoder.buffer_size);
+			tsk_mutex_lock(video->encoder.pending.h_mutex); // against stop() and the encode job
+			if(video->encoder.pending.stream){
+				// hand over the frame: "conv_buffer" becomes the pending frame and the previous pending buffer is reused by the converter
+				tsk_size_t frame_buffer_size = video->encoder.conv_buffer_size;
+				frame = video->encoder.conv_buffer;
+				video->encoder.conv_buffer = video->encoder.pending.buffer, video->encoder.conv_buffer_size = video->encoder.pending.buffer_size;
+				video->encoder.pending.buffer = frame, video->encoder.pending.buffer_size = frame_buffer_size;
+				if(video->encoder.pending.size){
+					++video->encoder.pending.skipped; // the previous frame was not encoded yet
+				}
+				video->encoder.pending.size = frame_size;
+				if(!video->encoder.pending.posted){
+					if((ret = tdav_video_pool_post(video->encoder.pending.stream, tdav_video_pool_stage_encode, _tdav_session_video_encode_job, video, 0)) == 0){
+						video->encoder.pending.posted = tsk_true;
+					}
+				}
+				tsk_mutex_unlock(video->encoder.pending.h_mutex);
+				return ret;
 			}
+			tsk_mutex_unlock(video->encoder.pending.h_mutex);
 		}
-		tsk_mutex_unlock(video->encoder.h_mutex);
-
-
-		if(out_size){
-			/* Never called, see tdav_session_video_raw_cb() */
-			trtp_manager_send_rtp(base->rtp_manager, video->encoder.buffer, out_size, 6006, tsk_true, tsk_true);
-		}
-bail: ;
+		// no video pool: encode on the producer's thread
+		ret = video->encoder.yuv420p_size
+			? _tdav_session_video_encode(video, video->encoder.conv_buffer, video->encoder.yuv420p_size)
+			: _tdav_session_video_encode(video, buffer, size);
 	}
 	else{
 		TSK_DEBUG_ERROR("Invalid parameter");
@@ -545,6 +606,7 @@ static int tdav_session_video_rtcp_cb(const void* callback_data, const trtp_rtcp
 			if(!(block = item->data)) continue;
 			if(base->rtp_manager->rtp.ssrc.local == block->ssrc){
 				tdav_session_video_pkt_loss_level_t pkt_loss_level = tdav_session_video_pkt_loss_level_low;
+				_tdav_session_video_avpf_update_rtt(video, block);
 				if(block->fraction > TDAV_SESSION_VIDEO_PKT_LOSS_HIGH)  pkt_loss_level = tdav_session_video_pkt_loss_level_high;
 				else if(block->fraction > TDAV_SESSION_VIDEO_PKT_LOSS_MEDIUM)  pkt_loss_level = tdav_session_video_pkt_loss_level_medium;
 				if(pkt_loss_level == tdav_session_video_pkt_loss_level_high || (pkt_loss_level > video->encoder.pkt_loss_level)){ // high or low -> medium
@@ -616,53 +678,11 @@ static int tdav_session_video_rtcp_cb(const void* callback_data, const trtp_rtcp
 			case trtp_rtcp_rtpfb_fci_type_nack:
 				{
 					if(rtpfb->nack.blp && rtpfb->nack.pid){
-						tsk_size_t i;
-						int32_t j;
-						uint16_t pid, blp;
-						const tsk_list_item_t* item;
-						const trtp_rtp_packet_t* pkt_rtp;
+						tsk_size_t i, count;
 						for(i = 0; i < rtpfb->nack.count; ++i){
-							static const int32_t __Pow2[16] = { 0x1, 0x2, 0x4, 0x8, 0x10, 0x20, 0x40, 0x80, 0x100, 0x200, 0x400, 0x800, 0x1000, 0x2000, 0x4000, 0x8000 };
-							int32_t blp_count;
-							blp = rtpfb->nack.blp[i];
-							blp_count = blp ? 16 : 0;
-							
-							for(j = -1/*Packet ID (PID)*/; j < blp_count; ++j){
-								if(j == -1 || (blp & __Pow2[j])){
-									pid = (rtpfb->nack.pid[i] + (j + 1));
-									tsk_list_lock(video->avpf.packets);
-									tsk_list_foreach(item, video->avpf.packets){
-										if(!(pkt_rtp = item->data)){
-											continue;
-										}
-										
-										// Very Important: the seq_nums are not consecutive because of wrapping. 
-										// For example, '65533, 65534, 65535, 0, 1' is a valid sequences which means we have to check all packets (probaly need somthing smarter)
-										if(pkt_rtp->header->seq_num == pid){
-											TSK_DEBUG_INFO("NACK Found, pid=%d, blp=%u", pid, blp);
-											trtp_manager_send_rtp_packet(base->rtp_manager, pkt_rtp, tsk_true);
-											break;
-										}
-										if(item == video->avpf.packets->tail){
-											// should never be called unless the tail is too small
-											int32_t old_max = (int32_t)video->avpf.max;
-											int32_t len_drop = (pkt_rtp->header->seq_num - pid);
-											video->avpf.max = TSK_CLAMP((int32_t)tmedia_defaults_get_avpf_tail_min(), (old_max + len_drop), (int32_t)tmedia_defaults_get_avpf_tail_max());
-											TSK_DEBUG_INFO("**NACK requesting dropped frames. List=[%d-%d], requested=%d, List.Max=%d, List.Count=%d. RTT is probably too high.", 
-												((const trtp_rtp_packet_t*)TSK_LIST_FIRST_DATA(video->avpf.packets))->header->seq_num,
-												((const trtp_rtp_packet_t*)TSK_LIST_LAST_DATA(video->avpf.packets))->header->seq_num,
-												pid, 
-												video->avpf.max,
-												video->avpf.count);
-												// FIR not really requested but needed
-												/*_tdav_session_video_remote_requested_idr(video, ((const trtp_rtcp_report_fb_t*)rtpfb)->ssrc_media);
-												tsk_list_clear_items(video->avpf.packets);
-												video->avpf.count = 0;*/
-										} // if(last_item)
-									}// foreach(pkt)
-									tsk_list_unlock(video->avpf.packets);
-								}// if(BLP is set)
-							}// foreach(BIT in BLP)
+							if((count = _tdav_session_video_avpf_resend(video, rtpfb->nack.pid[i], rtpfb->nack.blp[i]))){
+								TSK_DEBUG_INFO("NACK Found, pid=%d, blp=%u, resent=%u", rtpfb->nack.pid[i], rtpfb->nack.blp[i], (unsigned)count);
+							}
 						}// foreach(nack)
 					}// if(nack-blp and nack-pid are set)
 					break;
@@ -930,6 +950,113 @@ bail:
 
 /* ============ Plugin interface ================= */
 
+// Saves a sent packet to honor the RTCP-NACK requests. The history is sized using the packet rate and the RTT.
+static int _tdav_session_video_avpf_store(tdav_session_video_t* self, uint16_t seq_num, const void* data, tsk_size_t size)
+{
+	uint64_t now;
+	tsk_size_t wanted, capacity;
+	int ret = 0;
+
+	if(!data || !size){
+		return -1;
+	}
+
+	tsk_mutex_lock(self->avpf.h_mutex);
+
+	// packet rate, refreshed every second
+	now = tsk_time_now();
+	++self->avpf.pps.count;
+	if(!self->avpf.pps.start){
+		self->avpf.pps.start = now;
+	}
+	else if((now - self->avpf.pps.start) >= 1000){
+		self->avpf.pps.rate = (tsk_size_t)((self->avpf.pps.count * 1000) / (now - self->avpf.pps.start));
+		self->avpf.pps.start = now;
+		self->avpf.pps.count = 0;
+	}
+
+	// keep what could be requested within twice the RTT (the NACK has to arrive, then the retransmission)
+	wanted = self->avpf.rtt ? ((self->avpf.pps.rate * ((self->avpf.rtt << 1) + TDAV_SESSION_VIDEO_AVPF_RTT_MARGIN)) / 1000) : 0;
+	wanted = TSK_CLAMP(tmedia_defaults_get_avpf_tail_min(), TSK_MAX(wanted, self->avpf.max), tmedia_defaults_get_avpf_tail_max());
+	for(capacity = 1; capacity < wanted; capacity <<= 1) ;
+	// grow as soon as needed, shrink only if much too big
+	if(capacity > self->avpf.history.capacity || (capacity << 2) <= self->avpf.history.capacity){
+		if((ret = tdav_video_avpf_history_resize(&self->avpf.history, capacity)) != 0){
+			goto bail;
+		}
+	}
+	ret = tdav_video_avpf_history_put(&self->avpf.history, seq_num, data, size);
+
+bail:
+	tsk_mutex_unlock(self->avpf.h_mutex);
+	return ret;
+}
+
+// Resends the packets requested by a NACK (PID and bitmask of the following lost packets) from the AVPF history.
+// The packets are sent using a single batched call. Returns the number of packets resent.
+static tsk_size_t _tdav_session_video_avpf_resend(tdav_session_video_t* self, uint16_t pid, uint16_t blp)
+{
+	const void* datas[17];
+	tsk_size_t sizes[17];
+	tsk_size_t count = 0;
+	uint16_t seq_num;
+	int32_t j, overwritten_by;
+
+	tsk_mutex_lock(self->avpf.h_mutex);
+	if(self->avpf.history.capacity){
+		for(j = -1/*Packet ID (PID)*/; j < 16; ++j){
+			if(j != -1 && !(blp & (1 << j))){
+				continue;
+			}
+			seq_num = (uint16_t)(pid + (j + 1));
+			if((datas[count] = tdav_video_avpf_history_get(&self->avpf.history, seq_num, &sizes[count], &overwritten_by))){
+				++count;
+			}
+			else if(overwritten_by){
+				// overwritten: should never happen unless the history is too small
+				int32_t old_max = (int32_t)self->avpf.max;
+				self->avpf.max = TSK_CLAMP((int32_t)tmedia_defaults_get_avpf_tail_min(), (old_max + overwritten_by), (int32_t)tmedia_defaults_get_avpf_tail_max());
+				TSK_DEBUG_INFO("**NACK requesting dropped frames. Requested=%d, Overwritten by=%d, Max=%d, Capacity=%d, RTT=%u. RTT is probably too high.",
+					seq_num,
+					(uint16_t)(seq_num + overwritten_by),
+					(int)self->avpf.max,
+					(int)self->avpf.history.capacity,
+					self->avpf.rtt);
+			}
+		}
+		if(count){
+			// already serialized and encrypted
+			count = trtp_manager_send_rtp_raw_batch(TDAV_SESSION_AV(self)->rtp_manager, datas, sizes, count);
+		}
+	}
+	tsk_mutex_unlock(self->avpf.h_mutex);
+	return count;
+}
+
+// rfc3550 - 6.4.1: RTT = A - LSR - DLSR (in units of 1/65536 seconds)
+static void _tdav_session_video_avpf_update_rtt(tdav_session_video_t* self, const trtp_rtcp_rblock_t* block)
+{
+	if(block->lsr){
+		uint32_t now = (uint32_t)((tsk_time_ntp() >> 16) & 0xFFFFFFFF); // middle 32 bits
+		uint32_t rtt = (now - block->lsr - block->dlsr);
+		if(rtt < (65536 << 3)){ // ignore values above 8 seconds (clock issues)
+			rtt = (uint32_t)(((uint64_t)rtt * 1000) >> 16);
+			// smoothed
+			self->avpf.rtt = self->avpf.rtt ? ((self->avpf.rtt * 7 + rtt) >> 3) : rtt;
+		}
+	}
+}
+
+static void _tdav_session_video_avpf_clear(tdav_session_video_t* self)
+{
+	tsk_mutex_lock(self->avpf.h_mutex);
+	tdav_video_avpf_history_clear(&self->avpf.history);
+	self->avpf.rtt = 0;
+	self->avpf.pps.start = 0;
+	self->avpf.pps.count = self->avpf.pps.rate = 0;
+	tsk_mutex_unlock(self->avpf.h_mutex);
+}
+
 static int tdav_session_video_set(tmedia_session_t* self, const tmedia_param_t* param)
 {
 	int ret = 0;
@@ -1076,7 +1203,16 @@ static int tdav_session_video_start(tmedia_session_t* self)
 	}
 	tsk_mutex_unlock(video->encoder.h_mutex);
 
+	// encode on the video pool (the producer's thread is used when the pool cannot be started)
+	if (!video->encoder.pending.stream && !(video->encoder.pending.stream = tdav_video_pool_stream_create())) {
+		TSK_DEBUG_WARN("Failed to create video pool stream: encoding on the producer's thread");
+	}
+	video->encoder.pending.size = 0;
+	video->encoder.pending.work_size = 0;
+	video->encoder.pending.posted = tsk_false;
+
 	if (video->jb) {
+		tdav_video_jb_set_fps(video->jb, TMEDIA_CODEC_VIDEO(codec)->in.fps); // sizes the frame slots
 		if ((ret = tdav_video_jb_start(video->jb))) {
 			TSK_DEBUG_ERROR("Failed to start jitter buffer");
 			return ret;
@@ -1096,6 +1232,7 @@ static int tdav_session_video_stop(tmedia_session_t* self)
 	int ret;
 	tdav_session_video_t* video;
 	tdav_session_av_t* base;
+	struct tdav_video_pool_stream_s* stream;
 
 	TSK_DEBUG_INFO("tdav_session_video_stop");
 
@@ -1108,10 +1245,19 @@ static int tdav_session_video_stop(tmedia_session_t* self)
 	if (video->jb) {
 		ret = tdav_video_jb_stop(video->jb);
 	}
-	// clear AVPF packets and wait for the dtor() before destroying the list
-	tsk_list_lock(video->avpf.packets);
-	tsk_list_clear_items(video->avpf.packets);
-	tsk_list_unlock(video->avpf.packets);
+	// drop the frames not encoded yet and wait for the running job
+	// the stream is detached first: the encode job locks the same mutex
+	tsk_mutex_lock(video->encoder.pending.h_mutex);
+	stream = video->encoder.pending.stream;
+	video->encoder.pending.stream = tsk_null;
+	tsk_mutex_unlock(video->encoder.pending.h_mutex);
+	if (stream) {
+		tdav_video_pool_stream_close(stream);
+		TSK_OBJECT_SAFE_FREE(stream);
+		TSK_DEBUG_INFO("Video frames skipped by the encoder = %llu", video->encoder.pending.skipped);
+	}
+	// clear AVPF packets and wait for the dtor() before freeing the slots
+	_tdav_session_video_avpf_clear(video);
 
 	// the encoder must be locked before stopping the session as such action will close all codecs	
 	tsk_mutex_lock(video->encoder.h_mutex);
@@ -1324,8 +1470,12 @@ static int _tdav_session_video_init(tdav_session_video_t *p_self, tmedia_type_t
 		TSK_DEBUG_ERROR("Failed to create encode mutex");
 		return -4;
 	}
-	if (!(p_self->avpf.packets = tsk_list_create())) {
-		TSK_DEBUG_ERROR("Failed to create list");
+	if (!(p_self->encoder.pending.h_mutex = tsk_mutex_create())) {
+		TSK_DEBUG_ERROR("Failed to create encode mutex");
+		return -4;
+	}
+	if (!(p_self->avpf.h_mutex = tsk_mutex_create())) {
+		TSK_DEBUG_ERROR("Failed to create AVPF mutex");
 		return -2;
 	}
 	if (p_self->jb_enabled) {
@@ -1376,19 +1526,27 @@ static tsk_object_t* tdav_session_video_dtor(tsk_object_t * self)
 
 		TSK_FREE(video->encoder.buffer);
 		TSK_FREE(video->encoder.conv_buffer);
+		TSK_FREE(video->encoder.pending.buffer);
+		TSK_FREE(video->encoder.pending.work_buffer);
 		TSK_FREE(video->decoder.buffer);
 		TSK_FREE(video->decoder.conv_buffer);
 
 		TSK_OBJECT_SAFE_FREE(video->encoder.codec);
 		TSK_OBJECT_SAFE_FREE(video->decoder.codec);
 
-		TSK_OBJECT_SAFE_FREE(video->avpf.packets);
+		tdav_video_avpf_history_deinit(&video->avpf.history);
+		if(video->avpf.h_mutex){
+			tsk_mutex_destroy(&video->avpf.h_mutex);
+		}
 
 		TSK_OBJECT_SAFE_FREE(video->jb);
 
 		if(video->encoder.h_mutex){
 			tsk_mutex_destroy(&video->encoder.h_mutex);
 		}
+		if(video->encoder.pending.h_mutex){
+			tsk_mutex_destroy(&video->encoder.pending.h_mutex);
+		}
 
 		/* deinit() base */
 		tdav_session_av_deinit(TDAV_SESSION_AV(video));
@@ -0,0 +1,181 @@
+/*
+* Copyright (C) 2010-2015 Mamadou DIOP.
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*/
+
+/**@file tdav_video_avpf_history.c
+* @brief History of the sent RTP packets (as serialized, after SRTP) used to honor the RTCP-NACK requests.
+*
+* The packets are copied into preallocated slots (no allocation per packet). A packet always goes with its
+* "ext" buffer when moved, so a slot never holds the data of another packet.
+*/
+#include "tinydav/video/tdav_video_avpf_history.h"
+
+#include "tsk_memory.h"
+#include "tsk_debug.h"
+
+#include <string.h>
+
+#define _tdav_video_avpf_history_data(self, slot, index) \
+	(((slot)->size > TDAV_VIDEO_AVPF_HISTORY_SLOT_SIZE) ? (slot)->ext : &(self)->storage[(index) * TDAV_VIDEO_AVPF_HISTORY_SLOT_SIZE])
+
+/**@ingroup tdav_video_avpf_history_group
+* Resizes the ring. The packets still fitting are kept: when shrinking, the newest packet wins each slot.
+* @param self the history.
+* @param capacity the new capacity (power of two).
+* @retval zero if succeed and non-zero error code otherwise. The history is unchanged on failure.
+*/
+int tdav_video_avpf_history_resize(tdav_video_avpf_history_t* self, tsk_size_t capacity)
+{
+	tdav_video_avpf_history_slot_t *slots, *old, *dst;
+	uint8_t* storage = tsk_null;
+	tsk_size_t i, index;
+
+	if (!self || !capacity || (capacity & (capacity - 1))) {
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+
+	if (!(slots = tsk_calloc(capacity, sizeof(tdav_video_avpf_history_slot_t))) || !(storage = tsk_malloc(capacity * TDAV_VIDEO_AVPF_HISTORY_SLOT_SIZE))) {
+		TSK_DEBUG_ERROR("Failed to allocate AVPF history with capacity=%u", (unsigned)capacity);
+		TSK_FREE(slots);
+		return -2;
+	}
+	for (i = 0; i < self->capacity; ++i) {
+		old = &self->slots[i];
+		if (old->size) {
+			index = (old->seq_num & (capacity - 1));
+			dst = &slots[index];
+			if (!dst->size || (int16_t)(old->seq_num - dst->seq_num) > 0) {
+				// the packet and its "ext" buffer move together, the loser's buffer is released
+				TSK_FREE(dst->ext);
+				dst->seq_num = old->seq_num;
+				dst->size = old->size;
+				dst->ext = old->ext, old->ext = tsk_null;
+				dst->ext_size = old->ext_size;
+				if (old->size <= TDAV_VIDEO_AVPF_HISTORY_SLOT_SIZE) {
+					memcpy(&storage[index * TDAV_VIDEO_AVPF_HISTORY_SLOT_SIZE], &self->storage[i * TDAV_VIDEO_AVPF_HISTORY_SLOT_SIZE], old->size);
+				}
+			}
+		}
+		TSK_FREE(old->ext);
+	}
+	TSK_FREE(self->slots);
+	TSK_FREE(self->storage);
+	self->slots = slots;
+	self->storage = storage;
+	self->capacity = capacity;
+	return 0;
+}
+
+/**@ingroup tdav_video_avpf_history_group
+* Saves a sent packet, replacing the one using the same slot.
+* @retval zero if succeed and non-zero error code otherwise.
+*/
+int tdav_video_avpf_history_put(tdav_video_avpf_history_t* self, uint16_t seq_num, const void* data, tsk_size_t size)
+{
+	tdav_video_avpf_history_slot_t* slot;
+	tsk_size_t index;
+
+	if (!self || !self->capacity || !data || !size) {
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+
+	index = (seq_num & (self->capacity - 1));
+	slot = &self->slots[index];
+	if (size > TDAV_VIDEO_AVPF_HISTORY_SLOT_SIZE) {
+		if (slot->ext_size < size) {
+			void* ext;
+			if (!(ext = tsk_realloc(slot->ext, size))) {
+				TSK_DEBUG_ERROR("Failed to allocate buffer with size=%u", (unsigned)size);
+				slot->size = 0; // the old packet is lost, not the buffer
+				return -2;
+			}
+			slot->ext = ext;
+			slot->ext_size = size;
+		}
+		memcpy(slot->ext, data, size);
+	}
+	else {
+		memcpy(&self->storage[index * TDAV_VIDEO_AVPF_HISTORY_SLOT_SIZE], data, size);
+	}
+	slot->seq_num = seq_num;
+	slot->size = size;
+	return 0;
+}
+
+/**@ingroup tdav_video_avpf_history_group
+* Finds a packet.
+* @param self the history.
+* @param seq_num the sequence number of the packet.
+* @param size the size of the packet.
+* @param overwritten_by (optional) how much newer the packet that replaced it is (zero if not overwritten). Means the history is too small.
+* @retval the packet or null if not found. Valid until the next call to a non-const function.
+*/
+const void* tdav_video_avpf_history_get(const tdav_video_avpf_history_t* self, uint16_t seq_num, tsk_size_t* size, int32_t* overwritten_by)
+{
+	const tdav_video_avpf_history_slot_t* slot;
+	tsk_size_t index;
+
+	if (overwritten_by) {
+		*overwritten_by = 0;
+	}
+	if (!self || !self->capacity || !size) {
+		return tsk_null;
+	}
+
+	index = (seq_num & (self->capacity - 1));
+	slot = &self->slots[index];
+	if (slot->size && slot->seq_num == seq_num) {
+		*size = slot->size;
+		return _tdav_video_avpf_history_data(self, slot, index);
+	}
+	if (overwritten_by && slot->size && (int16_t)(slot->seq_num - seq_num) > 0) {
+		*overwritten_by = (uint16_t)(slot->seq_num - seq_num);
+	}
+	return tsk_null;
+}
+
+/**@ingroup tdav_video_avpf_history_group
+* Forgets all the packets (keeps the memory).
+*/
+void tdav_video_avpf_history_clear(tdav_video_avpf_history_t* self)
+{
+	tsk_size_t i;
+	if (self) {
+		for (i = 0; i < self->capacity; ++i) {
+			self->slots[i].size = 0;
+		}
+	}
+}
+
+/**@ingroup tdav_video_avpf_history_group
+* Releases the memory.
+*/
+void tdav_video_avpf_history_deinit(tdav_video_avpf_history_t* self)
+{
+	tsk_size_t i;
+	if (self) {
+		for (i = 0; i < self->capacity; ++i) {
+			TSK_FREE(self->slots[i].ext);
+		}
+		TSK_FREE(self->slots);
+		TSK_FREE(self->storage);
+		self->capacity = 0;
+	}
+}
@@ -0,0 +1,569 @@
+/*
+* Copyright (C) 2010-2015 Mamadou DIOP.
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*/
+
+/**@file tdav_video_pool.c
+* @brief Shared pool of threads running the video decode and encode jobs of all sessions.
+*
+* Instead of having one decoding thread per jitter buffer and encoding on the producer's thread, the jobs are posted
+* on "streams" and run by a fixed number of workers. A stream with pending jobs is in exactly one place at a time: a worker's
+* queue, the list of delayed streams or a running worker. This is what guarantees that the jobs of a stream run in order and
+* never concurrently without locking the job itself. An idle worker steals the streams queued on the other workers.
+*/
+#include "tinydav/video/tdav_video_pool.h"
+
+#include "tsk_thread.h"
+#include "tsk_mutex.h"
+#include "tsk_condwait.h"
+#include "tsk_object.h"
+#include "tsk_memory.h"
+#include "tsk_time.h"
+#include "tsk_cpu.h"
+#include "tsk_debug.h"
+
+/* upper bound for an idle wait: a wakeup could be missed between the last check and the wait */
+#define TDAV_VIDEO_POOL_IDLE_WAIT_MAX	50
+
+typedef struct tdav_video_pool_job_s
+{
+	tdav_video_pool_cb_f callback;
+	const void* callback_data;
+	tdav_video_pool_stage_t stage;
+	uint64_t due; /* not run before this time */
+}
+tdav_video_pool_job_t;
+
+typedef struct tdav_video_pool_stream_s
+{
+	TSK_DECLARE_OBJECT;
+
+	tsk_mutex_handle_t* mutex; /* jobs and state */
+	tsk_mutex_handle_t* run_mutex; /* held while a job runs. Recursive: a job is allowed to close its own stream */
+
+	tdav_video_pool_job_t jobs[TDAV_VIDEO_POOL_STREAM_JOBS_MAX];
+	tsk_size_t head;
+	tsk_size_t count;
+	tsk_bool_t scheduled; /* queued on a worker, delayed or running */
+	tsk_bool_t closed;
+
+	uint64_t delayed_due;
+	struct tdav_video_pool_stream_s* delayed_next;
+}
+tdav_video_pool_stream_t;
+
+typedef struct tdav_video_pool_worker_s
+{
+	tsk_thread_handle_t* tid[1];
+	tsk_size_t index;
+	tsk_mutex_handle_t* mutex;
+	int32_t priority; /* of the thread, follows the stage of the job being run */
+
+	/* ring of streams ready to run, the owner pops the head and the thieves the tail */
+	tdav_video_pool_stream_t** streams;
+	tsk_size_t head;
+	tsk_size_t count;
+	tsk_size_t capacity;
+
+	struct{
+		uint64_t jobs_count;
+		uint64_t latency_sum;
+		uint64_t latency_max;
+		uint64_t run_sum;
+		uint64_t run_max;
+	} stats[tdav_video_pool_stage_count];
+}
+tdav_video_pool_worker_t;
+
+static struct
+{
+	tsk_bool_t initialized;
+	tsk_bool_t started;
+	volatile tsk_bool_t running;
+	volatile tsk_bool_t ready; /* set once all the threads are created: "workers_count" never changes afterwards */
+	tsk_mutex_handle_t* mutex; /* start() and delayed streams */
+	tsk_condwait_handle_t* condwait;
+	volatile long signals;
+	volatile long next_worker;
+
+	tdav_video_pool_stream_t* delayed; /* sorted by due time */
+
+	volatile long depths[tdav_video_pool_stage_count];
+	long depths_max[tdav_video_pool_stage_count];
+	volatile long dropped[tdav_video_pool_stage_count];
+
+	tsk_size_t workers_count;
+	tdav_video_pool_worker_t workers[TDAV_VIDEO_POOL_WORKERS_MAX];
+}
+__pool = { tsk_false };
+
+static void _tdav_video_pool_signal()
+{
+	tsk_atomic_inc(&__pool.signals);
+	tsk_condwait_signal(__pool.condwait);
+}
+
+static int _tdav_video_pool_worker_push(tdav_video_pool_worker_t* worker, tdav_video_pool_stream_t* stream)
+{
+	int ret = 0;
+	tsk_mutex_lock(worker->mutex);
+	if(worker->count == worker->capacity){
+		tsk_size_t i, capacity = worker->capacity ? (worker->capacity << 1) : 16;
+		tdav_video_pool_stream_t** streams = tsk_malloc(capacity * sizeof(tdav_video_pool_stream_t*));
+		if(!streams){
+			TSK_DEBUG_ERROR("Failed to allocate %u streams", (unsigned)capacity);
+			ret = -1;
+			goto bail;
+		}
+		for(i = 0; i < worker->count; ++i){
+			streams[i] = worker->streams[(worker->head + i) % worker->capacity];
+		}
+		TSK_FREE(worker->streams);
+		worker->streams = streams;
+		worker->head = 0;
+		worker->capacity = capacity;
+	}
+	worker->streams[(worker->head + worker->count++) % worker->capacity] = tsk_object_ref(stream);
+bail:
+	tsk_mutex_unlock(worker->mutex);
+	return ret;
+}
+
+static tdav_video_pool_stream_t* _tdav_video_pool_worker_pop(tdav_video_pool_worker_t* worker, tsk_bool_t steal)
+{
+	tdav_video_pool_stream_t* stream = tsk_null;
+	if(!worker->count){ /* racy peek, checked again under the lock */
+		return tsk_null;
+	}
+	tsk_mutex_lock(worker->mutex);
+	if(worker->count){
+		if(steal){
+			stream = worker->streams[(worker->head + worker->count - 1) % worker->capacity];
+		}
+		else{
+			stream = worker->streams[worker->head];
+			worker->head = (worker->head + 1) % worker->capacity;
+		}
+		--worker->count;
+	}
+	tsk_mutex_unlock(worker->mutex);
+	return stream;
+}
+
+/* must be called with the stream's mutex held and at least one job pending */
+static int _tdav_video_pool_schedule(tdav_video_pool_stream_t* stream, uint64_t now, tdav_video_pool_worker_t* worker)
+{
+	const tdav_video_pool_job_t* job = &stream->jobs[stream->head];
+	int ret = 0;
+
+	if(job->due <= now){
+		if(!worker){
+			worker = &__pool.workers[(unsigned long)tsk_atomic_inc(&__pool.next_worker) % __pool.workers_count];
+		}
+		ret = _tdav_video_pool_worker_push(worker, stream);
+	}
+	else{
+		tdav_video_pool_stream_t** prev;
+		tsk_mutex_lock(__pool.mutex);
+		stream->delayed_due = job->due;
+		for(prev = &__pool.delayed; *prev && (*prev)->delayed_due <= job->due; prev = &(*prev)->delayed_next) ;
+		stream->delayed_next = *prev;
+		*prev = tsk_object_ref(stream);
+		tsk_mutex_unlock(__pool.mutex);
+	}
+	if(ret == 0){
+		_tdav_video_pool_signal();
+	}
+	return ret;
+}
+
+/* pops the first delayed stream if its due, otherwise returns the time to wait */
+static tdav_video_pool_stream_t* _tdav_video_pool_pop_delayed(uint64_t now, uint64_t* timeout)
+{
+	tdav_video_pool_stream_t* stream = tsk_null;
+	if(!__pool.delayed){
+		return tsk_null;
+	}
+	tsk_mutex_lock(__pool.mutex);
+	if((stream = __pool.delayed)){
+		if(stream->delayed_due <= now){
+			__pool.delayed = stream->delayed_next;
+			stream->delayed_next = tsk_null;
+		}
+		else{
+			*timeout = TSK_MIN(*timeout, (stream->delayed_due - now));
+			stream = tsk_null;
+		}
+	}
+	tsk_mutex_unlock(__pool.mutex);
+	return stream;
+}
+
+/* the decoding jobs replace the time critical thread each jitter buffer used to have */
+static int32_t _tdav_video_pool_stage_priority(tdav_video_pool_stage_t stage)
+{
+	return (stage == tdav_video_pool_stage_decode) ? TSK_THREAD_PRIORITY_TIME_CRITICAL : TSK_THREAD_PRIORITY_MEDIUM;
+}
+
+/* runs the first job of a stream popped from a queue and gives back the reference taken when it was queued */
+static void _tdav_video_pool_worker_run(tdav_video_pool_worker_t* worker, tdav_video_pool_stream_t* stream)
+{
+	tdav_video_pool_job_t job;
+	uint64_t start, end;
+
+	tsk_mutex_lock(stream->run_mutex);
+	tsk_mutex_lock(stream->mutex);
+	if(stream->closed || !stream->count){
+		stream->scheduled = tsk_false;
+		tsk_mutex_unlock(stream->mutex);
+		goto bail;
+	}
+	job = stream->jobs[stream->head];
+	stream->head = (stream->head + 1) % TDAV_VIDEO_POOL_STREAM_JOBS_MAX;
+	--stream->count;
+	tsk_mutex_unlock(stream->mutex);
+
+	tsk_atomic_dec(&__pool.depths[job.stage]);
+	if(worker->priority != _tdav_video_pool_stage_priority(job.stage)){
+		worker->priority = _tdav_video_pool_stage_priority(job.stage);
+		tsk_thread_set_priority(worker->tid[0], worker->priority);
+	}
+	start = tsk_time_now();
+	job.callback(job.callback_data);
+	end = tsk_time_now();
+
+	tsk_mutex_lock(worker->mutex);
+	++worker->stats[job.stage].jobs_count;
+	if(start > job.due){
+		worker->stats[job.stage].latency_sum += (start - job.due);
+		worker->stats[job.stage].latency_max = TSK_MAX(worker->stats[job.stage].latency_max, (start - job.due));
+	}
+	worker->stats[job.stage].run_sum += (end - start);
+	worker->stats[job.stage].run_max = TSK_MAX(worker->stats[job.stage].run_max, (end - start));
+	tsk_mutex_unlock(worker->mutex);
+
+	tsk_mutex_lock(stream->mutex);
+	/* keep the stream on this worker: the next job most likely uses the same data */
+	if(stream->closed || !stream->count || _tdav_video_pool_schedule(stream, end, worker) != 0){
+		stream->scheduled = tsk_false;
+	}
+	tsk_mutex_unlock(stream->mutex);
+
+bail:
+	tsk_mutex_unlock(stream->run_mutex);
+	tsk_object_unref(stream);
+}
+
+static void* TSK_STDCALL _tdav_video_pool_worker_thread(void *param)
+{
+	tdav_video_pool_worker_t* worker = (tdav_video_pool_worker_t*)param;
+	tdav_video_pool_stream_t* stream;
+	uint64_t timeout;
+	long signals;
+	tsk_size_t i;
+
+	TSK_DEBUG_INFO("Video pool worker -- START");
+
+	/* the workers steal from each other: wait until the number of workers is final */
+	while(__pool.running && !__pool.ready){
+		tsk_condwait_timedwait(__pool.condwait, TDAV_VIDEO_POOL_IDLE_WAIT_MAX);
+	}
+
+	while(__pool.running){
+		signals = __pool.signals;
+		timeout = TDAV_VIDEO_POOL_IDLE_WAIT_MAX;
+		/* delayed streams first, they would starve when the workers are busy */
+		if(!(stream = _tdav_video_pool_pop_delayed(tsk_time_now(), &timeout)) && !(stream = _tdav_video_pool_worker_pop(worker, tsk_false))){
+			for(i = 1; i < __pool.workers_count && !stream; ++i){
+				stream = _tdav_video_pool_worker_pop(&__pool.workers[(worker->index + i) % __pool.workers_count], tsk_true);
+			}
+		}
+		if(stream){
+			_tdav_video_pool_worker_run(worker, stream);
+		}
+		else if(signals == __pool.signals && timeout){
+			tsk_condwait_timedwait(__pool.condwait, timeout);
+		}
+	}
+
+	TSK_DEBUG_INFO("Video pool worker -- STOP");
+	return tsk_null;
+}
+
+static int _tdav_video_pool_start()
+{
+	tsk_size_t i, j;
+
+	__pool.running = tsk_true;
+	__pool.ready = tsk_false;
+	for(i = 0; i < __pool.workers_count; ++i){
+		__pool.workers[i].index = i;
+		__pool.workers[i].priority = TSK_THREAD_PRIORITY_MEDIUM;
+		if(!(__pool.workers[i].mutex = tsk_mutex_create())){
+			TSK_DEBUG_ERROR("Failed to create mutex");
+			break;
+		}
+	}
+	/* the workers steal from each other: all mutexes must exist before the first thread starts */
+	__pool.workers_count = i;
+	for(i = 0; i < __pool.workers_count; ++i){
+		if(tsk_thread_create(&__pool.workers[i].tid[0], _tdav_video_pool_worker_thread, &__pool.workers[i])){
+			TSK_DEBUG_ERROR("Failed to create worker thread");
+			break;
+		}
+	}
+	if(i == 0){
+		__pool.running = tsk_false;
+	}
+	/* keep running with the workers we managed to start (nothing is queued on the others yet and the started threads
+	are waiting for "ready" before reading "workers_count") */
+	for(j = i; j < __pool.workers_count; ++j){
+		tsk_mutex_destroy(&__pool.workers[j].mutex);
+	}
+	__pool.workers_count = i;
+	if(i == 0){
+		return -1;
+	}
+	tsk_atomic_barrier();
+	__pool.ready = tsk_true;
+	tsk_condwait_broadcast(__pool.condwait);
+	__pool.started = tsk_true;
+	TSK_DEBUG_INFO("Video pool started: workers=%u", (unsigned)__pool.workers_count);
+	return 0;
+}
+
+//=================================================================================================
+//	Video pool stream object definition
+//
+static tsk_object_t* tdav_video_pool_stream_ctor(tsk_object_t * self, va_list * app)
+{
+	tdav_video_pool_stream_t *stream = self;
+	if(stream){
+		if(!(stream->mutex = tsk_mutex_create()) || !(stream->run_mutex = tsk_mutex_create())){
+			TSK_DEBUG_ERROR("Failed to create mutex");
+			return tsk_null;
+		}
+	}
+	return self;
+}
+static tsk_object_t* tdav_video_pool_stream_dtor(tsk_object_t * self)
+{
+	tdav_video_pool_stream_t *stream = self;
+	if(stream){
+		if(stream->mutex){
+			tsk_mutex_destroy(&stream->mutex);
+		}
+		if(stream->run_mutex){
+			tsk_mutex_destroy(&stream->run_mutex);
+		}
+	}
+	return self;
+}
+static const tsk_object_def_t tdav_video_pool_stream_def_s =
+{
+	sizeof(tdav_video_pool_stream_t),
+	tdav_video_pool_stream_ctor,
+	tdav_video_pool_stream_dtor,
+	tsk_null,
+};
+
+/** Called by tdav_init() */
+int tdav_video_pool_init()
+{
+	if(__pool.initialized){
+		return 0;
+	}
+	if(!(__pool.mutex = tsk_mutex_create()) || !(__pool.condwait = tsk_condwait_create())){
+		TSK_DEBUG_ERROR("Failed to create mutex or condwait");
+		return -1;
+	}
+	__pool.workers_count = TSK_MIN(tsk_cpu_get_cores_count(), TDAV_VIDEO_POOL_WORKERS_MAX);
+	__pool.initialized = tsk_true;
+	return 0;
+}
+
+/** Sets the number of worker threads (default: number of cores). Must be called before the first stream is created. */
+int tdav_video_pool_set_workers_count(tsk_size_t count)
+{
+	int ret = 0;
+	if(!__pool.initialized || !count || count > TDAV_VIDEO_POOL_WORKERS_MAX){
+		TSK_DEBUG_ERROR("Invalid parameter or not initialized");
+		return -1;
+	}
+	tsk_mutex_lock(__pool.mutex);
+	if(__pool.started){
+		TSK_DEBUG_ERROR("Video pool already started");
+		ret = -2;
+	}
+	else{
+		__pool.workers_count = count;
+	}
+	tsk_mutex_unlock(__pool.mutex);
+	return ret;
+}
+
+/** Creates a stream of ordered jobs. The workers are started on the first call. */
+struct tdav_video_pool_stream_s* tdav_video_pool_stream_create()
+{
+	int ret = 0;
+	if(!__pool.initialized){
+		TSK_DEBUG_ERROR("Video pool not initialized");
+		return tsk_null;
+	}
+	tsk_mutex_lock(__pool.mutex);
+	if(!__pool.started){
+		ret = _tdav_video_pool_start();
+	}
+	tsk_mutex_unlock(__pool.mutex);
+	return (ret == 0) ? tsk_object_new(&tdav_video_pool_stream_def_s) : tsk_null;
+}
+
+/** Drops the pending jobs. When this function returns no job of the stream is running and none will ever run again. The caller still owns its reference. */
+int tdav_video_pool_stream_close(struct tdav_video_pool_stream_s* stream)
+{
+	if(!stream){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	tsk_mutex_lock(stream->mutex);
+	stream->closed = tsk_true;
+	for(; stream->count; --stream->count){
+		tsk_atomic_dec(&__pool.depths[stream->jobs[stream->head].stage]);
+		tsk_atomic_inc(&__pool.dropped[stream->jobs[stream->head].stage]);
+		stream->head = (stream->head + 1) % TDAV_VIDEO_POOL_STREAM_JOBS_MAX;
+	}
+	tsk_mutex_unlock(stream->mutex);
+	/* blocks until the running job completes unless called from it (recursive mutex) */
+	tsk_mutex_lock(stream->run_mutex);
+	tsk_mutex_unlock(stream->run_mutex);
+	return 0;
+}
+
+/** Posts a job to run after @a delay milliseconds and after the jobs already posted on the same stream. */
+int tdav_video_pool_post(struct tdav_video_pool_stream_s* stream, tdav_video_pool_stage_t stage, tdav_video_pool_cb_f callback, const void* callback_data, uint64_t delay)
+{
+	tdav_video_pool_job_t* job;
+	uint64_t now;
+	int ret = 0;
+
+	if(!stream || !callback || stage >= tdav_video_pool_stage_count){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+
+	tsk_mutex_lock(stream->mutex);
+	if(stream->closed){
+		ret = -2;
+		goto bail;
+	}
+	if(stream->count == TDAV_VIDEO_POOL_STREAM_JOBS_MAX){
+		TSK_DEBUG_WARN("Too many jobs pending on the stream");
+		tsk_atomic_inc(&__pool.dropped[stage]);
+		ret = -3;
+		goto bail;
+	}
+	now = tsk_time_now();
+	job = &stream->jobs[(stream->head + stream->count++) % TDAV_VIDEO_POOL_STREAM_JOBS_MAX];
+	job->callback = callback;
+	job->callback_data = callback_data;
+	job->stage = stage;
+	job->due = now + delay;
+	tsk_atomic_inc(&__pool.depths[stage]);
+	if(__pool.depths[stage] > __pool.depths_max[stage]){ /* racy but only used for the metrics */
+		__pool.depths_max[stage] = __pool.depths[stage];
+	}
+	if(!stream->scheduled){
+		if((ret = _tdav_video_pool_schedule(stream, now, tsk_null)) == 0){
+			stream->scheduled = tsk_true;
+		}
+		else{
+			--stream->count;
+			tsk_atomic_dec(&__pool.depths[stage]);
+		}
+	}
+bail:
+	tsk_mutex_unlock(stream->mutex);
+	return ret;
+}
+
+/** Gets the metrics of a stage, accumulated over all workers since the pool started. */
+int tdav_video_pool_get_stats(tdav_video_pool_stage_t stage, tdav_video_pool_stats_t* stats)
+{
+	uint64_t latency_sum = 0, run_sum = 0;
+	tsk_size_t i;
+
+	if(stage >= tdav_video_pool_stage_count || !stats){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	memset(stats, 0, sizeof(*stats));
+	if(__pool.initialized && __pool.started){
+		for(i = 0; i < __pool.workers_count; ++i){
+			tsk_mutex_lock(__pool.workers[i].mutex);
+			stats->jobs_count += __pool.workers[i].stats[stage].jobs_count;
+			latency_sum += __pool.workers[i].stats[stage].latency_sum;
+			run_sum += __pool.workers[i].stats[stage].run_sum;
+			stats->latency_max = TSK_MAX(stats->latency_max, __pool.workers[i].stats[stage].latency_max);
+			stats->run_max = TSK_MAX(stats->run_max, __pool.workers[i].stats[stage].run_max);
+			tsk_mutex_unlock(__pool.workers[i].mutex);
+		}
+		if(stats->jobs_count){
+			stats->latency_avg = latency_sum / stats->jobs_count;
+			stats->run_avg = run_sum / stats->jobs_count;
+		}
+		stats->queue_depth = (tsk_size_t)TSK_MAX(__pool.depths[stage], 0);
+		stats->queue_depth_max = (tsk_size_t)__pool.depths_max[stage];
+		stats->jobs_dropped = (uint64_t)__pool.dropped[stage];
+	}
+	return 0;
+}
+
+/** Called by tdav_deinit() */
+int tdav_video_pool_deinit()
+{
+	tdav_video_pool_stream_t* stream;
+	tsk_size_t i;
+
+	if(!__pool.initialized){
+		return 0;
+	}
+	if(__pool.started){
+		__pool.running = tsk_false;
+		tsk_condwait_broadcast(__pool.condwait);
+		for(i = 0; i < __pool.workers_count; ++i){
+			if(__pool.workers[i].tid[0]){
+				tsk_thread_join(&__pool.workers[i].tid[0]);
+			}
+		}
+		/* release the streams still queued, their jobs never run */
+		for(i = 0; i < __pool.workers_count; ++i){
+			while((stream = _tdav_video_pool_worker_pop(&__pool.workers[i], tsk_false))){
+				tsk_object_unref(stream);
+			}
+			tsk_mutex_destroy(&__pool.workers[i].mutex);
+			TSK_FREE(__pool.workers[i].streams);
+		}
+		while((stream = __pool.delayed)){
+			__pool.delayed = stream->delayed_next;
+			tsk_object_unref(stream);
+		}
+	}
+	tsk_condwait_destroy(&__pool.condwait);
+	tsk_mutex_destroy(&__pool.mutex);
+	memset(&__pool, 0, sizeof(__pool));
+	return 0;
+}
@@ -21,15 +21,32 @@
 */
 #include <string.h>
 #include <stdlib.h>
+#include <assert.h>
 
 #include "tinydav.h"
 
 #include "test_sessions.h"
+#include "test_g711.h"
+#include "test_scheduler.h"
+#include "test_mixer.h"
+#include "test_avpf_history.h"
+#include "test_resampler.h"
+#include "test_pcm_stage.h"
+#include "test_video_pool.h"
+#include "test_jitterbuffer.h"
 
 #define LOOP						0
 
 #define RUN_TEST_ALL				0
 #define RUN_TEST_SESSIONS			1
+#define RUN_TEST_G711				0
+#define RUN_TEST_SCHEDULER			0
+#define RUN_TEST_MIXER				0
+#define RUN_TEST_AVPF_HISTORY		0
+#define RUN_TEST_RESAMPLER			0
+#define RUN_TEST_PCM_STAGE			0
+#define RUN_TEST_VIDEO_POOL			0
+#define RUN_TEST_JITTERBUFFER		0
 
 // Codecs : http://www.itu.int/rec/T-REC-G.191-200509-S/en
 
@@ -50,6 +67,38 @@ int main()
 		test_sessions();
 #endif
 
+#if RUN_TEST_G711 || RUN_TEST_ALL
+		test_g711();
+#endif
+
+#if RUN_TEST_SCHEDULER || RUN_TEST_ALL
+		test_scheduler();
+#endif
+
+#if RUN_TEST_MIXER || RUN_TEST_ALL
+		test_mixer();
+#endif
+
+#if RUN_TEST_AVPF_HISTORY || RUN_TEST_ALL
+		test_avpf_history();
+#endif
+
+#if RUN_TEST_RESAMPLER || RUN_TEST_ALL
+		test_resampler();
+#endif
+
+#if RUN_TEST_PCM_STAGE || RUN_TEST_ALL
+		test_pcm_stage();
+#endif
+
+#if RUN_TEST_VIDEO_POOL || RUN_TEST_ALL
+		test_video_pool();
+#endif
+
+#if RUN_TEST_JITTERBUFFER || RUN_TEST_ALL
+		test_jitterbuffer();
+#endif
+
 	}
 	while(LOOP);
 
@@ -0,0 +1,117 @@
+/*
+* Copyright (C) 2009 Mamadou Diop.
+*
+* Contact: Mamadou Diop <diopmamadou(at)doubango.org>
+*	
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*	
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*	
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*
+*/
+#ifndef _TINYDEV_TEST_AVPF_HISTORY_H
+#define _TINYDEV_TEST_AVPF_HISTORY_H
+
+#include "tinydav/video/tdav_video_avpf_history.h"
+
+#define TEST_AVPF_HISTORY_BIG	(TDAV_VIDEO_AVPF_HISTORY_SLOT_SIZE + 100)
+
+/* packet "seq_num" is filled with its own sequence number, odd packets are bigger than a slot */
+static tsk_size_t test_avpf_history_packet(uint16_t seq_num, uint8_t* data)
+{
+	tsk_size_t size = (seq_num & 1) ? TEST_AVPF_HISTORY_BIG : (100 + (seq_num % 50));
+	memset(data, (seq_num & 0xFF), size);
+	return size;
+}
+
+static void test_avpf_history_check(const tdav_video_avpf_history_t* history, uint16_t seq_num)
+{
+	uint8_t expected[TEST_AVPF_HISTORY_BIG];
+	const void* data;
+	tsk_size_t size = 0, expected_size = test_avpf_history_packet(seq_num, expected);
+	data = tdav_video_avpf_history_get(history, seq_num, &size, tsk_null);
+	assert(data);
+	assert(size == expected_size && memcmp(data, expected, size) == 0);
+}
+
+void test_avpf_history()
+{
+	tdav_video_avpf_history_t history = { 0 };
+	uint8_t data[TEST_AVPF_HISTORY_BIG];
+	tsk_size_t size, i;
+	int32_t overwritten_by;
+	uint16_t seq_num, first = 65530; /* wraps */
+	int ret;
+
+	ret = tdav_video_avpf_history_resize(&history, 3);
+	assert(ret != 0); /* not a power of two */
+	ret = tdav_video_avpf_history_resize(&history, 64);
+	assert(ret == 0);
+
+	/* 64 packets, mixed sizes */
+	for(i = 0; i < 64; ++i){
+		seq_num = (uint16_t)(first + i);
+		ret = tdav_video_avpf_history_put(&history, seq_num, data, test_avpf_history_packet(seq_num, data));
+		assert(ret == 0);
+	}
+	for(i = 0; i < 64; ++i){
+		test_avpf_history_check(&history, (uint16_t)(first + i));
+	}
+
+	/* shrink: each slot keeps the newest packet with its own data (small or big) */
+	ret = tdav_video_avpf_history_resize(&history, 16);
+	assert(ret == 0 && history.capacity == 16);
+	for(i = 0; i < 64; ++i){
+		seq_num = (uint16_t)(first + i);
+		if(i >= 48){
+			test_avpf_history_check(&history, seq_num);
+		}
+		else{
+			assert(!tdav_video_avpf_history_get(&history, seq_num, &size, &overwritten_by));
+			assert(overwritten_by == (int32_t)(((63 - i) / 16) * 16) && overwritten_by > 0);
+		}
+	}
+	/* an "ext" buffer only stays with the big packet it belongs to */
+	for(i = 0; i < 16; ++i){
+		assert(!history.slots[i].ext || history.slots[i].ext_size >= TEST_AVPF_HISTORY_BIG);
+	}
+
+	/* grow back: nothing lost */
+	ret = tdav_video_avpf_history_resize(&history, 128);
+	assert(ret == 0);
+	for(i = 48; i < 64; ++i){
+		test_avpf_history_check(&history, (uint16_t)(first + i));
+	}
+
+	/* slot reuse after the shrink: the new packets overwrite the ones sharing the slot */
+	for(i = 64; i < 64 + 128; ++i){
+		seq_num = (uint16_t)(first + i);
+		ret = tdav_video_avpf_history_put(&history, seq_num, data, test_avpf_history_packet(seq_num, data));
+		assert(ret == 0);
+	}
+	ret = tdav_video_avpf_history_resize(&history, 32);
+	assert(ret == 0);
+	for(i = 64 + 128 - 32; i < 64 + 128; ++i){
+		test_avpf_history_check(&history, (uint16_t)(first + i));
+	}
+
+	tdav_video_avpf_history_clear(&history);
+	assert(!tdav_video_avpf_history_get(&history, (uint16_t)(first + 64 + 127), &size, &overwritten_by) && !overwritten_by);
+
+	tdav_video_avpf_history_deinit(&history);
+	assert(!history.slots && !history.storage && !history.capacity);
+
+	TSK_DEBUG_INFO("test_avpf_history: OK");
+}
+
+#endif /* _TINYDEV_TEST_AVPF_HISTORY_H */
@@ -0,0 +1,82 @@
+/*
+* Copyright (C) 2009 Mamadou Diop.
+*
+* Contact: Mamadou Diop <diopmamadou(at)doubango.org>
+*	
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*	
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*	
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*
+*/
+#ifndef _TINYDEV_TEST_G711_H
+#define _TINYDEV_TEST_G711_H
+
+#include "tinydav/codecs/g711/g711.h"
+
+#define TEST_G711_COUNT 65536
+
+/* the block functions (tables, SSE2/AVX2/NEON and the scalar tails) must be bit-exact with the reference ones */
+static void test_g711_block(unsigned int mask)
+{
+	static short pcm[TEST_G711_COUNT], pcm_out[256];
+	static unsigned char codes[TEST_G711_COUNT];
+	unsigned char all[256];
+	int i, offset;
+
+	tsk_cpu_set_flags_mask(mask);
+	for(i = 0; i < TEST_G711_COUNT; ++i){
+		pcm[i] = (short)(i - 32768);
+	}
+	for(i = 0; i < 256; ++i){
+		all[i] = (unsigned char)i;
+	}
+
+	/* aligned and full blocks, then unaligned with a tail */
+	for(offset = 0; offset < 2; ++offset){
+		tsk_size_t count = TEST_G711_COUNT - (offset * 3);
+
+		memset(codes, 0, sizeof(codes));
+		linear2alaw_block(&pcm[offset], codes, count);
+		for(i = 0; i < (int)count; ++i){
+			assert(codes[i] == linear2alaw(pcm[offset + i]));
+		}
+		memset(codes, 0, sizeof(codes));
+		linear2ulaw_block(&pcm[offset], codes, count);
+		for(i = 0; i < (int)count; ++i){
+			assert(codes[i] == linear2ulaw(pcm[offset + i]));
+		}
+	}
+
+	alaw2linear_block(all, pcm_out, 256);
+	for(i = 0; i < 256; ++i){
+		assert(pcm_out[i] == alaw2linear(all[i]));
+	}
+	ulaw2linear_block(all, pcm_out, 256);
+	for(i = 0; i < 256; ++i){
+		assert(pcm_out[i] == ulaw2linear(all[i]));
+	}
+}
+
+void test_g711()
+{
+	/* tables only, then with each SIMD level */
+	test_g711_block(tsk_cpu_flag_none);
+	test_g711_block(tsk_cpu_flag_sse2 | tsk_cpu_flag_neon);
+	test_g711_block(tsk_cpu_flag_all);
+
+	tsk_cpu_set_flags_mask(tsk_cpu_flag_all);
+	TSK_DEBUG_INFO("test_g711: OK");
+}
+
+#endif /* _TINYDEV_TEST_G711_H */
@@ -0,0 +1,192 @@
+/*
+* Copyright (C) 2009 Mamadou Diop.
+*
+* Contact: Mamadou Diop <diopmamadou(at)doubango.org>
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*
+*/
+#ifndef _TINYDEV_TEST_JITTERBUFFER_H
+#define _TINYDEV_TEST_JITTERBUFFER_H
+
+#include "tinydav/audio/tdav_jitterbuffer.h"
+
+#if !(HAVE_SPEEX_DSP && HAVE_SPEEX_JB)
+
+#define TEST_JITTERBUFFER_FRAME_SIZE	160 /* 10ms at 8kHz */
+#define TEST_JITTERBUFFER_FRAMES		400
+#define TEST_JITTERBUFFER_STEPS			(TEST_JITTERBUFFER_FRAMES + 50)
+#define TEST_JITTERBUFFER_POOL_SIZE		64
+/* sender timestamp of frame "n", never zero: the history of a new jitter buffer already holds a zero timestamp */
+#define TEST_JITTERBUFFER_TS(n)			(((n) + 1) * 10)
+
+/* frame "n" is filled with its own index */
+static void test_jitterbuffer_frame(long n, uint8_t* data)
+{
+	memset(data, (n & 0xFF), TEST_JITTERBUFFER_FRAME_SIZE);
+	memcpy(data, &n, sizeof(n));
+}
+
+/* arrival time of frame "n": up to 60ms of jitter, some frames are received after the next one */
+static long test_jitterbuffer_arrival(long n)
+{
+	return (n * 10) + ((n * 37) % 61);
+}
+
+/* "out" gets, for each 10ms step, the index of the frame returned by jb_get() or -(1 + result) when no frame is returned */
+static void test_jitterbuffer_run(tsk_bool_t pool, long* out, jb_info* info)
+{
+	jitterbuffer* jb;
+	uint8_t frame[TEST_JITTERBUFFER_FRAME_SIZE];
+	void* data;
+	long now, n = 0, i;
+	int result;
+
+	jb = pool ? jb_new_with_pool(TEST_JITTERBUFFER_POOL_SIZE, TEST_JITTERBUFFER_FRAME_SIZE) : jb_new();
+	assert(jb);
+
+	for(i = 0, now = 0; i < TEST_JITTERBUFFER_STEPS; ++i, now += 10){
+		/* frames sent in order but received with jitter, every 50th frame is received twice */
+		for(n = 0; n < TEST_JITTERBUFFER_FRAMES; ++n){
+			long arrival = test_jitterbuffer_arrival(n);
+			if(arrival > now - 10 && arrival <= now){
+				long k, count = (n % 50) ? 1 : 2;
+				for(k = 0; k < count; ++k){
+					test_jitterbuffer_frame(n, frame);
+					if(pool){
+						jb_put(jb, frame, JB_TYPE_VOICE, 10, TEST_JITTERBUFFER_TS(n), arrival, JB_CODEC_OTHER);
+					}
+					else{
+						data = malloc(sizeof(frame));
+						assert(data);
+						memcpy(data, frame, sizeof(frame));
+						jb_put(jb, data, JB_TYPE_VOICE, 10, TEST_JITTERBUFFER_TS(n), arrival, JB_CODEC_OTHER);
+					}
+				}
+			}
+		}
+
+		data = tsk_null;
+		result = jb_get(jb, &data, now, 10);
+		if(result == JB_OK){
+			assert(data);
+			memcpy(&out[i], data, sizeof(out[i]));
+			test_jitterbuffer_frame(out[i], frame);
+			assert(memcmp(data, frame, sizeof(frame)) == 0);
+			if(!pool){
+				free(data);
+			}
+		}
+		else{
+			out[i] = -(1 + result);
+		}
+	}
+
+	jb_get_info(jb, info);
+	jb_destroy(jb);
+}
+
+/* slab full: the new frames are dropped, oversized frames too, and smaller frames are not over-read */
+static void test_jitterbuffer_pool_full()
+{
+	jitterbuffer* jb;
+	uint8_t frame[TEST_JITTERBUFFER_FRAME_SIZE + 1];
+	void* data;
+	jb_info info;
+	long n;
+	int result;
+
+	jb = jb_new_with_pool(4, TEST_JITTERBUFFER_FRAME_SIZE);
+	assert(jb);
+
+	for(n = 0; n < 10; ++n){
+		test_jitterbuffer_frame(n, frame);
+		jb_put(jb, frame, JB_TYPE_VOICE, 10, TEST_JITTERBUFFER_TS(n), (n * 10), JB_CODEC_OTHER);
+	}
+	jb_get_info(jb, &info);
+	assert(info.frames_received == 10 && info.frames_dropped == 6);
+
+	/* one slot freed by jb_get(): the next frame takes it */
+	data = tsk_null;
+	for(n = 0; (result = jb_get(jb, &data, 100 + (n * 10), 10)) != JB_OK; ++n){
+		assert(n < 10 && result != JB_NOJB);
+	}
+	memcpy(&n, data, sizeof(n));
+	assert(n == 0);
+	test_jitterbuffer_frame(10, frame);
+	jb_put(jb, frame, JB_TYPE_VOICE, 10, TEST_JITTERBUFFER_TS(10), 100, JB_CODEC_OTHER);
+	jb_get_info(jb, &info);
+	assert(info.frames_dropped == 6);
+
+	/* nothing free anymore */
+	jb_put_with_size(jb, "ctl", 3, JB_TYPE_CONTROL, 0, 0, 100, JB_CODEC_OTHER);
+	jb_get_info(jb, &info);
+	assert(info.frames_dropped == 7);
+	jb_destroy(jb);
+
+	/* only the size of the control frame is copied, bigger frames are dropped */
+	jb = jb_new_with_pool(4, TEST_JITTERBUFFER_FRAME_SIZE);
+	assert(jb);
+	jb_put_with_size(jb, frame, sizeof(frame), JB_TYPE_CONTROL, 0, 0, 0, JB_CODEC_OTHER);
+	jb_put_with_size(jb, "ctl", 3, JB_TYPE_CONTROL, 0, 0, 0, JB_CODEC_OTHER);
+	jb_get_info(jb, &info);
+	assert(info.frames_received == 2 && info.frames_dropped == 1);
+	data = tsk_null;
+	result = jb_get(jb, &data, 0, 10);
+	assert(result == JB_OK && data && memcmp(data, "ctl", 3) == 0);
+	jb_destroy(jb);
+}
+
+void test_jitterbuffer()
+{
+	static long out_heap[TEST_JITTERBUFFER_STEPS], out_pool[TEST_JITTERBUFFER_STEPS];
+	jb_info info_heap, info_pool;
+	long i, ok = 0;
+
+	/* same frames, same output and same statistics with or without a pool */
+	test_jitterbuffer_run(tsk_false, out_heap, &info_heap);
+	test_jitterbuffer_run(tsk_true, out_pool, &info_pool);
+	for(i = 0; i < TEST_JITTERBUFFER_STEPS; ++i){
+		assert(out_heap[i] == out_pool[i]);
+		if(out_heap[i] >= 0){
+			++ok;
+		}
+	}
+	assert(ok > TEST_JITTERBUFFER_FRAMES / 2);
+	assert(info_heap.frames_received == info_pool.frames_received && info_heap.frames_received == TEST_JITTERBUFFER_FRAMES + (TEST_JITTERBUFFER_FRAMES / 50));
+	assert(info_heap.frames_dropped_twice == info_pool.frames_dropped_twice && info_heap.frames_dropped_twice == (TEST_JITTERBUFFER_FRAMES / 50));
+	assert(info_heap.frames_late == info_pool.frames_late);
+	assert(info_heap.frames_lost == info_pool.frames_lost);
+	assert(info_heap.frames_ooo == info_pool.frames_ooo);
+	assert(info_heap.frames_dropped == info_pool.frames_dropped);
+	assert(info_heap.delay == info_pool.delay && info_heap.delay_target == info_pool.delay_target);
+	assert(info_heap.jitter == info_pool.jitter && info_heap.iqr == info_pool.iqr);
+	assert(info_heap.losspct == info_pool.losspct && info_heap.losspct_jb == info_pool.losspct_jb);
+	assert(info_heap.last_voice_ms == info_pool.last_voice_ms && info_heap.silence == info_pool.silence);
+
+	test_jitterbuffer_pool_full();
+}
+
+#else
+
+void test_jitterbuffer()
+{
+	TSK_DEBUG_INFO("Speex jitter buffer: not tested");
+}
+
+#endif /* !(HAVE_SPEEX_DSP && HAVE_SPEEX_JB) */
+
+#endif /* _TINYDEV_TEST_JITTERBUFFER_H */
@@ -0,0 +1,78 @@
+/*
+* Copyright (C) 2009 Mamadou Diop.
+*
+* Contact: Mamadou Diop <diopmamadou(at)doubango.org>
+*	
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*	
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*	
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*
+*/
+#ifndef _TINYDEV_TEST_MIXER_H
+#define _TINYDEV_TEST_MIXER_H
+
+#include "tinydav/audio/tdav_audio_mixer.h"
+
+#define TEST_MIXER_SPEAKERS	4
+#define TEST_MIXER_SAMPLES	(960 + 5) /* 20ms at 48kHz plus a tail */
+
+/* mixes the speakers then builds the mix minus the first speaker (the loud frames saturate) */
+static void test_mixer_run(unsigned int mask, int16_t speakers[TEST_MIXER_SPEAKERS][TEST_MIXER_SAMPLES], int32_t* mix, int16_t* out, int16_t* out_own, tsk_size_t count)
+{
+	int i;
+	tsk_cpu_set_flags_mask(mask);
+	memset(mix, 0, count * sizeof(int32_t));
+	for(i = 0; i < TEST_MIXER_SPEAKERS; ++i){
+		tdav_audio_mixer_add(mix, speakers[i], count);
+	}
+	tdav_audio_mixer_out(mix, tsk_null, out, count);
+	tdav_audio_mixer_out(mix, speakers[0], out_own, count);
+}
+
+void test_mixer()
+{
+	static int16_t speakers[TEST_MIXER_SPEAKERS][TEST_MIXER_SAMPLES];
+	static int32_t mix_ref[TEST_MIXER_SAMPLES], mix[TEST_MIXER_SAMPLES];
+	static int16_t out_ref[TEST_MIXER_SAMPLES], out[TEST_MIXER_SAMPLES], own_ref[TEST_MIXER_SAMPLES], own[TEST_MIXER_SAMPLES];
+	tsk_size_t count, i;
+	int k;
+
+	srand(1234);
+	for(k = 0; k < TEST_MIXER_SPEAKERS; ++k){
+		for(i = 0; i < TEST_MIXER_SAMPLES; ++i){
+			/* first speaker at full scale, including -32768 */
+			speakers[k][i] = k ? (int16_t)((rand() % 20001) - 10000) : (int16_t)((rand() & 1) ? 32767 : -32768);
+		}
+	}
+
+	/* every tail length */
+	for(count = TEST_MIXER_SAMPLES - 8; count <= TEST_MIXER_SAMPLES; ++count){
+		test_mixer_run(tsk_cpu_flag_none, speakers, mix_ref, out_ref, own_ref, count);
+		test_mixer_run(tsk_cpu_flag_all, speakers, mix, out, own, count);
+		assert(memcmp(mix_ref, mix, count * sizeof(int32_t)) == 0);
+		assert(memcmp(out_ref, out, count * sizeof(int16_t)) == 0);
+		assert(memcmp(own_ref, own, count * sizeof(int16_t)) == 0);
+	}
+
+	/* the reference saturates */
+	for(i = 0; i < TEST_MIXER_SAMPLES; ++i){
+		assert(out_ref[i] == (int16_t)(TSK_CLAMP(-32768, mix_ref[i], 32767)));
+		assert(own_ref[i] == (int16_t)(TSK_CLAMP(-32768, mix_ref[i] - speakers[0][i], 32767)));
+	}
+
+	tsk_cpu_set_flags_mask(tsk_cpu_flag_all);
+	TSK_DEBUG_INFO("test_mixer: OK");
+}
+
+#endif /* _TINYDEV_TEST_MIXER_H */
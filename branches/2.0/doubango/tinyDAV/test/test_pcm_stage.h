@@ -0,0 +1,101 @@
+/*
+* Copyright (C) 2009 Mamadou Diop.
+*
+* Contact: Mamadou Diop <diopmamadou(at)doubango.org>
+*	
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*	
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*	
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*
+*/
+#ifndef _TINYDEV_TEST_PCM_STAGE_H
+#define _TINYDEV_TEST_PCM_STAGE_H
+
+#include "tinydav/audio/tdav_audio_pcm_stage.h"
+
+#define TEST_PCM_STAGE_SAMPLES	965
+
+/* processes the same frames with the scalar code and with the SIMD code: the samples and the levels must match */
+static void test_pcm_stage_compare(const int16_t* pcm, tsk_size_t count, uint8_t gain)
+{
+	static int16_t ref[TEST_PCM_STAGE_SAMPLES], simd[TEST_PCM_STAGE_SAMPLES];
+	tdav_audio_pcm_stage_t stage_ref, stage_simd;
+	int frame, ret;
+
+	tdav_audio_pcm_stage_init(&stage_ref);
+	tdav_audio_pcm_stage_init(&stage_simd);
+	for(frame = 0; frame < 3; ++frame){ /* more than one frame: the VAD keeps a state */
+		memcpy(ref, pcm, count * sizeof(int16_t));
+		memcpy(simd, pcm, count * sizeof(int16_t));
+		tsk_cpu_set_flags_mask(tsk_cpu_flag_none);
+		ret = tdav_audio_pcm_stage_process(&stage_ref, ref, count * sizeof(int16_t), 16, gain);
+		assert(ret == 0);
+		tsk_cpu_set_flags_mask(tsk_cpu_flag_all);
+		ret = tdav_audio_pcm_stage_process(&stage_simd, simd, count * sizeof(int16_t), 16, gain);
+		assert(ret == 0);
+		assert(memcmp(ref, simd, count * sizeof(int16_t)) == 0);
+		assert(memcmp(&stage_ref.levels, &stage_simd.levels, sizeof(stage_ref.levels)) == 0);
+		assert(stage_ref.noise_floor == stage_simd.noise_floor);
+	}
+	if(!gain){
+		assert(memcmp(ref, pcm, count * sizeof(int16_t)) == 0); /* unity gain: the samples are not changed */
+	}
+}
+
+void test_pcm_stage()
+{
+	static int16_t loud[TEST_PCM_STAGE_SAMPLES], quiet[TEST_PCM_STAGE_SAMPLES];
+	tdav_audio_pcm_stage_t stage;
+	tsk_size_t count, i;
+	uint8_t gain;
+	int ret;
+
+	srand(4321);
+	for(i = 0; i < TEST_PCM_STAGE_SAMPLES; ++i){
+		/* full scale (including -32768) every 7 samples, around the knee otherwise */
+		loud[i] = (i % 7) ? (int16_t)((rand() % 60001) - 30000) : ((i & 1) ? 32767 : -32768);
+		quiet[i] = (int16_t)((rand() % 601) - 300);
+	}
+
+	for(gain = 0; gain <= 7; ++gain){ /* 7 is capped to 6 */
+		/* odd lengths: the SIMD loops leave a tail to the scalar code */
+		for(count = 1; count <= 17; ++count){
+			test_pcm_stage_compare(loud, count, gain);
+			test_pcm_stage_compare(quiet, count, gain);
+		}
+		for(count = TEST_PCM_STAGE_SAMPLES - 8; count <= TEST_PCM_STAGE_SAMPLES; ++count){
+			test_pcm_stage_compare(loud, count, gain);
+			test_pcm_stage_compare(quiet, count, gain);
+		}
+	}
+
+	/* levels */
+	tdav_audio_pcm_stage_init(&stage);
+	memcpy(quiet, loud, sizeof(loud));
+	ret = tdav_audio_pcm_stage_process(&stage, quiet, sizeof(quiet), 16, 0);
+	assert(ret == 0);
+	assert(stage.levels.peak == 32767 && stage.levels.clipped == 0 && stage.levels.dbov > -10 && stage.levels.dbov <= 0);
+	ret = tdav_audio_pcm_stage_process(&stage, quiet, sizeof(quiet), 16, 2);
+	assert(ret == 0);
+	assert(stage.levels.peak == 32767 && stage.levels.clipped > 0);
+	memset(quiet, 0, sizeof(quiet));
+	ret = tdav_audio_pcm_stage_process(&stage, quiet, sizeof(quiet), 16, 6);
+	assert(ret == 0);
+	assert(stage.levels.rms == 0 && stage.levels.peak == 0 && stage.levels.dbov == -127);
+
+	tsk_cpu_set_flags_mask(tsk_cpu_flag_all);
+	TSK_DEBUG_INFO("test_pcm_stage: OK");
+}
+
+#endif /* _TINYDEV_TEST_PCM_STAGE_H */
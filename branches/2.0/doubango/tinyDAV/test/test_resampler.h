@@ -0,0 +1,153 @@
+/*
+* Copyright (C) 2009 Mamadou Diop.
+*
+* Contact: Mamadou Diop <diopmamadou(at)doubango.org>
+*	
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*	
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*	
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*
+*/
+#ifndef _TINYDEV_TEST_RESAMPLER_H
+#define _TINYDEV_TEST_RESAMPLER_H
+
+#include "tinymedia/tmedia_resampler.h"
+#include "tinydav/audio/tdav_audio_resampler.h"
+
+#include <math.h>
+
+#define TEST_RESAMPLER_PTIME		20
+#define TEST_RESAMPLER_FRAMES		50 /* one second */
+#define TEST_RESAMPLER_SAMPLES_MAX	((48000 * TEST_RESAMPLER_PTIME) / 1000)
+#define TEST_RESAMPLER_AMPLITUDE	16000.0
+/* minimum quality (dB): the 16-bit output is limited by its quantization noise */
+#define TEST_RESAMPLER_SNR_INT16	75.0
+#define TEST_RESAMPLER_SNR_FLOAT	100.0
+#define TEST_RESAMPLER_SNR_LOW		65.0 /* quality = 0 */
+#define TEST_RESAMPLER_ATTENUATION	80.0
+
+#ifndef M_PI
+#	define M_PI 3.14159265358979323846
+#endif
+
+/* signal to noise ratio (dB) of "y": the sine at "freq" fitted by least squares against the rest */
+static double test_resampler_snr(const double* y, tsk_size_t count, double freq, double rate)
+{
+	double ss = 0, cc = 0, sc = 0, ys = 0, yc = 0, a, b, det, fit, signal = 0, noise = 0, s, c;
+	tsk_size_t i;
+	for(i = 0; i < count; ++i){
+		s = sin(2.0 * M_PI * freq * i / rate), c = cos(2.0 * M_PI * freq * i / rate);
+		ss += s * s, cc += c * c, sc += s * c, ys += y[i] * s, yc += y[i] * c;
+	}
+	det = (ss * cc) - (sc * sc);
+	a = ((ys * cc) - (yc * sc)) / det;
+	b = ((yc * ss) - (ys * sc)) / det;
+	for(i = 0; i < count; ++i){
+		fit = (a * sin(2.0 * M_PI * freq * i / rate)) + (b * cos(2.0 * M_PI * freq * i / rate));
+		signal += fit * fit;
+		noise += (y[i] - fit) * (y[i] - fit);
+	}
+	return 10.0 * log10(signal / TSK_MAX(noise, 1e-9));
+}
+
+/* resamples one second of a sine with "freq" and returns the output (without the first frame, the filter history starts empty) */
+static tsk_size_t test_resampler_run(unsigned int mask, uint32_t in_freq, uint32_t out_freq, uint32_t quality, uint32_t bits_per_sample, double freq, double* y)
+{
+	static union { int16_t i16[TEST_RESAMPLER_SAMPLES_MAX]; float f32[TEST_RESAMPLER_SAMPLES_MAX]; } in, out;
+	tmedia_resampler_t* resampler;
+	tsk_size_t in_size = (in_freq * TEST_RESAMPLER_PTIME) / 1000, out_size = (out_freq * TEST_RESAMPLER_PTIME) / 1000, i, n, count = 0;
+	int frame, ret;
+
+	tsk_cpu_set_flags_mask(mask); /* the dot products are selected when the resampler is created */
+	resampler = tmedia_resampler_create();
+	assert(resampler);
+	ret = tmedia_resampler_open(resampler, in_freq, out_freq, TEST_RESAMPLER_PTIME, 1, 1, quality, bits_per_sample);
+	assert(ret == 0);
+	for(frame = 0; frame < TEST_RESAMPLER_FRAMES; ++frame){
+		for(i = 0; i < in_size; ++i){
+			double x = TEST_RESAMPLER_AMPLITUDE * sin(2.0 * M_PI * freq * ((frame * in_size) + i) / in_freq);
+			if(bits_per_sample == 16){
+				in.i16[i] = (int16_t)floor(x + 0.5);
+			}
+			else{
+				in.f32[i] = (float)x;
+			}
+		}
+		n = tmedia_resampler_process(resampler, &in, in_size, &out, out_size);
+		assert(n == out_size);
+		for(i = 0; frame > 0 && i < n; ++i){
+			y[count++] = (bits_per_sample == 16) ? out.i16[i] : out.f32[i];
+		}
+	}
+	TSK_OBJECT_SAFE_FREE(resampler);
+	return count;
+}
+
+static void test_resampler_check(uint32_t in_freq, uint32_t out_freq, uint32_t quality, uint32_t bits_per_sample, double freq, double snr_min)
+{
+	static double y_ref[TEST_RESAMPLER_SAMPLES_MAX * TEST_RESAMPLER_FRAMES], y[TEST_RESAMPLER_SAMPLES_MAX * TEST_RESAMPLER_FRAMES];
+	tsk_size_t count_ref, count, i;
+	double snr_ref, snr, diff_max = 0;
+
+	count_ref = test_resampler_run(tsk_cpu_flag_none, in_freq, out_freq, quality, bits_per_sample, freq, y_ref);
+	count = test_resampler_run(tsk_cpu_flag_all, in_freq, out_freq, quality, bits_per_sample, freq, y);
+	assert(count == count_ref);
+	for(i = 0; i < count; ++i){
+		diff_max = TSK_MAX(diff_max, fabs(y[i] - y_ref[i]));
+	}
+	snr_ref = test_resampler_snr(y_ref, count_ref, freq, out_freq);
+	snr = test_resampler_snr(y, count, freq, out_freq);
+	TSK_DEBUG_INFO("resampler %u->%u quality=%u bits=%u tone=%.0fHz: SNR=%.1fdB (scalar=%.1fdB) max diff=%g", in_freq, out_freq, quality, bits_per_sample, freq, snr, snr_ref, diff_max);
+	/* same filter: the SIMD code only changes the summation order (exact with the integer path) */
+	assert(bits_per_sample == 16 ? (diff_max == 0) : (diff_max < 0.05));
+	assert(snr_ref >= snr_min && snr >= snr_min);
+}
+
+/* a tone above the output Nyquist frequency must be filtered out, not folded back */
+static void test_resampler_alias(uint32_t in_freq, uint32_t out_freq, uint32_t quality, double freq, double attenuation_min)
+{
+	static double y[TEST_RESAMPLER_SAMPLES_MAX * TEST_RESAMPLER_FRAMES];
+	tsk_size_t count, i;
+	double energy = 0, attenuation;
+
+	count = test_resampler_run(tsk_cpu_flag_all, in_freq, out_freq, quality, 32, freq, y);
+	for(i = 0; i < count; ++i){
+		energy += y[i] * y[i];
+	}
+	attenuation = 10.0 * log10(((TEST_RESAMPLER_AMPLITUDE * TEST_RESAMPLER_AMPLITUDE) / 2.0) / TSK_MAX(energy / count, 1e-9));
+	TSK_DEBUG_INFO("resampler %u->%u quality=%u tone=%.0fHz: attenuation=%.1fdB", in_freq, out_freq, quality, freq, attenuation);
+	assert(attenuation >= attenuation_min);
+}
+
+void test_resampler()
+{
+	static const uint32_t rates[][2] = { {8000, 16000}, {16000, 8000}, {44100, 48000}, {48000, 44100}, {48000, 16000}, {16000, 48000}, {32000, 8000} };
+	tsk_size_t i;
+
+	for(i = 0; i < sizeof(rates) / sizeof(rates[0]); ++i){
+		/* 1 kHz is in the pass band of all the conversions */
+		test_resampler_check(rates[i][0], rates[i][1], 10, 16, 1000.0, TEST_RESAMPLER_SNR_INT16);
+		test_resampler_check(rates[i][0], rates[i][1], 10, 32, 1000.0, TEST_RESAMPLER_SNR_FLOAT);
+		test_resampler_check(rates[i][0], rates[i][1], 0, 16, 1000.0, TEST_RESAMPLER_SNR_LOW);
+	}
+
+	test_resampler_alias(48000, 8000, 10, 6000.0, TEST_RESAMPLER_ATTENUATION);
+	test_resampler_alias(16000, 8000, 10, 5000.0, TEST_RESAMPLER_ATTENUATION);
+	test_resampler_alias(44100, 16000, 10, 12000.0, TEST_RESAMPLER_ATTENUATION);
+
+	tsk_cpu_set_flags_mask(tsk_cpu_flag_all);
+	TSK_DEBUG_INFO("test_resampler: OK");
+}
+
+#endif /* _TINYDEV_TEST_RESAMPLER_H */
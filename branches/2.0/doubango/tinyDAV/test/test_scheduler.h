@@ -0,0 +1,109 @@
+/*
+* Copyright (C) 2009 Mamadou Diop.
+*
+* Contact: Mamadou Diop <diopmamadou(at)doubango.org>
+*	
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*	
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*	
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*
+*/
+#ifndef _TINYDEV_TEST_SCHEDULER_H
+#define _TINYDEV_TEST_SCHEDULER_H
+
+#include "tinydav/audio/tdav_audio_scheduler.h"
+
+#define TEST_SCHEDULER_DURATION		1000 /* ms */
+
+static volatile int test_scheduler_counts[4];
+static volatile int test_scheduler_busy;
+
+static int test_scheduler_cb(const void* callback_data)
+{
+	++test_scheduler_counts[(int)(intptr_t)callback_data];
+	return 0;
+}
+
+/* removes itself after 5 calls */
+static int test_scheduler_cb_self_remove(const void* callback_data)
+{
+	if(++test_scheduler_counts[(int)(intptr_t)callback_data] == 5){
+		tdav_audio_scheduler_remove(callback_data);
+	}
+	return 0;
+}
+
+/* slow callback: remove() must wait for it */
+static int test_scheduler_cb_slow(const void* callback_data)
+{
+	test_scheduler_busy = 1;
+	++test_scheduler_counts[(int)(intptr_t)callback_data];
+	tsk_thread_sleep(15);
+	test_scheduler_busy = 0;
+	return 0;
+}
+
+void test_scheduler()
+{
+	int counts[4], i, ret;
+	tsk_size_t entries_count;
+
+	memset((void*)test_scheduler_counts, 0, sizeof(test_scheduler_counts));
+	test_scheduler_busy = 0;
+
+	/* only possible if no audio session started the workers yet */
+	tdav_audio_scheduler_set_workers_count(2);
+
+	ret = tdav_audio_scheduler_add((const void*)(intptr_t)0, test_scheduler_cb, 20);
+	assert(ret == 0);
+	ret = tdav_audio_scheduler_add((const void*)(intptr_t)1, test_scheduler_cb, 10);
+	assert(ret == 0);
+	ret = tdav_audio_scheduler_add((const void*)(intptr_t)2, test_scheduler_cb_self_remove, 10);
+	assert(ret == 0);
+	ret = tdav_audio_scheduler_add((const void*)(intptr_t)3, test_scheduler_cb_slow, 40);
+	assert(ret == 0);
+
+	tsk_thread_sleep(TEST_SCHEDULER_DURATION);
+
+	/* returns once the callback is no longer running */
+	ret = tdav_audio_scheduler_remove((const void*)(intptr_t)3);
+	assert(ret == 0);
+	assert(!test_scheduler_busy);
+	ret = tdav_audio_scheduler_remove((const void*)(intptr_t)0);
+	assert(ret == 0);
+	ret = tdav_audio_scheduler_remove((const void*)(intptr_t)1);
+	assert(ret == 0);
+	for(i = 0; i < 4; ++i){
+		counts[i] = test_scheduler_counts[i];
+	}
+
+	/* one call per ptime: late ticks are skipped, never burst */
+	assert(counts[0] > 0 && counts[0] <= (TEST_SCHEDULER_DURATION / 20) + 1);
+	assert(counts[1] > counts[0] && counts[1] <= (TEST_SCHEDULER_DURATION / 10) + 1);
+	assert(counts[2] == 5);
+	assert(counts[3] > 0 && counts[3] <= (TEST_SCHEDULER_DURATION / 40) + 1);
+
+	/* never called again */
+	tsk_thread_sleep(100);
+	for(i = 0; i < 4; ++i){
+		assert(counts[i] == test_scheduler_counts[i]);
+	}
+	ret = tdav_audio_scheduler_get_stats(&entries_count, tsk_null, tsk_null);
+	assert(ret == 0);
+	assert(entries_count == 0);
+
+	TSK_DEBUG_INFO("test_scheduler: OK");
+}
+
+#endif /* _TINYDEV_TEST_SCHEDULER_H */
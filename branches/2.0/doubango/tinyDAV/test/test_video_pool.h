@@ -0,0 +1,232 @@
+/*
+* Copyright (C) 2009 Mamadou Diop.
+*
+* Contact: Mamadou Diop <diopmamadou(at)doubango.org>
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*
+*/
+#ifndef _TINYDEV_TEST_VIDEO_POOL_H
+#define _TINYDEV_TEST_VIDEO_POOL_H
+
+#include "tinydav/video/tdav_video_pool.h"
+#include "tinydav/video/jb/tdav_video_jb.h"
+
+#include "tinyrtp/rtp/trtp_rtp_packet.h"
+
+#define TEST_VIDEO_POOL_STREAMS		4
+#define TEST_VIDEO_POOL_JOBS		200 /* per stream */
+#define TEST_VIDEO_POOL_FRAMES		30
+
+typedef struct test_video_pool_ctx_s
+{
+	struct tdav_video_pool_stream_s* stream;
+	volatile long running;
+	volatile int count;
+	int errors;
+}
+test_video_pool_ctx_t;
+
+/* re-posts itself until TEST_VIDEO_POOL_JOBS ran, every 8th job is delayed */
+static int test_video_pool_cb(const void* callback_data)
+{
+	test_video_pool_ctx_t* ctx = (test_video_pool_ctx_t*)callback_data;
+	tsk_atomic_inc(&ctx->running);
+	if(ctx->running != 1){ /* another job of the stream is running */
+		++ctx->errors;
+	}
+	tsk_thread_sleep(0);
+	if(++ctx->count < TEST_VIDEO_POOL_JOBS){
+		if(tdav_video_pool_post(ctx->stream, (ctx->count & 1) ? tdav_video_pool_stage_decode : tdav_video_pool_stage_encode, test_video_pool_cb, ctx, (ctx->count & 7) ? 0 : 2) != 0){
+			++ctx->errors;
+		}
+	}
+	tsk_atomic_dec(&ctx->running);
+	return 0;
+}
+
+static volatile int test_video_pool_order[TDAV_VIDEO_POOL_STREAM_JOBS_MAX];
+static volatile int test_video_pool_order_count;
+
+/* jobs posted in a row must run in the posting order */
+static int test_video_pool_cb_order(const void* callback_data)
+{
+	test_video_pool_order[test_video_pool_order_count++] = (int)(intptr_t)callback_data;
+	return 0;
+}
+
+static volatile int test_video_pool_busy;
+
+/* slow job: close() must wait for it */
+static int test_video_pool_cb_slow(const void* callback_data)
+{
+	test_video_pool_busy = 1;
+	tsk_thread_sleep(100);
+	test_video_pool_busy = 0;
+	return 0;
+}
+
+static volatile int test_video_pool_jb_frames;
+static volatile int test_video_pool_jb_pkts;
+
+static int test_video_pool_jb_cb(const tdav_video_jb_cb_data_xt* data)
+{
+	if(data->type == tdav_video_jb_cb_data_type_rtp){
+		++test_video_pool_jb_pkts;
+		if(data->rtp.pkt->header->marker){
+			++test_video_pool_jb_frames;
+		}
+	}
+	return 0;
+}
+
+/* feeds a jitter buffer at 15fps and counts the frames delivered by the decode job */
+static void test_video_pool_jb()
+{
+	struct tdav_video_jb_s* jb;
+	trtp_rtp_packet_t* pkt;
+	uint8_t payload[500] = { 0 };
+	uint16_t seq_num = 100;
+	int f, p, ret;
+
+	test_video_pool_jb_frames = test_video_pool_jb_pkts = 0;
+
+	jb = tdav_video_jb_create();
+	assert(jb);
+	ret = tdav_video_jb_set_callback(jb, test_video_pool_jb_cb, tsk_null);
+	assert(ret == 0);
+	ret = tdav_video_jb_set_fps(jb, 15);
+	assert(ret == 0);
+	ret = tdav_video_jb_start(jb);
+	assert(ret == 0);
+	for(f = 0; f < TEST_VIDEO_POOL_FRAMES; ++f){
+		for(p = 0; p < 3; ++p){
+			pkt = trtp_rtp_packet_create(0x1234, seq_num++, f * 6000, 96, (p == 2));
+			assert(pkt);
+			pkt->payload.data_const = payload;
+			pkt->payload.size = sizeof(payload);
+			ret = tdav_video_jb_put(jb, pkt);
+			assert(ret == 0);
+			TSK_OBJECT_SAFE_FREE(pkt);
+		}
+		tsk_thread_sleep(66);
+	}
+	tsk_thread_sleep(500);
+	ret = tdav_video_jb_stop(jb);
+	assert(ret == 0);
+	/* the last frames may still be held for reordering */
+	assert(test_video_pool_jb_frames >= TEST_VIDEO_POOL_FRAMES - 3);
+	assert(test_video_pool_jb_pkts == test_video_pool_jb_frames * 3);
+	/* nothing is delivered once stopped */
+	f = test_video_pool_jb_frames;
+	tsk_thread_sleep(100);
+	assert(test_video_pool_jb_frames == f);
+
+	TSK_OBJECT_SAFE_FREE(jb);
+}
+
+void test_video_pool()
+{
+	test_video_pool_ctx_t ctxs[TEST_VIDEO_POOL_STREAMS];
+	tdav_video_pool_stats_t stats_dec, stats_enc;
+	struct tdav_video_pool_stream_s* stream;
+	int i, done, loops, ret;
+
+	/* only possible if no video session started the workers yet */
+	tdav_video_pool_set_workers_count(2);
+
+	/* jobs of the same stream are serialized even when the workers steal them */
+	memset(ctxs, 0, sizeof(ctxs));
+	for(i = 0; i < TEST_VIDEO_POOL_STREAMS; ++i){
+		ctxs[i].stream = tdav_video_pool_stream_create();
+		assert(ctxs[i].stream);
+	}
+	for(i = 0; i < TEST_VIDEO_POOL_STREAMS; ++i){
+		ret = tdav_video_pool_post(ctxs[i].stream, tdav_video_pool_stage_decode, test_video_pool_cb, &ctxs[i], 0);
+		assert(ret == 0);
+	}
+	for(loops = 0; loops < 500; ++loops){
+		for(i = 0, done = 0; i < TEST_VIDEO_POOL_STREAMS; ++i){
+			done += (ctxs[i].count == TEST_VIDEO_POOL_JOBS);
+		}
+		if(done == TEST_VIDEO_POOL_STREAMS){
+			break;
+		}
+		tsk_thread_sleep(10);
+	}
+	for(i = 0; i < TEST_VIDEO_POOL_STREAMS; ++i){
+		assert(ctxs[i].count == TEST_VIDEO_POOL_JOBS);
+		assert(ctxs[i].errors == 0);
+		ret = tdav_video_pool_stream_close(ctxs[i].stream);
+		assert(ret == 0);
+		TSK_OBJECT_SAFE_FREE(ctxs[i].stream);
+	}
+
+	ret = tdav_video_pool_get_stats(tdav_video_pool_stage_decode, &stats_dec);
+	assert(ret == 0);
+	ret = tdav_video_pool_get_stats(tdav_video_pool_stage_encode, &stats_enc);
+	assert(ret == 0);
+	assert(stats_dec.jobs_count + stats_enc.jobs_count >= TEST_VIDEO_POOL_STREAMS * TEST_VIDEO_POOL_JOBS);
+	assert(stats_dec.queue_depth == 0 && stats_enc.queue_depth == 0);
+	assert(stats_dec.queue_depth_max >= 1);
+
+	/* ordering and queue limit */
+	stream = tdav_video_pool_stream_create();
+	assert(stream);
+	test_video_pool_order_count = 0;
+	ret = tdav_video_pool_post(stream, tdav_video_pool_stage_decode, test_video_pool_cb_slow, tsk_null, 0);
+	assert(ret == 0);
+	for(i = 0; i < TDAV_VIDEO_POOL_STREAM_JOBS_MAX - 1; ++i){
+		ret = tdav_video_pool_post(stream, tdav_video_pool_stage_encode, test_video_pool_cb_order, (const void*)(intptr_t)i, 0);
+		assert(ret == 0);
+	}
+	tsk_thread_sleep(200);
+	assert(test_video_pool_order_count == TDAV_VIDEO_POOL_STREAM_JOBS_MAX - 1);
+	for(i = 0; i < TDAV_VIDEO_POOL_STREAM_JOBS_MAX - 1; ++i){
+		assert(test_video_pool_order[i] == i);
+	}
+
+	/* close() returns once the running job completed and drops the pending ones */
+	ret = tdav_video_pool_post(stream, tdav_video_pool_stage_decode, test_video_pool_cb_slow, tsk_null, 0);
+	assert(ret == 0);
+	ret = tdav_video_pool_post(stream, tdav_video_pool_stage_encode, test_video_pool_cb_order, (const void*)(intptr_t)-1, 50);
+	assert(ret == 0);
+	while(!test_video_pool_busy){
+		tsk_thread_sleep(1);
+	}
+	ret = tdav_video_pool_stream_close(stream);
+	assert(ret == 0);
+	assert(!test_video_pool_busy);
+	ret = tdav_video_pool_post(stream, tdav_video_pool_stage_encode, test_video_pool_cb_order, tsk_null, 0);
+	assert(ret == -2);
+	tsk_thread_sleep(100);
+	assert(test_video_pool_order_count == TDAV_VIDEO_POOL_STREAM_JOBS_MAX - 1);
+	TSK_OBJECT_SAFE_FREE(stream);
+
+	/* jitter buffer decoding on the pool */
+	test_video_pool_jb();
+
+	/* jitter buffer decoding on its own thread when no stream can be created */
+	ret = tdav_video_pool_deinit();
+	assert(ret == 0);
+	stream = tdav_video_pool_stream_create();
+	assert(!stream);
+	test_video_pool_jb();
+	ret = tdav_video_pool_init();
+	assert(ret == 0);
+}
+
+#endif /* _TINYDEV_TEST_VIDEO_POOL_H */
@@ -144,6 +144,18 @@
 #	define TNET_HAVE_SA_LEN		0
 #endif
 
+/* have epoll()? Linux only. Takes precedence over poll() for the network transport. */
+#if !defined(TNET_USE_EPOLL)
+#	if USE_EPOLL && defined(__linux__)
+#		define TNET_USE_EPOLL	1
+#	else
+#		define TNET_USE_EPOLL	0
+#	endif
+#endif
+#if !defined(TNET_EPOLL_EDGE_TRIGGERED)
+#	define TNET_EPOLL_EDGE_TRIGGERED	0
+#endif
+
 #endif /* _TINYNET_H_ */
 
 
@@ -27,13 +27,92 @@
 
 #include "tsk_object.h"
 #include "tsk_string.h"
+#include "tsk_buffer.h"
 #include "tsk_memory.h"
 #include "tsk_debug.h"
 #include "tsk_safeobj.h"
+#include "tsk_time.h"
 
-#define TNET_TLS_TIMEOUT		2000
-#define TNET_TLS_RETRY_COUNT	10
+#if HAVE_OPENSSL
+#	include <openssl/rand.h>
+#	include <openssl/hmac.h>
+#	if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#		include <openssl/core_names.h>
+#	endif
+#	if OPENSSL_VERSION_NUMBER >= 0x30000000L || defined(SSL_CTRL_SET_TLSEXT_TICKET_KEY_CB)
+#		define TNET_TLS_HAVE_TICKETS	1
+#	else
+#		define TNET_TLS_HAVE_TICKETS	0
+#	endif
+#endif
+
+/* maximum amount of data queued on a socket (plaintext waiting for the handshake or ciphertext waiting for the network) */
+#define TNET_TLS_PENDING_MAX	0x400000
+/* size of the chunks moved from the write BIO to the network */
+#define TNET_TLS_CHUNK_SIZE		0x4000
+
+#if defined(MSG_DONTWAIT)
+#	define TNET_TLS_MSG_FLAGS	MSG_DONTWAIT
+#else
+#	define TNET_TLS_MSG_FLAGS	0 /* WinSock: sockets are non-blocking once WSAEventSelect()ed */
+#endif
+
+#if TNET_UNDER_WINDOWS
+#	define TNET_TLS_WOULDBLOCK(err) ((err) == TNET_ERROR_WOULDBLOCK || (err) == TNET_ERROR_INPROGRESS || (err) == TNET_ERROR_INTR || (err) == WSAENOTCONN)
+#else
+#	define TNET_TLS_WOULDBLOCK(err) ((err) == TNET_ERROR_WOULDBLOCK || (err) == TNET_ERROR_EAGAIN || (err) == TNET_ERROR_INPROGRESS || (err) == TNET_ERROR_INTR)
+#endif
 
+/* session id context: sessions are only resumed on the listener which issued them */
+static const unsigned char __tnet_tls_sid_ctx[] = "doubango-tls";
+
+/*
+* Sessions shared by all the TLS sockets of a transport (attached to the SSL contexts as "app data"):
+*	- server: size-bounded OpenSSL cache (session ids) and RFC 5077 tickets. The ticket keys are rotated every
+*	"ticket_key_rotation" seconds and the previous key is still accepted (tickets renewed) during one more period.
+*	- client: the last session received from each destination ("host:port"), offered on the next connection.
+*/
+typedef struct tnet_tls_ticket_key_s
+{
+	unsigned char name[16];
+	unsigned char aes_key[32];
+	unsigned char hmac_key[32];
+	uint64_t created; // tsk_time_now(), zero if not generated yet
+}
+tnet_tls_ticket_key_t;
+
+typedef struct tnet_tls_client_session_s
+{
+	char* destination;
+	void* session; // SSL_SESSION
+	uint64_t last_use;
+}
+tnet_tls_client_session_t;
+
+typedef struct tnet_tls_sessions_s
+{
+	TSK_DECLARE_OBJECT;
+
+	tsk_size_t cache_size;
+	uint32_t lifetime; // seconds
+	uint32_t ticket_key_rotation; // seconds
+
+	tnet_tls_ticket_key_t keys[2]; // current and previous
+	tnet_tls_client_session_t clients[TNET_TLS_CLIENT_SESSIONS_MAX];
+	tnet_tls_stats_t stats;
+
+	TSK_DECLARE_SAFEOBJ;
+}
+tnet_tls_sessions_t;
+
+/*
+* The TLS engine never touches the socket through OpenSSL: the records are exchanged using memory BIOs and
+* the socket is only read when the I/O thread reports it as readable. Nothing blocks: the data the kernel cannot
+* accept is queued on the socket ("pending_out") and flushed when the transport reports the socket as writable
+* (see tnet_tls_socket_want_write() and tnet_tls_socket_flush()). The application data sent before the end of the
+* handshake (or while a renegotiation waits for the peer) is queued too ("pending_plain") and encrypted as soon as
+* the handshake completes, that is when the socket is readable again.
+*/
 typedef struct tnet_tls_socket_s
 {
 	TSK_DECLARE_OBJECT;
@@ -42,7 +121,15 @@ typedef struct tnet_tls_socket_s
 
 #if HAVE_OPENSSL
 	SSL *ssl;
+	BIO* rbio; /* network -> SSL, owned by "ssl" */
+	BIO* wbio; /* SSL -> network, owned by "ssl" */
 #endif
+	tsk_buffer_t* pending_plain;
+	tsk_buffer_t* pending_out;
+
+	tnet_tls_sessions_t* sessions; /* from the SSL context, may be null */
+	char* destination; /* "host:port", client only */
+	tsk_bool_t is_client;
 
 	TSK_DECLARE_SAFEOBJ;
 }
@@ -75,8 +162,22 @@ tnet_tls_socket_handle_t* tnet_tls_socket_create(tnet_fd_t fd, struct ssl_ctx_st
 			TSK_OBJECT_SAFE_FREE(socket);
 			return tsk_null;
 		}
-		if(SSL_set_fd(socket->ssl, socket->fd) != 1){
-			TSK_DEBUG_ERROR("SSL_set_fd(%d) failed [%s]", socket->fd, ERR_error_string(ERR_get_error(), tsk_null));
+		if(!(socket->rbio = BIO_new(BIO_s_mem())) || !(socket->wbio = BIO_new(BIO_s_mem()))){
+			TSK_DEBUG_ERROR("BIO_new() failed [%s]", ERR_error_string(ERR_get_error(), tsk_null));
+			if(socket->rbio){
+				BIO_free(socket->rbio), socket->rbio = tsk_null;
+			}
+			TSK_OBJECT_SAFE_FREE(socket);
+			return tsk_null;
+		}
+		BIO_set_mem_eof_return(socket->rbio, -1); /* empty means "retry", not "end of stream" */
+		SSL_set_bio(socket->ssl, socket->rbio, socket->wbio);
+		SSL_set_app_data(socket->ssl, socket);
+		/* "pending_plain" may be reallocated between a write returning SSL_ERROR_WANT_READ and its retry */
+		SSL_set_mode(socket->ssl, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+		socket->sessions = tsk_object_ref(SSL_CTX_get_app_data(ssl_ctx));
+		if(!(socket->pending_plain = tsk_buffer_create_null()) || !(socket->pending_out = tsk_buffer_create_null())){
+			TSK_DEBUG_ERROR("Failed to create buffers");
 			TSK_OBJECT_SAFE_FREE(socket);
 			return tsk_null;
 		}
@@ -85,7 +186,351 @@ tnet_tls_socket_handle_t* tnet_tls_socket_create(tnet_fd_t fd, struct ssl_ctx_st
 #endif
 }
 
-int tnet_tls_socket_connect(tnet_tls_socket_handle_t* self)
+struct tnet_tls_sessions_s* tnet_tls_sessions_create()
+{
+	tnet_tls_sessions_t* sessions;
+	if((sessions = tsk_object_new(tnet_tls_sessions_def_t))){
+		sessions->cache_size = TNET_TLS_SESSION_CACHE_SIZE;
+		sessions->lifetime = TNET_TLS_SESSION_LIFETIME;
+		sessions->ticket_key_rotation = TNET_TLS_TICKET_KEY_ROTATION;
+	}
+	return sessions;
+}
+
+/** Configures the sessions. Must be followed by tnet_tls_sessions_attach() to update the SSL contexts.
+* @param cache_size maximum number of sessions in the server cache, zero to disable the cache.
+* @param lifetime lifetime of the sessions (and tickets) in seconds.
+* @param ticket_key_rotation interval between two ticket keys in seconds, zero to disable the tickets.
+*/
+int tnet_tls_sessions_set(struct tnet_tls_sessions_s* self, tsk_size_t cache_size, uint32_t lifetime, uint32_t ticket_key_rotation)
+{
+	if(!self || !lifetime){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	tsk_safeobj_lock(self);
+	self->cache_size = cache_size;
+	self->lifetime = lifetime;
+	self->ticket_key_rotation = ticket_key_rotation;
+	tsk_safeobj_unlock(self);
+	return 0;
+}
+
+int tnet_tls_sessions_get_stats(struct tnet_tls_sessions_s* self, tnet_tls_stats_t* stats)
+{
+	tsk_size_t i;
+	if(!self || !stats){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	tsk_safeobj_lock(self);
+	*stats = self->stats;
+	for(i = 0, stats->client_sessions = 0; i < TNET_TLS_CLIENT_SESSIONS_MAX; ++i){
+		if(self->clients[i].session){
+			++stats->client_sessions;
+		}
+	}
+	tsk_safeobj_unlock(self);
+	return 0;
+}
+
+#if HAVE_OPENSSL
+/* must be called with the lock held */
+static int _tnet_tls_sessions_rotate(tnet_tls_sessions_t* self, uint64_t now)
+{
+	uint64_t period = (uint64_t)self->ticket_key_rotation * 1000;
+	if(self->keys[0].created && (now - self->keys[0].created) < period){
+		return 0;
+	}
+	if(self->keys[0].created && (now - self->keys[0].created) < (period << 1)){
+		self->keys[1] = self->keys[0];
+	}
+	else{
+		memset(&self->keys[1], 0, sizeof(self->keys[1])); /* no rotation during the last period: both keys expired */
+	}
+	if(RAND_bytes(self->keys[0].name, sizeof(self->keys[0].name)) != 1
+		|| RAND_bytes(self->keys[0].aes_key, sizeof(self->keys[0].aes_key)) != 1
+		|| RAND_bytes(self->keys[0].hmac_key, sizeof(self->keys[0].hmac_key)) != 1){
+		TSK_DEBUG_ERROR("RAND_bytes failed [%s]", ERR_error_string(ERR_get_error(), tsk_null));
+		memset(&self->keys[0], 0, sizeof(self->keys[0]));
+		return -2;
+	}
+	self->keys[0].created = now;
+	++self->stats.ticket_key_rotations;
+	return 0;
+}
+
+#if TNET_TLS_HAVE_TICKETS
+/* selects the key to use to encrypt (enc=1) or decrypt (enc=0) a ticket. Same return codes as the OpenSSL callback. */
+static int _tnet_tls_sessions_ticket_key(SSL* ssl, unsigned char key_name[16], unsigned char* iv, EVP_CIPHER_CTX* ctx, tnet_tls_ticket_key_t* key, int enc)
+{
+	int ret = 0;
+	uint64_t now = tsk_time_now();
+	tnet_tls_sessions_t* self = SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl));
+	if(!self){
+		return -1;
+	}
+	tsk_safeobj_lock(self);
+	if(_tnet_tls_sessions_rotate(self, now) != 0){
+		ret = -1;
+	}
+	else if(enc){
+		if(RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) == 1){
+			*key = self->keys[0];
+			memcpy(key_name, key->name, sizeof(key->name));
+			ret = EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), tsk_null, key->aes_key, iv) == 1 ? 1 : -1;
+		}
+		else{
+			ret = -1;
+		}
+	}
+	else if(memcmp(key_name, self->keys[0].name, sizeof(self->keys[0].name)) == 0){
+		*key = self->keys[0];
+#if defined(TLS1_3_VERSION)
+		/* TLS 1.3 clients use a ticket only once: always issue a new one after a resumption */
+		ret = (SSL_version(ssl) >= TLS1_3_VERSION) ? 2 : 1;
+#else
+		ret = 1;
+#endif
+	}
+	else if(self->keys[1].created && memcmp(key_name, self->keys[1].name, sizeof(self->keys[1].name)) == 0){
+		*key = self->keys[1];
+		ret = 2; /* accepted, a new ticket is issued with the current key */
+	}
+	tsk_safeobj_unlock(self);
+	if(!enc && ret > 0 && EVP_DecryptInit_ex(ctx, EVP_aes_256_cbc(), tsk_null, key->aes_key, iv) != 1){
+		ret = -1;
+	}
+	return ret;
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+static int _tnet_tls_sessions_ticket_cb(SSL* ssl, unsigned char key_name[16], unsigned char* iv, EVP_CIPHER_CTX* ctx, EVP_MAC_CTX* hctx, int enc)
+{
+	tnet_tls_ticket_key_t key;
+	int ret = _tnet_tls_sessions_ticket_key(ssl, key_name, iv, ctx, &key, enc);
+	if(ret > 0){
+		OSSL_PARAM params[3];
+		params[0] = OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, key.hmac_key, sizeof(key.hmac_key));
+		params[1] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, "SHA256", 0);
+		params[2] = OSSL_PARAM_construct_end();
+		if(EVP_MAC_CTX_set_params(hctx, params) != 1){
+			ret = -1;
+		}
+	}
+	OPENSSL_cleanse(&key, sizeof(key));
+	return ret;
+}
+#else
+static int _tnet_tls_sessions_ticket_cb(SSL* ssl, unsigned char key_name[16], unsigned char* iv, EVP_CIPHER_CTX* ctx, HMAC_CTX* hctx, int enc)
+{
+	tnet_tls_ticket_key_t key;
+	int ret = _tnet_tls_sessions_ticket_key(ssl, key_name, iv, ctx, &key, enc);
+	if(ret > 0 && HMAC_Init_ex(hctx, key.hmac_key, sizeof(key.hmac_key), EVP_sha256(), tsk_null) != 1){
+		ret = -1;
+	}
+	OPENSSL_cleanse(&key, sizeof(key));
+	return ret;
+}
+#endif
+#endif /* TNET_TLS_HAVE_TICKETS */
+
+/* client side: a new session was received from the server (end of the TLS 1.2 handshake or TLS 1.3 NewSessionTicket) */
+static int _tnet_tls_sessions_new_cb(SSL* ssl, SSL_SESSION* session)
+{
+	tsk_size_t i, index = TNET_TLS_CLIENT_SESSIONS_MAX;
+	tnet_tls_socket_t* socket = SSL_get_app_data(ssl);
+	tnet_tls_sessions_t* self;
+	if(!socket || !(self = socket->sessions) || !socket->destination){
+		return 0;
+	}
+	tsk_safeobj_lock(self);
+	for(i = 0; i < TNET_TLS_CLIENT_SESSIONS_MAX; ++i){
+		if(tsk_striequals(self->clients[i].destination, socket->destination)){
+			index = i;
+			break;
+		}
+		/* free entry or least recently used one */
+		if(index == TNET_TLS_CLIENT_SESSIONS_MAX || !self->clients[i].session || (self->clients[index].session && self->clients[i].last_use < self->clients[index].last_use)){
+			index = i;
+		}
+	}
+	if(self->clients[index].session){
+		SSL_SESSION_free((SSL_SESSION*)self->clients[index].session);
+	}
+	tsk_strupdate(&self->clients[index].destination, socket->destination);
+	self->clients[index].session = session; /* take the reference */
+	self->clients[index].last_use = tsk_time_now();
+	tsk_safeobj_unlock(self);
+	return 1;
+}
+
+/* client side: offers the last session received from the destination */
+static int _tnet_tls_sessions_resume(tnet_tls_sessions_t* self, SSL* ssl, const char* destination)
+{
+	tsk_size_t i;
+	int ret = 0;
+	tsk_safeobj_lock(self);
+	for(i = 0; i < TNET_TLS_CLIENT_SESSIONS_MAX; ++i){
+		if(self->clients[i].session && tsk_striequals(self->clients[i].destination, destination)){
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+			if(!SSL_SESSION_is_resumable((SSL_SESSION*)self->clients[i].session)){
+				break;
+			}
+#endif
+			if(SSL_set_session(ssl, (SSL_SESSION*)self->clients[i].session) == 1){ /* takes its own reference */
+				self->clients[i].last_use = tsk_time_now();
+				ret = 1;
+			}
+			break;
+		}
+	}
+	tsk_safeobj_unlock(self);
+	return ret;
+}
+#endif /* HAVE_OPENSSL */
+
+/** Applies the sessions configuration to the SSL contexts of a transport. Could be called several times. */
+int tnet_tls_sessions_attach(struct tnet_tls_sessions_s* self, struct ssl_ctx_st* ctx_client, struct ssl_ctx_st* ctx_server)
+{
+#if !HAVE_OPENSSL
+	TSK_DEBUG_ERROR("OpenSSL not enabled");
+	return -200;
+#else
+	if(!self){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	tsk_safeobj_lock(self);
+	if(ctx_server){
+		SSL_CTX_set_app_data(ctx_server, self);
+		SSL_CTX_set_session_id_context(ctx_server, __tnet_tls_sid_ctx, sizeof(__tnet_tls_sid_ctx) - 1);
+		SSL_CTX_set_timeout(ctx_server, (long)self->lifetime);
+		if(self->cache_size > 0){ /* zero means "unlimited" for OpenSSL */
+			SSL_CTX_set_session_cache_mode(ctx_server, SSL_SESS_CACHE_SERVER);
+			SSL_CTX_sess_set_cache_size(ctx_server, (long)self->cache_size);
+		}
+		else{
+			SSL_CTX_set_session_cache_mode(ctx_server, SSL_SESS_CACHE_OFF);
+		}
+#if TNET_TLS_HAVE_TICKETS
+		if(self->ticket_key_rotation > 0){
+			SSL_CTX_clear_options(ctx_server, SSL_OP_NO_TICKET);
+#	if OPENSSL_VERSION_NUMBER >= 0x30000000L
+			SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx_server, _tnet_tls_sessions_ticket_cb);
+#	else
+			SSL_CTX_set_tlsext_ticket_key_cb(ctx_server, _tnet_tls_sessions_ticket_cb);
+#	endif
+		}
+		else
+#endif
+		{
+			SSL_CTX_set_options(ctx_server, SSL_OP_NO_TICKET);
+		}
+	}
+	if(ctx_client){
+		SSL_CTX_set_app_data(ctx_client, self);
+		/* the sessions are stored per destination by the callback, not in the OpenSSL cache (keyed by session id) */
+		SSL_CTX_set_session_cache_mode(ctx_client, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+		SSL_CTX_sess_set_new_cb(ctx_client, _tnet_tls_sessions_new_cb);
+	}
+	tsk_safeobj_unlock(self);
+	return 0;
+#endif
+}
+
+#if HAVE_OPENSSL
+/* moves the records produced by OpenSSL to the network. Returns 1 if some data is still pending, 0 if everything was sent */
+static int _tnet_tls_socket_flush(tnet_tls_socket_t* socket)
+{
+	int ret, err;
+	
+	while(BIO_ctrl_pending(socket->wbio) > 0){
+		if(TSK_BUFFER_SIZE(socket->pending_out) >= TNET_TLS_PENDING_MAX){
+			TSK_DEBUG_ERROR("Too much data pending on fd=%d, the peer is not reading", socket->fd);
+			return -2;
+		}
+		if(tsk_buffer_reserve(socket->pending_out, TSK_BUFFER_SIZE(socket->pending_out) + TNET_TLS_CHUNK_SIZE) != 0){
+			TSK_DEBUG_ERROR("Failed to reserve %u bytes", (unsigned)(TSK_BUFFER_SIZE(socket->pending_out) + TNET_TLS_CHUNK_SIZE));
+			return -3;
+		}
+		if((ret = BIO_read(socket->wbio, TSK_BUFFER_TO_U8(socket->pending_out) + TSK_BUFFER_SIZE(socket->pending_out), TNET_TLS_CHUNK_SIZE)) <= 0){
+			break;
+		}
+		socket->pending_out->size += ret;
+	}
+
+	while(TSK_BUFFER_SIZE(socket->pending_out) > 0){
+		if((ret = (int)send(socket->fd, TSK_BUFFER_DATA(socket->pending_out), (int)TSK_BUFFER_SIZE(socket->pending_out), TNET_TLS_MSG_FLAGS)) > 0){
+			tsk_buffer_remove(socket->pending_out, 0, (tsk_size_t)ret);
+			continue;
+		}
+		if(ret < 0 && TNET_TLS_WOULDBLOCK((err = tnet_geterrno()))){
+			return 1; /* up to the transport to flush again when the socket is writable */
+		}
+		TNET_PRINT_LAST_ERROR("send(fd=%d) failed", socket->fd);
+		return -4;
+	}
+	return 0;
+}
+
+/* drives the handshake and, once completed, encrypts the data queued while it was in progress */
+static int _tnet_tls_socket_handshake(tnet_tls_socket_t* socket)
+{
+	int ret;
+	if(!SSL_is_init_finished(socket->ssl)){
+		if((ret = SSL_do_handshake(socket->ssl)) != 1){
+			ret = SSL_get_error(socket->ssl, ret);
+			if(ret == SSL_ERROR_WANT_READ || ret == SSL_ERROR_WANT_WRITE){
+				return 0;
+			}
+			TSK_DEBUG_ERROR("SSL_do_handshake(fd=%d) failed [%d, %s]", socket->fd, ret, ERR_error_string(ERR_get_error(), tsk_null));
+			return -2;
+		}
+		ret = SSL_session_reused(socket->ssl);
+		TSK_DEBUG_INFO("TLS handshake completed (fd=%d, %s)", socket->fd, ret ? "resumed" : "full");
+		if(socket->sessions){
+			tsk_safeobj_lock(socket->sessions);
+			if(socket->is_client){
+				ret ? ++socket->sessions->stats.client.resumed : ++socket->sessions->stats.client.full;
+			}
+			else{
+				ret ? ++socket->sessions->stats.server.resumed : ++socket->sessions->stats.server.full;
+			}
+			tsk_safeobj_unlock(socket->sessions);
+		}
+	}
+	if(TSK_BUFFER_SIZE(socket->pending_plain) > 0){
+		if((ret = SSL_write(socket->ssl, TSK_BUFFER_DATA(socket->pending_plain), (int)TSK_BUFFER_SIZE(socket->pending_plain))) <= 0){
+			ret = SSL_get_error(socket->ssl, ret);
+			if(ret == SSL_ERROR_WANT_READ || ret == SSL_ERROR_WANT_WRITE){ /* renegotiation: retried when the socket is readable */
+				return 0;
+			}
+			TSK_DEBUG_ERROR("SSL_write failed [%d, %s]", ret, ERR_error_string(ERR_get_error(), tsk_null));
+			return -3;
+		}
+		tsk_buffer_remove(socket->pending_plain, 0, (tsk_size_t)ret);
+	}
+	return 0;
+}
+
+/* queues application data until the handshake in progress completes */
+static int _tnet_tls_socket_queue(tnet_tls_socket_t* socket, const void* data, tsk_size_t size)
+{
+	if(TSK_BUFFER_SIZE(socket->pending_plain) + size > TNET_TLS_PENDING_MAX){
+		TSK_DEBUG_ERROR("Too much data queued on fd=%d while the handshake is in progress", socket->fd);
+		return -2;
+	}
+	if(tsk_buffer_append(socket->pending_plain, data, size) != 0){
+		TSK_DEBUG_ERROR("Failed to queue %u bytes", (unsigned)size);
+		return -3;
+	}
+	return 0;
+}
+#endif /* HAVE_OPENSSL */
+
+/** Starts the handshake. "host" and "port" identify the destination: the session previously negotiated with it (if any) is offered to be resumed. */
+int tnet_tls_socket_connect(tnet_tls_socket_handle_t* self, const char* host, tnet_port_t port)
 {
 #if !HAVE_OPENSSL
 	TSK_DEBUG_ERROR("You MUST enable OpenSSL");
@@ -99,18 +544,20 @@ int tnet_tls_socket_connect(tnet_tls_socket_handle_t* self)
 		return -1;
 	}
 
-	if((ret = SSL_connect(socket->ssl)) != 1){
-		ret = SSL_get_error(socket->ssl, ret);
-		if(ret == SSL_ERROR_WANT_WRITE || ret == SSL_ERROR_WANT_READ || ret == SSL_ERROR_SYSCALL){
-			ret = 0; /* up to the caller to check that the socket is writable and valid */
-		}
-		else{
-			TSK_DEBUG_ERROR("SSL_connect failed [%d, %s]", ret, ERR_error_string(ERR_get_error(), tsk_null));
+	tsk_safeobj_lock(socket);
+	socket->is_client = tsk_true;
+	if(socket->sessions && !tsk_strnullORempty(host)){
+		tsk_sprintf(&socket->destination, "%s:%u", host, (unsigned)port);
+		if(_tnet_tls_sessions_resume(socket->sessions, socket->ssl, socket->destination)){
+			TSK_DEBUG_INFO("Trying to resume the TLS session with %s", socket->destination);
 		}
 	}
-	else{
-		ret = 0;
+	SSL_set_connect_state(socket->ssl);
+	/* the TCP connection is probably not established yet: the ClientHello stays queued until the socket is writable */
+	if((ret = _tnet_tls_socket_handshake(socket)) == 0){
+		ret = _tnet_tls_socket_flush(socket) < 0 ? -3 : 0;
 	}
+	tsk_safeobj_unlock(socket);
 	
 	return ret;
 #endif
@@ -122,7 +569,6 @@ int tnet_tls_socket_accept(tnet_tls_socket_handle_t* self)
 	TSK_DEBUG_ERROR("You MUST enable OpenSSL");
 	return -200;
 #else
-	int ret = -1;
 	tnet_tls_socket_t* socket = self;
 
 	if(!self){
@@ -130,44 +576,10 @@ int tnet_tls_socket_accept(tnet_tls_socket_handle_t* self)
 		return -1;
 	}
 	
-	if((ret = SSL_accept(socket->ssl)) != 1){
-		ret = SSL_get_error(socket->ssl, ret);
-		if(ret == SSL_ERROR_WANT_READ){
-			int retval;
-			fd_set rfds;
-			while (1)
-			{
-				FD_ZERO(&rfds);
-				FD_SET(socket->fd, &rfds);
-				retval = select(socket->fd + 1, &rfds, NULL, NULL, NULL);
-				if (retval == -1){
-					TNET_PRINT_LAST_ERROR("select() failed");
-				}
-				else if (retval)
-				{
-					if (FD_ISSET(socket->fd, &rfds)){
-						ret = SSL_accept(socket->ssl);
-						ret = SSL_get_error(socket->ssl, ret);
-						if (ret == SSL_ERROR_WANT_READ){
-							continue;
-						}
-						else{
-							if(ret == SSL_ERROR_NONE){
-								return 0;
-							}
-							break;
-						}
-					}
-				}
-				else
-				{
-					break;
-				}
-			}
-		}
-		TSK_DEBUG_ERROR("SSL_accept() failed with error code [%d, %s]", ret, ERR_error_string(ERR_get_error(), tsk_null));
-		return -3;
-	}
+	/* the handshake continues in tnet_tls_socket_recv() when the ClientHello arrives */
+	tsk_safeobj_lock(socket);
+	SSL_set_accept_state(socket->ssl);
+	tsk_safeobj_unlock(socket);
 
 	return 0;
 #endif
@@ -179,36 +591,45 @@ int tnet_tls_socket_write(tnet_tls_socket_handle_t* self, const void* data, tsk_
 	TSK_DEBUG_ERROR("You MUST enable OpenSSL");
 	return -200;
 #else
-	int ret = -1;
+	int ret = 0;
 	tnet_tls_socket_t* socket = self;
-	tsk_bool_t try_again = tsk_true, want_read, want_write;
 	
-	if(!self){
+	if(!self || !data || !size){
 		TSK_DEBUG_ERROR("Invalid parameter");
 		return -1;
 	}
 
-	/* Write */
 	tsk_safeobj_lock(socket);
-	while(((ret = SSL_write(socket->ssl, data, (int)size)) <= 0) && try_again){
+	/* keep the order: nothing is written directly while older data is queued */
+	if(!SSL_is_init_finished(socket->ssl) || TSK_BUFFER_SIZE(socket->pending_plain) > 0){
+		if((ret = _tnet_tls_socket_queue(socket, data, size)) != 0){
+			goto bail;
+		}
+		ret = _tnet_tls_socket_handshake(socket);
+	}
+	else if((ret = SSL_write(socket->ssl, data, (int)size)) <= 0){
 		ret = SSL_get_error(socket->ssl, ret);
-		want_read = (ret == SSL_ERROR_WANT_READ);
-		want_write = (ret == SSL_ERROR_WANT_WRITE);
-
-		if(want_write || want_read){
-			if(!(ret = tnet_sockfd_waitUntil(socket->fd, TNET_TLS_TIMEOUT, want_write))){
-				continue;
+		if(ret == SSL_ERROR_WANT_READ || ret == SSL_ERROR_WANT_WRITE){
+			/* renegotiation started by the write: the data is written again by tnet_tls_socket_recv() once the peer answered */
+			if((ret = _tnet_tls_socket_queue(socket, data, size)) != 0){
+				goto bail;
 			}
 		}
 		else{
 			TSK_DEBUG_ERROR("SSL_write failed [%d, %s]", ret, ERR_error_string(ERR_get_error(), tsk_null));
 			ret = -3;
-			try_again = tsk_false;
+			goto bail;
 		}
 	}
+	else{
+		ret = 0;
+	}
+	if(ret == 0 && _tnet_tls_socket_flush(socket) < 0){
+		ret = -3;
+	}
+bail:
 	tsk_safeobj_unlock(socket);
 	
-	ret = (ret > 0) ? 0 : -3;
 	return ret;
 #endif
 }
@@ -219,89 +640,110 @@ int tnet_tls_socket_recv(tnet_tls_socket_handle_t* self, void** data, tsk_size_t
 	TSK_DEBUG_ERROR("You MUST enable OpenSSL");
 	return -200;
 #else
-	int ret = -1;
-	tsk_size_t read = 0;
-	tsk_size_t to_read = *size;
-	int rcount = TNET_TLS_RETRY_COUNT;
+	int ret = 0;
+	tsk_size_t read = 0, capacity;
 	tnet_tls_socket_t* socket = self;
 
-	if(!self){
+	if(!self || !data || !*data || !size || !*size || !isEncrypted){
 		TSK_DEBUG_ERROR("Invalid parameter");
 		return -1;
 	}
 	
 	tsk_safeobj_lock(socket);
 
-	*isEncrypted = SSL_is_init_finished(socket->ssl) ? tsk_false : tsk_true;
-
-	/* SSL handshake has completed? */
-	if(*isEncrypted){
-		char* buffer[1024];
-		if((ret = SSL_read(socket->ssl, buffer, sizeof(buffer))) <= 0){
-			ret = SSL_get_error(socket->ssl, ret);
-			if(ret == SSL_ERROR_WANT_WRITE || ret == SSL_ERROR_WANT_READ){
-				ret = 0;
-			}
-			else{
-				TSK_DEBUG_ERROR("SSL_read failed [%d, %s]", ret, ERR_error_string(ERR_get_error(), tsk_null));
-			}
-			*size = 0;
+	/* Records from the network: "data" (allocated by the transport using the readable size) is used as scratch buffer */
+	capacity = *size;
+	if((ret = (int)recv(socket->fd, (char*)*data, (int)capacity, TNET_TLS_MSG_FLAGS)) > 0){
+		if(BIO_write(socket->rbio, *data, ret) != ret){
+			TSK_DEBUG_ERROR("BIO_write(%d) failed", ret);
+			ret = -2;
+			goto bail;
 		}
-		else{
-			*size = ret;
-			ret = 0;
-		}
-		
+	}
+	else if(ret < 0 && !TNET_TLS_WOULDBLOCK(tnet_geterrno())){
+		TNET_PRINT_LAST_ERROR("recv(fd=%d) failed", socket->fd);
 		goto bail;
 	}
 
-	/* Read Application data */
-ssl_read:	
-	if(rcount && ((ret = SSL_read(socket->ssl, (((uint8_t*)*data)+read), (int)to_read)) <= 0)){
-		ret = SSL_get_error(socket->ssl, ret);
-		if(ret == SSL_ERROR_WANT_WRITE || ret == SSL_ERROR_WANT_READ){
-			if(!(ret = tnet_sockfd_waitUntil(socket->fd, TNET_TLS_TIMEOUT, (ret == SSL_ERROR_WANT_WRITE)))){
-				rcount--;
-				goto ssl_read;
+	/* Handshake (or renegotiation) */
+	if((ret = _tnet_tls_socket_handshake(socket)) != 0){
+		goto bail;
+	}
+
+	/* Application data */
+	while(SSL_is_init_finished(socket->ssl)){
+		if(read == capacity){
+			void* ptr;
+			tsk_size_t new_capacity = capacity + TSK_MAX((tsk_size_t)SSL_pending(socket->ssl), TNET_TLS_CHUNK_SIZE);
+			if(!(ptr = tsk_realloc(*data, new_capacity))){
+				TSK_DEBUG_ERROR("Failed to allocate %u bytes", (unsigned)new_capacity);
+				break;
 			}
+			*data = ptr, capacity = new_capacity;
 		}
-		else if(SSL_ERROR_ZERO_RETURN){ /* connection closed: do nothing, the transport layer will be alerted. */
-			*size = 0;
+		if((ret = SSL_read(socket->ssl, (((uint8_t*)*data) + read), (int)(capacity - read))) > 0){
+			read += (tsk_size_t)ret;
+			continue;
+		}
+		ret = SSL_get_error(socket->ssl, ret);
+		if(ret == SSL_ERROR_WANT_READ || ret == SSL_ERROR_WANT_WRITE){
 			ret = 0;
+		}
+		else if(ret == SSL_ERROR_ZERO_RETURN){ /* connection closed: do nothing, the transport layer will be alerted. */
 			TSK_DEBUG_INFO("TLS connection closed.");
+			ret = 0;
 		}
 		else{
 			TSK_DEBUG_ERROR("SSL_read failed [%d, %s]", ret, ERR_error_string(ERR_get_error(), tsk_null));
+			ret = -3;
 		}
+		break;
 	}
-	else if(ret >=0){
-		read += (tsk_size_t)ret;
 
-		if((ret = SSL_pending(socket->ssl)) > 0){
-			void *ptr;
-			to_read = ret;
+	/* Data queued while a renegotiation was in progress, the renegotiation may have been completed by SSL_read() */
+	if(ret == 0 && TSK_BUFFER_SIZE(socket->pending_plain) > 0 && SSL_is_init_finished(socket->ssl)){
+		ret = _tnet_tls_socket_handshake(socket);
+	}
 
-			if((ptr = tsk_realloc(*data, (read + to_read)))){
-				*data = ptr;
-				goto ssl_read;
-			}
-		}
+	/* Records produced while reading (handshake messages, alerts, key updates...) */
+	if(_tnet_tls_socket_flush(socket) < 0 && ret == 0){
+		ret = -4;
 	}
 
 bail:
 	tsk_safeobj_unlock(socket);
 
-	if(read){
-		*size = read;
-		return 0;
-	}
-	else{
-		return ret;
-	}
+	*isEncrypted = (read == 0); /* nothing for the application */
+	*size = read;
+	return read ? 0 : ret;
 #endif
 }
 
+/** Sends the data queued on the socket. Returns 1 if some data is still pending (the socket is not writable yet), 0 if everything was sent and a negative value on error. */
+int tnet_tls_socket_flush(tnet_tls_socket_handle_t* self)
+{
+#if !HAVE_OPENSSL
+	return 0;
+#else
+	int ret;
+	tnet_tls_socket_t* socket = self;
+	if(!self){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	tsk_safeobj_lock(socket);
+	ret = _tnet_tls_socket_flush(socket);
+	tsk_safeobj_unlock(socket);
+	return ret;
+#endif
+}
 
+/** Whether some encrypted data is waiting for the socket to become writable. */
+tsk_bool_t tnet_tls_socket_want_write(tnet_tls_socket_handle_t* self)
+{
+	const tnet_tls_socket_t* socket = self;
+	return (socket && socket->pending_out && TSK_BUFFER_SIZE(socket->pending_out) > 0) ? tsk_true : tsk_false;
+}
 
 
 //=================================================================================================
@@ -323,9 +765,13 @@ static tsk_object_t* tnet_tls_socket_dtor(tsk_object_t * self)
 #if HAVE_OPENSSL
 		if(socket->ssl){
 			SSL_shutdown(socket->ssl);
-			SSL_free(socket->ssl);
+			SSL_free(socket->ssl); /* also frees the BIOs */
 		}
 #endif
+		TSK_OBJECT_SAFE_FREE(socket->pending_plain);
+		TSK_OBJECT_SAFE_FREE(socket->pending_out);
+		TSK_OBJECT_SAFE_FREE(socket->sessions);
+		TSK_FREE(socket->destination);
 		tsk_safeobj_deinit(socket);
 	}
 	return self;
@@ -341,3 +787,46 @@ static const tsk_object_def_t tnet_tls_socket_def_s =
 const tsk_object_def_t *tnet_tls_socket_def_t = &tnet_tls_socket_def_s;
 
 
+
+
+//=================================================================================================
+//	TLS sessions object definition
+//
+static tsk_object_t* tnet_tls_sessions_ctor(tsk_object_t * self, va_list * app)
+{
+	tnet_tls_sessions_t *sessions = self;
+	if(sessions){
+		tsk_safeobj_init(sessions);
+	}
+	return self;
+}
+
+static tsk_object_t* tnet_tls_sessions_dtor(tsk_object_t * self)
+{ 
+	tnet_tls_sessions_t *sessions = self;
+	if(sessions){
+		tsk_size_t i;
+		for(i = 0; i < TNET_TLS_CLIENT_SESSIONS_MAX; ++i){
+#if HAVE_OPENSSL
+			if(sessions->clients[i].session){
+				SSL_SESSION_free((SSL_SESSION*)sessions->clients[i].session);
+			}
+#endif
+			TSK_FREE(sessions->clients[i].destination);
+		}
+#if HAVE_OPENSSL
+		OPENSSL_cleanse(sessions->keys, sizeof(sessions->keys));
+#endif
+		tsk_safeobj_deinit(sessions);
+	}
+	return self;
+}
+
+static const tsk_object_def_t tnet_tls_sessions_def_s = 
+{
+	sizeof(tnet_tls_sessions_t),
+	tnet_tls_sessions_ctor, 
+	tnet_tls_sessions_dtor,
+	tsk_null, 
+};
+const tsk_object_def_t *tnet_tls_sessions_def_t = &tnet_tls_sessions_def_s;
@@ -45,19 +45,53 @@
 
 TNET_BEGIN_DECLS
 
+#if !defined(TNET_TLS_SESSION_CACHE_SIZE)
+#	define TNET_TLS_SESSION_CACHE_SIZE		4096 /* Maximum number of sessions in the server-side cache. Zero to disable the cache. */
+#endif
+#if !defined(TNET_TLS_SESSION_LIFETIME)
+#	define TNET_TLS_SESSION_LIFETIME		3600 /* Lifetime (in seconds) of the cached sessions and tickets */
+#endif
+#if !defined(TNET_TLS_TICKET_KEY_ROTATION)
+#	define TNET_TLS_TICKET_KEY_ROTATION		3600 /* Interval (in seconds) between two session ticket keys (RFC 5077). Zero to disable the tickets. */
+#endif
+#if !defined(TNET_TLS_CLIENT_SESSIONS_MAX)
+#	define TNET_TLS_CLIENT_SESSIONS_MAX		64 /* Maximum number of destinations for which a client session is kept */
+#endif
+
 typedef void tnet_tls_socket_handle_t;
 struct ssl_ctx_st;
+struct tnet_tls_sessions_s;
+
+/** Handshake counters */
+typedef struct tnet_tls_stats_s
+{
+	struct{
+		uint64_t full;
+		uint64_t resumed;
+	} server, client;
+	uint64_t ticket_key_rotations;
+	tsk_size_t client_sessions; // number of destinations with a cached session
+}
+tnet_tls_stats_t;
+
+TINYNET_API struct tnet_tls_sessions_s* tnet_tls_sessions_create();
+TINYNET_API int tnet_tls_sessions_set(struct tnet_tls_sessions_s* self, tsk_size_t cache_size, uint32_t lifetime, uint32_t ticket_key_rotation);
+TINYNET_API int tnet_tls_sessions_attach(struct tnet_tls_sessions_s* self, struct ssl_ctx_st* ctx_client, struct ssl_ctx_st* ctx_server);
+TINYNET_API int tnet_tls_sessions_get_stats(struct tnet_tls_sessions_s* self, tnet_tls_stats_t* stats);
 
-int tnet_tls_socket_connect(tnet_tls_socket_handle_t* self);
+int tnet_tls_socket_connect(tnet_tls_socket_handle_t* self, const char* host, tnet_port_t port);
 int tnet_tls_socket_accept(tnet_tls_socket_handle_t* self);
 int tnet_tls_socket_write(tnet_tls_socket_handle_t* self, const void* data, tsk_size_t size);
 #define tnet_tls_socket_send(self, data, size) tnet_tls_socket_write(self, data, size)
 int tnet_tls_socket_recv(tnet_tls_socket_handle_t* self, void** data, tsk_size_t *size, tsk_bool_t *isEncrypted);
+int tnet_tls_socket_flush(tnet_tls_socket_handle_t* self);
+tsk_bool_t tnet_tls_socket_want_write(tnet_tls_socket_handle_t* self);
 
 TINYNET_API tsk_bool_t tnet_tls_is_supported();
 TINYNET_API tnet_tls_socket_handle_t* tnet_tls_socket_create(tnet_fd_t fd, struct ssl_ctx_st* ssl_ctx);
 
 TINYNET_GEXTERN const tsk_object_def_t *tnet_tls_socket_def_t;
+TINYNET_GEXTERN const tsk_object_def_t *tnet_tls_sessions_def_t;
 
 TNET_END_DECLS
 
@@ -92,6 +92,17 @@ static int tnet_socket_close(tnet_socket_t *sock);
 * @sa @ref tnet_socket_create.
 */
 tnet_socket_t* tnet_socket_create_2(const char* host, tnet_port_t port_, tnet_socket_type_t type, tsk_bool_t nonblocking, tsk_bool_t bindsocket)
+{
+	return tnet_socket_create_3(host, port_, type, nonblocking, bindsocket, tsk_false);
+}
+
+/**@ingroup tnet_socket_group
+* Creates a new socket.
+* Same as @ref tnet_socket_create_2() but allows other sockets to be bound to the same address (e.g. one datagram socket per I/O worker).
+* @param reuseport Indicates whether to set SO_REUSEPORT on a datagram socket before binding it. Stream sockets always reuse the address.
+* @retval @ref tnet_socket_t object.
+*/
+tnet_socket_t* tnet_socket_create_3(const char* host, tnet_port_t port_, tnet_socket_type_t type, tsk_bool_t nonblocking, tsk_bool_t bindsocket, tsk_bool_t reuseport)
 {
 	tnet_socket_t *sock;
 	if ((sock = tsk_object_new(tnet_socket_def_t))) {
@@ -154,6 +165,14 @@ tnet_socket_t* tnet_socket_create_2(const char* host, tnet_port_t port_, tnet_so
 					// do not break...continue
 				}
 			}
+			else if (reuseport) {
+				/* explicitly requested: must be set before bind() */
+				if ((status = tnet_sockfd_reuseaddr(sock->fd, 1))) {
+					tnet_socket_close(sock);
+					continue;
+				}
+				sock->reuseport = tsk_true;
+			}
 
 			if (bindsocket){
 				/* Bind the socket */
@@ -177,6 +177,7 @@ typedef struct tnet_socket_s
 	tnet_fd_t fd;
 	tnet_ip_t ip;
 	uint16_t port;
+	tsk_bool_t reuseport; // bound with SO_REUSEPORT: other sockets could be bound to the same address
 
 	tnet_tls_socket_handle_t* tlshandle;
 	tnet_dtls_socket_handle_t* dtlshandle;
@@ -192,6 +193,7 @@ typedef tnet_socket_t tnet_socket_ipsec_t; /**< IPSec socket. */
 typedef tsk_list_t tnet_sockets_L_t; /**< List of @ref tnet_socket_t elements. */
 
 TINYNET_API tnet_socket_t* tnet_socket_create_2(const char*host, tnet_port_t port, tnet_socket_type_t type, tsk_bool_t nonblocking, tsk_bool_t bindsocket);
+TINYNET_API tnet_socket_t* tnet_socket_create_3(const char*host, tnet_port_t port, tnet_socket_type_t type, tsk_bool_t nonblocking, tsk_bool_t bindsocket, tsk_bool_t reuseport);
 TINYNET_API tnet_socket_t* tnet_socket_create(const char* host, tnet_port_t port, tnet_socket_type_t type);
 TINYNET_API int tnet_socket_send_stream(tnet_socket_t* self, const void* data, tsk_size_t size);
 
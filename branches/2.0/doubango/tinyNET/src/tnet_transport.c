@@ -49,6 +49,34 @@ extern int tnet_transport_unprepare(tnet_transport_t *transport);
 extern void* TSK_STDCALL tnet_transport_mainthread(void *param);
 extern int tnet_transport_stop(tnet_transport_t *transport);
 
+/*== Receive buffers pool ==
+* Each buffer is preceded by a header holding its reference counter. A slot is free when its counter is equal to zero
+* and is borrowed using compare-and-swap which means no lock is needed on the hot path.
+* The pool is destroyed when both the transport and all borrowed buffers have released it.
+*/
+typedef struct tnet_transport_buffer_hdr_s
+{
+	struct tnet_transport_buffer_pool_s* pool;
+	long refcount; // zero if the slot is free
+}
+tnet_transport_buffer_hdr_t;
+
+typedef struct tnet_transport_buffer_pool_s
+{
+	uint8_t* slab; // TNET_TRANSPORT_BUFFER_POOL_COUNT slots of 'stride' bytes
+	tsk_size_t stride;
+	long next; // index of the next slot to try
+	long refcount; // one for the transport plus one per borrowed buffer
+}
+tnet_transport_buffer_pool_t;
+
+#define TNET_TRANSPORT_BUFFER_HDR(data) (((tnet_transport_buffer_hdr_t*)(data)) - 1)
+
+static tnet_transport_buffer_pool_t* _tnet_transport_buffer_pool_create();
+static void _tnet_transport_buffer_pool_release(tnet_transport_buffer_pool_t* pool);
+static void* _tnet_transport_buffer_pool_borrow(tnet_transport_buffer_pool_t* pool, tsk_size_t size);
+static void _tnet_transport_buffer_unref(void* data);
+
 static void* TSK_STDCALL run(void* self);
 static int _tnet_transport_dtls_cb(const void* usrdata, tnet_dtls_socket_event_type_t e, const tnet_dtls_socket_handle_t* handle, const void* data, tsk_size_t size);
 
@@ -88,6 +116,13 @@ static int _tnet_transport_ssl_init(tnet_transport_t* transport)
 				TSK_DEBUG_ERROR("SSL_CTX_set_cipher_list failed [%s]", ERR_error_string(ERR_get_error(), tsk_null));
 				return -4;
 			}
+			if (!transport->tls.sessions && !(transport->tls.sessions = tnet_tls_sessions_create())){
+				TSK_DEBUG_ERROR("Failed to create TLS sessions");
+				return -7;
+			}
+			if (tnet_tls_sessions_attach(transport->tls.sessions, transport->tls.ctx_client, transport->tls.ctx_server) != 0){
+				return -8;
+			}
 		}
 #if HAVE_OPENSSL_DTLS
 		if ((transport->dtls.enabled = is_dtls)){
@@ -137,17 +172,39 @@ static int _tnet_transport_ssl_deinit(tnet_transport_t* transport)
 }
 
 tnet_transport_t* tnet_transport_create(const char* host, tnet_port_t port, tnet_socket_type_t type, const char* description)
+{
+	return tnet_transport_create_3(host, port, type, description, 1);
+}
+
+/**
+* Creates a transport with several I/O workers (see @ref tnet_transport_set_workers_count).
+* Datagram transports with more than one worker bind their master socket with SO_REUSEPORT which means the per-worker sockets could
+* later be bound to the same address. Using @ref tnet_transport_set_workers_count() on a datagram transport created with a single worker fails.
+*/
+tnet_transport_t* tnet_transport_create_3(const char* host, tnet_port_t port, tnet_socket_type_t type, const char* description, tsk_size_t workers_count)
 {
 	tnet_transport_t* transport;
 
+	if (workers_count < 1 || workers_count > TNET_TRANSPORT_MAX_WORKERS){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return tsk_null;
+	}
+#if !TNET_USE_EPOLL
+	if (workers_count > 1){
+		TSK_DEBUG_ERROR("Multiple I/O workers require epoll() support");
+		return tsk_null;
+	}
+#endif
+
 	if ((transport = tsk_object_new(tnet_transport_def_t))){
 		transport->description = tsk_strdup(description);
 		transport->local_host = tsk_strdup(host);
 		transport->req_local_port = port;
 		transport->type = type;
+		transport->workers_count = workers_count;
 		transport->context = tnet_transport_context_create();
 
-		if ((transport->master = tnet_socket_create(transport->local_host, transport->req_local_port, transport->type))){
+		if ((transport->master = tnet_socket_create_3(transport->local_host, transport->req_local_port, transport->type, tsk_true, tsk_true, (TNET_SOCKET_TYPE_IS_DGRAM(transport->type) && workers_count > 1)))){
 			transport->local_ip = tsk_strdup(transport->master->ip);
 			transport->bind_local_port = transport->master->port;
 		}
@@ -204,6 +261,173 @@ tnet_transport_event_t* tnet_transport_event_create(tnet_transport_event_type_t
 	return tsk_object_new(tnet_transport_event_def_t, type, callback_data, fd);
 }
 
+/* Sets the data of a network event. The data is copied into a pooled buffer when possible. */
+int tnet_transport_event_set_data(tnet_transport_event_t* e, tnet_transport_t* transport, const void* data, tsk_size_t size)
+{
+	if (!e || !data || !size || e->data) {
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	if (transport && transport->buffer_pool && (e->data = _tnet_transport_buffer_pool_borrow(transport->buffer_pool, size))) {
+		e->pooled = tsk_true;
+	}
+	else if (!(e->data = tsk_malloc(size))) {
+		TSK_DEBUG_ERROR("Failed to allocate buffer with size = %u", (unsigned)size);
+		return -2;
+	}
+	memcpy(e->data, data, size);
+	e->size = size;
+	return 0;
+}
+
+/* Reads a batch of pending datagrams (recvmmsg) and wraps each of them into a network event. The caller owns the events.
+* Datagrams up to TNET_TRANSPORT_BUFFER_SIZE bytes are received straight into buffers borrowed from the transport's pool and handed to the events without copy.
+* Returns the number of datagrams read (a full batch means more could be pending) or a negative value if the socket failed. */
+int tnet_transport_recv_datagrams(tnet_transport_t* transport, tnet_fd_t fd, tnet_transport_dgram_slots_t* slots, tnet_transport_event_t** events, tsk_size_t* events_count)
+{
+	static const tsk_size_t head_size = TSK_MIN(TNET_TRANSPORT_BUFFER_SIZE, DGRAM_MAX_SIZE);
+	static const tsk_size_t tail_size = DGRAM_MAX_SIZE - TSK_MIN(TNET_TRANSPORT_BUFFER_SIZE, DGRAM_MAX_SIZE);
+	void* heads[TNET_TRANSPORT_DGRAM_BATCH];
+	void* tails[TNET_TRANSPORT_DGRAM_BATCH];
+	tsk_size_t sizes[TNET_TRANSPORT_DGRAM_BATCH];
+	struct sockaddr_storage froms[TNET_TRANSPORT_DGRAM_BATCH];
+	tnet_transport_event_t* e;
+	uint8_t* slot;
+	int ret, i;
+
+	if (!transport || !slots || !events || !events_count) {
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	*events_count = 0;
+	if (!slots->overflow && !(slots->overflow = tsk_malloc(TNET_TRANSPORT_DGRAM_BATCH * DGRAM_MAX_SIZE))) {
+		TSK_DEBUG_ERROR("Failed to allocate datagram slots");
+		return 0;
+	}
+	// head in the pooled buffer and tail in the overflow slot, or the whole overflow slot (contiguous) when the pool is exhausted
+	for (i = 0; i < TNET_TRANSPORT_DGRAM_BATCH; ++i) {
+		slot = slots->overflow + (i * DGRAM_MAX_SIZE);
+		if (!slots->pooled[i] && transport->buffer_pool) {
+			slots->pooled[i] = _tnet_transport_buffer_pool_borrow(transport->buffer_pool, head_size);
+		}
+		heads[i] = slots->pooled[i] ? slots->pooled[i] : slot;
+		tails[i] = slot + head_size;
+	}
+
+	if ((ret = tnet_sockfd_recvfrom_batch_2(fd, heads, head_size, tails, tail_size, sizes, froms, TNET_TRANSPORT_DGRAM_BATCH)) < 0) {
+		TNET_PRINT_LAST_ERROR("recvmmsg have failed.");
+		return ret;
+	}
+	for (i = 0; i < ret; ++i) {
+		if (!sizes[i]) {
+			continue;
+		}
+		if (!(e = tnet_transport_event_create(event_data, transport->callback_data, fd))) {
+			TSK_DEBUG_ERROR("Failed to create network event");
+			continue;
+		}
+		if (slots->pooled[i] && sizes[i] <= head_size) {
+			// zero-copy: the event takes the pooled buffer
+			e->data = slots->pooled[i], e->size = sizes[i], e->pooled = tsk_true;
+			slots->pooled[i] = tsk_null;
+		}
+		else {
+			slot = slots->overflow + (i * DGRAM_MAX_SIZE);
+			if (slots->pooled[i]) {
+				memcpy(slot, slots->pooled[i], head_size); // make the datagram contiguous
+			}
+			if (tnet_transport_event_set_data(e, tsk_null, slot, sizes[i]) != 0) {
+				TSK_OBJECT_SAFE_FREE(e);
+				continue;
+			}
+		}
+		e->remote_addr = froms[i];
+		events[(*events_count)++] = e;
+	}
+	return ret;
+}
+
+/* Releases the pooled buffers kept by the receive slots and frees the overflow slots. */
+void tnet_transport_dgram_slots_deinit(tnet_transport_dgram_slots_t* slots)
+{
+	tsk_size_t i;
+	if (slots) {
+		for (i = 0; i < TNET_TRANSPORT_DGRAM_BATCH; ++i) {
+			_tnet_transport_buffer_unref(slots->pooled[i]);
+			slots->pooled[i] = tsk_null;
+		}
+		TSK_FREE(slots->overflow);
+	}
+}
+
+/* Releases a pooled buffer. The buffer is returned to the pool when its reference counter reaches zero. */
+static void _tnet_transport_buffer_unref(void* data)
+{
+	if (data) {
+		tnet_transport_buffer_hdr_t* hdr = TNET_TRANSPORT_BUFFER_HDR(data);
+		long refcount;
+		do {
+			refcount = hdr->refcount;
+		} while (!tsk_atomic_cas(&hdr->refcount, refcount, refcount - 1));
+		if (refcount == 1) {
+			_tnet_transport_buffer_pool_release(hdr->pool);
+		}
+	}
+}
+
+static tnet_transport_buffer_pool_t* _tnet_transport_buffer_pool_create()
+{
+	tnet_transport_buffer_pool_t* pool;
+	tsk_size_t i;
+
+	if (!(pool = tsk_calloc(1, sizeof(tnet_transport_buffer_pool_t)))) {
+		TSK_DEBUG_ERROR("Failed to allocate buffer pool");
+		return tsk_null;
+	}
+	pool->stride = ((sizeof(tnet_transport_buffer_hdr_t) + TNET_TRANSPORT_BUFFER_SIZE + 15) & ~((tsk_size_t)15));
+	if (!(pool->slab = tsk_calloc(TNET_TRANSPORT_BUFFER_POOL_COUNT, pool->stride))) {
+		TSK_DEBUG_ERROR("Failed to allocate buffer pool slab");
+		TSK_FREE(pool);
+		return tsk_null;
+	}
+	for (i = 0; i < TNET_TRANSPORT_BUFFER_POOL_COUNT; ++i) {
+		((tnet_transport_buffer_hdr_t*)(pool->slab + (i * pool->stride)))->pool = pool;
+	}
+	pool->refcount = 1;
+	return pool;
+}
+
+static void _tnet_transport_buffer_pool_release(tnet_transport_buffer_pool_t* pool)
+{
+	long refcount;
+	do {
+		refcount = pool->refcount;
+	} while (!tsk_atomic_cas(&pool->refcount, refcount, refcount - 1));
+	if (refcount == 1) {
+		TSK_FREE(pool->slab);
+		tsk_free((void**)&pool);
+	}
+}
+
+static void* _tnet_transport_buffer_pool_borrow(tnet_transport_buffer_pool_t* pool, tsk_size_t size)
+{
+	tnet_transport_buffer_hdr_t* hdr;
+	tsk_size_t i, index;
+
+	if (size > TNET_TRANSPORT_BUFFER_SIZE) {
+		return tsk_null;
+	}
+	index = (tsk_size_t)tsk_atomic_inc(&pool->next);
+	for (i = 0; i < TNET_TRANSPORT_BUFFER_POOL_COUNT; ++i, ++index) {
+		hdr = (tnet_transport_buffer_hdr_t*)(pool->slab + ((index % TNET_TRANSPORT_BUFFER_POOL_COUNT) * pool->stride));
+		if (hdr->refcount == 0 && tsk_atomic_cas(&hdr->refcount, 0, 1)) {
+			tsk_atomic_inc(&pool->refcount);
+			return (hdr + 1);
+		}
+	}
+	return tsk_null; // exhausted
+}
+
 int tnet_transport_tls_set_certs(tnet_transport_handle_t *handle, const char* ca, const char* pbk, const char* pvk, tsk_bool_t verify)
 {
 	tnet_transport_t *transport = handle;
@@ -278,12 +502,61 @@ int tnet_transport_tls_set_certs(tnet_transport_handle_t *handle, const char* ca
 	return 0;
 }
 
+/**@ingroup tnet_transport_group
+* Configures the TLS session resumption (server side). The sessions are shared by all the connections of the transport.
+* @param cache_size maximum number of sessions in the cache (session ids), zero to disable the cache.
+* @param lifetime lifetime of the sessions and tickets, in seconds.
+* @param ticket_key_rotation interval between two session ticket keys (RFC 5077), in seconds. Zero to disable the tickets.
+* @retval Zero if succeed and non-zero error code otherwise.
+*/
+int tnet_transport_tls_set_sessions(tnet_transport_handle_t *handle, tsk_size_t cache_size, uint32_t lifetime, uint32_t ticket_key_rotation)
+{
+	tnet_transport_t *transport = handle;
+	int ret;
+
+	if (!transport) {
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	if (!transport->tls.enabled || !transport->tls.sessions) {
+		TSK_DEBUG_ERROR("TLS not enabled on this transport");
+		return -2;
+	}
+	if ((ret = tnet_tls_sessions_set(transport->tls.sessions, cache_size, lifetime, ticket_key_rotation))) {
+		return ret;
+	}
+	return tnet_tls_sessions_attach(transport->tls.sessions, transport->tls.ctx_client, transport->tls.ctx_server);
+}
+
+/**@ingroup tnet_transport_group
+* Gets the TLS handshake counters (full vs resumed).
+*/
+int tnet_transport_tls_get_stats(const tnet_transport_handle_t *handle, tnet_tls_stats_t* stats)
+{
+	const tnet_transport_t *transport = handle;
+
+	if (!transport || !stats) {
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	if (!transport->tls.sessions) {
+		memset(stats, 0, sizeof(*stats));
+		return 0;
+	}
+	return tnet_tls_sessions_get_stats(transport->tls.sessions, stats);
+}
+
 int tnet_transport_start(tnet_transport_handle_t* handle)
 {
 	int ret = -1;
 	if (handle){
 		tnet_transport_t *transport = handle;
 
+		/* receive buffers */
+		if (TNET_TRANSPORT_BUFFER_POOL_COUNT > 0 && TNET_SOCKET_TYPE_IS_DGRAM(transport->type) && !transport->buffer_pool){
+			transport->buffer_pool = _tnet_transport_buffer_pool_create(); // never mind if it fails: heap allocation will be used
+		}
+
 		/* prepare transport */
 		if ((ret = tnet_transport_prepare(transport))){
 			TSK_DEBUG_ERROR("Failed to prepare transport.");
@@ -793,7 +1066,7 @@ tnet_fd_t tnet_transport_connectto_3(const tnet_transport_handle_t *handle, stru
 				TSK_OBJECT_SAFE_FREE(socket->tlshandle);
 				socket->tlshandle = tsk_object_ref(tls_handle);
 			}
-			if ((status = tnet_tls_socket_connect(tls_handle))) {
+			if ((status = tnet_tls_socket_connect(tls_handle, host, port))) {
 				tnet_sockfd_close(&fd);
 				goto bail;
 			}
@@ -828,6 +1101,104 @@ int tnet_transport_set_callback(const tnet_transport_handle_t *handle, tnet_tran
 	return 0;
 }
 
+/**
+* Sets the number of I/O workers (threads) used by the transport. Each worker polls its own sockets and dispatches their events
+* on its own thread which means the callback could be called concurrently for different sockets. The events for a given socket are always
+* delivered in order. Datagram transports use one SO_REUSEPORT socket per worker while stream sockets are spread across the workers.
+* Only supported by the epoll() implementation. The master socket of a datagram transport must already be bound with SO_REUSEPORT (see @ref tnet_transport_create_3).
+* @param handle The transport. Must not be started.
+* @param count The number of workers within [1, TNET_TRANSPORT_MAX_WORKERS]. Default value: 1.
+* @retval Zero if succeed and non-zero error code otherwise.
+*/
+int tnet_transport_set_workers_count(tnet_transport_handle_t *handle, tsk_size_t count)
+{
+	tnet_transport_t *transport = (tnet_transport_t*)handle;
+
+	if (!transport || count < 1 || count > TNET_TRANSPORT_MAX_WORKERS){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	if (transport->prepared || TSK_RUNNABLE(transport)->started){
+		TSK_DEBUG_ERROR("Cannot change the number of workers while the transport is started");
+		return -2;
+	}
+#if !TNET_USE_EPOLL
+	if (count > 1){
+		TSK_DEBUG_ERROR("Multiple I/O workers require epoll() support");
+		return -3;
+	}
+#endif
+	if (count > 1 && transport->master && TNET_SOCKET_TYPE_IS_DGRAM(transport->master->type) && !transport->master->reuseport){
+		TSK_DEBUG_ERROR("The master socket must be bound with SO_REUSEPORT: use tnet_transport_create_3()");
+		return -4;
+	}
+	transport->workers_count = count;
+	return 0;
+}
+
+/**
+* Sends several buffers on a connected socket as a single write (no copy into a contiguous buffer).
+* Secure sockets (TLS) and the CFSocket implementation have no gather write: the buffers are sent one by one using @ref tnet_transport_send().
+* @param handle The transport.
+* @param from The socket to use to send the data.
+* @param iov The buffers to send, in order.
+* @param count The number of entries in @a iov (at most @ref TNET_SOCKFD_IOVEC_MAX).
+* @retval The total number of bytes sent.
+*/
+tsk_size_t tnet_transport_sendv(const tnet_transport_handle_t *handle, tnet_fd_t from, const tnet_iovec_t* iov, tsk_size_t count)
+{
+	const tnet_transport_t *transport = (const tnet_transport_t*)handle;
+	tsk_size_t i, sent = 0;
+
+	if (!transport || !iov || !count){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return 0;
+	}
+
+#if !(__IPHONE_OS_VERSION_MIN_REQUIRED >= 40000)
+	if (!transport->tls.enabled && count > 1 && count <= TNET_SOCKFD_IOVEC_MAX){
+		return tnet_sockfd_sendv(from, iov, count, 0);
+	}
+#endif
+	for (i = 0; i < count; ++i){
+		if (iov[i].size && tnet_transport_send(handle, from, iov[i].data, iov[i].size) != iov[i].size){
+			return 0;
+		}
+		sent += iov[i].size;
+	}
+	return sent;
+}
+
+/**
+* Sends several buffers as a single datagram (no copy into a contiguous buffer).
+* @param handle The transport. Must be a datagram transport.
+* @param from The socket to use to send the data.
+* @param to The destination address.
+* @param iov The buffers to send, in order.
+* @param count The number of entries in @a iov (at most @ref TNET_SOCKFD_IOVEC_MAX).
+* @retval The number of bytes sent.
+*/
+tsk_size_t tnet_transport_sendtov(const tnet_transport_handle_t *handle, tnet_fd_t from, const struct sockaddr *to, const tnet_iovec_t* iov, tsk_size_t count)
+{
+	const tnet_transport_t *transport = (const tnet_transport_t*)handle;
+	int ret;
+
+	if (!transport || !to || !iov || !count){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return 0;
+	}
+	if (!TNET_SOCKET_TYPE_IS_DGRAM(transport->master->type)){
+		TSK_DEBUG_ERROR("In order to use sendto() you must use an udp transport.");
+		return 0;
+	}
+	if (count == 1){
+		return tnet_transport_sendto(handle, from, to, iov[0].data, iov[0].size);
+	}
+	if ((ret = tnet_sockfd_sendtov(from, to, iov, count)) <= 0){
+		return 0;
+	}
+	return (tsk_size_t)ret;
+}
 
 int tnet_transport_shutdown(tnet_transport_handle_t* handle)
 {
@@ -867,9 +1238,8 @@ static int _tnet_transport_dtls_cb(const void* usrdata, tnet_dtls_socket_event_t
 		remote_addr = tnet_dtls_socket_get_remote_addr(handle);
 		fd = tnet_dtls_socket_get_fd(handle);
 		if ((e = tnet_transport_event_create(t_e, transport->callback_data, fd))) {
-			if (data && size && (e->data = tsk_malloc(size))) {
-				memcpy(e->data, data, size);
-				e->size = size;
+			if (data && size) {
+				tnet_transport_event_set_data(e, transport, data, size);
 			}
 			if (remote_addr) {
 				e->remote_addr = *remote_addr;
@@ -944,6 +1314,7 @@ static tsk_object_t* tnet_transport_ctor(tsk_object_t * self, va_list * app)
 {
 	tnet_transport_t *transport = self;
 	if (transport){
+		transport->workers_count = 1;
 	}
 	return self;
 }
@@ -965,6 +1336,13 @@ static tsk_object_t* tnet_transport_dtor(tsk_object_t * self)
 		TSK_FREE(transport->tls.pbk);
 		TSK_FREE(transport->tls.pvk);
 		_tnet_transport_ssl_deinit(transport); // openssl contexts
+		TSK_OBJECT_SAFE_FREE(transport->tls.sessions); // after the contexts
+
+		// borrowed buffers keep the pool alive
+		if (transport->buffer_pool) {
+			_tnet_transport_buffer_pool_release(transport->buffer_pool);
+			transport->buffer_pool = tsk_null;
+		}
 
 		TSK_DEBUG_INFO("*** Transport (%s) destroyed ***", transport->description);
 		TSK_FREE(transport->description);
@@ -1002,7 +1380,13 @@ static tsk_object_t* tnet_transport_event_dtor(tsk_object_t * self)
 {
 	tnet_transport_event_t *e = self;
 	if (e){
-		TSK_FREE(e->data);
+		if (e->pooled) {
+			_tnet_transport_buffer_unref(e->data);
+			e->data = tsk_null;
+		}
+		else {
+			TSK_FREE(e->data);
+		}
 	}
 
 	return self;
@@ -39,6 +39,21 @@ TNET_BEGIN_DECLS
 #define DGRAM_MAX_SIZE	8192
 #define STREAM_MAX_SIZE	8192
 
+#if !defined(TNET_TRANSPORT_DGRAM_BATCH)
+#	define TNET_TRANSPORT_DGRAM_BATCH	8 /* Maximum number of datagrams (up to DGRAM_MAX_SIZE bytes each) read per wakeup. Set to 1 to disable batching. */
+#endif
+
+#if !defined(TNET_TRANSPORT_BUFFER_SIZE)
+#	define TNET_TRANSPORT_BUFFER_SIZE	1500 /* Size of the pooled receive buffers (MTU). Larger datagrams are allocated on the heap. */
+#endif
+#if !defined(TNET_TRANSPORT_BUFFER_POOL_COUNT)
+#	define TNET_TRANSPORT_BUFFER_POOL_COUNT	128 /* Number of pooled receive buffers per datagram transport. Zero to disable the pool. */
+#endif
+
+#if !defined(TNET_TRANSPORT_MAX_WORKERS)
+#	define TNET_TRANSPORT_MAX_WORKERS	64 /* Maximum number of I/O workers per transport (see tnet_transport_set_workers_count) */
+#endif
+
 #define TNET_TRANSPORT_CB_F(callback)							((tnet_transport_cb_f)callback)
 
 typedef void tnet_transport_handle_t;
@@ -70,6 +85,7 @@ typedef struct tnet_transport_event_s
 
 	void* data;
 	tsk_size_t size;
+	tsk_bool_t pooled; // whether 'data' is borrowed from the transport's buffer pool (returned when the event is destroyed)
 
 	const void* callback_data;
 	tnet_fd_t local_fd;
@@ -79,7 +95,19 @@ tnet_transport_event_t;
 
 typedef int (*tnet_transport_cb_f)(const tnet_transport_event_t* e);
 
+/* Receive slots for batched datagram reads, owned by the thread reading the socket.
+* Datagrams land straight into the pooled buffers; the overflow slots only receive the bytes beyond TNET_TRANSPORT_BUFFER_SIZE
+* (or the whole datagram when the pool is exhausted). */
+typedef struct tnet_transport_dgram_slots_s
+{
+	uint8_t* overflow; // TNET_TRANSPORT_DGRAM_BATCH slots of DGRAM_MAX_SIZE bytes. Allocated on first use.
+	void* pooled[TNET_TRANSPORT_DGRAM_BATCH]; // buffers borrowed from the transport's pool and kept across reads until filled
+}
+tnet_transport_dgram_slots_t;
+
 TINYNET_API int tnet_transport_tls_set_certs(tnet_transport_handle_t *self, const char* ca, const char* pbk, const char* pvk, tsk_bool_t verify);
+TINYNET_API int tnet_transport_tls_set_sessions(tnet_transport_handle_t *self, tsk_size_t cache_size, uint32_t lifetime, uint32_t ticket_key_rotation);
+TINYNET_API int tnet_transport_tls_get_stats(const tnet_transport_handle_t *self, tnet_tls_stats_t* stats);
 TINYNET_API int tnet_transport_start(tnet_transport_handle_t* transport);
 TINYNET_API int tnet_transport_issecure(const tnet_transport_handle_t *handle);
 TINYNET_API const char* tnet_transport_get_description(const tnet_transport_handle_t *handle);
@@ -99,8 +127,11 @@ TINYNET_API tnet_fd_t tnet_transport_connectto(const tnet_transport_handle_t *ha
 TINYNET_API tnet_fd_t tnet_transport_connectto_3(const tnet_transport_handle_t *handle, struct tnet_socket_s* socket, const char* host, tnet_port_t port, tnet_socket_type_t type);
 TINYNET_API tsk_size_t tnet_transport_send(const tnet_transport_handle_t *handle, tnet_fd_t from, const void* buf, tsk_size_t size);
 TINYNET_API tsk_size_t tnet_transport_sendto(const tnet_transport_handle_t *handle, tnet_fd_t from, const struct sockaddr *to, const void* buf, tsk_size_t size);
+TINYNET_API tsk_size_t tnet_transport_sendv(const tnet_transport_handle_t *handle, tnet_fd_t from, const tnet_iovec_t* iov, tsk_size_t count);
+TINYNET_API tsk_size_t tnet_transport_sendtov(const tnet_transport_handle_t *handle, tnet_fd_t from, const struct sockaddr *to, const tnet_iovec_t* iov, tsk_size_t count);
 
 TINYNET_API int tnet_transport_set_callback(const tnet_transport_handle_t *handle, tnet_transport_cb_f callback, const void* callback_data);
+TINYNET_API int tnet_transport_set_workers_count(tnet_transport_handle_t *handle, tsk_size_t count);
 
 TINYNET_API const char* tnet_transport_dtls_get_local_fingerprint(const tnet_transport_handle_t *handle, tnet_dtls_hash_type_t hash);
 #define tnet_transport_dtls_set_certs(self, ca, pbk, pvk, verify) tnet_transport_tls_set_certs((self), (ca), (pbk), (pvk), (verify))
@@ -135,6 +166,8 @@ typedef struct tnet_transport_s
 
 	//unsigned connected:1;
 	void* mainThreadId[1];
+	tsk_size_t workers_count; // number of I/O workers (epoll only)
+	struct tnet_transport_buffer_pool_s* buffer_pool; // receive buffers (datagram transports only)
 
 	char *description;
 
@@ -150,6 +183,7 @@ typedef struct tnet_transport_s
 		tsk_bool_t verify; // whether to verify client/server certificate
 		struct ssl_ctx_st *ctx_client;
 		struct ssl_ctx_st *ctx_server;
+		struct tnet_tls_sessions_s* sessions; // session cache, tickets and handshake counters (shared by all the TLS sockets)
 	}tls;
 
 	/* DTLS */
@@ -166,7 +200,11 @@ tnet_transport_t;
 tsk_object_t* tnet_transport_context_create();
 TINYNET_API tnet_transport_t* tnet_transport_create(const char* host, tnet_port_t port, tnet_socket_type_t type, const char* description);
 TINYNET_API tnet_transport_t* tnet_transport_create_2(tnet_socket_t *master, const char* description);
+TINYNET_API tnet_transport_t* tnet_transport_create_3(const char* host, tnet_port_t port, tnet_socket_type_t type, const char* description, tsk_size_t workers_count);
 tnet_transport_event_t* tnet_transport_event_create(tnet_transport_event_type_t type, const void* callback_data, tnet_fd_t fd);
+int tnet_transport_event_set_data(tnet_transport_event_t* e, tnet_transport_t* transport, const void* data, tsk_size_t size);
+int tnet_transport_recv_datagrams(tnet_transport_t* transport, tnet_fd_t fd, tnet_transport_dgram_slots_t* slots, tnet_transport_event_t** events, tsk_size_t* events_count);
+void tnet_transport_dgram_slots_deinit(tnet_transport_dgram_slots_t* slots);
 
 TINYNET_GEXTERN const tsk_object_def_t *tnet_transport_def_t;
 TINYNET_GEXTERN const tsk_object_def_t *tnet_transport_event_def_t;
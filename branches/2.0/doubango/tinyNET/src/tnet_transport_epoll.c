@@ -0,0 +1,1219 @@
+/*
+* Copyright (C) 2010-2011 Mamadou Diop
+* Copyright (C) 2012-2015 Doubango Telecom <http://www.doubango.org>
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*
+*/
+
+/**@file tnet_transport_epoll.c
+ * @brief Network transport layer using Linux epoll().
+ *
+ * Unlike the poll() based implementation (tnet_transport_poll.c), the cost of each wakeup only depends on the number of ready sockets
+ * and adding/removing a socket doesn't require compacting an array: sockets are indexed by their file descriptor (the table grows with the highest fd).
+ * Level-triggered mode is used by default. Define TNET_EPOLL_EDGE_TRIGGERED to 1 (or configure with --enable-epoll=et) to use edge-triggered notifications.
+ *
+ * The sockets could be spread across several I/O workers (see @ref tnet_transport_set_workers_count). Each worker has its own epoll set,
+ * thread and events queue. A socket always belongs to the same worker which means the events for a given fd are delivered in order.
+ * Datagram transports use one SO_REUSEPORT socket per worker (the kernel shards the flows) while stream sockets are assigned using their fd.
+ * Pending datagrams are read in batches of up to TNET_TRANSPORT_DGRAM_BATCH (recvmmsg) straight into buffers borrowed from the transport's pool (see tnet_transport_recv_datagrams).
+ */
+#include "tnet_transport.h"
+#include "tsk_memory.h"
+#include "tsk_string.h"
+#include "tsk_debug.h"
+#include "tsk_thread.h"
+#include "tsk_buffer.h"
+#include "tsk_safeobj.h"
+
+#if TNET_USE_EPOLL
+
+#include <sys/epoll.h>
+#include <errno.h>
+
+#if !defined(TNET_EPOLL_LISTEN_BACKLOG)
+#	define TNET_EPOLL_LISTEN_BACKLOG	SOMAXCONN /* listen() backlog (the kernel caps it to net.core.somaxconn anyway) */
+#endif
+#if !defined(TNET_EPOLL_MIN_SOCKETS)
+#	define TNET_EPOLL_MIN_SOCKETS	64 /* Initial size of the fd-indexed sockets table. Grows as needed. */
+#endif
+#if !defined(TNET_EPOLL_MAX_EVENTS)
+#	define TNET_EPOLL_MAX_EVENTS	1024 /* Maximum number of events returned by a single epoll_wait() call. */
+#endif
+
+/*== Socket description ==*/
+typedef struct transport_socket_xs
+{
+	tnet_fd_t fd;
+	tsk_bool_t owner;
+	tsk_bool_t connected;
+	tsk_bool_t paused;
+	uint32_t events; // epoll events we're listening to
+	tsk_size_t worker; // index of the worker owning this socket
+
+	tnet_socket_type_t type;
+	tnet_tls_socket_handle_t* tlshandle;
+}
+transport_socket_xt;
+
+/*== I/O worker ==*/
+typedef struct transport_worker_s
+{
+	TSK_DECLARE_RUNNABLE; // events dispatcher. Not used by the first worker which dispatches its events using the transport itself.
+
+	tsk_size_t index;
+	int epfd;
+	void* tid[1]; // I/O thread. Not used by the first worker which runs on the transport's main thread.
+	tnet_transport_t* transport; // not owner
+	struct epoll_event events[TNET_EPOLL_MAX_EVENTS];
+	tnet_transport_dgram_slots_t dgram_slots; // receive slots for batched reads
+
+	TSK_DECLARE_SAFEOBJ;
+}
+transport_worker_t;
+
+/*== Transport context structure definition ==*/
+typedef struct transport_context_s
+{
+	TSK_DECLARE_OBJECT;
+
+	tsk_size_t count;
+	tnet_fd_t pipeW;
+	tnet_fd_t pipeR;
+	transport_worker_t* workers[TNET_TRANSPORT_MAX_WORKERS];
+	tsk_size_t workers_count;
+	transport_socket_xt** sockets; // indexed by fd
+	tsk_size_t sockets_size;
+
+	TSK_DECLARE_SAFEOBJ;
+}
+transport_context_t;
+
+/* Events for a socket must be dispatched by the worker owning it to keep them ordered */
+#define TRANSPORT_WORKER_RUNNABLE(transport, worker) ((worker)->index == 0 ? TSK_RUNNABLE(transport) : TSK_RUNNABLE(worker))
+#define TRANSPORT_WORKER_ENQUEUE(transport, worker, type, fd) TSK_RUNNABLE_ENQUEUE(TRANSPORT_WORKER_RUNNABLE((transport), (worker)), (type), (transport)->callback_data, (fd))
+#define TRANSPORT_WORKER_ENQUEUE_OBJECT_SAFE(transport, worker, e) TSK_RUNNABLE_ENQUEUE_OBJECT_SAFE(TRANSPORT_WORKER_RUNNABLE((transport), (worker)), (e))
+
+static const tsk_object_def_t *transport_worker_def_t;
+#define TRANSPORT_AUTO_WORKER	-1
+
+static transport_socket_xt* getSocket(transport_context_t *context, tnet_fd_t fd);
+static int addSocket(tnet_fd_t fd, tnet_socket_type_t type, tnet_transport_t *transport, tsk_bool_t take_ownership, tsk_bool_t is_client, tnet_tls_socket_handle_t* tlsHandle, int worker);
+static int watchWritable(transport_context_t *context, tnet_fd_t fd, tsk_bool_t watch);
+static int removeSocket(tnet_fd_t fd, transport_context_t *context);
+
+
+int tnet_transport_add_socket(const tnet_transport_handle_t *handle, tnet_fd_t fd, tnet_socket_type_t type, tsk_bool_t take_ownership, tsk_bool_t isClient, tnet_tls_socket_handle_t* tlsHandle)
+{
+	tnet_transport_t *transport = (tnet_transport_t*)handle;
+	transport_context_t* context;
+	int ret = -1;
+
+	if(!transport){
+		TSK_DEBUG_ERROR("Invalid server handle.");
+		return ret;
+	}
+
+	if(!(context = (transport_context_t*)transport->context)){
+		TSK_DEBUG_ERROR("Invalid context.");
+		return -2;
+	}
+
+	if(TNET_SOCKET_TYPE_IS_TLS(type) || TNET_SOCKET_TYPE_IS_WSS(type)){
+		transport->tls.enabled = 1;
+	}
+
+	// no need to signal the main thread: epoll_ctl() takes effect even if we're waiting
+	if((ret = addSocket(fd, type, transport, take_ownership, isClient, tlsHandle, TRANSPORT_AUTO_WORKER))){
+		TSK_DEBUG_ERROR("Failed to add new Socket.");
+		return ret;
+	}
+	TSK_DEBUG_INFO("Socket added (external call) %d", fd);
+	return 0;
+}
+
+int tnet_transport_pause_socket(const tnet_transport_handle_t *handle, tnet_fd_t fd, tsk_bool_t pause)
+{
+	tnet_transport_t *transport = (tnet_transport_t*)handle;
+	transport_context_t *context;
+	transport_socket_xt* socket;
+
+	if(!transport || !(context = (transport_context_t*)transport->context)){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+
+	tsk_safeobj_lock(context);
+	if(fd >= 0 && (tsk_size_t)fd < context->sockets_size && (socket = context->sockets[fd])){
+		// stop listening to EPOLLIN while paused: no busy loop in level-triggered mode. Resuming re-arms the fd which
+		// reports the data received in between (edge-triggered mode would otherwise wait for the next packet).
+		uint32_t events = pause ? (socket->events & ~EPOLLIN) : (socket->events | EPOLLIN);
+		socket->paused = pause;
+		if(events != socket->events || !pause){
+			struct epoll_event ev = { 0 };
+			socket->events = events;
+			ev.events = events;
+			ev.data.fd = fd;
+			if(epoll_ctl(context->workers[socket->worker]->epfd, EPOLL_CTL_MOD, fd, &ev) != 0){
+				TNET_PRINT_LAST_ERROR("epoll_ctl(EPOLL_CTL_MOD, fd=%d) failed", fd);
+			}
+		}
+	}
+	else{
+		TSK_DEBUG_WARN("Socket does not exist in this context");
+	}
+	tsk_safeobj_unlock(context);
+	return 0;
+}
+
+/* Remove socket */
+int tnet_transport_remove_socket(const tnet_transport_handle_t *handle, tnet_fd_t *pfd)
+{
+	tnet_transport_t *transport = (tnet_transport_t*)handle;
+	transport_context_t *context;
+	transport_socket_xt* socket;
+	transport_worker_t* worker = tsk_null;
+	tsk_bool_t found = tsk_false;
+	tnet_fd_t fd = *pfd;
+
+	TSK_DEBUG_INFO("Removing socket %d", fd);
+
+	if(!transport){
+		TSK_DEBUG_ERROR("Invalid server handle.");
+		return -1;
+	}
+
+	if(!(context = (transport_context_t*)transport->context)){
+		TSK_DEBUG_ERROR("Invalid context.");
+		return -2;
+	}
+
+	// the socket could be removed by another thread as soon as the context is unlocked: only keep its worker
+	tsk_safeobj_lock(context);
+	if(fd >= 0 && (tsk_size_t)fd < context->sockets_size && (socket = context->sockets[fd])){
+		worker = context->workers[socket->worker];
+	}
+	tsk_safeobj_unlock(context);
+	if(!worker){
+		return -1;
+	}
+
+	// lock order: worker -> context. The worker is locked to make sure the socket isn't being used by its I/O thread.
+	tsk_safeobj_lock(worker);
+	tsk_safeobj_lock(context);
+
+	// look again: removed (or replaced by a socket owned by another worker) while unlocked?
+	if((socket = ((tsk_size_t)fd < context->sockets_size ? context->sockets[fd] : tsk_null)) && context->workers[socket->worker] == worker){
+		tsk_bool_t self_ref = (&socket->fd == pfd);
+		removeSocket(fd, context); // socket will be destroyed
+		found = tsk_true;
+		TRANSPORT_WORKER_ENQUEUE(transport, worker, event_removed, fd);
+		if(!self_ref){ // if self_ref then, pfd no longer valid after removeSocket()
+			*pfd = TNET_INVALID_FD;
+		}
+	}
+
+	tsk_safeobj_unlock(context);
+	tsk_safeobj_unlock(worker);
+
+	return found ? 0 : -1;
+}
+
+
+tsk_size_t tnet_transport_send(const tnet_transport_handle_t *handle, tnet_fd_t from, const void* buf, tsk_size_t size)
+{
+	tnet_transport_t *transport = (tnet_transport_t*)handle;
+	int numberOfBytesSent = 0;
+
+	if(!transport){
+		TSK_DEBUG_ERROR("Invalid transport handle.");
+		goto bail;
+	}
+
+	if(transport->tls.enabled){
+		const transport_socket_xt* socket = getSocket(transport->context, from);
+		if(socket && socket->tlshandle){
+			if(!tnet_tls_socket_send(socket->tlshandle, buf, size)){
+				numberOfBytesSent = size;
+				if(tnet_tls_socket_want_write(socket->tlshandle)){
+					watchWritable(transport->context, from, tsk_true); // never wait for the peer: the worker flushes on EPOLLOUT
+				}
+			}
+			else{
+				numberOfBytesSent = 0;
+			}
+			goto bail;
+		}
+	}
+	else if((numberOfBytesSent = tnet_sockfd_send(from, buf, size, 0)) <= 0){
+		TNET_PRINT_LAST_ERROR("send have failed.");
+		goto bail;
+	}
+
+bail:
+	return numberOfBytesSent;
+}
+
+tsk_size_t tnet_transport_sendto(const tnet_transport_handle_t *handle, tnet_fd_t from, const struct sockaddr *to, const void* buf, tsk_size_t size)
+{
+	tnet_transport_t *transport = (tnet_transport_t*)handle;
+	int numberOfBytesSent = 0;
+
+	if(!transport){
+		TSK_DEBUG_ERROR("Invalid server handle.");
+		goto bail;
+	}
+
+	if(!TNET_SOCKET_TYPE_IS_DGRAM(transport->master->type)){
+		TSK_DEBUG_ERROR("In order to use sendto() you must use an udp transport.");
+		goto bail;
+	}
+
+	if((numberOfBytesSent = tnet_sockfd_sendto(from, to, buf, size)) <= 0){
+		TNET_PRINT_LAST_ERROR("sendto have failed.");
+		goto bail;
+	}
+
+bail:
+	return numberOfBytesSent;
+}
+
+int tnet_transport_have_socket(const tnet_transport_handle_t *handle, tnet_fd_t fd)
+{
+	tnet_transport_t *transport = (tnet_transport_t*)handle;
+
+	if(!transport){
+		TSK_DEBUG_ERROR("Invalid server handle.");
+		return 0;
+	}
+
+	return (getSocket((transport_context_t*)transport->context, fd) != 0);
+}
+
+const tnet_tls_socket_handle_t* tnet_transport_get_tlshandle(const tnet_transport_handle_t *handle, tnet_fd_t fd)
+{
+	tnet_transport_t *transport = (tnet_transport_t*)handle;
+	const transport_socket_xt *socket;
+
+	if(!transport){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return 0;
+	}
+
+	if((socket = getSocket((transport_context_t*)transport->context, fd))){
+		return socket->tlshandle;
+	}
+	return 0;
+}
+
+
+/*== Get socket ==*/
+static transport_socket_xt* getSocket(transport_context_t *context, tnet_fd_t fd)
+{
+	transport_socket_xt* ret = 0;
+
+	if(context && fd >= 0){
+		tsk_safeobj_lock(context);
+		if((tsk_size_t)fd < context->sockets_size){
+			ret = context->sockets[fd];
+		}
+		tsk_safeobj_unlock(context);
+	}
+
+	return ret;
+}
+
+/*== Add new socket ==*/
+int addSocket(tnet_fd_t fd, tnet_socket_type_t type, tnet_transport_t *transport, tsk_bool_t take_ownership, tsk_bool_t is_client, tnet_tls_socket_handle_t* tlsHandle, int worker)
+{
+	transport_context_t *context = transport?transport->context:0;
+	if(context){
+		transport_socket_xt *sock;
+		struct epoll_event ev = { 0 };
+
+		if(fd < 0){
+			TSK_DEBUG_ERROR("Invalid fd=%d", fd);
+			return -2;
+		}
+
+		sock = tsk_calloc(1, sizeof(transport_socket_xt));
+		sock->fd = fd;
+		sock->type = type;
+		sock->owner = take_ownership;
+
+		if((TNET_SOCKET_TYPE_IS_TLS(sock->type) || TNET_SOCKET_TYPE_IS_WSS(sock->type)) && transport->tls.enabled){
+			if(tlsHandle){
+				sock->tlshandle = tsk_object_ref(tlsHandle);
+			}
+			else{
+#if HAVE_OPENSSL
+				sock->tlshandle = tnet_tls_socket_create(sock->fd, is_client ? transport->tls.ctx_client : transport->tls.ctx_server);
+#endif
+			}
+		}
+
+		sock->events = (fd == context->pipeR) ? EPOLLIN : (EPOLLIN | EPOLLERR | EPOLLHUP);
+		if(TNET_SOCKET_TYPE_IS_STREAM(sock->type)){
+			sock->events |= EPOLLOUT; // emulate WinSock2 FD_CONNECT event
+		}
+#if TNET_EPOLL_EDGE_TRIGGERED
+		// OpenSSL could buffer decrypted records which means we'd never be notified again: TLS sockets are always level-triggered
+		if(fd != context->pipeR && !sock->tlshandle){
+			sock->events |= EPOLLET;
+		}
+#endif
+		ev.events = sock->events;
+		ev.data.fd = fd;
+
+		tsk_safeobj_lock(context);
+
+		sock->worker = (worker == TRANSPORT_AUTO_WORKER) ? (tsk_size_t)(fd % context->workers_count) : (tsk_size_t)worker;
+		if(sock->worker >= context->workers_count){
+			sock->worker = 0;
+		}
+
+		if((tsk_size_t)fd >= context->sockets_size){
+			tsk_size_t size = TSK_MAX((tsk_size_t)fd + 1, TSK_MAX(context->sockets_size << 1, TNET_EPOLL_MIN_SOCKETS));
+			transport_socket_xt** sockets;
+			if(!(sockets = tsk_realloc(context->sockets, size * sizeof(transport_socket_xt*)))){
+				TSK_DEBUG_ERROR("Failed to grow the sockets table to %u entries", (unsigned)size);
+				tsk_safeobj_unlock(context);
+				TSK_OBJECT_SAFE_FREE(sock->tlshandle);
+				TSK_FREE(sock);
+				return -4;
+			}
+			memset(&sockets[context->sockets_size], 0, (size - context->sockets_size) * sizeof(transport_socket_xt*));
+			context->sockets = sockets;
+			context->sockets_size = size;
+		}
+		if(context->sockets[fd]){
+			TSK_DEBUG_WARN("fd=%d already in the context. Replacing it.", fd);
+			epoll_ctl(context->workers[context->sockets[fd]->worker]->epfd, EPOLL_CTL_DEL, fd, tsk_null);
+			TSK_OBJECT_SAFE_FREE(context->sockets[fd]->tlshandle);
+			TSK_FREE(context->sockets[fd]);
+			context->count--;
+		}
+		if(epoll_ctl(context->workers[sock->worker]->epfd, EPOLL_CTL_ADD, fd, &ev) != 0){
+			TNET_PRINT_LAST_ERROR("epoll_ctl(EPOLL_CTL_ADD, fd=%d) failed", fd);
+			tsk_safeobj_unlock(context);
+			TSK_OBJECT_SAFE_FREE(sock->tlshandle);
+			TSK_FREE(sock);
+			return -3;
+		}
+		context->sockets[fd] = sock;
+		context->count++;
+
+		tsk_safeobj_unlock(context);
+
+		TSK_DEBUG_INFO("Socket added[%s]: fd=%d, worker=%u, tail.count=%d", transport->description, fd, (unsigned)sock->worker, context->count);
+
+		return 0;
+	}
+	else{
+		TSK_DEBUG_ERROR("Context is Null.");
+		return -1;
+	}
+}
+
+/*== Starts/stops reporting EPOLLOUT. Never stops while TLS data is pending ==*/
+static int watchWritable(transport_context_t *context, tnet_fd_t fd, tsk_bool_t watch)
+{
+	transport_socket_xt* sock;
+	int ret = 0;
+
+	if(fd < 0){
+		return -1;
+	}
+
+	// the sender queues its data before asking for EPOLLOUT and "want_write" is checked again here, under the context lock:
+	// a flush completing at the same time can't clear the event after the data was queued (at worst the event is set once for nothing)
+	tsk_safeobj_lock(context);
+	if((tsk_size_t)fd < context->sockets_size && (sock = context->sockets[fd])){
+		uint32_t events = watch ? (sock->events | EPOLLOUT) : (sock->events & ~EPOLLOUT);
+		if(!watch && sock->tlshandle && tnet_tls_socket_want_write(sock->tlshandle)){
+			events = sock->events;
+		}
+		if(events != sock->events){
+			struct epoll_event ev = { 0 };
+			sock->events = events;
+			ev.events = events;
+			ev.data.fd = fd;
+			if((ret = epoll_ctl(context->workers[sock->worker]->epfd, EPOLL_CTL_MOD, fd, &ev)) != 0){
+				TNET_PRINT_LAST_ERROR("epoll_ctl(EPOLL_CTL_MOD, fd=%d) failed", fd);
+			}
+		}
+	}
+	tsk_safeobj_unlock(context);
+
+	return ret;
+}
+
+/*== Remove socket ==*/
+int removeSocket(tnet_fd_t fd, transport_context_t *context)
+{
+	transport_socket_xt* sock;
+
+	if(fd < 0){
+		return -1;
+	}
+
+	tsk_safeobj_lock(context);
+
+	if((tsk_size_t)fd < context->sockets_size && (sock = context->sockets[fd])){
+		TSK_DEBUG_INFO("Socket to remove: fd=%d, tail.count=%d", fd, context->count);
+		// must be done before closing the fd (also closed fds are automatically removed from the epoll set)
+		if(epoll_ctl(context->workers[sock->worker]->epfd, EPOLL_CTL_DEL, fd, tsk_null) != 0){
+			TSK_DEBUG_INFO("epoll_ctl(EPOLL_CTL_DEL, fd=%d) failed", fd);
+		}
+		context->sockets[fd] = tsk_null;
+		context->count--;
+
+		/* Close the socket if we are the owner. Contrary to poll(), it's safe to close a socket while it's being epoll()ed */
+		if(sock->owner){
+			tnet_sockfd_close(&sock->fd);
+		}
+
+		/* Free tls context */
+		TSK_OBJECT_SAFE_FREE(sock->tlshandle);
+
+		// Free socket
+		TSK_FREE(sock);
+	}
+
+	tsk_safeobj_unlock(context);
+
+	return 0;
+}
+
+static void removeAllSockets(transport_context_t *context)
+{
+	tnet_fd_t fd;
+	tsk_safeobj_lock(context);
+	for(fd = 0; (tsk_size_t)fd < context->sockets_size && context->count; ++fd){
+		if(context->sockets[fd]){
+			removeSocket(fd, context);
+		}
+	}
+	tsk_safeobj_unlock(context);
+}
+
+/*== Creates the workers (the first one always exists) ==*/
+static int createWorkers(tnet_transport_t *transport)
+{
+	transport_context_t *context = transport->context;
+	tsk_size_t i, count = TSK_CLAMP(1, transport->workers_count, TNET_TRANSPORT_MAX_WORKERS);
+
+	for(i = 0; i < count; ++i){
+		if(!context->workers[i] && !(context->workers[i] = tsk_object_new(transport_worker_def_t, i))){
+			return -1;
+		}
+		if(context->workers[i]->epfd < 0){
+			return -2;
+		}
+		context->workers[i]->transport = transport;
+	}
+	context->workers_count = count;
+	return 0;
+}
+
+/*== Destroys all workers except the first one ==*/
+static void destroyWorkers(transport_context_t *context)
+{
+	tsk_size_t i;
+	for(i = 1; i < TNET_TRANSPORT_MAX_WORKERS; ++i){
+		TSK_OBJECT_SAFE_FREE(context->workers[i]);
+	}
+	context->workers_count = 1;
+}
+
+/*== Creates a datagram socket bound to the master address. The kernel will balance the flows across all these sockets. ==*/
+static tnet_fd_t createShardSocket(const struct sockaddr_storage* addr)
+{
+	tnet_fd_t fd;
+
+	if((fd = (tnet_fd_t)tnet_soccket(addr->ss_family, SOCK_DGRAM, IPPROTO_UDP)) == TNET_INVALID_FD){
+		TNET_PRINT_LAST_ERROR("Failed to create new socket.");
+		return TNET_INVALID_FD;
+	}
+	// SO_REUSEPORT must be set before bind()
+	if(tnet_sockfd_set_nonblocking(fd) || tnet_sockfd_reuseaddr(fd, 1) || bind(fd, (const struct sockaddr*)addr, tnet_get_sockaddr_size((const struct sockaddr*)addr))){
+		TNET_PRINT_LAST_ERROR("Failed to bind shard socket to the master address");
+		tnet_sockfd_close(&fd);
+	}
+	return fd;
+}
+
+int tnet_transport_stop(tnet_transport_t *transport)
+{
+	int ret;
+	transport_context_t *context;
+
+	if(!transport){
+		return -1;
+	}
+
+	context = transport->context;
+
+	if((ret = tsk_runnable_stop(TSK_RUNNABLE(transport)))){
+		return ret;
+	}
+
+	if(context){
+		// signal: closing the write side raises EPOLLHUP on the read side which wakes up all the workers
+		tsk_safeobj_lock(context); // =>MUST
+		if(context->pipeW != -1){
+			close(context->pipeW);
+			context->pipeW = -1;
+		}
+		tsk_safeobj_unlock(context);
+	}
+
+	if(transport->mainThreadId[0]){
+		return tsk_thread_join(transport->mainThreadId);
+	}
+	else{
+		/* already soppped */
+		return 0;
+	}
+}
+
+int tnet_transport_prepare(tnet_transport_t *transport)
+{
+	int ret = -1;
+	transport_context_t *context;
+	tnet_fd_t pipes[2];
+	struct sockaddr_storage shard_addr;
+	tsk_size_t i;
+
+	TSK_DEBUG_INFO("tnet_transport_prepare()");
+
+	if(!transport || !transport->context){
+		TSK_DEBUG_ERROR("Invalid parameter.");
+		return -1;
+	}
+	else{
+		context = transport->context;
+	}
+
+	if(transport->prepared){
+		TSK_DEBUG_ERROR("Transport already prepared.");
+		return -2;
+	}
+
+	if((ret = createWorkers(transport))){
+		TSK_DEBUG_ERROR("Failed to create workers");
+		return ret;
+	}
+
+	/* Prepare master */
+	if(!transport->master){
+		if((transport->master = tnet_socket_create_3(transport->local_host, transport->req_local_port, transport->type, tsk_true, tsk_true, (TNET_SOCKET_TYPE_IS_DGRAM(transport->type) && context->workers_count > 1)))){
+			tsk_strupdate(&transport->local_ip, transport->master->ip);
+			transport->bind_local_port = transport->master->port;
+		}
+		else{
+			TSK_DEBUG_ERROR("Failed to create master socket");
+			return -3;
+		}
+	}
+
+	/* Datagram with several workers: every socket bound to the address (the master included) must have SO_REUSEPORT before bind() */
+	if(TNET_SOCKET_TYPE_IS_DGRAM(transport->master->type) && context->workers_count > 1){
+		if(!transport->master->reuseport){
+			TSK_DEBUG_ERROR("The master socket is not bound with SO_REUSEPORT");
+			ret = -4;
+			goto bail;
+		}
+		if((ret = tnet_getsockname(transport->master->fd, &shard_addr))){
+			TNET_PRINT_LAST_ERROR("getsockname(%d) failed", transport->master->fd);
+			goto bail;
+		}
+	}
+
+	/* Start listening */
+	if(TNET_SOCKET_TYPE_IS_STREAM(transport->master->type)){
+		if((ret = tnet_sockfd_listen(transport->master->fd, TNET_EPOLL_LISTEN_BACKLOG))){
+			TNET_PRINT_LAST_ERROR("listen have failed.");
+			goto bail;
+		}
+	}
+
+	/* Create and add pipes to the epoll sets: only used to wakeup the workers when the transport is stopped */
+	if((ret = pipe(pipes))){
+		TNET_PRINT_LAST_ERROR("Failed to create new pipes.");
+		goto bail;
+	}
+
+	/* set both R and W sides */
+	context->pipeR = pipes[0];
+	context->pipeW = pipes[1];
+
+	/* add R side */
+	TSK_DEBUG_INFO("pipeR fd=%d, pipeW=%d", context->pipeR, context->pipeW);
+	if((ret = addSocket(context->pipeR, transport->master->type, transport, tsk_true, tsk_false, tsk_null, 0))){
+		goto bail;
+	}
+	for(i = 1; i < context->workers_count; ++i){
+		struct epoll_event ev = { 0 };
+		ev.events = EPOLLIN;
+		ev.data.fd = context->pipeR;
+		if((ret = epoll_ctl(context->workers[i]->epfd, EPOLL_CTL_ADD, context->pipeR, &ev))){
+			TNET_PRINT_LAST_ERROR("epoll_ctl(EPOLL_CTL_ADD, pipeR) failed");
+			goto bail;
+		}
+	}
+
+	/* Add the master socket to the context. */
+	TSK_DEBUG_INFO("master fd=%d", transport->master->fd);
+	// don't take ownership: will be closed by the dctor() when refCount==0
+	// otherwise will be closed twice: dctor() and removeSocket()
+	if((ret = addSocket(transport->master->fd, transport->master->type, transport, tsk_false, tsk_false, tsk_null, 0))){
+		TSK_DEBUG_ERROR("Failed to add master socket");
+		goto bail;
+	}
+
+	/* Datagram: one SO_REUSEPORT socket per additional worker */
+	if(TNET_SOCKET_TYPE_IS_DGRAM(transport->master->type) && context->workers_count > 1){
+		for(i = 1; i < context->workers_count; ++i){
+			tnet_fd_t fd;
+			if((fd = createShardSocket(&shard_addr)) == TNET_INVALID_FD){
+				ret = -4;
+				goto bail;
+			}
+			if((ret = addSocket(fd, transport->master->type, transport, tsk_true, tsk_false, tsk_null, (int)i))){
+				tnet_sockfd_close(&fd);
+				goto bail;
+			}
+		}
+	}
+
+	transport->prepared = tsk_true;
+
+bail:
+	return ret;
+}
+
+int tnet_transport_unprepare(tnet_transport_t *transport)
+{
+	transport_context_t *context;
+
+	if(!transport || !transport->context){
+		TSK_DEBUG_ERROR("Invalid parameter.");
+		return -1;
+	}
+	else{
+		context = transport->context;
+	}
+
+	if(!transport->prepared){
+		return 0;
+	}
+
+	transport->prepared = tsk_false;
+
+	removeAllSockets(context);
+	destroyWorkers(context);
+
+	/* reset both R and W sides */
+	if (context->pipeW != -1) {
+		if (close(context->pipeW)) {
+			TSK_DEBUG_ERROR("Failed to close pipeW:%d", context->pipeW);
+		}
+		context->pipeW = -1;
+	}
+	context->pipeR = -1;
+
+	// destroy master as it has been closed by removeSocket()
+	TSK_OBJECT_SAFE_FREE(transport->master);
+
+	return 0;
+}
+
+/*== Accept all pending connections. Returns non-zero if the listening socket must be removed ==*/
+static int acceptSockets(tnet_transport_t *transport, transport_socket_xt* active_socket)
+{
+	transport_context_t *context = transport->context;
+	transport_socket_xt* new_socket;
+	tnet_fd_t fd;
+
+	do{
+		if((fd = accept(active_socket->fd, tsk_null, tsk_null)) == TNET_INVALID_SOCKET){
+			if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR){
+				break;
+			}
+			TNET_PRINT_LAST_ERROR("accept(%d) failed", active_socket->fd);
+			return -1;
+		}
+		TSK_DEBUG_INFO("NETWORK EVENT FOR SERVER [%s] -- FD_ACCEPT(fd=%d)", transport->description, fd);
+		if(addSocket(fd, transport->master->type, transport, tsk_true, tsk_false, tsk_null, TRANSPORT_AUTO_WORKER) != 0 || !(new_socket = getSocket(context, fd))){
+			tnet_sockfd_close(&fd);
+			continue;
+		}
+		// the new socket could be owned by another worker
+		TRANSPORT_WORKER_ENQUEUE(transport, context->workers[new_socket->worker], event_accepted, fd);
+		if(active_socket->tlshandle){
+			if(tnet_tls_socket_accept(new_socket->tlshandle) != 0){
+				TRANSPORT_WORKER_ENQUEUE(transport, context->workers[new_socket->worker], event_closed, fd);
+				tnet_transport_remove_socket(transport, &fd);
+				TNET_PRINT_LAST_ERROR("SSL_accept() failed");
+			}
+		}
+	}
+	while(active_socket->events & EPOLLET); // edge-triggered: drain the accept queue
+
+	return 0;
+}
+
+/*== Reads the pending datagrams by batches (non-TLS datagram sockets only) ==*/
+static int recvDatagrams(transport_worker_t* worker, transport_socket_xt* active_socket)
+{
+	tnet_transport_t *transport = worker->transport;
+	tnet_transport_event_t* events[TNET_TRANSPORT_DGRAM_BATCH];
+	tsk_size_t count, i;
+	int ret;
+
+	do{
+		if((ret = tnet_transport_recv_datagrams(transport, active_socket->fd, &worker->dgram_slots, events, &count)) < 0){
+			removeSocket(active_socket->fd, transport->context);
+			return -1;
+		}
+		for(i = 0; i < count; ++i){
+			TRANSPORT_WORKER_ENQUEUE_OBJECT_SAFE(transport, worker, events[i]);
+		}
+	}
+	// level-triggered: the next epoll_wait() will report the remaining datagrams
+	while((active_socket->events & EPOLLET) && ret == TNET_TRANSPORT_DGRAM_BATCH && !active_socket->paused);
+
+	return 0;
+}
+
+/*== Reads all pending data. Returns non-zero if the socket have been removed ==*/
+static int recvSocket(transport_worker_t* worker, transport_socket_xt* active_socket)
+{
+	tnet_transport_t *transport = worker->transport;
+	transport_context_t *context = transport->context;
+	const tsk_bool_t is_stream = TNET_SOCKET_TYPE_IS_STREAM(transport->master->type);
+	const tsk_bool_t drain = (active_socket->events & EPOLLET) ? tsk_true : tsk_false;
+	tsk_bool_t first = tsk_true;
+	struct sockaddr_storage remote_addr = {0};
+	tnet_transport_event_t* e;
+	tnet_fd_t fd;
+	int ret;
+
+	if(TNET_TRANSPORT_DGRAM_BATCH > 1 && !is_stream && !active_socket->tlshandle){
+		return recvDatagrams(worker, active_socket);
+	}
+
+	do{
+		tsk_size_t len = 0;
+		void* buffer = tsk_null;
+
+		/* Retrieve the amount of pending data. */
+		ret = tnet_ioctlt(active_socket->fd, FIONREAD, &len);
+		if((ret < 0 || !len) && is_stream){
+			int listening = 0;
+			socklen_t socklen = sizeof(listening);
+
+			if(!first){ // edge-triggered: socket drained
+				return 0;
+			}
+
+			/* It's probably an incoming connection --> try to accept() it */
+			TSK_DEBUG_INFO("ioctlt(%d), len=%u returned zero or failed", active_socket->fd, len);
+
+			// check if socket is listening
+			if(getsockopt(active_socket->fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &socklen) != 0){
+				TNET_PRINT_LAST_ERROR("getsockopt(SO_ACCEPTCONN, %d) failed\n", active_socket->fd);
+				/* not socket accepted -> no socket to remove */
+				return 0;
+			}
+			if(listening){
+				if(acceptSockets(transport, active_socket) == 0){
+					return 0;
+				}
+			}
+			else{
+				TSK_DEBUG_INFO("Closing socket with fd = %d because ioctlt() returned zero or failed", active_socket->fd);
+			}
+			fd = active_socket->fd;
+			tnet_transport_remove_socket(transport, &active_socket->fd);
+			TRANSPORT_WORKER_ENQUEUE(transport, worker, event_closed, fd);
+			return -1;
+		}
+		first = tsk_false;
+
+		if(len <= 0){
+			// bodiless datagram (e.g. sent by some OSX clients): must be consumed or level-triggered epoll keeps reporting it.
+			// Android also requires to call recv() even if len is equal to zero.
+			if(len == 0 && ret == 0 && !is_stream){
+				static char __fake_buff[1];
+				ret = recv(active_socket->fd, __fake_buff, len, 0);
+			}
+			return 0;
+		}
+
+		if (!(buffer = tsk_calloc(len, sizeof(uint8_t)))) {
+			TSK_DEBUG_ERROR("TSK_CALLOC FAILED");
+			return 0;
+		}
+
+		// Retrieve the remote address
+		if (is_stream) {
+			ret = tnet_getpeername(active_socket->fd, &remote_addr);
+		}
+
+		// Receive the waiting data
+		if (active_socket->tlshandle) {
+			int isEncrypted;
+			tsk_size_t tlslen = len;
+			ret = tnet_tls_socket_recv(active_socket->tlshandle, &buffer, &tlslen, &isEncrypted);
+			if (tnet_tls_socket_want_write(active_socket->tlshandle)) { // handshake messages not sent yet
+				watchWritable(context, active_socket->fd, tsk_true);
+			}
+			if (ret == 0) {
+				if (isEncrypted) {
+					TSK_FREE(buffer);
+					return 0;
+				}
+				len = ret = tlslen;
+			}
+		}
+		else {
+			if (is_stream) {
+				ret = tnet_sockfd_recv(active_socket->fd, buffer, len, 0);
+			}
+			else {
+				ret = tnet_sockfd_recvfrom(active_socket->fd, buffer, len, 0, (struct sockaddr*)&remote_addr);
+			}
+		}
+
+		if(ret < 0){
+			TSK_FREE(buffer);
+			if(errno == EAGAIN || errno == EWOULDBLOCK){
+				return 0;
+			}
+			TNET_PRINT_LAST_ERROR("recv/recvfrom have failed.");
+			removeSocket(active_socket->fd, context);
+			return -1;
+		}
+
+		if((len != (tsk_size_t)ret) && len){
+			len = (tsk_size_t)ret;
+		}
+
+		if(len > 0){
+			e = tnet_transport_event_create(event_data, transport->callback_data, active_socket->fd);
+			e->data = buffer, buffer = tsk_null;
+			e->size = len;
+			e->remote_addr = remote_addr;
+
+			TRANSPORT_WORKER_ENQUEUE_OBJECT_SAFE(transport, worker, e);
+		}
+		TSK_FREE(buffer);
+	}
+	while(drain && !active_socket->paused);
+
+	return 0;
+}
+
+/*== I/O loop for a worker ==*/
+static int runWorker(transport_worker_t* worker)
+{
+	tnet_transport_t *transport = worker->transport;
+	transport_context_t *context = transport->context;
+	int ret, i;
+	uint32_t revents;
+	tnet_fd_t fd;
+	transport_socket_xt* active_socket;
+
+	while(TSK_RUNNABLE(transport)->running || TSK_RUNNABLE(transport)->started){
+		ret = epoll_wait(worker->epfd, worker->events, TNET_EPOLL_MAX_EVENTS, -1);
+		if(ret < 0){
+			if(errno == EINTR){
+				continue;
+			}
+			TNET_PRINT_LAST_ERROR("epoll_wait() have failed.");
+			return -1;
+		}
+
+		if(!TSK_RUNNABLE(transport)->running && !TSK_RUNNABLE(transport)->started){
+			TSK_DEBUG_INFO("Stopping [%s] worker #%u...", transport->description, (unsigned)worker->index);
+			return 0;
+		}
+
+		/* lock worker: sockets owned by this worker can't be removed while we're using them */
+		tsk_safeobj_lock(worker);
+
+		/* == Only ready sockets == */
+		for(i = 0; i < ret; ++i)
+		{
+			fd = worker->events[i].data.fd;
+			revents = worker->events[i].events;
+
+			if(fd == context->pipeR){
+				TSK_DEBUG_INFO("PipeR event = %u", revents);
+				if(revents & EPOLLIN){
+					static char __buffer[1024];
+					if(read(context->pipeR, __buffer, sizeof(__buffer)) < 0){
+						TNET_PRINT_LAST_ERROR("Failed to read from the Pipe");
+					}
+				}
+				else if(revents & EPOLLHUP){
+					TNET_PRINT_LAST_ERROR("Pipe Error");
+					tsk_safeobj_unlock(worker);
+					return -2;
+				}
+				continue;
+			}
+
+			/* Get active socket. Could be null if removed after epoll_wait() returned. */
+			if(!(active_socket = getSocket(context, fd))){
+				continue;
+			}
+
+			/*================== EPOLLHUP ==================*/
+			if(revents & EPOLLHUP){
+				if(revents & EPOLLOUT){
+					TSK_DEBUG_INFO("EPOLLOUT and EPOLLHUP are exclusive");
+				}
+				else{
+					TSK_DEBUG_INFO("NETWORK EVENT FOR SERVER [%s] -- EPOLLHUP(%d)", transport->description, fd);
+					tnet_transport_remove_socket(transport, &active_socket->fd);
+					TRANSPORT_WORKER_ENQUEUE(transport, worker, event_closed, fd);
+					continue;
+				}
+			}
+
+			/*================== EPOLLERR ==================*/
+			if(revents & EPOLLERR){
+				TSK_DEBUG_INFO("NETWORK EVENT FOR SERVER [%s] -- EPOLLERR(%d)", transport->description, fd);
+				tnet_transport_remove_socket(transport, &active_socket->fd);
+				TRANSPORT_WORKER_ENQUEUE(transport, worker, event_error, fd);
+				continue;
+			}
+
+			/*================== EPOLLIN ==================*/
+			if(revents & EPOLLIN){
+				/* check whether the socket is paused or not */
+				if(active_socket->paused){
+					TSK_DEBUG_INFO("Socket is paused");
+				}
+				else if(recvSocket(worker, active_socket) != 0){
+					continue; // socket removed
+				}
+			}
+
+			/*================== EPOLLOUT ==================*/
+			if(revents & EPOLLOUT){
+				TSK_DEBUG_INFO("NETWORK EVENT FOR SERVER [%s] -- EPOLLOUT", transport->description);
+				if(!active_socket->connected){
+					active_socket->connected = tsk_true;
+					TRANSPORT_WORKER_ENQUEUE(transport, worker, event_connected, active_socket->fd);
+				}
+				if(active_socket->tlshandle && tnet_tls_socket_flush(active_socket->tlshandle) < 0){
+					tnet_transport_remove_socket(transport, &active_socket->fd);
+					TRANSPORT_WORKER_ENQUEUE(transport, worker, event_error, fd);
+					continue;
+				}
+				if(active_socket->events & EPOLLOUT){
+					watchWritable(context, fd, tsk_false);
+				}
+			}
+
+			/*================== EPOLLPRI ==================*/
+			if(revents & EPOLLPRI){
+				TSK_DEBUG_INFO("NETWORK EVENT FOR SERVER [%s] -- EPOLLPRI", transport->description);
+			}
+		}/* for */
+
+		/* unlock worker */
+		tsk_safeobj_unlock(worker);
+
+	} /* while */
+
+	return 0;
+}
+
+/*=== I/O thread for the additional workers */
+static void* TSK_STDCALL workerIoThread(void *param)
+{
+	transport_worker_t* worker = param;
+	TSK_DEBUG_INFO("Worker #%u [%s] - enter", (unsigned)worker->index, worker->transport->description);
+	runWorker(worker);
+	TSK_DEBUG_INFO("Worker #%u [%s] - exit", (unsigned)worker->index, worker->transport->description);
+	return tsk_null;
+}
+
+/*=== Events dispatcher for the additional workers */
+static void* TSK_STDCALL workerRun(void* self)
+{
+	transport_worker_t* worker = self;
+	tsk_list_item_t *curr;
+
+	TSK_RUNNABLE_RUN_BEGIN(worker);
+
+	if((curr = TSK_RUNNABLE_POP_FIRST_SAFE(TSK_RUNNABLE(worker)))){
+		const tnet_transport_event_t *e = (const tnet_transport_event_t*)curr->data;
+		if(worker->transport->callback){
+			worker->transport->callback(e);
+		}
+		tsk_object_unref(curr);
+	}
+
+	TSK_RUNNABLE_RUN_END(worker);
+
+	return tsk_null;
+}
+
+/*=== Main thread */
+void *tnet_transport_mainthread(void *param)
+{
+	tnet_transport_t *transport = param;
+	transport_context_t *context = transport->context;
+	transport_worker_t* worker;
+	tsk_size_t i;
+
+	/* check whether the transport is already prepared */
+	if(!transport->prepared){
+		TSK_DEBUG_ERROR("Transport must be prepared before strating.");
+		goto bail;
+	}
+
+	TSK_DEBUG_INFO("Starting [%s] server with IP {%s} on port {%d} using fd {%d} with type {%d} (epoll, %u workers)...",
+			transport->description,
+			transport->master->ip,
+			transport->master->port,
+			transport->master->fd,
+			transport->master->type,
+			(unsigned)context->workers_count);
+
+	/* start the additional workers (dispatcher first) */
+	for(i = 1; i < context->workers_count; ++i){
+		worker = context->workers[i];
+		TSK_RUNNABLE(worker)->run = workerRun;
+		if(tsk_runnable_start(TSK_RUNNABLE(worker), tnet_transport_event_def_t) != 0 || tsk_thread_create(worker->tid, workerIoThread, worker) != 0){
+			TSK_DEBUG_ERROR("Failed to start worker #%u", (unsigned)i);
+			continue;
+		}
+		tsk_runnable_set_priority(TSK_RUNNABLE(worker), TSK_RUNNABLE(transport)->priority);
+		tsk_thread_set_priority(worker->tid[0], TSK_THREAD_PRIORITY_TIME_CRITICAL);
+	}
+
+	/* the first worker runs on this thread */
+	runWorker(context->workers[0]);
+
+	/* wait for the additional workers */
+	for(i = 1; i < context->workers_count; ++i){
+		worker = context->workers[i];
+		if(worker->tid[0]){
+			tsk_thread_join(worker->tid);
+		}
+		tsk_runnable_stop(TSK_RUNNABLE(worker));
+	}
+
+bail:
+
+	TSK_DEBUG_INFO("Stopped [%s] server with IP {%s} on port {%d}", transport->description, transport->master->ip, transport->master->port);
+	return 0;
+}
+
+void* tnet_transport_context_create()
+{
+	return tsk_object_new(tnet_transport_context_def_t);
+}
+
+
+//=================================================================================================
+//	Transport context object definition
+//
+static tsk_object_t* transport_context_ctor(tsk_object_t * self, va_list * app)
+{
+	transport_context_t *context = self;
+	if(context){
+		context->pipeR = context->pipeW = -1;
+		// the first worker always exists as sockets could be added before the transport is prepared
+		context->workers[0] = tsk_object_new(transport_worker_def_t, (tsk_size_t)0);
+		context->workers_count = 1;
+		tsk_safeobj_init(context);
+	}
+	return self;
+}
+
+static tsk_object_t* transport_context_dtor(tsk_object_t * self)
+{
+	transport_context_t *context = self;
+	if(context){
+		removeAllSockets(context);
+		destroyWorkers(context);
+		TSK_OBJECT_SAFE_FREE(context->workers[0]);
+		TSK_FREE(context->sockets);
+		tsk_safeobj_deinit(context);
+	}
+	return self;
+}
+
+static const tsk_object_def_t tnet_transport_context_def_s =
+{
+sizeof(transport_context_t),
+transport_context_ctor,
+transport_context_dtor,
+tsk_null,
+};
+const tsk_object_def_t *tnet_transport_context_def_t = &tnet_transport_context_def_s;
+
+
+//=================================================================================================
+//	Transport worker object definition
+//
+static tsk_object_t* transport_worker_ctor(tsk_object_t * self, va_list * app)
+{
+	transport_worker_t *worker = self;
+	if(worker){
+		worker->index = va_arg(*app, tsk_size_t);
+		if((worker->epfd = epoll_create1(EPOLL_CLOEXEC)) < 0){
+			TNET_PRINT_LAST_ERROR("epoll_create1() failed");
+		}
+		tsk_safeobj_init(worker);
+	}
+	return self;
+}
+
+static tsk_object_t* transport_worker_dtor(tsk_object_t * self)
+{
+	transport_worker_t *worker = self;
+	if(worker){
+		/* stops the dispatcher (if not already done) */
+		tsk_runnable_stop(TSK_RUNNABLE(worker));
+		if(worker->epfd >= 0){
+			close(worker->epfd);
+			worker->epfd = -1;
+		}
+		tnet_transport_dgram_slots_deinit(&worker->dgram_slots);
+		tsk_safeobj_deinit(worker);
+	}
+	return self;
+}
+
+static const tsk_object_def_t transport_worker_def_s =
+{
+sizeof(transport_worker_t),
+transport_worker_ctor,
+transport_worker_dtor,
+tsk_null,
+};
+static const tsk_object_def_t *transport_worker_def_t = &transport_worker_def_s;
+
+#endif /* TNET_USE_EPOLL */
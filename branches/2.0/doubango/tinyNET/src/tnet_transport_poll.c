@@ -31,7 +31,7 @@
 #include "tsk_buffer.h"
 #include "tsk_safeobj.h"
 
-#if USE_POLL && !(__IPHONE_OS_VERSION_MIN_REQUIRED >= 40000)
+#if USE_POLL && !TNET_USE_EPOLL && !(__IPHONE_OS_VERSION_MIN_REQUIRED >= 40000)
 
 #include "tnet_poll.h"
 
@@ -67,6 +67,7 @@ typedef struct transport_context_s
 	tnet_pollfd_t ufds[TNET_MAX_FDS];
 	transport_socket_xt* sockets[TNET_MAX_FDS];
 	tsk_bool_t polling; // whether we are poll()ing
+	tnet_transport_dgram_slots_t dgram_slots; // receive slots for batched reads
 
 	TSK_DECLARE_SAFEOBJ;
 }
@@ -75,6 +76,7 @@ transport_context_t;
 static transport_socket_xt* getSocket(transport_context_t *context, tnet_fd_t fd);
 static int addSocket(tnet_fd_t fd, tnet_socket_type_t type, tnet_transport_t *transport, tsk_bool_t take_ownership, tsk_bool_t is_client, tnet_tls_socket_handle_t* tlsHandle);
 static int removeSocket(int index, transport_context_t *context);
+static int watchWritable(transport_context_t *context, tnet_fd_t fd, tsk_bool_t watch);
 
 
 int tnet_transport_add_socket(const tnet_transport_handle_t *handle, tnet_fd_t fd, tnet_socket_type_t type, tsk_bool_t take_ownership, tsk_bool_t isClient, tnet_tls_socket_handle_t* tlsHandle)
@@ -206,6 +208,9 @@ tsk_size_t tnet_transport_send(const tnet_transport_handle_t *handle, tnet_fd_t
 		if(socket && socket->tlshandle){
 			if(!tnet_tls_socket_send(socket->tlshandle, buf, size)){
 				numberOfBytesSent = size;
+				if(tnet_tls_socket_want_write(socket->tlshandle)){
+					watchWritable(transport->context, from, tsk_true); // never wait for the peer: flushed on POLLOUT
+				}
 			}
 			else{
 				numberOfBytesSent = 0;
@@ -357,6 +362,36 @@ static void setConnected(tnet_fd_t fd, transport_context_t *context, int connect
 }
 */
 
+/*== Starts/stops reporting POLLOUT. Never stops while TLS data is pending ==*/
+static int watchWritable(transport_context_t *context, tnet_fd_t fd, tsk_bool_t watch)
+{
+	static char c = '\0';
+	tsk_size_t i;
+	
+	// the sender queues its data before asking for POLLOUT and "want_write" is checked again here, under the context lock:
+	// a flush completing at the same time can't clear the event after the data was queued (at worst the event is set once for nothing)
+	tsk_safeobj_lock(context);
+	for(i = 0; i < context->count; ++i){
+		if(context->sockets[i]->fd == fd){
+			if(watch && !(context->ufds[i].events & TNET_POLLOUT)){
+				context->ufds[i].events |= TNET_POLLOUT;
+				if(context->polling){ // wake up poll() to take the new events into account
+					if(write(context->pipeW, &c, 1) < 0){
+						TNET_PRINT_LAST_ERROR("Failed to write to the Pipe");
+					}
+				}
+			}
+			else if(!watch && !(context->sockets[i]->tlshandle && tnet_tls_socket_want_write(context->sockets[i]->tlshandle))){
+				context->ufds[i].events &= ~TNET_POLLOUT;
+			}
+			break;
+		}
+	}
+	tsk_safeobj_unlock(context);
+
+	return 0;
+}
+
 /*== Remove socket ==*/
 int removeSocket(int index, transport_context_t *context)
 {
@@ -549,6 +584,23 @@ int tnet_transport_unprepare(tnet_transport_t *transport)
 }
 
 /*=== Main thread */
+/*== Reads a batch of pending datagrams (non-TLS datagram sockets only) ==*/
+static int recvDatagrams(tnet_transport_t *transport, int index)
+{
+	transport_context_t *context = transport->context;
+	tnet_transport_event_t* events[TNET_TRANSPORT_DGRAM_BATCH];
+	tsk_size_t count, i;
+
+	if(tnet_transport_recv_datagrams(transport, context->sockets[index]->fd, &context->dgram_slots, events, &count) < 0){
+		removeSocket(index, context);
+		return -1;
+	}
+	for(i = 0; i < count; ++i){
+		TSK_RUNNABLE_ENQUEUE_OBJECT_SAFE(TSK_RUNNABLE(transport), events[i]);
+	}
+	return 0;
+}
+
 void *tnet_transport_mainthread(void *param)
 {
 	tnet_transport_t *transport = param;
@@ -671,6 +723,12 @@ void *tnet_transport_mainthread(void *param)
 					goto TNET_POLLIN_DONE;
 				}
 
+				/* Datagrams are read in batches (recvmmsg) into preallocated slots */
+				if(TNET_TRANSPORT_DGRAM_BATCH > 1 && !is_stream && !active_socket->tlshandle){
+					recvDatagrams(transport, i);
+					goto TNET_POLLIN_DONE;
+				}
+
 				/* Retrieve the amount of pending data.
 				 * IMPORTANT: If you are using Symbian please update your SDK to the latest build (August 2009) to have 'FIONREAD'.
 				 * This apply whatever you are using the 3rd or 5th edition.
@@ -756,7 +814,11 @@ void *tnet_transport_mainthread(void *param)
 				if (active_socket->tlshandle) {
 					int isEncrypted;
 					tsk_size_t tlslen = len;
-					if ((ret = tnet_tls_socket_recv(active_socket->tlshandle, &buffer, &tlslen, &isEncrypted)) == 0) {
+					ret = tnet_tls_socket_recv(active_socket->tlshandle, &buffer, &tlslen, &isEncrypted);
+					if (tnet_tls_socket_want_write(active_socket->tlshandle)) { // handshake messages not sent yet
+						context->ufds[i].events |= TNET_POLLOUT;
+					}
+					if (ret == 0) {
 						if (isEncrypted) {
 							TSK_FREE(buffer);
 							goto TNET_POLLIN_DONE;
@@ -810,9 +872,16 @@ TNET_POLLIN_DONE:
 					active_socket->connected = tsk_true;
 					TSK_RUNNABLE_ENQUEUE(transport, event_connected, transport->callback_data, active_socket->fd);
 				}
-				//else{
+				if(active_socket->tlshandle && tnet_tls_socket_flush(active_socket->tlshandle) < 0){
+					fd = active_socket->fd;
+					tnet_transport_remove_socket(transport, &active_socket->fd);
+					TSK_RUNNABLE_ENQUEUE(transport, event_error, transport->callback_data, fd);
+					continue;
+				}
+				// keep reporting POLLOUT until the pending TLS data is sent
+				if(!active_socket->tlshandle || !tnet_tls_socket_want_write(active_socket->tlshandle)){
 					context->ufds[i].events &= ~TNET_POLLOUT;
-				//}
+				}
 			}
 
 
@@ -869,6 +938,7 @@ static tsk_object_t* transport_context_dtor(tsk_object_t * self)
 		while(context->count){
 			removeSocket(0, context);
 		}
+		tnet_transport_dgram_slots_deinit(&context->dgram_slots);
 		tsk_safeobj_deinit(context);
 	}
 	return self;
@@ -643,6 +643,10 @@ void* TSK_STDCALL tnet_transport_mainthread(void *param)
 			else {
 				TSK_RUNNABLE_ENQUEUE(transport, event_connected, transport->callback_data, active_socket->fd);
 				active_socket->connected = 1;
+				// the ClientHello was queued while connecting
+				if (active_socket->tlshandle) {
+					tnet_tls_socket_flush(active_socket->tlshandle);
+				}
 			}
 		}
 
@@ -756,6 +760,11 @@ void* TSK_STDCALL tnet_transport_mainthread(void *param)
 				TNET_PRINT_LAST_ERROR("WRITE FAILED.");
 				goto done;
 			}
+			// TLS data queued when send() failed with WSAEWOULDBLOCK (FD_WRITE is only signaled in that case)
+			if (active_socket->tlshandle && tnet_tls_socket_flush(active_socket->tlshandle) < 0) {
+				TSK_RUNNABLE_ENQUEUE(transport, event_error, transport->callback_data, active_socket->fd);
+				goto done;
+			}
 		}
 
 
@@ -70,6 +70,14 @@ typedef char tnet_host_t[NI_MAXHOST];
 typedef char tnet_ip_t[INET6_ADDRSTRLEN];
 typedef unsigned char tnet_fingerprint_t[TNET_FINGERPRINT_MAX + 1];
 
+/** Scatter/gather entry (see @ref tnet_sockfd_sendv()) */
+typedef struct tnet_iovec_s
+{
+	const void* data;
+	tsk_size_t size;
+}
+tnet_iovec_t;
+
 typedef tsk_list_t tnet_interfaces_L_t; /**< List of @ref tnet_interface_t elements*/
 typedef tsk_list_t tnet_addresses_L_t; /**< List of @ref tnet_address_t elements*/
 
@@ -23,6 +23,10 @@
  *
  */
 
+#if defined(__linux__) && !defined(__ANDROID__) && !defined(_GNU_SOURCE)
+#	define _GNU_SOURCE /* recvmmsg(), sendmmsg() and 'struct mmsghdr' */
+#endif
+
 #include "tnet_utils.h"
 
 #include "tsk_thread.h"
@@ -146,6 +150,14 @@ void tnet_getlasterror(tnet_error_t *error)
 			sizeof(*error) - 1,
 			tsk_null);
 }
+#elif defined(_GNU_SOURCE) && defined(__GLIBC__)
+	{
+		// GNU version: the returned string is not necessarily stored in the buffer
+		const char* str = strerror_r(err, *error, sizeof(*error));
+		if (str && str != *error) {
+			snprintf(*error, sizeof(*error), "%s", str);
+		}
+	}
 #else
 	strerror_r(err, *error, sizeof(*error));
 	//sprintf(*error, "Network error (%d).", err);
@@ -1723,6 +1735,71 @@ bail:
 	return (int)((size == sent) ? sent : ret);
 }
 
+/**@ingroup tnet_utils_group
+* Sends several datagrams to the same destination using as few system calls as possible (@b sendmmsg when available).
+* @param fd The source socket.
+* @param to The destination socket.
+* @param bufs The datagrams to send.
+* @param sizes The size of each datagram.
+* @param count The number of datagrams (number of entries in @a bufs and @a sizes).
+* @retval The number of datagrams sent (which can be less than @a count). Otherwise, non-zero (negative) error code is returned.
+*/
+int tnet_sockfd_sendto_batch(tnet_fd_t fd, const struct sockaddr *to, const void* const* bufs, const tsk_size_t* sizes, tsk_size_t count)
+{
+	tsk_size_t sent = 0;
+	int ret = -1;
+
+	if (fd == TNET_INVALID_FD){
+		TSK_DEBUG_ERROR("Using invalid FD to send data.");
+		return -1;
+	}
+	if (!bufs || !sizes || !count){
+		TSK_DEBUG_ERROR("Using invalid BUFFER.");
+		return -2;
+	}
+
+#if HAVE_SENDMMSG && defined(_GNU_SOURCE)
+	{
+		struct mmsghdr msgs[TNET_SOCKFD_BATCH_MAX];
+		struct iovec iovs[TNET_SOCKFD_BATCH_MAX];
+		socklen_t tolen = tnet_get_sockaddr_size(to);
+		int try_guard = 10;
+		tsk_size_t i, n;
+
+		while (sent < count){
+			n = TSK_MIN((count - sent), TNET_SOCKFD_BATCH_MAX);
+			for (i = 0; i < n; ++i){
+				iovs[i].iov_base = (void*)bufs[sent + i];
+				iovs[i].iov_len = sizes[sent + i];
+				memset(&msgs[i], 0, sizeof(msgs[i]));
+				msgs[i].msg_hdr.msg_name = (void*)to;
+				msgs[i].msg_hdr.msg_namelen = tolen;
+				msgs[i].msg_hdr.msg_iov = &iovs[i];
+				msgs[i].msg_hdr.msg_iovlen = 1;
+			}
+			if ((ret = sendmmsg(fd, msgs, (unsigned int)n, 0)) <= 0){
+				if (tnet_geterrno() == TNET_ERROR_WOULDBLOCK && try_guard--){
+					TSK_DEBUG_INFO("sendmmsg() - WouldBlock. Retrying...");
+					tsk_thread_sleep(10);
+					continue;
+				}
+				TNET_PRINT_LAST_ERROR("sendmmsg() failed");
+				break;
+			}
+			sent += ret;
+		}
+	}
+#else
+	for (; sent < count; ++sent){
+		if ((ret = tnet_sockfd_sendto(fd, to, bufs[sent], sizes[sent])) <= 0){
+			break;
+		}
+	}
+#endif
+
+	return (sent > 0 || ret >= 0) ? (int)sent : ret;
+}
+
 /**@ingroup tnet_utils_group
 * Receives a datagram and stores the source address.
 * @param fd A descriptor identifying a bound socket.
@@ -1747,6 +1824,125 @@ int tnet_sockfd_recvfrom(tnet_fd_t fd, void* buf, tsk_size_t size, int flags, st
 	return recvfrom(fd, (char*)buf, (int)size, flags, from, &fromlen);
 }
 
+/**@ingroup tnet_utils_group
+* Receives up to @a count pending datagrams without blocking using as few system calls as possible (@b recvmmsg when available).
+* @param fd A descriptor identifying a bound socket.
+* @param bufs The slots for the incoming datagrams. Each slot must be at least @a slot_size bytes long.
+* @param slot_size The size, in bytes, of each slot. Datagrams larger than this size are dropped.
+* @param sizes Array of @a count elements holding the size of each received datagram upon return. The size is zero for dropped datagrams.
+* @param froms Array of @a count elements holding the source address of each received datagram upon return.
+* @param count The number of slots.
+* @retval The number of datagrams received (zero if there is nothing to read). Otherwise, non-zero (negative) error code is returned.
+*/
+int tnet_sockfd_recvfrom_batch(tnet_fd_t fd, void* const* bufs, tsk_size_t slot_size, tsk_size_t* sizes, struct sockaddr_storage* froms, tsk_size_t count)
+{
+	return tnet_sockfd_recvfrom_batch_2(fd, bufs, slot_size, tsk_null, 0, sizes, froms, count);
+}
+
+/**@ingroup tnet_utils_group
+* Same as @ref tnet_sockfd_recvfrom_batch() but each datagram is scattered into two buffers: the first @a head_size bytes land in @a heads[i] and the remaining ones in @a tails[i].
+* Useful to receive straight into small pooled buffers while still accepting bigger datagrams.
+* @param fd A descriptor identifying a bound socket.
+* @param heads The first part of each slot. Each one must be at least @a head_size bytes long.
+* @param head_size The size, in bytes, of each head.
+* @param tails The second part of each slot. Could be null if @a tail_size is equal to zero.
+* @param tail_size The size, in bytes, of each tail. Datagrams larger than @a head_size + @a tail_size are dropped.
+* @param sizes Array of @a count elements holding the size of each received datagram upon return. The size is zero for dropped datagrams.
+* @param froms Array of @a count elements holding the source address of each received datagram upon return.
+* @param count The number of slots.
+* @retval The number of datagrams received (zero if there is nothing to read). Otherwise, non-zero (negative) error code is returned.
+*/
+int tnet_sockfd_recvfrom_batch_2(tnet_fd_t fd, void* const* heads, tsk_size_t head_size, void* const* tails, tsk_size_t tail_size, tsk_size_t* sizes, struct sockaddr_storage* froms, tsk_size_t count)
+{
+	int ret;
+	const int iov_count = (tails && tail_size) ? 2 : 1;
+
+	if (fd == TNET_INVALID_FD){
+		TSK_DEBUG_ERROR("Using invalid FD to recv data.");
+		return -1;
+	}
+	if (!heads || !head_size || !sizes || !froms || !count){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -2;
+	}
+
+#if HAVE_RECVMMSG && defined(_GNU_SOURCE)
+	{
+		struct mmsghdr msgs[TNET_SOCKFD_BATCH_MAX];
+		struct iovec iovs[TNET_SOCKFD_BATCH_MAX][2];
+		int i;
+
+		count = TSK_MIN(count, TNET_SOCKFD_BATCH_MAX);
+		for (i = 0; i < (int)count; ++i){
+			iovs[i][0].iov_base = heads[i];
+			iovs[i][0].iov_len = head_size;
+			if (iov_count > 1){
+				iovs[i][1].iov_base = tails[i];
+				iovs[i][1].iov_len = tail_size;
+			}
+			memset(&msgs[i], 0, sizeof(msgs[i]));
+			msgs[i].msg_hdr.msg_name = &froms[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(froms[i]);
+			msgs[i].msg_hdr.msg_iov = iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = iov_count;
+		}
+		if ((ret = recvmmsg(fd, msgs, (unsigned int)count, MSG_DONTWAIT, tsk_null)) < 0){
+			return (tnet_geterrno() == TNET_ERROR_WOULDBLOCK || tnet_geterrno() == TNET_ERROR_EAGAIN) ? 0 : ret;
+		}
+		for (i = 0; i < ret; ++i){
+			if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC){
+				TSK_DEBUG_WARN("Dropping datagram larger than %u bytes", (unsigned)(head_size + (iov_count > 1 ? tail_size : 0)));
+				sizes[i] = 0;
+			}
+			else {
+				sizes[i] = msgs[i].msg_len;
+			}
+		}
+	}
+#else
+	/* one datagram per call */
+	if (iov_count == 1){
+		if ((ret = tnet_sockfd_recvfrom(fd, heads[0], head_size, 0, (struct sockaddr*)&froms[0])) < 0){
+			return (tnet_geterrno() == TNET_ERROR_WOULDBLOCK || tnet_geterrno() == TNET_ERROR_EAGAIN) ? 0 : ret;
+		}
+	}
+	else {
+#if TNET_UNDER_WINDOWS
+		WSABUF bufs[2];
+		DWORD numberOfBytesRecvd = 0, flags = 0;
+		int fromlen = sizeof(froms[0]);
+		bufs[0].buf = (CHAR*)heads[0], bufs[0].len = (ULONG)head_size;
+		bufs[1].buf = (CHAR*)tails[0], bufs[1].len = (ULONG)tail_size;
+		if (WSARecvFrom(fd, bufs, 2, &numberOfBytesRecvd, &flags, (struct sockaddr*)&froms[0], &fromlen, 0, 0) != 0){
+			return (tnet_geterrno() == TNET_ERROR_WOULDBLOCK) ? 0 : -3;
+		}
+		ret = (int)numberOfBytesRecvd;
+#else
+		struct iovec bufs[2];
+		struct msghdr msg;
+		bufs[0].iov_base = heads[0], bufs[0].iov_len = head_size;
+		bufs[1].iov_base = tails[0], bufs[1].iov_len = tail_size;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_name = &froms[0];
+		msg.msg_namelen = sizeof(froms[0]);
+		msg.msg_iov = bufs;
+		msg.msg_iovlen = 2;
+		if ((ret = (int)recvmsg(fd, &msg, 0)) < 0){
+			return (tnet_geterrno() == TNET_ERROR_WOULDBLOCK || tnet_geterrno() == TNET_ERROR_EAGAIN) ? 0 : ret;
+		}
+		if (msg.msg_flags & MSG_TRUNC){
+			TSK_DEBUG_WARN("Dropping datagram larger than %u bytes", (unsigned)(head_size + tail_size));
+			ret = 0;
+		}
+#endif
+	}
+	sizes[0] = (tsk_size_t)ret;
+	ret = 1;
+#endif
+
+	return ret;
+}
+
 /**@ingroup tnet_utils_group
 * Sends data on a connected socket.
 * @param fd A descriptor identifying a connected socket.
@@ -1791,6 +1987,145 @@ bail:
 	return sent;
 }
 
+/**@ingroup tnet_utils_group
+* Sends several buffers on a connected socket as if they were contiguous (@b sendmsg or @b WSASend with a buffer array).
+* @param fd A descriptor identifying a connected socket.
+* @param iov The buffers to send, in order.
+* @param count The number of entries in @a iov (at most @ref TNET_SOCKFD_IOVEC_MAX).
+* @param flags A set of flags that specify the way in which the call is made.
+* @retval The total number of bytes sent.
+*/
+tsk_size_t tnet_sockfd_sendv(tnet_fd_t fd, const tnet_iovec_t* iov, tsk_size_t count, int flags)
+{
+	tsk_size_t i, total = 0, sent = 0;
+	int ret = -1;
+#if TNET_UNDER_WINDOWS
+	WSABUF bufs[TNET_SOCKFD_IOVEC_MAX];
+	DWORD numberOfBytesSent = 0;
+#else
+	struct iovec bufs[TNET_SOCKFD_IOVEC_MAX];
+	struct msghdr msg;
+#endif
+
+	if (fd == TNET_INVALID_FD){
+		TSK_DEBUG_ERROR("Using invalid FD to send data.");
+		return 0;
+	}
+	if (!iov || !count || count > TNET_SOCKFD_IOVEC_MAX){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return 0;
+	}
+
+	for (i = 0; i < count; ++i){
+#if TNET_UNDER_WINDOWS
+		bufs[i].buf = (CHAR*)iov[i].data;
+		bufs[i].len = (ULONG)iov[i].size;
+#else
+		bufs[i].iov_base = (void*)iov[i].data;
+		bufs[i].iov_len = iov[i].size;
+#endif
+		total += iov[i].size;
+	}
+
+	/* one system call for the whole message */
+#if TNET_UNDER_WINDOWS
+	if ((ret = WSASend(fd, bufs, (DWORD)count, &numberOfBytesSent, (DWORD)flags, NULL, NULL)) == 0){
+		sent = (tsk_size_t)numberOfBytesSent;
+	}
+#else
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = bufs;
+	msg.msg_iovlen = count;
+	if ((ret = (int)sendmsg(fd, &msg, flags)) > 0){
+		sent = (tsk_size_t)ret;
+	}
+#endif
+	else if (tnet_geterrno() != TNET_ERROR_WOULDBLOCK){
+		TNET_PRINT_LAST_ERROR("sendmsg failed");
+		return 0;
+	}
+
+	/* partial write (e.g. full socket buffer): send what remains */
+	if (sent < total){
+		for (i = 0; i < count; ++i){
+			if (sent >= iov[i].size){
+				sent -= iov[i].size;
+				continue;
+			}
+			if (tnet_sockfd_send(fd, ((const uint8_t*)iov[i].data) + sent, (iov[i].size - sent), flags) != (iov[i].size - sent)){
+				return 0;
+			}
+			sent = 0;
+		}
+	}
+	return total;
+}
+
+/**@ingroup tnet_utils_group
+* Sends several buffers as a single datagram (@b sendmsg or @b WSASendTo with a buffer array).
+* @param fd The source socket.
+* @param to The destination socket.
+* @param iov The buffers to send, in order.
+* @param count The number of entries in @a iov (at most @ref TNET_SOCKFD_IOVEC_MAX).
+* @retval The number of bytes sent if succeed. Otherwise, non-zero (negative) error code is returned.
+*/
+int tnet_sockfd_sendtov(tnet_fd_t fd, const struct sockaddr *to, const tnet_iovec_t* iov, tsk_size_t count)
+{
+	tsk_size_t i;
+	int ret = -1, try_guard = 10;
+#if TNET_UNDER_WINDOWS
+	WSABUF bufs[TNET_SOCKFD_IOVEC_MAX];
+	DWORD numberOfBytesSent = 0;
+#else
+	struct iovec bufs[TNET_SOCKFD_IOVEC_MAX];
+	struct msghdr msg;
+#endif
+
+	if (fd == TNET_INVALID_FD){
+		TSK_DEBUG_ERROR("Using invalid FD to send data.");
+		return -1;
+	}
+	if (!to || !iov || !count || count > TNET_SOCKFD_IOVEC_MAX){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -2;
+	}
+
+	for (i = 0; i < count; ++i){
+#if TNET_UNDER_WINDOWS
+		bufs[i].buf = (CHAR*)iov[i].data;
+		bufs[i].len = (ULONG)iov[i].size;
+#else
+		bufs[i].iov_base = (void*)iov[i].data;
+		bufs[i].iov_len = iov[i].size;
+#endif
+	}
+#if !TNET_UNDER_WINDOWS
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_name = (void*)to;
+	msg.msg_namelen = tnet_get_sockaddr_size(to);
+	msg.msg_iov = bufs;
+	msg.msg_iovlen = count;
+#endif
+
+try_again:
+#if TNET_UNDER_WINDOWS
+	if ((ret = WSASendTo(fd, bufs, (DWORD)count, &numberOfBytesSent, 0, to, tnet_get_sockaddr_size(to), 0, 0)) == 0){
+		ret = (int)numberOfBytesSent;
+	}
+#else
+	ret = (int)sendmsg(fd, &msg, 0);
+#endif
+	if (ret <= 0){
+		if (tnet_geterrno() == TNET_ERROR_WOULDBLOCK && try_guard--){
+			TSK_DEBUG_INFO("sendmsg() - WouldBlock. Retrying...");
+			tsk_thread_sleep(10);
+			goto try_again;
+		}
+		TNET_PRINT_LAST_ERROR("sendmsg() failed");
+	}
+	return ret;
+}
+
 /**@ingroup tnet_utils_group
 * Receives data from a connected socket or a bound connectionless socket.
 * @param fd The descriptor that identifies a connected socket.
@@ -40,6 +40,14 @@ TNET_BEGIN_DECLS
 /**@ingroup tnet_utils_group
 */
 #define TNET_CONNECT_TIMEOUT		2000
+/**@ingroup tnet_utils_group
+* Maximum number of datagrams sent or received by a single batched call.
+*/
+#define TNET_SOCKFD_BATCH_MAX		64
+/**@ingroup tnet_utils_group
+* Maximum number of entries gathered by a single call to @ref tnet_sockfd_sendv() or @ref tnet_sockfd_sendtov().
+*/
+#define TNET_SOCKFD_IOVEC_MAX		16
 
 /**Interface.
 */
@@ -152,7 +160,12 @@ TINYNET_API int tnet_sockfd_reuseaddr(tnet_fd_t fd, int reuseAddr);
 
 TINYNET_API int tnet_sockfd_sendto(tnet_fd_t fd, const struct sockaddr *to, const void* buf, tsk_size_t size);
 TINYNET_API int tnet_sockfd_recvfrom(tnet_fd_t fd, void* buf, tsk_size_t size, int flags, struct sockaddr *from);
+TINYNET_API int tnet_sockfd_sendto_batch(tnet_fd_t fd, const struct sockaddr *to, const void* const* bufs, const tsk_size_t* sizes, tsk_size_t count);
+TINYNET_API int tnet_sockfd_recvfrom_batch(tnet_fd_t fd, void* const* bufs, tsk_size_t slot_size, tsk_size_t* sizes, struct sockaddr_storage* froms, tsk_size_t count);
+TINYNET_API int tnet_sockfd_recvfrom_batch_2(tnet_fd_t fd, void* const* heads, tsk_size_t head_size, void* const* tails, tsk_size_t tail_size, tsk_size_t* sizes, struct sockaddr_storage* froms, tsk_size_t count);
 TINYNET_API tsk_size_t tnet_sockfd_send(tnet_fd_t fd, const void* buf, tsk_size_t size, int flags);
+TINYNET_API tsk_size_t tnet_sockfd_sendv(tnet_fd_t fd, const tnet_iovec_t* iov, tsk_size_t count, int flags);
+TINYNET_API int tnet_sockfd_sendtov(tnet_fd_t fd, const struct sockaddr *to, const tnet_iovec_t* iov, tsk_size_t count);
 TINYNET_API int tnet_sockfd_recv(tnet_fd_t fd, void* buf, tsk_size_t size, int flags);
 TINYNET_API int tnet_sockfd_connectto(tnet_fd_t fd, const struct sockaddr_storage *to);
 TINYNET_API int tnet_sockfd_listen(tnet_fd_t fd, int backlog);
@@ -50,6 +50,7 @@
 #define RUN_TEST_DHCP		0
 #define RUN_TEST_DHCP6		0
 #define RUN_TEST_TLS		0
+#define RUN_TEST_TLS_ENGINE	0
 
 #ifdef _WIN32_WCE
 int _tmain(int argc, _TCHAR* argv[])
@@ -111,6 +112,11 @@ int main()
 		test_tls();
 #endif
 
+#if (RUN_TEST_ALL || RUN_TEST_TLS_ENGINE) && HAVE_OPENSSL
+		test_tls_engine();
+		test_tls_resumption();
+#endif
+
 	}
 
 	/* Cleanup the network stack */
@@ -101,5 +101,371 @@ void test_tls()
 	TSK_OBJECT_SAFE_FREE(transport);
 }
 
+#if HAVE_OPENSSL
+/*
+* Non-blocking engine: both ends run on this thread over a loopback connection, the sockets are never waited on.
+*/
+#define TEST_TLS_ENGINE_BIG_SIZE	(1024 * 1024)
+
+typedef struct test_tls_engine_end_s
+{
+	tnet_fd_t fd;
+	tnet_tls_socket_handle_t* tls;
+	tsk_buffer_t* received;
+}
+test_tls_engine_end_t;
+
+static SSL* test_tls_engine_client_ssl;
+
+static void test_tls_engine_info_cb(const SSL *ssl, int where, int ret)
+{
+	if(where & SSL_CB_HANDSHAKE_START){
+		test_tls_engine_client_ssl = (SSL*)ssl;
+	}
+}
+
+/* self-signed EC certificate */
+static SSL_CTX* test_tls_engine_ctx_create(tsk_bool_t is_server, int max_version)
+{
+	SSL_CTX* ctx;
+	int ret;
+
+	ctx = SSL_CTX_new(SSLv23_method());
+	assert(ctx);
+	ret = SSL_CTX_set_max_proto_version(ctx, max_version);
+	assert(ret == 1);
+	if(is_server){
+		EVP_PKEY_CTX* pctx;
+		EVP_PKEY* pkey = tsk_null;
+		X509* x509;
+		pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, tsk_null);
+		assert(pctx);
+		ret = EVP_PKEY_keygen_init(pctx);
+		assert(ret == 1);
+		ret = EVP_PKEY_CTX_set_ec_paramgen_curve_nid(pctx, NID_X9_62_prime256v1);
+		assert(ret == 1);
+		ret = EVP_PKEY_keygen(pctx, &pkey);
+		assert(ret == 1);
+		EVP_PKEY_CTX_free(pctx);
+		x509 = X509_new();
+		assert(x509);
+		ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+		X509_gmtime_adj(X509_get_notBefore(x509), 0);
+		X509_gmtime_adj(X509_get_notAfter(x509), 3600);
+		X509_set_pubkey(x509, pkey);
+		X509_NAME_add_entry_by_txt(X509_get_subject_name(x509), "CN", MBSTRING_ASC, (const unsigned char*)"doubango", -1, -1, 0);
+		X509_set_issuer_name(x509, X509_get_subject_name(x509));
+		ret = X509_sign(x509, pkey, EVP_sha256());
+		assert(ret > 0);
+		ret = SSL_CTX_use_certificate(ctx, x509);
+		assert(ret == 1);
+		ret = SSL_CTX_use_PrivateKey(ctx, pkey);
+		assert(ret == 1);
+		X509_free(x509);
+		EVP_PKEY_free(pkey);
+#if defined(SSL_OP_ALLOW_CLIENT_RENEGOTIATION)
+		SSL_CTX_set_options(ctx, SSL_OP_ALLOW_CLIENT_RENEGOTIATION);
+#endif
+	}
+	else{
+		SSL_CTX_set_info_callback(ctx, test_tls_engine_info_cb);
+	}
+	return ctx;
+}
+
+static tnet_fd_t test_tls_engine_fd_nonblocking(tnet_fd_t fd, int buffer_size)
+{
+	int ret;
+
+	ret = tnet_sockfd_set_nonblocking(fd);
+	assert(ret == 0);
+	ret = setsockopt(fd, SOL_SOCKET, SO_SNDBUF, (const char*)&buffer_size, sizeof(buffer_size));
+	assert(ret == 0);
+	ret = setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (const char*)&buffer_size, sizeof(buffer_size));
+	assert(ret == 0);
+	return fd;
+}
+
+/* connected pair of non-blocking TCP sockets with small kernel buffers */
+static void test_tls_engine_connect(tnet_fd_t* client, tnet_fd_t* server)
+{
+	struct sockaddr_in addr;
+	socklen_t addr_len = sizeof(addr);
+	tnet_fd_t fd;
+	int ret;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	fd = (tnet_fd_t)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	assert(fd != TNET_INVALID_FD);
+	ret = bind(fd, (const struct sockaddr*)&addr, sizeof(addr));
+	assert(ret == 0);
+	ret = listen(fd, 1);
+	assert(ret == 0);
+	ret = getsockname(fd, (struct sockaddr*)&addr, &addr_len);
+	assert(ret == 0);
+	*client = (tnet_fd_t)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	assert(*client != TNET_INVALID_FD);
+	ret = connect(*client, (const struct sockaddr*)&addr, sizeof(addr));
+	assert(ret == 0);
+	*server = (tnet_fd_t)accept(fd, tsk_null, tsk_null);
+	assert(*server != TNET_INVALID_FD);
+	tnet_sockfd_close(&fd);
+	test_tls_engine_fd_nonblocking(*client, 65536);
+	test_tls_engine_fd_nonblocking(*server, 65536);
+}
+
+/* what the transports do when the socket is readable and writable. Returns the number of bytes still queued for the network */
+static tsk_size_t test_tls_engine_pump(test_tls_engine_end_t* end, tsk_bool_t read)
+{
+	int ret;
+
+	if(read){
+		tsk_size_t size = 4096;
+		void* data = tsk_malloc(size);
+		tsk_bool_t isEncrypted;
+		ret = tnet_tls_socket_recv(end->tls, &data, &size, &isEncrypted);
+		assert(ret == 0);
+		if(!isEncrypted){
+			tsk_buffer_append(end->received, data, size);
+		}
+		TSK_FREE(data);
+	}
+	ret = tnet_tls_socket_flush(end->tls);
+	assert(ret >= 0);
+	return tnet_tls_socket_want_write(end->tls) ? 1 : 0;
+}
+
+/* runs both ends until "end" received "size" bytes */
+static void test_tls_engine_run(test_tls_engine_end_t* client, test_tls_engine_end_t* server, test_tls_engine_end_t* end, tsk_size_t size)
+{
+	int loops;
+	for(loops = 0; loops < 10000 && TSK_BUFFER_SIZE(end->received) < size; ++loops){
+		test_tls_engine_pump(client, tsk_true);
+		test_tls_engine_pump(server, tsk_true);
+		if(loops > 100){
+			tsk_thread_sleep(1);
+		}
+	}
+	assert(TSK_BUFFER_SIZE(end->received) == size);
+}
+
+void test_tls_engine()
+{
+	static const char hello[] = "REGISTER sip:doubango.org SIP/2.0\r\n\r\n";
+	test_tls_engine_end_t client = { TNET_INVALID_FD }, server = { TNET_INVALID_FD };
+	SSL_CTX *ctx_client, *ctx_server;
+	uint8_t *big;
+	tsk_size_t i;
+	int ret;
+
+	SSL_library_init();
+	SSL_load_error_strings();
+
+	/* renegotiation does not exist in TLS 1.3 */
+	ctx_client = test_tls_engine_ctx_create(tsk_false, TLS1_2_VERSION);
+	ctx_server = test_tls_engine_ctx_create(tsk_true, TLS1_2_VERSION);
+	test_tls_engine_connect(&client.fd, &server.fd);
+	client.tls = tnet_tls_socket_create(client.fd, ctx_client);
+	assert(client.tls);
+	server.tls = tnet_tls_socket_create(server.fd, ctx_server);
+	assert(server.tls);
+	client.received = tsk_buffer_create_null();
+	server.received = tsk_buffer_create_null();
+
+	/* data sent before the handshake completes is queued, then delivered */
+	ret = tnet_tls_socket_accept(server.tls);
+	assert(ret == 0);
+	ret = tnet_tls_socket_connect(client.tls, tsk_null, 0);
+	assert(ret == 0);
+	ret = tnet_tls_socket_write(client.tls, hello, sizeof(hello) - 1);
+	assert(ret == 0);
+	test_tls_engine_run(&client, &server, &server, sizeof(hello) - 1);
+	assert(memcmp(TSK_BUFFER_DATA(server.received), hello, sizeof(hello) - 1) == 0);
+	assert(test_tls_engine_client_ssl);
+
+	/* the peer is not reading: the writes never block, the records are queued and flushed once it reads */
+	big = tsk_malloc(TEST_TLS_ENGINE_BIG_SIZE);
+	assert(big);
+	for(i = 0; i < TEST_TLS_ENGINE_BIG_SIZE; ++i){
+		big[i] = (uint8_t)(i * 7);
+	}
+	tsk_buffer_cleanup(server.received);
+	for(i = 0; i < TEST_TLS_ENGINE_BIG_SIZE; i += TEST_TLS_ENGINE_BIG_SIZE / 16){
+		ret = tnet_tls_socket_write(client.tls, &big[i], TEST_TLS_ENGINE_BIG_SIZE / 16);
+		assert(ret == 0);
+	}
+	assert(tnet_tls_socket_want_write(client.tls));
+	test_tls_engine_run(&client, &server, &server, TEST_TLS_ENGINE_BIG_SIZE);
+	assert(memcmp(TSK_BUFFER_DATA(server.received), big, TEST_TLS_ENGINE_BIG_SIZE) == 0);
+	assert(!tnet_tls_socket_want_write(client.tls));
+
+	/* the write starting a renegotiation fails with SSL_ERROR_WANT_READ: queued and written again once the peer answered */
+	tsk_buffer_cleanup(server.received);
+	ret = SSL_renegotiate(test_tls_engine_client_ssl);
+	assert(ret == 1);
+	ret = tnet_tls_socket_write(client.tls, hello, sizeof(hello) - 1);
+	assert(ret == 0);
+	ret = tnet_tls_socket_write(client.tls, big, 1000);
+	assert(ret == 0); /* after the queued data */
+	assert(!SSL_is_init_finished(test_tls_engine_client_ssl));
+	test_tls_engine_run(&client, &server, &server, sizeof(hello) - 1 + 1000);
+	assert(memcmp(TSK_BUFFER_DATA(server.received), hello, sizeof(hello) - 1) == 0);
+	assert(memcmp(((const uint8_t*)TSK_BUFFER_DATA(server.received)) + sizeof(hello) - 1, big, 1000) == 0);
+	assert(SSL_is_init_finished(test_tls_engine_client_ssl));
+	assert(SSL_num_renegotiations(test_tls_engine_client_ssl) == 1);
+
+	/* and back to direct writes, in both directions */
+	tsk_buffer_cleanup(server.received);
+	ret = tnet_tls_socket_write(client.tls, hello, sizeof(hello) - 1);
+	assert(ret == 0);
+	ret = tnet_tls_socket_write(server.tls, big, 5000);
+	assert(ret == 0);
+	test_tls_engine_run(&client, &server, &server, sizeof(hello) - 1);
+	test_tls_engine_run(&client, &server, &client, 5000);
+	assert(memcmp(TSK_BUFFER_DATA(client.received), big, 5000) == 0);
+
+	/* the queue is capped when the peer never reads */
+	for(i = 0, ret = 0; i < 8 && ret == 0; ++i){
+		ret = tnet_tls_socket_write(client.tls, big, TEST_TLS_ENGINE_BIG_SIZE);
+	}
+	assert(ret != 0 && i > 1);
+
+	TSK_FREE(big);
+	TSK_OBJECT_SAFE_FREE(client.tls);
+	TSK_OBJECT_SAFE_FREE(server.tls);
+	TSK_OBJECT_SAFE_FREE(client.received);
+	TSK_OBJECT_SAFE_FREE(server.received);
+	tnet_sockfd_close(&client.fd);
+	tnet_sockfd_close(&server.fd);
+	SSL_CTX_free(ctx_client);
+	SSL_CTX_free(ctx_server);
+}
+
+/* one connection to "127.0.0.1:port": handshake then data in both directions (the client reads the TLS 1.3 tickets) */
+static void test_tls_engine_connection(SSL_CTX* ctx_client, SSL_CTX* ctx_server, tnet_port_t port)
+{
+	static const char hello[] = "OPTIONS sip:doubango.org SIP/2.0\r\n\r\n";
+	test_tls_engine_end_t client = { TNET_INVALID_FD }, server = { TNET_INVALID_FD };
+	int ret;
+
+	test_tls_engine_connect(&client.fd, &server.fd);
+	client.tls = tnet_tls_socket_create(client.fd, ctx_client);
+	assert(client.tls);
+	server.tls = tnet_tls_socket_create(server.fd, ctx_server);
+	assert(server.tls);
+	client.received = tsk_buffer_create_null();
+	server.received = tsk_buffer_create_null();
+	ret = tnet_tls_socket_accept(server.tls);
+	assert(ret == 0);
+	ret = tnet_tls_socket_connect(client.tls, "127.0.0.1", port);
+	assert(ret == 0);
+	ret = tnet_tls_socket_write(client.tls, hello, sizeof(hello) - 1);
+	assert(ret == 0);
+	test_tls_engine_run(&client, &server, &server, sizeof(hello) - 1);
+	ret = tnet_tls_socket_write(server.tls, hello, sizeof(hello) - 1);
+	assert(ret == 0);
+	test_tls_engine_run(&client, &server, &client, sizeof(hello) - 1);
+
+	TSK_OBJECT_SAFE_FREE(client.tls);
+	TSK_OBJECT_SAFE_FREE(server.tls);
+	TSK_OBJECT_SAFE_FREE(client.received);
+	TSK_OBJECT_SAFE_FREE(server.received);
+	tnet_sockfd_close(&client.fd);
+	tnet_sockfd_close(&server.fd);
+}
+
+/* runs connections and checks the handshakes are counted as expected (full/resumed), for both roles */
+static void test_tls_engine_connections(struct tnet_tls_sessions_s* sessions, SSL_CTX* ctx_client, SSL_CTX* ctx_server, tnet_port_t port, int count, uint64_t full, uint64_t resumed)
+{
+	tnet_tls_stats_t before, after;
+	int ret;
+
+	ret = tnet_tls_sessions_get_stats(sessions, &before);
+	assert(ret == 0);
+	while(count--){
+		test_tls_engine_connection(ctx_client, ctx_server, port);
+	}
+	ret = tnet_tls_sessions_get_stats(sessions, &after);
+	assert(ret == 0);
+	assert(after.client.full - before.client.full == full && after.server.full - before.server.full == full);
+	assert(after.client.resumed - before.client.resumed == resumed && after.server.resumed - before.server.resumed == resumed);
+}
+
+void test_tls_resumption()
+{
+	struct tnet_tls_sessions_s* sessions;
+	SSL_CTX *ctx_client, *ctx_server;
+	tnet_tls_stats_t stats;
+	int i, ret;
+
+	SSL_library_init();
+	SSL_load_error_strings();
+
+	for(i = 0; i < 2; ++i){
+		int version = i ? TLS1_2_VERSION : TLS1_3_VERSION;
+
+		/* tickets: the first connection to a destination is a full handshake, the next ones are resumed */
+		ctx_client = test_tls_engine_ctx_create(tsk_false, version);
+		ctx_server = test_tls_engine_ctx_create(tsk_true, version);
+		sessions = tnet_tls_sessions_create();
+		assert(sessions);
+		ret = tnet_tls_sessions_set(sessions, 16, 60, 60);
+		assert(ret == 0);
+		ret = tnet_tls_sessions_attach(sessions, ctx_client, ctx_server);
+		assert(ret == 0);
+		test_tls_engine_connections(sessions, ctx_client, ctx_server, 5061, 1, 1, 0);
+		test_tls_engine_connections(sessions, ctx_client, ctx_server, 5061, 3, 0, 3);
+		test_tls_engine_connections(sessions, ctx_client, ctx_server, 5062, 1, 1, 0); /* other destination */
+		test_tls_engine_connections(sessions, ctx_client, ctx_server, 5062, 1, 0, 1);
+		ret = tnet_tls_sessions_get_stats(sessions, &stats);
+		assert(ret == 0);
+		assert(stats.client_sessions == 2);
+		assert(stats.ticket_key_rotations == 1);
+
+		/* session ids only (the TLS 1.3 "tickets" are then stateful) */
+		ret = tnet_tls_sessions_set(sessions, 16, 60, 0);
+		assert(ret == 0);
+		ret = tnet_tls_sessions_attach(sessions, ctx_client, ctx_server);
+		assert(ret == 0);
+		test_tls_engine_connections(sessions, ctx_client, ctx_server, 5063, 1, 1, 0);
+		test_tls_engine_connections(sessions, ctx_client, ctx_server, 5063, 2, 0, 2);
+
+		/* nothing to resume from */
+		ret = tnet_tls_sessions_set(sessions, 0, 60, 0);
+		assert(ret == 0);
+		ret = tnet_tls_sessions_attach(sessions, ctx_client, ctx_server);
+		assert(ret == 0);
+		test_tls_engine_connections(sessions, ctx_client, ctx_server, 5064, 2, 2, 0);
+
+		TSK_OBJECT_SAFE_FREE(sessions);
+		SSL_CTX_free(ctx_client);
+		SSL_CTX_free(ctx_server);
+	}
+
+	/* ticket key rotation: the previous key is still accepted during one period, then the tickets expire */
+	ctx_client = test_tls_engine_ctx_create(tsk_false, TLS1_3_VERSION);
+	ctx_server = test_tls_engine_ctx_create(tsk_true, TLS1_3_VERSION);
+	sessions = tnet_tls_sessions_create();
+	assert(sessions);
+	ret = tnet_tls_sessions_set(sessions, 0, 60, 1);
+	assert(ret == 0);
+	ret = tnet_tls_sessions_attach(sessions, ctx_client, ctx_server);
+	assert(ret == 0);
+	test_tls_engine_connections(sessions, ctx_client, ctx_server, 5061, 1, 1, 0);
+	tsk_thread_sleep(1100);
+	test_tls_engine_connections(sessions, ctx_client, ctx_server, 5061, 1, 0, 1);
+	tsk_thread_sleep(2100);
+	test_tls_engine_connections(sessions, ctx_client, ctx_server, 5061, 1, 1, 0);
+	ret = tnet_tls_sessions_get_stats(sessions, &stats);
+	assert(ret == 0);
+	assert(stats.ticket_key_rotations == 3);
+	TSK_OBJECT_SAFE_FREE(sessions);
+	SSL_CTX_free(ctx_client);
+	SSL_CTX_free(ctx_server);
+}
+#endif /* HAVE_OPENSSL */
+
 #endif /* TNET_TEST_TLS_H */
 
@@ -76,6 +76,8 @@ TINYRTP_API tsk_size_t trtp_rtp_header_guess_serialbuff_size(const trtp_rtp_head
 TINYRTP_API tsk_size_t trtp_rtp_header_serialize_to(const trtp_rtp_header_t *self, void *buffer, tsk_size_t size);
 TINYRTP_API tsk_buffer_t* trtp_rtp_header_serialize(const trtp_rtp_header_t *self);
 TINYRTP_API trtp_rtp_header_t* trtp_rtp_header_deserialize(const void *data, tsk_size_t size);
+TINYRTP_API int trtp_rtp_header_deserialize_to(trtp_rtp_header_t *self, const void *data, tsk_size_t size);
+TINYRTP_API int trtp_rtp_header_copy(trtp_rtp_header_t *self, const trtp_rtp_header_t *other);
 
 
 TINYRTP_GEXTERN const tsk_object_def_t *trtp_rtp_header_def_t;
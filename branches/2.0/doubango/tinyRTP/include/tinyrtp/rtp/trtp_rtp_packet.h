@@ -52,8 +52,12 @@ typedef struct trtp_rtp_packet_s
 	/* extension header as per RFC 3550 section 5.3.1 */
 	struct{
 		void* data;
+		const void* data_const; // never free()d. an alternative to "data"
 		tsk_size_t size; /* contains the first two 16-bit fields */
 	} extension;
+
+	/* whether the payload and the extension are borrowed from the network buffer (see trtp_rtp_packet_deserialize_view()) */
+	tsk_bool_t is_view;
 }
 trtp_rtp_packet_t;
 typedef tsk_list_t trtp_rtp_packets_L_t;
@@ -65,6 +69,9 @@ TINYRTP_API tsk_size_t trtp_rtp_packet_guess_serialbuff_size(const trtp_rtp_pack
 TINYRTP_API tsk_size_t trtp_rtp_packet_serialize_to(const trtp_rtp_packet_t *self, void* buffer, tsk_size_t size);
 TINYRTP_API tsk_buffer_t* trtp_rtp_packet_serialize(const trtp_rtp_packet_t *self, tsk_size_t num_bytes_pad);
 TINYRTP_API trtp_rtp_packet_t* trtp_rtp_packet_deserialize(const void *data, tsk_size_t size);
+TINYRTP_API int trtp_rtp_packet_recycle(trtp_rtp_packet_t** self);
+TINYRTP_API int trtp_rtp_packet_deserialize_view(trtp_rtp_packet_t** self, const void *data, tsk_size_t size);
+TINYRTP_API trtp_rtp_packet_t* trtp_rtp_packet_materialize(const trtp_rtp_packet_t* self);
 
 
 TINYRTP_GEXTERN const tsk_object_def_t *trtp_rtp_packet_def_t;
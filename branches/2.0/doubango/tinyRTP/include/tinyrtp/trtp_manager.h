@@ -37,6 +37,30 @@
 TRTP_BEGIN_DECLS
 
 struct trtp_rtp_packet_s;
+struct trtp_manager_s;
+
+/** Maximum number of peer managers a single manager can relay to */
+#define TRTP_MANAGER_RELAY_LEGS_MAX	16
+
+/** Relay (SFU) leg: one peer manager receiving the forwarded stream */
+typedef struct trtp_manager_relay_leg_s
+{
+	struct trtp_manager_s* manager; // peer manager (strong reference)
+	tsk_bool_t anchored; // whether the offsets below are computed
+	uint32_t ssrc_source; // SSRC of the source the offsets were computed for
+	uint16_t seq_offset; // added to the source sequence number
+	uint32_t ts_offset; // added to the source timestamp
+}
+trtp_manager_relay_leg_t;
+
+/** Relay (SFU) scratch buffer: used when a packet must be copied (SRTP re-keying, rewritten RTCP feedback) */
+typedef struct trtp_manager_relay_buffer_s
+{
+	void* ptr;
+	tsk_size_t size;
+	tsk_mutex_handle_t* mutex; // held while the buffer is in use
+}
+trtp_manager_relay_buffer_t;
 
 /** RTP/RTCP manager */
 typedef struct trtp_manager_s
@@ -100,6 +124,11 @@ typedef struct trtp_manager_s
 			void* ptr;
 			tsk_size_t size;
 		} serial_buffer;
+
+		struct{
+			struct trtp_rtp_packet_s* packet; // reused to parse the received packets in place (see trtp_rtp_packet_deserialize_view())
+			tsk_mutex_handle_t* mutex; // only protects "packet", never held while calling the callbacks
+		} recv;
 	} rtp;
 
 	struct{
@@ -120,6 +149,18 @@ typedef struct trtp_manager_s
 		struct trtp_rtcp_session_s* session;
 	} rtcp;
 
+	// relay (SFU) mode: received RTP packets and RTCP feedback are forwarded to the peers without being decoded
+	struct{
+		trtp_manager_relay_leg_t legs[TRTP_MANAGER_RELAY_LEGS_MAX];
+		tsk_size_t count;
+		tsk_bool_t local_delivery; // whether received RTP packets are still forwarded to "rtp.cb"
+		tsk_mutex_handle_t* mutex; // only protects "legs" and "count", never held while calling another manager
+
+		// one buffer per direction: RTP and RTCP could be received by different threads
+		trtp_manager_relay_buffer_t buffer_rtp;
+		trtp_manager_relay_buffer_t buffer_rtcp;
+	} relay;
+
 	TSK_DECLARE_SAFEOBJ;
 
 #if HAVE_SRTP	
@@ -203,6 +244,10 @@ TINYRTP_API int trtp_manager_start(trtp_manager_t* self);
 TINYRTP_API tsk_size_t trtp_manager_send_rtp(trtp_manager_t* self, const void* data, tsk_size_t size, uint32_t duration, tsk_bool_t marker, tsk_bool_t last_packet);
 TINYRTP_API tsk_size_t trtp_manager_send_rtp_packet(trtp_manager_t* self, const struct trtp_rtp_packet_s* packet, tsk_bool_t bypass_encrypt);
 TINYRTP_API tsk_size_t trtp_manager_send_rtp_raw(trtp_manager_t* self, const void* data, tsk_size_t size);
+TINYRTP_API tsk_size_t trtp_manager_send_rtp_raw_batch(trtp_manager_t* self, const void* const* datas, const tsk_size_t* sizes, tsk_size_t count);
+TINYRTP_API int trtp_manager_relay_add(trtp_manager_t* self, trtp_manager_t* peer);
+TINYRTP_API int trtp_manager_relay_remove(trtp_manager_t* self, const trtp_manager_t* peer);
+TINYRTP_API int trtp_manager_relay_set_local_delivery(trtp_manager_t* self, tsk_bool_t enabled);
 TINYRTP_API int trtp_manager_set_app_bandwidth_max(trtp_manager_t* self, int32_t bw_upload_kbps, int32_t bw_download_kbps);
 TINYRTP_API int trtp_manager_signal_pkt_loss(trtp_manager_t* self, uint32_t ssrc_media, const uint16_t* seq_nums, tsk_size_t count);
 TINYRTP_API int trtp_manager_signal_frame_corrupted(trtp_manager_t* self, uint32_t ssrc_media);
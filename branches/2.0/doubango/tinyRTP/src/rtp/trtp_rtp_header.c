@@ -33,6 +33,8 @@
 #include "tsk_memory.h"
 #include "tsk_debug.h"
 
+#include <string.h> /* memcpy() */
+
 	/* RFC 3550 section 5.1 - RTP Fixed Header Fields
 		0                   1                   2                   3
 		0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
@@ -156,17 +158,61 @@ tsk_buffer_t* trtp_rtp_header_serialize(const trtp_rtp_header_t *self)
 trtp_rtp_header_t* trtp_rtp_header_deserialize(const void *data, tsk_size_t size)
 {
 	trtp_rtp_header_t* header = tsk_null;
-	const uint8_t* pdata = (const uint8_t*)data;
-	uint8_t csrc_count, i;
 
 	if(!data){
 		TSK_DEBUG_ERROR("Invalid parameter");
 		return tsk_null;
 	}
 
+	if(!(header = trtp_rtp_header_create_null())){
+		TSK_DEBUG_ERROR("Failed to create new RTP header");
+		return tsk_null;
+	}
+
+	if(trtp_rtp_header_deserialize_to(header, data, size) != 0){
+		TSK_OBJECT_SAFE_FREE(header);
+	}
+	
+	return header;
+}
+
+/* copies the fields of "other" into an existing object (not the object identity) */
+// returns zero if succeed and non-zero error code otherwise
+int trtp_rtp_header_copy(trtp_rtp_header_t *self, const trtp_rtp_header_t *other)
+{
+	if(!self || !other){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	self->version = other->version;
+	self->padding = other->padding;
+	self->extension = other->extension;
+	self->csrc_count = other->csrc_count;
+	self->marker = other->marker;
+	self->payload_type = other->payload_type;
+	self->seq_num = other->seq_num;
+	self->timestamp = other->timestamp;
+	self->ssrc = other->ssrc;
+	memcpy(self->csrc, other->csrc, sizeof(other->csrc));
+	self->codec_id = other->codec_id;
+	return 0;
+}
+
+/* deserialize the RTP header from a buffer into an existing object (no allocation) */
+// returns zero if succeed and non-zero error code otherwise
+int trtp_rtp_header_deserialize_to(trtp_rtp_header_t *self, const void *data, tsk_size_t size)
+{
+	const uint8_t* pdata = (const uint8_t*)data;
+	uint8_t csrc_count, i;
+
+	if(!self || !data){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+
 	if(size <TRTP_RTP_HEADER_MIN_SIZE){
 		TSK_DEBUG_ERROR("Too short to contain RTP header");
-		return tsk_null;
+		return -2;
 	}
 
 	/* Before starting to deserialize, get the "csrc_count" and check the length validity
@@ -175,60 +221,54 @@ trtp_rtp_header_t* trtp_rtp_header_deserialize(const void *data, tsk_size_t size
 	csrc_count = (*pdata & 0x0F);
 	if(size <(tsk_size_t)TRTP_RTP_HEADER_MIN_SIZE + (csrc_count << 2)){
 		TSK_DEBUG_ERROR("Too short to contain RTP header");
-		return tsk_null;
-	}
-
-	if(!(header = trtp_rtp_header_create_null())){
-		TSK_DEBUG_ERROR("Failed to create new RTP header");
-		return tsk_null;
+		return -2;
 	}
 
 	/* version (2bits) */
-	header->version = (*pdata >> 6);
+	self->version = (*pdata >> 6);
 	/* Padding (1bit) */
-	header->padding = ((*pdata >>5) & 0x01);
+	self->padding = ((*pdata >>5) & 0x01);
 	/* Extension (1bit) */
-	header->extension = ((*pdata >>4) & 0x01);
+	self->extension = ((*pdata >>4) & 0x01);
 	/* CSRC Count (4bits) */
-	header->csrc_count = csrc_count;
+	self->csrc_count = csrc_count;
 	// skip octet
 	++pdata;
 
 	/* Marker (1bit) */
-	header->marker = (*pdata >> 7);
+	self->marker = (*pdata >> 7);
 	/* Payload Type (7bits) */
-	header->payload_type = (*pdata & 0x7F);
+	self->payload_type = (*pdata & 0x7F);
 	// skip octet
 	++pdata;
 
 	/* Sequence Number (16bits) */
-	header->seq_num = pdata[0] << 8 | pdata[1];
+	self->seq_num = pdata[0] << 8 | pdata[1];
 	// skip octets
 	pdata += 2;
 
 	/* timestamp (32bits) */
-	header->timestamp = pdata[0] << 24 | pdata[1] << 16 | pdata[2] << 8 | pdata[3];
+	self->timestamp = pdata[0] << 24 | pdata[1] << 16 | pdata[2] << 8 | pdata[3];
 	// skip octets
 	pdata += 4;
 
 	/* synchronization source (SSRC) identifier (32bits) */
-	header->ssrc = pdata[0] << 24 | pdata[1] << 16 | pdata[2] << 8 | pdata[3];
+	self->ssrc = pdata[0] << 24 | pdata[1] << 16 | pdata[2] << 8 | pdata[3];
 	// skip octets
 	pdata += 4;
 
 	/* contributing source (CSRC) identifiers */
 	for(i=0; i<csrc_count; i++, pdata += 4){
-		header->csrc[i] = pdata[0] << 24 | pdata[1] << 16 | pdata[2] << 8 | pdata[3];
+		self->csrc[i] = pdata[0] << 24 | pdata[1] << 16 | pdata[2] << 8 | pdata[3];
 	}
 	
-	return header;
+	return 0;
 }
 
 
 
 
 
-
 //=================================================================================================
 //	RTP header object definition
 //
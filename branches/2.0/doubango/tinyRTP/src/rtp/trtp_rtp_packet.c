@@ -73,7 +73,7 @@ tsk_size_t trtp_rtp_packet_guess_serialbuff_size(const trtp_rtp_packet_t *self)
 		return 0;
 	}
 	size += trtp_rtp_header_guess_serialbuff_size(self->header);
-	if(self->extension.data && self->extension.size && self->header->extension){
+	if((self->extension.data || self->extension.data_const) && self->extension.size && self->header->extension){
 		size += self->extension.size;
 	}
 	size += self->payload.size;
@@ -98,8 +98,8 @@ tsk_size_t trtp_rtp_packet_serialize_to(const trtp_rtp_packet_t *self, void* buf
 	pbuff += s;
 
 	/* extension */
-	if(self->extension.data && self->extension.size && self->header->extension){
-		memcpy(pbuff, self->extension.data, self->extension.size);
+	if((self->extension.data || self->extension.data_const) && self->extension.size && self->header->extension){
+		memcpy(pbuff, self->extension.data ? self->extension.data : self->extension.data_const, self->extension.size);
 		pbuff += self->extension.size;
 	}
 	/* append payload */
@@ -136,71 +136,162 @@ tsk_buffer_t* trtp_rtp_packet_serialize(const trtp_rtp_packet_t *self, tsk_size_
 /** Deserialize rtp packet object from binary buffer */
 trtp_rtp_packet_t* trtp_rtp_packet_deserialize(const void *data, tsk_size_t size)
 {
-	trtp_rtp_packet_t* packet = tsk_null;
-	trtp_rtp_header_t *header;
+	trtp_rtp_packet_t *view = tsk_null, *packet;
+
+	if(trtp_rtp_packet_deserialize_view(&view, data, size) != 0){
+		TSK_OBJECT_SAFE_FREE(view);
+		return tsk_null;
+	}
+	/* copy the extension and the payload */
+	packet = trtp_rtp_packet_materialize(view);
+	TSK_OBJECT_SAFE_FREE(view);
+	return packet;
+}
+
+/** Gets a packet (with a header) which could be overwritten: the object is reused unless someone else holds a reference to it (or to its header).
+* @param self The packet to recycle. Replaced by a new object if null or still used by someone else.
+* @retval Zero if succeed and non-zero error code otherwise. The packet has no data and isn't a view.
+*/
+int trtp_rtp_packet_recycle(trtp_rtp_packet_t** self)
+{
+	if(!self){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	if(*self && tsk_object_get_refcount(*self) > 1){
+		TSK_OBJECT_SAFE_FREE(*self);
+	}
+	if(!*self && !(*self = trtp_rtp_packet_create_null())){
+		TSK_DEBUG_ERROR("Failed to create new RTP packet");
+		return -2;
+	}
+	if((*self)->header && tsk_object_get_refcount((*self)->header) > 1){
+		TSK_OBJECT_SAFE_FREE((*self)->header);
+	}
+	if(!(*self)->header && !((*self)->header = trtp_rtp_header_create_null())){
+		TSK_DEBUG_ERROR("Failed to create new RTP header");
+		return -2;
+	}
+	TSK_FREE((*self)->payload.data);
+	TSK_FREE((*self)->extension.data);
+	(*self)->payload.data_const = (*self)->extension.data_const = tsk_null;
+	(*self)->payload.size = (*self)->extension.size = 0;
+	(*self)->is_view = tsk_false;
+	return 0;
+}
+
+/** Deserialize rtp packet in place, without copying the payload.
+* @param self The packet to fill. Reused (no allocation) unless it's null or someone else holds a reference to it (see @ref trtp_rtp_packet_recycle()).
+* @param data The received buffer. The payload and the extension will point into it.
+* @param size The size of the received buffer.
+* @retval Zero if succeed and non-zero error code otherwise.
+* The payload and the extension are only valid while @a data is valid. A callee wanting to keep the packet (e.g. jitter buffer)
+* must use @ref trtp_rtp_packet_materialize().
+*/
+int trtp_rtp_packet_deserialize_view(trtp_rtp_packet_t** self, const void *data, tsk_size_t size)
+{
+	trtp_rtp_header_t* header;
 	tsk_size_t payload_size;
-	const uint8_t* pdata = data;
+	const uint8_t* pdata;
+	int ret;
 
-	if(!data){
+	if(!self || !data){
 		TSK_DEBUG_ERROR("Invalid parameter");
-		return tsk_null;
+		return -1;
 	}
 
 	if(size< TRTP_RTP_HEADER_MIN_SIZE){
 		TSK_DEBUG_ERROR("Too short to contain RTP message");
-		return tsk_null;
+		return -2;
 	}
-	
+
+	if((ret = trtp_rtp_packet_recycle(self))){
+		return ret;
+	}
+	header = (*self)->header;
+
 	/* deserialize the RTP header (the packet itsel will be deserialized only if the header deserialization succeed) */
-	if(!(header = trtp_rtp_header_deserialize(data, size))){
+	if((ret = trtp_rtp_header_deserialize_to(header, data, size))){
 		TSK_DEBUG_ERROR("Failed to deserialize RTP header");
-		return tsk_null;
+		return ret;
 	}
-	else{
-		/* create the packet */
-		if(!(packet = trtp_rtp_packet_create_null())){
-			TSK_DEBUG_ERROR("Failed to create new RTP packet");
-			TSK_OBJECT_SAFE_FREE(header);
-			return tsk_null;
+	header->codec_id = tmedia_codec_id_none;
+	(*self)->is_view = tsk_true;
+
+	/* do not need to check overflow (have been done by trtp_rtp_header_deserialize_to()) */
+	payload_size = (size - TRTP_RTP_HEADER_MIN_SIZE - (header->csrc_count << 2));
+	pdata = ((const uint8_t*)data) + (size - payload_size);
+
+	/*	RFC 3550 - 5.3.1 RTP Header Extension
+		If the X bit in the RTP header is one, a variable-length header
+		extension MUST be appended to the RTP header, following the CSRC list
+		if present.  The header extension contains a 16-bit length field that
+		counts the number of 32-bit words in the extension, excluding the
+		four-octet extension header (therefore zero is a valid length).  Only
+		a single extension can be appended to the RTP data header.
+		0                   1                   2                   3
+		0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+	   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	   |      defined by profile       |           length              |
+	   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	   |                        header extension                       |
+	   |                             ....                              |
+	*/
+	if(header->extension && payload_size>=4 /* extension min-size */){
+		tsk_size_t extension_size = 4 /* first two 16-bit fields */ + (tnet_ntohs_2(&pdata[2]) << 2/*words(32-bit)*/);
+		if(extension_size > payload_size){
+			TSK_DEBUG_ERROR("Too short to contain RTP header extension (%u > %u)", (unsigned)extension_size, (unsigned)payload_size);
+			return -3;
 		}
-		/* set the header */
-		packet->header = header,
-			header = tsk_null;
-		
-		/* do not need to check overflow (have been done by trtp_rtp_header_deserialize()) */
-		payload_size = (size - TRTP_RTP_HEADER_MIN_SIZE - (packet->header->csrc_count << 2));
-		pdata = ((const uint8_t*)data) + (size - payload_size);
-
-		/*	RFC 3550 - 5.3.1 RTP Header Extension
-			If the X bit in the RTP header is one, a variable-length header
-			extension MUST be appended to the RTP header, following the CSRC list
-			if present.  The header extension contains a 16-bit length field that
-			counts the number of 32-bit words in the extension, excluding the
-			four-octet extension header (therefore zero is a valid length).  Only
-			a single extension can be appended to the RTP data header.
-			0                   1                   2                   3
-			0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
-		   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-		   |      defined by profile       |           length              |
-		   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-		   |                        header extension                       |
-		   |                             ....                              |
-		*/
-		if(packet->header->extension && payload_size>=4 /* extension min-size */){
-			packet->extension.size = 4 /* first two 16-bit fields */ + (tnet_ntohs(*((uint16_t*)&pdata[2])) << 2/*words(32-bit)*/);
-			if((packet->extension.data = tsk_calloc(packet->extension.size, sizeof(uint8_t)))){
-				memcpy(packet->extension.data, pdata, packet->extension.size);
-			}
-			payload_size -= packet->extension.size;
+		(*self)->extension.data_const = pdata;
+		(*self)->extension.size = extension_size;
+		payload_size -= extension_size;
+	}
+
+	(*self)->payload.data_const = (pdata + (*self)->extension.size);
+	(*self)->payload.size = payload_size;
+
+	return 0;
+}
+
+/** Gets a packet which could be kept after the network buffer is reused.
+* @param self The packet to materialize.
+* @retval A new reference to @a self if it's already an owned packet or a deep copy if it's a view (see @ref trtp_rtp_packet_deserialize_view()).
+* It's up to the caller to free the returned object.
+*/
+trtp_rtp_packet_t* trtp_rtp_packet_materialize(const trtp_rtp_packet_t* self)
+{
+	trtp_rtp_packet_t* packet;
+
+	if(!self || !self->header){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return tsk_null;
+	}
+	if(!self->is_view){
+		return tsk_object_ref(TSK_OBJECT(self));
+	}
+
+	if(!(packet = trtp_rtp_packet_create_null()) || !(packet->header = trtp_rtp_header_create_null())){
+		TSK_DEBUG_ERROR("Failed to create new RTP packet");
+		TSK_OBJECT_SAFE_FREE(packet);
+		return tsk_null;
+	}
+	trtp_rtp_header_copy(packet->header, self->header);
+
+	if(self->extension.size && (self->extension.data || self->extension.data_const)){
+		if((packet->extension.data = tsk_malloc(self->extension.size))){
+			memcpy(packet->extension.data, self->extension.data ? self->extension.data : self->extension.data_const, self->extension.size);
+			packet->extension.size = self->extension.size;
 		}
+	}
 
-		packet->payload.size = payload_size;
-		if(payload_size && (packet->payload.data = tsk_calloc(packet->payload.size, sizeof(uint8_t)))){
-			memcpy(packet->payload.data, (pdata + packet->extension.size), packet->payload.size);
+	if(self->payload.size && (self->payload.data || self->payload.data_const)){
+		if((packet->payload.data = tsk_malloc(self->payload.size))){
+			memcpy(packet->payload.data, self->payload.data ? self->payload.data : self->payload.data_const, self->payload.size);
+			packet->payload.size = self->payload.size;
 		}
 		else{
 			TSK_DEBUG_ERROR("Failed to allocate new buffer");
-			packet->payload.size = 0;
 		}
 	}
 
@@ -214,7 +305,6 @@ trtp_rtp_packet_t* trtp_rtp_packet_deserialize(const void *data, tsk_size_t size
 
 
 
-
 //=================================================================================================
 //	RTP packet object definition
 //
@@ -233,6 +323,7 @@ static tsk_object_t* trtp_rtp_packet_dtor(tsk_object_t * self)
 		TSK_FREE(packet->payload.data);
 		TSK_FREE(packet->extension.data);
 		packet->payload.data_const = tsk_null;
+		packet->extension.data_const = tsk_null;
 	}
 
 	return self;
@@ -26,6 +26,8 @@
 
 #include "tinyrtp/rtp/trtp_rtp_packet.h"
 #include "tinyrtp/rtcp/trtp_rtcp_packet.h"
+#include "tinyrtp/rtcp/trtp_rtcp_header.h"
+#include "tinyrtp/rtcp/trtp_rtcp_report_fb.h"
 #include "tinyrtp/rtcp/trtp_rtcp_session.h"
 
 #include "turn/tnet_turn_session.h"
@@ -68,9 +70,18 @@
 #	define TRTP_DTLS_HANDSHAKING_TIMEOUT_MAX (TRTP_DTLS_HANDSHAKING_TIMEOUT << 20)
 #endif
 
+// room needed at the end of a buffer to encrypt it in place
+#if HAVE_SRTP
+#	define TRTP_SRTP_PAD_SIZE (SRTP_MAX_TRAILER_LEN + 0x04)
+#else
+#	define TRTP_SRTP_PAD_SIZE 0
+#endif
+
 static const tmedia_srtp_type_t __srtp_types[] = { tmedia_srtp_type_sdes, tmedia_srtp_type_dtls };
 
 static int _trtp_manager_recv_data(const trtp_manager_t* self, const uint8_t* data_ptr, tsk_size_t data_size, tnet_fd_t local_fd, const struct sockaddr_storage* remote_addr);
+static int _trtp_manager_relay_forward_rtp(trtp_manager_t* self, const struct trtp_rtp_packet_s* packet, uint8_t* data_ptr, tsk_size_t data_size);
+static int _trtp_manager_relay_forward_rtcp(trtp_manager_t* self, const uint8_t* data_ptr, tsk_size_t data_size);
 #define _trtp_manager_is_rtcpmux_active(self) ( (self) && ( (self)->use_rtcpmux && (!(self)->rtcp.local_socket || ((self)->transport && (self)->transport->master && (self)->transport->master->fd == (self)->rtcp.local_socket->fd)) ) )
 #if HAVE_SRTP
 static int _trtp_manager_srtp_set_enabled(trtp_manager_t* self, tmedia_srtp_type_t srtp_type, tsk_bool_t enabled);
@@ -424,6 +435,9 @@ static int _trtp_manager_recv_data(const trtp_manager_t* self, const uint8_t* da
 				}
 			}
 			#endif
+			if(self->relay.count){
+				_trtp_manager_relay_forward_rtcp((trtp_manager_t*)self, data_ptr, data_size);
+			}
 			return trtp_rtcp_session_process_rtcp_in(self->rtcp.session, data_ptr, data_size);
 		}
 		TSK_DEBUG_WARN("No RTCP session");
@@ -438,8 +452,11 @@ static int _trtp_manager_recv_data(const trtp_manager_t* self, const uint8_t* da
 			}
 		}
 
-		if(self->rtp.cb.fun){
-			trtp_rtp_packet_t* packet_rtp = tsk_null;
+		if(self->rtp.cb.fun || self->relay.count){
+			// parsed in place: no copy and, unless another thread is receiving or a callee kept the previous packet, no allocation.
+			// The callee materializes it only if it has to keep it.
+			trtp_rtp_packet_t* packet_rtp;
+			int ret = -1;
 			#if HAVE_SRTP
 			err_status_t status;
 			if(self->srtp_ctx_neg_remote){
@@ -449,22 +466,37 @@ static int _trtp_manager_recv_data(const trtp_manager_t* self, const uint8_t* da
 				}
 			}
 			#endif
-			if((packet_rtp = trtp_rtp_packet_deserialize(data_ptr, data_size))){
+			tsk_mutex_lock(self->rtp.recv.mutex);
+			packet_rtp = self->rtp.recv.packet, ((trtp_manager_t*)self)->rtp.recv.packet = tsk_null;
+			tsk_mutex_unlock(self->rtp.recv.mutex);
+			if(trtp_rtp_packet_deserialize_view(&packet_rtp, data_ptr, data_size) == 0){
 				// update remote SSRC based on received RTP packet
 				((trtp_manager_t*)self)->rtp.ssrc.remote = packet_rtp->header->ssrc;
+				// relay mode: forward to the peers before decoding (if ever) to keep the added latency low
+				if(self->relay.count){
+					_trtp_manager_relay_forward_rtp((trtp_manager_t*)self, packet_rtp, (uint8_t*)data_ptr, data_size);
+				}
 				// forward to the callback function (most likely "session_av")
-				self->rtp.cb.fun(self->rtp.cb.usrdata, packet_rtp);
+				if(self->rtp.cb.fun && self->relay.local_delivery){
+					self->rtp.cb.fun(self->rtp.cb.usrdata, packet_rtp);
+				}
 				// forward packet to the RTCP session
 				if(self->rtcp.session){
 					trtp_rtcp_session_process_rtp_in(self->rtcp.session, packet_rtp, data_size);
 				}
-				TSK_OBJECT_SAFE_FREE(packet_rtp);
-				return 0;
+				ret = 0;
 			}
 			else{
 				TSK_DEBUG_ERROR("RTP packet === NOK");
-				return -1;
 			}
+			// give the packet back for the next call (trtp_rtp_packet_deserialize_view() replaces it if a callee kept it)
+			tsk_mutex_lock(self->rtp.recv.mutex);
+			if(!self->rtp.recv.packet){
+				((trtp_manager_t*)self)->rtp.recv.packet = packet_rtp, packet_rtp = tsk_null;
+			}
+			tsk_mutex_unlock(self->rtp.recv.mutex);
+			TSK_OBJECT_SAFE_FREE(packet_rtp);
+			return ret;
 		}
 		return 0;
 	}
@@ -1564,6 +1596,382 @@ tsk_size_t trtp_manager_send_rtp_raw(trtp_manager_t* self, const void* data, tsk
 	return ret;
 }
 
+// send several raw packets "as is" using a single system call (when supported)
+// returns the number of packets sent
+tsk_size_t trtp_manager_send_rtp_raw_batch(trtp_manager_t* self, const void* const* datas, const tsk_size_t* sizes, tsk_size_t count)
+{
+	tsk_size_t ret = 0;
+
+	if(!self || !self->transport || !self->transport->master || !datas || !sizes || !count){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return 0;
+	}
+	tsk_safeobj_lock(self);
+	if (self->is_ice_turn_active) {
+		// TURN channels: no batching
+		for (ret = 0; ret < count; ++ret) {
+			if (tnet_ice_ctx_send_turn_rtp(self->ice_ctx, datas[ret], sizes[ret]) != 0) {
+				break;
+			}
+		}
+	}
+	else {
+		int sent = tnet_sockfd_sendto_batch(self->transport->master->fd, (const struct sockaddr *)&self->rtp.remote_addr, datas, sizes, count); // returns number of sent packets
+		ret = (sent > 0) ? (tsk_size_t)sent : 0;
+	}
+	tsk_safeobj_unlock(self);
+	return ret;
+}
+
+/** Adds a peer manager to relay (SFU mode) the received RTP packets and RTCP feedback to.
+* The packets are not decoded: the header is rewritten to the peer's SSRC, with the sequence numbers and timestamps shifted to continue the peer's own numbering.
+* With SRTP, the packets are decrypted with the keys of this leg then encrypted with the peer's keys.
+* The peer is referenced until removed or until this manager is stopped: stop both managers (or remove the legs) when relaying in both directions.
+* @param self The manager receiving the source stream.
+* @param peer The manager sending the relayed stream.
+* @retval 0 if succeed, non-zero error code otherwise.
+*/
+int trtp_manager_relay_add(trtp_manager_t* self, trtp_manager_t* peer)
+{
+	int ret = 0;
+	tsk_size_t i;
+
+	if(!self || !peer || self == peer){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+
+	tsk_mutex_lock(self->relay.mutex);
+	for(i = 0; i < self->relay.count; ++i){
+		if(self->relay.legs[i].manager == peer){
+			goto bail; // already added
+		}
+	}
+	if(self->relay.count >= TRTP_MANAGER_RELAY_LEGS_MAX){
+		TSK_DEBUG_ERROR("Too many relay legs (max=%d)", TRTP_MANAGER_RELAY_LEGS_MAX);
+		ret = -2;
+		goto bail;
+	}
+	memset(&self->relay.legs[self->relay.count], 0, sizeof(self->relay.legs[self->relay.count]));
+	self->relay.legs[self->relay.count++].manager = tsk_object_ref(peer);
+
+bail:
+	tsk_mutex_unlock(self->relay.mutex);
+	return ret;
+}
+
+/** Stops relaying to a peer manager previously added using @ref trtp_manager_relay_add() */
+int trtp_manager_relay_remove(trtp_manager_t* self, const trtp_manager_t* peer)
+{
+	tsk_size_t i;
+	trtp_manager_t* removed = tsk_null;
+
+	if(!self || !peer){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+
+	tsk_mutex_lock(self->relay.mutex);
+	for(i = 0; i < self->relay.count; ++i){
+		if(self->relay.legs[i].manager == peer){
+			removed = self->relay.legs[i].manager;
+			self->relay.legs[i] = self->relay.legs[--self->relay.count];
+			break;
+		}
+	}
+	tsk_mutex_unlock(self->relay.mutex);
+	
+	// released outside the lock: could be the last reference
+	TSK_OBJECT_SAFE_FREE(removed);
+	return 0;
+}
+
+/** Whether the received RTP packets are still forwarded to the RTP callback (to be decoded) when relaying. Default: true.
+* Disabling the local delivery makes the manager a pure forwarder.
+*/
+int trtp_manager_relay_set_local_delivery(trtp_manager_t* self, tsk_bool_t enabled)
+{
+	if(!self){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	self->relay.local_delivery = enabled;
+	return 0;
+}
+
+// copies the legs and references their managers to be able to send without holding the relay lock
+static tsk_size_t _trtp_manager_relay_legs_ref(trtp_manager_t* self, trtp_manager_relay_leg_t legs[TRTP_MANAGER_RELAY_LEGS_MAX])
+{
+	tsk_size_t i, count;
+	tsk_mutex_lock(self->relay.mutex);
+	for(i = 0, count = self->relay.count; i < count; ++i){
+		legs[i] = self->relay.legs[i];
+		legs[i].manager = tsk_object_ref(legs[i].manager);
+	}
+	tsk_mutex_unlock(self->relay.mutex);
+	return count;
+}
+
+static void _trtp_manager_relay_legs_unref(trtp_manager_relay_leg_t legs[TRTP_MANAGER_RELAY_LEGS_MAX], tsk_size_t count)
+{
+	tsk_size_t i;
+	for(i = 0; i < count; ++i){
+		TSK_OBJECT_SAFE_FREE(legs[i].manager);
+	}
+}
+
+// releases all the legs (outside the lock: could be the last references)
+static void _trtp_manager_relay_remove_all(trtp_manager_t* self)
+{
+	trtp_manager_relay_leg_t legs[TRTP_MANAGER_RELAY_LEGS_MAX];
+	tsk_size_t count;
+	tsk_mutex_lock(self->relay.mutex);
+	count = self->relay.count;
+	memcpy(legs, self->relay.legs, count * sizeof(trtp_manager_relay_leg_t));
+	self->relay.count = 0;
+	tsk_mutex_unlock(self->relay.mutex);
+	_trtp_manager_relay_legs_unref(legs, count);
+}
+
+// must be called with the buffer's mutex held
+static int _trtp_manager_relay_buffer_reserve(trtp_manager_relay_buffer_t* buffer, tsk_size_t size)
+{
+	if(buffer->size < size){
+		if(!(buffer->ptr = tsk_realloc(buffer->ptr, size))){
+			TSK_DEBUG_ERROR("Failed to allocate buffer with size = %u", (unsigned)size);
+			buffer->size = 0;
+			return -1;
+		}
+		buffer->size = size;
+	}
+	return 0;
+}
+
+static TSK_INLINE void _trtp_manager_relay_set_u32(uint8_t* ptr, uint32_t value)
+{
+	ptr[0] = value >> 24;
+	ptr[1] = (value >> 16) & 0xFF;
+	ptr[2] = (value >> 8) & 0xFF;
+	ptr[3] = value & 0xFF;
+}
+
+// forwards a received (and already decrypted) RTP packet to all relay legs
+// "data_ptr" is the packet as received: the legs without SRTP rewrite its header in place (no copy at all)
+static int _trtp_manager_relay_forward_rtp(trtp_manager_t* self, const trtp_rtp_packet_t* packet, uint8_t* data_ptr, tsk_size_t data_size)
+{
+	trtp_manager_relay_leg_t legs[TRTP_MANAGER_RELAY_LEGS_MAX];
+	tsk_size_t i, j, count;
+
+	if(!packet->header || data_size < TRTP_RTP_HEADER_MIN_SIZE){
+		return -1;
+	}
+
+	count = _trtp_manager_relay_legs_ref(self, legs);
+
+	for(i = 0; i < count; ++i){
+		trtp_manager_t* peer = legs[i].manager;
+		trtp_manager_relay_leg_t* leg = &legs[i];
+		uint8_t* ptr = data_ptr;
+		int size = (int)data_size;
+		uint16_t seq_num;
+		uint32_t timestamp;
+		tsk_bool_t encrypt = tsk_false, buffer_locked = tsk_false;
+
+		tsk_safeobj_lock(peer);
+		if(!peer->is_started || !peer->transport || !peer->transport->master){
+			goto next;
+		}
+#if HAVE_SRTP
+		if(peer->srtp_state != trtp_srtp_state_none && peer->srtp_state != trtp_srtp_state_started){
+			goto next;
+		}
+		encrypt = (peer->srtp_ctx_neg_local != tsk_null);
+#endif /* HAVE_SRTP */
+
+		// (re)compute the offsets on the first packet and each time the source changes
+		if(!leg->anchored || leg->ssrc_source != packet->header->ssrc){
+			leg->seq_offset = (uint16_t)(peer->rtp.seq_num + 1 - packet->header->seq_num);
+			leg->ts_offset = (peer->rtp.timestamp - packet->header->timestamp);
+			leg->ssrc_source = packet->header->ssrc;
+			leg->anchored = tsk_true;
+		}
+		seq_num = (uint16_t)(packet->header->seq_num + leg->seq_offset);
+		timestamp = (packet->header->timestamp + leg->ts_offset);
+
+		if(encrypt){
+			// SRTP encrypts in place and appends the auth tag: the original data is shared by all legs
+			tsk_mutex_lock(self->relay.buffer_rtp.mutex);
+			buffer_locked = tsk_true;
+			if(_trtp_manager_relay_buffer_reserve(&self->relay.buffer_rtp, data_size + TRTP_SRTP_PAD_SIZE) != 0){
+				goto next;
+			}
+			ptr = self->relay.buffer_rtp.ptr;
+			memcpy(ptr, data_ptr, data_size);
+		}
+		ptr[2] = seq_num >> 8;
+		ptr[3] = seq_num & 0xFF;
+		_trtp_manager_relay_set_u32(&ptr[4], timestamp);
+		_trtp_manager_relay_set_u32(&ptr[8], peer->rtp.ssrc.local);
+
+#if HAVE_SRTP
+		if(encrypt){
+			err_status_t status;
+			if((status = srtp_protect(peer->srtp_ctx_neg_local->rtp.session, ptr, &size)) != err_status_ok){
+				TSK_DEBUG_ERROR("srtp_protect() failed with error code =%d", (int)status);
+				goto next;
+			}
+		}
+#endif /* HAVE_SRTP */
+
+		if(trtp_manager_send_rtp_raw(peer, ptr, (tsk_size_t)size) > 0){
+			// keep the numbering continuous if the peer sends its own packets later
+			if((int16_t)(seq_num - peer->rtp.seq_num) > 0){
+				peer->rtp.seq_num = seq_num;
+				peer->rtp.timestamp = timestamp;
+			}
+			if(peer->rtcp.session){
+				trtp_rtp_header_t header_out = *packet->header;
+				trtp_rtp_packet_t packet_out = *packet;
+				header_out.seq_num = seq_num;
+				header_out.timestamp = timestamp;
+				header_out.ssrc = peer->rtp.ssrc.local;
+				packet_out.header = &header_out;
+				trtp_rtcp_session_process_rtp_out(peer->rtcp.session, &packet_out, (tsk_size_t)size);
+			}
+		}
+next:
+		if(buffer_locked){
+			tsk_mutex_unlock(self->relay.buffer_rtp.mutex);
+		}
+		tsk_safeobj_unlock(peer);
+	}
+
+	// save the offsets (unless the leg was removed meanwhile)
+	tsk_mutex_lock(self->relay.mutex);
+	for(i = 0; i < count; ++i){
+		for(j = 0; j < self->relay.count; ++j){
+			if(self->relay.legs[j].manager == legs[i].manager){
+				trtp_manager_t* manager = self->relay.legs[j].manager;
+				self->relay.legs[j] = legs[i];
+				self->relay.legs[j].manager = manager;
+				break;
+			}
+		}
+	}
+	tsk_mutex_unlock(self->relay.mutex);
+
+	_trtp_manager_relay_legs_unref(legs, count);
+	return 0;
+}
+
+// send raw RTCP data "as is" using the peer's RTCP path
+static tsk_size_t _trtp_manager_relay_send_rtcp_raw(trtp_manager_t* self, const void* data, tsk_size_t size)
+{
+	if(self->is_ice_turn_active && tnet_ice_ctx_is_turn_rtcp_active(self->ice_ctx)){
+		return (tnet_ice_ctx_send_turn_rtcp(self->ice_ctx, data, size) == 0) ? size : 0; // returns #0 if ok
+	}
+	else{
+		tnet_fd_t local_fd = (self->rtcp.local_socket && !self->use_rtcpmux) ? self->rtcp.local_socket->fd : self->transport->master->fd;
+		return tnet_sockfd_sendto(local_fd, (const struct sockaddr *)&self->rtcp.remote_addr, data, size); // returns number of sent bytes
+	}
+}
+
+// forwards the feedback about the relayed stream (NACK, PLI and FIR) to the source legs
+// Reports (SR, RR, SDES...) are terminated on each leg by its own RTCP session.
+static int _trtp_manager_relay_forward_rtcp(trtp_manager_t* self, const uint8_t* data_ptr, tsk_size_t data_size)
+{
+	trtp_manager_relay_leg_t legs[TRTP_MANAGER_RELAY_LEGS_MAX];
+	tsk_size_t i, j, count;
+
+	count = _trtp_manager_relay_legs_ref(self, legs);
+
+	tsk_mutex_lock(self->relay.buffer_rtcp.mutex);
+	if(count && _trtp_manager_relay_buffer_reserve(&self->relay.buffer_rtcp, data_size + TRTP_SRTP_PAD_SIZE) == 0){
+		for(i = 0; i < count; ++i){
+			trtp_manager_t* peer = legs[i].manager;
+			const uint8_t *pkt_ptr = data_ptr, *end_ptr = (data_ptr + data_size);
+			uint8_t* out_ptr = self->relay.buffer_rtcp.ptr;
+			tsk_bool_t reverse_anchored = tsk_false;
+			uint16_t reverse_seq_offset = 0;
+			int size;
+
+			// the sequence numbers seen by our remote party were shifted by the peer when relaying to us
+			tsk_mutex_lock(peer->relay.mutex);
+			for(j = 0; j < peer->relay.count; ++j){
+				if(peer->relay.legs[j].manager == self){
+					reverse_anchored = peer->relay.legs[j].anchored;
+					reverse_seq_offset = peer->relay.legs[j].seq_offset;
+					break;
+				}
+			}
+			tsk_mutex_unlock(peer->relay.mutex);
+
+			tsk_safeobj_lock(peer);
+
+			// rfc3550 - 6.1 RTCP Packet Format: compound packet
+			while((end_ptr - pkt_ptr) >= TRTP_RTCP_HEADER_SIZE){
+				tsk_size_t pkt_size = ((tsk_size_t)tnet_ntohs_2(&pkt_ptr[2]) + 1) << 2;
+				uint8_t fmt = (pkt_ptr[0] & 0x1F);
+				tsk_size_t k;
+				if(pkt_size > (tsk_size_t)(end_ptr - pkt_ptr)){
+					break;
+				}
+				if(pkt_size >= 12 && tnet_ntohl_2(&pkt_ptr[8]) == self->rtp.ssrc.local){
+					if(pkt_ptr[1] == trtp_rtcp_packet_type_rtpfb && fmt == trtp_rtcp_rtpfb_fci_type_nack){
+						memcpy(out_ptr, pkt_ptr, pkt_size);
+						// rfc4585 - 6.2.1. Generic NACK: PID(16) + BLP(16)
+						for(k = 12; reverse_anchored && (k + 4) <= pkt_size; k += 4){
+							uint16_t pid = (uint16_t)(tnet_ntohs_2(&out_ptr[k]) - reverse_seq_offset);
+							out_ptr[k] = pid >> 8;
+							out_ptr[k + 1] = pid & 0xFF;
+						}
+					}
+					else if(pkt_ptr[1] == trtp_rtcp_packet_type_psfb && (fmt == trtp_rtcp_psfb_fci_type_pli || fmt == trtp_rtcp_psfb_fci_type_fir)){
+						memcpy(out_ptr, pkt_ptr, pkt_size);
+						// rfc5104 - 4.3.1.1. FIR: SSRC(32) + Seq nr.(8) + Reserved(24)
+						for(k = 12; fmt == trtp_rtcp_psfb_fci_type_fir && (k + 8) <= pkt_size; k += 8){
+							_trtp_manager_relay_set_u32(&out_ptr[k], peer->rtp.ssrc.remote);
+						}
+					}
+					else{
+						pkt_ptr += pkt_size;
+						continue;
+					}
+					_trtp_manager_relay_set_u32(&out_ptr[4], peer->rtp.ssrc.local);
+					_trtp_manager_relay_set_u32(&out_ptr[8], peer->rtp.ssrc.remote);
+					out_ptr += pkt_size;
+				}
+				pkt_ptr += pkt_size;
+			}
+
+			size = (int)(out_ptr - (uint8_t*)self->relay.buffer_rtcp.ptr);
+			if(!size || !peer->is_started || !peer->use_rtcp || !peer->transport || !peer->transport->master){
+				goto next;
+			}
+#if HAVE_SRTP
+			if(peer->srtp_state != trtp_srtp_state_none && peer->srtp_state != trtp_srtp_state_started){
+				goto next;
+			}
+			if(peer->srtp_ctx_neg_local){
+				err_status_t status;
+				srtp_t session = peer->srtp_ctx_neg_local->rtcp.initialized ? peer->srtp_ctx_neg_local->rtcp.session : peer->srtp_ctx_neg_local->rtp.session;
+				if((status = srtp_protect_rtcp(session, self->relay.buffer_rtcp.ptr, &size)) != err_status_ok){
+					TSK_DEBUG_ERROR("srtp_protect_rtcp() failed with error code =%d", (int)status);
+					goto next;
+				}
+			}
+#endif /* HAVE_SRTP */
+			_trtp_manager_relay_send_rtcp_raw(peer, self->relay.buffer_rtcp.ptr, (tsk_size_t)size);
+next:
+			tsk_safeobj_unlock(peer);
+		}
+	}
+	tsk_mutex_unlock(self->relay.buffer_rtcp.mutex);
+
+	_trtp_manager_relay_legs_unref(legs, count);
+	return 0;
+}
+
 int trtp_manager_set_app_bandwidth_max(trtp_manager_t* self, int32_t bw_upload_kbps, int32_t bw_download_kbps)
 {
 	if(self){
@@ -1611,6 +2019,9 @@ int trtp_manager_stop(trtp_manager_t* self)
 
 	TSK_DEBUG_INFO("trtp_manager_stop()");
 
+	// release the relay legs first (and without holding our lock): breaks the reference cycles
+	_trtp_manager_relay_remove_all(self);
+
 	tsk_safeobj_lock(self);
 
 	// We haven't started the ICE context which means we must not stop it
@@ -1701,6 +2112,14 @@ static tsk_object_t* trtp_manager_ctor(tsk_object_t * self, va_list * app)
             tsk_strupdate(&manager->rtcp.cname, md5);
         }
 
+		manager->rtp.recv.mutex = tsk_mutex_create();
+
+		/* relay */
+		manager->relay.local_delivery = tsk_true;
+		manager->relay.mutex = tsk_mutex_create();
+		manager->relay.buffer_rtp.mutex = tsk_mutex_create();
+		manager->relay.buffer_rtcp.mutex = tsk_mutex_create();
+
 		/* timer */
 		manager->timer_mgr_global = tsk_timer_mgr_global_ref();
 
@@ -1734,6 +2153,16 @@ static tsk_object_t* trtp_manager_dtor(tsk_object_t * self)
 		TSK_FREE(manager->rtp.remote_ip);
 		TSK_FREE(manager->rtp.public_ip);
 		TSK_FREE(manager->rtp.serial_buffer.ptr);
+		TSK_OBJECT_SAFE_FREE(manager->rtp.recv.packet);
+		tsk_mutex_destroy(&manager->rtp.recv.mutex);
+
+		/* relay */
+		_trtp_manager_relay_remove_all(manager);
+		TSK_FREE(manager->relay.buffer_rtp.ptr);
+		TSK_FREE(manager->relay.buffer_rtcp.ptr);
+		tsk_mutex_destroy(&manager->relay.buffer_rtp.mutex);
+		tsk_mutex_destroy(&manager->relay.buffer_rtcp.mutex);
+		tsk_mutex_destroy(&manager->relay.mutex);
 
 		/* rtcp */
 		TSK_OBJECT_SAFE_FREE(manager->rtcp.session);
@@ -21,6 +21,7 @@
 */
 #include <string.h>
 #include <stdlib.h>
+#include <assert.h>
 
 #include "tinyrtp.h"
 
@@ -22,12 +22,128 @@
 #ifndef _TEST_MANAGER_H_
 #define _TEST_MANAGER_H_
 
+static trtp_manager_t* test_manager_relay_create(tnet_port_t remote_port)
+{
+	trtp_manager_t* manager;
+	int ret;
+
+	manager = trtp_manager_create(tsk_false, "127.0.0.1", tsk_false, tmedia_srtp_type_none, tmedia_srtp_mode_none);
+	assert(manager);
+	ret = trtp_manager_prepare(manager);
+	assert(ret == 0);
+	ret = trtp_manager_set_rtp_remote(manager, "127.0.0.1", remote_port);
+	assert(ret == 0);
+	ret = trtp_manager_start(manager);
+	assert(ret == 0);
+	return manager;
+}
+
+static void test_manager_relay_send(tnet_socket_t* from, const trtp_manager_t* to, uint16_t seq_num, uint32_t timestamp, uint32_t ssrc)
+{
+	struct sockaddr_storage addr;
+	int ret;
+	uint8_t data[12 + 4] = { 0x80, 0x00, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 'r', 't', 'p', '!' };
+	data[2] = seq_num >> 8, data[3] = seq_num & 0xFF;
+	data[4] = timestamp >> 24, data[5] = (timestamp >> 16) & 0xFF, data[6] = (timestamp >> 8) & 0xFF, data[7] = timestamp & 0xFF;
+	data[8] = ssrc >> 24, data[9] = (ssrc >> 16) & 0xFF, data[10] = (ssrc >> 8) & 0xFF, data[11] = ssrc & 0xFF;
+	ret = tnet_sockaddr_init("127.0.0.1", to->transport->master->port, tnet_socket_type_udp_ipv4, &addr);
+	assert(ret == 0);
+	ret = tnet_sockfd_sendto(from->fd, (const struct sockaddr*)&addr, data, sizeof(data));
+	assert(ret == sizeof(data));
+}
+
+/* returns the relayed packet, null if none */
+static trtp_rtp_packet_t* test_manager_relay_recv(tnet_socket_t* socket)
+{
+	uint8_t data[1500];
+	struct sockaddr_storage from;
+	int size;
+	if(tnet_sockfd_waitUntilReadable(socket->fd, 500) != 0){
+		return tsk_null;
+	}
+	size = tnet_sockfd_recvfrom(socket->fd, data, sizeof(data), 0, (struct sockaddr*)&from);
+	assert(size > 0);
+	return trtp_rtp_packet_deserialize(data, (tsk_size_t)size);
+}
+
+/* source (socket) -> A -> relay -> B -> sink (socket) */
+void test_manager_relay()
+{
+	tnet_socket_t *source, *sink;
+	trtp_manager_t *a, *b;
+	trtp_rtp_packet_t* packet;
+	uint16_t seq_num;
+	uint32_t timestamp;
+	int i, ret;
+
+	source = tnet_socket_create("127.0.0.1", TNET_SOCKET_PORT_ANY, tnet_socket_type_udp_ipv4);
+	assert(source);
+	sink = tnet_socket_create("127.0.0.1", TNET_SOCKET_PORT_ANY, tnet_socket_type_udp_ipv4);
+	assert(sink);
+	a = test_manager_relay_create(source->port);
+	b = test_manager_relay_create(sink->port);
+
+	ret = trtp_manager_relay_add(a, b);
+	assert(ret == 0);
+	ret = trtp_manager_relay_add(a, b);
+	assert(ret == 0 && a->relay.count == 1); /* already added */
+	ret = trtp_manager_relay_add(a, a);
+	assert(ret != 0);
+	ret = trtp_manager_relay_set_local_delivery(a, tsk_false);
+	assert(ret == 0);
+
+	/* rewritten to B's SSRC, continuing B's numbering */
+	seq_num = b->rtp.seq_num + 1, timestamp = b->rtp.timestamp;
+	for(i = 0; i < 3; ++i){
+		test_manager_relay_send(source, a, (uint16_t)(100 + i), 8000 + (i * 160), 0x11111111);
+		packet = test_manager_relay_recv(sink);
+		assert(packet);
+		assert(packet->header->ssrc == b->rtp.ssrc.local);
+		assert(packet->header->seq_num == (uint16_t)(seq_num + i));
+		assert(packet->header->timestamp == timestamp + (i * 160));
+		assert(packet->payload.size == 4 && memcmp(packet->payload.data, "rtp!", 4) == 0);
+		TSK_OBJECT_SAFE_FREE(packet);
+	}
+
+	/* new source: re-anchored, the numbering stays continuous */
+	test_manager_relay_send(source, a, 5000, 90000, 0x22222222);
+	packet = test_manager_relay_recv(sink);
+	assert(packet);
+	assert(packet->header->ssrc == b->rtp.ssrc.local && packet->header->seq_num == (uint16_t)(seq_num + 3));
+	TSK_OBJECT_SAFE_FREE(packet);
+
+	/* removed: nothing relayed */
+	ret = trtp_manager_relay_remove(a, b);
+	assert(ret == 0 && a->relay.count == 0);
+	test_manager_relay_send(source, a, 5001, 90160, 0x22222222);
+	packet = test_manager_relay_recv(sink);
+	assert(!packet);
+
+	/* stopping releases the legs (both directions: reference cycle) */
+	ret = trtp_manager_relay_add(a, b);
+	assert(ret == 0);
+	ret = trtp_manager_relay_add(b, a);
+	assert(ret == 0);
+	ret = trtp_manager_stop(a);
+	assert(ret == 0 && a->relay.count == 0);
+	ret = trtp_manager_stop(b);
+	assert(ret == 0 && b->relay.count == 0);
+	assert(tsk_object_get_refcount(a) == 1 && tsk_object_get_refcount(b) == 1);
+
+	TSK_OBJECT_SAFE_FREE(a);
+	TSK_OBJECT_SAFE_FREE(b);
+	TSK_OBJECT_SAFE_FREE(source);
+	TSK_OBJECT_SAFE_FREE(sink);
+}
+
 void test_manager()
 {
 	tsk_size_t i;
 	trtp_manager_t* manager;
 
-	if(!(manager = trtp_manager_create(tsk_true, "192.168.0.12", tsk_false))){
+	test_manager_relay();
+
+	if(!(manager = trtp_manager_create(tsk_true, "192.168.0.12", tsk_false, tmedia_srtp_type_none, tmedia_srtp_mode_none))){
 		goto bail;
 	}
 
@@ -53,7 +169,7 @@ void test_manager()
 	
 	/* send data */
 	for(i=0;i<2; i++){
-		if(trtp_manager_send_rtp(manager, "test", tsk_strlen("test"), 160, tsk_true)){
+		if(!trtp_manager_send_rtp(manager, "test", tsk_strlen("test"), 160, tsk_true, tsk_true)){
 			goto bail;
 		}
 	}
@@ -280,7 +280,7 @@ char packet_10[] = {
 	/* deserialize the packet*/ \
 	if((packet = trtp_rtp_packet_deserialize(packet_##n, sizeof(packet_##n)))){ \
 		/* serialize the packet */ \
-		if((buffer = trtp_rtp_packet_serialize(packet))){ \
+		if((buffer = trtp_rtp_packet_serialize(packet, 0))){ \
 			/* compare data */ \
 			if(sizeof(packet_##n) != buffer->size){ \
 				TSK_DEBUG_ERROR("Test-%d: Sizes are different", n); \
@@ -308,6 +308,64 @@ char packet_10[] = {
 		TSK_DEBUG_ERROR("Failed to deserialize packet-%d", n); \
 	}
 
+/* packets parsed in place: the object is reused unless someone kept it and the payload points into the received buffer */
+void test_parser_view()
+{
+	static const struct { const char* data; tsk_size_t size; } packets[] = {
+		{ packet_0, sizeof(packet_0) }, { packet_1, sizeof(packet_1) }, { packet_2, sizeof(packet_2) }, { packet_3, sizeof(packet_3) },
+	};
+	trtp_rtp_packet_t *view = tsk_null, *first, *kept, *copy;
+	tsk_buffer_t* buffer;
+	tsk_size_t i;
+	int ret;
+
+	/* reused */
+	ret = trtp_rtp_packet_deserialize_view(&view, packets[0].data, packets[0].size);
+	assert(ret == 0);
+	first = view;
+	for(i = 0; i < sizeof(packets)/sizeof(packets[0]); ++i){
+		ret = trtp_rtp_packet_deserialize_view(&view, packets[i].data, packets[i].size);
+		assert(ret == 0);
+		assert(view == first && view->is_view && tsk_object_get_refcount(view) == 1);
+		assert(view->payload.data_const == packets[i].data + (packets[i].size - view->payload.size) && !view->payload.data);
+		buffer = trtp_rtp_packet_serialize(view, 0);
+		assert(buffer && buffer->size == packets[i].size && memcmp(buffer->data, packets[i].data, buffer->size) == 0);
+		TSK_OBJECT_SAFE_FREE(buffer);
+	}
+
+	/* kept by a callee: never overwritten */
+	kept = tsk_object_ref(view);
+	ret = trtp_rtp_packet_deserialize_view(&view, packets[0].data, packets[0].size);
+	assert(ret == 0);
+	assert(view != kept && tsk_object_get_refcount(kept) == 1);
+	assert(kept->header->seq_num == 0x2c43 && view->header->seq_num == 0x0001);
+	TSK_OBJECT_SAFE_FREE(kept);
+
+	/* header kept (e.g. "proto_hdr" stored by a codec): only the header is replaced */
+	first = view;
+	kept = tsk_object_ref(view->header);
+	ret = trtp_rtp_packet_deserialize_view(&view, packets[1].data, packets[1].size);
+	assert(ret == 0);
+	assert(view == first && (void*)view->header != (void*)kept && ((trtp_rtp_header_t*)kept)->seq_num == 0x0001 && view->header->seq_num == 0x0002);
+	TSK_OBJECT_SAFE_FREE(kept);
+
+	/* materialized: deep copy owning its payload */
+	copy = trtp_rtp_packet_materialize(view);
+	assert(copy && copy != view && !copy->is_view && copy->header != view->header);
+	assert(copy->payload.data && copy->payload.size == view->payload.size && memcmp(copy->payload.data, view->payload.data_const, copy->payload.size) == 0);
+	kept = trtp_rtp_packet_materialize(copy);
+	assert(kept == copy && tsk_object_get_refcount(copy) == 2);
+	TSK_OBJECT_SAFE_FREE(kept);
+	TSK_OBJECT_SAFE_FREE(copy);
+
+	/* invalid packet */
+	ret = trtp_rtp_packet_deserialize_view(&view, packets[0].data, TRTP_RTP_HEADER_MIN_SIZE - 1);
+	assert(ret != 0);
+
+	TSK_OBJECT_SAFE_FREE(view);
+	TSK_DEBUG_INFO("Test-view: OK");
+}
+
 void test_parser()
 {
 	trtp_rtp_packet_t* packet;
@@ -325,6 +383,8 @@ void test_parser()
 	MAKE_TEST(8);
 	MAKE_TEST(9);
 	MAKE_TEST(10);	
+
+	test_parser_view();
 }
 
 
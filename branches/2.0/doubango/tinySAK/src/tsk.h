@@ -48,12 +48,14 @@ TSK_BEGIN_DECLS
 #include "tsk_time.h"
 #include "tsk_timer.h"
 #include "tsk_condwait.h"
+#include "tsk_cpu.h"
 #include "tsk_mutex.h"
 #include "tsk_semaphore.h"
 #include "tsk_thread.h"
 #include "tsk_runnable.h"
 #include "tsk_safeobj.h"
 #include "tsk_object.h"
+#include "tsk_arena.h"
 
 #include "tsk_debug.h"
 
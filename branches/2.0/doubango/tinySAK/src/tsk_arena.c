@@ -0,0 +1,203 @@
+/*
+* Copyright (C) 2010-2015 Mamadou DIOP.
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*/
+
+/**@file tsk_arena.c
+ * @brief Bump allocator for short-lived object graphs (e.g. a parsed message).
+ *
+ */
+#include "tsk_arena.h"
+#include "tsk_memory.h"
+#include "tsk_debug.h"
+#include "tsk_common.h"
+
+#include <string.h>
+
+/**@defgroup tsk_arena_group Arena allocator.
+* An arena is made current for the calling thread with @ref tsk_arena_push(). Until @ref tsk_arena_pop() is called,
+* the objects created by this thread are carved from the arena: no call to malloc() per object and no call to free()
+* when they are destroyed. The arena is refcounted by the objects it holds which means an object outliving its message
+* (e.g. referenced by a dialog) stays valid but keeps the whole arena alive. Copy such objects out of the arena when
+* they are long-lived.
+* The memory referenced by the objects (strings, buffers...) is still allocated on the heap as these fields are updated
+* in place all over the stack (see @ref tsk_strupdate()).
+* An arena could be current for several threads at the same time: the allocations are serialized.
+*/
+
+#define TSK_ARENA_ALIGN				(sizeof(void*) << 1) /* same as malloc() */
+#define TSK_ARENA_ROUND(size)		(((size) + (TSK_ARENA_ALIGN - 1)) & ~(TSK_ARENA_ALIGN - 1))
+#define TSK_ARENA_CHUNK_HDR_SIZE	TSK_ARENA_ROUND(sizeof(tsk_arena_chunk_t))
+#define TSK_ARENA_CHUNK_DATA(chunk)	(((uint8_t*)(chunk)) + TSK_ARENA_CHUNK_HDR_SIZE)
+
+typedef struct tsk_arena_chunk_s
+{
+	struct tsk_arena_chunk_s* next;
+	tsk_size_t size;
+	tsk_size_t used;
+}
+tsk_arena_chunk_t;
+
+#if defined(TSK_ARENA_TLS)
+static TSK_ARENA_TLS tsk_arena_t* __tsk_arena_current = tsk_null;
+#endif
+
+/**@ingroup tsk_arena_group
+* Creates an arena.
+* @param chunk_size The size of the chunks to carve the objects from. Zero to use @ref TSK_ARENA_CHUNK_SIZE.
+* @retval @ref tsk_arena_t object if succeed and null otherwise.
+*/
+tsk_arena_t* tsk_arena_create(tsk_size_t chunk_size)
+{
+	return tsk_object_new(tsk_arena_def_t, chunk_size);
+}
+
+/**@ingroup tsk_arena_group
+* Allocates zeroed memory from the arena. The memory is released when the arena is destroyed.
+* @param self The arena to allocate from.
+* @param size The number of bytes to allocate.
+* @retval Pointer to the memory (aligned as malloc() does) if succeed and null otherwise.
+*/
+void* tsk_arena_alloc(tsk_arena_t* self, tsk_size_t size)
+{
+	tsk_arena_chunk_t* chunk;
+	void* ret;
+
+	if(!self || !size){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return tsk_null;
+	}
+
+	size = TSK_ARENA_ROUND(size);
+	tsk_safeobj_lock(self);
+	if(!(chunk = self->chunks) || (chunk->size - chunk->used) < size){
+		tsk_size_t chunk_size = TSK_MAX(self->chunk_size, size);
+		if(!(chunk = tsk_malloc(TSK_ARENA_CHUNK_HDR_SIZE + chunk_size))){
+			TSK_DEBUG_ERROR("Failed to allocate arena chunk with size = %u", (unsigned)chunk_size);
+			tsk_safeobj_unlock(self);
+			return tsk_null;
+		}
+		chunk->size = chunk_size;
+		chunk->used = 0;
+		if(self->chunks && size > (self->chunk_size >> 2)){
+			/* large block: keep carving the current chunk */
+			chunk->next = self->chunks->next;
+			self->chunks->next = chunk;
+		}
+		else{
+			chunk->next = self->chunks;
+			self->chunks = chunk;
+		}
+		self->reserved += chunk_size;
+	}
+
+	ret = TSK_ARENA_CHUNK_DATA(chunk) + chunk->used;
+	chunk->used += size;
+	self->used += size;
+	tsk_safeobj_unlock(self);
+
+	memset(ret, 0, size);
+	return ret;
+}
+
+/**@ingroup tsk_arena_group
+* Makes @a self the current arena for the calling thread.
+* @param self The arena the next objects will be allocated from. Null to allocate them on the heap.
+* @retval The previous current arena to pass to @ref tsk_arena_pop().
+*/
+tsk_arena_t* tsk_arena_push(tsk_arena_t* self)
+{
+#if defined(TSK_ARENA_TLS)
+	tsk_arena_t* previous = __tsk_arena_current;
+	__tsk_arena_current = self;
+	return previous;
+#else
+	return tsk_null;
+#endif
+}
+
+/**@ingroup tsk_arena_group
+* Restores the arena that was current before @ref tsk_arena_push().
+* @param previous The value returned by @ref tsk_arena_push().
+*/
+void tsk_arena_pop(tsk_arena_t* previous)
+{
+#if defined(TSK_ARENA_TLS)
+	__tsk_arena_current = previous;
+#endif
+}
+
+/**@ingroup tsk_arena_group
+* Gets the current arena for the calling thread.
+* @retval The current arena or null if the objects are allocated on the heap.
+*/
+tsk_arena_t* tsk_arena_current()
+{
+#if defined(TSK_ARENA_TLS)
+	return __tsk_arena_current;
+#else
+	return tsk_null;
+#endif
+}
+
+/**@ingroup tsk_arena_group
+* Gets the arena an object was allocated from.
+* @param object The object.
+* @retval The arena or null if the object was allocated on the heap.
+*/
+tsk_arena_t* tsk_arena_of(const tsk_object_t* object)
+{
+	return object ? TSK_OBJECT_HEADER(object)->__arena__ : tsk_null;
+}
+
+
+//=================================================================================================
+//	Arena object definition
+//
+static tsk_object_t* tsk_arena_ctor(tsk_object_t * self, va_list * app)
+{
+	tsk_arena_t *arena = self;
+	if(arena){
+		tsk_size_t chunk_size = va_arg(*app, tsk_size_t);
+		arena->chunk_size = TSK_ARENA_ROUND(chunk_size ? chunk_size : TSK_ARENA_CHUNK_SIZE);
+		tsk_safeobj_init(arena);
+	}
+	return self;
+}
+
+static tsk_object_t* tsk_arena_dtor(tsk_object_t * self)
+{
+	tsk_arena_t *arena = self;
+	if(arena){
+		tsk_arena_chunk_t* chunk;
+		while((chunk = arena->chunks)){
+			arena->chunks = chunk->next;
+			tsk_free((void**)&chunk);
+		}
+		tsk_safeobj_deinit(arena);
+	}
+	return self;
+}
+
+static const tsk_object_def_t tsk_arena_def_s =
+{
+	sizeof(tsk_arena_t),
+	tsk_arena_ctor,
+	tsk_arena_dtor,
+	tsk_null,
+};
+const tsk_object_def_t *tsk_arena_def_t = &tsk_arena_def_s;
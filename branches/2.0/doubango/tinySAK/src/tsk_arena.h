@@ -0,0 +1,75 @@
+/*
+* Copyright (C) 2010-2015 Mamadou DIOP.
+*
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*/
+
+/**@file tsk_arena.h
+ * @brief Bump allocator for short-lived object graphs (e.g. a parsed message).
+ *
+ */
+#ifndef _TINYSAK_ARENA_H_
+#define _TINYSAK_ARENA_H_
+
+#include "tinysak_config.h"
+#include "tsk_object.h"
+#include "tsk_safeobj.h"
+
+TSK_BEGIN_DECLS
+
+#if !defined(TSK_ARENA_CHUNK_SIZE)
+#	define TSK_ARENA_CHUNK_SIZE	4096 /* Default size of the memory chunks carved by an arena */
+#endif
+
+/**@def TSK_ARENA_TLS
+* Storage class of the per-thread current arena. Arenas are disabled (all the objects are allocated on the heap)
+* when the compiler has no thread-local storage.
+*/
+#if defined(_MSC_VER)
+#	define TSK_ARENA_TLS	__declspec(thread)
+#elif defined(__GNUC__)
+#	define TSK_ARENA_TLS	__thread
+#endif
+
+/**@ingroup tsk_arena_group
+* Arena: the objects created by @ref tsk_object_new while the arena is current (see @ref tsk_arena_push) are carved from
+* large chunks instead of being allocated one by one. Each of these objects holds a reference to the arena and the chunks
+* are freed in one shot when the last one is destroyed.
+*/
+typedef struct tsk_arena_s
+{
+	TSK_DECLARE_OBJECT;
+	TSK_DECLARE_SAFEOBJ; /**< The objects of a message could be created by the getters of several threads (lazy parsing). */
+
+	tsk_size_t chunk_size;
+	struct tsk_arena_chunk_s* chunks; /**< The first one is the chunk being carved. */
+	tsk_size_t used; /**< Bytes handed out. */
+	tsk_size_t reserved; /**< Bytes allocated for the chunks. */
+}
+tsk_arena_t;
+
+TINYSAK_API tsk_arena_t* tsk_arena_create(tsk_size_t chunk_size);
+TINYSAK_API void* tsk_arena_alloc(tsk_arena_t* self, tsk_size_t size);
+TINYSAK_API tsk_arena_t* tsk_arena_push(tsk_arena_t* self);
+TINYSAK_API void tsk_arena_pop(tsk_arena_t* previous);
+TINYSAK_API tsk_arena_t* tsk_arena_current();
+TINYSAK_API tsk_arena_t* tsk_arena_of(const tsk_object_t* object);
+
+TINYSAK_GEXTERN const tsk_object_def_t *tsk_arena_def_t;
+
+TSK_END_DECLS
+
+#endif /* _TINYSAK_ARENA_H_ */
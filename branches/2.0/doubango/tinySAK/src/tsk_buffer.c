@@ -47,6 +47,92 @@
 #	define vsnprintf	_vsnprintf
 #endif
 
+/* Minimum capacity used when the buffer grows */
+#define TSK_BUFFER_CAPACITY_MIN		64
+/* Maximum memory kept for the next chuncks once the data have been consumed. Larger allocations (e.g. after a burst) are trimmed */
+#define TSK_BUFFER_CAPACITY_KEEP_MAX	(64 * 1024)
+
+/* Start of the allocated memory (the head could have been consumed) */
+#define _TSK_BUFFER_BASE(self)		(((uint8_t*)(self)->data) - (self)->offset)
+
+static void _tsk_buffer_free(tsk_buffer_t* self)
+{
+	if(self->data){
+		void* base = _TSK_BUFFER_BASE(self);
+		tsk_free(&base);
+		self->data = tsk_null;
+	}
+	self->size = self->capacity = self->offset = 0;
+}
+
+/* makes sure at least "capacity" bytes could be written at "self->data"
+* the bytes consumed from the head are reclaimed first, otherwise the allocation grows geometrically (unless "exact") */
+static int _tsk_buffer_grow_2(tsk_buffer_t* self, tsk_size_t capacity, tsk_bool_t exact)
+{
+	void* base;
+	tsk_size_t newcapacity;
+
+	if(capacity <= self->capacity){
+		return 0;
+	}
+	if(self->offset){
+		base = _TSK_BUFFER_BASE(self);
+		if(self->size){
+			memmove(base, self->data, self->size);
+		}
+		self->data = base;
+		self->capacity += self->offset;
+		self->offset = 0;
+		if(capacity <= self->capacity){
+			return 0;
+		}
+	}
+
+	newcapacity = exact ? capacity : TSK_MAX(self->capacity << 1, TSK_BUFFER_CAPACITY_MIN);
+	if(newcapacity < capacity){
+		newcapacity = capacity;
+	}
+	if(!(base = tsk_realloc(self->data, newcapacity))){
+		TSK_DEBUG_ERROR("Failed to allocate %u bytes", (unsigned)newcapacity);
+		return -2;
+	}
+	self->data = base;
+	self->capacity = newcapacity;
+	return 0;
+}
+
+#define _tsk_buffer_grow(self, capacity) _tsk_buffer_grow_2((self), (capacity), tsk_false)
+
+/* releases the memory of a large allocation once most of it has been consumed (the remaining data are moved to the head)
+* the allocation is at least four times bigger than the data, so the memmove() is amortized by the bytes consumed before */
+static void _tsk_buffer_trim(tsk_buffer_t* self)
+{
+	tsk_size_t allocated = self->offset + self->capacity;
+	if(allocated > TSK_BUFFER_CAPACITY_KEEP_MAX && self->size < (allocated >> 2)){
+		void *base, *newbase;
+		tsk_size_t newcapacity;
+		if(!self->size){
+			_tsk_buffer_free(self);
+			return;
+		}
+		base = _TSK_BUFFER_BASE(self);
+		memmove(base, self->data, self->size);
+		newcapacity = TSK_MAX(self->size << 1, TSK_BUFFER_CAPACITY_MIN);
+		if((newbase = tsk_realloc(base, newcapacity))){
+			self->data = newbase;
+			self->capacity = newcapacity;
+		}
+		else{ /* keep the old block */
+			self->data = base;
+			self->capacity = allocated;
+		}
+		self->offset = 0;
+	}
+}
+
+/* keeps TSK_BUFFER_TO_STRING() null-terminated when there is room for it */
+#define _TSK_BUFFER_TERMINATE(self)	if((self)->capacity > (self)->size) ((uint8_t*)(self)->data)[(self)->size] = '\0'
+
 /**@ingroup tsk_buffer_group
 * Creates new buffer.
 * @param data A pointer to the data to copy into the newly created buffer.
@@ -91,20 +177,11 @@ int tsk_buffer_append_2(tsk_buffer_t* self, const char* format, ...)
 	 */
 	int len = 0;
 	va_list ap;
-	char *buffer;
-	tsk_size_t oldsize;
-    va_list ap2;
+	tsk_size_t available;
 
 	if(!self){
 		return -1;
 	}
-
-	oldsize = self->size;
-	buffer = (char*)TSK_BUFFER_DATA(self);
-	
-	/* initialize variable arguments (needed for 64bit platforms where vsnprintf will change the va_list) */
-	va_start(ap, format);
-	va_start(ap2, format);
 	
 	/* compute destination len for windows mobile
 	*/
@@ -112,34 +189,54 @@ int tsk_buffer_append_2(tsk_buffer_t* self, const char* format, ...)
 	{
 		int n;
 		len = (tsk_strlen(format)*2);
-		buffer = (char*)tsk_realloc(buffer, (oldsize+len));
 		for(;;){
-			if( (n = vsnprintf((char*)(buffer + oldsize), len, format, ap)) >= 0 && (n<=len) ){
+			if(_tsk_buffer_grow(self, self->size + len + 1)){
+				return -2;
+			}
+			/* initialize variable arguments (needed for 64bit platforms where vsnprintf will change the va_list) */
+			va_start(ap, format);
+			n = vsnprintf((char*)(TSK_BUFFER_TO_U8(self) + self->size), len, format, ap);
+			va_end(ap);
+			if(n >= 0 && (n<=len)){
 				len = n;
 				break;
 			}
 			else{
 				len += 10;
-				buffer = (char*)tsk_realloc(buffer, (oldsize+len));
 			}
 		}
 	}
 #else
-    len = vsnprintf(tsk_null, 0, format, ap);
-    buffer = (char*)tsk_realloc(buffer, oldsize+len+1);
-    vsnprintf((buffer + oldsize), len
+	/* First try to format directly at the end of the buffer: most of the time the spare capacity is enough and the string is formatted only once */
+	available = self->capacity > self->size ? (self->capacity - self->size) : 0;
+	va_start(ap, format);
+	len = vsnprintf(available ? (char*)(TSK_BUFFER_TO_U8(self) + self->size) : tsk_null, available, format, ap);
+	va_end(ap);
+	if(len < 0){ /* _vsnprintf() returns -1 when the output is truncated */
+		va_start(ap, format);
+		len = vsnprintf(tsk_null, 0, format, ap);
+		va_end(ap);
+		if(len < 0){
+			TSK_DEBUG_ERROR("vsnprintf failed");
+			return -3;
+		}
+	}
+	if((tsk_size_t)len >= available){
+		if(_tsk_buffer_grow(self, self->size + len + 1)){
+			return -2;
+		}
+		va_start(ap, format);
+		vsnprintf((char*)(TSK_BUFFER_TO_U8(self) + self->size), len
 #if !defined(_MSC_VER) || defined(__GNUC__)
-		+1
+			+1
 #endif
-		, format, ap2);
+			, format, ap);
+		va_end(ap);
+	}
 #endif
-	
-	/* reset variable arguments */
-	va_end(ap);
-	va_end(ap2);
 
-	self->data = buffer;
-	self->size = (oldsize+len);
+	self->size += len;
+	_TSK_BUFFER_TERMINATE(self);
 	
 	return 0;
 }
@@ -162,23 +259,18 @@ int tsk_buffer_append_2(tsk_buffer_t* self, const char* format, ...)
 int tsk_buffer_append(tsk_buffer_t* self, const void* data, tsk_size_t size)
 {
 	if(self && size){
-		tsk_size_t oldsize = self->size;
-		tsk_size_t newsize = oldsize + size;
-		
-		if(oldsize){
-			self->data = tsk_realloc(self->data, newsize);
+		if(_tsk_buffer_grow(self, self->size + size + 1)){
+			return -2;
 		}
-		else{
-			self->data = tsk_calloc(size, sizeof(uint8_t));
+		if(data){
+			memcpy((void*)(TSK_BUFFER_TO_U8(self) + self->size), data, size);
 		}
-
-		if(self->data){
-			if(data){
-				memcpy((void*)(TSK_BUFFER_TO_U8(self) + oldsize), data, size);
-			}
-			self->size = newsize;
-			return 0;
+		else{
+			memset((void*)(TSK_BUFFER_TO_U8(self) + self->size), 0, size);
 		}
+		self->size += size;
+		_TSK_BUFFER_TERMINATE(self);
+		return 0;
 	}
 	else{
 		TSK_DEBUG_ERROR("Invalid parameter");
@@ -187,9 +279,45 @@ int tsk_buffer_append(tsk_buffer_t* self, const void* data, tsk_size_t size)
 }
 
 /**@ingroup tsk_buffer_group
-* Reallocates the buffer.
+* Appends a null-terminated string (without the null byte). Cheaper than @ref tsk_buffer_append_2 with "%s" as there is no format to parse.
+* @param self The buffer to append to.
+* @param str The string to append. Null and empty strings are ignored.
+* @retval Zero if succeed and non-zero error code otherwise.
+*/
+int tsk_buffer_append_str(tsk_buffer_t* self, const char* str)
+{
+	if(!self){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	return (str && *str) ? tsk_buffer_append(self, str, (tsk_size_t)strlen(str)) : 0;
+}
+
+/**@ingroup tsk_buffer_group
+* Appends the decimal representation of an integer. Cheaper than @ref tsk_buffer_append_2 with "%lld".
+* @param self The buffer to append to.
+* @param value The integer to append.
+* @retval Zero if succeed and non-zero error code otherwise.
+*/
+int tsk_buffer_append_int(tsk_buffer_t* self, int64_t value)
+{
+	char digits[21], *p = &digits[sizeof(digits)];
+	uint64_t u = (value < 0) ? ((uint64_t)(-(value + 1)) + 1) : (uint64_t)value;
+
+	do{
+		*--p = (char)('0' + (u % 10));
+		u /= 10;
+	}while(u);
+	if(value < 0){
+		*--p = '-';
+	}
+	return tsk_buffer_append(self, p, (tsk_size_t)(&digits[sizeof(digits)] - p));
+}
+
+/**@ingroup tsk_buffer_group
+* Reallocates the buffer. The memory is only reallocated when the new size is higher than the capacity.
 * @param self The buffer to realloc.
-* @param size The new size.
+* @param size The new size. New bytes are zeroed.
 * @retval Zero if succeed and non-zero error code otherwise.
 */
 int tsk_buffer_realloc(tsk_buffer_t* self, tsk_size_t size)
@@ -200,21 +328,40 @@ int tsk_buffer_realloc(tsk_buffer_t* self, tsk_size_t size)
 			return tsk_buffer_cleanup(self);
 		}
 
-		if(self->size == 0){ // first time?
-			self->data = tsk_calloc(size, sizeof(uint8_t));
-		}
-		else if(self->size != size){ // only realloc if different sizes
-			self->data = tsk_realloc(self->data, size);
+		if(size > self->size){
+			if(_tsk_buffer_grow(self, size + 1)){
+				return -2;
+			}
+			memset(TSK_BUFFER_TO_U8(self) + self->size, 0, (size - self->size));
 		}
 
 		self->size = size;
+		_TSK_BUFFER_TERMINATE(self);
 		return 0;
 	}
 	return -1;
 }
 
+/**@ingroup tsk_buffer_group
+* Makes sure that at least @a capacity bytes could be stored in the buffer without reallocating. The size is not changed.
+* Use it before appending many fragments whose total size is known (or could be estimated).
+* @param self The buffer to reserve memory for.
+* @param capacity The minimum capacity.
+* @retval Zero if succeed and non-zero error code otherwise.
+*/
+int tsk_buffer_reserve(tsk_buffer_t* self, tsk_size_t capacity)
+{
+	if(!self){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	return _tsk_buffer_grow_2(self, capacity, tsk_true);
+}
+
 /**@ingroup tsk_buffer_group
 * Removes a chunck of data from the buffer.
+* Removing from the head (@a position equal to zero) only moves the start of the buffer and doesn't copy the remaining data.
+* The memory is kept for the next chuncks, unless the allocation is larger than 64KB and mostly consumed, in which case it's trimmed.
 * @param self The buffer from which to remove the chunck.
 * @param position The chunck start position.
 * @param size The size of the chunck.
@@ -224,12 +371,31 @@ int tsk_buffer_remove(tsk_buffer_t* self, tsk_size_t position, tsk_size_t size)
 {
 	if(self && self->data && size){
 		if((position == 0) && ((position + size) >= self->size)){ /* Very common case. */
-			return tsk_buffer_cleanup(self);
+			/* keep the memory for the next chuncks (unless too large) */
+			self->data = _TSK_BUFFER_BASE(self);
+			self->capacity += self->offset;
+			self->offset = 0;
+			self->size = 0;
+			_tsk_buffer_trim(self);
+			if(self->data){
+				_TSK_BUFFER_TERMINATE(self);
+			}
+			return 0;
+		}
+		else if(position == 0){ /* consume from the head */
+			self->data = TSK_BUFFER_TO_U8(self) + size;
+			self->offset += size;
+			self->capacity -= size;
+			self->size -= size;
+			_tsk_buffer_trim(self);
+			return 0;
 		}
 		else if((position + size) < self->size){
-			memcpy(((uint8_t*)self->data) + position, ((uint8_t*)self->data) + position + size, 
+			memmove(((uint8_t*)self->data) + position, ((uint8_t*)self->data) + position + size, 
 				self->size-(position+size));
-			return tsk_buffer_realloc(self, (self->size-size));
+			self->size -= size;
+			_TSK_BUFFER_TERMINATE(self);
+			return 0;
 		}
 	}
 	return -1;
@@ -247,7 +413,6 @@ int tsk_buffer_insert(tsk_buffer_t* self, tsk_size_t position, const void* data,
 {
 	if(self && size)
 	{
-		int ret;
 		tsk_size_t tomove;
 
 		if(position > self->size){
@@ -257,8 +422,8 @@ int tsk_buffer_insert(tsk_buffer_t* self, tsk_size_t position, const void* data,
 
 		tomove = (self->size - position);
 
-		if((ret = tsk_buffer_realloc(self, (self->size + size)))){
-			return ret;
+		if(_tsk_buffer_grow(self, self->size + size + 1)){
+			return -3;
 		}
 		memmove(((uint8_t*)self->data) + position + size, ((uint8_t*)self->data) + position,
 			tomove/*self->size - (position + size)*/);
@@ -270,6 +435,8 @@ int tsk_buffer_insert(tsk_buffer_t* self, tsk_size_t position, const void* data,
 		else{
 			memset(((uint8_t*)self->data) + position, 0, size);
 		}
+		self->size += size;
+		_TSK_BUFFER_TERMINATE(self);
 
 		return 0;
 	}
@@ -302,8 +469,7 @@ int tsk_buffer_copy(tsk_buffer_t* self, tsk_size_t start, const void* data, tsk_
 int tsk_buffer_cleanup(tsk_buffer_t* self)
 {
 	if(self && self->data){
-		tsk_free(&(self->data));
-		self->size = 0;
+		_tsk_buffer_free(self);
 	}
 	return 0;
 }
@@ -323,11 +489,9 @@ int tsk_buffer_takeownership(tsk_buffer_t* self, void** data, tsk_size_t size)
 		return -1;
 	}
 
-	if(self->data){
-		tsk_free(&(self->data));
-	}
+	_tsk_buffer_free(self);
 	self->data = *data;
-	self->size = size;
+	self->size = self->capacity = size;
 	*data = tsk_null;
 
 	return 0;
@@ -343,7 +507,6 @@ int tsk_buffer_takeownership(tsk_buffer_t* self, void** data, tsk_size_t size)
 
 
 
-
 //=================================================================================================
 //	Buffer object definition
 //
@@ -354,11 +517,13 @@ static tsk_object_t* tsk_buffer_ctor(tsk_object_t * self, va_list * app)
 	tsk_size_t size = va_arg(*app, tsk_size_t);
 	
 	if (size) {
-		buffer->data = tsk_calloc((size+1), sizeof(uint8_t));
-		if (data) {
-			memcpy(buffer->data, data, size);
+		if ((buffer->data = tsk_calloc((size+1), sizeof(uint8_t)))) {
+			if (data) {
+				memcpy(buffer->data, data, size);
+			}
+			buffer->size = size;
+			buffer->capacity = size + 1;
 		}
-		buffer->size = size;
 	}
 	return self;
 }
@@ -367,8 +532,7 @@ static tsk_object_t* tsk_buffer_dtor(tsk_object_t * self)
 { 
 	tsk_buffer_t *buffer = (tsk_buffer_t *)self;
 	if(buffer){
-		TSK_FREE(buffer->data);
-		buffer->size = 0;
+		_tsk_buffer_free(buffer);
 	}
 
 	return self;
@@ -56,6 +56,13 @@ TSK_BEGIN_DECLS
 #define TSK_BUFFER_DATA(self)				(self ? TSK_BUFFER(self)->data : tsk_null)
 #define TSK_BUFFER_SIZE(self)				(self ? TSK_BUFFER(self)->size : 0)
 
+/**@ingroup tsk_buffer_group
+* @def TSK_BUFFER_CAPACITY
+* Gets the number of bytes which could be written at the internal buffer address without reallocating.
+* @param self @ref tsk_buffer_t object.
+*/
+#define TSK_BUFFER_CAPACITY(self)			(self ? TSK_BUFFER(self)->capacity : 0)
+
 /**@ingroup tsk_buffer_group
 * @def TSK_BUFFER_TO_STRING
 * Gets a the internal buffer as a pointer to a string (const char*).
@@ -78,6 +85,8 @@ typedef struct tsk_buffer_s
 
 	void *data; /**< Interanl data. */
 	tsk_size_t size; /**< The size of the internal data. */
+	tsk_size_t capacity; /**< Number of bytes allocated starting at @a data. Grows geometrically. */
+	tsk_size_t offset; /**< Number of bytes consumed from the head of the allocation (removed using @ref tsk_buffer_remove). */
 }
 tsk_buffer_t;
 
@@ -88,7 +97,10 @@ TINYSAK_API tsk_buffer_t* tsk_buffer_create_null();
 
 TINYSAK_API int tsk_buffer_append_2(tsk_buffer_t* self, const char* format, ...);
 TINYSAK_API int tsk_buffer_append(tsk_buffer_t* self, const void* data, tsk_size_t size);
+TINYSAK_API int tsk_buffer_append_str(tsk_buffer_t* self, const char* str);
+TINYSAK_API int tsk_buffer_append_int(tsk_buffer_t* self, int64_t value);
 TINYSAK_API int tsk_buffer_realloc(tsk_buffer_t* self, tsk_size_t size);
+TINYSAK_API int tsk_buffer_reserve(tsk_buffer_t* self, tsk_size_t capacity);
 TINYSAK_API int tsk_buffer_remove(tsk_buffer_t* self, tsk_size_t position, tsk_size_t size);
 TINYSAK_API int tsk_buffer_insert(tsk_buffer_t* self, tsk_size_t position, const void*data, tsk_size_t size);
 TINYSAK_API int tsk_buffer_copy(tsk_buffer_t* self, tsk_size_t start, const void* data, tsk_size_t size);
@@ -84,12 +84,18 @@ typedef unsigned int tsk_size_t;
 #if defined(__GNUC__) || (HAVE___SYNC_FETCH_AND_ADD && HAVE___SYNC_FETCH_AND_SUB)
 #	define tsk_atomic_inc(_ptr_) __sync_fetch_and_add((_ptr_), 1)
 #	define tsk_atomic_dec(_ptr_) __sync_fetch_and_sub((_ptr_), 1)
+#	define tsk_atomic_cas(_ptr_, _old_, _new_) __sync_bool_compare_and_swap((_ptr_), (_old_), (_new_))
+#	define tsk_atomic_barrier() __sync_synchronize()
 #elif defined(_MSC_VER)
 #	define tsk_atomic_inc(_ptr_) InterlockedIncrement((_ptr_))
 #	define tsk_atomic_dec(_ptr_) InterlockedDecrement((_ptr_))
+#	define tsk_atomic_cas(_ptr_, _old_, _new_) (InterlockedCompareExchange((_ptr_), (_new_), (_old_)) == (_old_))
+#	define tsk_atomic_barrier() MemoryBarrier()
 #else
 #	define tsk_atomic_inc(_ptr_) ++(*(_ptr_))
 #	define tsk_atomic_dec(_ptr_) --(*(_ptr_))
+#	define tsk_atomic_cas(_ptr_, _old_, _new_) ((*(_ptr_) == (_old_)) ? ((*(_ptr_) = (_new_)), 1) : 0)
+#	define tsk_atomic_barrier()
 #endif
 
 // Substract with saturation
@@ -0,0 +1,138 @@
+/*
+* Copyright (C) 2010-2011 Mamadou Diop.
+*
+* Contact: Mamadou Diop <diopmamadou(at)doubango[dot]org>
+*	
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*	
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*	
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*
+*/
+
+/**@file tsk_cpu.c
+ * @brief CPU features detection.
+ *
+ * @author Mamadou Diop <diopmamadou(at)doubango[dot]org>
+ *
+
+ */
+#include "tsk_cpu.h"
+
+#if TSK_CPU_X86 && defined(_MSC_VER)
+#	include <intrin.h>
+#endif
+#if TSK_UNDER_WINDOWS
+#	include <windows.h>
+#else
+#	include <unistd.h>
+#endif
+
+/**@defgroup tsk_cpu_group CPU features detection.
+* Used by the media layers to select the best (e.g. SIMD) implementation at runtime.
+*/
+
+#define TSK_CPU_FLAGS_UNKNOWN	0xFFFFFFFF
+
+static volatile unsigned int __tsk_cpu_flags = TSK_CPU_FLAGS_UNKNOWN;
+static volatile unsigned int __tsk_cpu_flags_mask = tsk_cpu_flag_all;
+
+static unsigned int _tsk_cpu_detect()
+{
+	unsigned int flags = tsk_cpu_flag_none;
+#if TSK_CPU_X86 && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if(info[0] >= 1){
+		__cpuid(info, 1);
+		if(info[3] & (1 << 26)) flags |= tsk_cpu_flag_sse2;
+		if(info[2] & (1 << 9)) flags |= tsk_cpu_flag_ssse3;
+		if(info[2] & (1 << 19)) flags |= tsk_cpu_flag_sse41;
+		/* AVX2 requires the OS to save the YMM registers (OSXSAVE + XCR0) */
+		if((info[2] & (1 << 27)) && (_xgetbv(0) & 0x06) == 0x06){
+			__cpuidex(info, 7, 0);
+			if(info[1] & (1 << 5)) flags |= tsk_cpu_flag_avx2;
+		}
+	}
+#elif TSK_CPU_X86 && defined(__GNUC__)
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("sse2")) flags |= tsk_cpu_flag_sse2;
+	if(__builtin_cpu_supports("ssse3")) flags |= tsk_cpu_flag_ssse3;
+	if(__builtin_cpu_supports("sse4.1")) flags |= tsk_cpu_flag_sse41;
+	if(__builtin_cpu_supports("avx2")) flags |= tsk_cpu_flag_avx2;
+#endif
+#if TSK_CPU_NEON
+	/* NEON code is only built when the toolchain targets it */
+	flags |= tsk_cpu_flag_neon;
+#endif
+	return flags;
+}
+
+/**@ingroup tsk_cpu_group
+* Gets the features supported by the CPU we're running on.
+* @retval A combination of @ref tsk_cpu_flag_t values, filtered by the mask set using @ref tsk_cpu_set_flags_mask().
+*/
+unsigned int tsk_cpu_get_flags()
+{
+	if(__tsk_cpu_flags == TSK_CPU_FLAGS_UNKNOWN){
+		/* detection is idempotent: no lock needed */
+		__tsk_cpu_flags = _tsk_cpu_detect();
+	}
+	return (__tsk_cpu_flags & __tsk_cpu_flags_mask);
+}
+
+/**@ingroup tsk_cpu_group
+* Checks whether the CPU supports a feature.
+* @param flag The feature to check.
+* @retval @a tsk_true if supported and not masked, @a tsk_false otherwise.
+*/
+tsk_bool_t tsk_cpu_has(tsk_cpu_flag_t flag)
+{
+	return (tsk_cpu_get_flags() & flag) == (unsigned int)flag ? tsk_true : tsk_false;
+}
+
+/**@ingroup tsk_cpu_group
+* Disables some features (e.g. to compare SIMD and plain C code). The media objects select their implementation
+* when created (or on each call) and keep it, so the mask applies to the objects created after this call.
+* @param mask The features to keep. Use @a tsk_cpu_flag_all to re-enable all features.
+*/
+void tsk_cpu_set_flags_mask(unsigned int mask)
+{
+	__tsk_cpu_flags_mask = mask;
+}
+
+/**@ingroup tsk_cpu_group
+* Gets the number of online processors. Used to size worker pools.
+* @retval The number of processors (at least 1).
+*/
+tsk_size_t tsk_cpu_get_cores_count()
+{
+	static tsk_size_t __cores_count = 0;
+	if(__cores_count == 0){
+#if TSK_UNDER_WINDOWS
+		SYSTEM_INFO SystemInfo;
+#	if TSK_UNDER_WINDOWS_RT
+		GetNativeSystemInfo(&SystemInfo);
+#	else
+		GetSystemInfo(&SystemInfo);
+#	endif
+		__cores_count = SystemInfo.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+		long count = sysconf(_SC_NPROCESSORS_ONLN);
+		__cores_count = (count > 0) ? (tsk_size_t)count : 1;
+#else
+		__cores_count = 1;
+#endif
+	}
+	return __cores_count;
+}
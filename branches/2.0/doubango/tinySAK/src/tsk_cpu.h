@@ -0,0 +1,81 @@
+/*
+* Copyright (C) 2010-2011 Mamadou Diop.
+*
+* Contact: Mamadou Diop <diopmamadou(at)doubango[dot]org>
+*	
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*	
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*	
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*
+*/
+
+/**@file tsk_cpu.h
+ * @brief CPU features detection.
+ *
+ * @author Mamadou Diop <diopmamadou(at)doubango[dot]org>
+ *
+
+ */
+#ifndef _TINYSAK_CPU_H_
+#define _TINYSAK_CPU_H_
+
+#include "tinysak_config.h"
+
+TSK_BEGIN_DECLS
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#	define TSK_CPU_X86		1
+#else
+#	define TSK_CPU_X86		0
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#	define TSK_CPU_NEON		1
+#else
+#	define TSK_CPU_NEON		0
+#endif
+
+/**@def TSK_CPU_TARGET
+* Allows a function to use instructions beyond the compiler's baseline (e.g. "avx2"). 
+* Such a function must only be called after checking @ref tsk_cpu_has().
+*/
+#if defined(__GNUC__) && TSK_CPU_X86
+#	define TSK_CPU_TARGET(name)	__attribute__((target(name)))
+#else
+#	define TSK_CPU_TARGET(name)
+#endif
+
+/** CPU features.
+*/
+typedef enum tsk_cpu_flag_e
+{
+	tsk_cpu_flag_none = 0x00,
+	tsk_cpu_flag_sse2 = (0x01 << 0),
+	tsk_cpu_flag_ssse3 = (0x01 << 1),
+	tsk_cpu_flag_sse41 = (0x01 << 2),
+	tsk_cpu_flag_avx2 = (0x01 << 3),
+	tsk_cpu_flag_neon = (0x01 << 4),
+
+	tsk_cpu_flag_all = 0xFFFFFFFF
+}
+tsk_cpu_flag_t;
+
+TINYSAK_API unsigned int tsk_cpu_get_flags();
+TINYSAK_API tsk_bool_t tsk_cpu_has(tsk_cpu_flag_t flag);
+TINYSAK_API void tsk_cpu_set_flags_mask(unsigned int mask);
+TINYSAK_API tsk_size_t tsk_cpu_get_cores_count();
+
+TSK_END_DECLS
+
+#endif /* _TINYSAK_CPU_H_ */
@@ -22,6 +22,7 @@
  *
  */
 #include "tsk_object.h"
+#include "tsk_arena.h"
 #include "tsk_memory.h"
 #include "tsk_debug.h"
 #include "tsk_common.h"
@@ -41,6 +42,31 @@ static int tsk_objects_count = 0;
 #	define TSK_DEBUG_OBJECTS	0
 #endif
 
+/* Allocates a zeroed object from the current arena or from the heap */
+static tsk_object_t* _tsk_object_alloc(const tsk_object_def_t *objdef)
+{
+	tsk_arena_t* arena = tsk_arena_current();
+	tsk_object_t* newobj;
+	if(arena && objdef != tsk_arena_def_t){
+		if((newobj = tsk_arena_alloc(arena, objdef->size))){
+			TSK_OBJECT_HEADER(newobj)->__arena__ = tsk_object_ref(arena);
+		}
+		return newobj;
+	}
+	return tsk_calloc(1, objdef->size);
+}
+
+/* Releases the memory of an object (the destructor must have been called) */
+static void _tsk_object_free(tsk_object_t *self)
+{
+	if(TSK_OBJECT_HEADER(self)->__arena__){
+		tsk_object_unref(TSK_OBJECT_HEADER(self)->__arena__);
+	}
+	else{
+		free(self);
+	}
+}
+
 /**@ingroup tsk_object_group
 * Creates new object. The object MUST be declared using @ref TSK_DECLARE_OBJECT macro.
 * @param objdef The object meta-data (definition). For more infomation see @ref tsk_object_def_t.
@@ -51,7 +77,7 @@ static int tsk_objects_count = 0;
 tsk_object_t* tsk_object_new(const tsk_object_def_t *objdef, ...)
 {
 	// Do not check "objdef", let the application die if it's null
-	tsk_object_t *newobj = tsk_calloc(1, objdef->size);
+	tsk_object_t *newobj = _tsk_object_alloc(objdef);
 	if(newobj){
 		(*(const tsk_object_def_t **) newobj) = objdef;
 		TSK_OBJECT_HEADER(newobj)->refCount = 1;
@@ -66,7 +92,7 @@ tsk_object_t* tsk_object_new(const tsk_object_def_t *objdef, ...)
 				if(objdef->destructor){
 					objdef->destructor(newobj_);
 				}
-				tsk_free(&newobj_);
+				_tsk_object_free(newobj_);
 			}
 
 #if TSK_DEBUG_OBJECTS
@@ -93,7 +119,7 @@ tsk_object_t* tsk_object_new(const tsk_object_def_t *objdef, ...)
 */
 tsk_object_t* tsk_object_new_2(const tsk_object_def_t *objdef, va_list* ap)
 {
-	tsk_object_t *newobj = tsk_calloc(1, objdef->size);
+	tsk_object_t *newobj = _tsk_object_alloc(objdef);
 	if (newobj) {
 		(*(const tsk_object_def_t **) newobj) = objdef;
 		TSK_OBJECT_HEADER(newobj)->refCount = 1;
@@ -230,7 +256,7 @@ void tsk_object_delete(tsk_object_t *self)
 			TSK_DEBUG_WARN("No destructor found.");
 		}
 		if (self) {
-			free(self);
+			_tsk_object_free(self);
 		}
 	}
 }
@@ -288,7 +314,7 @@ tsk_object_def_t;
 * @endcode
 *
 * <p>
-* An object is created in two phases. The first phase consists of dynamically allocating the object on the heap; this is why its size is mandatory in the object definition structure. When a new object is allocated on the heap, all its members (char*, void*, int, long …) will be zeroed. In the second phase, the newly created object will be initialized by calling the supplied constructor. To perform these two phases, you should call @ref tsk_object_new() or @ref tsk_object_new_2().
+* An object is created in two phases. The first phase consists of dynamically allocating the object on the heap; this is why its size is mandatory in the object definition structure. The memory is carved from the thread's current arena instead when there is one (see @ref tsk_arena_push()). When a new object is allocated on the heap, all its members (char*, void*, int, long …) will be zeroed. In the second phase, the newly created object will be initialized by calling the supplied constructor. To perform these two phases, you should call @ref tsk_object_new() or @ref tsk_object_new_2().
 * </p>
 * <p>
 * An object is destroyed in two phases. The first phase consists of freeing its members (void*, char* …). It’s the destructor which is responsible of this task. In the second phase, the object itself is freed. As the object cannot free itself, you should use @ref tsk_object_unref() or @ref tsk_object_delete() to perform these two phases. The difference between these two functions is explained in the coming sections.
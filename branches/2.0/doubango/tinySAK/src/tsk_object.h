@@ -78,7 +78,8 @@ typedef void tsk_object_t;
 */
 #define TSK_DECLARE_OBJECT \
 	const void* __def__;  /**< Opaque data holding a pointer to the actual meta-data(size, constructor, destructor and comparator) */ \
-	volatile long	refCount /**< Reference counter. */
+	volatile long	refCount; /**< Reference counter. */ \
+	struct tsk_arena_s* __arena__ /**< Arena the object was carved from (see @ref tsk_arena_push). Null if allocated on the heap. */
 
 /**@ingroup tsk_object_group
 * Internal macro to get the definition of the object.
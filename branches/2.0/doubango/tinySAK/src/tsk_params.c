@@ -264,15 +264,14 @@ int tsk_params_tostring(const tsk_params_L_t *self, const char separator, tsk_bu
 		tsk_list_foreach(item, self){
 			tsk_param_t* param = (tsk_param_t*)item->data;
 			//tsk_params_param_tostring(param, output);
-			if(TSK_LIST_IS_FIRST(self, item)){
-				if((ret = tsk_buffer_append_2(output, param->value?"%s=%s":"%s", param->name, param->value))){
-					goto bail;
-				}
+			if(!TSK_LIST_IS_FIRST(self, item) && (ret = tsk_buffer_append(output, &separator, 1))){
+				goto bail;
 			}
-			else{
-				if((ret = tsk_buffer_append_2(output, param->value?"%c%s=%s":"%c%s", separator, param->name, param->value))){
-					goto bail;
-				}
+			if((ret = tsk_buffer_append_str(output, param->name))){
+				goto bail;
+			}
+			if(param->value && ((ret = tsk_buffer_append(output, "=", 1)) || (ret = tsk_buffer_append_str(output, param->value)))){
+				goto bail;
 			}
 		}
 	}
@@ -261,6 +261,40 @@ int tsk_strLastIndexOf(const char * str, tsk_size_t size, const char * substring
 	return -1;
 }
 
+/**@ingroup tsk_string_group
+* Computes the (32-bit FNV-1a) hash of a string. Suitable for hash tables, not for security.
+* @param str The string to hash. Could be null.
+* @retval The hash value.
+*/
+tsk_size_t tsk_strhash(const char * str)
+{
+	uint32_t hash = 2166136261U;
+	if(str){
+		while(*str){
+			hash ^= (uint8_t)*str++;
+			hash *= 16777619U;
+		}
+	}
+	return (tsk_size_t)hash;
+}
+
+/**@ingroup tsk_string_group
+* Same as @ref tsk_strhash() but case-insensitive: strings equal per @ref tsk_striequals() have the same hash.
+* @param str The string to hash. Could be null.
+* @retval The hash value.
+*/
+tsk_size_t tsk_strihash(const char * str)
+{
+	uint32_t hash = 2166136261U;
+	if(str){
+		while(*str){
+			hash ^= (uint8_t)tolower((uint8_t)*str++);
+			hash *= 16777619U;
+		}
+	}
+	return (tsk_size_t)hash;
+}
+
 /**@ingroup tsk_string_group
 * Appends a copy of the source string to the destination string. The terminating null character in destination is overwritten by the first character of source,
 * and a new null-character is appended at the end of the new string formed by the concatenation of both in destination. If the destination is NULL then new
@@ -26,6 +26,9 @@
 * @author Mamadou Diop <diopmamadou(at)doubango[dot]org>
 *
 * @date Created: Sat Nov 8 16:54:58 2009 mdiop
+*
+* Pending timers are stored in a 4-ary min-heap (schedule: O(log n)) and indexed by id in a hash table
+* which means a timer is found in O(1) and removed in O(log n) when canceled.
 */
 #include "tsk_timer.h"
 #include "tsk_debug.h"
@@ -35,6 +38,10 @@
 #include "tsk_condwait.h"
 #include "tsk_semaphore.h"
 #include "tsk_time.h"
+#include "tsk_memory.h"
+
+#include <string.h>
+#include <limits.h>
 
 #if TSK_UNDER_WINDOWS
 #	include <windows.h>
@@ -46,7 +53,16 @@
 
 #define TSK_TIMER_CREATE(timeout, callback, arg)	tsk_object_new(tsk_timer_def_t, timeout, callback, arg)
 #define TSK_TIMER_TIMEOUT(self)						((tsk_timer_t*)self)->timeout
-#define TSK_TIMER_GET_FIRST()						(manager->timers && manager->timers->head) ? (tsk_timer_t*)(((tsk_list_item_t*)(manager->timers->head))->data) : 0
+#define TSK_TIMER_GET_FIRST()						(manager->heap_count ? manager->heap[0] : tsk_null)
+
+#define TSK_TIMER_HEAP_ARITY						4 /* 4-ary heap: shallower than a binary heap and children share cache lines */
+#define TSK_TIMER_HEAP_MIN_SIZE						64
+#define TSK_TIMER_BUCKETS_MIN_COUNT					256 /* must be a power of 2 */
+/* The ids of a shard are all congruent modulo the shards count: they are divided by 'ids_stride' (the shards count) before being masked */
+#define TSK_TIMER_BUCKET_INDEX(manager, id, count)	((((unsigned long)(id)) / (manager)->ids_stride) & ((count) - 1))
+#define TSK_TIMER_BUCKET(manager, id)				(manager)->buckets[TSK_TIMER_BUCKET_INDEX(manager, id, (manager)->buckets_count)]
+/* Sharded ids are "(seq + 1) * shards_count + shard": "seq" wraps before the id overflows which means the id is always positive and never equal to TSK_INVALID_TIMER_ID */
+#define TSK_TIMER_SHARDS_SEQ_MAX(shards_count)		((long)((LONG_MAX / (long)(shards_count)) - 1))
 
 /**
  * @struct	tsk_timer_s
@@ -61,6 +77,9 @@ typedef struct tsk_timer_s
 	uint64_t timeout; /**< When the timer will timeout(as EPOCH time). */
 	tsk_timer_callback_f callback; /**< The callback function to call after @ref timeout milliseconds. */
 
+	tsk_size_t heap_index; /**< Position in the manager's heap. */
+	struct tsk_timer_s* bucket_next; /**< Next timer in the same bucket of the manager's id index. */
+
 	unsigned canceled:1;
 }
 tsk_timer_t;
@@ -80,15 +99,34 @@ typedef struct tsk_timer_manager_s
 	tsk_mutex_handle_t *mutex;
 	tsk_semaphore_handle_t *sem;
 
-	tsk_timers_L_t *timers;
+	/* Pending timers, ordered by timeout (min-heap). The heap holds a reference to each timer. */
+	tsk_timer_t** heap;
+	tsk_size_t heap_count;
+	tsk_size_t heap_size;
+	/* Pending timers indexed by id (chained hash table) for O(1) lookup on cancel. */
+	tsk_timer_t** buckets;
+	tsk_size_t buckets_count;
+	tsk_size_t ids_stride;
+
+	/* Sharded manager (e.g. the global one): the timers are spread across 'shards_count' managers each with its own threads.
+	* The shard is selected using the callback argument and encoded in the timer id (id % shards_count). */
+	struct tsk_timer_manager_s** shards;
+	tsk_size_t shards_count;
+	long shards_seq;
+
+	/* Callbacks lateness histogram (see @ref tsk_timer_manager_get_lateness). Updated by the callbacks thread and read with the mutex held. */
+	uint64_t lateness[TSK_TIMER_LATENESS_BUCKETS];
 }
 tsk_timer_manager_t;
 typedef tsk_list_t tsk_timer_manager_L_t; /**< List of @ref tsk_timer_manager_t elements. */
 
 /*== Definitions */
 static void* TSK_STDCALL __tsk_timer_manager_mainthread(void *param); 
-static int __tsk_pred_find_timer_by_id(const tsk_list_item_t *item, const void *id);
-static void __tsk_timer_manager_raise(tsk_timer_t *timer);
+static int __tsk_timer_manager_add(tsk_timer_manager_t *manager, tsk_timer_t *timer);
+static tsk_timer_t* __tsk_timer_manager_remove(tsk_timer_manager_t *manager, tsk_timer_id_t id);
+static void __tsk_timer_manager_clear(tsk_timer_manager_t *manager);
+static tsk_timer_id_t __tsk_timer_manager_schedule(tsk_timer_manager_t *manager, uint64_t timeout, tsk_timer_callback_f callback, const void *arg, tsk_timer_id_t id);
+static int __tsk_timer_manager_cancel_bulk(tsk_timer_manager_t *manager, const tsk_timer_id_t* ids, tsk_size_t count, tsk_size_t modulo, tsk_size_t residue);
 static void* TSK_STDCALL run(void* self);
 
 /**@ingroup tsk_timer_group
@@ -98,6 +136,83 @@ tsk_timer_manager_handle_t* tsk_timer_manager_create()
 	return tsk_object_new(tsk_timer_manager_def_t);
 }
 
+/**@ingroup tsk_timer_group
+* Creates a timer manager spreading its timers across several shards. Each shard has its own threads which means
+* a slow callback only delays the timers on the same shard. Timers scheduled with the same callback argument always
+* use the same shard and thus are raised in order.
+* @param shards_count The number of shards (1 for a regular manager).
+* @retval A new timer manager.
+*/
+tsk_timer_manager_handle_t* tsk_timer_manager_create_sharded(tsk_size_t shards_count)
+{
+	tsk_timer_manager_t *manager;
+	tsk_size_t i;
+
+	if(!(manager = (tsk_timer_manager_t*)tsk_timer_manager_create()) || shards_count <= 1){
+		return manager;
+	}
+	if(!(manager->shards = (tsk_timer_manager_t**)tsk_calloc(shards_count, sizeof(tsk_timer_manager_t*)))){
+		TSK_DEBUG_ERROR("Failed to allocate shards");
+		TSK_OBJECT_SAFE_FREE(manager);
+		return tsk_null;
+	}
+	for(i = 0; i < shards_count; ++i){
+		if(!(manager->shards[i] = (tsk_timer_manager_t*)tsk_timer_manager_create())){
+			TSK_OBJECT_SAFE_FREE(manager);
+			return tsk_null;
+		}
+		manager->shards[i]->ids_stride = shards_count;
+		++manager->shards_count;
+	}
+	return manager;
+}
+
+/**@ingroup tsk_timer_group
+* Gets the number of shards.
+*/
+tsk_size_t tsk_timer_manager_get_shards_count(const tsk_timer_manager_handle_t *self)
+{
+	const tsk_timer_manager_t *manager = (const tsk_timer_manager_t*)self;
+	return manager ? TSK_MAX(manager->shards_count, 1) : 0;
+}
+
+/**@ingroup tsk_timer_group
+* Gets how late the callbacks were raised compared to their expected timeout.
+* Bucket 0 counts the callbacks raised less than 1 millisecond late and bucket i (i > 0) the callbacks raised [2^(i-1), 2^i) milliseconds late.
+* The last bucket also counts all later callbacks.
+* @param self The timer manager.
+* @param shard The shard index or @ref TSK_TIMER_SHARD_ALL to sum all shards.
+* @param histogram The histogram.
+* @retval Zero if succeed and non-zero error code otherwise.
+*/
+int tsk_timer_manager_get_lateness(const tsk_timer_manager_handle_t *self, tsk_size_t shard, uint64_t histogram[TSK_TIMER_LATENESS_BUCKETS])
+{
+	const tsk_timer_manager_t *manager = (const tsk_timer_manager_t*)self;
+	tsk_size_t i, j;
+
+	if(!manager || !histogram || (shard != TSK_TIMER_SHARD_ALL && shard >= TSK_MAX(manager->shards_count, 1))){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	if(!manager->shards_count){
+		tsk_mutex_lock(manager->mutex);
+		memcpy(histogram, manager->lateness, sizeof(manager->lateness));
+		tsk_mutex_unlock(manager->mutex);
+		return 0;
+	}
+	memset(histogram, 0, sizeof(manager->lateness));
+	for(i = 0; i < manager->shards_count; ++i){
+		if(shard == TSK_TIMER_SHARD_ALL || shard == i){
+			tsk_mutex_lock(manager->shards[i]->mutex);
+			for(j = 0; j < TSK_TIMER_LATENESS_BUCKETS; ++j){
+				histogram[j] += manager->shards[i]->lateness[j];
+			}
+			tsk_mutex_unlock(manager->shards[i]->mutex);
+		}
+	}
+	return 0;
+}
+
 /**@ingroup tsk_timer_group
 * Starts the timer manager.
 */
@@ -114,7 +229,15 @@ int tsk_timer_manager_start(tsk_timer_manager_handle_t *self)
 
 	tsk_mutex_lock(manager->mutex);
 
-	if(!TSK_RUNNABLE(manager)->running && !TSK_RUNNABLE(manager)->started){				
+	if(manager->shards_count){
+		tsk_size_t i;
+		for(i = 0, err = 0; i < manager->shards_count && err == 0; ++i){
+			err = tsk_timer_manager_start(manager->shards[i]);
+		}
+		// no thread for the manager itself: only used to route the requests to the shards
+		TSK_RUNNABLE(manager)->running = TSK_RUNNABLE(manager)->started = (err == 0);
+	}
+	else if(!TSK_RUNNABLE(manager)->running && !TSK_RUNNABLE(manager)->started){				
 		TSK_RUNNABLE(manager)->run = run;
 		if((err = tsk_runnable_start(TSK_RUNNABLE(manager), tsk_timer_def_t))){
 			//TSK_OBJECT_SAFE_FREE(manager);
@@ -139,13 +262,16 @@ void tsk_timer_manager_debug(tsk_timer_manager_handle_t *self)
 {
 	tsk_timer_manager_t *manager = (tsk_timer_manager_t*)self;
 	if(manager){
-		//int index = 0;
-		tsk_list_item_t *item = tsk_null;
+		tsk_size_t i;
+
+		for(i = 0; i < manager->shards_count; ++i){
+			tsk_timer_manager_debug(manager->shards[i]);
+		}
 
 		tsk_mutex_lock(manager->mutex);
 		
-		tsk_list_foreach(item, manager->timers){
-			tsk_timer_t* timer = (tsk_timer_t*)item->data;
+		for(i = 0; i < manager->heap_count; ++i){
+			tsk_timer_t* timer = manager->heap[i];
 			TSK_DEBUG_INFO("timer [%llu]- %llu, %llu", timer->id, timer->timeout, tsk_time_now());
 		}
 
@@ -169,6 +295,15 @@ int tsk_timer_manager_stop(tsk_timer_manager_handle_t *self)
 	// all functions called below are thread-safe ==> do not lock
 	// "mainthread" uses manager->mutex and runs in a separate thread ==> deadlock
 
+	if(manager->shards_count){
+		tsk_size_t i;
+		for(i = 0, ret = 0; i < manager->shards_count; ++i){
+			ret |= tsk_timer_manager_stop(manager->shards[i]);
+		}
+		TSK_RUNNABLE(manager)->running = TSK_RUNNABLE(manager)->started = tsk_false;
+		return ret;
+	}
+
 	if(TSK_RUNNABLE(manager)->running){
 		if((ret = tsk_runnable_stop(TSK_RUNNABLE(manager)))){
 			goto bail;
@@ -186,7 +321,9 @@ int tsk_timer_manager_stop(tsk_timer_manager_handle_t *self)
 	}
 
 bail:
-	tsk_list_clear_items(manager->timers);
+	tsk_mutex_lock(manager->mutex);
+	__tsk_timer_manager_clear(manager);
+	tsk_mutex_unlock(manager->mutex);
 	return ret;
 }
 
@@ -194,22 +331,50 @@ bail:
 */
 tsk_timer_id_t tsk_timer_manager_schedule(tsk_timer_manager_handle_t *self, uint64_t timeout, tsk_timer_callback_f callback, const void *arg)
 {
-	tsk_timer_id_t timer_id = TSK_INVALID_TIMER_ID;
 	tsk_timer_manager_t *manager = (tsk_timer_manager_t*)self;
 
+	if(manager && manager->shards_count && TSK_RUNNABLE(manager)->running){
+		tsk_size_t shard;
+		long seq, next;
+		do{
+			seq = manager->shards_seq;
+			next = (seq + 1 < TSK_TIMER_SHARDS_SEQ_MAX(manager->shards_count)) ? (seq + 1) : 0;
+		} while(!tsk_atomic_cas(&manager->shards_seq, seq, next));
+		// same argument => same shard (callbacks for an object are raised in order). Round-robin if there is no argument.
+		shard = arg ? (tsk_size_t)((((uint32_t)(((uintptr_t)arg) >> 3) * 2654435761U) >> 16) % manager->shards_count) : (tsk_size_t)(((unsigned long)seq) % manager->shards_count);
+		return __tsk_timer_manager_schedule(manager->shards[shard], timeout, callback, arg, (tsk_timer_id_t)(((seq + 1) * (long)manager->shards_count) + (long)shard));
+	}
+	return __tsk_timer_manager_schedule(manager, timeout, callback, arg, TSK_INVALID_TIMER_ID);
+}
+
+static tsk_timer_id_t __tsk_timer_manager_schedule(tsk_timer_manager_t *manager, uint64_t timeout, tsk_timer_callback_f callback, const void *arg, tsk_timer_id_t id)
+{
+	tsk_timer_id_t timer_id = TSK_INVALID_TIMER_ID;
+
 	if(manager && (TSK_RUNNABLE(manager)->running || TSK_RUNNABLE(manager)->started)){
 		tsk_timer_t *timer;
 
-		timer = (tsk_timer_t*)TSK_TIMER_CREATE(timeout, callback, arg);
+		if(!(timer = (tsk_timer_t*)TSK_TIMER_CREATE(timeout, callback, arg))){
+			TSK_DEBUG_ERROR("Failed to create timer");
+			return TSK_INVALID_TIMER_ID;
+		}
+		if(TSK_TIMER_ID_IS_VALID(id)){
+			timer->id = id;
+		}
 		timer_id = timer->id;
 		tsk_mutex_lock(manager->mutex);
-		tsk_list_push_ascending_data(manager->timers, ((void**) &timer));
+		if(__tsk_timer_manager_add(manager, timer) != 0){
+			timer_id = TSK_INVALID_TIMER_ID;
+		}
 		tsk_mutex_unlock(manager->mutex);
+		TSK_OBJECT_SAFE_FREE(timer); // owned by the heap
 		
 		// tsk_timer_manager_debug(self);
 
-		tsk_condwait_signal(manager->condwait);
-		tsk_semaphore_increment(manager->sem);
+		if(TSK_TIMER_ID_IS_VALID(timer_id)){
+			tsk_condwait_signal(manager->condwait);
+			tsk_semaphore_increment(manager->sem);
+		}
 	}
 
 	return timer_id;
@@ -227,20 +392,24 @@ int tsk_timer_manager_cancel(tsk_timer_manager_handle_t *self, tsk_timer_id_t id
 		return 0;
 	}
 
-	if(!TSK_LIST_IS_EMPTY(manager->timers) && TSK_RUNNABLE(manager)->running){
-		const tsk_list_item_t *item;
+	if(manager && manager->shards_count){
+		return tsk_timer_manager_cancel(manager->shards[((unsigned long)id) % manager->shards_count], id);
+	}
+
+	// "running" is set by the manager's thread: a timer scheduled right after start() must be cancelable too
+	if(manager && manager->heap_count && (TSK_RUNNABLE(manager)->running || TSK_RUNNABLE(manager)->started)){
+		tsk_timer_t *timer;
+		tsk_bool_t was_first;
 		tsk_mutex_lock(manager->mutex);
-		item = tsk_list_find_item_by_pred(manager->timers, __tsk_pred_find_timer_by_id, &id);
-		if(item && item->data){
-			tsk_timer_t *timer = (tsk_timer_t*)item->data;
+		was_first = (manager->heap_count && manager->heap[0]->id == id);
+		if((timer = __tsk_timer_manager_remove(manager, id))){
 			timer->canceled = 1;
 			timer->callback = tsk_null;
-			
-			if(item == manager->timers->head){
-				/* The timer we are waiting on ? ==> remove it now. */
+			if(was_first){
+				/* The timer we are waiting on ? ==> wakeup the main thread. */
 				tsk_condwait_signal(manager->condwait);
 			}
-			
+			TSK_OBJECT_SAFE_FREE(timer);
 			ret = 0;
 		}
 		tsk_mutex_unlock(manager->mutex);
@@ -248,6 +417,62 @@ int tsk_timer_manager_cancel(tsk_timer_manager_handle_t *self, tsk_timer_id_t id
 	return ret;
 }
 
+/**@ingroup tsk_timer_group
+* Cancels several timers at once (e.g. all timers owned by a SIP transaction) using a single lock.
+* @param self The timer manager.
+* @param ids The identifiers of the timers to cancel. Invalid identifiers are ignored.
+* @param count The number of identifiers.
+* @retval The number of timers canceled or negative error code.
+*/
+int tsk_timer_manager_cancel_bulk(tsk_timer_manager_handle_t *self, const tsk_timer_id_t* ids, tsk_size_t count)
+{
+	tsk_timer_manager_t *manager = (tsk_timer_manager_t*)self;
+
+	if(!manager || (!ids && count)){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+
+	if(manager->shards_count){
+		int canceled = 0;
+		tsk_size_t i;
+		for(i = 0; i < manager->shards_count; ++i){
+			canceled += __tsk_timer_manager_cancel_bulk(manager->shards[i], ids, count, manager->shards_count, i);
+		}
+		return canceled;
+	}
+	return __tsk_timer_manager_cancel_bulk(manager, ids, count, 1, 0);
+}
+
+/* Cancels the timers with an id matching "id % modulo == residue" (ids belonging to the shard) */
+static int __tsk_timer_manager_cancel_bulk(tsk_timer_manager_t *manager, const tsk_timer_id_t* ids, tsk_size_t count, tsk_size_t modulo, tsk_size_t residue)
+{
+	int canceled = 0;
+
+	if(manager->heap_count && (TSK_RUNNABLE(manager)->running || TSK_RUNNABLE(manager)->started)){
+		tsk_timer_t *timer;
+		tsk_timer_id_t first_id;
+		tsk_size_t i;
+		tsk_bool_t signal = tsk_false;
+		tsk_mutex_lock(manager->mutex);
+		first_id = manager->heap_count ? manager->heap[0]->id : TSK_INVALID_TIMER_ID;
+		for(i = 0; i < count; ++i){
+			if(TSK_TIMER_ID_IS_VALID(ids[i]) && (((unsigned long)ids[i]) % modulo) == residue && (timer = __tsk_timer_manager_remove(manager, ids[i]))){
+				timer->canceled = 1;
+				timer->callback = tsk_null;
+				signal |= (timer->id == first_id);
+				TSK_OBJECT_SAFE_FREE(timer);
+				++canceled;
+			}
+		}
+		if(signal){
+			tsk_condwait_signal(manager->condwait);
+		}
+		tsk_mutex_unlock(manager->mutex);
+	}
+	return canceled;
+}
+
 int tsk_timer_manager_destroy(tsk_timer_manager_handle_t **self)
 {
 	if(!self || !*self){
@@ -279,6 +504,13 @@ static void* TSK_STDCALL run(void* self)
 	if((curr = TSK_RUNNABLE_POP_FIRST_SAFE(TSK_RUNNABLE(manager)))){
 		tsk_timer_t *timer = (tsk_timer_t *)curr->data;
 		if(timer->callback){
+			uint64_t late = tsk_time_now();
+			tsk_size_t bucket = 0;
+			for(late = (late > timer->timeout) ? (late - timer->timeout) : 0; late && bucket < (TSK_TIMER_LATENESS_BUCKETS - 1); late >>= 1, ++bucket);
+			tsk_mutex_lock(manager->mutex);
+			++manager->lateness[bucket];
+			tsk_mutex_unlock(manager->mutex);
+
 			timer->callback(timer->arg, timer->id);
 		}
 		tsk_object_unref(curr);
@@ -291,14 +523,142 @@ static void* TSK_STDCALL run(void* self)
 	return tsk_null;
 }
 
-static int __tsk_pred_find_timer_by_id(const tsk_list_item_t *item, const void *id)
+/* Whether 't1' expires before 't2'. Timers with the same timeout expire in scheduling order. */
+#define TSK_TIMER_BEFORE(t1, t2) ((t1)->timeout < (t2)->timeout || ((t1)->timeout == (t2)->timeout && (t1)->id < (t2)->id))
+
+static void __tsk_timer_heap_set(tsk_timer_manager_t *manager, tsk_size_t index, tsk_timer_t *timer)
 {
-	tsk_timer_t *timer;
-	if(item && item->data){
-		timer = (tsk_timer_t*)item->data;
-		return (int)(timer->id - *((tsk_timer_id_t*)id));
+	manager->heap[index] = timer;
+	timer->heap_index = index;
+}
+
+static void __tsk_timer_heap_up(tsk_timer_manager_t *manager, tsk_size_t index)
+{
+	tsk_timer_t *timer = manager->heap[index];
+	tsk_size_t parent;
+	while(index > 0){
+		parent = (index - 1) / TSK_TIMER_HEAP_ARITY;
+		if(!TSK_TIMER_BEFORE(timer, manager->heap[parent])){
+			break;
+		}
+		__tsk_timer_heap_set(manager, index, manager->heap[parent]);
+		index = parent;
+	}
+	__tsk_timer_heap_set(manager, index, timer);
+}
+
+static void __tsk_timer_heap_down(tsk_timer_manager_t *manager, tsk_size_t index)
+{
+	tsk_timer_t *timer = manager->heap[index];
+	tsk_size_t child, first, last, best;
+	for(;;){
+		first = (index * TSK_TIMER_HEAP_ARITY) + 1;
+		if(first >= manager->heap_count){
+			break;
+		}
+		last = TSK_MIN(first + TSK_TIMER_HEAP_ARITY, manager->heap_count);
+		for(best = first, child = first + 1; child < last; ++child){
+			if(TSK_TIMER_BEFORE(manager->heap[child], manager->heap[best])){
+				best = child;
+			}
+		}
+		if(!TSK_TIMER_BEFORE(manager->heap[best], timer)){
+			break;
+		}
+		__tsk_timer_heap_set(manager, index, manager->heap[best]);
+		index = best;
+	}
+	__tsk_timer_heap_set(manager, index, timer);
+}
+
+static int __tsk_timer_buckets_resize(tsk_timer_manager_t *manager, tsk_size_t count)
+{
+	tsk_timer_t **buckets, *timer, *next;
+	tsk_size_t i, old_count = manager->buckets_count;
+
+	if(!(buckets = (tsk_timer_t**)tsk_calloc(count, sizeof(tsk_timer_t*)))){
+		TSK_DEBUG_ERROR("Failed to allocate %u buckets", (unsigned)count);
+		return -1;
+	}
+	for(i = 0; i < old_count; ++i){
+		for(timer = manager->buckets[i]; timer; timer = next){
+			next = timer->bucket_next;
+			timer->bucket_next = buckets[TSK_TIMER_BUCKET_INDEX(manager, timer->id, count)];
+			buckets[TSK_TIMER_BUCKET_INDEX(manager, timer->id, count)] = timer;
+		}
+	}
+	TSK_FREE(manager->buckets);
+	manager->buckets = buckets;
+	manager->buckets_count = count;
+	return 0;
+}
+
+/* Adds a timer to the heap and the id index. Takes a reference. Must be called with the mutex held. */
+static int __tsk_timer_manager_add(tsk_timer_manager_t *manager, tsk_timer_t *timer)
+{
+	if(manager->heap_count == manager->heap_size){
+		tsk_size_t size = TSK_MAX(TSK_TIMER_HEAP_MIN_SIZE, (manager->heap_size << 1));
+		tsk_timer_t** heap;
+		if(!(heap = (tsk_timer_t**)tsk_realloc(manager->heap, size * sizeof(tsk_timer_t*)))){
+			TSK_DEBUG_ERROR("Failed to grow timers heap to %u", (unsigned)size);
+			return -1;
+		}
+		manager->heap = heap;
+		manager->heap_size = size;
+	}
+	if(manager->heap_count >= manager->buckets_count){
+		if(__tsk_timer_buckets_resize(manager, TSK_MAX(TSK_TIMER_BUCKETS_MIN_COUNT, (manager->buckets_count << 1))) != 0){
+			return -1;
+		}
+	}
+
+	timer = (tsk_timer_t*)tsk_object_ref(timer);
+	timer->bucket_next = TSK_TIMER_BUCKET(manager, timer->id);
+	TSK_TIMER_BUCKET(manager, timer->id) = timer;
+	__tsk_timer_heap_set(manager, manager->heap_count++, timer);
+	__tsk_timer_heap_up(manager, timer->heap_index);
+	return 0;
+}
+
+/* Removes a timer from the heap and the id index. Returns the reference held by the heap. Must be called with the mutex held. */
+static tsk_timer_t* __tsk_timer_manager_remove(tsk_timer_manager_t *manager, tsk_timer_id_t id)
+{
+	tsk_timer_t **prev, *timer, *last;
+	tsk_size_t index;
+
+	if(!manager->buckets_count){
+		return tsk_null;
+	}
+	for(prev = &TSK_TIMER_BUCKET(manager, id); (timer = *prev) && timer->id != id; prev = &timer->bucket_next);
+	if(!timer){
+		return tsk_null;
+	}
+	*prev = timer->bucket_next;
+	timer->bucket_next = tsk_null;
+
+	index = timer->heap_index;
+	last = manager->heap[--manager->heap_count];
+	if(index < manager->heap_count){
+		__tsk_timer_heap_set(manager, index, last);
+		if(index > 0 && TSK_TIMER_BEFORE(last, manager->heap[(index - 1) / TSK_TIMER_HEAP_ARITY])){
+			__tsk_timer_heap_up(manager, index);
+		}
+		else{
+			__tsk_timer_heap_down(manager, index);
+		}
+	}
+	return timer;
+}
+
+/* Removes all timers. Must be called with the mutex held. */
+static void __tsk_timer_manager_clear(tsk_timer_manager_t *manager)
+{
+	while(manager->heap_count){
+		tsk_object_unref(manager->heap[--manager->heap_count]);
+	}
+	if(manager->buckets){
+		memset(manager->buckets, 0, manager->buckets_count * sizeof(tsk_timer_t*));
 	}
-	return -1;
 }
 
 static void* TSK_STDCALL __tsk_timer_manager_mainthread(void *param)
@@ -318,24 +678,20 @@ peek_first:
 			break;
 		}
 
-		tsk_mutex_lock(manager->mutex);
-		curr = TSK_TIMER_GET_FIRST();
-		tsk_mutex_unlock(manager->mutex);
-
-		if (curr && !curr->canceled) {
+		tsk_mutex_lock(manager->mutex); // must lock() before enqueue()
+		if ((curr = TSK_TIMER_GET_FIRST())) {
 			now = tsk_time_now();
 			if (now >= curr->timeout) {
-				tsk_timer_t *timer = (tsk_timer_t*)tsk_object_ref(curr);
+				tsk_timer_t *timer = __tsk_timer_manager_remove(manager, curr->id);
 				//TSK_DEBUG_INFO("Timer raise %llu", timer->id);
-
-				tsk_mutex_lock(manager->mutex); // must lock() before enqueue()
 				TSK_RUNNABLE_ENQUEUE_OBJECT_SAFE(TSK_RUNNABLE(manager), timer);
-				tsk_list_remove_item_by_data(manager->timers, curr);
 				tsk_mutex_unlock(manager->mutex);
 				TSK_OBJECT_SAFE_FREE(timer);
 			}
 			else{
-				if((ret = tsk_condwait_timedwait(manager->condwait, (curr->timeout - now)))){
+				uint64_t timeout = (curr->timeout - now); // "curr" could be canceled as soon as the mutex is unlocked
+				tsk_mutex_unlock(manager->mutex);
+				if((ret = tsk_condwait_timedwait(manager->condwait, timeout))){
 					TSK_DEBUG_ERROR("CONWAIT for timer manager failed [%d]", ret);
 					break;
 				}
@@ -344,10 +700,7 @@ peek_first:
 				}
 			}
 		}
-		else if(curr) {
-			tsk_mutex_lock(manager->mutex);
-			/* TSK_DEBUG_INFO("Timer canceled %llu", curr->id); */
-			tsk_list_remove_item_by_data(manager->timers, curr);
+		else {
 			tsk_mutex_unlock(manager->mutex);
 		}
 	} /* while() */
@@ -364,11 +717,27 @@ peek_first:
 /* ================= Global Timer Manager ================= */
 
 static tsk_timer_manager_t* __timer_mgr = tsk_null;
+static tsk_size_t __timer_mgr_shards_count = TSK_TIMER_MGR_GLOBAL_SHARDS;
+
+/**@ingroup tsk_timer_group
+* Sets the number of shards used by the global timer manager. Must be called before the global manager is created (@ref tsk_timer_mgr_global_ref).
+* @param shards_count The number of shards (1 to disable sharding).
+* @retval Zero if succeed and non-zero error code otherwise.
+*/
+int tsk_timer_mgr_global_set_shards_count(tsk_size_t shards_count)
+{
+	if(__timer_mgr){
+		TSK_DEBUG_ERROR("Global timer manager already created");
+		return -1;
+	}
+	__timer_mgr_shards_count = shards_count;
+	return 0;
+}
 
 tsk_timer_manager_handle_t* tsk_timer_mgr_global_ref()
 {
 	if(!__timer_mgr){
-		__timer_mgr = (tsk_timer_manager_t*)tsk_timer_manager_create();
+		__timer_mgr = (tsk_timer_manager_t*)tsk_timer_manager_create_sharded(__timer_mgr_shards_count);
 	}
 	else{
 		__timer_mgr = (tsk_timer_manager_t*)tsk_object_ref(__timer_mgr);
@@ -411,6 +780,15 @@ int tsk_timer_mgr_global_cancel(tsk_timer_id_t id)
     return tsk_timer_manager_cancel(__timer_mgr, id);
 }
 
+int tsk_timer_mgr_global_cancel_bulk(const tsk_timer_id_t* ids, tsk_size_t count)
+{
+    if(!__timer_mgr){
+            TSK_DEBUG_ERROR("No global Timer manager could be found");
+            return -1;
+    }
+    return tsk_timer_manager_cancel_bulk(__timer_mgr, ids, count);
+}
+
 int tsk_timer_mgr_global_unref(tsk_timer_manager_handle_t** mgr_global)
 {
 	if(!mgr_global || !*mgr_global){
@@ -438,10 +816,10 @@ static tsk_object_t* tsk_timer_manager_ctor(tsk_object_t * self, va_list * app)
 {
 	tsk_timer_manager_t *manager = (tsk_timer_manager_t*)self;
 	if(manager){
-		manager->timers = tsk_list_create();
 		manager->sem = tsk_semaphore_create();
 		manager->condwait = tsk_condwait_create();
 		manager->mutex = tsk_mutex_create();
+		manager->ids_stride = 1;
 	}
 	return self;
 }
@@ -456,7 +834,15 @@ static tsk_object_t* tsk_timer_manager_dtor(tsk_object_t * self)
 		tsk_semaphore_destroy(&manager->sem);
 		tsk_condwait_destroy(&manager->condwait);
 		tsk_mutex_destroy(&manager->mutex);
-		TSK_OBJECT_SAFE_FREE(manager->timers);
+		if(manager->shards){
+			while(manager->shards_count){
+				--manager->shards_count;
+				TSK_OBJECT_SAFE_FREE(manager->shards[manager->shards_count]);
+			}
+			TSK_FREE(manager->shards);
+		}
+		TSK_FREE(manager->heap);
+		TSK_FREE(manager->buckets);
 	}
 
 	return self;
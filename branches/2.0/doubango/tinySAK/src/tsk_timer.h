@@ -51,6 +51,23 @@ TSK_BEGIN_DECLS
 #define TSK_INVALID_TIMER_ID						0
 #define TSK_TIMER_ID_IS_VALID(id)					((id) != TSK_INVALID_TIMER_ID)
 
+/**@ingroup tsk_timer_group
+* @def TSK_TIMER_MGR_GLOBAL_SHARDS
+* Default number of shards for the global timer manager. 1 (no sharding) unless the application opts in using @ref tsk_timer_mgr_global_set_shards_count.
+*/
+#if !defined(TSK_TIMER_MGR_GLOBAL_SHARDS)
+#	define TSK_TIMER_MGR_GLOBAL_SHARDS				1
+#endif
+/**@ingroup tsk_timer_group
+* @def TSK_TIMER_LATENESS_BUCKETS
+* Number of buckets in the lateness histogram (see @ref tsk_timer_manager_get_lateness).
+*/
+#define TSK_TIMER_LATENESS_BUCKETS					12
+/**@ingroup tsk_timer_group
+* @def TSK_TIMER_SHARD_ALL
+*/
+#define TSK_TIMER_SHARD_ALL							((tsk_size_t)-1)
+
 /**@ingroup tsk_timer_group
 * @def tsk_timer_manager_handle_t
 */
@@ -65,6 +82,9 @@ typedef long tsk_timer_id_t;
 typedef int (*tsk_timer_callback_f)(const void* arg, tsk_timer_id_t timer_id);
 
 TINYSAK_API tsk_timer_manager_handle_t* tsk_timer_manager_create();
+TINYSAK_API tsk_timer_manager_handle_t* tsk_timer_manager_create_sharded(tsk_size_t shards_count);
+TINYSAK_API tsk_size_t tsk_timer_manager_get_shards_count(const tsk_timer_manager_handle_t *self);
+TINYSAK_API int tsk_timer_manager_get_lateness(const tsk_timer_manager_handle_t *self, tsk_size_t shard, uint64_t histogram[TSK_TIMER_LATENESS_BUCKETS]);
 
 TINYSAK_API int tsk_timer_manager_start(tsk_timer_manager_handle_t *self);
 TINYSAK_API int tsk_timer_manager_stop(tsk_timer_manager_handle_t *self);
@@ -74,14 +94,17 @@ TINYSAK_API void tsk_timer_manager_debug(tsk_timer_manager_handle_t *self);
 
 TINYSAK_API tsk_timer_id_t tsk_timer_manager_schedule(tsk_timer_manager_handle_t *self, uint64_t timeout, tsk_timer_callback_f callback, const void *arg);
 TINYSAK_API int tsk_timer_manager_cancel(tsk_timer_manager_handle_t *self, tsk_timer_id_t id);
+TINYSAK_API int tsk_timer_manager_cancel_bulk(tsk_timer_manager_handle_t *self, const tsk_timer_id_t* ids, tsk_size_t count);
 TINYSAK_API int tsk_timer_manager_destroy(tsk_timer_manager_handle_t **self);
 
 
 // Global Timer manager
+TINYSAK_API int tsk_timer_mgr_global_set_shards_count(tsk_size_t shards_count);
 TINYSAK_API tsk_timer_manager_handle_t* tsk_timer_mgr_global_ref();
 TINYSAK_API int tsk_timer_mgr_global_start();
 TINYSAK_API tsk_timer_id_t tsk_timer_mgr_global_schedule(uint64_t timeout, tsk_timer_callback_f callback, const void *arg);
 TINYSAK_API int tsk_timer_mgr_global_cancel(tsk_timer_id_t id);
+TINYSAK_API int tsk_timer_mgr_global_cancel_bulk(const tsk_timer_id_t* ids, tsk_size_t count);
 TINYSAK_API int tsk_timer_mgr_global_unref(tsk_timer_manager_handle_t** mgr_global);
 
 
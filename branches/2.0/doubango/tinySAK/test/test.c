@@ -54,6 +54,7 @@
 #define RUN_TEST_BASE64				0
 #define RUN_TEST_UUID				0
 #define RUN_TEST_FSM				0
+#define RUN_TEST_ARENA				0
 
 #if RUN_TEST_LISTS || RUN_TEST_ALL
 #include "test_lists.h"
@@ -135,6 +136,10 @@
 #include "test_fsm.h"
 #endif
 
+#if RUN_TEST_ARENA || RUN_TEST_ALL
+#include "test_arena.h"
+#endif
+
 
 #ifdef _WIN32_WCE
 int _tmain(int argc, _TCHAR* argv[])
@@ -280,6 +285,11 @@ int main()
 		test_fsm();
 #endif
 
+#if RUN_TEST_ARENA || RUN_TEST_ALL
+		/* test arena allocator */
+		test_arena();
+#endif
+
 	}
 	while(LOOP);
 
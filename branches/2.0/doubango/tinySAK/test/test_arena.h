@@ -0,0 +1,137 @@
+/*
+* Copyright (C) 2009 Mamadou Diop.
+*
+* Contact: Mamadou Diop <diopmamadou(at)doubango.org>
+*	
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*	
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*	
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*
+*/
+#ifndef _TEST_ARENA_H_
+#define _TEST_ARENA_H_
+
+#define ARENA_THREADS		4
+#define ARENA_BLOCKS		2000 /* per thread */
+#define ARENA_BLOCK_SIZE	24
+
+typedef struct test_arena_ctx_s
+{
+	tsk_arena_t* arena;
+	uint8_t* blocks[ARENA_BLOCKS];
+	uint8_t id;
+}
+test_arena_ctx_t;
+
+/* several threads carving the same arena (e.g. getters of a lazily parsed message) */
+static void *test_arena_thread(void *param)
+{
+	test_arena_ctx_t* ctx = (test_arena_ctx_t*)param;
+	tsk_arena_t* previous = tsk_arena_push(ctx->arena);
+	tsk_buffer_t* buffer;
+	int i;
+
+	for(i = 0; i < ARENA_BLOCKS; ++i){
+		ctx->blocks[i] = tsk_arena_alloc(ctx->arena, ARENA_BLOCK_SIZE);
+		assert(ctx->blocks[i]);
+		memset(ctx->blocks[i], ctx->id, ARENA_BLOCK_SIZE);
+		if(!(i & 63)){
+			buffer = tsk_buffer_create_null();
+			assert(buffer && tsk_arena_of(buffer) == ctx->arena);
+			TSK_OBJECT_SAFE_FREE(buffer);
+		}
+	}
+	tsk_arena_pop(previous);
+	return tsk_null;
+}
+
+void test_arena()
+{
+	tsk_arena_t *arena, *previous;
+	tsk_buffer_t *buffer, *buffer_heap;
+	tsk_list_t *list;
+	test_arena_ctx_t ctxs[ARENA_THREADS];
+	void* tid[ARENA_THREADS];
+	uint8_t *small, *large, *small_2;
+	int i, j, k, ret;
+
+	arena = tsk_arena_create(1024);
+	assert(arena);
+	assert(!tsk_arena_of(arena));
+
+	/* aligned as malloc() does and zeroed */
+	for(i = 1; i < 100; i += 7){
+		uint8_t* block = tsk_arena_alloc(arena, i);
+		assert(block && !(((uintptr_t)block) % (sizeof(void*) << 1)));
+		for(j = 0; j < i; ++j){
+			assert(block[j] == 0);
+		}
+		memset(block, 0xFF, i);
+	}
+	small = tsk_arena_alloc(arena, 0);
+	assert(!small);
+
+	/* a large block gets its own chunk and the current one is still carved */
+	small = tsk_arena_alloc(arena, 16);
+	large = tsk_arena_alloc(arena, 4096);
+	small_2 = tsk_arena_alloc(arena, 16);
+	assert(small && large && small_2);
+	assert(small_2 == small + 16);
+
+	/* the objects created while the arena is current are carved from it and keep it alive */
+	previous = tsk_arena_push(arena);
+	assert(tsk_arena_current() == arena);
+	buffer = tsk_buffer_create("test", 4);
+	list = tsk_list_create();
+	assert(buffer && list);
+	tsk_arena_pop(previous);
+	assert(tsk_arena_current() == previous);
+	buffer_heap = tsk_buffer_create_null();
+	assert(buffer_heap);
+	assert(tsk_arena_of(buffer) == arena && tsk_arena_of(list) == arena && !tsk_arena_of(buffer_heap));
+	assert(tsk_object_get_refcount(arena) == 3);
+	TSK_OBJECT_SAFE_FREE(list);
+	assert(tsk_object_get_refcount(arena) == 2);
+	tsk_object_unref(arena);
+	assert(tsk_object_get_refcount(arena) == 1);
+	assert(TSK_BUFFER_SIZE(buffer) == 4 && !memcmp(TSK_BUFFER_DATA(buffer), "test", 4));
+	TSK_OBJECT_SAFE_FREE(buffer); /* last reference: the chunks are released */
+	TSK_OBJECT_SAFE_FREE(buffer_heap);
+
+	/* concurrent allocations never overlap */
+	arena = tsk_arena_create(0);
+	assert(arena);
+	for(i = 0; i < ARENA_THREADS; ++i){
+		ctxs[i].arena = arena;
+		ctxs[i].id = (uint8_t)(i + 1);
+		tid[i] = tsk_null;
+		ret = tsk_thread_create(&tid[i], test_arena_thread, &ctxs[i]);
+		assert(ret == 0);
+	}
+	for(i = 0; i < ARENA_THREADS; ++i){
+		tsk_thread_join(&tid[i]);
+	}
+	for(i = 0; i < ARENA_THREADS; ++i){
+		for(j = 0; j < ARENA_BLOCKS; ++j){
+			for(k = 0; k < ARENA_BLOCK_SIZE; ++k){
+				assert(ctxs[i].blocks[j][k] == ctxs[i].id);
+			}
+		}
+	}
+	assert(tsk_object_get_refcount(arena) == 1);
+	assert(arena->used >= ARENA_THREADS * ARENA_BLOCKS * ARENA_BLOCK_SIZE);
+	TSK_OBJECT_SAFE_FREE(arena);
+}
+
+#endif /* _TEST_ARENA_H_ */
@@ -22,6 +22,74 @@
 #ifndef _TEST_BUFFER_H_
 #define _TEST_BUFFER_H_
 
+/* the memory is reused across chuncks (no shrinking while consuming the data) and only released after a burst */
+void test_buffer_reuse()
+{
+	tsk_buffer_t *buffer = tsk_buffer_create_null();
+	const void* data;
+	tsk_size_t capacity;
+	int i, ret;
+	char chunck[1000];
+
+	memset(chunck, 'x', sizeof(chunck));
+
+	/* append then consume everything: the same memory is used for the next chuncks */
+	ret = tsk_buffer_append(buffer, chunck, sizeof(chunck));
+	assert(ret == 0);
+	data = TSK_BUFFER_DATA(buffer);
+	capacity = TSK_BUFFER_CAPACITY(buffer);
+	for(i = 0; i < 100; ++i){
+		ret = tsk_buffer_remove(buffer, 0, TSK_BUFFER_SIZE(buffer));
+		assert(ret == 0);
+		assert(TSK_BUFFER_SIZE(buffer) == 0 && TSK_BUFFER_DATA(buffer) == data && TSK_BUFFER_CAPACITY(buffer) == capacity);
+		ret = tsk_buffer_append(buffer, chunck, sizeof(chunck));
+		assert(ret == 0);
+		assert(TSK_BUFFER_DATA(buffer) == data && TSK_BUFFER_CAPACITY(buffer) == capacity);
+	}
+
+	/* consume from the head: the start moves forward and the consumed bytes are reclaimed when appending */
+	ret = tsk_buffer_remove(buffer, 0, 100);
+	assert(ret == 0);
+	assert(TSK_BUFFER_SIZE(buffer) == sizeof(chunck) - 100 && TSK_BUFFER_DATA(buffer) == (const uint8_t*)data + 100);
+	ret = tsk_buffer_append(buffer, chunck, 100);
+	assert(ret == 0);
+	assert(TSK_BUFFER_SIZE(buffer) == sizeof(chunck) && TSK_BUFFER_DATA(buffer) == data && TSK_BUFFER_CAPACITY(buffer) == capacity);
+
+	/* burst: the large allocation is kept while most of it is still in use... */
+	for(i = 0; i < 256; ++i){
+		ret = tsk_buffer_append(buffer, chunck, sizeof(chunck));
+		assert(ret == 0);
+	}
+	capacity = TSK_BUFFER_CAPACITY(buffer);
+	assert(capacity >= 257 * sizeof(chunck));
+	for(i = 0; i < 128; ++i){
+		ret = tsk_buffer_remove(buffer, 0, sizeof(chunck));
+		assert(ret == 0);
+		assert(TSK_BUFFER_SIZE(buffer) == (257 - i - 1) * sizeof(chunck));
+	}
+	assert(TSK_BUFFER_CAPACITY(buffer) + buffer->offset == capacity);
+	/* ...and trimmed once mostly consumed */
+	while(TSK_BUFFER_SIZE(buffer) > 10 * sizeof(chunck)){
+		ret = tsk_buffer_remove(buffer, 0, sizeof(chunck));
+		assert(ret == 0);
+	}
+	assert(TSK_BUFFER_CAPACITY(buffer) + buffer->offset < capacity);
+	assert(TSK_BUFFER_SIZE(buffer) == 10 * sizeof(chunck) && memcmp(TSK_BUFFER_DATA(buffer), chunck, sizeof(chunck)) == 0);
+
+	/* nothing kept once empty */
+	for(i = 0; i < 256; ++i){
+		ret = tsk_buffer_append(buffer, chunck, sizeof(chunck));
+		assert(ret == 0);
+	}
+	ret = tsk_buffer_remove(buffer, 0, TSK_BUFFER_SIZE(buffer));
+	assert(ret == 0);
+	assert(TSK_BUFFER_SIZE(buffer) == 0 && TSK_BUFFER_CAPACITY(buffer) == 0 && !TSK_BUFFER_DATA(buffer));
+	ret = tsk_buffer_append(buffer, chunck, sizeof(chunck));
+	assert(ret == 0 && TSK_BUFFER_SIZE(buffer) == sizeof(chunck));
+
+	TSK_OBJECT_SAFE_FREE(buffer);
+}
+
 void test_buffer()
 {
 	tsk_buffer_t *buffer = tsk_buffer_create_null(); 
@@ -39,6 +107,8 @@ void test_buffer()
 	printf("2. Buffer=%s", TSK_BUFFER_TO_STRING(buffer));
 
 	TSK_OBJECT_SAFE_FREE(buffer);
+
+	test_buffer_reuse();
 }
 
 #endif /* _TEST_BUFFER_H_ */
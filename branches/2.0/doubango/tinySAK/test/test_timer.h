@@ -52,7 +52,7 @@ static int test_timer_callback(const void* arg, tsk_timer_id_t timer_id)
 void test_global_timer()
 {
 	size_t i;
-	tsk_timer_mgr_global_ref();
+	tsk_timer_manager_handle_t *mgr_global = tsk_timer_mgr_global_ref();
 
 	// for test: start it two times
 	tsk_timer_mgr_global_start();
@@ -67,11 +67,8 @@ void test_global_timer()
 
 	tsk_thread_sleep(4000);
 
-	// for test: stop it only one time
-	tsk_timer_mgr_global_stop();
-	tsk_timer_mgr_global_stop();
-
-	tsk_timer_mgr_global_unref();
+	// stopped when the last reference is released
+	tsk_timer_mgr_global_unref(&mgr_global);
 }
 
 void test_single_timer()
@@ -95,10 +92,185 @@ void test_single_timer()
 	TSK_OBJECT_SAFE_FREE(handle);
 }
 
+#define TEST_TIMER_HEAP_COUNT	256
+
+static uint64_t test_timer_heap_timeouts[TEST_TIMER_HEAP_COUNT];
+static tsk_timer_id_t test_timer_heap_ids[TEST_TIMER_HEAP_COUNT];
+static tsk_bool_t test_timer_heap_canceled[TEST_TIMER_HEAP_COUNT];
+static tsk_size_t test_timer_heap_fired[TEST_TIMER_HEAP_COUNT];
+static tsk_size_t test_timer_heap_fired_count = 0;
+
+static int test_timer_heap_callback(const void* arg, tsk_timer_id_t timer_id)
+{
+	// all callbacks are raised on the same thread
+	tsk_size_t index = ((const uint64_t*)arg - test_timer_heap_timeouts);
+	assert(test_timer_heap_ids[index] == timer_id);
+	if(test_timer_heap_fired_count < TEST_TIMER_HEAP_COUNT){
+		test_timer_heap_fired[test_timer_heap_fired_count++] = index;
+	}
+	return 0;
+}
+
+/* Schedules timers in random order, cancels some of them (one by one and in bulk) then checks
+* that only the remaining ones are raised and in timeout order. */
+void test_timer_heap()
+{
+	tsk_timer_manager_handle_t *handle = tsk_timer_manager_create();
+	tsk_timer_id_t bulk[TEST_TIMER_HEAP_COUNT];
+	tsk_size_t i, j, bulk_count = 0, expected = 0;
+	uint64_t tmp;
+	int ret;
+
+	printf("test_timer_heap//\n");
+
+	test_timer_heap_fired_count = 0;
+	memset(test_timer_heap_canceled, 0, sizeof(test_timer_heap_canceled));
+
+	// distinct timeouts (3ms apart) in random order
+	srand(1234);
+	for(i = 0; i < TEST_TIMER_HEAP_COUNT; ++i){
+		test_timer_heap_timeouts[i] = 50 + (i * 3);
+	}
+	for(i = TEST_TIMER_HEAP_COUNT - 1; i > 0; --i){
+		j = (tsk_size_t)rand() % (i + 1);
+		tmp = test_timer_heap_timeouts[i], test_timer_heap_timeouts[i] = test_timer_heap_timeouts[j], test_timer_heap_timeouts[j] = tmp;
+	}
+
+	tsk_timer_manager_start(handle);
+	for(i = 0; i < TEST_TIMER_HEAP_COUNT; ++i){
+		test_timer_heap_ids[i] = tsk_timer_manager_schedule(handle, test_timer_heap_timeouts[i], test_timer_heap_callback, &test_timer_heap_timeouts[i]);
+		assert(TSK_TIMER_ID_IS_VALID(test_timer_heap_ids[i]));
+	}
+	for(i = 0; i < TEST_TIMER_HEAP_COUNT; ++i){
+		switch(i & 3){
+			case 0: // one by one (removed from anywhere in the heap)
+				ret = tsk_timer_manager_cancel(handle, test_timer_heap_ids[i]);
+				assert(ret == 0);
+				test_timer_heap_canceled[i] = tsk_true;
+				break;
+			case 1: // in bulk
+				bulk[bulk_count++] = test_timer_heap_ids[i];
+				test_timer_heap_canceled[i] = tsk_true;
+				break;
+			default:
+				++expected;
+				break;
+		}
+	}
+	ret = tsk_timer_manager_cancel_bulk(handle, bulk, bulk_count);
+	assert(ret == (int)bulk_count);
+	// already canceled
+	ret = tsk_timer_manager_cancel(handle, test_timer_heap_ids[0]);
+	assert(ret != 0);
+	ret = tsk_timer_manager_cancel_bulk(handle, bulk, bulk_count);
+	assert(ret == 0);
+
+	tsk_thread_sleep((uint64_t)(50 + (TEST_TIMER_HEAP_COUNT * 3) + 500));
+
+	printf("fired=%u expected=%u\n", (unsigned)test_timer_heap_fired_count, (unsigned)expected);
+	assert(test_timer_heap_fired_count == expected);
+	for(i = 0; i < test_timer_heap_fired_count; ++i){
+		assert(!test_timer_heap_canceled[test_timer_heap_fired[i]]);
+		if(i > 0){
+			assert(test_timer_heap_timeouts[test_timer_heap_fired[i - 1]] < test_timer_heap_timeouts[test_timer_heap_fired[i]]);
+		}
+	}
+
+	TSK_OBJECT_SAFE_FREE(handle);
+}
+
+#define TEST_TIMER_SHARDS_COUNT		4
+#define TEST_TIMER_SHARDS_OBJECTS	8
+#define TEST_TIMER_SHARDS_PER_OBJECT	16
+
+typedef struct test_timer_object_s
+{
+	tsk_timer_id_t ids[TEST_TIMER_SHARDS_PER_OBJECT];
+	long last; // index of the last timer raised
+	long fired;
+	long disorders;
+}
+test_timer_object_t;
+static test_timer_object_t test_timer_objects[TEST_TIMER_SHARDS_OBJECTS];
+
+static int test_timer_shards_callback(const void* arg, tsk_timer_id_t timer_id)
+{
+	// raised on the object's shard: no concurrent callbacks for the same object
+	test_timer_object_t* object = (test_timer_object_t*)arg;
+	long i;
+	for(i = 0; i < TEST_TIMER_SHARDS_PER_OBJECT && object->ids[i] != timer_id; ++i);
+	if(i <= object->last){
+		++object->disorders;
+	}
+	object->last = i;
+	++object->fired;
+	return 0;
+}
+
+/* Sharded manager: the ids are valid, unique and route the cancellation to the right shard, and the timers
+* of the same object (callback argument) are raised in order. */
+void test_timer_shards()
+{
+	tsk_timer_manager_handle_t *handle = tsk_timer_manager_create_sharded(TEST_TIMER_SHARDS_COUNT);
+	tsk_timer_id_t bulk[TEST_TIMER_SHARDS_OBJECTS * TEST_TIMER_SHARDS_PER_OBJECT];
+	tsk_size_t i, j, k, bulk_count = 0;
+	test_timer_object_t* object;
+	int ret;
+
+	printf("test_timer_shards//\n");
+
+	assert(tsk_timer_manager_get_shards_count(handle) == TEST_TIMER_SHARDS_COUNT);
+	memset(test_timer_objects, 0, sizeof(test_timer_objects));
+	tsk_timer_manager_start(handle);
+
+	for(i = 0; i < TEST_TIMER_SHARDS_OBJECTS; ++i){
+		object = &test_timer_objects[i];
+		object->last = -1;
+		for(j = 0; j < TEST_TIMER_SHARDS_PER_OBJECT; ++j){
+			object->ids[j] = tsk_timer_manager_schedule(handle, (uint64_t)(20 + (j * 5)), test_timer_shards_callback, object);
+			assert(TSK_TIMER_ID_IS_VALID(object->ids[j]) && object->ids[j] > 0);
+			// same object => same shard
+			assert((object->ids[j] % TEST_TIMER_SHARDS_COUNT) == (object->ids[0] % TEST_TIMER_SHARDS_COUNT));
+		}
+	}
+	// unique ids
+	for(i = 0; i < TEST_TIMER_SHARDS_OBJECTS * TEST_TIMER_SHARDS_PER_OBJECT; ++i){
+		for(k = i + 1; k < TEST_TIMER_SHARDS_OBJECTS * TEST_TIMER_SHARDS_PER_OBJECT; ++k){
+			assert(test_timer_objects[i / TEST_TIMER_SHARDS_PER_OBJECT].ids[i % TEST_TIMER_SHARDS_PER_OBJECT] != test_timer_objects[k / TEST_TIMER_SHARDS_PER_OBJECT].ids[k % TEST_TIMER_SHARDS_PER_OBJECT]);
+		}
+	}
+	// cancel the odd timers: one by one for the first half of the objects and in bulk for the others
+	for(i = 0; i < TEST_TIMER_SHARDS_OBJECTS; ++i){
+		for(j = 1; j < TEST_TIMER_SHARDS_PER_OBJECT; j += 2){
+			if(i < (TEST_TIMER_SHARDS_OBJECTS >> 1)){
+				ret = tsk_timer_manager_cancel(handle, test_timer_objects[i].ids[j]);
+				assert(ret == 0);
+			}
+			else{
+				bulk[bulk_count++] = test_timer_objects[i].ids[j];
+			}
+		}
+	}
+	ret = tsk_timer_manager_cancel_bulk(handle, bulk, bulk_count);
+	assert(ret == (int)bulk_count);
+
+	tsk_thread_sleep((uint64_t)(20 + (TEST_TIMER_SHARDS_PER_OBJECT * 5) + 500));
+
+	for(i = 0; i < TEST_TIMER_SHARDS_OBJECTS; ++i){
+		printf("object=%u fired=%ld disorders=%ld\n", (unsigned)i, test_timer_objects[i].fired, test_timer_objects[i].disorders);
+		assert(test_timer_objects[i].fired == (TEST_TIMER_SHARDS_PER_OBJECT >> 1));
+		assert(test_timer_objects[i].disorders == 0);
+	}
+
+	TSK_OBJECT_SAFE_FREE(handle);
+}
+
 void test_timer()
 {
 	//test_single_timer();
 	test_global_timer();
+	test_timer_heap();
+	test_timer_shards();
 }
 
 #endif /* _TEST_TIMER_H_ */
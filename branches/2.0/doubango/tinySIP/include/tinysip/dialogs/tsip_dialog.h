@@ -165,6 +165,12 @@ typedef struct tsip_dialog_s
 
 	tsip_dialog_event_callback_f callback;
 
+	/* dialog layer list (holds a reference) and indexes (weak links), protected by the layer's lock */
+	struct tsip_dialog_s* layer_prev;
+	struct tsip_dialog_s* layer_next;
+	struct tsip_dialog_s* callid_next;
+	struct tsip_dialog_s* ssid_next;
+
 	TSK_DECLARE_SAFEOBJ;
 }
 tsip_dialog_t;
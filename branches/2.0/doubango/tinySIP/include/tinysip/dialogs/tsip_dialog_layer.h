@@ -41,13 +41,27 @@
 
 TSIP_BEGIN_DECLS
 
+/** Initial number of buckets used to index the dialogs. Doubled each time the load factor exceeds one. */
+#define TSIP_DIALOG_LAYER_BUCKETS_MIN	64
+
+#define TSIP_DIALOG_LAYER(self)	((tsip_dialog_layer_t*)(self))
+
 typedef struct tsip_dialog_layer_s
 {
 	TSK_DECLARE_OBJECT;
 
 	const tsip_stack_t *stack;
 
-	tsip_dialogs_L_t *dialogs;
+	/* Dialogs in creation order (linked through 'layer_prev' and 'layer_next'). The layer holds a reference to each of them. */
+	struct tsip_dialog_s* head;
+	struct tsip_dialog_s* tail;
+
+	/* Indexes used to match incoming messages and to remove the dialogs in constant time. */
+	struct tsip_dialog_s** callid_buckets; /* keyed by Call-ID (case-insensitive hash) */
+	struct tsip_dialog_s** ssid_buckets; /* keyed by SIP session id */
+	tsk_size_t buckets_count;
+	tsk_size_t count;
+	tsk_size_t count_register; /* number of REGISTER dialogs (used by the shutdown phases) */
 
 	struct{
 		tsk_bool_t inprogress;
@@ -66,6 +80,7 @@ tsip_dialog_layer_t* tsip_dialog_layer_create(tsip_stack_t* stack);
 TINYSIP_API tsip_dialog_t* tsip_dialog_layer_find_by_ss(tsip_dialog_layer_t *self, const tsip_ssession_handle_t *ss);
 tsip_dialog_t* tsip_dialog_layer_find_by_ssid(tsip_dialog_layer_t *self, tsip_ssession_id_t ssid);
 tsip_dialog_t* tsip_dialog_layer_find_by_callid(tsip_dialog_layer_t *self, const char* callid);
+tsip_dialog_t* tsip_dialog_layer_find(const tsip_dialog_layer_t *self, const char* callid, const char* to_tag, const char* from_tag, tsip_request_type_t type, tsk_bool_t *cid_matched);
 tsk_bool_t tsip_dialog_layer_have_dialog_with_callid(const tsip_dialog_layer_t *self, const char* callid);
 
 tsk_size_t tsip_dialog_layer_count_active_calls(tsip_dialog_layer_t *self);
@@ -176,12 +176,14 @@ typedef tsk_list_t tsip_headers_L_t; /**< List of @ref tsip_header_t elements. *
 
 TINYSIP_API const char *tsip_header_get_name(tsip_header_type_t type);
 TINYSIP_API const char *tsip_header_get_name_2(const tsip_header_t *self);
+TINYSIP_API tsip_header_type_t tsip_header_get_type(const char* name, tsk_size_t size);
 TINYSIP_API char tsip_header_get_param_separator(const tsip_header_t *self);
 TINYSIP_API int tsip_header_serialize(const tsip_header_t *self, tsk_buffer_t *output);
 TINYSIP_API char* tsip_header_tostring(const tsip_header_t *self);
 TINYSIP_API int tsip_header_value_serialize(const tsip_header_t *self, tsk_buffer_t *output);
 TINYSIP_API char* tsip_header_value_tostring(const tsip_header_t *self);
 TINYSIP_API char* tsip_header_get_param_value(const tsip_header_t *self, const char* pname);
+TINYSIP_API tsip_header_t* tsip_header_copyout(const tsip_header_t *self);
 
 #define TSIP_HEADER_HAVE_PARAM(self, name)					((self) && TSIP_HEADER((self))->params) ? tsk_params_have_param(TSIP_HEADER(self)->params, name) : tsk_false
 #define TSIP_HEADER_ADD_PARAM(self, name, value)			tsk_params_add_param((self) ? &TSIP_HEADER((self))->params : tsk_null, name, value)
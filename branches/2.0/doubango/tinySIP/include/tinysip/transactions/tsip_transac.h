@@ -67,6 +67,9 @@ TSIP_BEGIN_DECLS
 #define TRANSAC_TIMER_CANCEL(TX) \
 	tsk_timer_mgr_global_cancel(self->timer##TX.id)
 
+#define TRANSAC_TIMERS_CANCEL(IDS) \
+	tsk_timer_mgr_global_cancel_bulk((IDS), sizeof((IDS)) / sizeof((IDS)[0]))
+
 typedef enum tsip_transac_event_type_e
 {
 	tsip_transac_incoming_msg,
@@ -153,6 +156,13 @@ typedef struct tsip_transac_s
 	char* callid;
 	
 	tsip_transac_event_callback_f callback;
+
+	/* transaction layer list (holds a reference) and indexes (weak links), protected by the layer's lock */
+	struct tsip_transac_s* layer_prev;
+	struct tsip_transac_s* layer_next;
+	struct tsip_transac_s* branch_next;
+	struct tsip_transac_s* callid_next;
+	tsk_bool_t branch_indexed;
 }
 tsip_transac_t;
 
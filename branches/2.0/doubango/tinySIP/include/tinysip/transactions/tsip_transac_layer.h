@@ -40,13 +40,26 @@
 
 TSIP_BEGIN_DECLS
 
+/** Initial number of buckets used to index the transactions. Doubled each time the load factor exceeds one. */
+#define TSIP_TRANSAC_LAYER_BUCKETS_MIN	64
+
+#define TSIP_TRANSAC_LAYER(self)	((tsip_transac_layer_t*)(self))
+
 typedef struct tsip_transac_layer_s
 {
 	TSK_DECLARE_OBJECT;
 
 	const struct tsip_stack_s *stack;
 
-	tsip_transacs_L_t *transactions;
+	/* Transactions in creation order (linked through 'layer_prev' and 'layer_next'). The layer holds a reference to each of them. */
+	struct tsip_transac_s* head;
+	struct tsip_transac_s* tail;
+
+	/* Indexes used to match incoming messages and to remove the transactions in constant time. */
+	struct tsip_transac_s** branch_buckets; /* keyed by branch (RFC 3261 17.1.3 and 17.2.3). Client transactions are added when they start (see tsip_transac_layer_index_branch) */
+	struct tsip_transac_s** callid_buckets; /* keyed by Call-ID (ACK to non-2xx matching and membership) */
+	tsk_size_t buckets_count;
+	tsk_size_t count;
 
 	TSK_DECLARE_SAFEOBJ;
 }
@@ -59,6 +72,7 @@ tsip_transac_layer_t* tsip_transac_layer_create(tsip_stack_t* stack);
 
 tsip_transac_t* tsip_transac_layer_new(const tsip_transac_layer_t *self, tsk_bool_t isCT, const tsip_message_t* msg, tsip_transac_dst_t* dst);
 int tsip_transac_layer_remove(tsip_transac_layer_t *self, const tsip_transac_t *transac);
+int tsip_transac_layer_index_branch(tsip_transac_layer_t *self, tsip_transac_t *transac);
 int tsip_transac_layer_cancel_by_dialog(tsip_transac_layer_t *self, const struct tsip_dialog_s* dialog);
 
 tsip_transac_t* tsip_transac_layer_find_client(const tsip_transac_layer_t *self, const tsip_message_t* message);
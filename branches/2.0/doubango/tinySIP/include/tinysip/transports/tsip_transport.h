@@ -39,6 +39,7 @@
 #include "tsk_object.h"
 #include "tsk_list.h"
 #include "tsk_string.h"
+#include "tsk_buffer.h"
 
 
 TSIP_BEGIN_DECLS
@@ -123,6 +124,9 @@ typedef struct tsip_transport_s
 
 	tsip_transport_stream_peers_L_t* stream_peers;
 	int32_t stream_peers_count;
+
+	tsk_buffer_t* snd_buffer; /**< Reused to serialize the outgoing messages: grows up to the largest message and never shrinks. */
+	volatile long snd_buffer_busy; /**< Non-zero while @a snd_buffer is used by a sender (another thread falls back to a temporary buffer). */
 }
 tsip_transport_t;
 
@@ -135,6 +139,7 @@ int tsip_transport_deinit(tsip_transport_t* self);
 int tsip_transport_tls_set_certs(tsip_transport_t *self, const char* ca, const char* pbk, const char* pvk);
 tsk_size_t tsip_transport_send(const tsip_transport_t* self, const char *branch, tsip_message_t *msg, const char* destIP, int32_t destPort);
 tsk_size_t tsip_transport_send_raw(const tsip_transport_t* self, const char* dst_host, tnet_port_t dst_port, const void* data, tsk_size_t size, const char* callid);
+tsk_size_t tsip_transport_send_rawv(const tsip_transport_t* self, const char* dst_host, tnet_port_t dst_port, const tnet_iovec_t* iov, tsk_size_t count, const char* callid);
 tsk_size_t tsip_transport_send_raw_ws(const tsip_transport_t* self, tnet_fd_t local_fd, const void* data, tsk_size_t size, const char* callid);
 tsip_uri_t* tsip_transport_get_uri(const tsip_transport_t *self, int lr);
 
@@ -155,6 +160,7 @@ int tsip_transport_stream_peer_remove_callid(tsip_transport_stream_peer_t* self,
 int tsip_transport_stream_peers_cleanup(tsip_transport_t *self);
 
 #define tsip_transport_tls_set_certs(transport, ca, pbk, pvk, verify)					(transport ? tnet_transport_tls_set_certs(transport->net_transport, ca, pbk, pvk, verify) : -1)
+#define tsip_transport_tls_set_sessions(transport, cache_size, lifetime, ticket_key_rotation)	(transport ? tnet_transport_tls_set_sessions(transport->net_transport, cache_size, lifetime, ticket_key_rotation) : -1)
 #define tsip_transport_start(transport)													(transport ? tnet_transport_start(transport->net_transport) : -1)
 #define tsip_transport_isready(transport)												(transport ? tnet_transport_isready(transport->net_transport) : -1)
 #define tsip_transport_issecure(transport)												(transport ? tnet_transport_issecure(transport->net_transport) : 0)
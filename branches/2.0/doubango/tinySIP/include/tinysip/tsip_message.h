@@ -50,7 +50,9 @@
 #include "tnet_socket.h"
 
 #include "tsk_object.h"
+#include "tsk_arena.h"
 #include "tsk_buffer.h"
+#include "tsk_mutex.h"
 
 TSIP_BEGIN_DECLS
 
@@ -141,6 +143,16 @@ typedef struct tsip_message_s
 	/*== OTHER HEADERS*/
 	tsip_headers_L_t *headers;
 
+	/*== HEADERS NOT PARSED YET (see tsip_message_parse_2()) */
+	struct{
+		tsk_buffer_t* lines; /**< Copy of the raw header lines (with their CRLF). */
+		struct tsip_message_deferred_s* items; /**< Type and position of each line in @a lines. */
+		tsk_size_t count;
+		tsk_size_t capacity;
+		tsk_mutex_handle_t* mutex; /**< Created with the first deferred line. The getters parse on demand and could be called from several threads. */
+	} deferred;
+	tsk_arena_t* arena; /**< Arena the received headers are carved from (see tsip_message_parse_2()). Null if they are on the heap. */
+
 	/*== to hack the message */
 	char* sigcomp_id;
 	tnet_fd_t local_fd;
@@ -185,6 +197,11 @@ static void TSIP_MESSAGE_ADD_HEADER(tsip_message_t *self, ...)
 	}
 #endif
 
+int tsip_message_defer_header(tsip_message_t *self, const char* line, tsk_size_t size, tsk_size_t remaining);
+TINYSIP_API int tsip_message_parse_deferred(const tsip_message_t *self, tsip_header_type_t type);
+TINYSIP_API int tsip_message_parse_deferred_all(const tsip_message_t *self);
+TINYSIP_API int tsip_message_lock(const tsip_message_t *self);
+TINYSIP_API int tsip_message_unlock(const tsip_message_t *self);
 TINYSIP_API const tsip_header_t *tsip_message_get_headerAt(const tsip_message_t *self, tsip_header_type_t type, tsk_size_t index);
 TINYSIP_API const tsip_header_t *tsip_message_get_headerLast(const tsip_message_t *self, tsip_header_type_t type);
 TINYSIP_API const tsip_header_t *tsip_message_get_header(const tsip_message_t *self, tsip_header_type_t type);
@@ -199,6 +216,7 @@ TINYSIP_API uint32_t	tsip_message_getContent_length(const tsip_message_t *messag
 TINYSIP_API int32_t		tsip_message_getCSeq(const tsip_message_t *message);
 
 TINYSIP_API int tsip_message_tostring(const tsip_message_t *self, tsk_buffer_t *output);
+TINYSIP_API int tsip_message_tostring_2(const tsip_message_t *self, tsk_buffer_t *output, tsk_bool_t with_content);
 
 TINYSIP_API tsip_request_type_t tsip_request_get_type(const char* method);
 TINYSIP_API tsip_request_t *tsip_request_new(const char* method, const tsip_uri_t *request_uri, const tsip_uri_t *from, const tsip_uri_t *to, const char *call_id, int32_t cseq);
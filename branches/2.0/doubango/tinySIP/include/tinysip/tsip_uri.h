@@ -86,6 +86,7 @@ TINYSIP_API tsip_uri_t* tsip_uri_create(tsip_uri_type_t type);
 TINYSIP_API int tsip_uri_serialize(const tsip_uri_t *uri, tsk_bool_t with_params, tsk_bool_t quote, tsk_buffer_t *output);
 TINYSIP_API char* tsip_uri_tostring(const tsip_uri_t *uri, tsk_bool_t with_params, tsk_bool_t quote);
 TINYSIP_API tsip_uri_t *tsip_uri_clone(const tsip_uri_t *uri, tsk_bool_t with_params, tsk_bool_t quote);
+TINYSIP_API tsip_uri_t *tsip_uri_copyout(const tsip_uri_t *uri);
 
 TINYSIP_GEXTERN const tsk_object_def_t *tsip_uri_def_t;
 
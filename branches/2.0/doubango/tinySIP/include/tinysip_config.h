@@ -80,6 +80,19 @@
 #   define TSIP_COMPACT_HEADERS 0
 #endif
 
+/* Whether the transport layer only parses the headers needed to route the incoming messages (see tsip_message_parse_2()) */
+#if !defined(TSIP_MESSAGE_LAZY_PARSING)
+#   define TSIP_MESSAGE_LAZY_PARSING 1
+#endif
+
+/* Whether the transport layer carves the objects of each incoming message from a per-message arena (see tsip_message_parse_2()) */
+#if !defined(TSIP_MESSAGE_ARENA)
+#   define TSIP_MESSAGE_ARENA 1
+#endif
+#if !defined(TSIP_MESSAGE_ARENA_CHUNK_SIZE)
+#   define TSIP_MESSAGE_ARENA_CHUNK_SIZE 4096
+#endif
+
 #include <stdint.h>
 #ifdef __SYMBIAN32__
 #include <stdlib.h>
@@ -96,6 +96,7 @@ typedef enum tsip_stack_param_type_e
 	tsip_pname_dnsserver,
 	tsip_pname_max_fds,
 	tsip_pname_mode,
+	tsip_pname_network_workers,
 
 	
 	/* === Security === */
@@ -105,6 +106,7 @@ typedef enum tsip_stack_param_type_e
 	tsip_pname_amf,
 	tsip_pname_operator_id,
 	tsip_pname_tls_certs,
+	tsip_pname_tls_sessions,
 	tsip_pname_ipsec_params,
 
 	/* === Dummy Headers === */
@@ -359,6 +361,18 @@ int ret = tsip_stack_set(stack,
 #define TSIP_STACK_SET_DNS_SERVER(IP_STR)														tsip_pname_dnsserver, (const char*)IP_STR
 #define TSIP_STACK_SET_MAX_FDS(MAX_FDS_UINT)													tsip_pname_max_fds, (unsigned)MAX_FDS_UINT
 #define TSIP_STACK_SET_MODE(MODE_ENUM)															tsip_pname_mode, (tsip_stack_mode_t)MODE_ENUM
+/**@ingroup tsip_stack_group
+* @def TSIP_STACK_SET_NETWORK_WORKERS
+* Sets the number of I/O workers (threads) used by each SIP transport. Only supported by the epoll() network backend.
+* Datagram transports use one SO_REUSEPORT socket per worker. Must be set before the stack is started.
+* @param COUNT_UINT The number of workers. Default value: 1.
+* @code
+int ret = tsip_stack_set(stack, 
+              TSIP_STACK_SET_NETWORK_WORKERS(4),
+              TSIP_STACK_SET_NULL());
+* @endcode
+*/
+#define TSIP_STACK_SET_NETWORK_WORKERS(COUNT_UINT)												tsip_pname_network_workers, (unsigned)COUNT_UINT
 
 /* === Security === */
 /**@ingroup tsip_stack_group
@@ -459,6 +473,21 @@ int ret = tsip_stack_set(stack,
 #define TSIP_STACK_SET_IPSEC_PARAMS(ALG_STR, EALG_STR, MODE_STR, PROTOCOL_STR)				tsip_pname_ipsec_params, (const char*)ALG_STR, (const char*)EALG_STR, (const char*)MODE_STR, (const char*)PROTOCOL_STR
 #define TSIP_STACK_SET_TLS_CERTS(CA_FILE_STR, PUB_FILE_STR, PRIV_FILE_STR)					TSIP_STACK_SET_TLS_CERTS_2(CA_FILE_STR, PUB_FILE_STR, PRIV_FILE_STR, tsk_false)
 #define TSIP_STACK_SET_TLS_CERTS_2(CA_FILE_STR, PUB_FILE_STR, PRIV_FILE_STR, VERIF_BOOL)	tsip_pname_tls_certs, (const char*)CA_FILE_STR, (const char*)PUB_FILE_STR, (const char*)PRIV_FILE_STR, (tsk_bool_t)VERIF_BOOL
+/**@ingroup tsip_stack_group
+* @def TSIP_STACK_SET_TLS_SESSIONS
+* Configures the TLS session resumption of the TLS and WSS transports. Must be set before the stack is started.
+* @param CACHE_SIZE_UINT Maximum number of sessions in the server cache, zero to disable the cache. Default value: @ref TNET_TLS_SESSION_CACHE_SIZE.
+* @param LIFETIME_UINT Lifetime of the sessions and tickets, in seconds. Default value: @ref TNET_TLS_SESSION_LIFETIME.
+* @param TICKET_KEY_ROTATION_UINT Interval between two session ticket keys (RFC 5077), in seconds. Zero to disable the tickets. Default value: @ref TNET_TLS_TICKET_KEY_ROTATION.
+* @code
+int ret = tsip_stack_set(stack, 
+              TSIP_STACK_SET_TLS_SESSIONS(1024, 7200, 3600),
+              TSIP_STACK_SET_NULL());
+* @endcode
+*
+* @sa @ref tsip_stack_get_tls_stats()
+*/
+#define TSIP_STACK_SET_TLS_SESSIONS(CACHE_SIZE_UINT, LIFETIME_UINT, TICKET_KEY_ROTATION_UINT)	tsip_pname_tls_sessions, (unsigned)CACHE_SIZE_UINT, (unsigned)LIFETIME_UINT, (unsigned)TICKET_KEY_ROTATION_UINT
 
 /* === Headers === */
 /**@ingroup tsip_stack_group
@@ -595,6 +624,7 @@ typedef struct tsip_stack_s
 		tsk_bool_t discovery_dhcp;
 
 		tsk_size_t max_fds;
+		tsk_size_t workers_count;
 	} network;
 
 	/* === Security === */
@@ -619,6 +649,11 @@ typedef struct tsip_stack_s
 			char* pbk;
 			char* pvk;
 			tsk_bool_t verify;
+			struct {
+				tsk_size_t cache_size;
+				uint32_t lifetime;
+				uint32_t ticket_key_rotation;
+			} sessions;
 		}tls;
 		tsk_bool_t enable_secagree_tls;
 	} security;
@@ -678,6 +713,7 @@ TINYSIP_API const void* tsip_stack_get_userdata(const tsip_stack_handle_t *self)
 TINYSIP_API tnet_dns_ctx_t* tsip_stack_get_dnsctx(tsip_stack_handle_t *self);
 TINYSIP_API tsip_uri_t* tsip_stack_get_preferred_id(tsip_stack_handle_t *self);
 TINYSIP_API int tsip_stack_get_local_ip_n_port(const tsip_stack_handle_t *self, const char* protocol, tnet_port_t *port, tnet_ip_t *ip);
+TINYSIP_API int tsip_stack_get_tls_stats(const tsip_stack_handle_t *self, tnet_tls_stats_t* stats);
 TINYSIP_API int tsip_stack_stop(tsip_stack_handle_t *self);
 
 #define TSIP_STACK_EVENT_RAISE(stack, status_code, reason_phrase, incoming, type) \
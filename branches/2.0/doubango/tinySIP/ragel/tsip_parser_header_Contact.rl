@@ -126,7 +126,9 @@ int tsip_header_Contact_serialize(const tsip_header_t* header, tsk_buffer_t* out
 
 		/* Expires */
 		if(Contact->expires >=0){
-			tsk_buffer_append_2(output, ";expires=%lld", Contact->expires);
+			if(!(ret = tsk_buffer_append(output, ";expires=", 9))){
+				ret = tsk_buffer_append_int(output, Contact->expires);
+			}
 		}
 		
 		return ret;
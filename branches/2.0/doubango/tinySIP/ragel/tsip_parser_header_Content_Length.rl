@@ -76,7 +76,7 @@ int tsip_header_Content_Length_serialize(const tsip_header_t* header, tsk_buffer
 {
 	if(header){
 		const tsip_header_Content_Length_t *Content_Length = (const tsip_header_Content_Length_t *)header;		
-		return tsk_buffer_append_2(output, "%u", Content_Length->length);
+		return tsk_buffer_append_int(output, Content_Length->length);
 	}
 
 	return -1;
@@ -108,7 +108,7 @@ int tsip_header_To_serialize(const tsip_header_t* header, tsk_buffer_t* output)
 		if((ret = tsip_uri_serialize(To->uri, tsk_true, tsk_true, output))){
 			return ret;
 		}
-		if(To->tag && (ret = tsk_buffer_append_2(output, ";tag=%s", To->tag))){
+		if(To->tag && ((ret = tsk_buffer_append(output, ";tag=", 5)) || (ret = tsk_buffer_append_str(output, To->tag)))){
 			return ret;
 		}
 		return ret;
@@ -35,7 +35,7 @@
 #include "tsk_debug.h"
 #include "tsk_memory.h"
 
-static void tsip_message_parser_execute(tsk_ragel_state_t *state, tsip_message_t *message, tsk_bool_t extract_content);
+static void tsip_message_parser_execute(tsk_ragel_state_t *state, tsip_message_t *message, tsk_bool_t extract_content, tsk_bool_t lazy);
 static void tsip_message_parser_init(tsk_ragel_state_t *state);
 static void tsip_message_parser_eoh(tsk_ragel_state_t *state, tsip_message_t *message, tsk_bool_t extract_content);
 
@@ -145,7 +145,10 @@ static void tsip_message_parser_eoh(tsk_ragel_state_t *state, tsip_message_t *me
 		state->tag_end = p;
 		len = (int)(state->tag_end  - state->tag_start);
 		
-		if(tsip_header_parse(state, message)){
+		if(lazy && tsip_message_defer_header(message, state->tag_start, (tsk_size_t)len, (tsk_size_t)(pe - state->tag_start)) == 0){
+			/* will be parsed when requested (see tsip_message_get_headerAt()) */
+		}
+		else if(tsip_header_parse(state, message)){
 			//TSK_DEBUG_INFO("TSIP_MESSAGE_PARSER::PARSE_HEADER len=%d state=%d", len, state->cs);
 		}
 		else{
@@ -193,6 +196,18 @@ static void tsip_message_parser_eoh(tsk_ragel_state_t *state, tsip_message_t *me
 
 tsk_bool_t tsip_message_parse(tsk_ragel_state_t *state, tsip_message_t **result, tsk_bool_t extract_content)
 {
+	return tsip_message_parse_2(state, result, extract_content, tsk_false, tsk_false);
+}
+
+/** Parses a SIP message.
+* @param lazy Whether to only parse the headers the stack needs to route the message (Via, From, To, Call-ID, CSeq, Contact,
+* Expires and Content-*). The other ones are kept as received and parsed when a getter asks for them.
+* @param arena Whether to carve the headers, URIs and parameters from a per-message arena (see @ref tsk_arena_push()).
+*/
+tsk_bool_t tsip_message_parse_2(tsk_ragel_state_t *state, tsip_message_t **result, tsk_bool_t extract_content, tsk_bool_t lazy, tsk_bool_t arena)
+{
+	tsk_arena_t* previous;
+
 	if(!state || state->pe <= state->p){
 		return tsk_false;
 	}
@@ -200,6 +215,9 @@ tsk_bool_t tsip_message_parse(tsk_ragel_state_t *state, tsip_message_t **result,
 	if(!*result){
 		*result = tsip_message_create();
 	}
+	if(arena && *result && !(*result)->arena){
+		(*result)->arena = tsk_arena_create(TSIP_MESSAGE_ARENA_CHUNK_SIZE);
+	}
 
 	/* Ragel init */
 	tsip_message_parser_init(state);
@@ -207,7 +225,9 @@ tsk_bool_t tsip_message_parse(tsk_ragel_state_t *state, tsip_message_t **result,
 	/*
 	*	State mechine execution.
 	*/
-	tsip_message_parser_execute(state, *result, extract_content);
+	previous = tsk_arena_push((*result)->arena);
+	tsip_message_parser_execute(state, *result, extract_content, lazy);
+	tsk_arena_pop(previous);
 
 	/* Check result */
 
@@ -231,7 +251,7 @@ static void tsip_message_parser_init(tsk_ragel_state_t *state)
 	state->cs = cs;
 }
 
-static void tsip_message_parser_execute(tsk_ragel_state_t *state, tsip_message_t *message, tsk_bool_t extract_content)
+static void tsip_message_parser_execute(tsk_ragel_state_t *state, tsip_message_t *message, tsk_bool_t extract_content, tsk_bool_t lazy)
 {
 	int cs = state->cs;
 	const char *p = state->p;
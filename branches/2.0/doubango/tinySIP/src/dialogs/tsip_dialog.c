@@ -761,7 +761,7 @@ int tsip_dialog_update(tsip_dialog_t *self, const tsip_response_t* response)
 					if(!self->record_routes){
 						self->record_routes = tsk_list_create();
 					}
-					if((route = tsk_object_ref((void*)recordRoute))){
+					if((route = (tsip_header_Record_Route_t*)tsip_header_copyout(TSIP_HEADER(recordRoute)))){
 						tsk_list_push_front_data(self->record_routes, (void**)&route); /* Copy reversed. */
 					}
 				}
@@ -806,7 +806,7 @@ int tsip_dialog_update_2(tsip_dialog_t *self, const tsip_request_t* invite)
 	/* self->cseq_value = invite->CSeq ? invite->CSeq->seq : self->cseq_value; */
 	if(invite->From && invite->From->uri){
 		TSK_OBJECT_SAFE_FREE(self->uri_remote);
-		self->uri_remote = tsk_object_ref(invite->From->uri);
+		self->uri_remote = tsip_uri_copyout(invite->From->uri);
 	}
 
 	/* Route sets */
@@ -821,7 +821,7 @@ int tsip_dialog_update_2(tsip_dialog_t *self, const tsip_request_t* invite)
 			if(!self->record_routes){
 				self->record_routes = tsk_list_create();
 			}
-			if((route = tsk_object_ref((void*)recordRoute))){
+			if((route = (tsip_header_Record_Route_t*)tsip_header_copyout(TSIP_HEADER(recordRoute)))){
 				tsk_list_push_back_data(self->record_routes, (void**)&route); /* Copy non-reversed. */
 			}
 		}
@@ -40,39 +40,95 @@
 #include "tinysip/transactions/tsip_transac_layer.h"
 #include "tinysip/transports/tsip_transport_layer.h"
 
+#include "tsk_memory.h"
 #include "tsk_debug.h"
 
 extern tsip_ssession_handle_t *tsip_ssession_create_2(const tsip_stack_t* stack, const struct tsip_message_s* message);
 
-/*== Predicate function to find dialog by type */
-static int pred_find_dialog_by_type(const tsk_list_item_t *item, const void *type)
+/* case-insensitive because tsip_dialog_layer_find_by_callid() ignores the case */
+#define _tsip_dialog_layer_callid_bucket(self, callid) (tsk_strihash((callid)) & ((self)->buckets_count - 1))
+#define _tsip_dialog_layer_ssid_bucket(self, ssid) ((tsk_size_t)(ssid) & ((self)->buckets_count - 1)) /* ids are sequential */
+#define _tsip_dialog_layer_is_linked(self, dialog) ((dialog)->layer_prev || (self)->head == (dialog))
+
+/* appends at the tail to keep the creation order within a bucket (oldest dialog matches first, as with the list) */
+static void _tsip_dialog_layer_index(tsip_dialog_layer_t *self, tsip_dialog_t* dialog)
 {
-	if(item && item->data){
-		tsip_dialog_t *dialog = item->data;
-		return (dialog->type - *((tsip_dialog_type_t*)type));
-	}
-	return -1;
+	tsip_dialog_t** head;
+	dialog->callid_next = dialog->ssid_next = tsk_null;
+	for(head = &self->callid_buckets[_tsip_dialog_layer_callid_bucket(self, dialog->callid)]; *head; head = &(*head)->callid_next);
+	*head = dialog;
+	for(head = &self->ssid_buckets[_tsip_dialog_layer_ssid_bucket(self, tsip_ssession_get_id(dialog->ss))]; *head; head = &(*head)->ssid_next);
+	*head = dialog;
 }
 
-/*== Predicate function to find dialog by not type */
-static int pred_find_dialog_by_not_type(const tsk_list_item_t *item, const void *type)
+/* returns whether the dialog was indexed (only dialogs owned by the layer are) */
+static tsk_bool_t _tsip_dialog_layer_unindex(tsip_dialog_layer_t *self, const tsip_dialog_t* dialog)
 {
-	if(item && item->data){
-		tsip_dialog_t *dialog = item->data;
-		if(dialog->type != *((tsip_dialog_type_t*)type)){
-			return 0;
+	tsip_dialog_t** head;
+	for(head = &self->callid_buckets[_tsip_dialog_layer_callid_bucket(self, dialog->callid)]; *head != dialog; head = &(*head)->callid_next){
+		if(!*head){
+			return tsk_false;
 		}
 	}
-	return -1;
+	*head = dialog->callid_next;
+	for(head = &self->ssid_buckets[_tsip_dialog_layer_ssid_bucket(self, tsip_ssession_get_id(dialog->ss))]; *head; head = &(*head)->ssid_next){
+		if(*head == dialog){
+			*head = dialog->ssid_next;
+			break;
+		}
+	}
+	return tsk_true;
 }
 
-/*== Predicate function to find dialog by callid */
-static int pred_find_dialog_by_callid(const tsk_list_item_t *item, const void *callid)
+static int _tsip_dialog_layer_buckets_alloc(tsip_dialog_layer_t *self, tsk_size_t count)
 {
-	if(item && item->data && callid){
-		return tsk_strcmp(((tsip_dialog_t*)item->data)->callid, ((const char*)callid));
+	tsip_dialog_t** callid_buckets = tsk_calloc(count, sizeof(tsip_dialog_t*));
+	tsip_dialog_t** ssid_buckets = tsk_calloc(count, sizeof(tsip_dialog_t*));
+	if(!callid_buckets || !ssid_buckets){
+		TSK_DEBUG_ERROR("Failed to allocate %u buckets", (unsigned)count);
+		TSK_FREE(callid_buckets);
+		TSK_FREE(ssid_buckets);
+		return -1;
 	}
-	return -1;
+	TSK_FREE(self->callid_buckets);
+	TSK_FREE(self->ssid_buckets);
+	self->callid_buckets = callid_buckets;
+	self->ssid_buckets = ssid_buckets;
+	self->buckets_count = count;
+	return 0;
+}
+
+/* adds a new dialog to the layer (takes the ownership) */
+static int _tsip_dialog_layer_add(tsip_dialog_layer_t *self, tsip_dialog_t** dialog)
+{
+	tsip_dialog_t *it;
+
+	tsk_safeobj_lock(self);
+
+	_tsip_dialog_layer_index(self, *dialog);
+	if(((*dialog)->layer_prev = self->tail)){
+		self->tail->layer_next = *dialog;
+	}
+	else{
+		self->head = *dialog;
+	}
+	(*dialog)->layer_next = tsk_null;
+	self->tail = *dialog;
+	if((*dialog)->type == tsip_dialog_REGISTER){
+		++self->count_register;
+	}
+	*dialog = tsk_null; /* now owned by the layer */
+
+	/* doubles the number of buckets and rebuilds the indexes from the list (creation order) */
+	if(++self->count > self->buckets_count && _tsip_dialog_layer_buckets_alloc(self, self->buckets_count << 1) == 0){
+		for(it = self->head; it; it = it->layer_next){
+			_tsip_dialog_layer_index(self, it);
+		}
+	}
+
+	tsk_safeobj_unlock(self);
+
+	return 0;
 }
 
 tsip_dialog_layer_t* tsip_dialog_layer_create(tsip_stack_t* stack)
@@ -91,12 +147,10 @@ tsip_dialog_t* tsip_dialog_layer_find_by_ssid(tsip_dialog_layer_t *self, tsip_ss
 {
 	tsip_dialog_t *ret = 0;
 	tsip_dialog_t *dialog;
-	tsk_list_item_t *item;
 
 	tsk_safeobj_lock(self);
 
-	tsk_list_foreach(item, self->dialogs){
-		dialog = item->data;
+	for(dialog = self->ssid_buckets[_tsip_dialog_layer_ssid_bucket(self, ssid)]; dialog; dialog = dialog->ssid_next){
 		if(tsip_ssession_get_id(dialog->ss) == ssid){
 			ret = dialog;
 			break;
@@ -116,16 +170,15 @@ tsip_dialog_t* tsip_dialog_layer_find_by_callid(tsip_dialog_layer_t *self, const
 		return tsk_null;
 	}
 	else{
-		tsip_dialog_t *dialog = tsk_null;
-		tsk_list_item_t *item;
-		//--tsk_safeobj_lock(self);
-		tsk_list_foreach(item, self->dialogs){
-			if(tsk_striequals(TSIP_DIALOG(item->data)->callid, callid)){
-				dialog = tsk_object_ref(item->data);
+		tsip_dialog_t *dialog;
+		tsk_safeobj_lock(self); /* the buckets could be reallocated */
+		for(dialog = self->callid_buckets[_tsip_dialog_layer_callid_bucket(self, callid)]; dialog; dialog = dialog->callid_next){
+			if(tsk_striequals(dialog->callid, callid)){
+				dialog = tsk_object_ref(dialog);
 				break;
 			}
 		}
-		//--tsk_safeobj_unlock(self);
+		tsk_safeobj_unlock(self);
 		return dialog;
 	}
 }
@@ -133,10 +186,14 @@ tsip_dialog_t* tsip_dialog_layer_find_by_callid(tsip_dialog_layer_t *self, const
 tsk_bool_t tsip_dialog_layer_have_dialog_with_callid(const tsip_dialog_layer_t *self, const char* callid)
 {
 	tsk_bool_t found = tsk_false;
-	if(self){
+	if(self && callid){
+		const tsip_dialog_t *dialog;
 		tsk_safeobj_lock(self);
-		if(tsk_list_find_item_by_pred(self->dialogs, pred_find_dialog_by_callid, callid) != tsk_null){
-			found = tsk_true;
+		for(dialog = self->callid_buckets[_tsip_dialog_layer_callid_bucket(self, callid)]; dialog; dialog = dialog->callid_next){
+			if(tsk_strcmp(dialog->callid, callid) == 0){
+				found = tsk_true;
+				break;
+			}
 		}
 		tsk_safeobj_unlock(self);
 	}
@@ -148,14 +205,12 @@ tsip_dialog_t* tsip_dialog_layer_find(const tsip_dialog_layer_t *self, const cha
 {
 	tsip_dialog_t *ret = tsk_null;
 	tsip_dialog_t *dialog;
-	tsk_list_item_t *item;
 
 	*cid_matched = tsk_false;
 	
 	tsk_safeobj_lock(self);
 
-	tsk_list_foreach(item, self->dialogs){
-		dialog = item->data;
+	for(dialog = self->callid_buckets[_tsip_dialog_layer_callid_bucket(self, callid)]; dialog; dialog = dialog->callid_next){
 		if(tsk_strequals(dialog->callid, callid)){
 			tsk_bool_t is_cancel = (type == tsip_CANCEL); // Incoming CANCEL
 			tsk_bool_t is_register = (type == tsip_REGISTER); // Incoming REGISTER
@@ -197,12 +252,11 @@ tsk_size_t tsip_dialog_layer_count_active_calls(tsip_dialog_layer_t *self)
 	tsk_size_t count = 0;
 
 	tsip_dialog_t *dialog;
-	tsk_list_item_t *item;
 
 	tsk_safeobj_lock(self);
 
-	tsk_list_foreach(item, self->dialogs) {
-		if ((dialog = item->data) && dialog->type == tsip_dialog_INVITE && dialog->state != tsip_initial && dialog->state != tsip_terminated) {
+	for (dialog = self->head; dialog; dialog = dialog->layer_next) {
+		if (dialog->type == tsip_dialog_INVITE && dialog->state != tsip_initial && dialog->state != tsip_terminated) {
 			++count;
 		}
 	}
@@ -217,9 +271,7 @@ int tsip_dialog_layer_shutdownAll(tsip_dialog_layer_t *self)
 {
 	if(self){
 		tsk_bool_t wait = tsk_false;
-		tsk_list_item_t *item;
 		tsip_dialog_t *dialog;
-		tsip_dialog_type_t regtype = tsip_dialog_REGISTER;
 
 		if(!self->shutdown.inprogress){
 			self->shutdown.inprogress = tsk_true;
@@ -229,11 +281,11 @@ int tsip_dialog_layer_shutdownAll(tsip_dialog_layer_t *self)
 		}
 		
 		tsk_safeobj_lock(self);
-		if(tsk_list_count(self->dialogs, pred_find_dialog_by_not_type, &regtype)){
+		if(self->count > self->count_register){
 			/* There are non-register dialogs ==> phase-1 */
 			goto phase1;
 		}
-		else if(tsk_list_count(self->dialogs, pred_find_dialog_by_type, &regtype)){
+		else if(self->count_register){
 			/* There are one or more register dialogs ==> phase-2 */
 			goto phase2;
 		}
@@ -246,19 +298,20 @@ phase1:
 		/* Phase 1 - shutdown all except register and silent_hangup */
 		TSK_DEBUG_INFO("== Shutting down - Phase-1 started ==");
 phase1_loop:
-		tsk_list_foreach(item, self->dialogs){
-			dialog = item->data;
+		for(dialog = self->head; dialog; dialog = dialog->layer_next){
 			if(dialog->type != tsip_dialog_REGISTER && !dialog->ss->silent_hangup){
-				item = tsk_object_ref(item);
+				dialog = tsk_object_ref(dialog);
 				if(!tsip_dialog_shutdown(dialog, tsk_null)){
 					wait = tsk_true;
 				}
 
 				// if "tsip_dialog_shutdown()" remove the dialog, then
-				// "self->dialogs" will be unsafe
-				if(!(item = tsk_object_unref(item))){
+				// its links will be unsafe
+				if(!_tsip_dialog_layer_is_linked(self, dialog)){
+					tsk_object_unref(dialog);
 					goto phase1_loop;
 				}
+				tsk_object_unref(dialog);
 			}
 		}
 		tsk_safeobj_unlock(self);
@@ -278,18 +331,19 @@ phase2:
 		TSK_DEBUG_INFO("== Shutting down - Phase-2 started ==");
 		self->shutdown.phase2 = tsk_true;
 phase2_loop:
-		tsk_list_foreach(item, self->dialogs){
-			dialog = item->data;
+		for(dialog = self->head; dialog; dialog = dialog->layer_next){
 			if(dialog->type == tsip_dialog_REGISTER){
-				item = tsk_object_ref(item);
+				dialog = tsk_object_ref(dialog);
 				if(!tsip_dialog_shutdown(dialog, tsk_null)){
 					wait = tsk_true;
 				}
 				// if "tsip_dialog_shutdown()" remove the dialog, then
-				// "self->dialogs" will be unsafe 
-				if(!(item = tsk_object_unref(item))){
+				// its links will be unsafe 
+				if(!_tsip_dialog_layer_is_linked(self, dialog)){
+					tsk_object_unref(dialog);
 					goto phase2_loop;
 				}
+				tsk_object_unref(dialog);
 			}
 		}
 		tsk_safeobj_unlock(self);
@@ -303,17 +357,18 @@ phase2_loop:
 		/* Phase 3 - silenthangup (dialogs will be terminated immediately) */
 		TSK_DEBUG_INFO("== Shutting down - Phase-3 ==");
 phase3_loop:
-		tsk_list_foreach(item, self->dialogs){
-			dialog = item->data;
+		for(dialog = self->head; dialog; dialog = dialog->layer_next){
 			if(dialog->ss->silent_hangup){
-				item = tsk_object_ref(item);
+				dialog = tsk_object_ref(dialog);
 				tsip_dialog_shutdown(dialog, tsk_null);
 
 				// if "tsip_dialog_shutdown()" remove the dialog, then
-				// "self->dialogs" will became unsafe while looping
-				if(!(item = tsk_object_unref(item))){
+				// its links will became unsafe while looping
+				if(!_tsip_dialog_layer_is_linked(self, dialog)){
+					tsk_object_unref(dialog);
 					goto phase3_loop;
 				}
+				tsk_object_unref(dialog);
 			}
 		}
 
@@ -347,7 +402,10 @@ int tsip_dialog_layer_signal_stack_disconnected(tsip_dialog_layer_t *self)
     }
 
 	tsk_safeobj_lock(self);
-    tsk_list_pushback_list(dialogs_copy, self->dialogs);
+    for (dialog = self->head; dialog; dialog = dialog->layer_next) {
+        tsip_dialog_t *copy = tsk_object_ref(dialog);
+        tsk_list_push_back_data(dialogs_copy, (void**)&copy);
+    }
     tsk_safeobj_unlock(self);
     
     tsk_list_foreach(item, dialogs_copy){
@@ -415,7 +473,7 @@ tsip_dialog_t* tsip_dialog_layer_new(tsip_dialog_layer_t *self, tsip_dialog_type
 			{
 				if((dialog = (tsip_dialog_t*)tsip_dialog_invite_create(ss, tsk_null))){
 					ret = tsk_object_ref(dialog);
-					tsk_list_push_back_data(self->dialogs, (void**)&dialog);
+					_tsip_dialog_layer_add(self, &dialog);
 				}
 				break;
 			}
@@ -423,7 +481,7 @@ tsip_dialog_t* tsip_dialog_layer_new(tsip_dialog_layer_t *self, tsip_dialog_type
 			{
 				if((dialog = (tsip_dialog_t*)tsip_dialog_message_create(ss))){
 					ret = tsk_object_ref(dialog);
-					tsk_list_push_back_data(self->dialogs, (void**)&dialog);
+					_tsip_dialog_layer_add(self, &dialog);
 				}
 				break;
 			}
@@ -431,7 +489,7 @@ tsip_dialog_t* tsip_dialog_layer_new(tsip_dialog_layer_t *self, tsip_dialog_type
 			{
 				if((dialog = (tsip_dialog_t*)tsip_dialog_info_create(ss))){
 					ret = tsk_object_ref(dialog);
-					tsk_list_push_back_data(self->dialogs, (void**)&dialog);
+					_tsip_dialog_layer_add(self, &dialog);
 				}
 				break;
 			}
@@ -439,7 +497,7 @@ tsip_dialog_t* tsip_dialog_layer_new(tsip_dialog_layer_t *self, tsip_dialog_type
 			{
 				if((dialog = (tsip_dialog_t*)tsip_dialog_options_create(ss))){
 					ret = tsk_object_ref(dialog);
-					tsk_list_push_back_data(self->dialogs, (void**)&dialog);
+					_tsip_dialog_layer_add(self, &dialog);
 				}
 				break;
 			}
@@ -447,7 +505,7 @@ tsip_dialog_t* tsip_dialog_layer_new(tsip_dialog_layer_t *self, tsip_dialog_type
 			{
 				if((dialog = (tsip_dialog_t*)tsip_dialog_publish_create(ss))){
 					ret = tsk_object_ref(dialog);
-					tsk_list_push_back_data(self->dialogs, (void**)&dialog);
+					_tsip_dialog_layer_add(self, &dialog);
 				}
 				break;
 			}
@@ -455,7 +513,7 @@ tsip_dialog_t* tsip_dialog_layer_new(tsip_dialog_layer_t *self, tsip_dialog_type
 			{
 				if((dialog = (tsip_dialog_t*)tsip_dialog_register_create(ss, tsk_null))){
 					ret = tsk_object_ref(dialog);
-					tsk_list_push_back_data(self->dialogs, (void**)&dialog);
+					_tsip_dialog_layer_add(self, &dialog);
 				}
 				break;
 			}
@@ -463,7 +521,7 @@ tsip_dialog_t* tsip_dialog_layer_new(tsip_dialog_layer_t *self, tsip_dialog_type
 			{
 				if((dialog = (tsip_dialog_t*)tsip_dialog_subscribe_create(ss))){
 					ret = tsk_object_ref(dialog);
-					tsk_list_push_back_data(self->dialogs, (void**)&dialog);
+					_tsip_dialog_layer_add(self, &dialog);
 				}
 				break;
 			}
@@ -482,23 +540,42 @@ bail:
 int tsip_dialog_layer_remove(tsip_dialog_layer_t *self, const tsip_dialog_t *dialog)
 {
 	if(dialog && self){
-		tsip_dialog_type_t regtype = tsip_dialog_REGISTER;
+		tsip_dialog_t *removed = tsk_null;
 		tsk_safeobj_lock(self);
 		
 		/* remove the dialog */
-		tsk_list_remove_item_by_data(self->dialogs, dialog);
+		if(_tsip_dialog_layer_unindex(self, dialog)){
+			removed = (tsip_dialog_t*)dialog;
+			if(removed->layer_prev){
+				removed->layer_prev->layer_next = removed->layer_next;
+			}
+			else{
+				self->head = removed->layer_next;
+			}
+			if(removed->layer_next){
+				removed->layer_next->layer_prev = removed->layer_prev;
+			}
+			else{
+				self->tail = removed->layer_prev;
+			}
+			removed->layer_prev = removed->layer_next = removed->callid_next = removed->ssid_next = tsk_null;
+			if(removed->type == tsip_dialog_REGISTER){
+				--self->count_register;
+			}
+			--self->count;
+		}
 		
 		/* whether shutting down? */
 		if(self->shutdown.inprogress){
 			if(self->shutdown.phase2){ /* Phase 2 (all non-REGISTER and silent dialogs have been removed) */
-				if(tsk_list_count(self->dialogs, pred_find_dialog_by_type, &regtype) == 0){
+				if(self->count_register == 0){
 					/* alert only if there is not REGISTER dialog (ignore silents) */
 					TSK_DEBUG_INFO("== Shutting down - Phase-2 completed ==");
 					tsk_condwait_broadcast(self->shutdown.condwait);
 				}
 			}
 			else{ /* Phase 1 */
-				if(tsk_list_count(self->dialogs, pred_find_dialog_by_not_type, &regtype) == 0){
+				if(self->count == self->count_register){
 					/* alert only if all dialogs except REGISTER have been removed */
 					TSK_DEBUG_INFO("== Shutting down - Phase-1 completed ==");
 					tsk_condwait_broadcast(self->shutdown.condwait);
@@ -508,6 +585,9 @@ int tsip_dialog_layer_remove(tsip_dialog_layer_t *self, const tsip_dialog_t *dia
 
 		tsk_safeobj_unlock(self);
 
+		/* the dialog could be destroyed: do it without holding the lock */
+		TSK_OBJECT_SAFE_FREE(removed);
+
 		return 0;
 	}
 
@@ -666,7 +746,7 @@ int tsip_dialog_layer_handle_incoming_msg(const tsip_dialog_layer_t *self, tsip_
 				if(message->local_fd > 0 && TNET_SOCKET_TYPE_IS_STREAM(message->src_net_type)) {
 					tsip_dialog_set_connected_fd(newdialog, message->local_fd);
 				}
-				tsk_list_push_back_data(self->dialogs, (void**)&newdialog); /* add new dialog to the layer */
+				_tsip_dialog_layer_add(TSIP_DIALOG_LAYER(self), &newdialog); /* add new dialog to the layer */
 				TSK_OBJECT_SAFE_FREE(dst);
 			}
 
@@ -736,9 +816,11 @@ static tsk_object_t* tsip_dialog_layer_ctor(tsk_object_t * self, va_list * app)
 	tsip_dialog_layer_t *layer = self;
 	if(layer){
 		layer->stack = va_arg(*app, const tsip_stack_t *);
-		layer->dialogs = tsk_list_create();
-
 		tsk_safeobj_init(layer);
+
+		if(_tsip_dialog_layer_buckets_alloc(layer, TSIP_DIALOG_LAYER_BUCKETS_MIN) != 0){
+			return tsk_null;
+		}
 	}
 	return self;
 }
@@ -747,7 +829,14 @@ static tsk_object_t* tsip_dialog_layer_dtor(tsk_object_t * self)
 { 
 	tsip_dialog_layer_t *layer = self;
 	if(layer){
-		TSK_OBJECT_SAFE_FREE(layer->dialogs);
+		tsip_dialog_t *dialog;
+		while((dialog = layer->head)){
+			layer->head = dialog->layer_next;
+			dialog->layer_prev = dialog->layer_next = tsk_null;
+			TSK_OBJECT_SAFE_FREE(dialog);
+		}
+		TSK_FREE(layer->callid_buckets);
+		TSK_FREE(layer->ssid_buckets);
 
 		/* condwait */
 		if(layer->shutdown.condwait){
@@ -188,7 +188,7 @@ int tsip_dialog_register_InProgress_2_Connected_X_2xx(va_list *app)
 			if(!TSIP_DIALOG_GET_STACK(self)->associated_uris){
 				TSIP_DIALOG_GET_STACK(self)->associated_uris = tsk_list_create();
 			}
-			uri = tsk_object_ref(hdr_P_Associated_URI_t->uri);
+			uri = tsip_uri_copyout(hdr_P_Associated_URI_t->uri);
 			tsk_list_push_back_data(TSIP_DIALOG_GET_STACK(self)->associated_uris, (void**)&uri);
 		}
 
@@ -201,7 +201,7 @@ int tsip_dialog_register_InProgress_2_Connected_X_2xx(va_list *app)
 			if(!TSIP_DIALOG_GET_STACK(self)->service_routes){
 				TSIP_DIALOG_GET_STACK(self)->service_routes = tsk_list_create();
 			}
-			uri = tsk_object_ref(hdr_Service_Route->uri);
+			uri = tsip_uri_copyout(hdr_Service_Route->uri);
 			tsk_list_push_back_data(TSIP_DIALOG_GET_STACK(self)->service_routes, (void**)&uri);
 		}
 
@@ -210,7 +210,7 @@ int tsip_dialog_register_InProgress_2_Connected_X_2xx(va_list *app)
 			if(TSIP_DIALOG_GET_STACK(self)->paths == 0){
 				TSIP_DIALOG_GET_STACK(self)->paths = tsk_list_create();
 			}
-			uri = tsk_object_ref(hdr_Path->uri);
+			uri = tsip_uri_copyout(hdr_Path->uri);
 			tsk_list_push_back_data(TSIP_DIALOG_GET_STACK(self)->paths, (void**)&uri);
 		}
 	}
@@ -31,9 +31,14 @@
 
 #include "tinysip/headers/tsip_header_Dummy.h"
 
+#include "tinysip/tsip_message.h"
+#include "tinysip/parsers/tsip_parser_header.h"
+
 
 #include "tsk_debug.h"
 
+#include <ctype.h>
+
 /* Compact headers: http://www.cs.columbia.edu/sip/compact.html 
 Abbreviation 	Header 					defined by 					origin (mnemonic)
 a 				Accept-Contact 			draft-ietf-sip-callerprefs 	--
@@ -220,6 +225,180 @@ const char *tsip_header_get_name_2(const tsip_header_t *self)
 	return "unknown-header";
 }
 
+/** Gets the type of the header named @a name (long or compact form, case-insensitive).
+ * @param name The name of the header, not necessarily null-terminated.
+ * @param size The length of @a name.
+ *
+ * @return The type of the header or @a tsip_htype_Dummy if the name is unknown (extension header).
+**/
+tsip_header_type_t tsip_header_get_type(const char* name, tsk_size_t size)
+{
+	/* long and compact names (whatever TSIP_COMPACT_HEADERS is): the first character and the length leave at most a few names to compare */
+	if(name && size){
+		switch(tolower(*name)){
+			case 'a':
+				if(size == 1) return tsip_htype_Accept_Contact;
+				if(size == 5 && tsk_strniequals(name, "Allow", 5)) return tsip_htype_Allow;
+				if(size == 6 && tsk_strniequals(name, "Accept", 6)) return tsip_htype_Accept;
+				if(size == 10 && tsk_strniequals(name, "Alert-Info", 10)) return tsip_htype_Alert_Info;
+				if(size == 12 && tsk_strniequals(name, "Allow-Events", 12)) return tsip_htype_Allow_Events;
+				if(size == 13 && tsk_strniequals(name, "Authorization", 13)) return tsip_htype_Authorization;
+				if(size == 14 && tsk_strniequals(name, "Accept-Contact", 14)) return tsip_htype_Accept_Contact;
+				if(size == 15 && tsk_strniequals(name, "Accept-Encoding", 15)) return tsip_htype_Accept_Encoding;
+				if(size == 15 && tsk_strniequals(name, "Accept-Language", 15)) return tsip_htype_Accept_Language;
+				if(size == 19 && tsk_strniequals(name, "Authentication-Info", 19)) return tsip_htype_Authentication_Info;
+				if(size == 24 && tsk_strniequals(name, "Accept-Resource-Priority", 24)) return tsip_htype_Accept_Resource_Priority;
+				break;
+			case 'b':
+				if(size == 1) return tsip_htype_Referred_By;
+				break;
+			case 'c':
+				if(size == 1) return tsip_htype_Content_Type;
+				if(size == 4 && tsk_strniequals(name, "CSeq", 4)) return tsip_htype_CSeq;
+				if(size == 7 && tsk_strniequals(name, "Call-ID", 7)) return tsip_htype_Call_ID;
+				if(size == 7 && tsk_strniequals(name, "Contact", 7)) return tsip_htype_Contact;
+				if(size == 9 && tsk_strniequals(name, "Call-Info", 9)) return tsip_htype_Call_Info;
+				if(size == 12 && tsk_strniequals(name, "Content-Type", 12)) return tsip_htype_Content_Type;
+				if(size == 14 && tsk_strniequals(name, "Content-Length", 14)) return tsip_htype_Content_Length;
+				if(size == 16 && tsk_strniequals(name, "Content-Encoding", 16)) return tsip_htype_Content_Encoding;
+				if(size == 16 && tsk_strniequals(name, "Content-Language", 16)) return tsip_htype_Content_Language;
+				if(size == 19 && tsk_strniequals(name, "Content-Disposition", 19)) return tsip_htype_Content_Disposition;
+				break;
+			case 'd':
+				if(size == 1) return tsip_htype_Request_Disposition;
+				if(size == 4 && tsk_strniequals(name, "Date", 4)) return tsip_htype_Date;
+				break;
+			case 'e':
+				if(size == 1) return tsip_htype_Content_Encoding;
+				if(size == 5 && tsk_strniequals(name, "Event", 5)) return tsip_htype_Event;
+				if(size == 7 && tsk_strniequals(name, "Expires", 7)) return tsip_htype_Expires;
+				if(size == 10 && tsk_strniequals(name, "Error-Info", 10)) return tsip_htype_Error_Info;
+				break;
+			case 'f':
+				if(size == 1) return tsip_htype_From;
+				if(size == 4 && tsk_strniequals(name, "From", 4)) return tsip_htype_From;
+				break;
+			case 'h':
+				if(size == 12 && tsk_strniequals(name, "History-Info", 12)) return tsip_htype_History_Info;
+				break;
+			case 'i':
+				if(size == 1) return tsip_htype_Call_ID;
+				if(size == 8 && tsk_strniequals(name, "Identity", 8)) return tsip_htype_Identity;
+				if(size == 11 && tsk_strniequals(name, "In-Reply-To", 11)) return tsip_htype_In_Reply_To;
+				if(size == 13 && tsk_strniequals(name, "Identity-Info", 13)) return tsip_htype_Identity_Info;
+				break;
+			case 'j':
+				if(size == 1) return tsip_htype_Reject_Contact;
+				if(size == 4 && tsk_strniequals(name, "Join", 4)) return tsip_htype_Join;
+				break;
+			case 'k':
+				if(size == 1) return tsip_htype_Supported;
+				break;
+			case 'l':
+				if(size == 1) return tsip_htype_Content_Length;
+				break;
+			case 'm':
+				if(size == 1) return tsip_htype_Contact;
+				if(size == 6 && tsk_strniequals(name, "Min-SE", 6)) return tsip_htype_Min_SE;
+				if(size == 11 && tsk_strniequals(name, "Min-Expires", 11)) return tsip_htype_Min_Expires;
+				if(size == 12 && tsk_strniequals(name, "Max-Forwards", 12)) return tsip_htype_Max_Forwards;
+				if(size == 12 && tsk_strniequals(name, "MIME-Version", 12)) return tsip_htype_MIME_Version;
+				break;
+			case 'n':
+				if(size == 1) return tsip_htype_Identity_Info;
+				break;
+			case 'o':
+				if(size == 1) return tsip_htype_Event;
+				if(size == 12 && tsk_strniequals(name, "Organization", 12)) return tsip_htype_Organization;
+				break;
+			case 'p':
+				if(size == 4 && tsk_strniequals(name, "Path", 4)) return tsip_htype_Path;
+				if(size == 7 && tsk_strniequals(name, "Privacy", 7)) return tsip_htype_Privacy;
+				if(size == 8 && tsk_strniequals(name, "Priority", 8)) return tsip_htype_Priority;
+				if(size == 10 && tsk_strniequals(name, "P-DCS-LAES", 10)) return tsip_htype_P_DCS_LAES;
+				if(size == 10 && tsk_strniequals(name, "P-DCS-OSPS", 10)) return tsip_htype_P_DCS_OSPS;
+				if(size == 13 && tsk_strniequals(name, "P-Early-Media", 13)) return tsip_htype_P_Early_Media;
+				if(size == 13 && tsk_strniequals(name, "P-Profile-Key", 13)) return tsip_htype_P_Profile_Key;
+				if(size == 13 && tsk_strniequals(name, "Proxy-Require", 13)) return tsip_htype_Proxy_Require;
+				if(size == 14 && tsk_strniequals(name, "P-Answer-State", 14)) return tsip_htype_P_Answer_State;
+				if(size == 14 && tsk_strniequals(name, "P-DCS-Redirect", 14)) return tsip_htype_P_DCS_Redirect;
+				if(size == 15 && tsk_strniequals(name, "P-User-Database", 15)) return tsip_htype_P_User_Database;
+				if(size == 16 && tsk_strniequals(name, "P-Associated-URI", 16)) return tsip_htype_P_Associated_URI;
+				if(size == 17 && tsk_strniequals(name, "P-Called-Party-ID", 17)) return tsip_htype_P_Called_Party_ID;
+				if(size == 17 && tsk_strniequals(name, "P-Charging-Vector", 17)) return tsip_htype_P_Charging_Vector;
+				if(size == 18 && tsk_strniequals(name, "P-DCS-Billing-Info", 18)) return tsip_htype_P_DCS_Billing_Info;
+				if(size == 18 && tsk_strniequals(name, "Proxy-Authenticate", 18)) return tsip_htype_Proxy_Authenticate;
+				if(size == 19 && tsk_strniequals(name, "P-Asserted-Identity", 19)) return tsip_htype_P_Asserted_Identity;
+				if(size == 19 && tsk_strniequals(name, "Proxy-Authorization", 19)) return tsip_htype_Proxy_Authorization;
+				if(size == 20 && tsk_strniequals(name, "P-DCS-Trace-Party-ID", 20)) return tsip_htype_P_DCS_Trace_Party_ID;
+				if(size == 20 && tsk_strniequals(name, "P-Preferred-Identity", 20)) return tsip_htype_P_Preferred_Identity;
+				if(size == 20 && tsk_strniequals(name, "P-Visited-Network-ID", 20)) return tsip_htype_P_Visited_Network_ID;
+				if(size == 21 && tsk_strniequals(name, "P-Access-Network-Info", 21)) return tsip_htype_P_Access_Network_Info;
+				if(size == 21 && tsk_strniequals(name, "P-Media-Authorization", 21)) return tsip_htype_P_Media_Authorization;
+				if(size == 29 && tsk_strniequals(name, "P-Charging-Function-Addresses", 29)) return tsip_htype_P_Charging_Function_Addresses;
+				break;
+			case 'r':
+				if(size == 1) return tsip_htype_Refer_To;
+				if(size == 4 && tsk_strniequals(name, "RAck", 4)) return tsip_htype_RAck;
+				if(size == 4 && tsk_strniequals(name, "RSeq", 4)) return tsip_htype_RSeq;
+				if(size == 5 && tsk_strniequals(name, "Route", 5)) return tsip_htype_Route;
+				if(size == 6 && tsk_strniequals(name, "Reason", 6)) return tsip_htype_Reason;
+				if(size == 7 && tsk_strniequals(name, "Require", 7)) return tsip_htype_Require;
+				if(size == 8 && tsk_strniequals(name, "Refer-To", 8)) return tsip_htype_Refer_To;
+				if(size == 8 && tsk_strniequals(name, "Replaces", 8)) return tsip_htype_Replaces;
+				if(size == 8 && tsk_strniequals(name, "Reply-To", 8)) return tsip_htype_Reply_To;
+				if(size == 9 && tsk_strniequals(name, "Refer-Sub", 9)) return tsip_htype_Refer_Sub;
+				if(size == 11 && tsk_strniequals(name, "Referred-By", 11)) return tsip_htype_Referred_By;
+				if(size == 11 && tsk_strniequals(name, "Retry-After", 11)) return tsip_htype_Retry_After;
+				if(size == 12 && tsk_strniequals(name, "Record-Route", 12)) return tsip_htype_Record_Route;
+				if(size == 14 && tsk_strniequals(name, "Reject-Contact", 14)) return tsip_htype_Reject_Contact;
+				if(size == 17 && tsk_strniequals(name, "Resource-Priority", 17)) return tsip_htype_Resource_Priority;
+				if(size == 19 && tsk_strniequals(name, "Request-Disposition", 19)) return tsip_htype_Request_Disposition;
+				break;
+			case 's':
+				if(size == 1) return tsip_htype_Subject;
+				if(size == 6 && tsk_strniequals(name, "Server", 6)) return tsip_htype_Server;
+				if(size == 7 && tsk_strniequals(name, "Subject", 7)) return tsip_htype_Subject;
+				if(size == 8 && tsk_strniequals(name, "SIP-ETag", 8)) return tsip_htype_SIP_ETag;
+				if(size == 9 && tsk_strniequals(name, "Supported", 9)) return tsip_htype_Supported;
+				if(size == 12 && tsk_strniequals(name, "SIP-If-Match", 12)) return tsip_htype_SIP_If_Match;
+				if(size == 13 && tsk_strniequals(name, "Service-Route", 13)) return tsip_htype_Service_Route;
+				if(size == 15 && tsk_strniequals(name, "Security-Client", 15)) return tsip_htype_Security_Client;
+				if(size == 15 && tsk_strniequals(name, "Security-Server", 15)) return tsip_htype_Security_Server;
+				if(size == 15 && tsk_strniequals(name, "Security-Verify", 15)) return tsip_htype_Security_Verify;
+				if(size == 15 && tsk_strniequals(name, "Session-Expires", 15)) return tsip_htype_Session_Expires;
+				if(size == 18 && tsk_strniequals(name, "Subscription-State", 18)) return tsip_htype_Subscription_State;
+				break;
+			case 't':
+				if(size == 1) return tsip_htype_To;
+				if(size == 2 && tsk_strniequals(name, "To", 2)) return tsip_htype_To;
+				if(size == 9 && tsk_strniequals(name, "Timestamp", 9)) return tsip_htype_Timestamp;
+				if(size == 13 && tsk_strniequals(name, "Target-Dialog", 13)) return tsip_htype_Target_Dialog;
+				break;
+			case 'u':
+				if(size == 1) return tsip_htype_Allow_Events;
+				if(size == 10 && tsk_strniequals(name, "User-Agent", 10)) return tsip_htype_User_Agent;
+				if(size == 11 && tsk_strniequals(name, "Unsupported", 11)) return tsip_htype_Unsupported;
+				break;
+			case 'v':
+				if(size == 1) return tsip_htype_Via;
+				if(size == 3 && tsk_strniequals(name, "Via", 3)) return tsip_htype_Via;
+				break;
+			case 'w':
+				if(size == 7 && tsk_strniequals(name, "Warning", 7)) return tsip_htype_Warning;
+				if(size == 16 && tsk_strniequals(name, "WWW-Authenticate", 16)) return tsip_htype_WWW_Authenticate;
+				break;
+			case 'x':
+				if(size == 1) return tsip_htype_Session_Expires;
+				break;
+			case 'y':
+				if(size == 1) return tsip_htype_Identity;
+				break;
+		}
+	}
+	return tsip_htype_Dummy;
+}
+
 char tsip_header_get_param_separator(const tsip_header_t *self)
 {
 	if(self)
@@ -246,17 +425,16 @@ char tsip_header_get_param_separator(const tsip_header_t *self)
 int tsip_header_serialize(const tsip_header_t *self, tsk_buffer_t *output)
 {
 	int ret = -1;
-	static const char* hname;
-	static char separator;
+	char separator;
 
 	if(self && TSIP_HEADER(self)->serialize){
 		tsk_list_item_t *item;
 		
-		hname = tsip_header_get_name_2(self);
 		ret = 0; // for empty lists
 
 		/* Header name */
-		tsk_buffer_append_2(output, "%s: ", hname);
+		tsk_buffer_append_str(output, tsip_header_get_name_2(self));
+		tsk_buffer_append(output, ": ", 2);
 
 		/*  Header value (likes calling tsip_header_value_serialize() ) */
 		if((ret = TSIP_HEADER(self)->serialize(self, output))){
@@ -265,10 +443,13 @@ int tsip_header_serialize(const tsip_header_t *self, tsk_buffer_t *output)
 		}
 
 		/* Parameters */
+		separator = tsip_header_get_param_separator(self);
 		tsk_list_foreach(item, self->params){
 			tsk_param_t* param = item->data;
-			separator = tsip_header_get_param_separator(self);
-			if((ret = tsk_buffer_append_2(output, param->value?"%c%s=%s":"%c%s", separator, param->name, param->value))){
+			if((ret = tsk_buffer_append(output, &separator, 1)) || (ret = tsk_buffer_append_str(output, param->name))){
+				return ret;
+			}
+			if(param->value && ((ret = tsk_buffer_append(output, "=", 1)) || (ret = tsk_buffer_append_str(output, param->value)))){
 				return ret;
 			}
 		}
@@ -335,3 +516,45 @@ char* tsip_header_get_param_value(const tsip_header_t *self, const char* pname)
 	
 	return tsk_null;
 }
+
+/**@ingroup tsip_header_group
+* Copies a header out of the arena of the message it was received with (see @ref tsip_message_parse_2()). Must be used
+* for the headers outliving their message (e.g. dialog's route set) otherwise they keep the whole arena alive.
+* @param self The header to copy.
+* @retval New reference to @a self if it's allocated on the heap and a heap copy otherwise.
+*/
+tsip_header_t* tsip_header_copyout(const tsip_header_t *self)
+{
+	tsip_header_t* copy = tsk_null;
+	tsip_message_t* message = tsk_null;
+	tsk_buffer_t* output = tsk_null;
+	tsk_ragel_state_t state;
+	tsk_arena_t* previous;
+
+	if(!self){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return tsk_null;
+	}
+	if(!tsk_arena_of(self)){
+		return tsk_object_ref((tsk_object_t*)self);
+	}
+
+	/* serialize then parse the header again into a heap-allocated message */
+	previous = tsk_arena_push(tsk_null);
+	if((output = tsk_buffer_create_null()) && (message = tsip_message_create()) && tsip_header_serialize(self, output) == 0){
+		tsk_ragel_state_init(&state, output->data, output->size);
+		state.tag_start = state.p;
+		state.tag_end = state.pe;
+		if(tsip_header_parse(&state, message)){
+			copy = tsk_object_ref((tsk_object_t*)tsip_message_get_header(message, self->type));
+		}
+	}
+	tsk_arena_pop(previous);
+	if(!copy){
+		TSK_DEBUG_ERROR("Failed to copy '%s' header", tsip_header_get_name_2(self));
+	}
+
+	TSK_OBJECT_SAFE_FREE(output);
+	TSK_OBJECT_SAFE_FREE(message);
+	return copy;
+}
@@ -55,7 +55,11 @@ int tsip_header_CSeq_serialize(const tsip_header_t* header, tsk_buffer_t* output
 {
 	if(header){
 		const tsip_header_CSeq_t *CSeq = (const tsip_header_CSeq_t *)header;
-		return tsk_buffer_append_2(output, "%u %s", CSeq->seq, CSeq->method);
+		int ret;
+		if((ret = tsk_buffer_append_int(output, CSeq->seq)) || (ret = tsk_buffer_append(output, " ", 1))){
+			return ret;
+		}
+		return tsk_buffer_append_str(output, CSeq->method);
 	}
 	return -1;
 }
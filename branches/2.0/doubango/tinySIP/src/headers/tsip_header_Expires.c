@@ -55,7 +55,7 @@ int tsip_header_Expires_serialize(const tsip_header_t* header, tsk_buffer_t* out
 	if(header){
 		const tsip_header_Expires_t *Expires = (const tsip_header_Expires_t *)header;
 		if(Expires->delta_seconds >=0){
-			return tsk_buffer_append_2(output, "%lld", Expires->delta_seconds);
+			return tsk_buffer_append_int(output, Expires->delta_seconds);
 		}
 		return 0;
 	}
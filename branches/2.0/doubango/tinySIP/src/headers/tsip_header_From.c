@@ -62,7 +62,9 @@ int tsip_header_From_serialize(const tsip_header_t* header, tsk_buffer_t* output
 			return ret;
 		}
 		if(From->tag){
-			ret = tsk_buffer_append_2(output, ";tag=%s", From->tag);
+			if(!(ret = tsk_buffer_append(output, ";tag=", 5))){
+				ret = tsk_buffer_append_str(output, From->tag);
+			}
 		}
 	}
 	return ret;
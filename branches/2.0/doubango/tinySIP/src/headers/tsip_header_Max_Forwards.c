@@ -56,7 +56,7 @@ int tsip_header_Max_Forwards_serialize(const tsip_header_t* header, tsk_buffer_t
 	if(header){
 		const tsip_header_Max_Forwards_t *Max_Forwards = (const tsip_header_Max_Forwards_t *)header;
 		if(Max_Forwards->value >= 0){
-			return tsk_buffer_append_2(output, "%d", Max_Forwards->value);
+			return tsk_buffer_append_int(output, Max_Forwards->value);
 		}
 		return 0;
 	}
@@ -57,56 +57,57 @@ int tsip_header_Via_serialize(const tsip_header_t* header, tsk_buffer_t* output)
 {
 	if(header){
 		const tsip_header_Via_t *Via = (const tsip_header_Via_t *)header;
-		tsk_istr_t port, rport, ttl;
 		int ipv6 = (Via->host && tsk_strcontains(Via->host, tsk_strlen(Via->host), ":"));
+		int ret;
 
-		if(Via->port){
-			tsk_itoa(Via->port, &port);
+		/* SIP/2.0/UDP [::]:1988;test=1234;comp=sigcomp;rport=254;ttl=457;received=192.0.2.101;branch=z9hG4bK1245420841406\r\n" */
+		if((ret = tsk_buffer_append_str(output, Via->proto_name ? Via->proto_name : "SIP")) || (ret = tsk_buffer_append(output, "/", 1))
+			|| (ret = tsk_buffer_append_str(output, Via->proto_version ? Via->proto_version : "2.0")) || (ret = tsk_buffer_append(output, "/", 1))
+			|| (ret = tsk_buffer_append_str(output, Via->transport ? Via->transport : "UDP")) || (ret = tsk_buffer_append(output, " ", 1))){
+			return ret;
 		}
-		if(Via->rport){
-			tsk_itoa(Via->rport, &rport);
+
+		if((ipv6 && (ret = tsk_buffer_append(output, "[", 1)))
+			|| (ret = tsk_buffer_append_str(output, Via->host ? Via->host : "127.0.0.1"))
+			|| (ipv6 && (ret = tsk_buffer_append(output, "]", 1)))){
+			return ret;
 		}
-		if(Via->ttl){
-			tsk_itoa(Via->ttl, &ttl);
+		if(Via->port && ((ret = tsk_buffer_append(output, ":", 1)) || (ret = tsk_buffer_append_int(output, Via->port)))){
+			return ret;
 		}
 
-		/* SIP/2.0/UDP [::]:1988;test=1234;comp=sigcomp;rport=254;ttl=457;received=192.0.2.101;branch=z9hG4bK1245420841406\r\n" */
-		return tsk_buffer_append_2(output, "%s/%s/%s %s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s",
-
-			Via->proto_name ? Via->proto_name : "SIP",
-
-			Via->proto_version ? Via->proto_version : "2.0",
-
-			Via->transport ? Via->transport : "UDP",
-
-			ipv6 ? "[" : "",
-			Via->host ? Via->host : "127.0.0.1",
-			ipv6 ? "]" : "",
-
-			Via->port ? ":" : "",
-			Via->port ? port : "",
-
-			Via->maddr ? ";maddr=" : "",
-			Via->maddr ? Via->maddr : "",
-
-			Via->sigcomp_id ? ";sigcomp-id=" : "",
-			Via->sigcomp_id ? Via->sigcomp_id : "",
-
-			Via->comp ? ";comp=" : "",
-			Via->comp ? Via->comp : "",
-
-			Via->rport>=0 ? (Via->rport>0?";rport=":";rport") : "",
-			Via->rport>0 ? rport : "",
-
-			Via->ttl>=0 ? (Via->ttl>0?";ttl=":";ttl") : "",
-			Via->ttl>0 ? ttl : "",
-
-			Via->received ? ";received=" : "",
-			Via->received ? Via->received : "",
-
-			Via->branch ? ";branch=" : "",
-			Via->branch ? Via->branch : ""
-			);
+		if(Via->maddr && ((ret = tsk_buffer_append(output, ";maddr=", 7)) || (ret = tsk_buffer_append_str(output, Via->maddr)))){
+			return ret;
+		}
+		if(Via->sigcomp_id && ((ret = tsk_buffer_append(output, ";sigcomp-id=", 12)) || (ret = tsk_buffer_append_str(output, Via->sigcomp_id)))){
+			return ret;
+		}
+		if(Via->comp && ((ret = tsk_buffer_append(output, ";comp=", 6)) || (ret = tsk_buffer_append_str(output, Via->comp)))){
+			return ret;
+		}
+		if(Via->rport > 0){
+			if((ret = tsk_buffer_append(output, ";rport=", 7)) || (ret = tsk_buffer_append_int(output, Via->rport))){
+				return ret;
+			}
+		}
+		else if(Via->rport == 0 && (ret = tsk_buffer_append(output, ";rport", 6))){
+			return ret;
+		}
+		if(Via->ttl > 0){
+			if((ret = tsk_buffer_append(output, ";ttl=", 5)) || (ret = tsk_buffer_append_int(output, Via->ttl))){
+				return ret;
+			}
+		}
+		else if(Via->ttl == 0 && (ret = tsk_buffer_append(output, ";ttl", 4))){
+			return ret;
+		}
+		if(Via->received && ((ret = tsk_buffer_append(output, ";received=", 10)) || (ret = tsk_buffer_append_str(output, Via->received)))){
+			return ret;
+		}
+		if(Via->branch && ((ret = tsk_buffer_append(output, ";branch=", 8)) || (ret = tsk_buffer_append_str(output, Via->branch)))){
+			return ret;
+		}
+		return 0;
 	}
 	return -1;
 }
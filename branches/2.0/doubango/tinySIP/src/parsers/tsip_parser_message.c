@@ -37,7 +37,7 @@
 #include "tsk_debug.h"
 #include "tsk_memory.h"
 
-static void tsip_message_parser_execute(tsk_ragel_state_t *state, tsip_message_t *message, tsk_bool_t extract_content);
+static void tsip_message_parser_execute(tsk_ragel_state_t *state, tsip_message_t *message, tsk_bool_t extract_content, tsk_bool_t lazy);
 static void tsip_message_parser_init(tsk_ragel_state_t *state);
 static void tsip_message_parser_eoh(tsk_ragel_state_t *state, tsip_message_t *message, tsk_bool_t extract_content);
 
@@ -50,7 +50,7 @@ static void tsip_message_parser_eoh(tsk_ragel_state_t *state, tsip_message_t *me
 *	Ragel state machine.
 */
 
-/* #line 187 "./ragel/tsip_parser_message.rl" */
+/* #line 190 "./ragel/tsip_parser_message.rl" */
 
 
 
@@ -195,11 +195,23 @@ static const int tsip_machine_parser_message_error = 0;
 static const int tsip_machine_parser_message_en_main = 1;
 
 
-/* #line 192 "./ragel/tsip_parser_message.rl" */
+/* #line 195 "./ragel/tsip_parser_message.rl" */
 
 
 tsk_bool_t tsip_message_parse(tsk_ragel_state_t *state, tsip_message_t **result, tsk_bool_t extract_content)
 {
+	return tsip_message_parse_2(state, result, extract_content, tsk_false, tsk_false);
+}
+
+/** Parses a SIP message.
+* @param lazy Whether to only parse the headers the stack needs to route the message (Via, From, To, Call-ID, CSeq, Contact,
+* Expires and Content-*). The other ones are kept as received and parsed when a getter asks for them.
+* @param arena Whether to carve the headers, URIs and parameters from a per-message arena (see @ref tsk_arena_push()).
+*/
+tsk_bool_t tsip_message_parse_2(tsk_ragel_state_t *state, tsip_message_t **result, tsk_bool_t extract_content, tsk_bool_t lazy, tsk_bool_t arena)
+{
+	tsk_arena_t* previous;
+
 	if(!state || state->pe <= state->p){
 		return tsk_false;
 	}
@@ -207,6 +219,9 @@ tsk_bool_t tsip_message_parse(tsk_ragel_state_t *state, tsip_message_t **result,
 	if(!*result){
 		*result = tsip_message_create();
 	}
+	if(arena && *result && !(*result)->arena){
+		(*result)->arena = tsk_arena_create(TSIP_MESSAGE_ARENA_CHUNK_SIZE);
+	}
 
 	/* Ragel init */
 	tsip_message_parser_init(state);
@@ -214,14 +229,16 @@ tsk_bool_t tsip_message_parse(tsk_ragel_state_t *state, tsip_message_t **result,
 	/*
 	*	State mechine execution.
 	*/
-	tsip_message_parser_execute(state, *result, extract_content);
+	previous = tsk_arena_push((*result)->arena);
+	tsip_message_parser_execute(state, *result, extract_content, lazy);
+	tsk_arena_pop(previous);
 
 	/* Check result */
 
 	if( state->cs < 
-/* #line 223 "./src/parsers/tsip_parser_message.c" */
+/* #line 231 "./src/parsers/tsip_parser_message.c" */
 37
-/* #line 214 "./ragel/tsip_parser_message.rl" */
+/* #line 234 "./ragel/tsip_parser_message.rl" */
  )
 	{
 		TSK_DEBUG_ERROR("Failed to parse SIP message: %s", state->p);
@@ -238,17 +255,17 @@ static void tsip_message_parser_init(tsk_ragel_state_t *state)
 
 	/* Regel machine initialization. */
 	
-/* #line 242 "./src/parsers/tsip_parser_message.c" */
+/* #line 250 "./src/parsers/tsip_parser_message.c" */
 	{
 	cs = tsip_machine_parser_message_start;
 	}
 
-/* #line 230 "./ragel/tsip_parser_message.rl" */
+/* #line 250 "./ragel/tsip_parser_message.rl" */
 	
 	state->cs = cs;
 }
 
-static void tsip_message_parser_execute(tsk_ragel_state_t *state, tsip_message_t *message, tsk_bool_t extract_content)
+static void tsip_message_parser_execute(tsk_ragel_state_t *state, tsip_message_t *message, tsk_bool_t extract_content, tsk_bool_t lazy)
 {
 	int cs = state->cs;
 	const char *p = state->p;
@@ -256,7 +273,7 @@ static void tsip_message_parser_execute(tsk_ragel_state_t *state, tsip_message_t
 	const char *eof = state->eof;
 
 	
-/* #line 260 "./src/parsers/tsip_parser_message.c" */
+/* #line 268 "./src/parsers/tsip_parser_message.c" */
 	{
 	int _klen;
 	unsigned int _trans;
@@ -459,7 +476,10 @@ _match:
 		state->tag_end = p;
 		len = (int)(state->tag_end  - state->tag_start);
 		
-		if(tsip_header_parse(state, message)){
+		if(lazy && tsip_message_defer_header(message, state->tag_start, (tsk_size_t)len, (tsk_size_t)(pe - state->tag_start)) == 0){
+			/* will be parsed when requested (see tsip_message_get_headerAt()) */
+		}
+		else if(tsip_header_parse(state, message)){
 			//TSK_DEBUG_INFO("TSIP_MESSAGE_PARSER::PARSE_HEADER len=%d state=%d", len, state->cs);
 		}
 		else{
@@ -468,7 +488,7 @@ _match:
 	}
 	break;
 	case 7:
-/* #line 167 "./ragel/tsip_parser_message.rl" */
+/* #line 170 "./ragel/tsip_parser_message.rl" */
 	{
 		state->cs = cs;
 		state->p = p;
@@ -483,7 +503,7 @@ _match:
 		eof = state->eof;
 	}
 	break;
-/* #line 487 "./src/parsers/tsip_parser_message.c" */
+/* #line 495 "./src/parsers/tsip_parser_message.c" */
 		}
 	}
 
@@ -496,7 +516,7 @@ _again:
 	_out: {}
 	}
 
-/* #line 242 "./ragel/tsip_parser_message.rl" */
+/* #line 262 "./ragel/tsip_parser_message.rl" */
 
 	state->cs = cs;
 	state->p = p;
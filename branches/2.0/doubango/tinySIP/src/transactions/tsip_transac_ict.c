@@ -78,6 +78,7 @@
 
  */
 #include "tinysip/transactions/tsip_transac_ict.h"
+#include "tinysip/transactions/tsip_transac_layer.h"
 
 #include "tsk_debug.h"
 
@@ -362,6 +363,9 @@ int tsip_transac_ict_start(tsip_transac_ict_t *self, const tsip_request_t* reque
 			tsk_strcat_2(&(TSIP_TRANSAC(self)->branch), "-%s", branch);
 		}
 
+		/* responses are matched using the branch */
+		tsip_transac_layer_index_branch(TSIP_TRANSAC_GET_STACK(self)->layer_transac, TSIP_TRANSAC(self));
+
 		TSIP_TRANSAC(self)->running = 1;
 		self->request = tsk_object_ref((void*)request);
 
@@ -894,12 +898,8 @@ static tsk_object_t* tsip_transac_ict_dtor(tsk_object_t * _self)
 	tsip_transac_ict_t *self = _self;
 	if(self){
 		/* Cancel timers */
-		if(!TSIP_TRANSAC(self)->reliable){
-			TRANSAC_TIMER_CANCEL(A);
-		}
-		TRANSAC_TIMER_CANCEL(B);
-		TRANSAC_TIMER_CANCEL(D);
-		TRANSAC_TIMER_CANCEL(M);
+		tsk_timer_id_t timers[] = { (TSIP_TRANSAC(self)->reliable ? TSK_INVALID_TIMER_ID : self->timerA.id), self->timerB.id, self->timerD.id, self->timerM.id };
+		TRANSAC_TIMERS_CANCEL(timers);
 
 		TSIP_TRANSAC(self)->running = tsk_false;
 		TSK_OBJECT_SAFE_FREE(self->request);
@@ -789,13 +789,8 @@ static tsk_object_t* tsip_transac_ist_dtor(tsk_object_t * _self)
 	if(self)
 	{
 		/* Cancel timers */
-		TRANSAC_TIMER_CANCEL(H);
-		TRANSAC_TIMER_CANCEL(I);
-		if(!TSIP_TRANSAC(self)->reliable){
-			TRANSAC_TIMER_CANCEL(G);
-		}
-		TRANSAC_TIMER_CANCEL(L);
-		TRANSAC_TIMER_CANCEL(X);
+		tsk_timer_id_t timers[] = { self->timerH.id, self->timerI.id, (TSIP_TRANSAC(self)->reliable ? TSK_INVALID_TIMER_ID : self->timerG.id), self->timerL.id, self->timerX.id };
+		TRANSAC_TIMERS_CANCEL(timers);
 
 		TSIP_TRANSAC(self)->running = tsk_false;
 		TSK_OBJECT_SAFE_FREE(self->lastResponse);
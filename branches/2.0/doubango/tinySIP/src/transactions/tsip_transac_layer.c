@@ -35,8 +35,73 @@
 #include "tinysip/transactions/tsip_transac_nist.h"
 
 #include "tsk_string.h"
+#include "tsk_memory.h"
 #include "tsk_debug.h"
 
+#define _tsip_transac_layer_bucket(self, str) (tsk_strhash((str)) & ((self)->buckets_count - 1))
+
+/* appends at the tail to keep the creation order within a bucket (oldest transaction matches first, as with the list) */
+static void _tsip_transac_layer_chain_append(tsip_transac_t** head, tsip_transac_t* transac, tsk_bool_t branch)
+{
+	while(*head){
+		head = branch ? &(*head)->branch_next : &(*head)->callid_next;
+	}
+	*head = transac;
+}
+
+/* returns whether the transaction was found */
+static tsk_bool_t _tsip_transac_layer_chain_remove(tsip_transac_t** head, const tsip_transac_t* transac, tsk_bool_t branch)
+{
+	while(*head){
+		if(*head == transac){
+			*head = branch ? transac->branch_next : transac->callid_next;
+			return tsk_true;
+		}
+		head = branch ? &(*head)->branch_next : &(*head)->callid_next;
+	}
+	return tsk_false;
+}
+
+/* the branch of a client transaction is only known when it starts: not indexed by branch until then */
+static void _tsip_transac_layer_index(tsip_transac_layer_t* self, tsip_transac_t* transac)
+{
+	transac->branch_next = transac->callid_next = tsk_null;
+	if((transac->branch_indexed = (transac->branch != tsk_null))){
+		_tsip_transac_layer_chain_append(&self->branch_buckets[_tsip_transac_layer_bucket(self, transac->branch)], transac, tsk_true);
+	}
+	_tsip_transac_layer_chain_append(&self->callid_buckets[_tsip_transac_layer_bucket(self, transac->callid)], transac, tsk_false);
+}
+
+static int _tsip_transac_layer_buckets_alloc(tsip_transac_layer_t* self, tsk_size_t count)
+{
+	tsip_transac_t** branch_buckets = tsk_calloc(count, sizeof(tsip_transac_t*));
+	tsip_transac_t** callid_buckets = tsk_calloc(count, sizeof(tsip_transac_t*));
+	if(!branch_buckets || !callid_buckets){
+		TSK_DEBUG_ERROR("Failed to allocate %u buckets", (unsigned)count);
+		TSK_FREE(branch_buckets);
+		TSK_FREE(callid_buckets);
+		return -1;
+	}
+	TSK_FREE(self->branch_buckets);
+	TSK_FREE(self->callid_buckets);
+	self->branch_buckets = branch_buckets;
+	self->callid_buckets = callid_buckets;
+	self->buckets_count = count;
+	return 0;
+}
+
+/* doubles the number of buckets and rebuilds the indexes from the list (creation order) */
+static void _tsip_transac_layer_grow(tsip_transac_layer_t* self)
+{
+	tsip_transac_t* transac;
+	if(_tsip_transac_layer_buckets_alloc(self, self->buckets_count << 1) == 0){
+		for(transac = self->head; transac; transac = transac->layer_next){
+			_tsip_transac_layer_index(self, transac);
+		}
+	}
+	/* otherwise, keep the current buckets (longer chains) */
+}
+
 tsip_transac_layer_t* tsip_transac_layer_create(tsip_stack_t* stack)
 {
 	return tsk_object_new(tsip_transac_layer_def_t, stack);
@@ -83,7 +148,20 @@ tsip_transac_t* tsip_transac_layer_new(const tsip_transac_layer_t *self, tsk_boo
 			/* Add new transaction */
 			if(transac){
 				ret = tsk_object_ref(transac);
-				tsk_list_push_back_data(self->transactions, (void**)&transac);
+				_tsip_transac_layer_index(TSIP_TRANSAC_LAYER(self), transac);
+				/* the list takes the reference */
+				if((transac->layer_prev = self->tail)){
+					transac->layer_prev->layer_next = transac;
+				}
+				else{
+					TSIP_TRANSAC_LAYER(self)->head = transac;
+				}
+				transac->layer_next = tsk_null;
+				TSIP_TRANSAC_LAYER(self)->tail = transac;
+				transac = tsk_null;
+				if(++TSIP_TRANSAC_LAYER(self)->count > self->buckets_count){
+					_tsip_transac_layer_grow(TSIP_TRANSAC_LAYER(self));
+				}
 			}
 		}
 	}
@@ -97,7 +175,29 @@ int tsip_transac_layer_remove(tsip_transac_layer_t *self, const tsip_transac_t *
 {
 	if(transac && self){
 		tsk_safeobj_lock(self);
-		tsk_list_remove_item_by_data(self->transactions, transac);
+		/* only transactions owned by the layer are in the Call-ID index */
+		if(_tsip_transac_layer_chain_remove(&self->callid_buckets[_tsip_transac_layer_bucket(self, transac->callid)], transac, tsk_false)){
+			tsip_transac_t* removed = (tsip_transac_t*)transac;
+			if(transac->branch_indexed){
+				_tsip_transac_layer_chain_remove(&self->branch_buckets[_tsip_transac_layer_bucket(self, transac->branch)], transac, tsk_true);
+			}
+			if(removed->layer_prev){
+				removed->layer_prev->layer_next = removed->layer_next;
+			}
+			else{
+				self->head = removed->layer_next;
+			}
+			if(removed->layer_next){
+				removed->layer_next->layer_prev = removed->layer_prev;
+			}
+			else{
+				self->tail = removed->layer_prev;
+			}
+			removed->layer_prev = removed->layer_next = removed->branch_next = removed->callid_next = tsk_null;
+			removed->branch_indexed = tsk_false;
+			--self->count;
+			TSK_OBJECT_SAFE_FREE(removed);
+		}
 		tsk_safeobj_unlock(self);
 
 		return 0;
@@ -106,10 +206,27 @@ int tsip_transac_layer_remove(tsip_transac_layer_t *self, const tsip_transac_t *
 	return -1;
 }
 
+/** Indexes a client transaction by branch. Must be called as soon as the branch is set (when the transaction starts) and before sending the request. */
+int tsip_transac_layer_index_branch(tsip_transac_layer_t *self, tsip_transac_t *transac)
+{
+	if(!self || !transac || !transac->branch){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	tsk_safeobj_lock(self);
+	if(!transac->branch_indexed && (transac->layer_prev || self->head == transac)){ /* owned by the layer */
+		transac->branch_next = tsk_null;
+		transac->branch_indexed = tsk_true;
+		_tsip_transac_layer_chain_append(&self->branch_buckets[_tsip_transac_layer_bucket(self, transac->branch)], transac, tsk_true);
+	}
+	tsk_safeobj_unlock(self);
+	return 0;
+}
+
 /* cancel all transactions related to this dialog */
 int tsip_transac_layer_cancel_by_dialog(tsip_transac_layer_t *self, const struct tsip_dialog_s* dialog)
 {
-	tsk_list_item_t *item;
+	tsip_transac_t *transac;
 	int ret = 0; /* Perhaps there is zero transaction */
 
 
@@ -120,9 +237,9 @@ int tsip_transac_layer_cancel_by_dialog(tsip_transac_layer_t *self, const struct
 	
 	tsk_safeobj_lock(self);
 again:
-	tsk_list_foreach(item, self->transactions){
-		if(tsk_object_cmp(dialog, TSIP_TRANSAC_GET_DIALOG(item->data)) == 0){
-			if((ret = tsip_transac_fsm_act(TSIP_TRANSAC(item->data), tsip_atype_cancel, tsk_null))){ /* will call tsip_transac_layer_remove() if succeed */
+	for(transac = self->head; transac; transac = transac->layer_next){
+		if(tsk_object_cmp(dialog, TSIP_TRANSAC_GET_DIALOG(transac)) == 0){
+			if((ret = tsip_transac_fsm_act(transac, tsip_atype_cancel, tsk_null))){ /* will call tsip_transac_layer_remove() if succeed */
 				/* break; */
 			}
 			else{
@@ -160,7 +277,6 @@ tsip_transac_t* tsip_transac_layer_find_client(const tsip_transac_layer_t *self,
 	*/
 	tsip_transac_t *ret = tsk_null;
 	tsip_transac_t *transac;
-	tsk_list_item_t *item;
 
 	/*	Check first Via/CSeq validity.
 	*/
@@ -170,8 +286,7 @@ tsip_transac_t* tsip_transac_layer_find_client(const tsip_transac_layer_t *self,
 
 	tsk_safeobj_lock(self);
 
-	tsk_list_foreach(item, self->transactions){
-		transac = item->data;
+	for(transac = self->branch_buckets[_tsip_transac_layer_bucket(self, response->firstVia->branch)]; transac; transac = transac->branch_next){
 		if( tsk_strequals(transac->branch, response->firstVia->branch) 
 			&& tsk_strequals(transac->cseq_method, response->CSeq->method)
 			)
@@ -215,7 +330,8 @@ tsip_transac_t* tsip_transac_layer_find_server(const tsip_transac_layer_t *self,
 	*/
 	tsip_transac_t *ret = tsk_null;
 	tsip_transac_t *transac;
-	tsk_list_item_t *item;
+	tsk_bool_t is_ack;
+	const char* callid;
 	//const char* sent_by;
 
 	/*	Check first Via/CSeq validity */
@@ -223,29 +339,39 @@ tsip_transac_t* tsip_transac_layer_find_server(const tsip_transac_layer_t *self,
 		return tsk_null;
 	}
 
+	is_ack = TSIP_REQUEST_IS_ACK(message);
+	callid = message->Call_ID ? message->Call_ID->value : tsk_null;
+
 	tsk_safeobj_lock(self);
 
-	tsk_list_foreach(item, self->transactions){
-		transac = item->data;
-		if(TSIP_REQUEST_IS_ACK(message) && tsk_strequals(transac->callid, message->Call_ID->value)){ /* 1. ACK branch won't match INVITE's but they MUST have the same CSeq/CallId values */
+	if(is_ack){ /* 1. ACK branch won't match INVITE's but they MUST have the same CSeq/CallId values */
+		for(transac = self->callid_buckets[_tsip_transac_layer_bucket(self, callid)]; transac; transac = transac->callid_next){
 			// [transac->type == tsip_transac_type_ist] is used to avoid looping in webrtc2sip mode (e.g. browser <->(breaker)<->browser)
 			// (browser-1) -> INVITE -> (breaker) -> INVITE - (server) -> INVITE -> (breaker) -> (browser-2)
 			// the breaker will have two transactions (IST and ICT) with same cseq value and call-id (if not changed by the server)
-			if(transac->type == tsip_transac_type_ist && tsk_striequals(transac->cseq_method, "INVITE") && message->CSeq->seq == transac->cseq_value){
+			if(tsk_strequals(transac->callid, callid) && transac->type == tsip_transac_type_ist && tsk_striequals(transac->cseq_method, "INVITE") && message->CSeq->seq == transac->cseq_value){
 				ret = tsk_object_ref(transac);
 				break;
 			}
 		}
-		else if(tsk_strequals(transac->branch, message->firstVia->branch) /* 2. Compare branches*/
-			&& (1 == 1) /* FIXME: compare host:ip */
-			){
-			if(tsk_strequals(transac->cseq_method, message->CSeq->method)){
-				ret = tsk_object_ref(transac);
-				break;
+	}
+
+	if(!ret){
+		for(transac = self->branch_buckets[_tsip_transac_layer_bucket(self, message->firstVia->branch)]; transac; transac = transac->branch_next){
+			if(is_ack && tsk_strequals(transac->callid, callid)){
+				continue; /* same Call-ID: only matched using the rule above */
 			}
-			else if(TSIP_REQUEST_IS_CANCEL(message) || TSIP_RESPONSE_IS_TO_CANCEL(message)){
-				ret = tsk_object_ref(transac);
-				break;
+			if(tsk_strequals(transac->branch, message->firstVia->branch) /* 2. Compare branches*/
+				&& (1 == 1) /* FIXME: compare host:ip */
+				){
+				if(tsk_strequals(transac->cseq_method, message->CSeq->method)){
+					ret = tsk_object_ref(transac);
+					break;
+				}
+				else if(TSIP_REQUEST_IS_CANCEL(message) || TSIP_RESPONSE_IS_TO_CANCEL(message)){
+					ret = tsk_object_ref(transac);
+					break;
+				}
 			}
 		}
 	}
@@ -317,9 +443,11 @@ static tsk_object_t* tsip_transac_layer_ctor(tsk_object_t * self, va_list * app)
 	tsip_transac_layer_t *layer = self;
 	if(layer){
 		layer->stack = va_arg(*app, const tsip_stack_handle_t *);
-		layer->transactions = tsk_list_create();
-
 		tsk_safeobj_init(layer);
+
+		if(_tsip_transac_layer_buckets_alloc(layer, TSIP_TRANSAC_LAYER_BUCKETS_MIN) != 0){
+			return tsk_null;
+		}
 	}
 	return self;
 }
@@ -328,7 +456,14 @@ static tsk_object_t* tsip_transac_layer_dtor(tsk_object_t * self)
 { 
 	tsip_transac_layer_t *layer = self;
 	if(layer){
-		TSK_OBJECT_SAFE_FREE(layer->transactions);
+		tsip_transac_t *transac;
+		while((transac = layer->head)){
+			layer->head = transac->layer_next;
+			transac->layer_prev = transac->layer_next = tsk_null;
+			TSK_OBJECT_SAFE_FREE(transac);
+		}
+		TSK_FREE(layer->branch_buckets);
+		TSK_FREE(layer->callid_buckets);
 
 		tsk_safeobj_deinit(layer);
 
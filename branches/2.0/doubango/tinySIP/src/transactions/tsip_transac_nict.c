@@ -71,6 +71,7 @@
  *
  */
 #include "tinysip/transactions/tsip_transac_nict.h"
+#include "tinysip/transactions/tsip_transac_layer.h"
 
 #include "tsk_debug.h"
 
@@ -326,6 +327,9 @@ int tsip_transac_nict_start(tsip_transac_nict_t *self, const tsip_request_t* req
 			tsk_strcat_2(&(TSIP_TRANSAC(self)->branch), "-%s", branch);
 		}
 
+		/* responses are matched using the branch */
+		tsip_transac_layer_index_branch(TSIP_TRANSAC_GET_STACK(self)->layer_transac, TSIP_TRANSAC(self));
+
 		TSIP_TRANSAC(self)->running = tsk_true;
 		self->request = tsk_object_ref((void*)request);
 
@@ -699,11 +703,8 @@ static tsk_object_t* tsip_transac_nict_dtor(tsk_object_t * _self)
 	tsip_transac_nict_t *self = _self;
 	if(self){
 		/* Cancel timers */
-		if(!TSIP_TRANSAC(self)->reliable){
-			TRANSAC_TIMER_CANCEL(E);
-		}
-		TRANSAC_TIMER_CANCEL(F);
-		TRANSAC_TIMER_CANCEL(K);
+		tsk_timer_id_t timers[] = { (TSIP_TRANSAC(self)->reliable ? TSK_INVALID_TIMER_ID : self->timerE.id), self->timerF.id, self->timerK.id };
+		TRANSAC_TIMERS_CANCEL(timers);
 
 		TSIP_TRANSAC(self)->running = tsk_false;
 		TSK_OBJECT_SAFE_FREE(self->request);
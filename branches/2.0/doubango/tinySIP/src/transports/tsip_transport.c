@@ -53,6 +53,10 @@
 #if !defined(TSIP_TRANSPORT_STREAM_PEER_FIRST_MSG_TIMEOUT)
 #	define TSIP_TRANSPORT_STREAM_PEER_FIRST_MSG_TIMEOUT					30000 /* 30 seconds */ // High because of WebRTC clients (Time between camera access request and end-of-ice process)
 #endif /* TSIP_TRANSPORT_STREAM_PEER_FIRST_MSG_TIMEOUT */
+// Initial capacity of the buffer used to serialize the outgoing messages (grows as needed).
+#if !defined(TSIP_TRANSPORT_SND_BUFFER_SIZE)
+#	define TSIP_TRANSPORT_SND_BUFFER_SIZE								4096
+#endif /* TSIP_TRANSPORT_SND_BUFFER_SIZE */
 
 static const char* __null_callid = tsk_null;
 
@@ -327,9 +331,26 @@ int tsip_transport_msg_update(const tsip_transport_t* self, tsip_message_t *msg)
 // "udp", "tcp" or "tls"
 tsk_size_t tsip_transport_send_raw(const tsip_transport_t* self, const char* dst_host, tnet_port_t dst_port, const void* data, tsk_size_t size, const char* callid)
 {
-	tsk_size_t ret = 0;
+	tnet_iovec_t iov;
+	iov.data = data;
+	iov.size = size;
+	return tsip_transport_send_rawv(self, dst_host, dst_port, &iov, 1, callid);
+}
 
-	TSK_DEBUG_INFO("\n\nSEND: %.*s\n\n", size, (const char*)data);
+// "udp", "tcp" or "tls": the buffers are sent as a single message (e.g. headers + content) without being copied
+tsk_size_t tsip_transport_send_rawv(const tsip_transport_t* self, const char* dst_host, tnet_port_t dst_port, const tnet_iovec_t* iov, tsk_size_t count, const char* callid)
+{
+	tsk_size_t ret = 0, i, size = 0;
+
+	if(!self || !iov || !count){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return 0;
+	}
+
+	for(i = 0; i < count; ++i){
+		size += iov[i].size;
+	}
+	TSK_DEBUG_INFO("\n\nSEND: %.*s%.*s\n\n", (int)iov[0].size, (const char*)iov[0].data, (int)(count > 1 ? iov[1].size : 0), (count > 1 ? (const char*)iov[1].data : ""));
 
 	if(TNET_SOCKET_TYPE_IS_DGRAM(self->type)){// "udp" or "dtls"
 		const struct sockaddr_storage* to = &self->pcscf_addr;
@@ -339,8 +360,8 @@ tsk_size_t tsip_transport_send_raw(const tsip_transport_t* self, const char* dst
 				to = &dst_addr;
 			}
 		}
-		if(!(ret = tnet_transport_sendto(self->net_transport, self->connectedFD, (const struct sockaddr*)to, data, size))){
-			TSK_DEBUG_ERROR("Send(%u) returns zero", size);
+		if(!(ret = tnet_transport_sendtov(self->net_transport, self->connectedFD, (const struct sockaddr*)to, iov, count))){
+			TSK_DEBUG_ERROR("Send(%u) returns zero", (unsigned)size);
 		}
 	}
 	else{// "sctp", "tcp" or "tls"
@@ -398,11 +419,13 @@ tsk_size_t tsip_transport_send_raw(const tsip_transport_t* self, const char* dst
 		}
 		// send() data
 		if(peer->connected){
-			ret = tnet_transport_send(self->net_transport, peer->local_fd, data, size);
+			ret = tnet_transport_sendv(self->net_transport, peer->local_fd, iov, count);
 		}
 		else{
 			TSK_DEBUG_INFO("Data send requested but peer not connected yet...saving data");
-			tsk_buffer_append(peer->snd_buff_stream, data, size);
+			for(i = 0; i < count; ++i){
+				tsk_buffer_append(peer->snd_buff_stream, iov[i].data, iov[i].size);
+			}
 			ret = 0; // nothing sent
 		}
 		TSK_OBJECT_SAFE_FREE(peer);
@@ -482,6 +505,37 @@ tsk_size_t tsip_transport_send_raw_ws(const tsip_transport_t* self, tnet_fd_t lo
 	return ret;
 }
 
+/* sends a serialized message ("iov" is the start line and headers, optionally followed by the content) */
+static tsk_size_t _tsip_transport_send_iov(const tsip_transport_t* self, const tsip_message_t *msg, const tnet_iovec_t* iov, tsk_size_t iov_count, const char* destIP, int32_t destPort, const char* callid)
+{
+	tsk_size_t ret = 0;
+	if(TNET_SOCKET_TYPE_IS_WS(self->type) || TNET_SOCKET_TYPE_IS_WSS(self->type)){
+		//if(!TNET_SOCKET_TYPE_IS_WS(msg->net_type) && !TNET_SOCKET_TYPE_IS_WSS(msg->net_type)){
+			// message not received over WS/WS tranport but have to be sent over WS/WS
+			tsip_transport_stream_peer_t* peer = tsip_transport_find_stream_peer_by_remote_ip(TSIP_TRANSPORT(self), destIP, destPort, self->type);
+			if(peer){
+				ret = tsip_transport_send_raw_ws(self, peer->local_fd, iov[0].data, iov[0].size, callid);
+				TSK_OBJECT_SAFE_FREE(peer);
+			}
+			else if(msg->local_fd > 0)
+		//}
+		//else{
+			ret = tsip_transport_send_raw_ws(self, msg->local_fd, iov[0].data, iov[0].size, callid);
+		//}
+	}
+	else if(TNET_SOCKET_TYPE_IS_IPSEC(self->type)){
+		tnet_fd_t fd = tsip_transport_ipsec_getFD(TSIP_TRANSPORT_IPSEC(self), TSIP_MESSAGE_IS_REQUEST(msg));
+		// "fd == TNET_INVALID_FD" means IPSec SAs not up yet
+		ret = (fd != TNET_INVALID_FD)
+			? tnet_sockfd_send(fd, iov[0].data, iov[0].size, 0)
+			: tsip_transport_send_raw(self, destIP, destPort, iov[0].data, iov[0].size, callid);
+	}
+	else{
+		ret = tsip_transport_send_rawv(self, destIP, destPort, iov, iov_count, callid);
+	}
+	return ret;
+}
+
 /* sends a request 
 * all callers of this function should provide a sigcomp-id
 */
@@ -491,6 +545,9 @@ tsk_size_t tsip_transport_send(const tsip_transport_t* self, const char *branch,
 	if(self){
 		tsk_buffer_t *buffer = tsk_null;
 		const char* callid = msg->Call_ID ? msg->Call_ID->value : __null_callid;
+		tnet_iovec_t iov[2];
+		tsk_size_t iov_count = 1;
+		tsk_bool_t with_content;
 
 		/* Add Via and update AOR, IPSec headers, SigComp ...
 		* ACK sent from the transaction layer will contains a Via header and should not be updated 
@@ -530,10 +587,30 @@ tsk_size_t tsip_transport_send(const tsip_transport_t* self, const char *branch,
 			}
 		}
 
-		if((buffer = tsk_buffer_create_null())){
-			tsip_message_tostring(msg, buffer);
+		/* Serialize into the per-transport buffer (no allocation once it reached the size of the largest message).
+		* Another thread already using it (e.g. response sent while retransmitting) falls back to a temporary buffer.
+		*/
+		if(self->snd_buffer && tsk_atomic_cas(&((tsip_transport_t*)self)->snd_buffer_busy, 0, 1)){
+			buffer = self->snd_buffer;
+			tsk_buffer_remove(buffer, 0, buffer->size);
+		}
+		else if(!(buffer = tsk_buffer_create_null())){
+			TSK_DEBUG_ERROR("Failed to create buffer");
+			return 0;
+		}
 
-			if(buffer->size >1300){
+		/* The content is not copied after the headers when the transport can gather both (plain UDP/TCP) */
+		with_content = (!TSIP_MESSAGE_HAS_CONTENT(msg) || msg->sigcomp_id || TNET_SOCKET_TYPE_IS_SECURE(self->type) || TNET_SOCKET_TYPE_IS_WS(self->type));
+		if(tsip_message_tostring_2(msg, buffer, with_content) == 0){
+			iov[0].data = buffer->data;
+			iov[0].size = buffer->size;
+			if(!with_content){
+				iov[1].data = msg->Content->data;
+				iov[1].size = msg->Content->size;
+				iov_count = 2;
+			}
+
+			if((iov[0].size + (iov_count > 1 ? iov[1].size : 0)) > 1300){
 				/*	RFC 3261 - 18.1.1 Sending Requests (FIXME)
 					If a request is within 200 bytes of the path MTU, or if it is larger
 					than 1300 bytes and the path MTU is unknown, the request MUST be sent
@@ -549,50 +626,33 @@ tsk_size_t tsip_transport_send(const tsip_transport_t* self, const char *branch,
 			}
 			
 			/* === SigComp === */
-			if(msg->sigcomp_id){
-				if(self->stack->sigcomp.handle){
-					tsk_size_t out_size;
-					char SigCompBuffer[TSIP_SIGCOMP_MAX_BUFF_SIZE];
-					
-					out_size = tsip_sigcomp_handler_compress(self->stack->sigcomp.handle, msg->sigcomp_id, TNET_SOCKET_TYPE_IS_STREAM(self->type),
-						buffer->data, buffer->size, SigCompBuffer, sizeof(SigCompBuffer));
-					if(out_size){
-						tsk_buffer_cleanup(buffer);
-						tsk_buffer_append(buffer, SigCompBuffer, out_size);
-					}
-				}
-				else{
-					TSK_DEBUG_ERROR("The outgoing message should be compressed using SigComp but there is not compartment");
+			if(msg->sigcomp_id && self->stack->sigcomp.handle){
+				char SigCompBuffer[TSIP_SIGCOMP_MAX_BUFF_SIZE];
+				tsk_size_t out_size;
+				
+				out_size = tsip_sigcomp_handler_compress(self->stack->sigcomp.handle, msg->sigcomp_id, TNET_SOCKET_TYPE_IS_STREAM(self->type),
+					buffer->data, buffer->size, SigCompBuffer, sizeof(SigCompBuffer));
+				if(out_size){
+					/* sent from the stack buffer (before it goes out of scope): no copy back */
+					iov[0].data = SigCompBuffer;
+					iov[0].size = out_size;
 				}
-			}
-
-			/* === Send the message === */
-			if(TNET_SOCKET_TYPE_IS_WS(self->type) || TNET_SOCKET_TYPE_IS_WSS(self->type)){
-				//if(!TNET_SOCKET_TYPE_IS_WS(msg->net_type) && !TNET_SOCKET_TYPE_IS_WSS(msg->net_type)){
-					// message not received over WS/WS tranport but have to be sent over WS/WS
-					tsip_transport_stream_peer_t* peer = tsip_transport_find_stream_peer_by_remote_ip(TSIP_TRANSPORT(self), destIP, destPort, self->type);
-					if(peer){
-						ret = tsip_transport_send_raw_ws(self, peer->local_fd, buffer->data, buffer->size, callid);
-						TSK_OBJECT_SAFE_FREE(peer);
-					}
-					else if(msg->local_fd > 0)
-				//}
-				//else{
-					ret = tsip_transport_send_raw_ws(self, msg->local_fd, buffer->data, buffer->size, callid);
-				//}
-			}
-			else if(TNET_SOCKET_TYPE_IS_IPSEC(self->type)){
-				tnet_fd_t fd = tsip_transport_ipsec_getFD(TSIP_TRANSPORT_IPSEC(self), TSIP_MESSAGE_IS_REQUEST(msg));
-				// "fd == TNET_INVALID_FD" means IPSec SAs not up yet
-				ret = (fd != TNET_INVALID_FD)
-					? tnet_sockfd_send(fd, buffer->data, buffer->size, 0)
-					: tsip_transport_send_raw(self, destIP, destPort, buffer->data, buffer->size, callid);
+				ret = _tsip_transport_send_iov(self, msg, iov, iov_count, destIP, destPort, callid);
 			}
 			else{
-				ret = tsip_transport_send_raw(self, destIP, destPort, buffer->data, buffer->size, callid);
+				if(msg->sigcomp_id){
+					TSK_DEBUG_ERROR("The outgoing message should be compressed using SigComp but there is not compartment");
+				}
+				ret = _tsip_transport_send_iov(self, msg, iov, iov_count, destIP, destPort, callid);
 			}
+		}
 
 //bail:
+		if(buffer == self->snd_buffer){
+			/* full barrier: the writes to the buffer are visible to the next sender */
+			tsk_atomic_cas(&((tsip_transport_t*)self)->snd_buffer_busy, 1, 0);
+		}
+		else{
 			TSK_OBJECT_SAFE_FREE(buffer);
 		}
 	}
@@ -916,7 +976,8 @@ int tsip_transport_init(tsip_transport_t* self, tnet_socket_type_t type, const s
 
 	self->stack = stack;
 	self->type = type;
-	self->net_transport = tnet_transport_create(host, port, type, description);
+	/* the number of I/O workers must be known before the master socket is bound (SO_REUSEPORT) */
+	self->net_transport = tnet_transport_create_3(host, port, type, description, stack ? (TSK_CLAMP(1, stack->network.workers_count, TNET_TRANSPORT_MAX_WORKERS)) : 1);
 		
 	self->scheme = "sip";
 
@@ -963,6 +1024,12 @@ int tsip_transport_init(tsip_transport_t* self, tnet_socket_type_t type, const s
 			self->service = "SIP+D2U";
 		}
 	}
+	/* Serialization buffer */
+	if((self->snd_buffer = tsk_buffer_create_null())){
+		tsk_buffer_reserve(self->snd_buffer, TSIP_TRANSPORT_SND_BUFFER_SIZE);
+	}
+	self->snd_buffer_busy = 0;
+
 	self->connectedFD = TNET_INVALID_FD;
 	self->initialized = 1;
 	
@@ -977,6 +1044,7 @@ int tsip_transport_deinit(tsip_transport_t* self)
 
 	TSK_OBJECT_SAFE_FREE(self->net_transport);
 	TSK_OBJECT_SAFE_FREE(self->stream_peers);
+	TSK_OBJECT_SAFE_FREE(self->snd_buffer);
     
 	self->initialized = 0;
 	return 0;
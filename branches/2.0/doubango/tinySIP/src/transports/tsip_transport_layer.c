@@ -288,7 +288,7 @@ parse_buffer:
 	*	==> Parse the SIP message without the content.
 	*/
 	tsk_ragel_state_init(&state, TSK_BUFFER_DATA(peer->rcv_buff_stream), endOfheaders + 4/*2CRLF*/);
-	if(tsip_message_parse(&state, &message, tsk_false/* do not extract the content */) == tsk_true){
+	if(tsip_message_parse_2(&state, &message, tsk_false/* do not extract the content */, TSIP_MESSAGE_LAZY_PARSING, TSIP_MESSAGE_ARENA) == tsk_true){
 		tsk_size_t clen = TSIP_MESSAGE_CONTENT_LENGTH(message); /* MUST have content-length header (see RFC 3261 - 7.5). If no CL header then the macro return zero. */
 		if(clen == 0){ /* No content */
 			tsk_buffer_remove(peer->rcv_buff_stream, 0, (endOfheaders + 4/*2CRLF*/)); /* Remove SIP headers and CRLF */
@@ -598,7 +598,7 @@ parse_buffer:
 	//	==> Parse the SIP message without the content.
 	TSK_DEBUG_INFO("Receiving SIP o/ WebSocket message: %.*s", pay_len, (const char*)peer->ws.rcv_buffer);
 	tsk_ragel_state_init(&state, peer->ws.rcv_buffer, (tsk_size_t)pay_len);
-	if (tsip_message_parse(&state, &message, tsk_false/* do not extract the content */) == tsk_true) {
+	if (tsip_message_parse_2(&state, &message, tsk_false/* do not extract the content */, TSIP_MESSAGE_LAZY_PARSING, TSIP_MESSAGE_ARENA) == tsk_true) {
 		const uint8_t* body_start = (const uint8_t*)state.eoh;
 		int64_t clen = (pay_len - (int64_t)(body_start - ((const uint8_t*)peer->ws.rcv_buffer)));
 		if (clen > 0) {
@@ -695,7 +695,7 @@ static int tsip_transport_layer_dgram_cb(const tnet_transport_event_t* e)
 	}
 
 	tsk_ragel_state_init(&state, data_ptr, data_size);
-	if(tsip_message_parse(&state, &message, tsk_true) == tsk_true 
+	if(tsip_message_parse_2(&state, &message, tsk_true, TSIP_MESSAGE_LAZY_PARSING, TSIP_MESSAGE_ARENA) == tsk_true 
 		&& message->firstVia &&  message->Call_ID && message->CSeq && message->From && message->To)
 	{
 		/* Set local fd used to receive the message and the address of the remote peer */
@@ -1074,6 +1074,12 @@ int tsip_transport_layer_add(tsip_transport_layer_t* self, const char* local_hos
 			if(TNET_SOCKET_TYPE_IS_TLS(type) || TNET_SOCKET_TYPE_IS_WSS(type) || TNET_SOCKET_TYPE_IS_DTLS(type) || self->stack->security.enable_secagree_tls){
 				tsip_transport_tls_set_certs(transport, self->stack->security.tls.ca, self->stack->security.tls.pbk, self->stack->security.tls.pvk, self->stack->security.tls.verify);
 			}
+			/* TLS session resumption */
+			if(TNET_SOCKET_TYPE_IS_TLS(type) || TNET_SOCKET_TYPE_IS_WSS(type)){
+				if(tsip_transport_tls_set_sessions(transport, self->stack->security.tls.sessions.cache_size, self->stack->security.tls.sessions.lifetime, self->stack->security.tls.sessions.ticket_key_rotation) != 0){
+					TSK_DEBUG_WARN("Failed to configure the TLS sessions");
+				}
+			}
 			/* Nat Traversal context */
 			if(self->stack->natt.ctx){
 				tnet_transport_set_natt_ctx(transport->net_transport, self->stack->natt.ctx);
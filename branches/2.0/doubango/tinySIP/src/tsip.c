@@ -315,6 +315,11 @@ static int __tsip_stack_set(tsip_stack_t *self, va_list* app)
 					self->network.mode = va_arg(*app, tsip_stack_mode_t);
 					break;
 				}
+			case tsip_pname_network_workers:
+				{	/* (unsigned)COUNT_UINT */
+					self->network.workers_count = va_arg(*app, unsigned);
+					break;
+				}
 			
 
 
@@ -400,6 +405,13 @@ static int __tsip_stack_set(tsip_stack_t *self, va_list* app)
 					self->security.tls.verify = va_arg(*app, tsk_bool_t);
 					break;
 				}
+			case tsip_pname_tls_sessions:
+				{	/* (unsigned)CACHE_SIZE_UINT, (unsigned)LIFETIME_UINT, (unsigned)TICKET_KEY_ROTATION_UINT */
+					self->security.tls.sessions.cache_size = va_arg(*app, unsigned);
+					self->security.tls.sessions.lifetime = va_arg(*app, unsigned);
+					self->security.tls.sessions.ticket_key_rotation = va_arg(*app, unsigned);
+					break;
+				}
 			
 
 			/* === Dummy Headers === */
@@ -529,6 +541,12 @@ tsip_stack_handle_t* tsip_stack_create(tsip_stack_callback_f callback, const cha
 	for(i = 0; i < sizeof(stack->network.proxy_cscf_port)/sizeof(stack->network.proxy_cscf_port[0]); ++i) { stack->network.proxy_cscf_port[i] = 5060; }
 	for(i = 0; i < sizeof(stack->network.proxy_cscf_type)/sizeof(stack->network.proxy_cscf_type[0]); ++i) { stack->network.proxy_cscf_type[i] = tnet_socket_type_invalid; }
 	stack->network.max_fds = tmedia_defaults_get_max_fds();
+	stack->network.workers_count = 1;
+
+	/* === Default values (Security) === */
+	stack->security.tls.sessions.cache_size = TNET_TLS_SESSION_CACHE_SIZE;
+	stack->security.tls.sessions.lifetime = TNET_TLS_SESSION_LIFETIME;
+	stack->security.tls.sessions.ticket_key_rotation = TNET_TLS_TICKET_KEY_ROTATION;
 	
 	// all events should be delivered to the user before the stack stop
 	tsk_runnable_set_important(TSK_RUNNABLE(stack), tsk_true);
@@ -928,6 +946,44 @@ int tsip_stack_get_local_ip_n_port(const tsip_stack_handle_t *self, const char*
 	return -2;
 }
 
+/**@ingroup tsip_stack_group
+* Gets the TLS handshake counters (full vs resumed) of all the TLS and WSS transports.
+* @param self The 3GPP IMS/LTE stack.
+* @param stats The counters, summed over the transports.
+* @retval Zero if succeed and non-zero error code otherwise.
+* @sa @ref TSIP_STACK_SET_TLS_SESSIONS()
+*/
+int tsip_stack_get_tls_stats(const tsip_stack_handle_t *self, tnet_tls_stats_t* stats)
+{
+	const tsip_stack_t *stack = self;
+	const tsk_list_item_t *item;
+	tnet_tls_stats_t transport_stats;
+
+	if(!stack || !stats){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+
+	memset(stats, 0, sizeof(*stats));
+	if(stack->layer_transport){
+		tsk_list_foreach(item, stack->layer_transport->transports){
+			const tsip_transport_t *transport = item->data;
+			if(!transport || !(TNET_SOCKET_TYPE_IS_TLS(transport->type) || TNET_SOCKET_TYPE_IS_WSS(transport->type))){
+				continue;
+			}
+			if(tnet_transport_tls_get_stats(transport->net_transport, &transport_stats) == 0){
+				stats->server.full += transport_stats.server.full;
+				stats->server.resumed += transport_stats.server.resumed;
+				stats->client.full += transport_stats.client.full;
+				stats->client.resumed += transport_stats.client.resumed;
+				stats->ticket_key_rotations += transport_stats.ticket_key_rotations;
+				stats->client_sessions += transport_stats.client_sessions;
+			}
+		}
+	}
+	return 0;
+}
+
 /**@ingroup tsip_stack_group
 * Stops the stack.
 * @param self The 3GPP IMS/LTE stack to stop. This handle should be created using @ref tsip_stack_create() and started using tsip_stack_start().
@@ -37,6 +37,8 @@
 #include "tinysip/headers/tsip_header_Supported.h"
 #include "tinysip/headers/tsip_header_User_Agent.h"
 
+#include "tinysip/parsers/tsip_parser_header.h"
+
 
 #include "tsk_debug.h"
 #include "tsk_memory.h"
@@ -46,6 +48,18 @@
 /**@defgroup tsip_message_group SIP message (either request or response).
 */
 
+/* Header line kept as received until a getter asks for its type (see tsip_message_parse_2()) */
+typedef struct tsip_message_deferred_s
+{
+	tsip_header_type_t type;
+	tsk_size_t offset; /* in "deferred.lines" */
+	tsk_size_t size; /* with the CRLF */
+	tsk_size_t anchor; /* number of headers in "self->headers" when the line was received */
+	tsk_size_t produced; /* number of headers added to "self->headers" when parsed (a line could hold several values) */
+	tsk_bool_t parsed;
+}
+tsip_message_deferred_t;
+
 /*== Predicate function to find tsk_string_t object by val*/
 static int __pred_find_string_by_value(const tsk_list_item_t *item, const void *stringVal)
 {
@@ -91,7 +105,7 @@ int	tsip_message_add_header(tsip_message_t *self, const tsip_header_t *hdr)
 				if(!self->field) \
 				{ \
 					self->field = (tsip_header_##type##_t*)header; \
-					return 0; \
+					goto bail; \
 				} \
 				break; \
 			}
@@ -99,6 +113,12 @@ int	tsip_message_add_header(tsip_message_t *self, const tsip_header_t *hdr)
 	if(self && hdr){
 		tsip_header_t *header = tsk_object_ref((void*)hdr);
 
+		tsip_message_lock(self);
+		/* keep the order of the headers with the same type */
+		if(self->deferred.count){
+			tsip_message_parse_deferred(self, header->type);
+		}
+
 		switch(header->type){
 			ADD_HEADER(Via, firstVia);
 			ADD_HEADER(From, From);
@@ -114,7 +134,8 @@ int	tsip_message_add_header(tsip_message_t *self, const tsip_header_t *hdr)
 		}
 
 		tsk_list_push_back_data(self->headers, (void**)&header);
-
+bail:
+		tsip_message_unlock(self);
 		return 0;
 	}
 	return -1;
@@ -163,6 +184,210 @@ int tsip_message_add_content(tsip_message_t *self, const char* content_type, con
 	return -1;
 }
 
+/* Types with a dedicated field in the message: always parsed when received (the stack reads them directly) */
+static tsk_bool_t _tsip_message_is_eager(const tsip_message_t *self, tsip_header_type_t type)
+{
+	switch(type){
+		case tsip_htype_Via: return !self->firstVia;
+		case tsip_htype_Contact: return !self->Contact;
+		case tsip_htype_From:
+		case tsip_htype_To:
+		case tsip_htype_Call_ID:
+		case tsip_htype_CSeq:
+		case tsip_htype_Expires:
+		case tsip_htype_Content_Type:
+		case tsip_htype_Content_Length:
+			return tsk_true;
+		default:
+			return tsk_false;
+	}
+}
+
+/**@ingroup tsip_message_group
+* Records a raw header line instead of parsing it (lazy parsing). Called by the message parser.
+* @param line The header line, including the CRLF.
+* @param size The size of the line.
+* @param remaining The number of bytes from the start of the line to the end of the message (capacity hint).
+* @retval Zero if the line was recorded, 1 if the header must be parsed now and a negative value on error.
+*/
+int tsip_message_defer_header(tsip_message_t *self, const char* line, tsk_size_t size, tsk_size_t remaining)
+{
+	tsk_size_t name_size;
+	tsip_header_type_t type;
+	tsip_message_deferred_t* item;
+
+	if(!self || !line || !size){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+
+	for(name_size = 0; name_size < size && line[name_size] != ':'; ++name_size) ;
+	if(name_size == size){
+		return 1; /* let the parser report the error */
+	}
+	while(name_size && (line[name_size - 1] == ' ' || line[name_size - 1] == '\t')){
+		--name_size;
+	}
+	if(_tsip_message_is_eager(self, (type = tsip_header_get_type(line, name_size)))){
+		return 1;
+	}
+
+	if(!self->deferred.lines){
+		if(!(self->deferred.lines = tsk_buffer_create_null()) || tsk_buffer_reserve(self->deferred.lines, TSK_MAX(remaining, size) + 1)){
+			return -2;
+		}
+		/* the parser runs on the transport thread before the message is shared: no lock needed here */
+		if(!self->deferred.mutex && !(self->deferred.mutex = tsk_mutex_create())){
+			return -2;
+		}
+	}
+	if(self->deferred.count == self->deferred.capacity){
+		tsk_size_t capacity = self->deferred.capacity ? (self->deferred.capacity << 1) : 16;
+		if(!(item = tsk_realloc(self->deferred.items, capacity * sizeof(tsip_message_deferred_t)))){
+			return -3;
+		}
+		self->deferred.items = item;
+		self->deferred.capacity = capacity;
+	}
+	item = &self->deferred.items[self->deferred.count];
+	item->type = type;
+	item->offset = TSK_BUFFER_SIZE(self->deferred.lines);
+	item->size = size;
+	item->anchor = tsk_list_count(self->headers, tsk_null, tsk_null); /* values following the first one of an eagerly parsed Via or Contact */
+	item->produced = 0;
+	item->parsed = tsk_false;
+	if(tsk_buffer_append(self->deferred.lines, line, size)){
+		return -4;
+	}
+	++self->deferred.count;
+	return 0;
+}
+
+/* moves the items appended to "headers" after the first "count" ones to "index" */
+static void _tsip_message_headers_move_tail(tsip_headers_L_t* headers, tsk_size_t count, tsk_size_t index)
+{
+	tsk_list_item_t *last_old = tsk_null, *first_new, *before = tsk_null, *at;
+	tsk_size_t i;
+
+	if(index >= count || !headers->head){
+		return;
+	}
+	for(i = 0, at = headers->head; i < count; ++i, at = at->next){
+		if(i == index - 1){
+			before = at;
+		}
+		last_old = at;
+	}
+	if(!(first_new = last_old->next)){
+		return;
+	}
+	at = before ? before->next : headers->head;
+	headers->tail->next = at;
+	if(before){
+		before->next = first_new;
+	}
+	else{
+		headers->head = first_new;
+	}
+	last_old->next = tsk_null;
+	headers->tail = last_old;
+}
+
+static int _tsip_message_parse_deferred_item(tsip_message_t *self, tsk_size_t index)
+{
+	tsip_message_deferred_t* item = &self->deferred.items[index];
+	tsk_ragel_state_t state;
+	const char* line = (const char*)TSK_BUFFER_TO_U8(self->deferred.lines) + item->offset;
+	tsk_arena_t* previous;
+	tsk_size_t i, count, position;
+	tsk_bool_t ok;
+
+	/* where the headers would be if the message was parsed when received */
+	for(i = 0, position = item->anchor; i < index; ++i){
+		if(self->deferred.items[i].parsed){
+			position += self->deferred.items[i].produced;
+		}
+	}
+	count = tsk_list_count(self->headers, tsk_null, tsk_null);
+
+	item->parsed = tsk_true;
+	tsk_ragel_state_init(&state, line, item->size);
+	state.tag_start = state.p;
+	state.tag_end = state.pe;
+	previous = tsk_arena_push(self->arena);
+	ok = tsip_header_parse(&state, self);
+	tsk_arena_pop(previous);
+
+	item->produced = tsk_list_count(self->headers, tsk_null, tsk_null) - count;
+	_tsip_message_headers_move_tail(self->headers, count, position);
+	if(!ok){
+		TSK_DEBUG_ERROR("Failed to parse header - %.*s", (int)item->size, line);
+		return -2;
+	}
+	return 0;
+}
+
+/**@ingroup tsip_message_group
+* Parses the header lines of type @a type received but not parsed yet (lazy parsing). The typed headers are added
+* to the message, in the order they were received, as if they were parsed when the message was received. Called by
+* the getters: the message is only logically const, the changes are made under the message lock.
+*/
+int tsip_message_parse_deferred(const tsip_message_t *self, tsip_header_type_t type)
+{
+	tsk_size_t i;
+	tsip_message_t *message = (tsip_message_t*)self;
+	if(!self){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	tsip_message_lock(self);
+	for(i = 0; i < message->deferred.count; ++i){
+		if(!message->deferred.items[i].parsed && message->deferred.items[i].type == type){
+			_tsip_message_parse_deferred_item(message, i);
+		}
+	}
+	tsip_message_unlock(self);
+	return 0;
+}
+
+/**@ingroup tsip_message_group
+* Parses all the header lines received but not parsed yet (lazy parsing). Needed before walking @a self->headers directly.
+*/
+int tsip_message_parse_deferred_all(const tsip_message_t *self)
+{
+	tsk_size_t i;
+	tsip_message_t *message = (tsip_message_t*)self;
+	if(!self){
+		TSK_DEBUG_ERROR("Invalid parameter");
+		return -1;
+	}
+	tsip_message_lock(self);
+	for(i = 0; i < message->deferred.count; ++i){
+		if(!message->deferred.items[i].parsed){
+			_tsip_message_parse_deferred_item(message, i);
+		}
+	}
+	tsip_message_unlock(self);
+	return 0;
+}
+
+/**@ingroup tsip_message_group
+* Locks a message received with lazy parsing (no-op otherwise). Must be held while walking @a self->headers directly
+* if another thread could call the getters at the same time. Recursive.
+*/
+int tsip_message_lock(const tsip_message_t *self)
+{
+	return (self && self->deferred.mutex) ? tsk_mutex_lock(self->deferred.mutex) : 0;
+}
+
+/**@ingroup tsip_message_group
+* Unlocks a message locked using @ref tsip_message_lock().
+*/
+int tsip_message_unlock(const tsip_message_t *self)
+{
+	return (self && self->deferred.mutex) ? tsk_mutex_unlock(self->deferred.mutex) : 0;
+}
+
 const tsip_header_t *tsip_message_get_headerAt(const tsip_message_t *self, tsip_header_type_t type, tsk_size_t index)
 {
 	/* Do not forget to update tinyWRAP::SipMessage::getHeaderAt() */
@@ -170,7 +395,12 @@ const tsip_header_t *tsip_message_get_headerAt(const tsip_message_t *self, tsip_
 	const tsk_list_item_t *item;
 	const tsip_header_t* hdr = tsk_null;
 
-	if(self){		
+	if(self){
+		tsip_message_lock(self);
+		if(self->deferred.count){
+			tsip_message_parse_deferred(self, type);
+		}
+
 		switch(type)
 		{
 		case tsip_htype_Via:
@@ -233,6 +463,7 @@ const tsip_header_t *tsip_message_get_headerAt(const tsip_message_t *self, tsip_
 	}
 
 bail:
+	tsip_message_unlock(self);
 	return hdr;
 }
 
@@ -326,23 +557,44 @@ uint32_t tsip_message_getContent_length(const tsip_message_t *self)
 }
 
 int tsip_message_tostring(const tsip_message_t *self, tsk_buffer_t *output)
+{
+	return tsip_message_tostring_2(self, output, tsk_true);
+}
+
+/**@ingroup tsip_message_group
+* Serializes a message.
+* @param self The message to serialize.
+* @param output The buffer to append the message to. Its memory is reused: pass the same buffer (emptied using
+* @ref tsk_buffer_remove()) for each message to avoid reallocations.
+* @param with_content Whether to append the content. If false, the output stops at the empty line and the content
+* (@a self->Content) could be sent as is (e.g. second entry of @ref tnet_transport_sendv()).
+* @retval Zero if succeed and non-zero error code otherwise.
+*/
+int tsip_message_tostring_2(const tsip_message_t *self, tsk_buffer_t *output, tsk_bool_t with_content)
 {
 	if(!self || !output){
 		return -1;
 	}
 
+	tsip_message_lock(self);
+
 	if(TSIP_MESSAGE_IS_REQUEST(self)){
 		/*Method SP Request_URI SP SIP_Version CRLF*/
 		/* Method */
-		tsk_buffer_append_2(output, "%s ", self->line.request.method);
+		tsk_buffer_append_str(output, self->line.request.method);
+		tsk_buffer_append(output, " ", 1);
 		/* Request URI (without quotes but with params)*/
 		tsip_uri_serialize(self->line.request.uri, tsk_true, tsk_false, output);
 		/* SIP VERSION */
-		tsk_buffer_append_2(output, " %s\r\n", TSIP_MESSAGE_VERSION_DEFAULT);
+		tsk_buffer_append(output, " "TSIP_MESSAGE_VERSION_DEFAULT"\r\n", sizeof(" "TSIP_MESSAGE_VERSION_DEFAULT"\r\n") - 1);
 	}
 	else{
 		/*SIP_Version SP Status_Code SP Reason_Phrase CRLF*/
-		tsk_buffer_append_2(output, "%s %hi %s\r\n", TSIP_MESSAGE_VERSION_DEFAULT, TSIP_RESPONSE_CODE(self), TSIP_RESPONSE_PHRASE(self));
+		tsk_buffer_append(output, TSIP_MESSAGE_VERSION_DEFAULT" ", sizeof(TSIP_MESSAGE_VERSION_DEFAULT" ") - 1);
+		tsk_buffer_append_int(output, TSIP_RESPONSE_CODE(self));
+		tsk_buffer_append(output, " ", 1);
+		tsk_buffer_append_str(output, TSIP_RESPONSE_PHRASE(self));
+		tsk_buffer_append(output, "\r\n", 2);
 	}
 
 	/* First Via */
@@ -383,10 +635,26 @@ int tsip_message_tostring(const tsip_message_t *self, tsk_buffer_t *output)
 		tsip_header_serialize(TSIP_HEADER(self->Content_Length), output);
 	}
 
-	/* All other headers */
+	/* All other headers, in the order they were received. Lazy parsing: the lines not parsed yet are copied as is */
 	{
-		tsk_list_item_t *item;
-		tsk_list_foreach(item, self->headers){
+		const tsk_list_item_t *item = self->headers ? self->headers->head : tsk_null;
+		tsk_size_t i, j, position = 0, produced = 0;
+		for(i = 0; i < self->deferred.count; ++i){
+			const tsip_message_deferred_t* deferred = &self->deferred.items[i];
+			for(; item && position < deferred->anchor + produced; item = item->next, ++position){
+				tsip_header_serialize(TSIP_HEADER(item->data), output);
+			}
+			if(deferred->parsed){
+				for(j = 0; item && j < deferred->produced; item = item->next, ++j, ++position){
+					tsip_header_serialize(TSIP_HEADER(item->data), output);
+				}
+				produced += deferred->produced;
+			}
+			else{
+				tsk_buffer_append(output, TSK_BUFFER_TO_U8(self->deferred.lines) + deferred->offset, deferred->size);
+			}
+		}
+		for(; item; item = item->next){
 			tsip_header_serialize(TSIP_HEADER(item->data), output);
 		}
 	}
@@ -395,10 +663,11 @@ int tsip_message_tostring(const tsip_message_t *self, tsk_buffer_t *output)
 	tsk_buffer_append(output, "\r\n", 2);
 
 	/* CONTENT */
-	if(TSIP_MESSAGE_HAS_CONTENT(self)){
+	if(with_content && TSIP_MESSAGE_HAS_CONTENT(self)){
 		tsk_buffer_append(output, TSK_BUFFER_TO_STRING(self->Content), TSK_BUFFER_SIZE(self->Content));
 	}
 
+	tsip_message_unlock(self);
 	return 0;
 }
 
@@ -633,6 +902,12 @@ static tsk_object_t* tsip_message_dtor(tsk_object_t *self)
 		TSK_OBJECT_SAFE_FREE(message->Content);
 
 		TSK_OBJECT_SAFE_FREE(message->headers);
+		TSK_OBJECT_SAFE_FREE(message->deferred.lines);
+		TSK_FREE(message->deferred.items);
+		if(message->deferred.mutex){
+			tsk_mutex_destroy(&message->deferred.mutex);
+		}
+		TSK_OBJECT_SAFE_FREE(message->arena); /* the chunks are freed when the last header is destroyed */
 
 		TSK_FREE(message->sigcomp_id);
 
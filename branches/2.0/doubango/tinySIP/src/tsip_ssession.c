@@ -198,7 +198,7 @@ int __tsip_ssession_set(tsip_ssession_t *self, va_list *app)
 					const tsip_uri_t* URI_OBJ = va_arg(*app, const tsip_uri_t *);
 					if(URI_OBJ){
 						TSK_OBJECT_SAFE_FREE(self->to);
-						self->to = tsk_object_ref((void*)URI_OBJ);
+						self->to = tsip_uri_copyout(URI_OBJ);
 					}
 					break;
 				}
@@ -207,7 +207,7 @@ int __tsip_ssession_set(tsip_ssession_t *self, va_list *app)
 					const tsip_uri_t* URI_OBJ = va_arg(*app, const tsip_uri_t *);
 					if(URI_OBJ){
 						TSK_OBJECT_SAFE_FREE(self->from);
-						self->from = tsk_object_ref((void*)URI_OBJ);
+						self->from = tsip_uri_copyout(URI_OBJ);
 					}
 					break;
 				}
@@ -36,6 +36,7 @@
 #include "tsk_string.h"
 #include "tsk_params.h"
 #include "tsk_url.h"
+#include "tsk_arena.h"
 
 #include <string.h>
 
@@ -57,35 +58,37 @@ tsip_uri_t* tsip_uri_create(tsip_uri_type_t type)
 /* internal function used to serialize a SIP/SIPS/TEL URI */
 int __tsip_uri_serialize(const tsip_uri_t *uri, tsk_bool_t with_params, tsk_buffer_t *output)
 {
-	tsk_istr_t port;
-
-	if(uri->port){
-		tsk_itoa(uri->port, &port);
-	}
+	int ret;
 
 	/* sip:alice:secretword@atlanta.com:65535 */
-	tsk_buffer_append_2(output, "%s:%s%s%s%s%s%s%s%s%s", 
-
-		uri->scheme ? uri->scheme : "sip", /* default scheme is sip: */
-
-		uri->user_name ? uri->user_name : "",
-
-		uri->password ? ":" : "",
-		uri->password ? uri->password : "",
-
-		uri->host ? (uri->user_name ? "@" : "") : "",
-		uri->host_type == host_ipv6 ? "[" : "",
-		uri->host ? uri->host : "",
-		uri->host_type == host_ipv6 ? "]" : "",
-
-		uri->port ? ":" : "",
-		uri->port ? port : ""
-		);
+	if((ret = tsk_buffer_append_str(output, uri->scheme ? uri->scheme : "sip")) /* default scheme is sip: */
+		|| (ret = tsk_buffer_append(output, ":", 1))
+		|| (ret = tsk_buffer_append_str(output, uri->user_name))){
+		return ret;
+	}
+	if(uri->password && ((ret = tsk_buffer_append(output, ":", 1)) || (ret = tsk_buffer_append_str(output, uri->password)))){
+		return ret;
+	}
+	if(uri->host && uri->user_name && (ret = tsk_buffer_append(output, "@", 1))){
+		return ret;
+	}
+	if(uri->host_type == host_ipv6){
+		if((ret = tsk_buffer_append(output, "[", 1)) || (ret = tsk_buffer_append_str(output, uri->host)) || (ret = tsk_buffer_append(output, "]", 1))){
+			return ret;
+		}
+	}
+	else if((ret = tsk_buffer_append_str(output, uri->host))){
+		return ret;
+	}
+	if(uri->port && ((ret = tsk_buffer_append(output, ":", 1)) || (ret = tsk_buffer_append_int(output, uri->port)))){
+		return ret;
+	}
 	
 	/* Params */
 	if(with_params && !TSK_LIST_IS_EMPTY(uri->params)){
-		tsk_buffer_append(output, ";", 1);
-		tsk_params_tostring(uri->params, ';', output);
+		if((ret = tsk_buffer_append(output, ";", 1)) || (ret = tsk_params_tostring(uri->params, ';', output))){
+			return ret;
+		}
 	}
 	
 	return 0;
@@ -105,12 +108,15 @@ int tsip_uri_serialize(const tsip_uri_t *uri, tsk_bool_t with_params, tsk_bool_t
 		int ret = 0;
 		if(quote){
 			if(uri->display_name){
-				tsk_buffer_append_2(output, "\"%s\"", uri->display_name);
+				if((ret = tsk_buffer_append(output, "\"", 1)) || (ret = tsk_buffer_append_str(output, uri->display_name)) || (ret = tsk_buffer_append(output, "\"", 1))){
+					return ret;
+				}
 			}
 
-			tsk_buffer_append(output, "<", 1);
-			ret = __tsip_uri_serialize(uri, with_params, output);
-			tsk_buffer_append(output, ">", 1);
+			if((ret = tsk_buffer_append(output, "<", 1)) || (ret = __tsip_uri_serialize(uri, with_params, output))){
+				return ret;
+			}
+			ret = tsk_buffer_append(output, ">", 1);
 		}
 		else{
 			ret = __tsip_uri_serialize(uri, with_params, output);
@@ -165,6 +171,30 @@ tsip_uri_t *tsip_uri_clone(const tsip_uri_t *uri, tsk_bool_t with_params, tsk_bo
 	return newuri;
 }
 
+/**@ingroup tsip_uri_group
+* Copies a URI out of the arena of the message it was received with (see @ref tsip_message_parse_2()). Must be used
+* for the URIs outliving their message (e.g. dialog's remote URI) otherwise they keep the whole arena alive.
+* @param uri The URI to copy.
+* @retval New reference to @a uri if it's allocated on the heap and a heap copy (with the parameters and display name) otherwise.
+*/
+tsip_uri_t *tsip_uri_copyout(const tsip_uri_t *uri)
+{
+	tsip_uri_t *newuri;
+	tsk_arena_t* previous;
+
+	if(!tsk_arena_of(uri)){
+		return tsk_object_ref((tsk_object_t*)uri);
+	}
+
+	previous = tsk_arena_push(tsk_null);
+	if((newuri = tsip_uri_clone(uri, tsk_true, tsk_false))){
+		tsk_strupdate(&newuri->display_name, uri->display_name);
+	}
+	tsk_arena_pop(previous);
+
+	return newuri;
+}
+
 
 
 
@@ -24,11 +24,17 @@
 
 #include "tinysip.h"
 
+#include <assert.h>
+
 #include "test_sipmessages.h"
 #include "test_uri.h" /*SIP/SIPS/TEL*/
 #include "test_transac.h"
+#include "test_dialog_layer.h"
 #include "test_stack.h"
 #include "test_imsaka.h"
+#include "test_serializer.h"
+#include "test_lazy_parsing.h"
+#include "test_parsing.h"
 
 
 #define RUN_TEST_LOOP		1
@@ -37,8 +43,12 @@
 #define RUN_TEST_MESSAGES	1
 #define RUN_TEST_URI		0
 #define RUN_TEST_TRANSAC	0
+#define RUN_TEST_DIALOG_LAYER	0
 #define RUN_TEST_STACK		0
 #define RUN_TEST_IMS_AKA	0
+#define RUN_TEST_SERIALIZER	0
+#define RUN_TEST_LAZY_PARSING	0
+#define RUN_TEST_PARSING	0
 
 #ifdef _WIN32_WCE
 int _tmain(int argc, _TCHAR* argv[])
@@ -69,6 +79,10 @@ int main()
 		test_transac();
 #endif
 
+#if RUN_TEST_ALL || RUN_TEST_DIALOG_LAYER
+		test_dialog_layer();
+#endif
+
 #if RUN_TEST_ALL || RUN_TEST_STACK
 		test_stack();
 #endif
@@ -76,6 +90,18 @@ int main()
 #if RUN_TEST_ALL || RUN_TEST_IMS_AKA
 		test_imsaka();
 #endif
+
+#if RUN_TEST_ALL || RUN_TEST_SERIALIZER
+		test_serializer();
+#endif
+
+#if RUN_TEST_ALL || RUN_TEST_LAZY_PARSING
+		test_lazy_parsing();
+#endif
+
+#if RUN_TEST_ALL || RUN_TEST_PARSING
+		test_parsing();
+#endif
 	}
 
 	tnet_cleanup();
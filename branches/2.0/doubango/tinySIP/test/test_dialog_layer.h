@@ -0,0 +1,197 @@
+/*
+* Copyright (C) 2009 Mamadou Diop.
+*
+* Contact: Mamadou Diop <diopmamadou(at)doubango[dot]org>
+*	
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*	
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*	
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*
+*/
+#ifndef _TEST_DIALOG_LAYER_H
+#define _TEST_DIALOG_LAYER_H
+
+#include "tinysip/dialogs/tsip_dialog_layer.h"
+
+#define TEST_DIALOG_LAYER_COUNT		200 /* more than TSIP_DIALOG_LAYER_BUCKETS_MIN: the indexes grow */
+#define TEST_DIALOG_LAYER_TRIES		10000
+
+static tsip_dialog_t* test_dialog_layer_new(tsip_dialog_layer_t* layer, tsip_stack_handle_t* stack, const char* tag_local, const char* tag_remote)
+{
+	tsip_ssession_handle_t* ss;
+	tsip_dialog_t* dialog = tsk_null;
+
+	if((ss = tsip_ssession_create(stack, TSIP_SSESSION_SET_NULL()))){
+		if((dialog = tsip_dialog_layer_new(layer, tsip_dialog_MESSAGE, ss))){
+			tsk_strupdate(&dialog->tag_local, tag_local);
+			tsk_strupdate(&dialog->tag_remote, tag_remote);
+		}
+		TSK_OBJECT_SAFE_FREE(ss); /* owned by the dialog */
+	}
+	return dialog;
+}
+
+/* a second dialog sharing the Call-ID of "dialog" (e.g. forked INVITE): the Call-IDs are random, so new dialogs are created until
+* one is indexed in the same bucket and it then takes the Call-ID of "dialog" */
+static tsip_dialog_t* test_dialog_layer_fork(tsip_dialog_layer_t* layer, tsip_stack_handle_t* stack, const tsip_dialog_t* dialog, const char* tag_remote)
+{
+	tsip_dialog_t* fork;
+	int i;
+
+	for(i = 0; i < TEST_DIALOG_LAYER_TRIES; ++i){
+		if(!(fork = test_dialog_layer_new(layer, stack, dialog->tag_local, tag_remote))){
+			break;
+		}
+		if((tsk_strihash(fork->callid) & (layer->buckets_count - 1)) == (tsk_strihash(dialog->callid) & (layer->buckets_count - 1))){
+			tsk_strupdate(&fork->callid, dialog->callid);
+			return fork;
+		}
+		tsip_dialog_layer_remove(layer, fork);
+		TSK_OBJECT_SAFE_FREE(fork);
+	}
+	return tsk_null;
+}
+
+/* finds a dialog and drops the reference returned by the layer */
+static const tsip_dialog_t* test_dialog_layer_find(const tsip_dialog_layer_t* layer, const char* callid, const char* tag_remote, const char* tag_local, tsip_request_type_t type, tsk_bool_t* cid_matched)
+{
+	tsip_dialog_t* dialog = tsip_dialog_layer_find(layer, callid, tag_remote, tag_local, type, cid_matched);
+	tsk_object_unref(dialog);
+	return dialog;
+}
+
+static const tsip_dialog_t* test_dialog_layer_find_by_callid(tsip_dialog_layer_t* layer, const char* callid)
+{
+	tsip_dialog_t* dialog = tsip_dialog_layer_find_by_callid(layer, callid);
+	tsk_object_unref(dialog);
+	return dialog;
+}
+
+static const tsip_dialog_t* test_dialog_layer_find_by_ss(tsip_dialog_layer_t* layer, const tsip_ssession_handle_t* ss)
+{
+	tsip_dialog_t* dialog = tsip_dialog_layer_find_by_ss(layer, ss);
+	tsk_object_unref(dialog);
+	return dialog;
+}
+
+void test_dialog_layer()
+{
+	tsip_stack_handle_t* stack = tsip_stack_create(tsk_null, "sip:open-ims.test", "alice@open-ims.test", "sip:alice@open-ims.test", TSIP_STACK_SET_NULL());
+	tsip_dialog_layer_t* layer = tsip_dialog_layer_create(stack);
+	tsip_dialog_t *d1, *d2, *dialogs[TEST_DIALOG_LAYER_COUNT];
+	const tsip_dialog_t* found;
+	tsk_bool_t cid_matched, have;
+	char* callid = tsk_null;
+	tsk_size_t count;
+	int i, ret;
+
+	assert(stack && layer);
+
+	d1 = test_dialog_layer_new(layer, stack, "tag-local", "tag-remote-1");
+	assert(d1 && layer->count == 1);
+	tsk_strupdate(&callid, d1->callid);
+
+	/* Call-ID and tags */
+	found = test_dialog_layer_find(layer, callid, "tag-remote-1", "tag-local", tsip_BYE, &cid_matched);
+	assert(found == d1 && cid_matched);
+	found = test_dialog_layer_find(layer, callid, "tag-remote-2", "tag-local", tsip_BYE, &cid_matched);
+	assert(!found && cid_matched); /* remote tag mismatch */
+	found = test_dialog_layer_find(layer, callid, "tag-remote-1", "tag-other", tsip_BYE, &cid_matched);
+	assert(!found && cid_matched); /* local tag mismatch */
+	found = test_dialog_layer_find(layer, callid, "tag-remote-1", tsk_null, tsip_CANCEL, &cid_matched);
+	assert(found == d1 && cid_matched); /* CANCEL: local tag not checked */
+	found = test_dialog_layer_find(layer, callid, tsk_null, tsk_null, tsip_NOTIFY, &cid_matched);
+	assert(found == d1 && cid_matched); /* NOTIFY: tags not checked */
+	found = test_dialog_layer_find(layer, "unknown-call-id", "tag-remote-1", "tag-local", tsip_BYE, &cid_matched);
+	assert(!found && !cid_matched);
+	found = test_dialog_layer_find_by_callid(layer, callid);
+	assert(found == d1);
+	have = tsip_dialog_layer_have_dialog_with_callid(layer, callid);
+	assert(have);
+	found = test_dialog_layer_find_by_ss(layer, d1->ss);
+	assert(found == d1);
+
+	/* second dialog under the same Call-ID, other remote tag */
+	d2 = test_dialog_layer_fork(layer, stack, d1, "tag-remote-2");
+	assert(d2 && layer->count == 2);
+	found = test_dialog_layer_find(layer, callid, "tag-remote-2", "tag-local", tsip_BYE, &cid_matched);
+	assert(found == d2 && cid_matched);
+	found = test_dialog_layer_find(layer, callid, "tag-remote-1", "tag-local", tsip_BYE, &cid_matched);
+	assert(found == d1 && cid_matched);
+	found = test_dialog_layer_find_by_callid(layer, callid);
+	assert(found == d1); /* oldest first */
+	found = test_dialog_layer_find_by_ss(layer, d2->ss);
+	assert(found == d2);
+
+	/* the indexes are rebuilt when they grow */
+	for(i = 0; i < TEST_DIALOG_LAYER_COUNT; ++i){
+		dialogs[i] = test_dialog_layer_new(layer, stack, "tag-local", "tag-remote");
+		assert(dialogs[i]);
+	}
+	assert(layer->count == TEST_DIALOG_LAYER_COUNT + 2 && layer->buckets_count > TSIP_DIALOG_LAYER_BUCKETS_MIN);
+	for(i = 0; i < TEST_DIALOG_LAYER_COUNT; ++i){
+		found = test_dialog_layer_find(layer, dialogs[i]->callid, "tag-remote", "tag-local", tsip_BYE, &cid_matched);
+		assert(found == dialogs[i]);
+		found = test_dialog_layer_find_by_ss(layer, dialogs[i]->ss);
+		assert(found == dialogs[i]);
+	}
+	found = test_dialog_layer_find(layer, callid, "tag-remote-2", "tag-local", tsip_BYE, &cid_matched);
+	assert(found == d2);
+	found = test_dialog_layer_find(layer, callid, "tag-remote-1", "tag-local", tsip_BYE, &cid_matched);
+	assert(found == d1);
+
+	/* removing a dialog removes its index entries */
+	count = layer->count;
+	ret = tsip_dialog_layer_remove(layer, d1);
+	assert(ret == 0 && layer->count == count - 1);
+	found = test_dialog_layer_find(layer, callid, "tag-remote-1", "tag-local", tsip_BYE, &cid_matched);
+	assert(!found && cid_matched); /* only the second dialog is left */
+	found = test_dialog_layer_find_by_callid(layer, callid);
+	assert(found == d2);
+	found = test_dialog_layer_find_by_ss(layer, d1->ss);
+	assert(!found);
+	ret = tsip_dialog_layer_remove(layer, d1); /* not owned anymore */
+	assert(ret == 0 && layer->count == count - 1);
+	ret = tsip_dialog_layer_remove(layer, d2);
+	assert(ret == 0 && layer->count == count - 2);
+	found = test_dialog_layer_find(layer, callid, "tag-remote-2", "tag-local", tsip_BYE, &cid_matched);
+	assert(!found && !cid_matched);
+	have = tsip_dialog_layer_have_dialog_with_callid(layer, callid);
+	assert(!have);
+	found = test_dialog_layer_find_by_ss(layer, d2->ss);
+	assert(!found);
+	for(i = 0; i < TEST_DIALOG_LAYER_COUNT; i += 2){
+		ret = tsip_dialog_layer_remove(layer, dialogs[i]);
+		assert(ret == 0);
+	}
+	for(i = 0; i < TEST_DIALOG_LAYER_COUNT; ++i){
+		found = test_dialog_layer_find_by_callid(layer, dialogs[i]->callid);
+		assert(found == ((i & 1) ? dialogs[i] : tsk_null));
+		found = test_dialog_layer_find_by_ss(layer, dialogs[i]->ss);
+		assert(found == ((i & 1) ? dialogs[i] : tsk_null));
+	}
+	assert(layer->count == TEST_DIALOG_LAYER_COUNT / 2);
+
+	for(i = 0; i < TEST_DIALOG_LAYER_COUNT; ++i){
+		TSK_OBJECT_SAFE_FREE(dialogs[i]);
+	}
+	TSK_OBJECT_SAFE_FREE(d1);
+	TSK_OBJECT_SAFE_FREE(d2);
+	TSK_FREE(callid);
+	TSK_OBJECT_SAFE_FREE(layer);
+	TSK_OBJECT_SAFE_FREE(stack);
+	TSK_DEBUG_INFO("Test-dialog-layer: OK");
+}
+
+#endif /* _TEST_DIALOG_LAYER_H */
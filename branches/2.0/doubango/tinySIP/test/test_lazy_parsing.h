@@ -0,0 +1,156 @@
+/*
+* Copyright (C) 2009 Mamadou Diop.
+*
+* Contact: Mamadou Diop <diopmamadou(at)doubango[dot]org>
+*	
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*	
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*	
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*
+*/
+#ifndef _TEST_LAZY_PARSING_H
+#define _TEST_LAZY_PARSING_H
+
+#define LAZY_PARSING_THREADS	4
+#define LAZY_PARSING_LOOP		200
+
+/* the headers the transport parses eagerly are interleaved with the deferred ones, some of them have several values */
+#define LAZY_PARSING_MSG \
+	"INVITE sip:bob@open-ims.test SIP/2.0\r\n" \
+	"Via: SIP/2.0/UDP 10.0.0.1:5060;branch=z9hG4bK1,SIP/2.0/UDP 10.0.0.2:5060;branch=z9hG4bK2\r\n" \
+	"Route: <sip:pcscf.open-ims.test:4060;lr>\r\n" \
+	"Via: SIP/2.0/UDP 10.0.0.3:5060;branch=z9hG4bK3\r\n" \
+	"Max-Forwards: 70\r\n" \
+	"From: <sip:alice@open-ims.test>;tag=1234\r\n" \
+	"Route: <sip:scscf.open-ims.test:6060;lr>,<sip:as.open-ims.test;lr>\r\n" \
+	"To: <sip:bob@open-ims.test>\r\n" \
+	"Contact: <sip:alice@10.0.0.1:5060>,<sip:alice@10.0.0.4:5060>\r\n" \
+	"Allow: INVITE, ACK, BYE\r\n" \
+	"Call-ID: 4a5c1bd2\r\n" \
+	"Supported: timer, 100rel\r\n" \
+	"CSeq: 1 INVITE\r\n" \
+	"Contact: <sip:alice@10.0.0.5:5060>\r\n" \
+	"Allow: MESSAGE\r\n" \
+	"User-Agent: IM-client/OMA1.0\r\n" \
+	"Record-Route: <sip:pcscf.open-ims.test:4060;lr>\r\n" \
+	"Content-Type: text/plain\r\n" \
+	"Content-Length: 11\r\n" \
+	"\r\n" \
+	"How are you"
+
+static tsip_message_t* test_lazy_parsing_parse(const char* data, tsk_bool_t lazy)
+{
+	tsk_ragel_state_t state;
+	tsip_message_t *message = tsk_null;
+
+	tsk_ragel_state_init(&state, data, tsk_strlen(data));
+	if(!tsip_message_parse_2(&state, &message, tsk_true, lazy, tsk_true)){
+		TSK_OBJECT_SAFE_FREE(message);
+	}
+	return message;
+}
+
+/* the lazily parsed message must serialize as if it was fully parsed when received */
+static tsk_bool_t test_lazy_parsing_equals(const tsip_message_t* lazy, const tsk_buffer_t* expected)
+{
+	tsk_buffer_t *buffer = tsk_buffer_create_null();
+	tsk_bool_t ret;
+
+	tsip_message_tostring(lazy, buffer);
+	if(!(ret = (buffer->size == expected->size && !memcmp(buffer->data, expected->data, buffer->size)))){
+		TSK_DEBUG_ERROR("Lazy parsing mismatch:\n%s\nexpected:\n%s", TSK_BUFFER_TO_STRING(buffer), TSK_BUFFER_TO_STRING(expected));
+	}
+	TSK_OBJECT_SAFE_FREE(buffer);
+	return ret;
+}
+
+static void* TSK_STDCALL test_lazy_parsing_getters(void* arg)
+{
+	static const tsip_header_type_t types[] = { tsip_htype_Allow, tsip_htype_Route, tsip_htype_Via, tsip_htype_Supported, tsip_htype_Contact, tsip_htype_Record_Route };
+	const tsip_message_t* message = (const tsip_message_t*)arg;
+	tsk_size_t i;
+
+	for(i = 0; i < sizeof(types)/sizeof(types[0]); ++i){
+		tsip_message_get_headerLast(message, types[i]);
+	}
+	return tsk_null;
+}
+
+void test_lazy_parsing()
+{
+	tsip_message_t *eager = tsk_null, *lazy = tsk_null;
+	tsk_buffer_t *canonical = tsk_buffer_create_null(), *expected = tsk_buffer_create_null();
+	const tsip_header_Route_t* route;
+	const tsip_header_t* header;
+	tsk_thread_handle_t* threads[LAZY_PARSING_THREADS];
+	tsk_bool_t allowed;
+	int i, j, ret;
+
+	/* the deferred lines are copied as received: use the canonical form of the message */
+	eager = test_lazy_parsing_parse(LAZY_PARSING_MSG, tsk_false);
+	assert(eager);
+	tsip_message_tostring(eager, canonical);
+	TSK_OBJECT_SAFE_FREE(eager);
+	eager = test_lazy_parsing_parse(TSK_BUFFER_TO_STRING(canonical), tsk_false);
+	assert(eager);
+	tsip_message_tostring(eager, expected);
+	assert(canonical->size == expected->size && !memcmp(canonical->data, expected->data, expected->size));
+
+	/* nothing parsed on demand */
+	lazy = test_lazy_parsing_parse(TSK_BUFFER_TO_STRING(canonical), tsk_true);
+	assert(lazy && lazy->deferred.count > 0);
+	assert(test_lazy_parsing_equals(lazy, expected));
+
+	/* parsed on demand, out of order: the headers keep their place */
+	route = (const tsip_header_Route_t*)tsip_message_get_headerAt(lazy, tsip_htype_Route, 1);
+	assert(route && route->uri && tsk_striequals(route->uri->host, "scscf.open-ims.test"));
+	assert(test_lazy_parsing_equals(lazy, expected));
+	allowed = tsip_message_allowed(lazy, "MESSAGE");
+	assert(allowed);
+	assert(test_lazy_parsing_equals(lazy, expected));
+	header = tsip_message_get_headerAt(lazy, tsip_htype_Via, 2);
+	assert(header);
+	header = tsip_message_get_headerAt(lazy, tsip_htype_Via, 3);
+	assert(!header);
+	assert(test_lazy_parsing_equals(lazy, expected));
+	header = tsip_message_get_headerAt(lazy, tsip_htype_Contact, 2);
+	assert(header);
+	assert(test_lazy_parsing_equals(lazy, expected));
+	ret = tsip_message_parse_deferred_all(lazy);
+	assert(ret == 0);
+	assert(test_lazy_parsing_equals(lazy, expected));
+	assert(tsk_list_count(lazy->headers, tsk_null, tsk_null) == tsk_list_count(eager->headers, tsk_null, tsk_null));
+	TSK_OBJECT_SAFE_FREE(lazy);
+
+	/* getters called from several threads at the same time */
+	for(j = 0; j < LAZY_PARSING_LOOP; ++j){
+		lazy = test_lazy_parsing_parse(TSK_BUFFER_TO_STRING(canonical), tsk_true);
+		assert(lazy);
+		for(i = 0; i < LAZY_PARSING_THREADS; ++i){
+			ret = tsk_thread_create(&threads[i], test_lazy_parsing_getters, lazy);
+			assert(ret == 0);
+		}
+		for(i = 0; i < LAZY_PARSING_THREADS; ++i){
+			tsk_thread_join(&threads[i]);
+		}
+		assert(test_lazy_parsing_equals(lazy, expected));
+		TSK_OBJECT_SAFE_FREE(lazy);
+	}
+
+	TSK_OBJECT_SAFE_FREE(eager);
+	TSK_OBJECT_SAFE_FREE(canonical);
+	TSK_OBJECT_SAFE_FREE(expected);
+}
+
+#endif /* _TEST_LAZY_PARSING_H */
@@ -0,0 +1,97 @@
+/*
+* Copyright (C) 2009 Mamadou Diop.
+*
+* Contact: Mamadou Diop <diopmamadou(at)doubango[dot]org>
+*	
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*	
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*	
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*
+*/
+#ifndef _TEST_PARSING_H
+#define _TEST_PARSING_H
+
+#define PARSING_LOOP		20000
+#define PARSING_MSG \
+	"INVITE sip:bob@open-ims.test SIP/2.0\r\n" \
+	"Via: SIP/2.0/UDP 192.168.0.12:5060;branch=z9hG4bK1274980921982;rport\r\n" \
+	"Via: SIP/2.0/TCP 10.0.0.1:5060;branch=z9hG4bK3ac1;received=10.0.0.1\r\n" \
+	"Max-Forwards: 70\r\n" \
+	"Route: <sip:pcscf.open-ims.test:4060;lr;transport=udp>,<sip:orig@scscf.open-ims.test:6060;lr>\r\n" \
+	"Record-Route: <sip:mo@pcscf.open-ims.test:4060;lr>\r\n" \
+	"From: \"Alice\" <sip:alice@open-ims.test>;tag=1928301774\r\n" \
+	"To: <sip:bob@open-ims.test>\r\n" \
+	"Call-ID: a84b4c76e66710@pc33.open-ims.test\r\n" \
+	"CSeq: 314159 INVITE\r\n" \
+	"Contact: <sip:alice@192.168.0.12:5060;transport=udp>;+g.oma.sip-im\r\n" \
+	"Allow: INVITE, ACK, CANCEL, BYE, MESSAGE, OPTIONS, NOTIFY, PRACK, UPDATE, REFER\r\n" \
+	"Supported: timer, 100rel, path\r\n" \
+	"Session-Expires: 1800;refresher=uac\r\n" \
+	"Min-SE: 90\r\n" \
+	"User-Agent: IM-client/OMA1.0 doubango/v2.0\r\n" \
+	"P-Preferred-Identity: <sip:alice@open-ims.test>\r\n" \
+	"P-Access-Network-Info: 3GPP-UTRAN-TDD;utran-cell-id-3gpp=00000000\r\n" \
+	"Privacy: none\r\n" \
+	"Content-Type: text/plain\r\n" \
+	"Content-Length: 11\r\n" \
+	"\r\n" \
+	"How are you"
+
+/* parses then destroys the message as the transport layer does for each incoming message */
+static uint64_t test_parsing_loop(const char* data, tsk_bool_t lazy, tsk_bool_t arena, tsk_size_t* arena_bytes)
+{
+	uint64_t start = tsk_time_now();
+	tsk_ragel_state_t state;
+	tsip_message_t *message;
+	tsk_size_t i;
+
+	*arena_bytes = 0;
+	for(i = 0; i < PARSING_LOOP; ++i){
+		message = tsk_null;
+		tsk_ragel_state_init(&state, data, tsk_strlen(data));
+		if(!tsip_message_parse_2(&state, &message, tsk_true, lazy, arena)){
+			TSK_DEBUG_ERROR("Failed to parse the message");
+			TSK_OBJECT_SAFE_FREE(message);
+			break;
+		}
+		/* what the dialog layer always needs */
+		tsip_message_get_header(message, tsip_htype_Route);
+		tsip_message_get_header(message, tsip_htype_Record_Route);
+		if(message->arena){
+			*arena_bytes = message->arena->used;
+		}
+		TSK_OBJECT_SAFE_FREE(message);
+	}
+	return (tsk_time_now() - start);
+}
+
+void test_parsing()
+{
+	static const struct { tsk_bool_t lazy; tsk_bool_t arena; const char* name; } modes[] = {
+		{ tsk_false, tsk_false, "heap" },
+		{ tsk_false, tsk_true, "arena" },
+		{ tsk_true, tsk_false, "heap + lazy" },
+		{ tsk_true, tsk_true, "arena + lazy" },
+	};
+	tsk_size_t i, arena_bytes;
+	uint64_t duration;
+
+	for(i = 0; i < sizeof(modes)/sizeof(modes[0]); ++i){
+		duration = test_parsing_loop(PARSING_MSG, modes[i].lazy, modes[i].arena, &arena_bytes);
+		TSK_DEBUG_INFO("Parsing (%u bytes, %d loops) %s = %llu ms, %u bytes carved from the arena per message",
+			(unsigned)tsk_strlen(PARSING_MSG), PARSING_LOOP, modes[i].name, duration, (unsigned)arena_bytes);
+	}
+}
+
+#endif /* _TEST_PARSING_H */
@@ -0,0 +1,294 @@
+/*
+* Copyright (C) 2009 Mamadou Diop.
+*
+* Contact: Mamadou Diop <diopmamadou(at)doubango[dot]org>
+*	
+* This file is part of Open Source Doubango Framework.
+*
+* DOUBANGO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*	
+* DOUBANGO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*	
+* You should have received a copy of the GNU General Public License
+* along with DOUBANGO.
+*
+*/
+#ifndef _TEST_SERIALIZER_H
+#define _TEST_SERIALIZER_H
+
+#define SERIALIZER_LOOP		100000
+#define SERIALIZER_MSG		SIP_MESSAGE /* from test_sipmessages.h */
+
+/* Output of the printf-based serializer for each sample of test_sipmessages.h */
+#define SIP_REQUEST_GOLDEN \
+	"REGISTER sip:open-ims.test SIP/2.0\r\n" \
+	"Via: SIP/2.0/UDP [::]:1988;comp=sigcomp;rport=254;ttl=457;received=192.0.2.101;branch=z9hG4bK1245420841406;test=1234\r\n" \
+	"From: \"Mamadou\"<sip:mamadou@open-ims.test>;tag=29358\r\n" \
+	"To: <sip:mamadou@open-ims.test>;tag=12345\r\n" \
+	"Contact: <sip:mamadou@[::]:1988;comp=sigcomp;transport=udp>;expires=600000;+deviceID=\"3ca50bcb-7a67-44f1-afd0-994a55f930f4\";mobility=\"fixed\";+g.3gpp.cs-voice;+g.3gpp.app%5fref=\"urn%3Aurnxxx%3A3gpp-application.ims.iari.gsmais\";+g.oma.sip-im.large-message;+g.oma.sip-im\r\n" \
+	"Call-ID: M-fa53180346f7f55ceb8d8670f9223dbb\r\n" \
+	"CSeq: 201 REGISTER\r\n" \
+	"Content-Length: 180\r\n" \
+	"Test-Header: 0\r\n" \
+	"Max-Forwards: 70\r\n" \
+	"Allow: INVITE,ACK,CANCEL,BYE,MESSAGE,OPTIONS,NOTIFY,PRACK\r\n" \
+	"Allow: REFER,UPDATE\r\n" \
+	"Allow-Events: talk,hold,conference,LocalModeStatus\r\n" \
+	"User-Agent: IM-client/OMA1.0 doubango/v0.0.0\r\n" \
+	"Require: pref,path\r\n" \
+	"Service-Route: <sip:orig@open-ims.test:6060;lr>\r\n" \
+	"Service-Route: <sip:orig2@open-ims.test:6060;lr>\r\n" \
+	"Path: <sip:term@open-ims.test:4060;lr>\r\n" \
+	"Require: 100rel\r\n" \
+	"P-Preferred-Identity: <sip:mamadou@open-ims.test>\r\n" \
+	"Supported: path\r\n" \
+	"Supported: gruu,outbound,timer\r\n" \
+	"P-Access-Network-Info: 3GPP-UTRAN-TDD;utran-cell-id-3gpp=00000000\r\n" \
+	"Privacy: none;user;id\r\n" \
+	"Supported: gruu,outbound,path,timer\r\n" \
+	"Expires12: 1983\r\n" \
+	"\r\n"
+
+#define SIP_RESPONSE_GOLDEN \
+	"SIP/2.0 200 This is my reason phrase\r\n" \
+	"Via: SIP/2.0/UDP 192.168.0.11:63140;rport=63140;branch=z9hG4bK1261611942868\r\n" \
+	"From: <sip:mamadou@open-ims.test>;tag=1261611941121\r\n" \
+	"To: <sip:mamadou@open-ims.test>;tag=bweyal\r\n" \
+	"Contact: <sip:mamadou@192.168.0.12:58827;transport=udp>;expires=300;mobility=fixed;+deviceid=\"DD1289FA-C3D7-47bd-A40D-F1F1B2CC5FFC\"\r\n" \
+	"Call-ID: 1261611941121\r\n" \
+	"CSeq: 31516 REGISTER\r\n" \
+	"Content-Length: 0\r\n" \
+	"Min-Expires: 30\r\n" \
+	"Event: reg\r\n" \
+	"Contact: <sip:mamadou@192.168.0.12:58828;transport=udp>;expires=300;mobility=fixed;+deviceid=\"DD1289FA-C3D7-47bd-A40D-F1F1B2CC5FFC\"\r\n" \
+	"Contact: <sip:mamadou@192.168.0.12:58829;transport=udp>;expires=300;mobility=fixed;+deviceid=\"DD1289FA-C3D7-47bd-A40D-F1F1B2CC5FFC\"\r\n" \
+	"Contact: <sip:mamadou@192.168.0.11:63140>;expires=3600;q=1.0\r\n" \
+	"Contact: <sip:mamadou@192.168.0.11:56717>;expires=3600;q=1.0\r\n" \
+	"Contact: <sip:mamadou@127.0.0.1:5060>;expires=3600;q=1.0\r\n" \
+	"Contact: <sip:mamadou@127.0.0.1>;expires=3600;q=1.0\r\n" \
+	"P-Preferred-Identity: <sip:mamadou@open-ims.test>\r\n" \
+	"Path: <sip:term@open-ims.test:4060;lr>\r\n" \
+	"P-Access-Network-Info: 3GPP-UTRAN-TDD;utran-cell-id-3gpp=00000000\r\n" \
+	"Authorization: Digest username=\"Alice\",realm=\"atlanta.com\",nonce=\"84a4cc6f3082121f32b42a2187831a9e\",response=\"7587245234b3434cc3412213e5f113a5432,test=123\"\r\n" \
+	"Privacy: none;user;id\r\n" \
+	"Proxy-Authenticate: Digest realm=\"atlanta.com\",domain=\"sip:ss1.carrier.com\",qop=\"auth,auth-int\",nonce=\"f84f1cec41e6cbe5aea9c8e88d359\",opaque=\"\",stale=FALSE,algorithm=MD5,test=124\r\n" \
+	"Authorization: Digest username=\"bob\",realm=\"atlanta.example.com\",nonce=\"ea9c8e88df84f1cec4341ae6cbe5a359\",uri=\"sips:ss2.biloxi.example.com\",response=\"dfe56131d1958046689d83306477ecc\",opaque=\"\",test=\"7854\"\r\n" \
+	"Proxy-Authorization: Digest username=\"Alice\",realm=\"atlanta.com\",nonce=\"c60f3082ee1212b402a21831ae\",response=\"245f23415f11432b3434341c022\",test=666\r\n" \
+	"WWW-Authenticate: Digest realm=\"atlanta.com\",domain=\"sip:boxesbybob.com\",qop=\"auth\",nonce=\"f84f1cec41e6cbe5aea9c8e88d359\",opaque=\"\",stale=FALSE,algorithm=MD5,test=\"3\"\r\n" \
+	"l: 0\r\n" \
+	"Subscription-State: active;reason=deactivated;expires=507099;retry-after=145;test=jk\r\n" \
+	"\r\n"
+
+#define SIP_MESSAGE_GOLDEN \
+	"MESSAGE sip:mamadou@open-ims.test SIP/2.0\r\n" \
+	"Via: SIP/2.0/tcp 127.0.0.1:5082;branch=z9hG4bKc16be5aee32df400d01015675ab911ba\r\n" \
+	"From: \"Bob \"<sip:bob@open-ims.test>;tag=mercuro\r\n" \
+	"To: \"Alice\"<sip:alice@open-ims.test>\r\n" \
+	"Contact: <sip:mamadou@127.0.0.1:5060>\r\n" \
+	"Call-ID: 1262767804423\r\n" \
+	"CSeq: 8 MESSAGE\r\n" \
+	"Content-Type: text/plain;charset=utf-8\r\n" \
+	"Content-Length: 11\r\n" \
+	"Via: SIP/2.0/udp 127.0.0.1:5082;received=192.168.0.13;branch=z9hG4bKeec53b25db240bec92ea250964b8c1fa;received_port_ext=5081\r\n" \
+	"Via: SIP/2.0/UDP 192.168.0.12:57121;rport=57121;received=192.168.0.12;branch=z9hG4bK1274980921982;received_port_ext=5081\r\n" \
+	"Refer-To: <sips:a8342043f@atlanta.example.com>\r\n" \
+	"Refer-To: <sip:conf44@example.com>;isfocus\r\n" \
+	"Referred-By: <sip:referrer@referrer.example>;cid=\"20398823.2UWQFN309shb3@referrer.example\";\"20398823.2UWQFN309shb3@referrer.example\"\r\n" \
+	"Refer-Sub: false;test=45;op\r\n" \
+	"Refer-Sub: true;p\r\n" \
+	"RSeq: 17422\r\n" \
+	"RAck: 776656 1 INVITE\r\n" \
+	"Min-SE: 90;test;y=0\r\n" \
+	"Session-Expires: 95;refresher=uas;y=4\r\n" \
+	"Session-Expires: 95;refresher=uac;o=7;k\r\n" \
+	"Max-Forwards: 70\r\n" \
+	"Date: Wed, 28 Apr 2010 23:42:50 GMT\r\n" \
+	"Allow: INVITE,ACK,CANCEL,BYE,MESSAGE,OPTIONS,NOTIFY,PRACK,UPDATE,REFER\r\n" \
+	"User-Agent: IM-client/OMA1.0 TestUA/v4.0.1508.0\r\n" \
+	"Security-Client: ipsec-3gpp;alg=hmac-md5-96;ealg=aes-cbc;prot=esp;mod=(null);spi-c=4294967295;spi-s=67890;port-c=61676;port-s=61662;mod=trans\r\n" \
+	"Security-Client: tls;q=0.200\r\n" \
+	"Security-Client: ipsec-ike;q=0.100\r\n" \
+	"Security-Client: tls;q=0.200;test=123\r\n" \
+	"Security-Server: ipsec-ike;q=0.100\r\n" \
+	"Security-Server: ipsec-3gpp;alg=hmac-md5-96;ealg=aes-cbc;prot=esp;spi-c=5000;spi-s=5001;port-c=13416;port-s=12318;mod=trans\r\n" \
+	"Security-Verify: ipsec-3gpp;alg=hmac-md5-96;ealg=aes-cbc;prot=esp;spi-c=5000;spi-s=5001;port-c=9999;port-s=20000;mod=trans\r\n" \
+	"Security-Verify: ipsec-ike;q=0.100;test=458;toto\r\n" \
+	"Service-Route: <sip:orig@open-ims.test:6060;lr;transport=udp>\r\n" \
+	"Service-Route: <sip:atlanta.com>\r\n" \
+	"Service-Route: \"Originating\"<sip:orig2@open-ims.test:6060;lr>\r\n" \
+	"Path: <sip:term@open-ims.test:4060;lr>\r\n" \
+	"Route: \"Prox-CSCF\"<sip:pcscf.open-ims.test:4060;lr;transport=udp>;test=1\r\n" \
+	"Route: \"Originating\"<sip:orig@scscf.open-ims.test:6060;lr>\r\n" \
+	"Record-Route: <sip:mo@pcscf.ims.inexbee.com:4060;lr>\r\n" \
+	"Record-Route: \"Originating\"<sip:pcscf.open-ims.test:4060;lr;transport=udp>;test=2\r\n" \
+	"Allow-Events: presence,presence.winfo\r\n" \
+	"Event: reg\r\n" \
+	"P-Associated-URI: <sip:bob@open-ims.test>\r\n" \
+	"P-Associated-URI: <sip:0600000001@open-ims.test>\r\n" \
+	"P-Associated-URI: <sip:0100000001@open-ims.test>\r\n" \
+	"P-Charging-Function-Addresses: ccf=ccf=pri_ccf_address;ccf=pri_ccf_address\r\n" \
+	"Server: Sip EXpress router (2.0.0-dev1 OpenIMSCore (i386/linux))\r\n" \
+	"Warning: 392 192.168.0.15:6060 \"Noisy feedback tells:  pid=4521 req_src_ip=192.168.0.15 req_src_port=5060 in_uri=sip:scscf.open-ims.test:6060 out_uri=sip:scscf.open-ims.test:6060 via_cnt==3\"\r\n" \
+	"P-Asserted-Identity: \"Cullen Jennings\"<sip:fluffy@cisco.com>\r\n" \
+	"P-Asserted-Identity: <tel:+14085264000>\r\n" \
+	"WWW-Authenticate: Digest realm=\"ims.inexbee.com\",qop=\"auth\",nonce=\"iTaxDEv2uO8sKxzVVaRy6IkU9Lra6wAA2xv4BrmCzvY=\",stale=FALSE,algorithm=AKAv1-MD5\r\n" \
+	"WWW-Authenticate: Digest realm=\"ims.cingularme.com\",qop=\"auth\",nonce=\"b7c9036dbf3054aea9404c7286aee9703dc8f84c2008\",opaque=\"Lss:scsf-stdn.imsgroup0-001.ims1.wtcdca1.mobility.att.net:5060\",stale=FALSE,algorithm=MD5\r\n" \
+	"Etag: W/'1231-3213213'\r\n" \
+	"\r\n" \
+	"How are you"
+
+#define SIP_PUB_GRUU_GOLDEN \
+	"SIP/2.0 200 OK - SAR succesful and registrar saved\r\n" \
+	"Via: SIP/2.0/UDP 192.168.1.103:46268;rport=46268;received=10.19.3.201;branch=z9hG4bK1431761912;keep\r\n" \
+	"From: <sip:1111111111@open-ims.test>;tag=728193295\r\n" \
+	"To: <sip:1111111111@open-ims.test>;tag=80332102165c3c2994562ca45e4f4401-b009\r\n" \
+	"Contact: <sip:1111111111@192.168.1.103:37761;transport=udp>;expires=1593;pub-gruu=\"sip:1111111111@open-ims.test;gr=urn%3Auuid%3A00000000-0000-AAAA-8000-18879680264c\"\r\n" \
+	"Call-ID: ecfb4022-eb8f-ca0d-6885-fbeaafa65854\r\n" \
+	"CSeq: 1767541515 REGISTER\r\n" \
+	"Content-Length: 0\r\n" \
+	"P-Associated-URI: <sip:1111111111@open-ims.test>\r\n" \
+	"Contact: <sip:1111111111@192.168.1.103:46268;transport=udp>;expires=1700;pub-gruu=\"sip:1111111111@open-ims.test;gr=urn%3Auuid%3A00000000-0000-AAAA-8000-18879680264c\"\r\n" \
+	"Path: <sip:term@pcscf.open-ims.test:4060;lr>\r\n" \
+	"Service-Route: <sip:orig@scscf.open-ims.test:6060;lr>\r\n" \
+	"Allow: INVITE,ACK,CANCEL,OPTIONS,BYE,REFER,SUBSCRIBE,NOTIFY,PUBLISH,MESSAGE,INFO\r\n" \
+	"P-Charging-Function-Addresses: ccf=ccf=pri_ccf_address;ccf=pri_ccf_address\r\n" \
+	"Server: Sip EXpress router (2.1.0-dev1 OpenIMSCore (x86_64/linux))\r\n" \
+	"Warning: 392 10.19.3.160:6060 \"Noisy feedback tells:  pid=30444 req_src_ip=10.19.3.160 req_src_port=5060 in_uri=sip:scscf.open-ims.test:6060 out_uri=sip:scscf.open-ims.test:6060 via_cnt==3\"\r\n" \
+	"\r\n"
+
+#define SIP_OPTIONS_GOLDEN \
+	"SIP/2.0 200 OK\r\n" \
+	"Via: SIP/2.0/TCP 192.168.1.110:49144;rport=49144;received=10.19.3.223;branch=z9hG4bK580365294\r\n" \
+	"From: <sip:bob@open-ims.test>;tag=912385275\r\n" \
+	"To: <sip:1947@open-ims.test>;tag=131610378\r\n" \
+	"Call-ID: cbfac0bb-9426-c8cf-fbd9-96bc91ec8acb\r\n" \
+	"CSeq: 756765417 OPTIONS\r\n" \
+	"Content-Length: 0\r\n" \
+	"Accept: application/sdp\r\n" \
+	"Accept-Encoding: *\r\n" \
+	"Accept-Language: en\r\n" \
+	"Allow: INVITE,ACK,CANCEL,BYE,PRACK,UPDATE,REFER,MESSAGE,OPTIONS\r\n" \
+	"Supported: gruu\r\n" \
+	"P-Asserted-Identity: <sip:1947@open-ims.test>\r\n" \
+	"\r\n"
+
+#define SIP_COMPACT_GOLDEN \
+	"SIP/2.0 200 OK\r\n" \
+	"Via: SIP/2.0/TCP 10.51.2.181:51483;rport=51483;received=10.51.2.181;branch=z9hG4bK1652501\r\n" \
+	"From: <sip:847...@10.50.4.29>;tag=1656856\r\n" \
+	"To: <sip:847...@10.50.4.29>;tag=4553420699375288838\r\n" \
+	"Contact: <sip:8475551001@10.51.2.181:51483;transport=tcp>;+g.oma.sip-im;language=\"en,fr\"\r\n" \
+	"Call-ID: d1dab636-ff9b-2672-7521-4bea5e73fa7f\r\n" \
+	"CSeq: 24466 SUBSCRIBE\r\n" \
+	"Expires: 3600\r\n" \
+	"Content-Length: 0\r\n" \
+	"\r\n"
+
+/* Old send path: new buffer for each message, content appended after the headers then copied into the send buffer */
+static uint64_t test_serializer_fresh_buffer(const tsip_message_t* message, uint8_t* snd_buffer, tsk_size_t snd_buffer_size)
+{
+	uint64_t start = tsk_time_now();
+	tsk_size_t i;
+
+	for(i = 0; i < SERIALIZER_LOOP; ++i){
+		tsk_buffer_t *buffer = tsk_buffer_create_null();
+		tsip_message_tostring(message, buffer);
+		if(buffer->size <= snd_buffer_size){
+			memcpy(snd_buffer, buffer->data, buffer->size);
+		}
+		TSK_OBJECT_SAFE_FREE(buffer);
+	}
+	return (tsk_time_now() - start);
+}
+
+/* New send path: headers serialized into a reused buffer, content handed as is (second entry of the iovec) */
+static uint64_t test_serializer_reused_buffer(const tsip_message_t* message, tnet_iovec_t iov[2])
+{
+	uint64_t start = tsk_time_now();
+	tsk_buffer_t *buffer = tsk_buffer_create_null();
+	tsk_size_t i;
+
+	tsk_buffer_reserve(buffer, 4096);
+	for(i = 0; i < SERIALIZER_LOOP; ++i){
+		tsk_buffer_remove(buffer, 0, buffer->size);
+		tsip_message_tostring_2(message, buffer, tsk_false);
+		iov[0].data = buffer->data, iov[0].size = buffer->size;
+		iov[1].data = message->Content->data, iov[1].size = message->Content->size;
+	}
+	TSK_OBJECT_SAFE_FREE(buffer);
+	return (tsk_time_now() - start);
+}
+
+/* both paths must produce the bytes of the printf-based serializer */
+static void test_serializer_golden(const char* name, const char* data, const char* golden)
+{
+	tsk_ragel_state_t state;
+	tsip_message_t *message = tsk_null;
+	tsk_buffer_t *buffer = tsk_buffer_create_null(), *buffer_2 = tsk_buffer_create_null();
+	tsk_bool_t parsed;
+	int ret;
+
+	tsk_ragel_state_init(&state, data, tsk_strlen(data));
+	parsed = tsip_message_parse(&state, &message, tsk_true);
+	assert(parsed == tsk_true);
+
+	ret = tsip_message_tostring(message, buffer);
+	assert(ret == 0);
+	if(buffer->size != tsk_strlen(golden) || memcmp(buffer->data, golden, buffer->size)){
+		TSK_DEBUG_ERROR("%s: serialized message mismatch:\n%s\nexpected:\n%s", name, TSK_BUFFER_TO_STRING(buffer), golden);
+		assert(0);
+	}
+
+	ret = tsip_message_tostring_2(message, buffer_2, tsk_false);
+	assert(ret == 0);
+	if(TSIP_MESSAGE_HAS_CONTENT(message)){
+		ret = tsk_buffer_append(buffer_2, message->Content->data, message->Content->size);
+		assert(ret == 0);
+	}
+	assert(buffer_2->size == buffer->size && !memcmp(buffer_2->data, golden, buffer_2->size));
+
+	TSK_OBJECT_SAFE_FREE(message);
+	TSK_OBJECT_SAFE_FREE(buffer);
+	TSK_OBJECT_SAFE_FREE(buffer_2);
+}
+
+void test_serializer()
+{
+	tsk_ragel_state_t state;
+	tsip_message_t *message = tsk_null;
+	tsk_buffer_t *buffer = tsk_buffer_create_null();
+	static uint8_t snd_buffer[TSIP_SIGCOMP_MAX_BUFF_SIZE];
+	tnet_iovec_t iov[2];
+	uint64_t fresh, reused;
+
+	test_serializer_golden("SIP_REQUEST", SIP_REQUEST, SIP_REQUEST_GOLDEN);
+	test_serializer_golden("SIP_RESPONSE", SIP_RESPONSE, SIP_RESPONSE_GOLDEN);
+	test_serializer_golden("SIP_MESSAGE", SIP_MESSAGE, SIP_MESSAGE_GOLDEN);
+	test_serializer_golden("SIP_PUB_GRUU", SIP_PUB_GRUU, SIP_PUB_GRUU_GOLDEN);
+	test_serializer_golden("SIP_OPTIONS", SIP_OPTIONS, SIP_OPTIONS_GOLDEN);
+	test_serializer_golden("SIP_COMPACT", SIP_COMPACT, SIP_COMPACT_GOLDEN);
+
+	tsk_ragel_state_init(&state, SERIALIZER_MSG, tsk_strlen(SERIALIZER_MSG));
+	if(tsip_message_parse(&state, &message, tsk_true) != tsk_true || !TSIP_MESSAGE_HAS_CONTENT(message)){
+		TSK_DEBUG_ERROR("Failed to parse the message");
+		goto bail;
+	}
+	tsip_message_tostring(message, buffer);
+
+	fresh = test_serializer_fresh_buffer(message, snd_buffer, sizeof(snd_buffer));
+	reused = test_serializer_reused_buffer(message, iov);
+	TSK_DEBUG_INFO("Serializer (%u bytes, %d loops): fresh buffer + copy = %llu ms, reused buffer + iovec = %llu ms",
+		(unsigned)buffer->size, SERIALIZER_LOOP, fresh, reused);
+
+bail:
+	TSK_OBJECT_SAFE_FREE(message);
+	TSK_OBJECT_SAFE_FREE(buffer);
+}
+
+#endif /* _TEST_SERIALIZER_H */
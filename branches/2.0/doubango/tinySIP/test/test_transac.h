@@ -22,13 +22,188 @@
 #ifndef _TEST_TRANSAC_H
 #define _TEST_TRANSAC_H
 
+#include "tinysip/transactions/tsip_transac_layer.h"
+
+#define TEST_TRANSAC_COUNT	200 /* more than TSIP_TRANSAC_LAYER_BUCKETS_MIN: the indexes grow */
+
+static tsip_message_t* test_transac_parse(const char* first_line, const char* branch, const char* call_id, int32_t cseq, const char* method)
+{
+	tsk_ragel_state_t state;
+	tsip_message_t *message = tsk_null;
+	char* data = tsk_null;
+
+	tsk_sprintf(&data,
+		"%s\r\n"
+		"Via: SIP/2.0/UDP 10.0.0.1:5060;branch=%s\r\n"
+		"From: <sip:alice@open-ims.test>;tag=1234\r\n"
+		"To: <sip:bob@open-ims.test>\r\n"
+		"Call-ID: %s\r\n"
+		"CSeq: %d %s\r\n"
+		"Content-Length: 0\r\n"
+		"\r\n",
+		first_line, branch, call_id, cseq, method);
+	tsk_ragel_state_init(&state, data, tsk_strlen(data));
+	if(!tsip_message_parse(&state, &message, tsk_true)){
+		TSK_OBJECT_SAFE_FREE(message);
+	}
+	TSK_FREE(data);
+	return message;
+}
+
+#define test_transac_request(method, branch, call_id, cseq) test_transac_parse(method " sip:bob@open-ims.test SIP/2.0", (branch), (call_id), (cseq), method)
+#define test_transac_response(method, branch, call_id, cseq) test_transac_parse("SIP/2.0 200 OK", (branch), (call_id), (cseq), method)
+
+/* finds a server transaction and drops the reference returned by the layer */
+static const tsip_transac_t* test_transac_find_server(const tsip_transac_layer_t* layer, const tsip_message_t* message)
+{
+	tsip_transac_t* transac = tsip_transac_layer_find_server(layer, message);
+	tsk_object_unref(transac);
+	return transac;
+}
+
+static const tsip_transac_t* test_transac_find_client(const tsip_transac_layer_t* layer, const tsip_message_t* message)
+{
+	tsip_transac_t* transac = tsip_transac_layer_find_client(layer, message);
+	tsk_object_unref(transac);
+	return transac;
+}
+
 void test_transac()
 {
-	//tsip_transac_nict_t transact;
+	tsip_transac_layer_t* layer = tsip_transac_layer_create(tsk_null);
+	tsip_message_t *invite, *message, *request, *response;
+	tsip_transac_t *ist, *nist, *nict, *transacs[TEST_TRANSAC_COUNT];
+	const tsip_transac_t* found;
+	char branch[32], call_id[32];
+	int i, ret;
+
+	assert(layer);
+	invite = test_transac_request("INVITE", "z9hG4bK-invite", "call-1", 1);
+	message = test_transac_request("MESSAGE", "z9hG4bK-message", "call-2", 1);
+	assert(invite && message);
+
+	/* server transactions: indexed by branch as soon as they are created */
+	ist = tsip_transac_layer_new(layer, tsk_false, invite, tsk_null);
+	nist = tsip_transac_layer_new(layer, tsk_false, message, tsk_null);
+	assert(ist && nist && layer->count == 2);
+
+	/* branch + method */
+	found = test_transac_find_server(layer, invite);
+	assert(found == ist);
+	found = test_transac_find_server(layer, message);
+	assert(found == nist);
+	request = test_transac_request("BYE", "z9hG4bK-invite", "call-1", 2);
+	found = test_transac_find_server(layer, request);
+	assert(!found); /* same branch, other method */
+	TSK_OBJECT_SAFE_FREE(request);
+	request = test_transac_request("MESSAGE", "z9hG4bK-other", "call-2", 1);
+	found = test_transac_find_server(layer, request);
+	assert(!found); /* same method, other branch */
+	TSK_OBJECT_SAFE_FREE(request);
+
+	/* CANCEL: same branch as the INVITE */
+	request = test_transac_request("CANCEL", "z9hG4bK-invite", "call-1", 1);
+	found = test_transac_find_server(layer, request);
+	assert(found == ist);
+	TSK_OBJECT_SAFE_FREE(request);
+
+	/* ACK to a non-2xx final response: other branch, matched by Call-ID and CSeq */
+	request = test_transac_request("ACK", "z9hG4bK-ack", "call-1", 1);
+	found = test_transac_find_server(layer, request);
+	assert(found == ist);
+	TSK_OBJECT_SAFE_FREE(request);
+	request = test_transac_request("ACK", "z9hG4bK-ack", "call-1", 2);
+	found = test_transac_find_server(layer, request);
+	assert(!found); /* other CSeq */
+	TSK_OBJECT_SAFE_FREE(request);
+	request = test_transac_request("ACK", "z9hG4bK-ack", "call-2", 1);
+	found = test_transac_find_server(layer, request);
+	assert(!found); /* not an INVITE transaction */
+	TSK_OBJECT_SAFE_FREE(request);
+
+	/* client transaction: only indexed by branch once it is known */
+	request = test_transac_request("REGISTER", "z9hG4bK-register", "call-3", 1);
+	response = test_transac_response("REGISTER", "z9hG4bK-register", "call-3", 1);
+	nict = tsip_transac_layer_new(layer, tsk_true, request, tsk_null);
+	assert(nict && !nict->branch);
+	found = test_transac_find_client(layer, response);
+	assert(!found);
+	tsk_strupdate(&nict->branch, "z9hG4bK-register");
+	ret = tsip_transac_layer_index_branch(layer, nict);
+	assert(ret == 0);
+	found = test_transac_find_client(layer, response);
+	assert(found == nict);
+	ret = tsip_transac_layer_index_branch(layer, nict); /* already indexed */
+	assert(ret == 0);
+	TSK_OBJECT_SAFE_FREE(response);
+	response = test_transac_response("MESSAGE", "z9hG4bK-register", "call-3", 1);
+	found = test_transac_find_client(layer, response);
+	assert(!found); /* same branch, other method */
+	TSK_OBJECT_SAFE_FREE(response);
+	TSK_OBJECT_SAFE_FREE(request);
+
+	/* the indexes are rebuilt when they grow */
+	for(i = 0; i < TEST_TRANSAC_COUNT; ++i){
+		sprintf(branch, "z9hG4bK-%d", i);
+		sprintf(call_id, "call-id-%d", i);
+		request = test_transac_request("OPTIONS", branch, call_id, i);
+		transacs[i] = tsip_transac_layer_new(layer, tsk_false, request, tsk_null);
+		assert(transacs[i]);
+		TSK_OBJECT_SAFE_FREE(request);
+	}
+	assert(layer->count == TEST_TRANSAC_COUNT + 3 && layer->buckets_count > TSIP_TRANSAC_LAYER_BUCKETS_MIN);
+	for(i = 0; i < TEST_TRANSAC_COUNT; ++i){
+		sprintf(branch, "z9hG4bK-%d", i);
+		sprintf(call_id, "call-id-%d", i);
+		request = test_transac_request("OPTIONS", branch, call_id, i);
+		found = test_transac_find_server(layer, request);
+		assert(found == transacs[i]);
+		TSK_OBJECT_SAFE_FREE(request);
+	}
+	found = test_transac_find_server(layer, invite);
+	assert(found == ist);
 
-	//tsip_transac_nict_init(&transact);
+	/* removing a transaction removes its index entries */
+	ret = tsip_transac_layer_remove(layer, ist);
+	assert(ret == 0 && layer->count == TEST_TRANSAC_COUNT + 2);
+	found = test_transac_find_server(layer, invite);
+	assert(!found);
+	request = test_transac_request("ACK", "z9hG4bK-ack", "call-1", 1);
+	found = test_transac_find_server(layer, request);
+	assert(!found);
+	TSK_OBJECT_SAFE_FREE(request);
+	ret = tsip_transac_layer_remove(layer, ist); /* not owned anymore */
+	assert(ret == 0 && layer->count == TEST_TRANSAC_COUNT + 2);
+	ret = tsip_transac_layer_remove(layer, nict);
+	assert(ret == 0);
+	response = test_transac_response("REGISTER", "z9hG4bK-register", "call-3", 1);
+	found = test_transac_find_client(layer, response);
+	assert(!found);
+	TSK_OBJECT_SAFE_FREE(response);
+	for(i = 0; i < TEST_TRANSAC_COUNT; i += 2){
+		ret = tsip_transac_layer_remove(layer, transacs[i]);
+		assert(ret == 0);
+	}
+	for(i = 0; i < TEST_TRANSAC_COUNT; ++i){
+		sprintf(branch, "z9hG4bK-%d", i);
+		sprintf(call_id, "call-id-%d", i);
+		request = test_transac_request("OPTIONS", branch, call_id, i);
+		found = test_transac_find_server(layer, request);
+		assert(found == ((i & 1) ? transacs[i] : tsk_null));
+		TSK_OBJECT_SAFE_FREE(request);
+		TSK_OBJECT_SAFE_FREE(transacs[i]);
+	}
+	found = test_transac_find_server(layer, message);
+	assert(found == nist);
+	assert(layer->count == (TEST_TRANSAC_COUNT / 2) + 1);
 
-	//tsk_thread_sleep(2000);
+	TSK_OBJECT_SAFE_FREE(ist);
+	TSK_OBJECT_SAFE_FREE(nist);
+	TSK_OBJECT_SAFE_FREE(nict);
+	TSK_OBJECT_SAFE_FREE(invite);
+	TSK_OBJECT_SAFE_FREE(message);
+	TSK_OBJECT_SAFE_FREE(layer);
+	TSK_DEBUG_INFO("Test-transac: OK");
 }
 
 #endif /* _TEST_TRANSAC_H */